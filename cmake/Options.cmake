@@ -8,6 +8,8 @@ option(SNAPPIN_ENABLE_RECORD      "Enable Recording module" OFF)
 option(SNAPPIN_ENABLE_UIA         "Enable UI Automation element detection" OFF)
 
 option(SNAPPIN_ENABLE_DEBUG_PANEL "Enable debug panel (build-time)" OFF)
+option(SNAPPIN_ENABLE_SIMD        "Enable SSE2/AVX2/NEON pixel kernels" ON)
 option(SNAPPIN_STRICT_WARNINGS    "Treat warnings as errors" ON)
 
 option(SNAPPIN_BUILD_TESTS        "Build unit tests" ON)
+option(SNAPPIN_BUILD_BENCHMARKS   "Build micro-benchmarks (not registered with ctest)" ON)
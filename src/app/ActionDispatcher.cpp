@@ -1,15 +1,20 @@
 ﻿#include "ActionDispatcher.h"
 
 #include "CaptureFreeze.h"
+#include "CaptureHistoryStore.h"
 #include "ConfigService.h"
 #include "ErrorCodes.h"
 #include "OverlayWindow.h"
 #include "AnnotateWindow.h"
 #include "Artifact.h"
+#include "ExportQueue.h"
 #include "ExportService.h"
 #include "ToolbarWindow.h"
 #include "SettingsWindow.h"
 #include "PinManager.h"
+#include "StatsService.h"
+#include "TaskScheduler.h"
+#include "TraceRecorder.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -24,10 +29,12 @@
 #include <shlobj.h>
 
 #include <cctype>
+#include <charconv>
 #include <climits>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -173,10 +180,9 @@ std::string ExpandPattern(const std::string& pattern) {
   return out;
 }
 
-std::optional<CpuBitmap> CaptureRectToCpu(const RectPX& rect,
-                                          std::shared_ptr<std::vector<uint8_t>>* storage_out) {
-  if (!storage_out || rect.w <= 0 || rect.h <= 0) {
-    return std::nullopt;
+BitmapView CaptureRectToCpu(const RectPX& rect) {
+  if (rect.w <= 0 || rect.h <= 0) {
+    return BitmapView();
   }
   BITMAPINFO bmi = {};
   bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
@@ -188,7 +194,7 @@ std::optional<CpuBitmap> CaptureRectToCpu(const RectPX& rect,
 
   HDC screen = GetDC(nullptr);
   if (!screen) {
-    return std::nullopt;
+    return BitmapView();
   }
   void* bits = nullptr;
   HBITMAP dib = CreateDIBSection(screen, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
@@ -197,14 +203,14 @@ std::optional<CpuBitmap> CaptureRectToCpu(const RectPX& rect,
       DeleteObject(dib);
     }
     ReleaseDC(nullptr, screen);
-    return std::nullopt;
+    return BitmapView();
   }
 
   HDC mem = CreateCompatibleDC(screen);
   if (!mem) {
     DeleteObject(dib);
     ReleaseDC(nullptr, screen);
-    return std::nullopt;
+    return BitmapView();
   }
   HGDIOBJ old = SelectObject(mem, dib);
   BOOL ok = BitBlt(mem, 0, 0, rect.w, rect.h, screen, rect.x, rect.y,
@@ -214,7 +220,7 @@ std::optional<CpuBitmap> CaptureRectToCpu(const RectPX& rect,
   ReleaseDC(nullptr, screen);
   if (!ok) {
     DeleteObject(dib);
-    return std::nullopt;
+    return BitmapView();
   }
 
   const int32_t stride = rect.w * 4;
@@ -225,13 +231,7 @@ std::optional<CpuBitmap> CaptureRectToCpu(const RectPX& rect,
   std::memcpy(storage->data(), bits, total);
   DeleteObject(dib);
 
-  CpuBitmap bmp;
-  bmp.format = PixelFormat::BGRA8;
-  bmp.size_px = SizePX{rect.w, rect.h};
-  bmp.stride_bytes = stride;
-  bmp.data.p = storage->data();
-  *storage_out = std::move(storage);
-  return bmp;
+  return BitmapView::FromBuffer(std::move(storage), SizePX{rect.w, rect.h}, stride);
 }
 
 std::wstring TrimWide(const std::wstring& value) {
@@ -262,26 +262,43 @@ bool TryParseInt32(const std::string& text, int32_t* out) {
   return true;
 }
 
-Result<std::wstring> RunSystemOcr(const CpuBitmap& bmp,
-                                  const std::vector<uint8_t>& pixels) {
-  if (bmp.format != PixelFormat::BGRA8 || bmp.size_px.w <= 0 || bmp.size_px.h <= 0 ||
-      bmp.stride_bytes < bmp.size_px.w * 4) {
-    Error err;
-    err.code = ERR_TARGET_INVALID;
-    err.message = "Artifact bitmap format unsupported";
-    err.retryable = false;
-    err.detail = "ocr_bitmap_format";
-    return Result<std::wstring>::Fail(err);
+// Plain decimal digits only: no sign, whitespace or trailing text, and the
+// value must fit in size_t.
+bool TryParseIndex(const std::string& text, size_t* out) {
+  if (!out || text.empty()) {
+    return false;
+  }
+  size_t v = 0;
+  const char* last = text.data() + text.size();
+  const std::from_chars_result r = std::from_chars(text.data(), last, v);
+  if (r.ec != std::errc() || r.ptr != last) {
+    return false;
+  }
+  *out = v;
+  return true;
+}
+
+// "fast" | "balanced" | "small"; anything else keeps `fallback`.
+PngPreset ParsePngPreset(const std::string& value, PngPreset fallback) {
+  if (value == "fast") {
+    return PngPreset::Fast;
+  }
+  if (value == "balanced") {
+    return PngPreset::Balanced;
   }
+  if (value == "small") {
+    return PngPreset::Small;
+  }
+  return fallback;
+}
 
-  const size_t expected =
-      static_cast<size_t>(bmp.stride_bytes) * static_cast<size_t>(bmp.size_px.h);
-  if (pixels.size() < expected) {
+Result<std::wstring> RunSystemOcr(const BitmapView& bmp) {
+  if (!bmp.valid() || bmp.format() != PixelFormat::BGRA8) {
     Error err;
     err.code = ERR_TARGET_INVALID;
-    err.message = "Artifact bitmap storage invalid";
+    err.message = "Artifact bitmap format unsupported";
     err.retryable = false;
-    err.detail = "ocr_bitmap_storage";
+    err.detail = "ocr_bitmap_format";
     return Result<std::wstring>::Fail(err);
   }
 
@@ -299,16 +316,15 @@ Result<std::wstring> RunSystemOcr(const CpuBitmap& bmp,
       return Result<std::wstring>::Fail(err);
     }
 
-    const int32_t packed_stride = bmp.size_px.w * 4;
+    const int32_t packed_stride = bmp.size_px().w * 4;
     const size_t packed_size =
-        static_cast<size_t>(packed_stride) * static_cast<size_t>(bmp.size_px.h);
-    const uint8_t* ocr_data = pixels.data();
+        static_cast<size_t>(packed_stride) * static_cast<size_t>(bmp.size_px().h);
+    const uint8_t* ocr_data = bmp.data();
     std::vector<uint8_t> packed;
-    if (bmp.stride_bytes != packed_stride) {
+    if (bmp.stride_bytes() != packed_stride) {
       packed.resize(packed_size);
-      for (int32_t y = 0; y < bmp.size_px.h; ++y) {
-        const uint8_t* src_row =
-            pixels.data() + static_cast<size_t>(y) * bmp.stride_bytes;
+      for (int32_t y = 0; y < bmp.size_px().h; ++y) {
+        const uint8_t* src_row = bmp.row(y);
         uint8_t* dst_row =
             packed.data() + static_cast<size_t>(y) * packed_stride;
         std::memcpy(dst_row, src_row, static_cast<size_t>(packed_stride));
@@ -324,7 +340,7 @@ Result<std::wstring> RunSystemOcr(const CpuBitmap& bmp,
     auto software_bitmap =
         winrt::Windows::Graphics::Imaging::SoftwareBitmap::CreateCopyFromBuffer(
             buffer, winrt::Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8,
-        bmp.size_px.w, bmp.size_px.h,
+        bmp.size_px().w, bmp.size_px().h,
         winrt::Windows::Graphics::Imaging::BitmapAlphaMode::Ignore);
 
     auto recognized = engine.RecognizeAsync(software_bitmap).get();
@@ -355,6 +371,50 @@ Result<std::wstring> RunSystemOcr(const CpuBitmap& bmp,
   }
 }
 
+// Saves the request, retrying a generated path on the desktop or in the temp
+// directory when the configured folder is not writable.
+Result<std::wstring> SaveWithFallback(IExportService* exporter,
+                                      const ExportRequest& request) {
+  Result<std::wstring> saved = exporter->SaveImage(request.artifact, request.options);
+  if (saved.ok || !request.auto_path || saved.error.code != ERR_PATH_NOT_WRITABLE) {
+    return saved;
+  }
+  std::wstring fallback_dir = GetDesktopDir();
+  if (fallback_dir.empty()) {
+    wchar_t temp_path[MAX_PATH] = {};
+    DWORD len = GetTempPathW(MAX_PATH, temp_path);
+    if (len > 0 && len < MAX_PATH) {
+      fallback_dir.assign(temp_path, temp_path + len);
+      if (!fallback_dir.empty() &&
+          (fallback_dir.back() == L'\\' || fallback_dir.back() == L'/')) {
+        fallback_dir.pop_back();
+      }
+    }
+  }
+  if (fallback_dir.empty()) {
+    return saved;
+  }
+  std::wstring file_name = L"SnapPin";
+  std::wstring name_only = request.options.path;
+  size_t pos = name_only.find_last_of(L"\\/");
+  if (pos != std::wstring::npos) {
+    name_only = name_only.substr(pos + 1);
+  }
+  if (!name_only.empty()) {
+    size_t dot = name_only.find_last_of(L'.');
+    if (dot != std::wstring::npos) {
+      name_only = name_only.substr(0, dot);
+    }
+    name_only = SanitizeFileName(name_only);
+    if (!name_only.empty()) {
+      file_name = name_only;
+    }
+  }
+  SaveImageOptions options = request.options;
+  options.path = BuildAutoSavePath(fallback_dir, file_name);
+  return exporter->SaveImage(request.artifact, options);
+}
+
 } // namespace
 
 ActionDispatcher::ActionDispatcher(IActionRegistry& registry, RuntimeState* state, HWND hwnd,
@@ -373,19 +433,92 @@ ActionDispatcher::ActionDispatcher(IActionRegistry& registry, RuntimeState* stat
       toolbar_(toolbar),
       annotate_window_(annotate_window),
       settings_(settings),
-      pin_manager_(pin_manager) {}
+      pin_manager_(pin_manager) {
+  // One save at a time: the PNG encoder already spreads a save across cores.
+  export_queue_ = std::make_unique<ExportQueue>(
+      [this](const ExportRequest& request) {
+        return SaveWithFallback(exporter_, request);
+      },
+      [this](const ExportQueueEvent& ev) { QueueExportEvent(ev); }, 1);
+
+  RegisterAppHandlers();
+  RegisterCaptureHandlers();
+  RegisterExportHandlers();
+  RegisterPinHandlers();
+  RegisterAnnotateHandlers();
+  RegisterOcrHandlers();
+  RegisterHistoryHandlers();
+  RegisterDebugHandlers();
+}
+
+bool ActionDispatcher::RegisterHandler(std::string_view action_id, ActionHandler handler) {
+  const ActionHandle handle = registry_.Lookup(action_id);
+  if (!handle.valid()) {
+    char buffer[160];
+    _snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "handler for unknown action %.*s\n",
+                static_cast<int>(action_id.size()), action_id.data());
+    OutputDebugStringA(buffer);
+    return false;
+  }
+  return handlers_.Set(handle, std::move(handler));
+}
+
+void ActionDispatcher::RegisterAppHandlers() {
+  RegisterHandler("app.exit", [this](ActionCall& call) { return AppExit(call); });
+  RegisterHandler("settings.reload", [this](ActionCall& call) { return SettingsReload(call); });
+  RegisterHandler("settings.open", [this](ActionCall& call) { return SettingsOpen(call); });
+}
+
+void ActionDispatcher::RegisterCaptureHandlers() {
+  RegisterHandler("capture.start", [this](ActionCall& call) { return CaptureStart(call); });
+  RegisterHandler("artifact.dismiss",
+                  [this](ActionCall& call) { return ArtifactDismiss(call); });
+}
+
+void ActionDispatcher::RegisterExportHandlers() {
+  RegisterHandler("export.copy_image",
+                  [this](ActionCall& call) { return ExportCopyImage(call); });
+  RegisterHandler("export.save_image",
+                  [this](ActionCall& call) { return ExportSaveImage(call); });
+}
+
+// The other pin.* actions only touch existing pins and are registered by
+// PinManager::RegisterActions; creating a pin from the artifact also ends the
+// capture session, which lives here.
+void ActionDispatcher::RegisterPinHandlers() {
+  RegisterHandler("pin.create_from_artifact",
+                  [this](ActionCall& call) { return PinCreateFromArtifact(call); });
+}
+
+void ActionDispatcher::RegisterAnnotateHandlers() {
+  RegisterHandler("annotate.open", [this](ActionCall& call) { return AnnotateOpen(call); });
+}
+
+void ActionDispatcher::RegisterOcrHandlers() {
+  RegisterHandler("ocr.start", [this](ActionCall& call) { return OcrStart(call); });
+}
+
+void ActionDispatcher::RegisterHistoryHandlers() {
+  RegisterHandler("history.pin_recent",
+                  [this](ActionCall& call) { return HistoryPinRecent(call); });
+}
+
+void ActionDispatcher::RegisterDebugHandlers() {
+  RegisterHandler("debug.trace_dump", [this](ActionCall& call) { return DebugTraceDump(call); });
+}
 
 bool ActionDispatcher::IsEnabled(const std::string& action_id, const RuntimeState& state) {
-  auto desc = registry_.Find(action_id);
-  if (!desc.has_value()) {
+  const ActionDescriptor* desc = registry_.Find(action_id);
+  if (!desc) {
     return false;
   }
-  return IsContextAllowed(desc.value(), state);
+  return IsContextAllowed(*desc, state);
 }
 
 Result<Id64> ActionDispatcher::Invoke(const ActionInvoke& req) {
-  auto desc = registry_.Find(req.id);
-  if (!desc.has_value()) {
+  const ActionHandle handle = registry_.Lookup(req.id);
+  const ActionDescriptor* desc = registry_.Find(handle);
+  if (!desc) {
     Error err;
     err.code = ERR_INTERNAL_ERROR;
     err.message = "Unknown action";
@@ -395,7 +528,7 @@ Result<Id64> ActionDispatcher::Invoke(const ActionInvoke& req) {
   }
 
   const RuntimeState state_snapshot = state_ ? *state_ : RuntimeState{};
-  if (!IsContextAllowed(desc.value(), state_snapshot)) {
+  if (!IsContextAllowed(*desc, state_snapshot)) {
     Error err;
     err.code = ERR_OPERATION_ABORTED;
     err.message = "Action not enabled";
@@ -404,6 +537,8 @@ Result<Id64> ActionDispatcher::Invoke(const ActionInvoke& req) {
     return Result<Id64>::Fail(err);
   }
 
+  // Descriptor ids live as long as the registry, so the span can keep it.
+  SNAPPIN_TRACE_SPAN(desc->id.c_str(), "action");
   Id64 correlation_id{next_correlation_.fetch_add(1)};
 
   ActionEvent started{};
@@ -412,7 +547,22 @@ Result<Id64> ActionDispatcher::Invoke(const ActionInvoke& req) {
   started.type = ActionEvent::Type::Started;
   EmitEvent(started);
 
-  Result<void> exec = ExecuteAction(req, correlation_id);
+  ActionCall call{req, handle, correlation_id};
+  const uint64_t t0 = MonotonicMicros();
+  Result<void> exec;
+  if (const ActionHandler* handler = handlers_.Get(handle)) {
+    exec = (*handler)(call);
+  } else {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "No handler";
+    err.retryable = false;
+    err.detail = req.id;
+    exec = Result<void>::Fail(err);
+  }
+  if (stats_) {
+    stats_->RecordActionMicros(req.id, MonotonicMicros() - t0);
+  }
   if (!exec.ok) {
     ActionEvent failed{};
     failed.action_id = req.id;
@@ -422,6 +572,9 @@ Result<Id64> ActionDispatcher::Invoke(const ActionInvoke& req) {
     EmitEvent(failed);
     return Result<Id64>::Ok(correlation_id);
   }
+  if (call.deferred) {
+    return Result<Id64>::Ok(correlation_id);
+  }
 
   ActionEvent done{};
   done.action_id = req.id;
@@ -433,8 +586,21 @@ Result<Id64> ActionDispatcher::Invoke(const ActionInvoke& req) {
 }
 
 void ActionDispatcher::Subscribe(std::function<void(const ActionEvent&)> cb) {
-  std::lock_guard<std::mutex> lock(subs_mu_);
-  subscribers_.push_back(std::move(cb));
+  events_.Subscribe(std::move(cb));
+}
+
+void ActionDispatcher::SetStatsService(StatsService* stats) { stats_ = stats; }
+
+void ActionDispatcher::SetCaptureHistory(CaptureHistoryStore* history) { history_ = history; }
+
+void ActionDispatcher::AppendActiveToHistory() {
+  if (!history_ || !artifacts_ || !state_ || !state_->active_artifact_id.has_value()) {
+    return;
+  }
+  // Compression and the disk write happen on the history's own thread.
+  if (std::shared_ptr<const Artifact> art = artifacts_->Get(*state_->active_artifact_id)) {
+    history_->Append(*art);
+  }
 }
 
 bool ActionDispatcher::ContextSatisfied(ActionContext ctx, const RuntimeState& state) const {
@@ -471,626 +637,668 @@ bool ActionDispatcher::IsContextAllowed(const ActionDescriptor& desc,
   return false;
 }
 
-void ActionDispatcher::EmitEvent(const ActionEvent& ev) {
-  std::vector<std::function<void(const ActionEvent&)>> subs_copy;
+void ActionDispatcher::DrainExportEvents() {
+  std::vector<ActionEvent> events;
+  std::vector<std::wstring> open_dirs;
   {
-    std::lock_guard<std::mutex> lock(subs_mu_);
-    subs_copy = subscribers_;
-  }
-  for (auto& cb : subs_copy) {
-    cb(ev);
-  }
-}
-
-Result<void> ActionDispatcher::ExecuteAction(const ActionInvoke& req, Id64) {
-  if (req.id == "app.exit") {
-    if (hwnd_) {
-      PostMessageW(hwnd_, WM_CLOSE, 0, 0);
-    }
-    return Result<void>::Ok();
-  }
-  if (req.id == "capture.start") {
-    if (state_ && (state_->overlay_visible || state_->active_artifact_id.has_value() ||
-                   state_->annotate_running)) {
-      if (annotate_window_ && annotate_window_->IsVisible()) {
-        annotate_window_->EndSession();
-      }
-      if (toolbar_) {
-        toolbar_->Hide();
+    std::lock_guard<std::mutex> lock(export_mu_);
+    events.swap(export_events_);
+    for (const ActionEvent& ev : events) {
+      if (ev.type == ActionEvent::Type::Progress) {
+        continue;
       }
-      if (overlay_) {
-        overlay_->Hide();
+      bool open = export_open_folder_.erase(ev.correlation_id.value) > 0;
+      if (open && ev.type == ActionEvent::Type::Succeeded) {
+        open_dirs.push_back(DirName(WidenUtf8(ev.output_ref)));
       }
-      if (artifacts_) {
-        artifacts_->ClearActive();
-      }
-      ClearFrozenFrame();
-      state_->overlay_visible = overlay_ ? overlay_->IsVisible() : false;
-      state_->active_artifact_id.reset();
-      state_->annotate_running = false;
-      return Result<void>::Ok();
     }
-    if (!overlay_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Overlay unavailable";
-      err.retryable = true;
-      err.detail = "overlay_null";
-      return Result<void>::Fail(err);
-    }
-    Result<void> freeze = PrepareFrozenFrameForCursorMonitor();
-    if (!freeze.ok) {
-      OutputDebugStringA("Capture freeze failed\n");
-      ClearFrozenFrame();
-    }
-    const FrozenFrame* frozen = PeekFrozenFrame();
-    if (overlay_) {
-      if (frozen && frozen->pixels) {
-        overlay_->SetFrozenFrame(frozen->pixels, frozen->size_px,
-                                 frozen->stride_bytes);
-        overlay_->ShowForRect(frozen->screen_rect_px);
-      } else {
-        overlay_->ClearFrozenFrame();
-        overlay_->ShowForCurrentMonitor();
-      }
-    }
-    if (state_) {
-      state_->overlay_visible = overlay_->IsVisible();
-    }
-    if (!overlay_->IsVisible()) {
-      ClearFrozenFrame();
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Overlay show failed";
-      err.retryable = true;
-      err.detail = "overlay_show_failed";
-      return Result<void>::Fail(err);
-    }
-    return Result<void>::Ok();
   }
-  if (req.id == "export.copy_image") {
-    if (!artifacts_ || !exporter_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Export unavailable";
-      err.retryable = true;
-      err.detail = "export_null";
-      return Result<void>::Fail(err);
-    }
-    std::optional<Id64> active_id = state_ ? state_->active_artifact_id : std::nullopt;
-    if (!active_id.has_value()) {
-      Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "No active artifact";
-      err.retryable = false;
-      err.detail = "no_active_artifact";
-      return Result<void>::Fail(err);
-    }
-    std::optional<Artifact> art = artifacts_->Get(active_id.value());
-    if (!art.has_value()) {
-      Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "Artifact missing";
-      err.retryable = false;
-      err.detail = "artifact_missing";
-      return Result<void>::Fail(err);
-    }
-    return exporter_->CopyImageToClipboard(*art);
-  }
-  if (req.id == "export.save_image") {
-    if (!artifacts_ || !exporter_ || !config_service_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Export unavailable";
-      err.retryable = true;
-      err.detail = "export_save_null";
-      return Result<void>::Fail(err);
-    }
-    std::optional<Id64> active_id = state_ ? state_->active_artifact_id : std::nullopt;
-    if (!active_id.has_value()) {
-      Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "No active artifact";
-      err.retryable = false;
-      err.detail = "no_active_artifact";
-      return Result<void>::Fail(err);
-    }
-    std::optional<Artifact> art = artifacts_->Get(active_id.value());
-    if (!art.has_value()) {
-      Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "Artifact missing";
-      err.retryable = false;
-      err.detail = "artifact_missing";
-      return Result<void>::Fail(err);
-    }
-
-    SaveImageOptions options;
-    options.format = ImageFormat::PNG;
-
-    std::optional<std::string> format = FindParam(req, "format");
-    if (format.has_value()) {
-      std::string upper = *format;
-      for (char& ch : upper) {
-        ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
-      }
-      if (upper != "PNG") {
-        Error err;
-        err.code = ERR_ENCODE_IMAGE_FAILED;
-        err.message = "Unsupported format";
-        err.retryable = false;
-        err.detail = "format";
-        return Result<void>::Fail(err);
-      }
-    }
-
-    std::wstring path;
-    std::optional<std::string> path_param = FindParam(req, "path");
-    if (path_param.has_value()) {
-      path = WidenUtf8(*path_param);
-    }
-    if (path.empty()) {
-      std::wstring dir = config_service_->ExportSaveDir();
-      if (dir.empty()) {
-        dir = GetDesktopDir();
-      }
-      if (dir.empty()) {
-        dir = JoinPath(config_service_->RootDir(), L"exports");
-      }
-      if (!EnsureDir(dir)) {
-        Error err;
-        err.code = ERR_PATH_NOT_WRITABLE;
-        err.message = "Save path not writable";
-        err.retryable = false;
-        err.detail = "export_dir";
-        return Result<void>::Fail(err);
-      }
-      std::string pattern = config_service_->ExportNamingPattern();
-      if (pattern.empty()) {
-        pattern = "SnapPin_{yyyyMMdd_HHmmss}_{rand4}";
-      }
-      std::string filename = ExpandPattern(pattern);
-      std::wstring safe = SanitizeFileName(WidenUtf8(filename));
-      if (safe.empty()) {
-        safe = L"SnapPin";
-      }
-      path = BuildAutoSavePath(dir, safe);
-    }
-    options.path = path;
-    bool auto_path = !path_param.has_value();
-
-    bool open_folder = config_service_->ExportOpenFolderAfterSave(false);
-    std::optional<std::string> open_param = FindParam(req, "open_folder");
-    if (open_param.has_value()) {
-      std::string val = *open_param;
-      for (char& ch : val) {
-        ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
-      }
-      if (val == "true") {
-        open_folder = true;
-      } else if (val == "false") {
-        open_folder = false;
-      }
-    }
-    options.open_folder = open_folder;
-
-    Result<std::wstring> saved = exporter_->SaveImage(*art, options);
-    if (!saved.ok && auto_path && saved.error.code == ERR_PATH_NOT_WRITABLE) {
-      std::wstring fallback_dir = GetDesktopDir();
-      if (fallback_dir.empty()) {
-        wchar_t temp_path[MAX_PATH] = {};
-        DWORD len = GetTempPathW(MAX_PATH, temp_path);
-        if (len > 0 && len < MAX_PATH) {
-          fallback_dir.assign(temp_path, temp_path + len);
-          if (!fallback_dir.empty() &&
-              (fallback_dir.back() == L'\\' || fallback_dir.back() == L'/')) {
-            fallback_dir.pop_back();
-          }
-        }
-      }
-      if (!fallback_dir.empty()) {
-        std::wstring file_name = L"SnapPin";
-        std::wstring name_only = path;
-        size_t pos = name_only.find_last_of(L"\\/");
-        if (pos != std::wstring::npos) {
-          name_only = name_only.substr(pos + 1);
-        }
-        if (!name_only.empty()) {
-          size_t dot = name_only.find_last_of(L'.');
-          if (dot != std::wstring::npos) {
-            name_only = name_only.substr(0, dot);
-          }
-          name_only = SanitizeFileName(name_only);
-          if (!name_only.empty()) {
-            file_name = name_only;
-          }
-        }
-        options.path = BuildAutoSavePath(fallback_dir, file_name);
-        saved = exporter_->SaveImage(*art, options);
-      }
-    }
-    if (!saved.ok) {
+  for (const ActionEvent& ev : events) {
+    if (ev.type == ActionEvent::Type::Failed && ev.error.has_value()) {
       char buffer[256];
       _snprintf_s(buffer, sizeof(buffer), _TRUNCATE,
                   "save failed code=%s detail=%s\n",
-                  saved.error.code.c_str(), saved.error.detail.c_str());
+                  ev.error->code.c_str(), ev.error->detail.c_str());
       OutputDebugStringA(buffer);
-      return Result<void>::Fail(saved.error);
-    }
-
-    if (options.open_folder) {
-      std::wstring dir = DirName(saved.value);
-      if (!dir.empty()) {
-        ShellExecuteW(nullptr, L"open", dir.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
-      }
     }
-    return Result<void>::Ok();
+    EmitEvent(ev);
   }
-  if (req.id == "pin.create_from_artifact") {
-    if (!pin_manager_ || !artifacts_ || !state_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Pin unavailable";
-      err.retryable = true;
-      err.detail = "pin_service_null";
-      return Result<void>::Fail(err);
-    }
-    if (!state_->active_artifact_id.has_value()) {
-      Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "No active artifact";
-      err.retryable = false;
-      err.detail = "no_active_artifact";
-      return Result<void>::Fail(err);
+  for (const std::wstring& dir : open_dirs) {
+    if (!dir.empty()) {
+      ShellExecuteW(nullptr, L"open", dir.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
     }
-    std::optional<Artifact> art = artifacts_->Get(*state_->active_artifact_id);
-    if (!art.has_value()) {
-      Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "Artifact missing";
-      err.retryable = false;
-      err.detail = "artifact_missing";
-      return Result<void>::Fail(err);
-    }
-    Result<Id64> pin = pin_manager_->CreateFromArtifact(*art);
-    if (!pin.ok) {
-      return Result<void>::Fail(pin.error);
+  }
+}
+
+void ActionDispatcher::QueueExportEvent(const ExportQueueEvent& ev) {
+  ActionEvent out{};
+  out.action_id = "export.save_image";
+  out.correlation_id = ev.correlation_id;
+  out.type = ev.type;
+  out.progress_0_1 = ev.progress_0_1;
+  out.output_ref = NarrowUtf8(ev.path);
+  out.error = ev.error;
+  bool post = false;
+  {
+    std::lock_guard<std::mutex> lock(export_mu_);
+    post = export_events_.empty();
+    export_events_.push_back(std::move(out));
+  }
+  // One message per batch; DrainExportEvents takes everything queued so far.
+  if (post && hwnd_) {
+    PostMessageW(hwnd_, kExportEventMessage, 0, 0);
+  }
+}
+
+void ActionDispatcher::EmitEvent(const ActionEvent& ev) { events_.Emit(ev); }
+
+Result<void> ActionDispatcher::AppExit(ActionCall&) {
+  if (hwnd_) {
+    PostMessageW(hwnd_, WM_CLOSE, 0, 0);
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> ActionDispatcher::CaptureStart(ActionCall&) {
+  if (state_ && (state_->overlay_visible || state_->active_artifact_id.has_value() ||
+                 state_->annotate_running)) {
+    if (annotate_window_ && annotate_window_->IsVisible()) {
+      annotate_window_->EndSession();
     }
     if (toolbar_) {
       toolbar_->Hide();
     }
-    if (annotate_window_ && annotate_window_->IsVisible()) {
-      annotate_window_->EndSession();
-    }
     if (overlay_) {
       overlay_->Hide();
     }
-    if (state_) {
-      state_->active_artifact_id.reset();
-      state_->annotate_running = false;
-      state_->overlay_visible = overlay_ ? overlay_->IsVisible() : false;
-    }
     if (artifacts_) {
       artifacts_->ClearActive();
     }
+    ClearFrozenFrame();
+    state_->overlay_visible = overlay_ ? overlay_->IsVisible() : false;
+    state_->active_artifact_id.reset();
+    state_->annotate_running = false;
     return Result<void>::Ok();
   }
-  if (req.id == "pin.create_from_clipboard") {
-    if (!pin_manager_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Pin unavailable";
-      err.retryable = true;
-      err.detail = "pin_service_null";
-      return Result<void>::Fail(err);
-    }
-    Result<Id64> pin = pin_manager_->CreateFromClipboard();
-    if (!pin.ok) {
-      return Result<void>::Fail(pin.error);
-    }
-    return Result<void>::Ok();
+  if (!overlay_) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Overlay unavailable";
+    err.retryable = true;
+    err.detail = "overlay_null";
+    return Result<void>::Fail(err);
   }
-  if (req.id == "pin.copy_focused") {
-    if (!pin_manager_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Pin unavailable";
-      err.retryable = true;
-      err.detail = "pin_service_null";
-      return Result<void>::Fail(err);
-    }
-    return pin_manager_->CopyFocused();
+  const uint64_t show_t0 = MonotonicMicros();
+  Result<void> freeze = PrepareFrozenFrameForCursorMonitor();
+  if (!freeze.ok) {
+    OutputDebugStringA("Capture freeze failed\n");
+    ClearFrozenFrame();
   }
-  if (req.id == "pin.save_focused") {
-    if (!pin_manager_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Pin unavailable";
-      err.retryable = true;
-      err.detail = "pin_service_null";
-      return Result<void>::Fail(err);
+  const FrozenFrame* frozen = PeekFrozenFrame();
+  if (overlay_) {
+    if (frozen && frozen->pixels.valid()) {
+      overlay_->SetFrozenFrame(frozen->pixels);
+      overlay_->ShowForRect(frozen->screen_rect_px);
+    } else {
+      overlay_->ClearFrozenFrame();
+      overlay_->ShowForCurrentMonitor();
     }
-    return pin_manager_->SaveFocused();
   }
-  if (req.id == "pin.close_focused") {
-    if (!pin_manager_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Pin unavailable";
-      err.retryable = true;
-      err.detail = "pin_service_null";
-      return Result<void>::Fail(err);
-    }
-    return pin_manager_->CloseFocused();
+  if (state_) {
+    state_->overlay_visible = overlay_->IsVisible();
   }
-  if (req.id == "pin.close_all") {
-    if (!pin_manager_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Pin unavailable";
-      err.retryable = true;
-      err.detail = "pin_service_null";
-      return Result<void>::Fail(err);
-    }
-    return pin_manager_->CloseAll();
+  if (!overlay_->IsVisible()) {
+    ClearFrozenFrame();
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Overlay show failed";
+    err.retryable = true;
+    err.detail = "overlay_show_failed";
+    return Result<void>::Fail(err);
   }
-  if (req.id == "annotate.open") {
-    if (!artifacts_ || !state_ || !annotate_window_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Annotate unavailable";
-      err.retryable = true;
-      err.detail = "annotate_service_null";
-      return Result<void>::Fail(err);
+  if (stats_) {
+    stats_->RecordOverlayShowMicros(MonotonicMicros() - show_t0);
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> ActionDispatcher::ExportCopyImage(ActionCall&) {
+  if (!artifacts_ || !exporter_) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Export unavailable";
+    err.retryable = true;
+    err.detail = "export_null";
+    return Result<void>::Fail(err);
+  }
+  std::optional<Id64> active_id = state_ ? state_->active_artifact_id : std::nullopt;
+  if (!active_id.has_value()) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "No active artifact";
+    err.retryable = false;
+    err.detail = "no_active_artifact";
+    return Result<void>::Fail(err);
+  }
+  std::shared_ptr<const Artifact> art = artifacts_->Get(active_id.value());
+  if (!art) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "Artifact missing";
+    err.retryable = false;
+    err.detail = "artifact_missing";
+    return Result<void>::Fail(err);
+  }
+  return exporter_->CopyImageToClipboard(*art);
+}
+
+Result<void> ActionDispatcher::ExportSaveImage(ActionCall& call) {
+  const ActionInvoke& req = call.req;
+  if (!artifacts_ || !exporter_ || !config_service_) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Export unavailable";
+    err.retryable = true;
+    err.detail = "export_save_null";
+    return Result<void>::Fail(err);
+  }
+  std::optional<Id64> active_id = state_ ? state_->active_artifact_id : std::nullopt;
+  if (!active_id.has_value()) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "No active artifact";
+    err.retryable = false;
+    err.detail = "no_active_artifact";
+    return Result<void>::Fail(err);
+  }
+  std::shared_ptr<const Artifact> art = artifacts_->Get(active_id.value());
+  if (!art) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "Artifact missing";
+    err.retryable = false;
+    err.detail = "artifact_missing";
+    return Result<void>::Fail(err);
+  }
+
+  SaveImageOptions options;
+  options.format = ImageFormat::PNG;
+
+  std::optional<std::string> format = FindParam(req, "format");
+  if (format.has_value()) {
+    std::string upper = *format;
+    for (char& ch : upper) {
+      ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
     }
-    if (!state_->active_artifact_id.has_value()) {
+    if (upper != "PNG") {
       Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "No active artifact";
+      err.code = ERR_ENCODE_IMAGE_FAILED;
+      err.message = "Unsupported format";
       err.retryable = false;
-      err.detail = "no_active_artifact";
+      err.detail = "format";
       return Result<void>::Fail(err);
     }
-    std::optional<Artifact> art = artifacts_->Get(*state_->active_artifact_id);
-    if (!art.has_value()) {
-      Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "Artifact missing";
-      err.retryable = false;
-      err.detail = "artifact_missing";
-      return Result<void>::Fail(err);
+  }
+
+  std::wstring path;
+  std::optional<std::string> path_param = FindParam(req, "path");
+  if (path_param.has_value()) {
+    path = WidenUtf8(*path_param);
+  }
+  if (path.empty()) {
+    std::wstring dir = config_service_->ExportSaveDir();
+    if (dir.empty()) {
+      dir = GetDesktopDir();
     }
-    if (!art->base_cpu.has_value() || !art->base_cpu_storage ||
-        art->base_cpu_storage->empty()) {
-      std::shared_ptr<std::vector<uint8_t>> storage;
-      std::optional<CpuBitmap> recaptured =
-          CaptureRectToCpu(art->screen_rect_px, &storage);
-      if (recaptured.has_value()) {
-        art->base_cpu = *recaptured;
-        art->base_cpu_storage = std::move(storage);
-        artifacts_->Put(*art);
-      }
+    if (dir.empty()) {
+      dir = JoinPath(config_service_->RootDir(), L"exports");
     }
-    if (!art->base_cpu.has_value() || !art->base_cpu_storage ||
-        art->base_cpu_storage->empty() ||
-        art->base_cpu->format != PixelFormat::BGRA8 ||
-        art->base_cpu->stride_bytes < art->base_cpu->size_px.w * 4) {
+    if (!EnsureDir(dir)) {
       Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "Artifact bitmap format unsupported";
+      err.code = ERR_PATH_NOT_WRITABLE;
+      err.message = "Save path not writable";
       err.retryable = false;
-      err.detail = "artifact_bitmap_unsupported";
+      err.detail = "export_dir";
       return Result<void>::Fail(err);
     }
+    std::string pattern = config_service_->ExportNamingPattern();
+    if (pattern.empty()) {
+      pattern = "SnapPin_{yyyyMMdd_HHmmss}_{rand4}";
+    }
+    std::string filename = ExpandPattern(pattern);
+    std::wstring safe = SanitizeFileName(WidenUtf8(filename));
+    if (safe.empty()) {
+      safe = L"SnapPin";
+    }
+    path = BuildAutoSavePath(dir, safe);
+  }
+  options.path = path;
+  bool auto_path = !path_param.has_value();
+
+  options.png_preset =
+      ParsePngPreset(config_service_->ExportPngPreset(), PngPreset::Balanced);
+  std::optional<std::string> preset_param = FindParam(req, "png_preset");
+  if (preset_param.has_value()) {
+    options.png_preset = ParsePngPreset(*preset_param, options.png_preset);
+  }
 
-    if (!annotate_window_->BeginSession(art->screen_rect_px, art->base_cpu_storage,
-                                        art->base_cpu->size_px,
-                                        art->base_cpu->stride_bytes)) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Annotate window open failed";
-      err.retryable = true;
-      err.detail = "annotate_window_begin";
-      return Result<void>::Fail(err);
+  bool open_folder = config_service_->ExportOpenFolderAfterSave(false);
+  std::optional<std::string> open_param = FindParam(req, "open_folder");
+  if (open_param.has_value()) {
+    std::string val = *open_param;
+    for (char& ch : val) {
+      ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
     }
-    if (overlay_) {
-      overlay_->SetInteractionEnabled(false);
+    if (val == "true") {
+      open_folder = true;
+    } else if (val == "false") {
+      open_folder = false;
     }
-    if (toolbar_) {
-      toolbar_->Hide();
+  }
+  options.open_folder = open_folder;
+
+  ExportRequest request;
+  request.artifact = *art;
+  request.options = std::move(options);
+  request.auto_path = auto_path;
+
+  // With CPU pixels the request holds an immutable snapshot, so the encode
+  // and write run on the export queue and the UI thread returns at once.
+  // Without them the save recaptures the screen and must happen now.
+  if (export_queue_ && request.artifact.base_cpu.valid()) {
+    if (request.options.open_folder) {
+      std::lock_guard<std::mutex> lock(export_mu_);
+      export_open_folder_.insert(call.correlation_id.value);
+    }
+    export_queue_->Submit(call.correlation_id, std::move(request));
+    call.deferred = true;
+    return Result<void>::Ok();
+  }
+
+  Result<std::wstring> saved = SaveWithFallback(exporter_, request);
+  if (!saved.ok) {
+    char buffer[256];
+    _snprintf_s(buffer, sizeof(buffer), _TRUNCATE,
+                "save failed code=%s detail=%s\n",
+                saved.error.code.c_str(), saved.error.detail.c_str());
+    OutputDebugStringA(buffer);
+    return Result<void>::Fail(saved.error);
+  }
+
+  if (request.options.open_folder) {
+    std::wstring dir = DirName(saved.value);
+    if (!dir.empty()) {
+      ShellExecuteW(nullptr, L"open", dir.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
     }
-    state_->annotate_running = true;
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> ActionDispatcher::PinCreateFromArtifact(ActionCall&) {
+  if (!pin_manager_ || !artifacts_ || !state_) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Pin unavailable";
+    err.retryable = true;
+    err.detail = "pin_service_null";
+    return Result<void>::Fail(err);
+  }
+  if (!state_->active_artifact_id.has_value()) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "No active artifact";
+    err.retryable = false;
+    err.detail = "no_active_artifact";
+    return Result<void>::Fail(err);
+  }
+  std::shared_ptr<const Artifact> art = artifacts_->Get(*state_->active_artifact_id);
+  if (!art) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "Artifact missing";
+    err.retryable = false;
+    err.detail = "artifact_missing";
+    return Result<void>::Fail(err);
+  }
+  Result<Id64> pin = pin_manager_->CreateFromArtifact(*art);
+  if (!pin.ok) {
+    return Result<void>::Fail(pin.error);
+  }
+  AppendActiveToHistory();
+  if (toolbar_) {
+    toolbar_->Hide();
+  }
+  if (annotate_window_ && annotate_window_->IsVisible()) {
+    annotate_window_->EndSession();
+  }
+  if (overlay_) {
+    overlay_->Hide();
+  }
+  if (state_) {
+    state_->active_artifact_id.reset();
+    state_->annotate_running = false;
     state_->overlay_visible = overlay_ ? overlay_->IsVisible() : false;
-    return Result<void>::Ok();
   }
-  if (req.id == "ocr.start") {
-    if (!artifacts_ || !exporter_ || !state_) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "OCR unavailable";
-      err.retryable = true;
-      err.detail = "ocr_service_null";
-      return Result<void>::Fail(err);
+  if (artifacts_) {
+    artifacts_->ClearActive();
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> ActionDispatcher::AnnotateOpen(ActionCall&) {
+  if (!artifacts_ || !state_ || !annotate_window_) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Annotate unavailable";
+    err.retryable = true;
+    err.detail = "annotate_service_null";
+    return Result<void>::Fail(err);
+  }
+  if (!state_->active_artifact_id.has_value()) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "No active artifact";
+    err.retryable = false;
+    err.detail = "no_active_artifact";
+    return Result<void>::Fail(err);
+  }
+  std::shared_ptr<const Artifact> art = artifacts_->Get(*state_->active_artifact_id);
+  if (!art) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "Artifact missing";
+    err.retryable = false;
+    err.detail = "artifact_missing";
+    return Result<void>::Fail(err);
+  }
+  if (!art->base_cpu.valid()) {
+    BitmapView recaptured = CaptureRectToCpu(art->screen_rect_px);
+    if (recaptured.valid()) {
+      Artifact updated = *art;
+      updated.base_cpu = std::move(recaptured);
+      artifacts_->Put(std::move(updated));
+      art = artifacts_->Get(*state_->active_artifact_id);
     }
-    if (!state_->active_artifact_id.has_value()) {
-      Error err;
-      err.code = ERR_TARGET_INVALID;
-      err.message = "No active artifact";
-      err.retryable = false;
-      err.detail = "no_active_artifact";
-      return Result<void>::Fail(err);
+  }
+  if (!art->base_cpu.valid() || art->base_cpu.format() != PixelFormat::BGRA8) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "Artifact bitmap format unsupported";
+    err.retryable = false;
+    err.detail = "artifact_bitmap_unsupported";
+    return Result<void>::Fail(err);
+  }
+
+  if (!annotate_window_->BeginSession(art->screen_rect_px, art->base_cpu)) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Annotate window open failed";
+    err.retryable = true;
+    err.detail = "annotate_window_begin";
+    return Result<void>::Fail(err);
+  }
+  if (overlay_) {
+    overlay_->SetInteractionEnabled(false);
+  }
+  if (toolbar_) {
+    toolbar_->Hide();
+  }
+  state_->annotate_running = true;
+  state_->overlay_visible = overlay_ ? overlay_->IsVisible() : false;
+  return Result<void>::Ok();
+}
+
+Result<void> ActionDispatcher::OcrStart(ActionCall& call) {
+  const ActionInvoke& req = call.req;
+  if (!artifacts_ || !exporter_ || !state_) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "OCR unavailable";
+    err.retryable = true;
+    err.detail = "ocr_service_null";
+    return Result<void>::Fail(err);
+  }
+  if (!state_->active_artifact_id.has_value()) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "No active artifact";
+    err.retryable = false;
+    err.detail = "no_active_artifact";
+    return Result<void>::Fail(err);
+  }
+
+  std::shared_ptr<const Artifact> art = artifacts_->Get(*state_->active_artifact_id);
+  if (!art) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "Artifact missing";
+    err.retryable = false;
+    err.detail = "artifact_missing";
+    return Result<void>::Fail(err);
+  }
+
+  if (!art->base_cpu.valid()) {
+    BitmapView recaptured = CaptureRectToCpu(art->screen_rect_px);
+    if (recaptured.valid()) {
+      Artifact updated = *art;
+      updated.base_cpu = std::move(recaptured);
+      artifacts_->Put(std::move(updated));
+      art = artifacts_->Get(*state_->active_artifact_id);
     }
+  }
 
-    std::optional<Artifact> art = artifacts_->Get(*state_->active_artifact_id);
-    if (!art.has_value()) {
+  if (!art->base_cpu.valid() || art->base_cpu.format() != PixelFormat::BGRA8) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "Artifact bitmap format unsupported";
+    err.retryable = false;
+    err.detail = "artifact_bitmap_unsupported";
+    return Result<void>::Fail(err);
+  }
+
+  BitmapView ocr_bmp = art->base_cpu;
+
+  const std::optional<std::string> x_param = FindParam(req, "x");
+  const std::optional<std::string> y_param = FindParam(req, "y");
+  const std::optional<std::string> w_param = FindParam(req, "w");
+  const std::optional<std::string> h_param = FindParam(req, "h");
+  const bool has_region_param = x_param.has_value() || y_param.has_value() ||
+                                w_param.has_value() || h_param.has_value();
+  if (has_region_param) {
+    int32_t sx = 0;
+    int32_t sy = 0;
+    int32_t sw = 0;
+    int32_t sh = 0;
+    if (!x_param.has_value() || !y_param.has_value() || !w_param.has_value() ||
+        !h_param.has_value() || !TryParseInt32(*x_param, &sx) ||
+        !TryParseInt32(*y_param, &sy) || !TryParseInt32(*w_param, &sw) ||
+        !TryParseInt32(*h_param, &sh) || sw <= 0 || sh <= 0) {
       Error err;
       err.code = ERR_TARGET_INVALID;
-      err.message = "Artifact missing";
+      err.message = "Invalid OCR region";
       err.retryable = false;
-      err.detail = "artifact_missing";
+      err.detail = "ocr_region_param";
       return Result<void>::Fail(err);
     }
 
-    if (!art->base_cpu.has_value() || !art->base_cpu_storage ||
-        art->base_cpu_storage->empty()) {
-      std::shared_ptr<std::vector<uint8_t>> storage;
-      std::optional<CpuBitmap> recaptured =
-          CaptureRectToCpu(art->screen_rect_px, &storage);
-      if (recaptured.has_value()) {
-        art->base_cpu = *recaptured;
-        art->base_cpu_storage = std::move(storage);
-        artifacts_->Put(*art);
-      }
+    RectPX art_rect = art->screen_rect_px;
+    if (art_rect.w <= 0 || art_rect.h <= 0) {
+      art_rect.x = 0;
+      art_rect.y = 0;
+      art_rect.w = art->base_cpu.size_px().w;
+      art_rect.h = art->base_cpu.size_px().h;
     }
 
-    if (!art->base_cpu.has_value() || !art->base_cpu_storage ||
-        art->base_cpu_storage->empty() ||
-        art->base_cpu->format != PixelFormat::BGRA8 ||
-        art->base_cpu->stride_bytes < art->base_cpu->size_px.w * 4) {
+    const int32_t rel_left = sx - art_rect.x;
+    const int32_t rel_top = sy - art_rect.y;
+    ocr_bmp = art->base_cpu.Crop(RectPX{rel_left, rel_top, sw, sh});
+    if (!ocr_bmp.valid()) {
       Error err;
       err.code = ERR_TARGET_INVALID;
-      err.message = "Artifact bitmap format unsupported";
+      err.message = "OCR region outside artifact";
       err.retryable = false;
-      err.detail = "artifact_bitmap_unsupported";
+      err.detail = "ocr_region_outside";
       return Result<void>::Fail(err);
     }
+  }
 
-    const CpuBitmap* ocr_bmp = &(*art->base_cpu);
-    const std::vector<uint8_t>* ocr_pixels = art->base_cpu_storage.get();
-    CpuBitmap cropped_bmp{};
-    std::vector<uint8_t> cropped_pixels;
-
-    const std::optional<std::string> x_param = FindParam(req, "x");
-    const std::optional<std::string> y_param = FindParam(req, "y");
-    const std::optional<std::string> w_param = FindParam(req, "w");
-    const std::optional<std::string> h_param = FindParam(req, "h");
-    const bool has_region_param = x_param.has_value() || y_param.has_value() ||
-                                  w_param.has_value() || h_param.has_value();
-    if (has_region_param) {
-      int32_t sx = 0;
-      int32_t sy = 0;
-      int32_t sw = 0;
-      int32_t sh = 0;
-      if (!x_param.has_value() || !y_param.has_value() || !w_param.has_value() ||
-          !h_param.has_value() || !TryParseInt32(*x_param, &sx) ||
-          !TryParseInt32(*y_param, &sy) || !TryParseInt32(*w_param, &sw) ||
-          !TryParseInt32(*h_param, &sh) || sw <= 0 || sh <= 0) {
-        Error err;
-        err.code = ERR_TARGET_INVALID;
-        err.message = "Invalid OCR region";
-        err.retryable = false;
-        err.detail = "ocr_region_param";
-        return Result<void>::Fail(err);
-      }
-
-      RectPX art_rect = art->screen_rect_px;
-      if (art_rect.w <= 0 || art_rect.h <= 0) {
-        art_rect.x = 0;
-        art_rect.y = 0;
-        art_rect.w = art->base_cpu->size_px.w;
-        art_rect.h = art->base_cpu->size_px.h;
-      }
-
-      const int32_t rel_left = sx - art_rect.x;
-      const int32_t rel_top = sy - art_rect.y;
-      const int32_t rel_right = rel_left + sw;
-      const int32_t rel_bottom = rel_top + sh;
-
-      const int32_t crop_left = std::max<int32_t>(0, rel_left);
-      const int32_t crop_top = std::max<int32_t>(0, rel_top);
-      const int32_t crop_right =
-          std::min<int32_t>(art->base_cpu->size_px.w, rel_right);
-      const int32_t crop_bottom =
-          std::min<int32_t>(art->base_cpu->size_px.h, rel_bottom);
-      const int32_t crop_w = crop_right - crop_left;
-      const int32_t crop_h = crop_bottom - crop_top;
-      if (crop_w <= 0 || crop_h <= 0) {
-        Error err;
-        err.code = ERR_TARGET_INVALID;
-        err.message = "OCR region outside artifact";
-        err.retryable = false;
-        err.detail = "ocr_region_outside";
-        return Result<void>::Fail(err);
-      }
-
-      const int32_t src_stride = art->base_cpu->stride_bytes;
-      const int32_t dst_stride = crop_w * 4;
-      cropped_pixels.resize(static_cast<size_t>(dst_stride) *
-                           static_cast<size_t>(crop_h));
-      const uint8_t* src = art->base_cpu_storage->data();
-      for (int32_t row = 0; row < crop_h; ++row) {
-        const uint8_t* src_row =
-            src + static_cast<size_t>(crop_top + row) * src_stride +
-            static_cast<size_t>(crop_left) * 4;
-        uint8_t* dst_row =
-            cropped_pixels.data() + static_cast<size_t>(row) * dst_stride;
-        std::memcpy(dst_row, src_row, static_cast<size_t>(dst_stride));
-      }
-
-      cropped_bmp = *art->base_cpu;
-      cropped_bmp.size_px = SizePX{crop_w, crop_h};
-      cropped_bmp.stride_bytes = dst_stride;
-      cropped_bmp.data.p = cropped_pixels.data();
-      ocr_bmp = &cropped_bmp;
-      ocr_pixels = &cropped_pixels;
-    }
-
-    Result<std::wstring> ocr = RunSystemOcr(*ocr_bmp, *ocr_pixels);
-    if (!ocr.ok) {
-      return Result<void>::Fail(ocr.error);
-    }
+  // Recognition takes hundreds of milliseconds, so it runs on a scheduler
+  // worker; the bitmap shares the artifact's pixels. The call blocks that
+  // long inside WinRT, so it is queued at background priority and workers
+  // take save strips and paint bands ahead of it. The clipboard and the final
+  // event belong to the UI thread, where the continuation runs.
+  auto ocr = std::make_shared<Result<std::wstring>>();
+  const Id64 correlation_id = call.correlation_id;
+  TaskScheduler::Shared().SubmitThen(
+      [ocr, ocr_bmp] { *ocr = RunSystemOcr(ocr_bmp); },
+      [this, ocr, correlation_id](bool completed) {
+        Result<void> copied = Result<void>::Ok();
+        if (!completed) {
+          Error err;
+          err.code = ERR_OPERATION_ABORTED;
+          err.message = "OCR failed";
+          err.retryable = true;
+          err.detail = "ocr_task_failed";
+          copied = Result<void>::Fail(err);
+        } else if (!ocr->ok) {
+          copied = Result<void>::Fail(ocr->error);
+        } else {
+          copied = exporter_->CopyTextToClipboard(ocr->value);
+        }
+        ActionEvent done{};
+        done.action_id = "ocr.start";
+        done.correlation_id = correlation_id;
+        done.type = copied.ok ? ActionEvent::Type::Succeeded : ActionEvent::Type::Failed;
+        if (!copied.ok) {
+          done.error = copied.error;
+        }
+        EmitEvent(done);
+      },
+      TaskPriority::Background);
+  call.deferred = true;
+  return Result<void>::Ok();
+}
 
-    Result<void> copied = exporter_->CopyTextToClipboard(ocr.value);
-    if (!copied.ok) {
-      return copied;
-    }
-    return Result<void>::Ok();
+Result<void> ActionDispatcher::ArtifactDismiss(ActionCall&) {
+  AppendActiveToHistory();
+  if (annotate_window_ && annotate_window_->IsVisible()) {
+    annotate_window_->EndSession();
   }
-  if (req.id == "artifact.dismiss") {
-    if (annotate_window_ && annotate_window_->IsVisible()) {
-      annotate_window_->EndSession();
-    }
-    if (state_) {
-      state_->annotate_running = false;
-    }
-    if (artifacts_) {
-      artifacts_->ClearActive();
-    }
-    if (state_) {
-      state_->active_artifact_id.reset();
-    }
-    if (toolbar_) {
-      toolbar_->Hide();
-    }
-    if (overlay_) {
-      overlay_->Hide();
-    }
-    return Result<void>::Ok();
+  if (state_) {
+    state_->annotate_running = false;
+  }
+  if (artifacts_) {
+    artifacts_->ClearActive();
+  }
+  if (state_) {
+    state_->active_artifact_id.reset();
   }
-  if (req.id == "settings.reload") {
-    if (!config_service_) {
+  if (toolbar_) {
+    toolbar_->Hide();
+  }
+  if (overlay_) {
+    overlay_->Hide();
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> ActionDispatcher::HistoryPinRecent(ActionCall& call) {
+  if (!pin_manager_ || !history_) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Capture history unavailable";
+    err.retryable = false;
+    err.detail = history_ ? "pin_service_null" : "history_disabled";
+    return Result<void>::Fail(err);
+  }
+  // index 0 is the most recent capture.
+  size_t index = 0;
+  std::optional<std::string> index_param = FindParam(call.req, "index");
+  if (index_param.has_value()) {
+    if (!TryParseIndex(*index_param, &index)) {
       Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Config service unavailable";
-      err.retryable = true;
-      err.detail = "config_service_null";
+      err.code = ERR_TARGET_INVALID;
+      err.message = "Invalid history index";
+      err.retryable = false;
+      err.detail = *index_param;
       return Result<void>::Fail(err);
     }
-    return config_service_->Reload();
   }
-  if (req.id == "settings.open") {
-    if (settings_) {
-      settings_->Show();
-    }
-    return Result<void>::Ok();
+  CaptureHistoryEntry entry;
+  BitmapView pixels;
+  if (history_->NthNewest(index, &entry)) {
+    pixels = history_->Load(entry.seq);
+  }
+  if (!pixels.valid()) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "No such capture in history";
+    err.retryable = false;
+    err.detail = "history_index_" + std::to_string(index);
+    return Result<void>::Fail(err);
+  }
+  PointPX pos{};
+  pos.x = entry.screen_rect_px.x;
+  pos.y = entry.screen_rect_px.y;
+  Result<Id64> pin = pin_manager_->CreateFromPixels(std::move(pixels), pos);
+  if (!pin.ok) {
+    return Result<void>::Fail(pin.error);
   }
+  return Result<void>::Ok();
+}
 
-  Error err;
-  err.code = ERR_INTERNAL_ERROR;
-  err.message = "No handler";
-  err.retryable = false;
-  err.detail = req.id;
-  return Result<void>::Fail(err);
+Result<void> ActionDispatcher::DebugTraceDump(ActionCall& call) {
+  // debug.trace_enabled is read at startup; with it off the dump would be empty.
+  if (!TraceRecorder::Enabled()) {
+    Error err;
+    err.code = ERR_OPERATION_ABORTED;
+    err.message = "Tracing is disabled (debug.trace_enabled)";
+    err.retryable = false;
+    err.detail = "trace_disabled";
+    return Result<void>::Fail(err);
+  }
+  std::wstring path;
+  if (std::optional<std::string> param = FindParam(call.req, "path")) {
+    path = WidenUtf8(*param);
+  } else if (config_service_) {
+    path = JoinPath(config_service_->RootDir(), L"trace.json");
+  }
+  if (path.empty()) {
+    Error err;
+    err.code = ERR_TARGET_INVALID;
+    err.message = "No trace output path";
+    err.retryable = false;
+    err.detail = "trace_path_empty";
+    return Result<void>::Fail(err);
+  }
+  if (!TraceRecorder::Shared().DumpToFile(path)) {
+    Error err;
+    err.code = ERR_PATH_NOT_WRITABLE;
+    err.message = "Failed to write trace";
+    err.retryable = true;
+    err.detail = NarrowUtf8(path);
+    return Result<void>::Fail(err);
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> ActionDispatcher::SettingsReload(ActionCall&) {
+  if (!config_service_) {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Config service unavailable";
+    err.retryable = true;
+    err.detail = "config_service_null";
+    return Result<void>::Fail(err);
+  }
+  return config_service_->Reload();
+}
+
+Result<void> ActionDispatcher::SettingsOpen(ActionCall&) {
+  if (settings_) {
+    settings_->Show();
+  }
+  return Result<void>::Ok();
 }
 
 } // namespace snappin
@@ -1,11 +1,17 @@
 #pragma once
 #include "Action.h"
+#include "ActionEventBus.h"
+#include "ActionTable.h"
+#include "ExportQueue.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
 namespace snappin {
@@ -18,9 +24,15 @@ class IExportService;
 class ToolbarWindow;
 class SettingsWindow;
 class PinManager;
+class StatsService;
+class CaptureHistoryStore;
 
 class ActionDispatcher final : public IActionDispatcher {
 public:
+  // Posted to `hwnd` when background export events are ready for
+  // DrainExportEvents().
+  static constexpr UINT kExportEventMessage = WM_APP + 38;
+
   ActionDispatcher(IActionRegistry& registry, RuntimeState* state, HWND hwnd,
                    ConfigService* config_service, OverlayWindow* overlay,
                    IArtifactStore* artifacts, IExportService* exporter,
@@ -29,13 +41,54 @@ public:
 
   bool IsEnabled(const std::string& action_id, const RuntimeState& state) override;
   Result<Id64> Invoke(const ActionInvoke& req) override;
+  // Every event, synchronously on the emitting thread. events() takes
+  // filtered and asynchronous subscribers.
   void Subscribe(std::function<void(const ActionEvent&)>) override;
+  ActionEventBus& events() { return events_; }
+  // Receives per-action Invoke latency and overlay show time; may be null.
+  void SetStatsService(StatsService* stats);
+  // Receives each artifact as it is dismissed or pinned, and backs
+  // history.pin_recent; may be null.
+  void SetCaptureHistory(CaptureHistoryStore* history);
+  // Installs (or replaces) the handler for a registered action. Modules call
+  // this at startup; returns false when the id is not in the registry.
+  bool RegisterHandler(std::string_view action_id, ActionHandler handler);
+  // Delivers queued export Progress/Succeeded/Failed events to subscribers.
+  // Call on the UI thread.
+  void DrainExportEvents();
 
 private:
   bool ContextSatisfied(ActionContext ctx, const RuntimeState& state) const;
   bool IsContextAllowed(const ActionDescriptor& desc, const RuntimeState& state) const;
   void EmitEvent(const ActionEvent& ev);
-  Result<void> ExecuteAction(const ActionInvoke& req, Id64 correlation_id);
+  // Handlers of actions that drive the capture session (runtime state,
+  // overlay, active artifact, export queue) live here; modules whose actions
+  // need none of it register their own (PinManager::RegisterActions).
+  void RegisterAppHandlers();
+  void RegisterCaptureHandlers();
+  void RegisterExportHandlers();
+  void RegisterPinHandlers();
+  void RegisterAnnotateHandlers();
+  void RegisterOcrHandlers();
+  void RegisterHistoryHandlers();
+  void RegisterDebugHandlers();
+  // Queues the active artifact, in its final annotated state, for history.
+  void AppendActiveToHistory();
+
+  Result<void> AppExit(ActionCall& call);
+  Result<void> SettingsReload(ActionCall& call);
+  Result<void> SettingsOpen(ActionCall& call);
+  Result<void> CaptureStart(ActionCall& call);
+  Result<void> ArtifactDismiss(ActionCall& call);
+  Result<void> ExportCopyImage(ActionCall& call);
+  // Sets call.deferred when the save runs on the export queue.
+  Result<void> ExportSaveImage(ActionCall& call);
+  Result<void> PinCreateFromArtifact(ActionCall& call);
+  Result<void> AnnotateOpen(ActionCall& call);
+  Result<void> OcrStart(ActionCall& call);
+  Result<void> HistoryPinRecent(ActionCall& call);
+  Result<void> DebugTraceDump(ActionCall& call);
+  void QueueExportEvent(const ExportQueueEvent& ev);
 
   IActionRegistry& registry_;
   RuntimeState* state_ = nullptr;
@@ -48,9 +101,17 @@ private:
   AnnotateWindow* annotate_window_ = nullptr;
   SettingsWindow* settings_ = nullptr;
   PinManager* pin_manager_ = nullptr;
+  StatsService* stats_ = nullptr;
+  CaptureHistoryStore* history_ = nullptr;
+  ActionHandlerTable handlers_;
   std::atomic<uint64_t> next_correlation_{1};
-  std::mutex subs_mu_;
-  std::vector<std::function<void(const ActionEvent&)>> subscribers_;
+  ActionEventBus events_;
+  std::mutex export_mu_;
+  std::vector<ActionEvent> export_events_;
+  std::unordered_set<uint64_t> export_open_folder_;
+  // Declared last: its destructor finishes queued saves, which still post
+  // events through the members above.
+  std::unique_ptr<ExportQueue> export_queue_;
 };
 
 } // namespace snappin
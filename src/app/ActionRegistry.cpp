@@ -18,68 +18,65 @@ ActionDescriptor MakeAction(const char* id, const char* title, const char* desc,
 } // namespace
 
 ActionRegistry::ActionRegistry() {
-  actions_.push_back(MakeAction("app.exit", "Exit", "Exit SnapPin",
-                                {ActionContext::GLOBAL}, ThreadPolicy::UI_ONLY));
-  actions_.push_back(MakeAction("capture.start", "Capture", "Start capture overlay",
-                                {ActionContext::GLOBAL}, ThreadPolicy::UI_ONLY));
-  actions_.push_back(MakeAction("pin.create_from_clipboard", "Pin Clipboard",
-                                "Create pin from clipboard",
-                                {ActionContext::GLOBAL}, ThreadPolicy::UI_ONLY));
-  actions_.push_back(MakeAction("export.copy_image", "Copy Image",
-                                "Copy active artifact to clipboard",
-                                {ActionContext::ARTIFACT_ACTIVE},
-                                ThreadPolicy::BACKGROUND_OK));
-  actions_.push_back(MakeAction("export.save_image", "Save Image",
-                                "Save active artifact to file",
-                                {ActionContext::ARTIFACT_ACTIVE},
-                                ThreadPolicy::BACKGROUND_OK));
-  actions_.push_back(MakeAction("pin.create_from_artifact", "Pin",
-                                "Create pin from active artifact",
-                                {ActionContext::ARTIFACT_ACTIVE},
-                                ThreadPolicy::UI_ONLY));
-  actions_.push_back(MakeAction("pin.close_focused", "Close Focused Pin",
-                                "Close currently focused pin",
-                                {ActionContext::PIN_FOCUSED},
-                                ThreadPolicy::UI_ONLY));
-  actions_.push_back(MakeAction("pin.copy_focused", "Copy Focused Pin",
-                                "Copy focused pin image to clipboard",
-                                {ActionContext::PIN_FOCUSED},
-                                ThreadPolicy::BACKGROUND_OK));
-  actions_.push_back(MakeAction("pin.save_focused", "Save Focused Pin",
-                                "Save focused pin image to file",
-                                {ActionContext::PIN_FOCUSED},
-                                ThreadPolicy::BACKGROUND_OK));
-  actions_.push_back(MakeAction("pin.close_all", "Close All Pins",
-                                "Close all pin windows",
-                                {ActionContext::GLOBAL},
-                                ThreadPolicy::UI_ONLY));
-  actions_.push_back(MakeAction("annotate.open", "Annotate",
-                                "Open annotation editor for active artifact",
-                                {ActionContext::ARTIFACT_ACTIVE},
-                                ThreadPolicy::UI_ONLY));
-  actions_.push_back(MakeAction("ocr.start", "OCR",
-                                "Run OCR for active artifact",
-                                {ActionContext::ARTIFACT_ACTIVE},
-                                ThreadPolicy::BACKGROUND_OK));
-  actions_.push_back(MakeAction("artifact.dismiss", "Close Toolbar",
-                                "Dismiss active artifact",
-                                {ActionContext::ARTIFACT_ACTIVE},
-                                ThreadPolicy::UI_ONLY));
-  actions_.push_back(MakeAction("settings.reload", "Reload Settings", "Reload config",
-                                {ActionContext::GLOBAL}, ThreadPolicy::BACKGROUND_OK));
-  actions_.push_back(MakeAction("settings.open", "Open Settings", "Open settings window",
-                                {ActionContext::GLOBAL}, ThreadPolicy::UI_ONLY));
-}
-
-std::vector<ActionDescriptor> ActionRegistry::ListAll() { return actions_; }
-
-std::optional<ActionDescriptor> ActionRegistry::Find(const std::string& id) {
-  for (const auto& action : actions_) {
-    if (action.id == id) {
-      return action;
-    }
-  }
-  return std::nullopt;
+  Add(MakeAction("app.exit", "Exit", "Exit SnapPin",
+                 {ActionContext::GLOBAL}, ThreadPolicy::UI_ONLY));
+  Add(MakeAction("capture.start", "Capture", "Start capture overlay",
+                 {ActionContext::GLOBAL}, ThreadPolicy::UI_ONLY));
+  Add(MakeAction("pin.create_from_clipboard", "Pin Clipboard",
+                 "Create pin from clipboard",
+                 {ActionContext::GLOBAL}, ThreadPolicy::UI_ONLY));
+  Add(MakeAction("export.copy_image", "Copy Image",
+                 "Copy active artifact to clipboard",
+                 {ActionContext::ARTIFACT_ACTIVE},
+                 ThreadPolicy::BACKGROUND_OK));
+  Add(MakeAction("export.save_image", "Save Image",
+                 "Save active artifact to file",
+                 {ActionContext::ARTIFACT_ACTIVE},
+                 ThreadPolicy::BACKGROUND_OK));
+  Add(MakeAction("pin.create_from_artifact", "Pin",
+                 "Create pin from active artifact",
+                 {ActionContext::ARTIFACT_ACTIVE},
+                 ThreadPolicy::UI_ONLY));
+  Add(MakeAction("pin.close_focused", "Close Focused Pin",
+                 "Close currently focused pin",
+                 {ActionContext::PIN_FOCUSED},
+                 ThreadPolicy::UI_ONLY));
+  Add(MakeAction("pin.copy_focused", "Copy Focused Pin",
+                 "Copy focused pin image to clipboard",
+                 {ActionContext::PIN_FOCUSED},
+                 ThreadPolicy::BACKGROUND_OK));
+  Add(MakeAction("pin.save_focused", "Save Focused Pin",
+                 "Save focused pin image to file",
+                 {ActionContext::PIN_FOCUSED},
+                 ThreadPolicy::BACKGROUND_OK));
+  Add(MakeAction("pin.close_all", "Close All Pins",
+                 "Close all pin windows",
+                 {ActionContext::GLOBAL},
+                 ThreadPolicy::UI_ONLY));
+  Add(MakeAction("history.pin_recent", "Pin From History",
+                 "Pin a recent capture from history",
+                 {ActionContext::GLOBAL},
+                 ThreadPolicy::UI_ONLY));
+  Add(MakeAction("debug.trace_dump", "Dump Trace",
+                 "Write recorded latency spans as Chrome trace JSON",
+                 {ActionContext::GLOBAL},
+                 ThreadPolicy::UI_ONLY));
+  Add(MakeAction("annotate.open", "Annotate",
+                 "Open annotation editor for active artifact",
+                 {ActionContext::ARTIFACT_ACTIVE},
+                 ThreadPolicy::UI_ONLY));
+  Add(MakeAction("ocr.start", "OCR",
+                 "Run OCR for active artifact",
+                 {ActionContext::ARTIFACT_ACTIVE},
+                 ThreadPolicy::BACKGROUND_OK));
+  Add(MakeAction("artifact.dismiss", "Close Toolbar",
+                 "Dismiss active artifact",
+                 {ActionContext::ARTIFACT_ACTIVE},
+                 ThreadPolicy::UI_ONLY));
+  Add(MakeAction("settings.reload", "Reload Settings", "Reload config",
+                 {ActionContext::GLOBAL}, ThreadPolicy::BACKGROUND_OK));
+  Add(MakeAction("settings.open", "Open Settings", "Open settings window",
+                 {ActionContext::GLOBAL}, ThreadPolicy::UI_ONLY));
 }
 
 } // namespace snappin
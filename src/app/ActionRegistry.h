@@ -1,19 +1,12 @@
 #pragma once
-#include "Action.h"
-
-#include <vector>
+#include "ActionTable.h"
 
 namespace snappin {
 
-class ActionRegistry final : public IActionRegistry {
+// Built-in actions. Handles follow registration order below.
+class ActionRegistry final : public ActionTable {
 public:
   ActionRegistry();
-
-  std::vector<ActionDescriptor> ListAll() override;
-  std::optional<ActionDescriptor> Find(const std::string& id) override;
-
-private:
-  std::vector<ActionDescriptor> actions_;
 };
 
 } // namespace snappin
@@ -1,12 +1,18 @@
 ﻿#include "ActionDispatcher.h"
 #include "ActionRegistry.h"
 #include "ArtifactStore.h"
+#include "CaptureHistoryStore.h"
 #include "ConfigService.h"
 #include "CaptureService.h"
 #include "CaptureFreeze.h"
 #include "ExportService.h"
+#include "GdiGlyphSource.h"
 #include "KeybindingsService.h"
 #include "PinManager.h"
+#include "PinPixelStore.h"
+#include "PixelBufferPool.h"
+#include "PixelDedupRegistry.h"
+#include "ScaledImageCache.h"
 #include "SingleInstance.h"
 #include "TrayIcon.h"
 #include "OverlayWindow.h"
@@ -14,6 +20,8 @@
 #include "AnnotateWindow.h"
 #include "StatsService.h"
 #include "SettingsWindow.h"
+#include "TaskScheduler.h"
+#include "TraceRecorder.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -23,6 +31,7 @@
 
 #include <cstdio>
 #include <cstring>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <vector>
@@ -32,6 +41,8 @@ const wchar_t kMainWindowClass[] = L"SnapPinHiddenWindow";
 const UINT kTrayCallbackMessage = WM_USER + 1;
 const UINT kTrayIconId = 1;
 const int kSessionCopyHotkeyId = 0x51C0;
+// Posted when TaskScheduler continuations are waiting for the UI thread.
+const UINT kTaskContinuationMessage = WM_APP + 39;
 
 UINT g_taskbar_created_msg = 0;
 snappin::TrayIcon g_tray;
@@ -44,6 +55,7 @@ std::unique_ptr<snappin::ConfigService> g_config_service;
 std::unique_ptr<snappin::KeybindingsService> g_keybindings_service;
 std::unique_ptr<snappin::ICaptureService> g_capture_service;
 std::unique_ptr<snappin::ArtifactStore> g_artifact_store;
+std::unique_ptr<snappin::CaptureHistoryStore> g_capture_history;
 std::unique_ptr<snappin::ExportService> g_export_service;
 snappin::RuntimeState g_runtime_state;
 std::unique_ptr<snappin::OverlayWindow> g_overlay;
@@ -71,109 +83,59 @@ void SetSessionCopyHotkey(bool enabled) {
   }
 }
 
-std::optional<snappin::CpuBitmap> CropFrozenFrame(
-    const snappin::FrozenFrame& frozen, const snappin::RectPX& selection,
-    std::shared_ptr<std::vector<uint8_t>>* storage_out,
-    snappin::RectPX* out_rect) {
-  if (!storage_out) {
-    return std::nullopt;
+// Returns a view of the selection inside the frozen frame. Large selections
+// share the frame buffer; small ones are compacted so a tiny crop does not keep
+// a whole monitor frame alive.
+snappin::BitmapView CropFrozenFrame(const snappin::FrozenFrame& frozen,
+                                    const snappin::RectPX& selection,
+                                    snappin::RectPX* out_rect) {
+  SNAPPIN_TRACE_SPAN("capture.crop_frozen_frame", "capture");
+  const snappin::BitmapView& frame = frozen.pixels;
+  if (!frame.valid()) {
+    return snappin::BitmapView();
   }
-  if (!frozen.pixels || frozen.pixels->empty()) {
-    return std::nullopt;
-  }
-
-  int32_t rel_x = selection.x - frozen.screen_rect_px.x;
-  int32_t rel_y = selection.y - frozen.screen_rect_px.y;
-  int32_t w = selection.w;
-  int32_t h = selection.h;
 
-  if (rel_x < 0) {
-    w += rel_x;
-    rel_x = 0;
+  const snappin::RectPX rel{selection.x - frozen.screen_rect_px.x,
+                            selection.y - frozen.screen_rect_px.y, selection.w,
+                            selection.h};
+  snappin::BitmapView cropped = frame.Crop(rel);
+  if (!cropped.valid()) {
+    return snappin::BitmapView();
   }
-  if (rel_y < 0) {
-    h += rel_y;
-    rel_y = 0;
-  }
-
-  if (rel_x + w > frozen.size_px.w) {
-    w = frozen.size_px.w - rel_x;
-  }
-  if (rel_y + h > frozen.size_px.h) {
-    h = frozen.size_px.h - rel_y;
-  }
-
-  if (w <= 0 || h <= 0) {
-    return std::nullopt;
-  }
-
-  const int32_t src_stride = frozen.stride_bytes;
-  const int32_t dst_stride = w * 4;
-  const size_t row_bytes = static_cast<size_t>(dst_stride);
-  const size_t total = row_bytes * static_cast<size_t>(h);
-
-  auto storage = std::make_shared<std::vector<uint8_t>>();
-  storage->resize(total);
-
-  const uint8_t* src_base =
-      reinterpret_cast<const uint8_t*>(frozen.pixels->data());
-  uint8_t* dst_base = storage->data();
-
-  const size_t src_row_offset = static_cast<size_t>(rel_x) * 4;
-  for (int32_t y = 0; y < h; ++y) {
-    const uint8_t* src =
-        src_base + static_cast<size_t>(rel_y + y) * src_stride + src_row_offset;
-    uint8_t* dst = dst_base + static_cast<size_t>(y) * dst_stride;
-    std::memcpy(dst, src, row_bytes);
+  if (cropped.span_bytes() * 2 < frame.span_bytes()) {
+    cropped = snappin::ClonePooled(snappin::PixelBufferPool::Shared(), cropped);
   }
 
   if (out_rect) {
+    const int32_t rel_x = rel.x < 0 ? 0 : rel.x;
+    const int32_t rel_y = rel.y < 0 ? 0 : rel.y;
     out_rect->x = frozen.screen_rect_px.x + rel_x;
     out_rect->y = frozen.screen_rect_px.y + rel_y;
-    out_rect->w = w;
-    out_rect->h = h;
+    out_rect->w = cropped.size_px().w;
+    out_rect->h = cropped.size_px().h;
   }
-
-  snappin::CpuBitmap bmp;
-  bmp.format = snappin::PixelFormat::BGRA8;
-  bmp.size_px = snappin::SizePX{w, h};
-  bmp.stride_bytes = dst_stride;
-  bmp.data.p = storage->data();
-  *storage_out = std::move(storage);
-  return bmp;
+  return cropped;
 }
 
-bool UpdateActiveArtifactBitmap(std::shared_ptr<std::vector<uint8_t>> pixels,
-                                const snappin::SizePX& size_px,
-                                int32_t stride_bytes) {
-  if (!pixels || !g_artifact_store || !g_runtime_state.active_artifact_id.has_value() ||
-      size_px.w <= 0 || size_px.h <= 0 || stride_bytes < size_px.w * 4) {
-    return false;
-  }
-  const size_t expected_size =
-      static_cast<size_t>(stride_bytes) * static_cast<size_t>(size_px.h);
-  if (pixels->size() < expected_size) {
+bool UpdateActiveArtifactBitmap(const snappin::BitmapView& pixels) {
+  if (!pixels.valid() || !g_artifact_store ||
+      !g_runtime_state.active_artifact_id.has_value()) {
     return false;
   }
-  std::optional<snappin::Artifact> art =
+  std::shared_ptr<const snappin::Artifact> art =
       g_artifact_store->Get(*g_runtime_state.active_artifact_id);
-  if (!art.has_value()) {
+  if (!art) {
     return false;
   }
 
-  art->base_cpu_storage = std::move(pixels);
-  snappin::CpuBitmap bmp;
-  bmp.format = snappin::PixelFormat::BGRA8;
-  bmp.size_px = size_px;
-  bmp.stride_bytes = stride_bytes;
-  bmp.data.p = art->base_cpu_storage->data();
-  art->base_cpu = bmp;
-  if (art->screen_rect_px.w <= 0 || art->screen_rect_px.h <= 0) {
-    art->screen_rect_px.w = size_px.w;
-    art->screen_rect_px.h = size_px.h;
+  snappin::Artifact updated = *art;
+  updated.base_cpu = pixels;
+  if (updated.screen_rect_px.w <= 0 || updated.screen_rect_px.h <= 0) {
+    updated.screen_rect_px.w = pixels.size_px().w;
+    updated.screen_rect_px.h = pixels.size_px().h;
   }
-  g_artifact_store->Put(*art);
-  g_runtime_state.active_artifact_id = art->artifact_id;
+  g_runtime_state.active_artifact_id = updated.artifact_id;
+  g_artifact_store->Put(std::move(updated));
   return true;
 }
 
@@ -182,18 +144,13 @@ void RefreshAnnotateFromActiveArtifact() {
       !g_runtime_state.active_artifact_id.has_value()) {
     return;
   }
-  std::optional<snappin::Artifact> art =
+  std::shared_ptr<const snappin::Artifact> art =
       g_artifact_store->Get(*g_runtime_state.active_artifact_id);
-  if (!art.has_value() || !art->base_cpu.has_value() || !art->base_cpu_storage ||
-      art->base_cpu_storage->empty()) {
+  if (!art || !art->base_cpu.valid() ||
+      art->base_cpu.format() != snappin::PixelFormat::BGRA8) {
     return;
   }
-  if (art->base_cpu->format != snappin::PixelFormat::BGRA8 ||
-      art->base_cpu->stride_bytes < art->base_cpu->size_px.w * 4) {
-    return;
-  }
-  g_annotate->BeginSession(art->screen_rect_px, art->base_cpu_storage,
-                           art->base_cpu->size_px, art->base_cpu->stride_bytes);
+  g_annotate->BeginSession(art->screen_rect_px, art->base_cpu);
   if (g_overlay) {
     g_overlay->SetInteractionEnabled(false);
     g_runtime_state.overlay_visible = g_overlay->IsVisible();
@@ -243,6 +200,14 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
         g_pin_manager->HandleWindowCommand(wparam, lparam);
       }
       return 0;
+    case snappin::ActionDispatcher::kExportEventMessage:
+      if (g_action_dispatcher) {
+        g_action_dispatcher->DrainExportEvents();
+      }
+      return 0;
+    case kTaskContinuationMessage:
+      snappin::TaskScheduler::Shared().RunUiContinuations();
+      return 0;
     case kTrayCallbackMessage: {
       const UINT tray_msg = static_cast<UINT>(LOWORD(lparam));
       if (g_config_service && g_config_service->DebugEnabled(false)) {
@@ -351,6 +316,8 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
     return 1;
   }
   g_main_hwnd = hwnd;
+  snappin::TaskScheduler::Shared().SetUiWakeup(
+      [hwnd] { PostMessageW(hwnd, kTaskContinuationMessage, 0, 0); });
 
   g_action_registry = std::make_unique<snappin::ActionRegistry>();
   g_config_service = std::make_unique<snappin::ConfigService>();
@@ -358,12 +325,42 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
   if (!config_init.ok) {
     OutputDebugStringA("Config init failed\n");
   }
+  snappin::TraceRecorder::SetEnabled(g_config_service->DebugTraceEnabled(false));
+  snappin::TraceRecorder::Shared().SetThreadName("ui");
   g_stats = std::make_unique<snappin::StatsService>();
+  snappin::PixelBufferPool::Shared().SetHighWaterBytes(
+      static_cast<size_t>(g_config_service->AdvancedPixelPoolMaxMb(256)) << 20);
+  g_stats->SetPixelBufferPool(&snappin::PixelBufferPool::Shared());
   g_capture_service = snappin::CreateCaptureService();
-  g_artifact_store = std::make_unique<snappin::ArtifactStore>();
+  g_artifact_store = std::make_unique<snappin::ArtifactStore>(
+      static_cast<size_t>(g_config_service->AdvancedMaxCpuBitmapCacheMb(128)) << 20);
+  g_stats->SetArtifactStore(g_artifact_store.get());
+  g_artifact_store->SetPixelInterner(&snappin::PixelDedupRegistry::Shared());
+  g_stats->SetPixelDedupRegistry(&snappin::PixelDedupRegistry::Shared());
+  g_stats->SetGlyphCache(&snappin::SharedGlyphCache());
+  snappin::ScaledImageCache::Shared().SetBudget(
+      static_cast<size_t>(g_config_service->AdvancedPinScaleCacheMb(64)) << 20);
+  g_stats->SetScaledImageCache(&snappin::ScaledImageCache::Shared());
+  snappin::PinPixelStore::Shared().SetIdleMs(
+      static_cast<uint64_t>(g_config_service->AdvancedPinCompressIdleSeconds(30)) * 1000);
+  snappin::PinPixelStore::Shared().Start();
+  g_stats->SetPinPixelStore(&snappin::PinPixelStore::Shared());
+  const int history_max_mb = g_config_service->AdvancedHistoryMaxMb(512);
+  if (history_max_mb > 0 && !g_config_service->RootDir().empty()) {
+    g_capture_history = std::make_unique<snappin::CaptureHistoryStore>();
+    const std::filesystem::path history_dir =
+        std::filesystem::path(g_config_service->RootDir()) / L"history";
+    if (g_capture_history->Open(history_dir, static_cast<uint64_t>(history_max_mb) << 20)) {
+      g_stats->SetCaptureHistory(g_capture_history.get());
+    } else {
+      OutputDebugStringA("Capture history init failed\n");
+      g_capture_history.reset();
+    }
+  }
   g_export_service = std::make_unique<snappin::ExportService>();
   g_pin_manager = std::make_unique<snappin::PinManager>();
-  if (!g_pin_manager->Initialize(instance, hwnd, &g_runtime_state, g_config_service.get(), g_export_service.get())) {
+  if (!g_pin_manager->Initialize(instance, hwnd, &g_runtime_state, g_config_service.get(), g_export_service.get(),
+                                  g_artifact_store.get())) {
     OutputDebugStringA("Pin manager init failed\n");
   }
 
@@ -379,9 +376,6 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
   if (!g_overlay->Create(instance)) {
     OutputDebugStringA("Overlay create failed\n");
   } else {
-    if (g_stats) {
-      g_stats->SetOverlayShowMs(1.0);
-    }
     g_overlay->SetCallbacks(
         [](const snappin::RectPX& rect) {
           if (g_ocr_region_select_mode) {
@@ -407,26 +401,22 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
           }
 
           g_runtime_state.overlay_visible = g_overlay ? g_overlay->IsVisible() : false;
-          ULONGLONG t0 = GetTickCount64();
+          const uint64_t t0 = snappin::MonotonicMicros();
           bool captured = false;
 
           std::optional<snappin::FrozenFrame> frozen =
               snappin::ConsumeFrozenFrame();
           if (frozen.has_value()) {
-            std::shared_ptr<std::vector<uint8_t>> storage;
             snappin::RectPX actual_rect = rect;
-            std::optional<snappin::CpuBitmap> bmp =
-                CropFrozenFrame(*frozen, rect, &storage, &actual_rect);
-            if (bmp.has_value() && g_artifact_store) {
-              ULONGLONG t1 = GetTickCount64();
+            snappin::BitmapView bmp = CropFrozenFrame(*frozen, rect, &actual_rect);
+            if (bmp.valid() && g_artifact_store) {
               if (g_stats) {
-                g_stats->SetCaptureOnceMs(static_cast<double>(t1 - t0));
+                g_stats->RecordCaptureOnceMicros(snappin::MonotonicMicros() - t0);
               }
               snappin::Artifact artifact;
               artifact.artifact_id = g_artifact_store->NextId();
               artifact.kind = snappin::ArtifactKind::CAPTURE;
-              artifact.base_cpu = *bmp;
-              artifact.base_cpu_storage = std::move(storage);
+              artifact.base_cpu = std::move(bmp);
               artifact.screen_rect_px = actual_rect;
               artifact.dpi_scale = 1.0f;
               g_artifact_store->Put(artifact);
@@ -471,9 +461,8 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
             snappin::Result<snappin::CaptureFrame> result =
                 g_capture_service->CaptureOnce(target, options);
             if (result.ok) {
-              ULONGLONG t1 = GetTickCount64();
               if (g_stats) {
-                g_stats->SetCaptureOnceMs(static_cast<double>(t1 - t0));
+                g_stats->RecordCaptureOnceMicros(snappin::MonotonicMicros() - t0);
               }
               snappin::Artifact artifact;
               artifact.artifact_id = g_artifact_store->NextId();
@@ -547,6 +536,13 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
   if (!g_annotate->Create(instance, annotate_parent)) {
     OutputDebugStringA("Annotate window create failed\n");
   }
+  if (g_config_service) {
+    snappin::StrokeSimplifierOptions pencil;
+    pencil.tolerance_px =
+        static_cast<float>(g_config_service->AnnotatePencilTolerancePx(pencil.tolerance_px));
+    pencil.smoothing = g_config_service->AnnotatePencilSmoothing(false);
+    g_annotate->SetPencilOptions(pencil);
+  }
 
   if (g_toolbar) {
     g_toolbar->SetCallbacks(
@@ -645,12 +641,15 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
       *g_action_registry, &g_runtime_state, hwnd, g_config_service.get(),
       g_overlay.get(), g_artifact_store.get(), g_export_service.get(),
       g_toolbar.get(), g_annotate.get(), g_settings.get(), g_pin_manager.get());
+  if (g_pin_manager) {
+    g_pin_manager->RegisterActions(*g_action_dispatcher);
+  }
+  g_action_dispatcher->SetStatsService(g_stats.get());
+  g_action_dispatcher->SetCaptureHistory(g_capture_history.get());
   if (g_annotate) {
     g_annotate->SetCommandCallback(
-        [](snappin::AnnotateWindow::Command cmd,
-           std::shared_ptr<std::vector<uint8_t>> pixels, const snappin::SizePX& size,
-           int32_t stride) {
-          UpdateActiveArtifactBitmap(std::move(pixels), size, stride);
+        [](snappin::AnnotateWindow::Command cmd, const snappin::BitmapView& pixels) {
+          UpdateActiveArtifactBitmap(pixels);
           if (!g_action_dispatcher) {
             return;
           }
@@ -696,36 +695,47 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
   if (!hotkeys.ok) {
     OutputDebugStringA("Hotkeys init failed\n");
   }
-  g_action_dispatcher->Subscribe([](const snappin::ActionEvent& ev) {
-    if (ev.action_id == "capture.start" &&
-        ev.type == snappin::ActionEvent::Type::Started) {
-      g_ocr_region_select_mode = false;
-      SetSessionCopyHotkey(false);
-    }
-    if (ev.action_id == "artifact.dismiss" &&
-        ev.type == snappin::ActionEvent::Type::Succeeded) {
-      g_ocr_region_select_mode = false;
-      SetSessionCopyHotkey(false);
-    }
-    if (ev.action_id == "pin.create_from_artifact" &&
-        ev.type == snappin::ActionEvent::Type::Succeeded) {
-      g_ocr_region_select_mode = false;
-      SetSessionCopyHotkey(false);
-    }
-    if (ev.action_id == "annotate.open" &&
-        ev.type == snappin::ActionEvent::Type::Succeeded) {
-      SetSessionCopyHotkey(false);
-    }
-    if (g_config_service && !g_config_service->DebugEnabled(false)) {
-      return;
-    }
-    char buffer[128];
-    _snprintf_s(buffer, sizeof(buffer), _TRUNCATE,
-                "action=%s type=%d correlation=%llu\n", ev.action_id.c_str(),
-                static_cast<int>(ev.type),
-                static_cast<unsigned long long>(ev.correlation_id.value));
-    OutputDebugStringA(buffer);
-  });
+  // Session state follows the actions on the UI thread; Progress events
+  // never reach it.
+  g_action_dispatcher->events().Subscribe(
+      [](const snappin::ActionEvent& ev) {
+        if (ev.action_id == "capture.start" &&
+            ev.type == snappin::ActionEvent::Type::Started) {
+          g_ocr_region_select_mode = false;
+          SetSessionCopyHotkey(false);
+        }
+        if (ev.action_id == "artifact.dismiss" &&
+            ev.type == snappin::ActionEvent::Type::Succeeded) {
+          g_ocr_region_select_mode = false;
+          SetSessionCopyHotkey(false);
+        }
+        if (ev.action_id == "pin.create_from_artifact" &&
+            ev.type == snappin::ActionEvent::Type::Succeeded) {
+          g_ocr_region_select_mode = false;
+          SetSessionCopyHotkey(false);
+        }
+        if (ev.action_id == "annotate.open" &&
+            ev.type == snappin::ActionEvent::Type::Succeeded) {
+          SetSessionCopyHotkey(false);
+        }
+      },
+      snappin::ActionEventFilter::ForTypes(
+          {snappin::ActionEvent::Type::Started, snappin::ActionEvent::Type::Succeeded}));
+  // The debug log is written off the emitting thread, so a slow debugger
+  // attachment cannot stall Invoke.
+  g_action_dispatcher->events().Subscribe(
+      [](const snappin::ActionEvent& ev) {
+        if (g_config_service && !g_config_service->DebugEnabled(false)) {
+          return;
+        }
+        char buffer[128];
+        _snprintf_s(buffer, sizeof(buffer), _TRUNCATE,
+                    "action=%s type=%d correlation=%llu\n", ev.action_id.c_str(),
+                    static_cast<int>(ev.type),
+                    static_cast<unsigned long long>(ev.correlation_id.value));
+        OutputDebugStringA(buffer);
+      },
+      {}, snappin::EventDelivery::Async);
 
   if (!g_tray.Init(hwnd, kTrayCallbackMessage, kTrayIconId)) {
     // Tray is optional for now; continue running.
@@ -737,17 +747,25 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE, PWSTR, int) {
     DispatchMessageW(&msg);
   }
 
+  // Tasks in flight (OCR) finish before the services they use go; their
+  // continuations are dropped with the window.
+  snappin::TaskScheduler::Shared().WaitIdle();
+  snappin::TaskScheduler::Shared().SetUiWakeup(nullptr);
+  // The worker releases artifact pin refs; stop it before the store goes.
+  snappin::PinPixelStore::Shared().Stop();
   g_action_dispatcher.reset();
   g_action_registry.reset();
   g_config_service.reset();
   g_keybindings_service.reset();
   g_capture_service.reset();
+  g_stats.reset();
+  // Writes the captures still queued.
+  g_capture_history.reset();
   g_artifact_store.reset();
   g_export_service.reset();
   g_overlay.reset();
   g_toolbar.reset();
   g_annotate.reset();
-  g_stats.reset();
   g_settings.reset();
   g_pin_manager.reset();
   return static_cast<int>(msg.wParam);
@@ -1,6 +1,8 @@
 #include "CaptureFreeze.h"
 
 #include "ErrorCodes.h"
+#include "PixelBufferPool.h"
+#include "TraceRecorder.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -104,17 +106,20 @@ Result<FrozenFrame> CaptureFrozenFrameForMonitorRect(const RectPX& rect) {
   }
 
   size_t bytes = static_cast<size_t>(dib.stride) * rect.h;
-  auto storage = std::make_shared<std::vector<uint8_t>>();
-  storage->resize(bytes);
-  std::memcpy(storage->data(), dib.bits, bytes);
+  std::shared_ptr<uint8_t> storage = PixelBufferPool::Shared().Acquire(bytes);
+  if (!storage) {
+    DeleteObject(dib.bitmap);
+    FillWin32Error(&err, ERR_OUT_OF_MEMORY, "Failed to allocate frame",
+                   ERROR_NOT_ENOUGH_MEMORY);
+    return Result<FrozenFrame>::Fail(err);
+  }
+  std::memcpy(storage.get(), dib.bits, bytes);
   DeleteObject(dib.bitmap);
 
   FrozenFrame frame;
   frame.screen_rect_px = rect;
-  frame.size_px = SizePX{rect.w, rect.h};
-  frame.stride_bytes = dib.stride;
-  frame.format = PixelFormat::BGRA8;
-  frame.pixels = std::move(storage);
+  frame.pixels = BitmapView(std::move(storage), SizePX{rect.w, rect.h}, dib.stride,
+                            PixelFormat::BGRA8);
   return Result<FrozenFrame>::Ok(frame);
 }
 
@@ -156,6 +161,7 @@ RectPX ResolveMonitorRectPx(HMONITOR monitor) {
 } // namespace
 
 Result<void> PrepareFrozenFrameForCursorMonitor() {
+  SNAPPIN_TRACE_SPAN("capture.freeze_monitor", "capture");
   POINT cursor = {};
   if (!GetCursorPos(&cursor)) {
     Error err;
@@ -171,6 +177,8 @@ Result<void> PrepareFrozenFrameForCursorMonitor() {
     return Result<void>::Fail(err);
   }
 
+  // Drop the previous frame first so its block can be recycled for this one.
+  g_frozen_frame.reset();
   Result<FrozenFrame> frame = CaptureFrozenFrameForMonitorRect(rect);
   if (!frame.ok) {
     return Result<void>::Fail(frame.error);
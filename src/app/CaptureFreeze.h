@@ -9,10 +9,8 @@ namespace snappin {
 
 struct FrozenFrame {
   RectPX screen_rect_px{};
-  SizePX size_px{};
-  int32_t stride_bytes = 0;
-  PixelFormat format = PixelFormat::BGRA8;
-  std::shared_ptr<std::vector<uint8_t>> pixels;
+  // BGRA8 monitor pixels in a PixelBufferPool block.
+  BitmapView pixels;
 };
 
 Result<void> PrepareFrozenFrameForCursorMonitor();
@@ -7,122 +7,28 @@
 
 #include <shlobj.h>
 
-#include <cctype>
+#include <memory>
 #include <string>
-#include <vector>
+#include <utility>
 
 namespace snappin {
 namespace {
 
-bool ReadBoolField(const std::string& json, const std::string& key, bool* out) {
-  std::string needle = "\"" + key + "\"";
-  size_t pos = json.find(needle);
-  if (pos == std::string::npos) {
-    return false;
-  }
-  pos = json.find(':', pos + needle.size());
-  if (pos == std::string::npos) {
-    return false;
-  }
-  ++pos;
-  while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
-    ++pos;
-  }
-  if (json.compare(pos, 4, "true") == 0) {
-    *out = true;
-    return true;
-  }
-  if (json.compare(pos, 5, "false") == 0) {
-    *out = false;
-    return true;
-  }
-  return false;
-}
-
-bool ReadStringField(const std::string& json, const std::string& key, std::string* out) {
-  std::string needle = "\"" + key + "\"";
-  size_t pos = json.find(needle);
-  if (pos == std::string::npos) {
-    return false;
-  }
-  pos = json.find(':', pos + needle.size());
-  if (pos == std::string::npos) {
-    return false;
-  }
-  ++pos;
-  while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
-    ++pos;
-  }
-  if (pos >= json.size() || json[pos] != '"') {
-    return false;
-  }
-  ++pos;
-  std::string value;
-  bool escape = false;
-  for (; pos < json.size(); ++pos) {
-    char c = json[pos];
-    if (escape) {
-      value.push_back(c);
-      escape = false;
-      continue;
-    }
-    if (c == '\\') {
-      escape = true;
-      continue;
-    }
-    if (c == '"') {
-      *out = value;
-      return true;
-    }
-    value.push_back(c);
-  }
-  return false;
-}
-
-bool FindObjectSection(const std::string& json, const std::string& key, size_t* start,
-                       size_t* end) {
-  std::string needle = "\"" + key + "\"";
-  size_t pos = json.find(needle);
-  if (pos == std::string::npos) {
-    return false;
-  }
-  pos = json.find('{', pos + needle.size());
-  if (pos == std::string::npos) {
-    return false;
+std::wstring WidenUtf8(const std::string& value) {
+  if (value.empty()) {
+    return L"";
   }
-
-  size_t i = pos + 1;
-  int depth = 1;
-  bool in_string = false;
-  bool escape = false;
-  for (; i < json.size(); ++i) {
-    char c = json[i];
-    if (in_string) {
-      if (escape) {
-        escape = false;
-      } else if (c == '\\') {
-        escape = true;
-      } else if (c == '"') {
-        in_string = false;
-      }
-      continue;
-    }
-    if (c == '"') {
-      in_string = true;
-      continue;
-    }
-    if (c == '{') {
-      ++depth;
-    } else if (c == '}') {
-      --depth;
-      if (depth == 0) {
-        *start = pos + 1;
-        *end = i;
-        return true;
-      }
-    }
+  int needed =
+      MultiByteToWideChar(CP_UTF8, 0, value.data(), static_cast<int>(value.size()),
+                          nullptr, 0);
+  if (needed <= 0) {
+    return L"";
   }
-  return false;
+  std::wstring out;
+  out.resize(static_cast<size_t>(needed));
+  MultiByteToWideChar(CP_UTF8, 0, value.data(), static_cast<int>(value.size()),
+                      out.data(), needed);
+  return out;
 }
 
 void FillWin32Error(Error* err, const char* code, const char* message, DWORD last_error) {
@@ -271,7 +177,12 @@ Result<void> ConfigService::Reload() {
   return Result<void>::Ok();
 }
 
-const std::string& ConfigService::RawJson() const { return json_; }
+std::string ConfigService::RawJson() const { return CurrentState()->json; }
+
+std::shared_ptr<const ConfigSnapshot> ConfigService::Snapshot() const {
+  std::shared_ptr<const State> state = CurrentState();
+  return std::shared_ptr<const ConfigSnapshot>(state, &state->snapshot);
+}
 
 const std::wstring& ConfigService::RootDir() const { return root_dir_; }
 
@@ -280,87 +191,75 @@ const std::wstring& ConfigService::ConfigDir() const { return config_dir_; }
 const std::wstring& ConfigService::ConfigPath() const { return config_path_; }
 
 bool ConfigService::CaptureAutoCopyToClipboard(bool default_value) const {
-  size_t start = 0;
-  size_t end = 0;
-  if (!FindObjectSection(json_, "capture", &start, &end)) {
-    return default_value;
-  }
-  std::string section = json_.substr(start, end - start);
-  bool enabled = default_value;
-  if (ReadBoolField(section, "auto_copy_to_clipboard", &enabled)) {
-    return enabled;
-  }
-  return default_value;
+  return CurrentState()->snapshot.capture_auto_copy_to_clipboard.value_or(default_value);
 }
 
 bool ConfigService::CaptureAutoShowToolbar(bool default_value) const {
-  size_t start = 0;
-  size_t end = 0;
-  if (!FindObjectSection(json_, "capture", &start, &end)) {
-    return default_value;
-  }
-  std::string section = json_.substr(start, end - start);
-  bool enabled = default_value;
-  if (ReadBoolField(section, "auto_show_toolbar", &enabled)) {
-    return enabled;
-  }
-  return default_value;
+  return CurrentState()->snapshot.capture_auto_show_toolbar.value_or(default_value);
 }
 
 std::wstring ConfigService::ExportSaveDir() const {
-  size_t start = 0;
-  size_t end = 0;
-  if (!FindObjectSection(json_, "export", &start, &end)) {
-    return L"";
-  }
-  std::string section = json_.substr(start, end - start);
-  std::string value;
-  if (!ReadStringField(section, "save_dir", &value)) {
-    return L"";
-  }
-  return std::wstring(value.begin(), value.end());
+  return CurrentState()->export_save_dir;
 }
 
 std::string ConfigService::ExportNamingPattern() const {
-  size_t start = 0;
-  size_t end = 0;
-  if (!FindObjectSection(json_, "export", &start, &end)) {
-    return "";
-  }
-  std::string section = json_.substr(start, end - start);
-  std::string value;
-  if (!ReadStringField(section, "naming_pattern", &value)) {
-    return "";
-  }
-  return value;
+  return CurrentState()->snapshot.export_naming_pattern;
+}
+
+std::string ConfigService::ExportPngPreset() const {
+  return CurrentState()->snapshot.export_png_preset;
 }
 
 bool ConfigService::ExportOpenFolderAfterSave(bool default_value) const {
-  size_t start = 0;
-  size_t end = 0;
-  if (!FindObjectSection(json_, "export", &start, &end)) {
-    return default_value;
-  }
-  std::string section = json_.substr(start, end - start);
-  bool enabled = default_value;
-  if (ReadBoolField(section, "open_folder_after_save", &enabled)) {
-    return enabled;
-  }
-  return default_value;
+  return CurrentState()->snapshot.export_open_folder_after_save.value_or(default_value);
+}
+
+bool ConfigService::HotkeysEnabled(bool default_value) const {
+  return CurrentState()->snapshot.hotkeys_enabled.value_or(default_value);
+}
+
+std::string ConfigService::HotkeysConflictPolicy() const {
+  return CurrentState()->snapshot.hotkeys_conflict_policy;
+}
+
+double ConfigService::AnnotatePencilTolerancePx(double default_value) const {
+  return CurrentState()->snapshot.annotate_pencil_tolerance_px.value_or(default_value);
+}
+
+bool ConfigService::AnnotatePencilSmoothing(bool default_value) const {
+  return CurrentState()->snapshot.annotate_pencil_smoothing.value_or(default_value);
+}
+
+bool ConfigService::PinRestoreSession(bool default_value) const {
+  return CurrentState()->snapshot.pin_restore_session.value_or(default_value);
 }
 
 bool ConfigService::DebugEnabled(bool default_value) const {
-  size_t start = 0;
-  size_t end = 0;
-  if (!FindObjectSection(json_, "debug", &start, &end)) {
-    return default_value;
-  }
-  std::string section = json_.substr(start, end - start);
-  bool enabled = default_value;
-  if (ReadBoolField(section, "enabled", &enabled)) {
-    return enabled;
-  }
-  return default_value;
+  return CurrentState()->snapshot.debug_enabled.value_or(default_value);
+}
+
+bool ConfigService::DebugTraceEnabled(bool default_value) const {
+  return CurrentState()->snapshot.debug_trace_enabled.value_or(default_value);
+}
+
+int ConfigService::AdvancedPixelPoolMaxMb(int default_value) const {
+  return CurrentState()->snapshot.advanced_pixel_pool_max_mb.value_or(default_value);
+}
+
+int ConfigService::AdvancedMaxCpuBitmapCacheMb(int default_value) const {
+  return CurrentState()->snapshot.advanced_max_cpu_bitmap_cache_mb.value_or(default_value);
+}
+
+int ConfigService::AdvancedPinScaleCacheMb(int default_value) const {
+  return CurrentState()->snapshot.advanced_pin_scale_cache_mb.value_or(default_value);
+}
+
+int ConfigService::AdvancedPinCompressIdleSeconds(int default_value) const {
+  return CurrentState()->snapshot.advanced_pin_compress_idle_seconds.value_or(default_value);
+}
+
+int ConfigService::AdvancedHistoryMaxMb(int default_value) const {
+  return CurrentState()->snapshot.advanced_history_max_mb.value_or(default_value);
 }
 
 bool ConfigService::EnsureConfigExists(Error* err) {
@@ -376,143 +275,31 @@ bool ConfigService::EnsureConfigExists(Error* err) {
     return true;
   }
 
-  std::string defaults = DefaultConfigJson();
-  return WriteFileAtomic(config_path_, defaults, err);
+  return WriteFileAtomic(config_path_, std::string(DefaultConfigJson()), err);
 }
 
 bool ConfigService::Load(Error* err) {
-  return ReadFileToString(config_path_, &json_, err);
-}
-
-std::string ConfigService::DefaultConfigJson() {
-  return R"json({
-  "config_version": 1,
-  "app": {
-    "language": "auto",
-    "start_on_boot": false,
-    "single_instance": true,
-    "theme": "system"
-  },
-  "privacy": {
-    "allow_network_features": false,
-    "log_redaction_level": "strict",
-    "first_time_network_prompt_shown": false
-  },
-  "hotkeys": {
-    "enabled": true,
-    "conflict_policy": "warn"
-  },
-  "capture": {
-    "detect_mode_default": "elements",
-    "backend_prefer": "auto",
-    "include_cursor": false,
-    "overlay_min_rect_px": 5,
-    "overlay_show_hint": true,
-    "multi_monitor_behavior": "current_monitor",
-    "auto_copy_to_clipboard": true,
-    "auto_show_toolbar": true,
-    "copy_priority": "image"
-  },
-  "export": {
-    "default_format": "png",
-    "jpeg_quality_0_100": 90,
-    "webp_quality_0_100": 90,
-    "save_dir": "",
-    "naming_pattern": "SnapPin_{yyyyMMdd_HHmmss}_{rand4}",
-    "open_folder_after_save": false,
-    "clipboard_retry_ms": 200,
-    "clipboard_retry_count": 5
-  },
-  "annotate": {
-    "default_tool": "rect",
-    "stroke_width": 2.0,
-    "stroke_color": "#FF3B30",
-    "text_font": "Segoe UI",
-    "text_size": 16.0,
-    "auto_save_temp": true,
-    "confirm_on_close_if_dirty": true
-  },
-  "pin": {
-    "always_on_top_default": true,
-    "opacity_step": 0.05,
-    "scale_step": 0.05,
-    "scale_step_fine": 0.01,
-    "min_opacity_0_1": 0.2,
-    "max_scale": 5.0,
-    "min_scale": 0.1,
-    "double_click_action": "none",
-    "lock_disables_annotate": true,
-    "clipboard_prefer": "image_first",
-    "from_clipboard_fail_toast": true
-  },
-  "text_render": {
-    "enabled": true,
-    "font_family": "Segoe UI",
-    "font_size": 16.0,
-    "text_color": "#1E1E1E",
-    "bg_color": "#FFFFFF",
-    "padding_px": 12,
-    "line_spacing": 1.25,
-    "max_width_px": 720,
-    "max_height_px": 2000,
-    "trim_trailing_blank_lines": true,
-    "tab_to_spaces": 2,
-    "corner_radius_px": 10,
-    "shadow_enabled": false
-  },
-  "ocr": {
-    "enabled": true,
-    "engine": "system",
-    "auto_ocr_on_pin": false,
-    "language_hint": "",
-    "copy_fulltext_after_recognize": false,
-    "selection_mode": "rect",
-    "hover_highlight": true
-  },
-  "scroll": {
-    "enabled": true,
-    "max_frames": 300,
-    "downscale": 0.5,
-    "low_fps_hint": 10,
-    "match_fail_policy": "prompt",
-    "overlap_search_px": 200
-  },
-  "record": {
-    "enabled": true,
-    "container_default": "mp4",
-    "fps": 30,
-    "bitrate_kbps": 8000,
-    "countdown_seconds": 3,
-    "include_cursor": true,
-    "max_queue_frames": 60,
-    "drop_policy": "drop_oldest",
-    "output_dir": "",
-    "filename_pattern": "SnapPinRec_{yyyyMMdd_HHmmss}_{rand4}"
-  },
-  "history": {
-    "enabled": true,
-    "max_items": 50,
-    "max_total_mb": 500,
-    "keep_days": 0,
-    "thumb_max_edge_px": 320,
-    "thumb_cache_items": 20,
-    "auto_cleanup_on_start": true,
-    "index_file_name": "index.jsonl"
-  },
-  "advanced": {
-    "lazy_release_seconds": 10,
-    "memory_pressure_release": true,
-    "max_gpu_staging_mb": 256,
-    "max_cpu_bitmap_cache_mb": 128,
-    "ipc_channel": "named_pipe"
-  },
-  "debug": {
-    "enabled": false,
-    "show_stats_panel": false,
-    "log_level": "info",
-    "save_frames_for_diagnostics": false
+  auto state = std::make_shared<State>();
+  if (!ReadFileToString(config_path_, &state->json, err)) {
+    return false;
+  }
+  JsonParseError parse_err;
+  if (!BuildConfigSnapshot(state->json, &state->snapshot, &parse_err)) {
+    if (err) {
+      err->code = ERR_INTERNAL_ERROR;
+      err->message = "Config parse failed";
+      err->retryable = false;
+      err->detail = FormatJsonError(parse_err);
+    }
+    return false;
   }
-})json";
+  state->export_save_dir = WidenUtf8(state->snapshot.export_save_dir);
+  state_.store(std::move(state));
+  return true;
+}
+
+std::shared_ptr<const ConfigService::State> ConfigService::CurrentState() const {
+  return state_.load();
 }
 
 std::wstring ConfigService::GetRootDir() {
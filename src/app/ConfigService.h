@@ -1,10 +1,17 @@
 #pragma once
+#include "ConfigSnapshot.h"
 #include "Types.h"
 
+#include <atomic>
+#include <memory>
 #include <string>
 
 namespace snappin {
 
+// Getters read a ConfigSnapshot parsed once per Load; a reload builds a new
+// snapshot and swaps it in atomically, so readers on any thread see either
+// the old or the new config, never a mix. A file that fails to parse is
+// rejected and the previous snapshot stays active.
 class ConfigService {
 public:
   ConfigService() = default;
@@ -12,7 +19,9 @@ public:
   Result<void> Initialize();
   Result<void> Reload();
 
-  const std::string& RawJson() const;
+  std::string RawJson() const;
+  // The current snapshot; stays valid (and unchanged) across reloads.
+  std::shared_ptr<const ConfigSnapshot> Snapshot() const;
   const std::wstring& RootDir() const;
   const std::wstring& ConfigDir() const;
   const std::wstring& ConfigPath() const;
@@ -20,14 +29,32 @@ public:
   bool CaptureAutoShowToolbar(bool default_value = true) const;
   std::wstring ExportSaveDir() const;
   std::string ExportNamingPattern() const;
+  std::string ExportPngPreset() const;
   bool ExportOpenFolderAfterSave(bool default_value = false) const;
+  bool HotkeysEnabled(bool default_value = true) const;
+  std::string HotkeysConflictPolicy() const;
+  double AnnotatePencilTolerancePx(double default_value = 1.0) const;
+  bool AnnotatePencilSmoothing(bool default_value = false) const;
+  bool PinRestoreSession(bool default_value = true) const;
   bool DebugEnabled(bool default_value = false) const;
+  bool DebugTraceEnabled(bool default_value = false) const;
+  int AdvancedPixelPoolMaxMb(int default_value = 256) const;
+  int AdvancedMaxCpuBitmapCacheMb(int default_value = 128) const;
+  int AdvancedPinScaleCacheMb(int default_value = 64) const;
+  int AdvancedPinCompressIdleSeconds(int default_value = 30) const;
+  int AdvancedHistoryMaxMb(int default_value = 512) const;
 
 private:
+  struct State {
+    std::string json;
+    ConfigSnapshot snapshot;
+    std::wstring export_save_dir; // snapshot.export_save_dir, widened
+  };
+
   bool EnsureConfigExists(Error* err);
   bool Load(Error* err);
+  std::shared_ptr<const State> CurrentState() const;
 
-  static std::string DefaultConfigJson();
   static std::wstring GetRootDir();
   static std::wstring GetExeDir();
   static std::wstring JoinPath(const std::wstring& a, const std::wstring& b);
@@ -35,7 +62,7 @@ private:
   std::wstring root_dir_;
   std::wstring config_dir_;
   std::wstring config_path_;
-  std::string json_;
+  std::atomic<std::shared_ptr<const State>> state_{std::make_shared<const State>()};
 };
 
 } // namespace snappin
@@ -130,52 +130,6 @@ bool ReadBoolField(const std::string& json, const std::string& key, bool* out) {
   return false;
 }
 
-bool FindObjectSection(const std::string& json, const std::string& key, size_t* start,
-                       size_t* end) {
-  std::string needle = "\"" + key + "\"";
-  size_t pos = json.find(needle);
-  if (pos == std::string::npos) {
-    return false;
-  }
-  pos = json.find('{', pos + needle.size());
-  if (pos == std::string::npos) {
-    return false;
-  }
-
-  size_t i = pos + 1;
-  int depth = 1;
-  bool in_string = false;
-  bool escape = false;
-  for (; i < json.size(); ++i) {
-    char c = json[i];
-    if (in_string) {
-      if (escape) {
-        escape = false;
-      } else if (c == '\\') {
-        escape = true;
-      } else if (c == '"') {
-        in_string = false;
-      }
-      continue;
-    }
-    if (c == '"') {
-      in_string = true;
-      continue;
-    }
-    if (c == '{') {
-      ++depth;
-    } else if (c == '}') {
-      --depth;
-      if (depth == 0) {
-        *start = pos + 1;
-        *end = i;
-        return true;
-      }
-    }
-  }
-  return false;
-}
-
 bool FindArraySection(const std::string& json, const std::string& key, size_t* start,
                       size_t* end) {
   std::string needle = "\"" + key + "\"";
@@ -309,14 +263,12 @@ Result<void> KeybindingsService::Initialize(const ConfigService& config,
     return Result<void>::Fail(err);
   }
 
-  bool enabled = true;
-  ParseHotkeysEnabled(config.RawJson(), &enabled);
-  if (!enabled) {
+  if (!config.HotkeysEnabled(true)) {
     OutputDebugStringA("Hotkeys disabled by config\n");
     return Result<void>::Ok();
   }
 
-  ConflictPolicy policy = ParseConflictPolicy(config.RawJson());
+  ConflictPolicy policy = ParseConflictPolicy(config.HotkeysConflictPolicy());
   if (!RegisterBindings(policy, &err)) {
     return Result<void>::Fail(err);
   }
@@ -399,7 +351,7 @@ bool KeybindingsService::RegisterBindings(ConflictPolicy policy, Error* err) {
     if (!binding.enabled) {
       continue;
     }
-    if (!registry_ || !registry_->Find(binding.id).has_value()) {
+    if (!registry_ || !registry_->Find(binding.id)) {
       continue;
     }
     std::string scope_upper = ToUpper(binding.scope);
@@ -452,37 +404,17 @@ bool KeybindingsService::RegisterBindings(ConflictPolicy policy, Error* err) {
 }
 
 KeybindingsService::ConflictPolicy KeybindingsService::ParseConflictPolicy(
-    const std::string& json) {
-  size_t start = 0;
-  size_t end = 0;
-  if (!FindObjectSection(json, "hotkeys", &start, &end)) {
-    return ConflictPolicy::Warn;
-  }
-  std::string section = json.substr(start, end - start);
-  std::string value;
-  if (!ReadStringField(section, "conflict_policy", &value)) {
-    return ConflictPolicy::Warn;
-  }
-  value = ToUpper(value);
-  if (value == "OVERRIDE") {
+    const std::string& value) {
+  const std::string upper = ToUpper(value);
+  if (upper == "OVERRIDE") {
     return ConflictPolicy::Override;
   }
-  if (value == "IGNORE") {
+  if (upper == "IGNORE") {
     return ConflictPolicy::Ignore;
   }
   return ConflictPolicy::Warn;
 }
 
-bool KeybindingsService::ParseHotkeysEnabled(const std::string& json, bool* enabled_out) {
-  size_t start = 0;
-  size_t end = 0;
-  if (!FindObjectSection(json, "hotkeys", &start, &end)) {
-    return false;
-  }
-  std::string section = json.substr(start, end - start);
-  return ReadBoolField(section, "enabled", enabled_out);
-}
-
 std::string KeybindingsService::DefaultKeybindingsJson() {
   return R"json({
   "keybindings_version": 1,
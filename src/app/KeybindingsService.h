@@ -41,8 +41,7 @@ private:
   bool ParseBindings(const std::string& json, Error* err);
   bool RegisterBindings(ConflictPolicy policy, Error* err);
 
-  static ConflictPolicy ParseConflictPolicy(const std::string& json);
-  static bool ParseHotkeysEnabled(const std::string& json, bool* enabled_out);
+  static ConflictPolicy ParseConflictPolicy(const std::string& value);
   static std::string DefaultKeybindingsJson();
   static std::wstring JoinPath(const std::wstring& a, const std::wstring& b);
   static bool ReadFileToString(const std::wstring& path, std::string* out, Error* err);
@@ -1,7 +1,12 @@
 ﻿#include "PinManager.h"
 
 #include "Action.h"
+#include "ActionDispatcher.h"
 #include "ConfigService.h"
+#include "PinPixelStore.h"
+#include "PixelBufferPool.h"
+#include "PixelDedupRegistry.h"
+#include "PixelKernels.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -12,6 +17,8 @@
 #include <cwctype>
 #include <cstdio>
 #include <cstring>
+#include <filesystem>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -181,6 +188,28 @@ bool WriteTextFileUtf8(const std::wstring& path, const std::wstring& text, Error
   return true;
 }
 
+PinSessionMeta ToSessionMeta(const PinWindow::State& state) {
+  PinSessionMeta meta;
+  meta.pos_px = state.pos_px;
+  meta.scale = state.scale;
+  meta.opacity = state.opacity;
+  meta.locked = state.locked;
+  meta.always_on_top = state.always_on_top;
+  meta.visible = state.visible;
+  return meta;
+}
+
+PinWindow::State FromSessionMeta(const PinSessionMeta& meta) {
+  PinWindow::State state;
+  state.pos_px = meta.pos_px;
+  state.scale = meta.scale;
+  state.opacity = meta.opacity;
+  state.locked = meta.locked;
+  state.always_on_top = meta.always_on_top;
+  state.visible = meta.visible;
+  return state;
+}
+
 } // namespace
 
 PinManager::~PinManager() { Shutdown(); }
@@ -188,52 +217,48 @@ PinManager::~PinManager() { Shutdown(); }
 bool PinManager::Initialize(HINSTANCE instance, HWND main_hwnd,
                             RuntimeState* runtime_state,
                             ConfigService* config_service,
-                            IExportService* exporter) {
+                            IExportService* exporter,
+                            IArtifactStore* artifacts) {
   instance_ = instance;
   main_hwnd_ = main_hwnd;
   runtime_state_ = runtime_state;
   config_service_ = config_service;
   exporter_ = exporter;
-  return instance_ != nullptr && main_hwnd_ != nullptr;
+  artifacts_ = artifacts;
+  if (instance_ == nullptr || main_hwnd_ == nullptr) {
+    return false;
+  }
+  if (config_service_ && !config_service_->RootDir().empty() &&
+      config_service_->PinRestoreSession(true)) {
+    const std::filesystem::path path =
+        std::filesystem::path(config_service_->RootDir()) / L"pins.session";
+    if (session_.Open(path)) {
+      RestoreSession();
+    } else {
+      OutputDebugStringA("Pin session open failed\n");
+    }
+  }
+  return true;
 }
 
 void PinManager::Shutdown() {
+  session_.Close();
   DestroyAll();
   instance_ = nullptr;
   main_hwnd_ = nullptr;
   runtime_state_ = nullptr;
   config_service_ = nullptr;
   exporter_ = nullptr;
+  artifacts_ = nullptr;
 }
 
 Result<Id64> PinManager::CreateFromArtifact(const Artifact& art) {
-  std::shared_ptr<std::vector<uint8_t>> storage;
-  SizePX size_px{};
-  int32_t stride_bytes = 0;
-
-  if (art.base_cpu.has_value() && art.base_cpu_storage &&
-      !art.base_cpu_storage->empty() &&
-      art.base_cpu->format == PixelFormat::BGRA8 && art.base_cpu->size_px.w > 0 &&
-      art.base_cpu->size_px.h > 0 &&
-      art.base_cpu->stride_bytes >= art.base_cpu->size_px.w * 4) {
-    const size_t total = static_cast<size_t>(art.base_cpu->stride_bytes) *
-                         static_cast<size_t>(art.base_cpu->size_px.h);
-    if (art.base_cpu_storage->size() < total) {
-      Error err;
-      err.code = ERR_INTERNAL_ERROR;
-      err.message = "Artifact bitmap storage invalid";
-      err.retryable = true;
-      err.detail = "base_cpu_storage_size";
-      return Result<Id64>::Fail(err);
-    }
-    auto copied = std::make_shared<std::vector<uint8_t>>();
-    copied->resize(total);
-    std::memcpy(copied->data(), art.base_cpu_storage->data(), total);
-    storage = std::move(copied);
-    size_px = art.base_cpu->size_px;
-    stride_bytes = art.base_cpu->stride_bytes;
+  // The pin shares the artifact's pixels; neither side ever writes to them.
+  BitmapView pixels;
+  if (art.base_cpu.valid() && art.base_cpu.format() == PixelFormat::BGRA8) {
+    pixels = art.base_cpu;
   } else {
-    if (!CaptureRectToBitmap(art.screen_rect_px, &storage, &size_px, &stride_bytes)) {
+    if (!CaptureRectToBitmap(art.screen_rect_px, &pixels)) {
       Error err;
       err.code = ERR_CAPTURE_FAILED;
       err.message = "Pin capture failed";
@@ -246,17 +271,38 @@ Result<Id64> PinManager::CreateFromArtifact(const Artifact& art) {
   PointPX pos{};
   pos.x = art.screen_rect_px.x;
   pos.y = art.screen_rect_px.y;
-  return CreatePinWithBitmap(std::move(storage), size_px, stride_bytes, pos);
+  return CreatePinWithBitmap(std::move(pixels), pos, art.artifact_id);
+}
+
+Result<Id64> PinManager::CreateFromPixels(BitmapView pixels, const PointPX& pos_px) {
+  if (pixels.valid() && pixels.format() != PixelFormat::BGRA8) {
+    std::shared_ptr<uint8_t> bgra;
+    int32_t stride = 0;
+    CpuBitmap target;
+    if (AcquirePixelBuffer(PixelBufferPool::Shared(), pixels.size_px(), &bgra, &stride)) {
+      target.size_px = pixels.size_px();
+      target.stride_bytes = stride;
+      target.data.p = bgra.get();
+    }
+    if (!bgra || !SwizzleBitmapRB(pixels.AsCpuBitmap(), &target)) {
+      Error err;
+      err.code = ERR_OUT_OF_MEMORY;
+      err.message = "Pin pixels unavailable";
+      err.retryable = true;
+      err.detail = "swizzle";
+      return Result<Id64>::Fail(err);
+    }
+    pixels = BitmapView(std::move(bgra), target.size_px, stride, target.format);
+  }
+  return CreatePinWithBitmap(std::move(pixels), pos_px);
 }
 
 Result<Id64> PinManager::CreateFromClipboard() {
-  std::shared_ptr<std::vector<uint8_t>> storage;
-  SizePX size_px{};
-  int32_t stride_bytes = 0;
+  BitmapView pixels;
   Error image_err;
-  if (ReadClipboardBitmap(&storage, &size_px, &stride_bytes, &image_err)) {
-    const PointPX pos = DefaultCenteredPos(size_px);
-    return CreatePinWithBitmap(std::move(storage), size_px, stride_bytes, pos);
+  if (ReadClipboardBitmap(&pixels, &image_err)) {
+    const PointPX pos = DefaultCenteredPos(pixels.size_px());
+    return CreatePinWithBitmap(std::move(pixels), pos);
   }
 
   std::wstring text;
@@ -331,6 +377,18 @@ Result<void> PinManager::SaveFocused() {
   return SavePin(*focused_pin_id_);
 }
 
+void PinManager::RegisterActions(ActionDispatcher& dispatcher) {
+  dispatcher.RegisterHandler("pin.create_from_clipboard", [this](ActionCall&) {
+    Result<Id64> pin = CreateFromClipboard();
+    return pin.ok ? Result<void>::Ok() : Result<void>::Fail(pin.error);
+  });
+  dispatcher.RegisterHandler("pin.copy_focused", [this](ActionCall&) { return CopyFocused(); });
+  dispatcher.RegisterHandler("pin.save_focused", [this](ActionCall&) { return SaveFocused(); });
+  dispatcher.RegisterHandler("pin.close_focused",
+                             [this](ActionCall&) { return CloseFocused(); });
+  dispatcher.RegisterHandler("pin.close_all", [this](ActionCall&) { return CloseAll(); });
+}
+
 bool PinManager::HandleWindowCommand(WPARAM wparam, LPARAM lparam) {
   const Id64 pin_id{static_cast<uint64_t>(wparam)};
   const PinWindow::Command cmd = static_cast<PinWindow::Command>(lparam);
@@ -355,6 +413,13 @@ bool PinManager::HandleWindowCommand(WPARAM wparam, LPARAM lparam) {
     case PinWindow::Command::DestroyAll:
       res = DestroyAll();
       break;
+    case PinWindow::Command::RepaintSelf: {
+      auto it = pins_.find(pin_id.value);
+      if (it != pins_.end() && it->second.window) {
+        it->second.window->Invalidate();
+      }
+      break;
+    }
     default:
       return false;
   }
@@ -369,10 +434,8 @@ bool PinManager::HandleWindowCommand(WPARAM wparam, LPARAM lparam) {
   return true;
 }
 
-bool PinManager::CaptureRectToBitmap(
-    const RectPX& rect, std::shared_ptr<std::vector<uint8_t>>* storage_out,
-    SizePX* size_out, int32_t* stride_out) {
-  if (!storage_out || !size_out || !stride_out || rect.w <= 0 || rect.h <= 0) {
+bool PinManager::CaptureRectToBitmap(const RectPX& rect, BitmapView* pixels_out) {
+  if (!pixels_out || rect.w <= 0 || rect.h <= 0) {
     return false;
   }
 
@@ -407,23 +470,23 @@ bool PinManager::CaptureRectToBitmap(
     return false;
   }
 
-  const int32_t stride = rect.w * 4;
-  const size_t total = static_cast<size_t>(stride) * static_cast<size_t>(rect.h);
-  auto storage = std::make_shared<std::vector<uint8_t>>();
-  storage->resize(total);
-  std::memcpy(storage->data(), bits, total);
+  const SizePX size_px{rect.w, rect.h};
+  std::shared_ptr<uint8_t> storage;
+  int32_t stride = 0;
+  if (!AcquirePixelBuffer(PixelBufferPool::Shared(), size_px, &storage, &stride)) {
+    DeleteObject(dib);
+    return false;
+  }
+  std::memcpy(storage.get(), bits,
+              static_cast<size_t>(stride) * static_cast<size_t>(rect.h));
   DeleteObject(dib);
 
-  *storage_out = std::move(storage);
-  *size_out = SizePX{rect.w, rect.h};
-  *stride_out = stride;
-  return true;
+  *pixels_out = BitmapView(std::move(storage), size_px, stride);
+  return pixels_out->valid();
 }
 
-bool PinManager::ReadClipboardBitmap(
-    std::shared_ptr<std::vector<uint8_t>>* storage_out, SizePX* size_out,
-    int32_t* stride_out, Error* err) {
-  if (!storage_out || !size_out || !stride_out || !err) {
+bool PinManager::ReadClipboardBitmap(BitmapView* pixels_out, Error* err) {
+  if (!pixels_out || !err) {
     return false;
   }
 
@@ -466,9 +529,16 @@ bool PinManager::ReadClipboardBitmap(
 
   const int32_t w = bm.bmWidth;
   const int32_t h = bm.bmHeight;
-  const int32_t stride = w * 4;
-  auto storage = std::make_shared<std::vector<uint8_t>>();
-  storage->resize(static_cast<size_t>(stride) * static_cast<size_t>(h));
+  std::shared_ptr<uint8_t> storage;
+  int32_t stride = 0;
+  if (!AcquirePixelBuffer(PixelBufferPool::Shared(), SizePX{w, h}, &storage, &stride)) {
+    CloseClipboard();
+    err->code = ERR_OUT_OF_MEMORY;
+    err->message = "Clipboard image alloc failed";
+    err->retryable = true;
+    err->detail = "pixel_pool";
+    return false;
+  }
 
   BITMAPINFO bi = {};
   bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
@@ -480,7 +550,7 @@ bool PinManager::ReadClipboardBitmap(
 
   HDC screen = GetDC(nullptr);
   const int lines =
-      GetDIBits(screen, bmp, 0, static_cast<UINT>(h), storage->data(), &bi,
+      GetDIBits(screen, bmp, 0, static_cast<UINT>(h), storage.get(), &bi,
                 DIB_RGB_COLORS);
   ReleaseDC(nullptr, screen);
   CloseClipboard();
@@ -493,10 +563,8 @@ bool PinManager::ReadClipboardBitmap(
     return false;
   }
 
-  *storage_out = std::move(storage);
-  *size_out = SizePX{w, h};
-  *stride_out = stride;
-  return true;
+  *pixels_out = BitmapView(std::move(storage), SizePX{w, h}, stride);
+  return pixels_out->valid();
 }
 
 bool PinManager::ReadClipboardText(std::wstring* text_out, Error* err) {
@@ -558,10 +626,9 @@ bool PinManager::ReadClipboardText(std::wstring* text_out, Error* err) {
   return true;
 }
 
-Result<Id64> PinManager::CreatePinWithBitmap(
-    std::shared_ptr<std::vector<uint8_t>> storage, const SizePX& size_px,
-    int32_t stride_bytes, const PointPX& pos_px) {
-  if (!instance_ || !main_hwnd_ || !storage || size_px.w <= 0 || size_px.h <= 0) {
+Result<Id64> PinManager::CreatePinWithBitmap(BitmapView pixels, const PointPX& pos_px,
+                                             std::optional<Id64> source_artifact_id) {
+  if (!instance_ || !main_hwnd_ || !pixels.valid()) {
     Error err;
     err.code = ERR_INTERNAL_ERROR;
     err.message = "Pin manager not initialized";
@@ -570,7 +637,61 @@ Result<Id64> PinManager::CreatePinWithBitmap(
     return Result<Id64>::Fail(err);
   }
 
+  // Identical images (pinned twice, or pinned from the clipboard right after
+  // a copy) share one buffer with each other and with their artifacts.
+  pixels = PixelDedupRegistry::Shared().Intern(std::move(pixels));
+
   Id64 pin_id{next_pin_id_++};
+  std::unique_ptr<PinWindow> window = NewPinWindow();
+  window->SetStateCallback([this](Id64 id, const PinWindow::State& state) {
+    session_.PutMeta(id.value, ToSessionMeta(state));
+  });
+
+  // Once idle pins are compressed their pixels no longer share the artifact's
+  // buffer, so the artifact's pin reference is dropped then rather than kept
+  // until the pin closes.
+  PinEntry entry;
+  if (artifacts_ && source_artifact_id.has_value()) {
+    artifacts_->AddPinRef(*source_artifact_id);
+    entry.source_artifact_id = source_artifact_id;
+    entry.source_released = std::make_shared<std::atomic<bool>>(false);
+  }
+  std::function<void()> on_compressed;
+  if (entry.source_released) {
+    on_compressed = [artifacts = artifacts_, id = *source_artifact_id,
+                     released = entry.source_released] {
+      if (!released->exchange(true)) {
+        artifacts->ReleasePinRef(id);
+      }
+    };
+  }
+
+  const SizePX size_px = pixels.size_px();
+  const BitmapView session_pixels = pixels;
+  PinPixelStore::Shared().Add(pin_id.value, std::move(pixels), std::move(on_compressed));
+  if (!window->Create(instance_, pin_id, size_px, pos_px)) {
+    PinPixelStore::Shared().Remove(pin_id.value);
+    ReleaseSourceArtifact(entry);
+    Error err;
+    err.code = ERR_OUT_OF_MEMORY;
+    err.message = "Pin window create failed";
+    err.retryable = true;
+    err.detail = "CreateWindowExW";
+    return Result<Id64>::Fail(err);
+  }
+  // Encoded and written on the session's writer thread.
+  session_.PutPixels(pin_id.value, session_pixels);
+
+  entry.content_kind = PinWindow::ContentKind::Image;
+  entry.size_px = size_px;
+  entry.window = std::move(window);
+  pins_[pin_id.value] = std::move(entry);
+
+  SetFocusedPin(pin_id);
+  return Result<Id64>::Ok(pin_id);
+}
+
+std::unique_ptr<PinWindow> PinManager::NewPinWindow() {
   auto window = std::make_unique<PinWindow>();
   window->SetCallbacks(
       [this](Id64 focused_id) { SetFocusedPin(focused_id); },
@@ -581,26 +702,58 @@ Result<Id64> PinManager::CreatePinWithBitmap(
                        static_cast<LPARAM>(command));
         }
       });
+  return window;
+}
 
-  if (!window->Create(instance_, pin_id, storage, size_px, stride_bytes, pos_px)) {
-    Error err;
-    err.code = ERR_OUT_OF_MEMORY;
-    err.message = "Pin window create failed";
-    err.retryable = true;
-    err.detail = "CreateWindowExW";
-    return Result<Id64>::Fail(err);
+// Windows are created from the meta and pixel headers alone; PinPixelStore's
+// worker then reads and verifies each pin's pixels, and the window paints a
+// placeholder until they arrive. Pins whose pixels turn out missing or fail
+// their checksum are destroyed (and dropped from the session) at that point
+// rather than shown blank. Closed pins are dropped here: nothing shows them
+// again.
+void PinManager::RestoreSession() {
+  const HWND main_hwnd = main_hwnd_;
+  for (uint64_t key : session_.Keys()) {
+    next_pin_id_ = std::max(next_pin_id_, key + 1);
+    PinSessionMeta meta;
+    SizePX size_px;
+    bool restored = false;
+    if (session_.Meta(key, &meta) && meta.visible &&
+        session_.PixelInfo(key, &size_px, nullptr)) {
+      restored = PinPixelStore::Shared().AddDeferred(
+          key, size_px, [this, key] { return session_.Pixels(key); },
+          [main_hwnd, key](bool ok) {
+            const PinWindow::Command command =
+                ok ? PinWindow::Command::RepaintSelf : PinWindow::Command::DestroySelf;
+            PostMessageW(main_hwnd, kWindowCommandMessage, static_cast<WPARAM>(key),
+                         static_cast<LPARAM>(command));
+          });
+    }
+    if (restored && RestorePin(Id64{key}, size_px, meta)) {
+      continue;
+    }
+    PinPixelStore::Shared().Remove(key);
+    session_.Remove(key);
   }
+}
+
+bool PinManager::RestorePin(Id64 pin_id, const SizePX& size_px, const PinSessionMeta& meta) {
+  std::unique_ptr<PinWindow> window = NewPinWindow();
+  if (!window->Create(instance_, pin_id, size_px, meta.pos_px)) {
+    return false;
+  }
+  window->RestoreState(FromSessionMeta(meta));
+  // Set after restoring so that restoring does not write the state back.
+  window->SetStateCallback([this](Id64 id, const PinWindow::State& state) {
+    session_.PutMeta(id.value, ToSessionMeta(state));
+  });
 
   PinEntry entry;
   entry.content_kind = PinWindow::ContentKind::Image;
-  entry.storage = std::move(storage);
   entry.size_px = size_px;
-  entry.stride_bytes = stride_bytes;
   entry.window = std::move(window);
   pins_[pin_id.value] = std::move(entry);
-
-  SetFocusedPin(pin_id);
-  return Result<Id64>::Ok(pin_id);
+  return true;
 }
 
 Result<Id64> PinManager::CreatePinWithText(const std::wstring& text,
@@ -627,18 +780,9 @@ Result<Id64> PinManager::CreatePinWithText(const std::wstring& text,
 
   const SizePX size_px = EstimateTextPinSize(trimmed);
   Id64 pin_id{next_pin_id_++};
-  auto window = std::make_unique<PinWindow>();
-  window->SetCallbacks(
-      [this](Id64 focused_id) { SetFocusedPin(focused_id); },
-      [this](Id64 source_id, PinWindow::Command command) {
-        if (main_hwnd_) {
-          PostMessageW(main_hwnd_, kWindowCommandMessage,
-                       static_cast<WPARAM>(source_id.value),
-                       static_cast<LPARAM>(command));
-        }
-      });
+  std::unique_ptr<PinWindow> window = NewPinWindow();
 
-  if (!window->Create(instance_, pin_id, nullptr, size_px, 0, pos_px, content_kind,
+  if (!window->Create(instance_, pin_id, size_px, pos_px, content_kind,
                       trimmed)) {
     Error err;
     err.code = ERR_OUT_OF_MEMORY;
@@ -652,7 +796,6 @@ Result<Id64> PinManager::CreatePinWithText(const std::wstring& text,
   entry.content_kind = content_kind;
   entry.text_payload = trimmed;
   entry.size_px = size_px;
-  entry.stride_bytes = 0;
   entry.window = std::move(window);
   pins_[pin_id.value] = std::move(entry);
 
@@ -704,8 +847,12 @@ Result<void> PinManager::BuildArtifactFromPin(Id64 pin_id, Artifact* out_artifac
     err.detail = "pin_id";
     return Result<void>::Fail(err);
   }
-  if (it->second.content_kind != PinWindow::ContentKind::Image ||
-      !it->second.storage || it->second.storage->empty()) {
+  // Copy and save need full resolution; idle pins are decompressed here.
+  BitmapView pixels;
+  if (it->second.content_kind == PinWindow::ContentKind::Image) {
+    pixels = PinPixelStore::Shared().Full(pin_id.value);
+  }
+  if (!pixels.valid()) {
     Error err;
     err.code = ERR_TARGET_INVALID;
     err.message = "Pin is not an image";
@@ -717,13 +864,7 @@ Result<void> PinManager::BuildArtifactFromPin(Id64 pin_id, Artifact* out_artifac
   Artifact art;
   art.artifact_id = pin_id;
   art.kind = ArtifactKind::CAPTURE;
-  art.base_cpu_storage = it->second.storage;
-  CpuBitmap bmp;
-  bmp.format = PixelFormat::BGRA8;
-  bmp.size_px = it->second.size_px;
-  bmp.stride_bytes = it->second.stride_bytes;
-  bmp.data.p = it->second.storage->data();
-  art.base_cpu = bmp;
+  art.base_cpu = std::move(pixels);
   art.screen_rect_px = RectPX{0, 0, it->second.size_px.w, it->second.size_px.h};
   art.dpi_scale = 1.0f;
 
@@ -877,6 +1018,9 @@ Result<void> PinManager::DestroyPin(Id64 pin_id) {
   if (it->second.window) {
     it->second.window->Destroy();
   }
+  PinPixelStore::Shared().Remove(pin_id.value);
+  session_.Remove(pin_id.value);
+  ReleaseSourceArtifact(it->second);
   pins_.erase(it);
   if (focused_pin_id_.has_value() && focused_pin_id_->value == pin_id.value) {
     SetFocusedPin(std::nullopt);
@@ -889,11 +1033,21 @@ Result<void> PinManager::DestroyAll() {
     if (kv.second.window) {
       kv.second.window->Destroy();
     }
+    PinPixelStore::Shared().Remove(kv.first);
+    session_.Remove(kv.first);
+    ReleaseSourceArtifact(kv.second);
   }
   pins_.clear();
   SetFocusedPin(std::nullopt);
   return Result<void>::Ok();
 }
 
+void PinManager::ReleaseSourceArtifact(const PinEntry& entry) {
+  if (artifacts_ && entry.source_artifact_id.has_value() &&
+      !(entry.source_released && entry.source_released->exchange(true))) {
+    artifacts_->ReleasePinRef(*entry.source_artifact_id);
+  }
+}
+
 } // namespace snappin
 
@@ -2,12 +2,14 @@
 #include "Artifact.h"
 #include "ErrorCodes.h"
 #include "ExportService.h"
+#include "PinSessionStore.h"
 #include "PinWindow.h"
 #include "Types.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <string>
@@ -16,6 +18,7 @@
 
 namespace snappin {
 
+class ActionDispatcher;
 class ConfigService;
 struct RuntimeState;
 
@@ -26,18 +29,31 @@ public:
   PinManager() = default;
   ~PinManager();
 
+  // Restores the image pins of the last session unless pin.restore_session
+  // is off; they are kept in <root>/pins.session as they change.
   bool Initialize(HINSTANCE instance, HWND main_hwnd, RuntimeState* runtime_state,
-                  ConfigService* config_service, IExportService* exporter);
+                  ConfigService* config_service, IExportService* exporter,
+                  IArtifactStore* artifacts);
+  // Closes the session file first, so the pins it tears down are restored.
   void Shutdown();
 
+  // The artifact stays pinned in `artifacts` until the pin is destroyed.
   Result<Id64> CreateFromArtifact(const Artifact& art);
   Result<Id64> CreateFromClipboard();
+  // Pins pixels with their top-left corner at pos_px (a capture reopened
+  // from history, say). RGBA8 pixels are converted to a BGRA8 copy.
+  Result<Id64> CreateFromPixels(BitmapView pixels, const PointPX& pos_px);
 
   Result<void> CloseFocused();
   Result<void> CloseAll();
   Result<void> CopyFocused();
   Result<void> SaveFocused();
 
+  // Installs the handlers of pin.create_from_clipboard, pin.copy_focused,
+  // pin.save_focused, pin.close_focused and pin.close_all. The dispatcher
+  // keeps pin.create_from_artifact, which also ends the capture session.
+  void RegisterActions(ActionDispatcher& dispatcher);
+
   bool HandleWindowCommand(WPARAM wparam, LPARAM lparam);
 
 private:
@@ -45,20 +61,22 @@ private:
     std::unique_ptr<PinWindow> window;
     PinWindow::ContentKind content_kind = PinWindow::ContentKind::Image;
     std::wstring text_payload;
-    std::shared_ptr<std::vector<uint8_t>> storage;
     SizePX size_px{};
-    int32_t stride_bytes = 0;
+    // Artifact this pin was created from; holds a pin reference in artifacts_
+    // until the pin is destroyed or PinPixelStore compresses its pixels,
+    // whichever comes first (`source_released` records that the reference is gone).
+    std::optional<Id64> source_artifact_id;
+    std::shared_ptr<std::atomic<bool>> source_released;
   };
 
-  bool CaptureRectToBitmap(const RectPX& rect,
-                           std::shared_ptr<std::vector<uint8_t>>* storage_out,
-                           SizePX* size_out, int32_t* stride_out);
-  bool ReadClipboardBitmap(std::shared_ptr<std::vector<uint8_t>>* storage_out,
-                           SizePX* size_out, int32_t* stride_out, Error* err);
+  bool CaptureRectToBitmap(const RectPX& rect, BitmapView* pixels_out);
+  bool ReadClipboardBitmap(BitmapView* pixels_out, Error* err);
   bool ReadClipboardText(std::wstring* text_out, Error* err);
-  Result<Id64> CreatePinWithBitmap(std::shared_ptr<std::vector<uint8_t>> storage,
-                                   const SizePX& size_px, int32_t stride_bytes,
-                                   const PointPX& pos_px);
+  Result<Id64> CreatePinWithBitmap(BitmapView pixels, const PointPX& pos_px,
+                                   std::optional<Id64> source_artifact_id = std::nullopt);
+  std::unique_ptr<PinWindow> NewPinWindow();
+  void RestoreSession();
+  bool RestorePin(Id64 pin_id, const SizePX& size_px, const PinSessionMeta& meta);
   Result<Id64> CreatePinWithText(const std::wstring& text,
                                  PinWindow::ContentKind content_kind,
                                  const PointPX& pos_px);
@@ -71,14 +89,18 @@ private:
   Result<void> ClosePin(Id64 pin_id);
   Result<void> DestroyPin(Id64 pin_id);
   Result<void> DestroyAll();
+  void ReleaseSourceArtifact(const PinEntry& entry);
 
   HINSTANCE instance_ = nullptr;
   HWND main_hwnd_ = nullptr;
   RuntimeState* runtime_state_ = nullptr;
   ConfigService* config_service_ = nullptr;
   IExportService* exporter_ = nullptr;
+  IArtifactStore* artifacts_ = nullptr;
 
   uint64_t next_pin_id_ = 1;
+  // Keyed by pin id; pin ids of restored pins are kept.
+  PinSessionStore session_;
   std::unordered_map<uint64_t, PinEntry> pins_;
   std::optional<Id64> focused_pin_id_;
 };
@@ -1,20 +1,138 @@
 #include "StatsService.h"
 
+#include <mutex>
+
 namespace snappin {
 
-void StatsService::SetOverlayShowMs(double ms) { overlay_show_ms_.store(ms); }
+void StatsService::RecordOverlayShowMicros(uint64_t us) { overlay_show_.RecordMicros(us); }
+
+void StatsService::RecordCaptureOnceMicros(uint64_t us) { capture_once_.RecordMicros(us); }
 
-void StatsService::SetCaptureOnceMs(double ms) { capture_once_ms_.store(ms); }
+void StatsService::RecordActionMicros(const std::string& action_id, uint64_t us) {
+  ActionHistogram(action_id)->RecordMicros(us);
+}
 
 void StatsService::SetWorkingSetBytes(uint64_t bytes) {
   working_set_bytes_.store(bytes);
 }
 
-StatsSnapshot StatsService::Snapshot() {
+void StatsService::SetPixelBufferPool(const PixelBufferPool* pool) {
+  pixel_pool_.store(pool);
+}
+
+void StatsService::SetArtifactStore(const ArtifactStore* store) {
+  artifact_store_.store(store);
+}
+
+void StatsService::SetGlyphCache(const GlyphCache* cache) {
+  glyph_cache_.store(cache);
+}
+
+void StatsService::SetScaledImageCache(const ScaledImageCache* cache) {
+  scaled_image_cache_.store(cache);
+}
+
+void StatsService::SetPinPixelStore(const PinPixelStore* store) {
+  pin_pixel_store_.store(store);
+}
+
+void StatsService::SetPixelDedupRegistry(const PixelDedupRegistry* registry) {
+  pixel_dedup_.store(registry);
+}
+
+void StatsService::SetCaptureHistory(const CaptureHistoryStore* history) {
+  capture_history_.store(history);
+}
+
+StatsSnapshot StatsService::Snapshot() { return Collect(false); }
+
+StatsSnapshot StatsService::SnapshotAndReset() { return Collect(true); }
+
+LatencyHistogram* StatsService::ActionHistogram(const std::string& action_id) {
+  {
+    std::shared_lock<std::shared_mutex> lock(actions_mu_);
+    auto it = actions_.find(action_id);
+    if (it != actions_.end()) {
+      return it->second.get();
+    }
+  }
+  std::unique_lock<std::shared_mutex> lock(actions_mu_);
+  auto& slot = actions_[action_id];
+  if (!slot) {
+    slot = std::make_unique<LatencyHistogram>();
+  }
+  return slot.get();
+}
+
+StatsSnapshot StatsService::Collect(bool reset) {
+  auto take = [reset](LatencyHistogram& hist) {
+    return reset ? hist.SnapshotAndReset() : hist.Summary();
+  };
+
   StatsSnapshot snap;
-  snap.overlay_show_ms_p95 = overlay_show_ms_.load();
-  snap.capture_once_ms_p95 = capture_once_ms_.load();
+  snap.overlay_show = take(overlay_show_);
+  snap.capture_once = take(capture_once_);
+  snap.overlay_show_ms_p95 = snap.overlay_show.p95_ms;
+  snap.capture_once_ms_p95 = snap.capture_once.p95_ms;
+  {
+    std::shared_lock<std::shared_mutex> lock(actions_mu_);
+    snap.actions.reserve(actions_.size());
+    for (auto& [id, hist] : actions_) {
+      LatencySummary summary = take(*hist);
+      if (summary.count > 0) {
+        snap.actions.push_back({id, summary});
+      }
+    }
+  }
   snap.working_set_bytes = working_set_bytes_.load();
+  if (const PixelBufferPool* pool = pixel_pool_.load()) {
+    const PixelBufferPoolStats pool_stats = pool->Stats();
+    snap.pixel_pool_hits = pool_stats.hits;
+    snap.pixel_pool_misses = pool_stats.misses;
+    snap.pixel_pool_idle_bytes = pool_stats.pooled_bytes;
+  }
+  if (const ArtifactStore* store = artifact_store_.load()) {
+    const ArtifactStoreStats store_stats = store->Stats();
+    snap.artifact_count = store_stats.count;
+    snap.artifact_resident_bytes = store_stats.resident_bytes;
+    snap.artifact_budget_bytes = store_stats.budget_bytes;
+    snap.artifact_evictions = store_stats.evictions;
+  }
+  if (const GlyphCache* glyphs = glyph_cache_.load()) {
+    const GlyphCacheStats glyph_stats = glyphs->Stats();
+    snap.glyph_cache_hits = glyph_stats.glyph_hits;
+    snap.glyph_cache_misses = glyph_stats.glyph_misses;
+    snap.glyph_cache_bytes = glyph_stats.bytes;
+    snap.text_layout_hits = glyph_stats.layout_hits;
+    snap.text_layout_misses = glyph_stats.layout_misses;
+  }
+  if (const ScaledImageCache* scaled = scaled_image_cache_.load()) {
+    const ScaledImageCacheStats scaled_stats = scaled->Stats();
+    snap.pin_scale_cache_hits = scaled_stats.hits;
+    snap.pin_scale_cache_misses = scaled_stats.misses;
+    snap.pin_scale_cache_bytes = scaled_stats.bytes;
+  }
+  if (const PinPixelStore* pins = pin_pixel_store_.load()) {
+    const PinPixelStoreStats pin_stats = pins->Stats();
+    snap.pins_compressed = pin_stats.compressed_pins;
+    snap.pin_pixels_uncompressed_bytes = pin_stats.uncompressed_bytes;
+    snap.pin_pixels_compressed_bytes = pin_stats.compressed_bytes;
+    snap.pin_pixels_compressed_source_bytes = pin_stats.compressed_source_bytes;
+    snap.pin_pixels_display_bytes = pin_stats.display_bytes;
+  }
+  if (const PixelDedupRegistry* dedup = pixel_dedup_.load()) {
+    const PixelDedupStats dedup_stats = dedup->Stats();
+    snap.pixel_dedup_hits = dedup_stats.hits;
+    snap.pixel_dedup_shared_bytes = dedup_stats.shared_bytes;
+    snap.pixel_dedup_collisions = dedup_stats.collisions;
+  }
+  if (const CaptureHistoryStore* history = capture_history_.load()) {
+    const CaptureHistoryStats history_stats = history->Stats();
+    snap.history_entries = history_stats.entries;
+    snap.history_disk_bytes = history_stats.disk_bytes;
+    snap.history_thumbnail_bytes = history_stats.thumbnail_bytes;
+    snap.history_pending = history_stats.pending;
+  }
   return snap;
 }
 
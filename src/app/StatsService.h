@@ -1,24 +1,71 @@
 #pragma once
+#include "ArtifactStore.h"
+#include "CaptureHistoryStore.h"
+#include "GlyphCache.h"
+#include "LatencyHistogram.h"
+#include "PinPixelStore.h"
+#include "PixelBufferPool.h"
+#include "PixelDedupRegistry.h"
+#include "ScaledImageCache.h"
 #include "Stats.h"
 
 #include <atomic>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
 
 namespace snappin {
 
+// Recording methods are safe from any thread. Latencies go into lock-free
+// histograms; the per-action table only locks (shared) to find the histogram
+// and exclusively the first time an action id is seen.
 class StatsService final : public IStatsService {
 public:
   StatsService() = default;
 
-  void SetOverlayShowMs(double ms);
-  void SetCaptureOnceMs(double ms);
+  void RecordOverlayShowMicros(uint64_t us);
+  void RecordCaptureOnceMicros(uint64_t us);
+  void RecordActionMicros(const std::string& action_id, uint64_t us);
   void SetWorkingSetBytes(uint64_t bytes);
+  // Pool whose hit/miss counters are reported in snapshots; may be null.
+  void SetPixelBufferPool(const PixelBufferPool* pool);
+  // Store whose resident/budget bytes are reported in snapshots; may be null.
+  void SetArtifactStore(const ArtifactStore* store);
+  // Glyph cache whose hit/miss counters are reported in snapshots; may be null.
+  void SetGlyphCache(const GlyphCache* cache);
+  // Pin zoom cache whose hit/miss counters are reported in snapshots; may be null.
+  void SetScaledImageCache(const ScaledImageCache* cache);
+  // Pin pixel store whose compressed/uncompressed bytes are reported in
+  // snapshots; may be null.
+  void SetPinPixelStore(const PinPixelStore* store);
+  // Pixel dedup registry whose hits and shared bytes are reported in
+  // snapshots; may be null.
+  void SetPixelDedupRegistry(const PixelDedupRegistry* registry);
+  // Capture history whose entries and disk bytes are reported in snapshots;
+  // may be null.
+  void SetCaptureHistory(const CaptureHistoryStore* history);
 
   StatsSnapshot Snapshot() override;
+  StatsSnapshot SnapshotAndReset() override;
 
 private:
-  std::atomic<double> overlay_show_ms_{0.0};
-  std::atomic<double> capture_once_ms_{0.0};
+  LatencyHistogram* ActionHistogram(const std::string& action_id);
+  StatsSnapshot Collect(bool reset);
+
+  LatencyHistogram overlay_show_;
+  LatencyHistogram capture_once_;
+  std::shared_mutex actions_mu_;
+  // Entries are never erased, so histogram pointers stay valid.
+  std::map<std::string, std::unique_ptr<LatencyHistogram>> actions_;
   std::atomic<uint64_t> working_set_bytes_{0};
+  std::atomic<const PixelBufferPool*> pixel_pool_{nullptr};
+  std::atomic<const ArtifactStore*> artifact_store_{nullptr};
+  std::atomic<const GlyphCache*> glyph_cache_{nullptr};
+  std::atomic<const ScaledImageCache*> scaled_image_cache_{nullptr};
+  std::atomic<const PinPixelStore*> pin_pixel_store_{nullptr};
+  std::atomic<const PixelDedupRegistry*> pixel_dedup_{nullptr};
+  std::atomic<const CaptureHistoryStore*> capture_history_{nullptr};
 };
 
 } // namespace snappin
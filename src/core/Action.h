@@ -1,9 +1,11 @@
 #pragma once
 #include "Types.h"
 
+#include <cstdint>
 #include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -49,6 +51,24 @@ struct ActionInvoke {
   std::vector<std::pair<std::string, std::string>> kv;
 };
 
+// Compact id assigned when an action is registered; indexes the registry's
+// descriptors and the dispatcher's handler table.
+struct ActionHandle {
+  uint32_t value = UINT32_MAX;
+  bool valid() const { return value != UINT32_MAX; }
+};
+
+// One dispatch of a registered action, passed to its handler.
+struct ActionCall {
+  const ActionInvoke& req;
+  ActionHandle handle;
+  Id64 correlation_id;
+  // Set by handlers that finish later and report their own Succeeded/Failed.
+  bool deferred = false;
+};
+
+using ActionHandler = std::function<Result<void>(ActionCall& call)>;
+
 struct ActionEvent {
   std::string action_id;
   Id64 correlation_id;
@@ -62,8 +82,14 @@ struct ActionEvent {
 class IActionRegistry {
 public:
   virtual ~IActionRegistry() = default;
-  virtual std::vector<ActionDescriptor> ListAll() = 0;
-  virtual std::optional<ActionDescriptor> Find(const std::string& id) = 0;
+  // Descriptors in registration order; index i has handle {i}.
+  virtual const std::vector<ActionDescriptor>& ListAll() const = 0;
+  // Invalid handle when `id` is not registered.
+  virtual ActionHandle Lookup(std::string_view id) const = 0;
+  // Null for an invalid or unknown handle.
+  virtual const ActionDescriptor* Find(ActionHandle handle) const = 0;
+
+  const ActionDescriptor* Find(std::string_view id) const { return Find(Lookup(id)); }
 };
 
 class IActionDispatcher {
@@ -0,0 +1,358 @@
+#include "ActionEventBus.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+// Shared by every bus, so a version number identifies one list for good.
+std::atomic<uint64_t> g_next_version{1};
+
+uint64_t HashActionId(const std::string& id) {
+  uint64_t h = 14695981039346656037ull;  // FNV-1a
+  for (const char c : id) {
+    h = (h ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+  }
+  return h;
+}
+
+// The lists this thread emitted to last, one slot per bus in use.
+struct CachedList {
+  const void* bus = nullptr;
+  uint64_t version = 0;
+  std::shared_ptr<const void> list;
+};
+constexpr size_t kCachedLists = 4;
+thread_local CachedList t_lists[kCachedLists];
+thread_local size_t t_next_slot = 0;
+// Only the outermost Emit on a thread uses the cache: a callback that
+// emits again must not replace the list its caller is walking.
+thread_local int t_emit_depth = 0;
+
+struct EmitDepth {
+  EmitDepth() { ++t_emit_depth; }
+  ~EmitDepth() { --t_emit_depth; }
+};
+
+} // namespace
+
+// Bounded multi-producer, single-consumer ring (Vyukov's sequence-numbered
+// cells) drained by its own thread. The thread parks on an atomic wait
+// while the ring is empty; producers only notify when it says it is parked.
+class ActionEventBus::AsyncQueue {
+public:
+  AsyncQueue(size_t capacity, Callback cb)
+      : mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+        cells_(std::make_unique<Cell[]>(mask_ + 1)),
+        cb_(std::move(cb)) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    thread_ = std::thread([this] { Run(); });
+  }
+  ~AsyncQueue() { Stop(); }
+
+  // False when the ring is full; the event is dropped.
+  bool Push(const ActionEvent& ev) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->ev = ev;
+    // Sequentially consistent with the consumer's park check in Run: either
+    // it sees this cell or we see it parked.
+    cell->seq.store(pos + 1, std::memory_order_seq_cst);
+    if (parked_.load(std::memory_order_seq_cst)) {
+      Wake();
+    }
+    return true;
+  }
+
+  // Delivers what is queued, then joins. Events pushed meanwhile may be lost.
+  void Stop() {
+    if (!thread_.joinable()) {
+      return;
+    }
+    stopping_.store(true);
+    Wake();
+    thread_.join();
+  }
+
+  size_t pending() const {
+    return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+  }
+  uint64_t delivered() const { return delivered_.load(std::memory_order_relaxed); }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq{0};
+    ActionEvent ev{};
+  };
+
+  bool Ready(std::memory_order order = std::memory_order_acquire) const {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    return cells_[tail & mask_].seq.load(order) == tail + 1;
+  }
+
+  void Wake() {
+    signal_.fetch_add(1);
+    signal_.notify_one();
+  }
+
+  void Run() {
+    ActionEvent ev{};
+    for (;;) {
+      while (Ready()) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[tail & mask_];
+        ev = std::move(cell.ev);
+        cell.seq.store(tail + mask_ + 1, std::memory_order_release);
+        tail_.store(tail + 1, std::memory_order_relaxed);
+        try {
+          cb_(ev);
+        } catch (...) {
+        }
+        delivered_.fetch_add(1, std::memory_order_relaxed);
+      }
+      if (stopping_.load()) {
+        return;
+      }
+      const uint32_t seen = signal_.load();
+      parked_.store(true, std::memory_order_seq_cst);
+      if (!Ready(std::memory_order_seq_cst) && !stopping_.load()) {
+        signal_.wait(seen);
+      }
+      parked_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  Callback cb_;
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};  // written by the consumer only
+  std::atomic<uint64_t> delivered_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<bool> parked_{false};
+  std::atomic<bool> stopping_{false};
+  std::atomic<uint32_t> signal_{0};
+  std::thread thread_;
+};
+
+ActionEventFilter ActionEventFilter::ForAction(std::string action_id) {
+  ActionEventFilter filter;
+  filter.action_id = std::move(action_id);
+  return filter;
+}
+
+ActionEventFilter ActionEventFilter::ForTypes(std::initializer_list<ActionEvent::Type> types) {
+  ActionEventFilter filter;
+  filter.types = 0;
+  for (const ActionEvent::Type type : types) {
+    filter.types |= Bit(type);
+  }
+  return filter;
+}
+
+bool ActionEventFilter::Matches(const ActionEvent& ev) const {
+  return (types & Bit(ev.type)) != 0 && (action_id.empty() || action_id == ev.action_id);
+}
+
+ActionEventBus::~ActionEventBus() {
+  std::shared_ptr<const List> list;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    list = std::move(list_);
+    version_.store(0, std::memory_order_release);
+  }
+  if (list) {
+    for (const Subscriber& sub : *list) {
+      if (sub.queue) {
+        sub.queue->Stop();
+      }
+    }
+  }
+}
+
+ActionEventBus::SubscriptionId ActionEventBus::Subscribe(Callback cb, ActionEventFilter filter,
+                                                         EventDelivery delivery,
+                                                         size_t queue_capacity) {
+  if (!cb) {
+    return 0;
+  }
+  Subscriber sub;
+  sub.action_hash = HashActionId(filter.action_id);
+  sub.filter = std::move(filter);
+  if (delivery == EventDelivery::Async) {
+    sub.queue = std::make_shared<AsyncQueue>(queue_capacity, std::move(cb));
+  } else {
+    sub.cb = std::move(cb);
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  sub.id = next_id_++;
+  auto next = std::make_shared<List>();
+  if (list_) {
+    next->reserve(list_->size() + 1);
+    next->insert(next->end(), list_->begin(), list_->end());
+  }
+  next->push_back(std::move(sub));
+  const SubscriptionId id = next->back().id;
+  PublishLocked(std::move(next));
+  return id;
+}
+
+bool ActionEventBus::Unsubscribe(SubscriptionId id) {
+  std::shared_ptr<AsyncQueue> queue;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!list_) {
+      return false;
+    }
+    auto next = std::make_shared<List>();
+    next->reserve(list_->size());
+    bool found = false;
+    for (const Subscriber& sub : *list_) {
+      if (sub.id == id) {
+        found = true;
+        queue = sub.queue;
+      } else {
+        next->push_back(sub);
+      }
+    }
+    if (!found) {
+      return false;
+    }
+    PublishLocked(std::move(next));
+  }
+  // Joined outside the lock: its callback may subscribe or emit.
+  if (queue) {
+    queue->Stop();
+  }
+  return true;
+}
+
+void ActionEventBus::Emit(const ActionEvent& ev) const {
+  const uint64_t version = version_.load(std::memory_order_acquire);
+  if (version == 0) {
+    return;
+  }
+  if (t_emit_depth > 0) {
+    uint64_t unused = 0;
+    const std::shared_ptr<const List> list = Snapshot(&unused);
+    if (list) {
+      const EmitDepth depth;
+      Deliver(*list, ev);
+    }
+    return;
+  }
+
+  CachedList* slot = nullptr;
+  for (CachedList& cached : t_lists) {
+    if (cached.version == version) {
+      slot = &cached;
+      break;
+    }
+  }
+  if (!slot) {
+    for (CachedList& cached : t_lists) {
+      if (cached.bus == this) {
+        slot = &cached;
+        break;
+      }
+    }
+    if (!slot) {
+      slot = &t_lists[t_next_slot++ % kCachedLists];
+    }
+    uint64_t current = 0;
+    std::shared_ptr<const List> list = Snapshot(&current);
+    slot->bus = this;
+    slot->version = current;
+    slot->list = std::move(list);
+    if (!slot->list) {
+      return;
+    }
+  }
+  // Exceptions from sync callbacks reach the emitter.
+  const EmitDepth depth;
+  Deliver(*static_cast<const List*>(slot->list.get()), ev);
+}
+
+void ActionEventBus::Deliver(const List& list, const ActionEvent& ev) const {
+  const uint8_t bit = ActionEventFilter::Bit(ev.type);
+  uint64_t hash = 0;
+  bool hashed = false;
+  for (const Subscriber& sub : list) {
+    if ((sub.filter.types & bit) == 0) {
+      continue;
+    }
+    if (!sub.filter.action_id.empty()) {
+      if (!hashed) {
+        hash = HashActionId(ev.action_id);
+        hashed = true;
+      }
+      if (sub.action_hash != hash || sub.filter.action_id != ev.action_id) {
+        continue;
+      }
+    }
+    if (sub.queue) {
+      sub.queue->Push(ev);
+    } else {
+      sub.cb(ev);
+    }
+  }
+}
+
+size_t ActionEventBus::subscriber_count() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return list_ ? list_->size() : 0;
+}
+
+ActionEventBusStats ActionEventBus::Stats() const {
+  uint64_t version = 0;
+  const std::shared_ptr<const List> list = Snapshot(&version);
+  ActionEventBusStats stats;
+  if (!list) {
+    return stats;
+  }
+  stats.subscribers = list->size();
+  for (const Subscriber& sub : *list) {
+    if (sub.queue) {
+      ++stats.async_subscribers;
+      stats.async_pending += sub.queue->pending();
+      stats.async_delivered += sub.queue->delivered();
+      stats.async_dropped += sub.queue->dropped();
+    }
+  }
+  return stats;
+}
+
+void ActionEventBus::PublishLocked(std::shared_ptr<const List> list) {
+  list_ = std::move(list);
+  version_.store(g_next_version.fetch_add(1), std::memory_order_release);
+}
+
+std::shared_ptr<const ActionEventBus::List> ActionEventBus::Snapshot(uint64_t* version) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  *version = version_.load(std::memory_order_relaxed);
+  return list_;
+}
+
+} // namespace snappin
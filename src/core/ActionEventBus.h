@@ -0,0 +1,110 @@
+#pragma once
+#include "Action.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace snappin {
+
+// Which events a subscriber receives.
+struct ActionEventFilter {
+  static constexpr uint8_t kAllTypes = 0x0F;
+  static constexpr uint8_t Bit(ActionEvent::Type type) {
+    return static_cast<uint8_t>(1u << static_cast<unsigned>(type));
+  }
+
+  std::string action_id;      // empty: every action
+  uint8_t types = kAllTypes;  // Bit() per ActionEvent::Type
+
+  static ActionEventFilter ForAction(std::string action_id);
+  static ActionEventFilter ForTypes(std::initializer_list<ActionEvent::Type> types);
+  bool Matches(const ActionEvent& ev) const;
+};
+
+enum class EventDelivery : uint8_t {
+  Sync,  // on the emitting thread, before Emit returns
+  // On the subscription's own thread, through a bounded queue; events that
+  // find the queue full are dropped and counted, so emitters never wait.
+  Async,
+};
+
+struct ActionEventBusStats {
+  size_t subscribers = 0;
+  size_t async_subscribers = 0;
+  size_t async_pending = 0;
+  uint64_t async_delivered = 0;
+  uint64_t async_dropped = 0;  // queue full
+};
+
+// Publishes ActionEvents to subscribers without locking on the emit path.
+//
+// The subscriber list is immutable once published: Subscribe and
+// Unsubscribe copy it, change the copy and publish it under a new version
+// number (unique across all buses). Each emitting thread keeps the last
+// list it saw per bus, so Emit is one atomic load of the version and, while
+// the list is unchanged, touches no shared writable memory. A thread that
+// sees a new version takes the lock once to pick the list up. Old lists are
+// freed once no thread holds them any more, so a removed callback may still
+// be kept alive (not called) by an idle thread's copy.
+//
+// Filters are checked before anything is called or queued. Async
+// subscribers each get a bounded multi-producer queue and a delivery thread
+// that sleeps while the queue is empty. Thread-safe.
+class ActionEventBus {
+public:
+  using Callback = std::function<void(const ActionEvent&)>;
+  using SubscriptionId = uint64_t;
+  static constexpr size_t kDefaultQueueCapacity = 256;
+
+  ActionEventBus() = default;
+  // Stops async subscribers after they deliver what they have queued.
+  ~ActionEventBus();
+  ActionEventBus(const ActionEventBus&) = delete;
+  ActionEventBus& operator=(const ActionEventBus&) = delete;
+
+  // Returns the subscription's id, or 0 for an empty callback. The queue
+  // capacity (Async only) is rounded up to a power of two.
+  SubscriptionId Subscribe(Callback cb, ActionEventFilter filter = {},
+                           EventDelivery delivery = EventDelivery::Sync,
+                           size_t queue_capacity = kDefaultQueueCapacity);
+  // False for an unknown id. An async subscription delivers what it has
+  // queued before this returns; a sync callback may still be running on a
+  // thread that was emitting concurrently.
+  bool Unsubscribe(SubscriptionId id);
+
+  void Emit(const ActionEvent& ev) const;
+
+  size_t subscriber_count() const;
+  ActionEventBusStats Stats() const;
+
+private:
+  class AsyncQueue;
+  struct Subscriber {
+    SubscriptionId id = 0;
+    ActionEventFilter filter;
+    uint64_t action_hash = 0;  // of filter.action_id, checked before the string
+    Callback cb;
+    std::shared_ptr<AsyncQueue> queue;  // null for Sync
+  };
+  using List = std::vector<Subscriber>;
+
+  // Caller holds mu_.
+  void PublishLocked(std::shared_ptr<const List> list);
+  // The current list and its version, read together under mu_.
+  std::shared_ptr<const List> Snapshot(uint64_t* version) const;
+  void Deliver(const List& list, const ActionEvent& ev) const;
+
+  mutable std::mutex mu_;
+  std::shared_ptr<const List> list_;   // guarded by mu_
+  SubscriptionId next_id_ = 1;         // guarded by mu_
+  std::atomic<uint64_t> version_{0};   // 0 until the first Subscribe
+};
+
+} // namespace snappin
@@ -0,0 +1,77 @@
+#include "ActionTable.h"
+
+#include <utility>
+
+namespace snappin {
+
+ActionHandle ActionTable::Add(ActionDescriptor desc) {
+  if (desc.id.empty() || Lookup(desc.id).valid()) {
+    return ActionHandle{};
+  }
+  if ((actions_.size() + 1) * 2 > slots_.size()) {
+    Rehash(slots_.empty() ? 32 : slots_.size() * 2);
+  }
+  const uint32_t index = static_cast<uint32_t>(actions_.size());
+  const size_t mask = slots_.size() - 1;
+  size_t slot = Hash(desc.id) & mask;
+  while (slots_[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  slots_[slot] = index + 1;
+  actions_.push_back(std::move(desc));
+  return ActionHandle{index};
+}
+
+const std::vector<ActionDescriptor>& ActionTable::ListAll() const { return actions_; }
+
+ActionHandle ActionTable::Lookup(std::string_view id) const {
+  if (slots_.empty()) {
+    return ActionHandle{};
+  }
+  const size_t mask = slots_.size() - 1;
+  for (size_t slot = Hash(id) & mask; slots_[slot] != 0; slot = (slot + 1) & mask) {
+    const uint32_t index = slots_[slot] - 1;
+    if (actions_[index].id == id) {
+      return ActionHandle{index};
+    }
+  }
+  return ActionHandle{};
+}
+
+const ActionDescriptor* ActionTable::Find(ActionHandle handle) const {
+  return handle.value < actions_.size() ? &actions_[handle.value] : nullptr;
+}
+
+uint32_t ActionTable::Hash(std::string_view id) {
+  // FNV-1a; ids are short ASCII strings.
+  uint32_t h = 2166136261u;
+  for (char c : id) {
+    h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return h;
+}
+
+void ActionTable::Rehash(size_t slot_count) {
+  slots_.assign(slot_count, 0);
+  const size_t mask = slot_count - 1;
+  for (uint32_t index = 0; index < actions_.size(); ++index) {
+    size_t slot = Hash(actions_[index].id) & mask;
+    while (slots_[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = index + 1;
+  }
+}
+
+bool ActionHandlerTable::Set(ActionHandle handle, ActionHandler handler) {
+  if (!handle.valid()) {
+    return false;
+  }
+  if (handle.value >= handlers_.size()) {
+    handlers_.resize(static_cast<size_t>(handle.value) + 1);
+  }
+  handlers_[handle.value] = std::move(handler);
+  return true;
+}
+
+} // namespace snappin
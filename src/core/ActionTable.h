@@ -0,0 +1,50 @@
+#pragma once
+#include "Action.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace snappin {
+
+// IActionRegistry backed by a vector of descriptors and an open-addressing
+// hash index over their ids, so Lookup is O(1) in the number of actions and
+// never allocates. Add is meant for startup; it must not race with readers.
+class ActionTable : public IActionRegistry {
+public:
+  // Returns the new action's handle, or an invalid handle when the id is
+  // empty or already registered.
+  ActionHandle Add(ActionDescriptor desc);
+
+  const std::vector<ActionDescriptor>& ListAll() const override;
+  ActionHandle Lookup(std::string_view id) const override;
+  const ActionDescriptor* Find(ActionHandle handle) const override;
+  using IActionRegistry::Find;
+
+private:
+  static uint32_t Hash(std::string_view id);
+  void Rehash(size_t slot_count);
+
+  std::vector<ActionDescriptor> actions_;
+  // Handle value + 1 per slot, 0 when empty; at most half full.
+  std::vector<uint32_t> slots_;
+};
+
+// Handlers indexed by ActionHandle, filled in by each module at startup.
+class ActionHandlerTable {
+public:
+  // Replaces any handler already set for `handle`. False for an invalid handle.
+  bool Set(ActionHandle handle, ActionHandler handler);
+  // Null when nothing is registered for `handle`.
+  const ActionHandler* Get(ActionHandle handle) const {
+    if (handle.value >= handlers_.size() || !handlers_[handle.value]) {
+      return nullptr;
+    }
+    return &handlers_[handle.value];
+  }
+
+private:
+  std::vector<ActionHandler> handlers_;
+};
+
+} // namespace snappin
@@ -0,0 +1,170 @@
+#include "AnnotationHitIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+// Inclusive pixel bounds of a shape.
+void ShapeBounds(const HitShape& s, int64_t* x0, int64_t* y0, int64_t* x1, int64_t* y1) {
+  const int64_t r = s.kind == HitShape::Kind::Capsule ? std::max(0, s.radius) : 0;
+  *x0 = std::min<int64_t>(s.a.x, s.b.x) - r;
+  *y0 = std::min<int64_t>(s.a.y, s.b.y) - r;
+  *x1 = std::max<int64_t>(s.a.x, s.b.x) + r;
+  *y1 = std::max<int64_t>(s.a.y, s.b.y) + r;
+}
+
+int32_t CellIndex(int64_t v, int32_t count) {
+  return static_cast<int32_t>(
+      std::clamp<int64_t>(v / AnnotationHitIndex::kCellPx, 0, count - 1));
+}
+
+} // namespace
+
+bool HitShape::Contains(const PointPX& pt) const {
+  if (kind == Kind::Box) {
+    return pt.x >= std::min(a.x, b.x) && pt.x <= std::max(a.x, b.x) &&
+           pt.y >= std::min(a.y, b.y) && pt.y <= std::max(a.y, b.y);
+  }
+  const double vx = static_cast<double>(b.x) - a.x;
+  const double vy = static_cast<double>(b.y) - a.y;
+  const double wx = static_cast<double>(pt.x) - a.x;
+  const double wy = static_cast<double>(pt.y) - a.y;
+  const double len_sq = vx * vx + vy * vy;
+  double t = 0.0;
+  if (len_sq > 1e-6) {
+    t = std::clamp((wx * vx + wy * vy) / len_sq, 0.0, 1.0);
+  }
+  const double dx = wx - t * vx;
+  const double dy = wy - t * vy;
+  const double r = static_cast<double>(radius);
+  return dx * dx + dy * dy <= r * r;
+}
+
+void AnnotationHitIndex::Reset(const SizePX& canvas) {
+  Clear();
+  cols_ = std::max(1, (canvas.w + kCellPx - 1) / kCellPx);
+  rows_ = std::max(1, (canvas.h + kCellPx - 1) / kCellPx);
+  cells_.assign(static_cast<size_t>(cols_) * static_cast<size_t>(rows_), {});
+}
+
+void AnnotationHitIndex::Clear() {
+  for (auto& cell : cells_) {
+    cell.clear();
+  }
+  items_.clear();
+  free_handles_.clear();
+  order_.clear();
+}
+
+void AnnotationHitIndex::AddToCells(uint32_t handle) {
+  Item& item = items_[handle];
+  item.cells.clear();
+  if (cells_.empty()) {
+    return;
+  }
+  for (uint32_t s = 0; s < item.shapes.size(); ++s) {
+    int64_t x0, y0, x1, y1;
+    ShapeBounds(item.shapes[s], &x0, &y0, &x1, &y1);
+    const int32_t c0 = CellIndex(x0, cols_);
+    const int32_t c1 = CellIndex(x1, cols_);
+    const int32_t r0 = CellIndex(y0, rows_);
+    const int32_t r1 = CellIndex(y1, rows_);
+    for (int32_t row = r0; row <= r1; ++row) {
+      for (int32_t col = c0; col <= c1; ++col) {
+        const uint32_t c = CellAt(col, row);
+        std::vector<CellEntry>& cell = cells_[c];
+        // Entries of one item are appended back to back, so the cell is new
+        // to this item exactly when its last entry belongs to someone else.
+        if (cell.empty() || cell.back().item != handle) {
+          item.cells.push_back(c);
+        }
+        cell.push_back(CellEntry{handle, s});
+      }
+    }
+  }
+}
+
+void AnnotationHitIndex::RemoveFromCells(uint32_t handle) {
+  for (uint32_t c : items_[handle].cells) {
+    std::vector<CellEntry>& cell = cells_[c];
+    cell.erase(std::remove_if(cell.begin(), cell.end(),
+                              [handle](const CellEntry& e) { return e.item == handle; }),
+               cell.end());
+  }
+  items_[handle].cells.clear();
+}
+
+void AnnotationHitIndex::Insert(size_t pos, std::vector<HitShape> shapes) {
+  pos = std::min(pos, order_.size());
+  uint32_t handle = 0;
+  if (!free_handles_.empty()) {
+    handle = free_handles_.back();
+    free_handles_.pop_back();
+  } else {
+    handle = static_cast<uint32_t>(items_.size());
+    items_.emplace_back();
+  }
+  items_[handle].shapes = std::move(shapes);
+  order_.insert(order_.begin() + static_cast<std::ptrdiff_t>(pos), handle);
+  for (size_t i = pos; i < order_.size(); ++i) {
+    items_[order_[i]].pos = i;
+  }
+  AddToCells(handle);
+}
+
+void AnnotationHitIndex::Erase(size_t pos) {
+  if (pos >= order_.size()) {
+    return;
+  }
+  const uint32_t handle = order_[pos];
+  RemoveFromCells(handle);
+  items_[handle].shapes.clear();
+  free_handles_.push_back(handle);
+  order_.erase(order_.begin() + static_cast<std::ptrdiff_t>(pos));
+  for (size_t i = pos; i < order_.size(); ++i) {
+    items_[order_[i]].pos = i;
+  }
+}
+
+void AnnotationHitIndex::Update(size_t pos, std::vector<HitShape> shapes) {
+  if (pos >= order_.size()) {
+    return;
+  }
+  const uint32_t handle = order_[pos];
+  RemoveFromCells(handle);
+  items_[handle].shapes = std::move(shapes);
+  AddToCells(handle);
+}
+
+void AnnotationHitIndex::HitsAt(const PointPX& pt, std::vector<size_t>* out) const {
+  out->clear();
+  if (cells_.empty()) {
+    return;
+  }
+  const std::vector<CellEntry>& cell = cells_[CellAt(CellIndex(pt.x, cols_),
+                                                     CellIndex(pt.y, rows_))];
+  for (const CellEntry& e : cell) {
+    const Item& item = items_[e.item];
+    // Skip further shapes of an item that already hit.
+    if (!out->empty() && out->back() == item.pos) {
+      continue;
+    }
+    if (item.shapes[e.shape].Contains(pt)) {
+      out->push_back(item.pos);
+    }
+  }
+  std::sort(out->begin(), out->end(), [](size_t a, size_t b) { return a > b; });
+  out->erase(std::unique(out->begin(), out->end()), out->end());
+}
+
+size_t AnnotationHitIndex::cell_refs() const {
+  size_t refs = 0;
+  for (const auto& cell : cells_) {
+    refs += cell.size();
+  }
+  return refs;
+}
+
+} // namespace snappin
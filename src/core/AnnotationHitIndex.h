@@ -0,0 +1,83 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snappin {
+
+// Region of an item that counts as a hit, in canvas pixels.
+struct HitShape {
+  enum class Kind : uint8_t {
+    Box,     // a = top-left, b = bottom-right, both inclusive
+    Capsule, // points within `radius` of segment a-b
+  };
+  Kind kind = Kind::Box;
+  PointPX a{};
+  PointPX b{};
+  int32_t radius = 0;
+
+  bool Contains(const PointPX& pt) const;
+};
+
+// Hit-test index over an ordered list of items (annotations), each made of
+// any number of HitShapes. Items are addressed by position; a higher position
+// is drawn later and so is on top. Shapes are bucketed into a uniform grid of
+// kCellPx cells over the canvas, so a query only tests the shapes of one cell
+// instead of every segment of every stroke. Insert/Erase/Update touch only
+// the cells of the item involved (plus an O(n) integer shift of positions,
+// matching the vector insert the caller does anyway). Not thread-safe.
+class AnnotationHitIndex {
+public:
+  static constexpr int32_t kCellPx = 64;
+
+  AnnotationHitIndex() = default;
+
+  // Empties the index and sizes the grid for a canvas. Shapes and queries
+  // outside the canvas are clamped to its border cells.
+  void Reset(const SizePX& canvas);
+  void Clear();
+
+  // Mirrors inserting an item at `pos` (0..size()).
+  void Insert(size_t pos, std::vector<HitShape> shapes);
+  // Mirrors erasing the item at `pos`.
+  void Erase(size_t pos);
+  // Replaces the shapes of the item at `pos` (after a move, resize or edit).
+  void Update(size_t pos, std::vector<HitShape> shapes);
+
+  // Positions of the items with a shape containing `pt`, topmost first.
+  void HitsAt(const PointPX& pt, std::vector<size_t>* out) const;
+
+  size_t size() const { return order_.size(); }
+  // Total shape references across cells; for tests and benchmarks.
+  size_t cell_refs() const;
+
+private:
+  struct CellEntry {
+    uint32_t item = 0;  // handle, stable while the item exists
+    uint32_t shape = 0; // index into the item's shapes
+  };
+
+  struct Item {
+    std::vector<HitShape> shapes;
+    std::vector<uint32_t> cells; // cells holding at least one of the shapes
+    size_t pos = 0;
+  };
+
+  uint32_t CellAt(int32_t col, int32_t row) const {
+    return static_cast<uint32_t>(row) * static_cast<uint32_t>(cols_) +
+           static_cast<uint32_t>(col);
+  }
+  void AddToCells(uint32_t handle);
+  void RemoveFromCells(uint32_t handle);
+
+  int32_t cols_ = 0;
+  int32_t rows_ = 0;
+  std::vector<std::vector<CellEntry>> cells_;
+  std::vector<Item> items_;           // by handle
+  std::vector<uint32_t> free_handles_;
+  std::vector<uint32_t> order_;       // position -> handle
+};
+
+} // namespace snappin
@@ -21,8 +21,9 @@ struct Artifact {
   ArtifactKind kind = ArtifactKind::CAPTURE;
 
   std::optional<GpuFrameHandle> base_gpu;
-  std::optional<CpuBitmap> base_cpu;
-  std::shared_ptr<std::vector<uint8_t>> base_cpu_storage;
+  // Shared, immutable pixels. Pins, the annotate session and export hold
+  // views of the same buffer rather than copies.
+  BitmapView base_cpu;
 
   RectPX screen_rect_px{};
   float dpi_scale = 1.0f;
@@ -33,9 +34,14 @@ struct Artifact {
 class IArtifactStore {
 public:
   virtual ~IArtifactStore() = default;
-  virtual std::optional<Artifact> Get(Id64 id) = 0;
-  virtual void Put(const Artifact& artifact) = 0;
+  // Null when unknown or evicted. The artifact never changes after Put().
+  virtual std::shared_ptr<const Artifact> Get(Id64 id) = 0;
+  // Stores (or replaces) the artifact under its id and makes it active.
+  virtual void Put(Artifact artifact) = 0;
   virtual void ClearActive() = 0;
+  // Artifacts with outstanding pin references are never evicted.
+  virtual void AddPinRef(Id64 id) = 0;
+  virtual void ReleasePinRef(Id64 id) = 0;
 };
 
 } // namespace snappin
@@ -0,0 +1,121 @@
+#include "ArtifactStore.h"
+
+#include <utility>
+
+namespace snappin {
+
+ArtifactStore::ArtifactStore(size_t budget_bytes) : budget_bytes_(budget_bytes) {}
+
+size_t ArtifactStore::ResidentBytes(const Artifact& artifact) {
+  return artifact.base_cpu.valid() ? artifact.base_cpu.span_bytes() : 0;
+}
+
+std::shared_ptr<const Artifact> ArtifactStore::Get(Id64 id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = items_.find(id.value);
+  if (it == items_.end()) {
+    return nullptr;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+  return it->second.artifact;
+}
+
+void ArtifactStore::Put(Artifact artifact) {
+  if (IPixelInterner* interner = interner_.load()) {
+    artifact.base_cpu = interner->Intern(std::move(artifact.base_cpu));
+  }
+  const uint64_t id = artifact.artifact_id.value;
+  const size_t bytes = ResidentBytes(artifact);
+  auto shared = std::make_shared<const Artifact>(std::move(artifact));
+  std::vector<std::shared_ptr<const Artifact>> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto [it, inserted] = items_.try_emplace(id);
+    Entry& entry = it->second;
+    if (inserted) {
+      lru_.push_front(id);
+      entry.lru_pos = lru_.begin();
+    } else {
+      resident_bytes_ -= entry.bytes;
+      dropped.push_back(std::move(entry.artifact));
+      lru_.splice(lru_.begin(), lru_, entry.lru_pos);
+    }
+    entry.artifact = std::move(shared);
+    entry.bytes = bytes;
+    resident_bytes_ += bytes;
+    active_id_ = Id64{id};
+    EvictLocked(&dropped);
+  }
+}
+
+void ArtifactStore::ClearActive() {
+  std::vector<std::shared_ptr<const Artifact>> dropped;
+  std::lock_guard<std::mutex> lock(mu_);
+  active_id_.reset();
+  EvictLocked(&dropped);
+}
+
+void ArtifactStore::AddPinRef(Id64 id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = items_.find(id.value);
+  if (it != items_.end()) {
+    ++it->second.pin_refs;
+  }
+}
+
+void ArtifactStore::ReleasePinRef(Id64 id) {
+  std::vector<std::shared_ptr<const Artifact>> dropped;
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = items_.find(id.value);
+  if (it != items_.end() && it->second.pin_refs > 0) {
+    --it->second.pin_refs;
+    EvictLocked(&dropped);
+  }
+}
+
+std::optional<Id64> ArtifactStore::ActiveId() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return active_id_;
+}
+
+Id64 ArtifactStore::NextId() {
+  return Id64{next_id_.fetch_add(1, std::memory_order_relaxed)};
+}
+
+void ArtifactStore::SetBudgetBytes(size_t bytes) {
+  std::vector<std::shared_ptr<const Artifact>> dropped;
+  std::lock_guard<std::mutex> lock(mu_);
+  budget_bytes_ = bytes;
+  EvictLocked(&dropped);
+}
+
+void ArtifactStore::SetPixelInterner(IPixelInterner* interner) { interner_.store(interner); }
+
+ArtifactStoreStats ArtifactStore::Stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  ArtifactStoreStats out;
+  out.count = items_.size();
+  out.resident_bytes = resident_bytes_;
+  out.budget_bytes = budget_bytes_;
+  out.evictions = evictions_;
+  return out;
+}
+
+void ArtifactStore::EvictLocked(std::vector<std::shared_ptr<const Artifact>>* dropped) {
+  auto pos = lru_.end();
+  while (resident_bytes_ > budget_bytes_ && pos != lru_.begin()) {
+    --pos;
+    auto it = items_.find(*pos);
+    const Entry& entry = it->second;
+    if (entry.pin_refs > 0 || (active_id_.has_value() && active_id_->value == *pos)) {
+      continue;
+    }
+    resident_bytes_ -= entry.bytes;
+    dropped->push_back(std::move(it->second.artifact));
+    items_.erase(it);
+    pos = lru_.erase(pos);
+    ++evictions_;
+  }
+}
+
+} // namespace snappin
@@ -0,0 +1,80 @@
+#pragma once
+#include "Artifact.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace snappin {
+
+struct ArtifactStoreStats {
+  uint64_t count = 0;
+  uint64_t resident_bytes = 0;
+  uint64_t budget_bytes = 0;
+  uint64_t evictions = 0;
+};
+
+// Thread-safe artifact store. Artifacts are immutable once stored and handed
+// out as shared_ptr<const Artifact>, so export/OCR workers read them without
+// copying or locking; editing means Put()ing a modified copy under the same id.
+// Resident bytes are the CPU pixel spans of the stored artifacts. When they
+// exceed the budget, the least recently used artifacts are dropped, except the
+// active one and those with outstanding pin references. Dropping only releases
+// the store's reference; holders of an artifact keep it alive.
+class ArtifactStore final : public IArtifactStore {
+public:
+  static constexpr size_t kDefaultBudgetBytes = size_t{128} << 20;
+
+  explicit ArtifactStore(size_t budget_bytes = kDefaultBudgetBytes);
+  ArtifactStore(const ArtifactStore&) = delete;
+  ArtifactStore& operator=(const ArtifactStore&) = delete;
+
+  std::shared_ptr<const Artifact> Get(Id64 id) override;
+  void Put(Artifact artifact) override;
+  void ClearActive() override;
+  void AddPinRef(Id64 id) override;
+  void ReleasePinRef(Id64 id) override;
+
+  std::optional<Id64> ActiveId() const;
+  Id64 NextId();
+
+  // Evicts at once when lowering the budget.
+  void SetBudgetBytes(size_t bytes);
+  // Put() passes pixels through `interner` (may be null), outside the lock,
+  // so identical captures share one buffer with each other and with pins.
+  void SetPixelInterner(IPixelInterner* interner);
+  ArtifactStoreStats Stats() const;
+
+  static size_t ResidentBytes(const Artifact& artifact);
+
+private:
+  struct Entry {
+    std::shared_ptr<const Artifact> artifact;
+    size_t bytes = 0;
+    int32_t pin_refs = 0;
+    std::list<uint64_t>::iterator lru_pos;
+  };
+
+  // Caller holds mu_. Moves dropped artifacts to *dropped so they are
+  // destroyed after the lock is released.
+  void EvictLocked(std::vector<std::shared_ptr<const Artifact>>* dropped);
+
+  mutable std::mutex mu_;
+  std::unordered_map<uint64_t, Entry> items_;
+  // Front = most recently used.
+  std::list<uint64_t> lru_;
+  std::optional<Id64> active_id_;
+  size_t budget_bytes_ = 0;
+  size_t resident_bytes_ = 0;
+  uint64_t evictions_ = 0;
+  std::atomic<uint64_t> next_id_{1};
+  std::atomic<IPixelInterner*> interner_{nullptr};
+};
+
+} // namespace snappin
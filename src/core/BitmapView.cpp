@@ -0,0 +1,97 @@
+#include "Types.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace snappin {
+
+BitmapView::BitmapView(std::shared_ptr<const uint8_t> origin, const SizePX& size_px,
+                       int32_t stride_bytes, PixelFormat format)
+    : size_px_(size_px), stride_bytes_(stride_bytes), format_(format) {
+  if (origin && size_px.w > 0 && size_px.h > 0 && stride_bytes >= size_px.w * 4) {
+    origin_ = std::move(origin);
+  } else {
+    size_px_ = {};
+    stride_bytes_ = 0;
+  }
+}
+
+BitmapView BitmapView::FromBuffer(std::shared_ptr<std::vector<uint8_t>> buffer,
+                                  const SizePX& size_px, int32_t stride_bytes,
+                                  PixelFormat format) {
+  if (!buffer || size_px.w <= 0 || size_px.h <= 0 || stride_bytes < size_px.w * 4) {
+    return BitmapView();
+  }
+  const size_t needed = static_cast<size_t>(stride_bytes) *
+                            static_cast<size_t>(size_px.h - 1) +
+                        static_cast<size_t>(size_px.w) * 4;
+  if (buffer->size() < needed) {
+    return BitmapView();
+  }
+  const uint8_t* origin = buffer->data();
+  return BitmapView(std::shared_ptr<const uint8_t>(std::move(buffer), origin), size_px,
+                    stride_bytes, format);
+}
+
+BitmapView BitmapView::CopyFrom(const CpuBitmap& bitmap) {
+  if (!bitmap.data.p || bitmap.size_px.w <= 0 || bitmap.size_px.h <= 0 ||
+      bitmap.stride_bytes < bitmap.size_px.w * 4) {
+    return BitmapView();
+  }
+  const int32_t stride = bitmap.size_px.w * 4;
+  auto buffer = std::make_shared<std::vector<uint8_t>>(
+      static_cast<size_t>(stride) * static_cast<size_t>(bitmap.size_px.h));
+  const uint8_t* src = static_cast<const uint8_t*>(bitmap.data.p);
+  for (int32_t y = 0; y < bitmap.size_px.h; ++y) {
+    std::memcpy(buffer->data() + static_cast<size_t>(y) * stride,
+                src + static_cast<size_t>(y) * static_cast<size_t>(bitmap.stride_bytes),
+                static_cast<size_t>(stride));
+  }
+  return FromBuffer(std::move(buffer), bitmap.size_px, stride, bitmap.format);
+}
+
+size_t BitmapView::span_bytes() const {
+  if (!valid()) {
+    return 0;
+  }
+  return static_cast<size_t>(stride_bytes_) * static_cast<size_t>(size_px_.h - 1) +
+         static_cast<size_t>(size_px_.w) * 4;
+}
+
+BitmapView BitmapView::Crop(const RectPX& rect) const {
+  if (!valid()) {
+    return BitmapView();
+  }
+  const int64_t left = std::max<int64_t>(rect.x, 0);
+  const int64_t top = std::max<int64_t>(rect.y, 0);
+  const int64_t right =
+      std::min<int64_t>(static_cast<int64_t>(rect.x) + rect.w, size_px_.w);
+  const int64_t bottom =
+      std::min<int64_t>(static_cast<int64_t>(rect.y) + rect.h, size_px_.h);
+  if (right <= left || bottom <= top) {
+    return BitmapView();
+  }
+  const uint8_t* origin = row(static_cast<int32_t>(top)) + static_cast<size_t>(left) * 4;
+  return BitmapView(std::shared_ptr<const uint8_t>(origin_, origin),
+                    SizePX{static_cast<int32_t>(right - left),
+                           static_cast<int32_t>(bottom - top)},
+                    stride_bytes_, format_);
+}
+
+BitmapView BitmapView::Clone() const { return CopyFrom(AsCpuBitmap()); }
+
+CpuBitmap BitmapView::AsCpuBitmap() const {
+  CpuBitmap bmp;
+  bmp.format = format_;
+  bmp.size_px = size_px_;
+  bmp.stride_bytes = stride_bytes_;
+  bmp.data.p = const_cast<uint8_t*>(origin_.get());
+  return bmp;
+}
+
+bool BitmapView::SharesBufferWith(const BitmapView& other) const {
+  return valid() && other.valid() && !origin_.owner_before(other.origin_) &&
+         !other.origin_.owner_before(origin_);
+}
+
+} // namespace snappin
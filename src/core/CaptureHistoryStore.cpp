@@ -0,0 +1,704 @@
+#include "CaptureHistoryStore.h"
+
+#include "Crc32.h"
+#include "MappedFile.h"
+#include "PixelBufferPool.h"
+#include "PixelCodec.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+constexpr uint32_t kSegmentMagic = 0x53485053u; // "SPHS"
+constexpr uint32_t kRecordMagic = 0x52485053u;  // "SPHR"
+constexpr uint32_t kVersion = 1;
+constexpr uint64_t kSegmentHeaderBytes = 32;
+constexpr uint64_t kRecordHeaderBytes = 96;
+
+void StoreLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+  }
+}
+
+void StoreLe64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; ++i) {
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+  }
+}
+
+uint32_t LoadLe32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; --i) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+uint64_t LoadLe64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; --i) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+uint64_t Padded(uint64_t n) { return (n + 7) & ~uint64_t{7}; }
+
+uint64_t PixelBytes(const SizePX& size) {
+  return uint64_t{4} * static_cast<uint32_t>(size.w) * static_cast<uint32_t>(size.h);
+}
+
+uint64_t NowUnixMs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count());
+}
+
+std::filesystem::path SegmentPath(const std::filesystem::path& dir, uint64_t number) {
+  char name[32] = {};
+  std::snprintf(name, sizeof(name), "capture-%016llx.hist",
+                static_cast<unsigned long long>(number));
+  return dir / name;
+}
+
+// The number in a segment file name, or false for any other file.
+bool ParseSegmentName(const std::filesystem::path& path, uint64_t* number) {
+  const std::string name = path.filename().string();
+  constexpr size_t kDigits = 16;
+  const std::string prefix = "capture-";
+  const std::string suffix = ".hist";
+  if (name.size() != prefix.size() + kDigits + suffix.size() ||
+      name.compare(0, prefix.size(), prefix) != 0 ||
+      name.compare(prefix.size() + kDigits, suffix.size(), suffix) != 0) {
+    return false;
+  }
+  uint64_t value = 0;
+  for (size_t i = prefix.size(); i < prefix.size() + kDigits; ++i) {
+    const char c = name[i];
+    uint64_t digit = 0;
+    if (c >= '0' && c <= '9') {
+      digit = static_cast<uint64_t>(c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      digit = static_cast<uint64_t>(c - 'a' + 10);
+    } else {
+      return false;
+    }
+    value = (value << 4) | digit;
+  }
+  *number = value;
+  return true;
+}
+
+SizePX ThumbnailSize(const SizePX& full) {
+  const int32_t edge = CaptureHistoryStore::kThumbnailEdgePx;
+  if (full.w <= edge && full.h <= edge) {
+    return full;
+  }
+  SizePX size;
+  if (full.w >= full.h) {
+    size.w = edge;
+    size.h = static_cast<int32_t>((int64_t{full.h} * edge + full.w / 2) / full.w);
+  } else {
+    size.h = edge;
+    size.w = static_cast<int32_t>((int64_t{full.w} * edge + full.h / 2) / full.h);
+  }
+  size.w = std::max(size.w, 1);
+  size.h = std::max(size.h, 1);
+  return size;
+}
+
+BitmapView PooledBitmap(const SizePX& size, PixelFormat format, CpuBitmap* target) {
+  std::shared_ptr<uint8_t> pixels;
+  int32_t stride = 0;
+  if (!AcquirePixelBuffer(PixelBufferPool::Shared(), size, &pixels, &stride)) {
+    return BitmapView{};
+  }
+  target->format = format;
+  target->size_px = size;
+  target->stride_bytes = stride;
+  target->data.p = pixels.get();
+  return BitmapView(std::move(pixels), size, stride, format);
+}
+
+// Halves while the image is at least twice the thumbnail, then resamples, so
+// the Lanczos pass stays short. Runs on the writer thread, so its strips queue
+// behind interactive work.
+BitmapView MakeThumbnail(const BitmapView& full) {
+  const SizePX size = ThumbnailSize(full.size_px());
+  BitmapView level = full;
+  while (level.size_px().w / 2 >= size.w && level.size_px().h / 2 >= size.h) {
+    const SizePX half{(level.size_px().w + 1) / 2, (level.size_px().h + 1) / 2};
+    CpuBitmap target;
+    BitmapView next = PooledBitmap(half, full.format(), &target);
+    if (!next.valid() || !DownsampleHalf(level.AsCpuBitmap(), &target, PixelKernelIsa::Auto,
+                                           TaskPriority::Background)) {
+      return BitmapView{};
+    }
+    level = std::move(next);
+  }
+  if (level.size_px().w == size.w && level.size_px().h == size.h) {
+    return level.SharesBufferWith(full) ? ClonePooled(PixelBufferPool::Shared(), full) : level;
+  }
+  CpuBitmap target;
+  BitmapView thumbnail = PooledBitmap(size, full.format(), &target);
+  if (!thumbnail.valid() || !ResizeLanczos(level.AsCpuBitmap(), &target, PixelKernelIsa::Auto,
+                                              TaskPriority::Background)) {
+    return BitmapView{};
+  }
+  return thumbnail;
+}
+
+uint32_t RowsCrc(const BitmapView& pixels) {
+  uint32_t crc = 0;
+  const size_t row_bytes = static_cast<size_t>(pixels.size_px().w) * 4;
+  for (int32_t y = 0; y < pixels.size_px().h; ++y) {
+    crc = UpdateCrc32(crc, pixels.row(y), row_bytes);
+  }
+  return crc;
+}
+
+} // namespace
+
+CaptureHistoryStore::CaptureHistoryStore() = default;
+
+CaptureHistoryStore::~CaptureHistoryStore() { Close(); }
+
+bool CaptureHistoryStore::Open(const std::filesystem::path& dir, uint64_t max_bytes,
+                               uint64_t segment_bytes) {
+  Close();
+  if (max_bytes == 0) {
+    return false;
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  std::vector<std::pair<uint64_t, std::filesystem::path>> found;
+  std::filesystem::directory_iterator it(dir, ec);
+  if (ec) {
+    return false;
+  }
+  for (const auto& item : it) {
+    uint64_t number = 0;
+    std::error_code type_ec;
+    if (item.is_regular_file(type_ec) && ParseSegmentName(item.path(), &number)) {
+      found.emplace_back(number, item.path());
+    }
+  }
+  std::sort(found.begin(), found.end());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  dir_ = dir;
+  max_bytes_ = max_bytes;
+  segment_bytes_ = std::max<uint64_t>(1, std::min(segment_bytes, max_bytes / 4));
+  stats_ = CaptureHistoryStats{};
+  next_seq_ = 1;
+  for (const auto& [number, path] : found) {
+    auto segment = std::make_shared<Segment>();
+    segment->number = number;
+    segment->path = path;
+    if (ScanSegment(segment)) {
+      segments_.push_back(std::move(segment));
+    }
+  }
+  if (!index_.empty()) {
+    next_seq_ = index_.back().info.seq + 1;
+  }
+  if (!segments_.empty() && segments_.back()->bytes < segment_bytes_) {
+    active_ = segments_.back();
+  } else {
+    active_ = CreateSegment(segments_.empty() ? 1 : segments_.back()->number + 1);
+    if (!active_) {
+      CloseLocked();
+      return false;
+    }
+    segments_.push_back(active_);
+  }
+  // The limit may have been lowered since the last run.
+  for (const auto& victim : EvictLocked()) {
+    victim->file.reset();
+    std::filesystem::remove(victim->path, ec);
+  }
+  open_ = true;
+  stopping_ = false;
+  write_failed_ = false;
+  writer_ = std::thread([this] { WriterLoop(); });
+  return true;
+}
+
+void CaptureHistoryStore::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) {
+      return;
+    }
+    stopping_ = true;
+  }
+  queue_cv_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseLocked();
+}
+
+bool CaptureHistoryStore::is_open() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return open_;
+}
+
+uint64_t CaptureHistoryStore::Append(const Artifact& artifact) {
+  const BitmapView& pixels = artifact.base_cpu;
+  if (!pixels.valid() || pixels.size_px().w <= 0 || pixels.size_px().h <= 0) {
+    return 0;
+  }
+  Entry entry;
+  entry.info.artifact_id = artifact.artifact_id;
+  entry.info.captured_at_ms = NowUnixMs();
+  entry.info.screen_rect_px = artifact.screen_rect_px;
+  entry.info.dpi_scale = artifact.dpi_scale;
+  entry.info.size_px = pixels.size_px();
+  entry.info.format = pixels.format();
+  entry.info.pending = true;
+  entry.pixels = pixels;
+  uint64_t seq = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || stopping_) {
+      return 0;
+    }
+    seq = next_seq_++;
+    entry.info.seq = seq;
+    queue_.push_back(Op{entry.info, pixels});
+    index_.push_back(std::move(entry));
+  }
+  queue_cv_.notify_one();
+  return seq;
+}
+
+size_t CaptureHistoryStore::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.size();
+}
+
+bool CaptureHistoryStore::Find(uint64_t seq, CaptureHistoryEntry* out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Entry* entry = const_cast<CaptureHistoryStore*>(this)->FindLocked(seq);
+  if (!entry) {
+    return false;
+  }
+  *out = entry->info;
+  return true;
+}
+
+bool CaptureHistoryStore::NthNewest(size_t n, CaptureHistoryEntry* out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (n >= index_.size()) {
+    return false;
+  }
+  *out = index_[index_.size() - 1 - n].info;
+  return true;
+}
+
+std::vector<CaptureHistoryEntry> CaptureHistoryStore::Recent(size_t count) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<CaptureHistoryEntry> out;
+  out.reserve(std::min(count, index_.size()));
+  for (auto it = index_.rbegin(); it != index_.rend() && out.size() < count; ++it) {
+    out.push_back(it->info);
+  }
+  return out;
+}
+
+BitmapView CaptureHistoryStore::Load(uint64_t seq) {
+  std::shared_ptr<Segment> segment;
+  uint64_t offset = 0;
+  uint64_t bytes = 0;
+  uint32_t crc = 0;
+  bool verified = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry* entry = FindLocked(seq);
+    if (!entry) {
+      return BitmapView{};
+    }
+    ++stats_.loads;
+    if (!entry->segment) {
+      return entry->pixels;
+    }
+    segment = entry->segment;
+    offset = entry->packed_offset;
+    bytes = entry->packed_bytes;
+    crc = entry->packed_crc;
+    verified = entry->verified;
+  }
+
+  // Decoded from the mapping; the store lock is free meanwhile, and the
+  // writer only waits when it appends to this very segment.
+  BitmapView pixels;
+  bool corrupt = false;
+  {
+    std::lock_guard<std::mutex> file_lock(segment->mu);
+    const uint8_t* base = segment->file ? segment->file->Map(offset + bytes) : nullptr;
+    if (!base) {
+      return BitmapView{}; // evicted meanwhile
+    }
+    const uint8_t* packed = base + offset;
+    if (!verified && UpdateCrc32(0, packed, static_cast<size_t>(bytes)) != crc) {
+      corrupt = true;
+    } else {
+      pixels = DecompressPixels(packed, static_cast<size_t>(bytes));
+      corrupt = !pixels.valid();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (corrupt) {
+    ++stats_.corrupt_records;
+    EraseLocked(seq);
+  } else if (Entry* entry = FindLocked(seq)) {
+    entry->verified = true;
+  }
+  return pixels;
+}
+
+bool CaptureHistoryStore::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this] { return queue_.empty() && !writing_; });
+  return open_ && !write_failed_;
+}
+
+CaptureHistoryStats CaptureHistoryStore::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CaptureHistoryStats stats = stats_;
+  stats.entries = index_.size();
+  stats.segments = segments_.size();
+  for (const auto& segment : segments_) {
+    stats.disk_bytes += segment->bytes;
+  }
+  for (const Entry& entry : index_) {
+    if (entry.info.thumbnail.valid()) {
+      stats.thumbnail_bytes += PixelBytes(entry.info.thumbnail.size_px());
+    }
+  }
+  stats.pending = queue_.size() + (writing_ ? 1 : 0);
+  return stats;
+}
+
+void CaptureHistoryStore::WriterLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      break; // stopping, and everything accepted is written
+    }
+    Op op = std::move(queue_.front());
+    queue_.pop_front();
+    writing_ = true;
+    lock.unlock();
+
+    Entry written;
+    const bool ok = WriteRecord(op, &written);
+
+    lock.lock();
+    write_failed_ = write_failed_ || !ok;
+    if (Entry* entry = FindLocked(op.info.seq)) {
+      if (ok) {
+        entry->info.stored_bytes = written.info.stored_bytes;
+        entry->info.thumbnail = std::move(written.info.thumbnail);
+        entry->info.pending = false;
+        entry->segment = written.segment;
+        entry->packed_offset = written.packed_offset;
+        entry->packed_bytes = written.packed_bytes;
+        entry->packed_crc = written.packed_crc;
+        entry->verified = true;
+        entry->pixels = BitmapView{};
+      } else {
+        EraseLocked(op.info.seq);
+      }
+    }
+    if (ok) {
+      ++stats_.records_written;
+      written.segment->bytes += written.info.stored_bytes;
+    } else {
+      ++stats_.write_failures;
+    }
+    std::vector<std::shared_ptr<Segment>> victims = EvictLocked();
+    const bool drained = queue_.empty();
+    lock.unlock();
+
+    std::error_code ec;
+    for (const auto& victim : victims) {
+      {
+        std::lock_guard<std::mutex> file_lock(victim->mu);
+        victim->file.reset();
+      }
+      std::filesystem::remove(victim->path, ec);
+    }
+    bool synced = true;
+    if (drained) {
+      std::lock_guard<std::mutex> file_lock(active_->mu);
+      synced = active_->file && active_->file->Sync();
+    }
+
+    lock.lock();
+    write_failed_ = write_failed_ || !synced;
+    writing_ = false;
+    idle_cv_.notify_all();
+  }
+}
+
+bool CaptureHistoryStore::WriteRecord(const Op& op, Entry* written) {
+  // Thumbnail and compression run without any lock.
+  const BitmapView thumbnail = MakeThumbnail(op.pixels);
+  std::vector<uint8_t> packed;
+  if (!thumbnail.valid() || !CompressPixels(op.pixels, &packed)) {
+    return false;
+  }
+  const SizePX thumb_size = thumbnail.size_px();
+  const uint64_t thumb_bytes = PixelBytes(thumb_size);
+  const uint64_t payload_bytes = thumb_bytes + packed.size();
+  const uint64_t record_bytes = kRecordHeaderBytes + Padded(payload_bytes);
+
+  std::vector<uint8_t> record(static_cast<size_t>(record_bytes), 0);
+  uint8_t* h = record.data();
+  const CaptureHistoryEntry& info = op.info;
+  StoreLe32(h, kRecordMagic);
+  h[4] = info.format == PixelFormat::BGRA8 ? 1 : 0;
+  StoreLe64(h + 8, info.seq);
+  StoreLe64(h + 16, info.artifact_id.value);
+  StoreLe64(h + 24, info.captured_at_ms);
+  StoreLe32(h + 32, static_cast<uint32_t>(info.screen_rect_px.x));
+  StoreLe32(h + 36, static_cast<uint32_t>(info.screen_rect_px.y));
+  StoreLe32(h + 40, static_cast<uint32_t>(info.screen_rect_px.w));
+  StoreLe32(h + 44, static_cast<uint32_t>(info.screen_rect_px.h));
+  StoreLe32(h + 48, std::bit_cast<uint32_t>(info.dpi_scale));
+  StoreLe32(h + 52, static_cast<uint32_t>(info.size_px.w));
+  StoreLe32(h + 56, static_cast<uint32_t>(info.size_px.h));
+  StoreLe32(h + 60, static_cast<uint32_t>(thumb_size.w));
+  StoreLe32(h + 64, static_cast<uint32_t>(thumb_size.h));
+  StoreLe32(h + 68, RowsCrc(thumbnail));
+  StoreLe64(h + 72, packed.size());
+  StoreLe32(h + 80, UpdateCrc32(0, packed.data(), packed.size()));
+  StoreLe32(h + 92, UpdateCrc32(0, h, 92));
+  uint8_t* payload = h + kRecordHeaderBytes;
+  const size_t thumb_row = static_cast<size_t>(thumb_size.w) * 4;
+  for (int32_t y = 0; y < thumb_size.h; ++y) {
+    std::memcpy(payload + static_cast<size_t>(y) * thumb_row, thumbnail.row(y), thumb_row);
+  }
+  std::memcpy(payload + thumb_bytes, packed.data(), packed.size());
+
+  // Start a new segment rather than let this one outgrow the segment size
+  // (a single record larger than that gets a segment of its own).
+  if (active_->bytes > kSegmentHeaderBytes &&
+      active_->bytes + record_bytes > segment_bytes_) {
+    std::shared_ptr<Segment> next = CreateSegment(active_->number + 1);
+    if (!next) {
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> file_lock(active_->mu);
+      if (active_->file) {
+        active_->file->Sync();
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_.push_back(next);
+    active_ = std::move(next);
+  }
+
+  uint64_t offset = 0;
+  {
+    std::lock_guard<std::mutex> file_lock(active_->mu);
+    MappedFile* file = active_->file.get();
+    if (!file) {
+      return false;
+    }
+    offset = file->size();
+    if (!file->Append(record.data(), record.size())) {
+      // Cut the partial record so later appends stay reachable.
+      file->Truncate(offset);
+      return false;
+    }
+  }
+  written->info.stored_bytes = record_bytes;
+  written->info.thumbnail = thumbnail;
+  written->segment = active_;
+  written->packed_offset = offset + kRecordHeaderBytes + thumb_bytes;
+  written->packed_bytes = packed.size();
+  written->packed_crc = LoadLe32(h + 80);
+  return true;
+}
+
+std::shared_ptr<CaptureHistoryStore::Segment> CaptureHistoryStore::CreateSegment(
+    uint64_t number) {
+  auto segment = std::make_shared<Segment>();
+  segment->number = number;
+  segment->path = SegmentPath(dir_, number);
+  segment->file = std::make_unique<MappedFile>();
+  uint8_t header[kSegmentHeaderBytes] = {};
+  StoreLe32(header, kSegmentMagic);
+  StoreLe32(header + 4, kVersion);
+  StoreLe64(header + 8, number);
+  StoreLe32(header + 28, UpdateCrc32(0, header, 28));
+  if (!segment->file->Open(segment->path) || !segment->file->Truncate(0) ||
+      !segment->file->Append(header, sizeof(header))) {
+    return nullptr;
+  }
+  segment->bytes = kSegmentHeaderBytes;
+  return segment;
+}
+
+bool CaptureHistoryStore::ScanSegment(const std::shared_ptr<Segment>& segment) {
+  std::error_code ec;
+  segment->file = std::make_unique<MappedFile>();
+  MappedFile* file = segment->file.get();
+  if (!file->Open(segment->path)) {
+    return false;
+  }
+  const uint64_t size = file->size();
+  const uint8_t* base = size >= kSegmentHeaderBytes ? file->Map(size) : nullptr;
+  if (!base || LoadLe32(base) != kSegmentMagic || LoadLe32(base + 4) != kVersion ||
+      LoadLe64(base + 8) != segment->number || LoadLe32(base + 28) != UpdateCrc32(0, base, 28)) {
+    // Torn while being created, or not ours: nothing in it can be trusted.
+    stats_.torn_bytes += size;
+    segment->file.reset();
+    std::filesystem::remove(segment->path, ec);
+    return false;
+  }
+
+  uint64_t off = kSegmentHeaderBytes;
+  while (off + kRecordHeaderBytes <= size) {
+    const uint8_t* h = base + off;
+    if (LoadLe32(h) != kRecordMagic || LoadLe32(h + 92) != UpdateCrc32(0, h, 92) || h[4] > 1) {
+      break;
+    }
+    Entry entry;
+    CaptureHistoryEntry& info = entry.info;
+    info.seq = LoadLe64(h + 8);
+    info.artifact_id.value = LoadLe64(h + 16);
+    info.captured_at_ms = LoadLe64(h + 24);
+    info.screen_rect_px.x = static_cast<int32_t>(LoadLe32(h + 32));
+    info.screen_rect_px.y = static_cast<int32_t>(LoadLe32(h + 36));
+    info.screen_rect_px.w = static_cast<int32_t>(LoadLe32(h + 40));
+    info.screen_rect_px.h = static_cast<int32_t>(LoadLe32(h + 44));
+    info.dpi_scale = std::bit_cast<float>(LoadLe32(h + 48));
+    info.size_px.w = static_cast<int32_t>(LoadLe32(h + 52));
+    info.size_px.h = static_cast<int32_t>(LoadLe32(h + 56));
+    info.format = h[4] == 1 ? PixelFormat::BGRA8 : PixelFormat::RGBA8;
+    const SizePX thumb_size{static_cast<int32_t>(LoadLe32(h + 60)),
+                            static_cast<int32_t>(LoadLe32(h + 64))};
+    const uint64_t packed_bytes = LoadLe64(h + 72);
+    if (info.size_px.w <= 0 || info.size_px.h <= 0 || thumb_size.w <= 0 ||
+        thumb_size.h <= 0 || thumb_size.w > kThumbnailEdgePx ||
+        thumb_size.h > kThumbnailEdgePx || packed_bytes > size ||
+        (!index_.empty() && info.seq <= index_.back().info.seq)) {
+      break;
+    }
+    const uint64_t thumb_bytes = PixelBytes(thumb_size);
+    const uint64_t record_bytes = kRecordHeaderBytes + Padded(thumb_bytes + packed_bytes);
+    if (record_bytes > size - off) {
+      break;
+    }
+    const uint8_t* payload = h + kRecordHeaderBytes;
+    if (UpdateCrc32(0, payload, static_cast<size_t>(thumb_bytes)) != LoadLe32(h + 68)) {
+      break;
+    }
+    // Copied out: the mapping moves as the segment grows.
+    CpuBitmap target;
+    info.thumbnail = PooledBitmap(thumb_size, info.format, &target);
+    if (!info.thumbnail.valid()) {
+      break;
+    }
+    auto* rows = static_cast<uint8_t*>(target.data.p);
+    const size_t thumb_row = static_cast<size_t>(thumb_size.w) * 4;
+    for (int32_t y = 0; y < thumb_size.h; ++y) {
+      std::memcpy(rows + static_cast<size_t>(y) * static_cast<size_t>(target.stride_bytes),
+                  payload + static_cast<size_t>(y) * thumb_row, thumb_row);
+    }
+    info.stored_bytes = record_bytes;
+    entry.segment = segment;
+    entry.packed_offset = off + kRecordHeaderBytes + thumb_bytes;
+    entry.packed_bytes = packed_bytes;
+    entry.packed_crc = LoadLe32(h + 80);
+    index_.push_back(std::move(entry));
+    off += record_bytes;
+  }
+  if (off < size) {
+    stats_.torn_bytes += size - off;
+    if (!file->Truncate(off) || !file->Sync()) {
+      return false;
+    }
+  }
+  segment->bytes = off;
+  return true;
+}
+
+CaptureHistoryStore::Entry* CaptureHistoryStore::FindLocked(uint64_t seq) {
+  if (index_.empty() || seq < index_.front().info.seq) {
+    return nullptr;
+  }
+  // Seqs are dense unless a write failed or a record was corrupt.
+  const uint64_t slot = seq - index_.front().info.seq;
+  if (slot < index_.size() && index_[static_cast<size_t>(slot)].info.seq == seq) {
+    return &index_[static_cast<size_t>(slot)];
+  }
+  auto it = std::lower_bound(index_.begin(), index_.end(), seq,
+                             [](const Entry& e, uint64_t s) { return e.info.seq < s; });
+  return it != index_.end() && it->info.seq == seq ? &*it : nullptr;
+}
+
+void CaptureHistoryStore::EraseLocked(uint64_t seq) {
+  auto it = std::lower_bound(index_.begin(), index_.end(), seq,
+                             [](const Entry& e, uint64_t s) { return e.info.seq < s; });
+  if (it != index_.end() && it->info.seq == seq) {
+    index_.erase(it);
+  }
+}
+
+std::vector<std::shared_ptr<CaptureHistoryStore::Segment>> CaptureHistoryStore::EvictLocked() {
+  std::vector<std::shared_ptr<Segment>> victims;
+  uint64_t total = 0;
+  for (const auto& segment : segments_) {
+    total += segment->bytes;
+  }
+  // The segment being written is never evicted.
+  while (total > max_bytes_ && segments_.size() > 1) {
+    std::shared_ptr<Segment> victim = std::move(segments_.front());
+    segments_.pop_front();
+    while (!index_.empty() && index_.front().segment == victim) {
+      index_.pop_front();
+      ++stats_.evicted_entries;
+    }
+    total -= victim->bytes;
+    ++stats_.evicted_segments;
+    victims.push_back(std::move(victim));
+  }
+  return victims;
+}
+
+void CaptureHistoryStore::CloseLocked() {
+  for (const auto& segment : segments_) {
+    std::lock_guard<std::mutex> file_lock(segment->mu);
+    if (segment->file) {
+      segment->file->Sync();
+      segment->file.reset();
+    }
+  }
+  segments_.clear();
+  active_.reset();
+  index_.clear();
+  queue_.clear();
+  open_ = false;
+  stopping_ = false;
+}
+
+} // namespace snappin
@@ -0,0 +1,168 @@
+#pragma once
+#include "Artifact.h"
+#include "Types.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace snappin {
+
+class MappedFile;
+
+// One capture in the history, as kept in the in-memory index.
+struct CaptureHistoryEntry {
+  uint64_t seq = 0;             // increasing across sessions; never reused
+  Id64 artifact_id{};
+  uint64_t captured_at_ms = 0;  // Unix epoch
+  RectPX screen_rect_px{};
+  float dpi_scale = 1.0f;
+  SizePX size_px{};
+  PixelFormat format = PixelFormat::BGRA8;
+  uint64_t stored_bytes = 0;    // record size on disk; 0 while pending
+  bool pending = false;         // queued, not yet compressed and written
+  // At most kThumbnailEdgePx on its longer side; empty while pending.
+  BitmapView thumbnail;
+};
+
+struct CaptureHistoryStats {
+  uint64_t entries = 0;
+  uint64_t segments = 0;
+  uint64_t disk_bytes = 0;
+  uint64_t thumbnail_bytes = 0;  // resident thumbnail pixels
+  uint64_t records_written = 0;
+  uint64_t write_failures = 0;
+  uint64_t evicted_entries = 0;
+  uint64_t evicted_segments = 0;
+  uint64_t torn_bytes = 0;       // cut from segment tails by the last Open
+  uint64_t corrupt_records = 0;  // pixel payloads failing their checksum on load
+  uint64_t loads = 0;
+  size_t pending = 0;
+};
+
+// Captures of past sessions in a directory of append-only segment files,
+// with a compact index (metadata and a thumbnail per capture) in memory.
+//
+// Layout (little-endian throughout): segments are named
+// capture-<16 hex digits>.hist after their number and start with a 32-byte
+// header (magic, version, number, header CRC-32). Records follow, each a
+// 96-byte header (magic, format, seq, artifact id, capture time, screen
+// rect, dpi, size, thumbnail size, CRC-32s of thumbnail and pixels, and of
+// the header itself), the raw thumbnail rows, and the PixelCodec blob,
+// padded to 8 bytes.
+//
+// Append() puts the capture in the index at once, holding its pixels, and
+// queues it; a background thread makes the thumbnail, compresses the
+// pixels, appends the record to the newest segment and then lets go of the
+// pixels. A segment is closed once it reaches the segment size, and whole
+// segments are deleted, oldest first, while the total exceeds max_bytes, so
+// the history uses at most max_bytes plus the segment being written.
+//
+// Open scans every segment, keeps the longest prefix of each whose headers
+// and thumbnails check out and truncates the rest. Pixel payloads are not
+// read until Load(), which decodes straight from a mapping of the segment
+// and verifies the checksum on first use. Find() and NthNewest() are O(1).
+// Thread-safe.
+class CaptureHistoryStore {
+public:
+  static constexpr uint64_t kDefaultSegmentBytes = uint64_t{64} << 20;
+  static constexpr int32_t kThumbnailEdgePx = 128;
+
+  CaptureHistoryStore();
+  ~CaptureHistoryStore();
+  CaptureHistoryStore(const CaptureHistoryStore&) = delete;
+  CaptureHistoryStore& operator=(const CaptureHistoryStore&) = delete;
+
+  // Opens (creating if needed) the directory and scans its segments,
+  // deleting the oldest ones beyond max_bytes. The segment size is capped at
+  // a quarter of max_bytes. False when max_bytes is 0 or the directory or a
+  // new segment cannot be created; damaged segments are not an error.
+  bool Open(const std::filesystem::path& dir, uint64_t max_bytes,
+            uint64_t segment_bytes = kDefaultSegmentBytes);
+  // Writes what is queued, syncs and closes.
+  void Close();
+  bool is_open() const;
+
+  // Queues the artifact's pixels with its id, rect and dpi, stamped with the
+  // current time. Returns its seq, or 0 when the store is not open or the
+  // artifact has no CPU pixels.
+  uint64_t Append(const Artifact& artifact);
+
+  size_t size() const;
+  bool Find(uint64_t seq, CaptureHistoryEntry* out) const;
+  // n = 0 is the newest capture.
+  bool NthNewest(size_t n, CaptureHistoryEntry* out) const;
+  // Up to `count` captures, newest first.
+  std::vector<CaptureHistoryEntry> Recent(size_t count) const;
+
+  // Decoded pixels in a PixelBufferPool buffer (the queued pixels while
+  // pending); empty when unknown, evicted or corrupt. A corrupt capture is
+  // dropped from the index.
+  BitmapView Load(uint64_t seq);
+
+  // Waits until everything queued is written and synced.
+  bool Flush();
+
+  CaptureHistoryStats Stats() const;
+
+private:
+  struct Segment {
+    uint64_t number = 0;
+    std::filesystem::path path;
+    uint64_t bytes = 0;  // guarded by the store's mutex_
+    // Guards file: the writer appends while readers map and decode.
+    std::mutex mu;
+    std::unique_ptr<MappedFile> file;
+  };
+  struct Entry {
+    CaptureHistoryEntry info;
+    std::shared_ptr<Segment> segment;  // null while pending
+    uint64_t packed_offset = 0;
+    uint64_t packed_bytes = 0;
+    uint32_t packed_crc = 0;
+    bool verified = false;
+    BitmapView pixels;  // held until written
+  };
+  struct Op {
+    CaptureHistoryEntry info;
+    BitmapView pixels;
+  };
+
+  void WriterLoop();
+  bool WriteRecord(const Op& op, Entry* written);
+  // Creates segment `number` holding just its header; null on failure.
+  std::shared_ptr<Segment> CreateSegment(uint64_t number);
+  bool ScanSegment(const std::shared_ptr<Segment>& segment);
+  // Callers hold mutex_.
+  Entry* FindLocked(uint64_t seq);
+  void EraseLocked(uint64_t seq);
+  std::vector<std::shared_ptr<Segment>> EvictLocked();
+  void CloseLocked();
+
+  mutable std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable idle_cv_;
+  std::filesystem::path dir_;
+  uint64_t max_bytes_ = 0;
+  uint64_t segment_bytes_ = kDefaultSegmentBytes;
+  std::deque<Entry> index_;  // ordered by seq
+  std::deque<std::shared_ptr<Segment>> segments_;  // oldest first
+  std::deque<Op> queue_;
+  uint64_t next_seq_ = 1;
+  bool open_ = false;
+  bool writing_ = false;
+  bool stopping_ = false;
+  bool write_failed_ = false;
+  CaptureHistoryStats stats_;
+  std::thread writer_;
+  // The segment appended to; only the writer thread (or Open) touches it.
+  std::shared_ptr<Segment> active_;
+};
+
+} // namespace snappin
@@ -0,0 +1,230 @@
+#include "ConfigSnapshot.h"
+
+#include <cmath>
+#include <utility>
+
+namespace snappin {
+
+bool BuildConfigSnapshot(std::string_view json, ConfigSnapshot* out, JsonParseError* err) {
+  JsonValue root;
+  if (!ParseJson(json, &root, err)) {
+    return false;
+  }
+  if (!root.is_object()) {
+    if (err) {
+      *err = JsonParseError{};
+      err->message = "config root is not an object";
+    }
+    return false;
+  }
+
+  ConfigSnapshot snap;
+  bool flag = false;
+  if (const JsonValue* capture = root.Find("capture")) {
+    if (capture->ReadBool("auto_copy_to_clipboard", &flag)) {
+      snap.capture_auto_copy_to_clipboard = flag;
+    }
+    if (capture->ReadBool("auto_show_toolbar", &flag)) {
+      snap.capture_auto_show_toolbar = flag;
+    }
+  }
+  if (const JsonValue* exp = root.Find("export")) {
+    exp->ReadString("save_dir", &snap.export_save_dir);
+    exp->ReadString("naming_pattern", &snap.export_naming_pattern);
+    exp->ReadString("png_preset", &snap.export_png_preset);
+    if (exp->ReadBool("open_folder_after_save", &flag)) {
+      snap.export_open_folder_after_save = flag;
+    }
+  }
+  if (const JsonValue* hotkeys = root.Find("hotkeys")) {
+    if (hotkeys->ReadBool("enabled", &flag)) {
+      snap.hotkeys_enabled = flag;
+    }
+    hotkeys->ReadString("conflict_policy", &snap.hotkeys_conflict_policy);
+  }
+  if (const JsonValue* annotate = root.Find("annotate")) {
+    double number = 0.0;
+    if (annotate->ReadNumber("pencil_tolerance_px", &number) && std::isfinite(number) &&
+        number >= 0.0) {
+      snap.annotate_pencil_tolerance_px = number;
+    }
+    if (annotate->ReadBool("pencil_smoothing", &flag)) {
+      snap.annotate_pencil_smoothing = flag;
+    }
+  }
+  if (const JsonValue* pin = root.Find("pin")) {
+    if (pin->ReadBool("restore_session", &flag)) {
+      snap.pin_restore_session = flag;
+    }
+  }
+  if (const JsonValue* debug = root.Find("debug")) {
+    if (debug->ReadBool("enabled", &flag)) {
+      snap.debug_enabled = flag;
+    }
+    if (debug->ReadBool("trace_enabled", &flag)) {
+      snap.debug_trace_enabled = flag;
+    }
+  }
+  if (const JsonValue* advanced = root.Find("advanced")) {
+    int value = 0;
+    if (advanced->ReadInt("pixel_pool_max_mb", &value) && value >= 0) {
+      snap.advanced_pixel_pool_max_mb = value;
+    }
+    if (advanced->ReadInt("max_cpu_bitmap_cache_mb", &value) && value >= 0) {
+      snap.advanced_max_cpu_bitmap_cache_mb = value;
+    }
+    if (advanced->ReadInt("pin_scale_cache_mb", &value) && value >= 0) {
+      snap.advanced_pin_scale_cache_mb = value;
+    }
+    if (advanced->ReadInt("pin_compress_idle_seconds", &value) && value >= 0) {
+      snap.advanced_pin_compress_idle_seconds = value;
+    }
+    if (advanced->ReadInt("history_max_mb", &value) && value >= 0) {
+      snap.advanced_history_max_mb = value;
+    }
+  }
+  *out = std::move(snap);
+  return true;
+}
+
+std::string_view DefaultConfigJson() {
+  return R"json({
+  "config_version": 1,
+  "app": {
+    "language": "auto",
+    "start_on_boot": false,
+    "single_instance": true,
+    "theme": "system"
+  },
+  "privacy": {
+    "allow_network_features": false,
+    "log_redaction_level": "strict",
+    "first_time_network_prompt_shown": false
+  },
+  "hotkeys": {
+    "enabled": true,
+    "conflict_policy": "warn"
+  },
+  "capture": {
+    "detect_mode_default": "elements",
+    "backend_prefer": "auto",
+    "include_cursor": false,
+    "overlay_min_rect_px": 5,
+    "overlay_show_hint": true,
+    "multi_monitor_behavior": "current_monitor",
+    "auto_copy_to_clipboard": true,
+    "auto_show_toolbar": true,
+    "copy_priority": "image"
+  },
+  "export": {
+    "default_format": "png",
+    "jpeg_quality_0_100": 90,
+    "webp_quality_0_100": 90,
+    "png_preset": "balanced",
+    "save_dir": "",
+    "naming_pattern": "SnapPin_{yyyyMMdd_HHmmss}_{rand4}",
+    "open_folder_after_save": false,
+    "clipboard_retry_ms": 200,
+    "clipboard_retry_count": 5
+  },
+  "annotate": {
+    "default_tool": "rect",
+    "stroke_width": 2.0,
+    "stroke_color": "#FF3B30",
+    "text_font": "Segoe UI",
+    "text_size": 16.0,
+    "pencil_tolerance_px": 1.0,
+    "pencil_smoothing": false,
+    "auto_save_temp": true,
+    "confirm_on_close_if_dirty": true
+  },
+  "pin": {
+    "always_on_top_default": true,
+    "opacity_step": 0.05,
+    "scale_step": 0.05,
+    "scale_step_fine": 0.01,
+    "min_opacity_0_1": 0.2,
+    "max_scale": 5.0,
+    "min_scale": 0.1,
+    "double_click_action": "none",
+    "lock_disables_annotate": true,
+    "clipboard_prefer": "image_first",
+    "from_clipboard_fail_toast": true,
+    "restore_session": true
+  },
+  "text_render": {
+    "enabled": true,
+    "font_family": "Segoe UI",
+    "font_size": 16.0,
+    "text_color": "#1E1E1E",
+    "bg_color": "#FFFFFF",
+    "padding_px": 12,
+    "line_spacing": 1.25,
+    "max_width_px": 720,
+    "max_height_px": 2000,
+    "trim_trailing_blank_lines": true,
+    "tab_to_spaces": 2,
+    "corner_radius_px": 10,
+    "shadow_enabled": false
+  },
+  "ocr": {
+    "enabled": true,
+    "engine": "system",
+    "auto_ocr_on_pin": false,
+    "language_hint": "",
+    "copy_fulltext_after_recognize": false,
+    "selection_mode": "rect",
+    "hover_highlight": true
+  },
+  "scroll": {
+    "enabled": true,
+    "max_frames": 300,
+    "downscale": 0.5,
+    "low_fps_hint": 10,
+    "match_fail_policy": "prompt",
+    "overlap_search_px": 200
+  },
+  "record": {
+    "enabled": true,
+    "container_default": "mp4",
+    "fps": 30,
+    "bitrate_kbps": 8000,
+    "countdown_seconds": 3,
+    "include_cursor": true,
+    "max_queue_frames": 60,
+    "drop_policy": "drop_oldest",
+    "output_dir": "",
+    "filename_pattern": "SnapPinRec_{yyyyMMdd_HHmmss}_{rand4}"
+  },
+  "history": {
+    "enabled": true,
+    "max_items": 50,
+    "max_total_mb": 500,
+    "keep_days": 0,
+    "thumb_max_edge_px": 320,
+    "thumb_cache_items": 20,
+    "auto_cleanup_on_start": true,
+    "index_file_name": "index.jsonl"
+  },
+  "advanced": {
+    "lazy_release_seconds": 10,
+    "memory_pressure_release": true,
+    "max_gpu_staging_mb": 256,
+    "max_cpu_bitmap_cache_mb": 128,
+    "pixel_pool_max_mb": 256,
+    "pin_scale_cache_mb": 64,
+    "pin_compress_idle_seconds": 30,
+    "history_max_mb": 512,
+    "ipc_channel": "named_pipe"
+  },
+  "debug": {
+    "enabled": false,
+    "show_stats_panel": false,
+    "log_level": "info",
+    "save_frames_for_diagnostics": false,
+    "trace_enabled": false
+  }
+})json";
+}
+
+} // namespace snappin
@@ -0,0 +1,49 @@
+#pragma once
+#include "Json.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace snappin {
+
+// Typed view of config.json, built once per load. Optional fields are unset
+// when the key is missing or has the wrong type, so callers apply their own
+// defaults; strings are empty in that case. Immutable after construction.
+struct ConfigSnapshot {
+  std::optional<bool> capture_auto_copy_to_clipboard;
+  std::optional<bool> capture_auto_show_toolbar;
+
+  std::string export_save_dir; // UTF-8
+  std::string export_naming_pattern;
+  std::string export_png_preset;
+  std::optional<bool> export_open_folder_after_save;
+
+  std::optional<bool> hotkeys_enabled;
+  std::string hotkeys_conflict_policy;
+
+  // Only finite, non-negative values are kept.
+  std::optional<double> annotate_pencil_tolerance_px;
+  std::optional<bool> annotate_pencil_smoothing;
+
+  std::optional<bool> pin_restore_session;
+
+  std::optional<bool> debug_enabled;
+  std::optional<bool> debug_trace_enabled;
+  // Only non-negative values are kept.
+  std::optional<int> advanced_pixel_pool_max_mb;
+  std::optional<int> advanced_max_cpu_bitmap_cache_mb;
+  std::optional<int> advanced_pin_scale_cache_mb;
+  std::optional<int> advanced_pin_compress_idle_seconds;
+  std::optional<int> advanced_history_max_mb;
+};
+
+// Parses `json` and extracts the known fields. Fails (with the parse position)
+// on malformed JSON or when the document is not an object.
+bool BuildConfigSnapshot(std::string_view json, ConfigSnapshot* out,
+                         JsonParseError* err = nullptr);
+
+// Contents written to config.json when none exists.
+std::string_view DefaultConfigJson();
+
+} // namespace snappin
@@ -0,0 +1,55 @@
+#include "Crc32.h"
+
+namespace snappin {
+namespace {
+
+struct CrcTables {
+  uint32_t t[8][256];
+};
+
+const CrcTables& Crc() {
+  static const CrcTables tables = [] {
+    CrcTables c{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t v = n;
+      for (int k = 0; k < 8; ++k) {
+        v = (v & 1) ? 0xEDB88320u ^ (v >> 1) : v >> 1;
+      }
+      c.t[0][n] = v;
+    }
+    for (uint32_t n = 0; n < 256; ++n) {
+      for (int k = 1; k < 8; ++k) {
+        c.t[k][n] = (c.t[k - 1][n] >> 8) ^ c.t[0][c.t[k - 1][n] & 0xFF];
+      }
+    }
+    return c;
+  }();
+  return tables;
+}
+
+uint32_t LoadLe32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace
+
+uint32_t UpdateCrc32(uint32_t crc, const uint8_t* p, size_t n) {
+  const auto& t = Crc().t;
+  crc = ~crc;
+  while (n >= 8) {
+    const uint32_t lo = LoadLe32(p) ^ crc;
+    const uint32_t hi = LoadLe32(p + 4);
+    crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^
+          t[4][lo >> 24] ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^
+          t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    p += 8;
+    n -= 8;
+  }
+  while (n-- > 0) {
+    crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+} // namespace snappin
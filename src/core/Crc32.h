@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace snappin {
+
+// CRC-32 with the zlib/PNG polynomial, slice-by-8. Pass the previous result
+// (0 to start) to checksum data in pieces.
+uint32_t UpdateCrc32(uint32_t crc, const uint8_t* p, size_t n);
+
+} // namespace snappin
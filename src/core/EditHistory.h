@@ -0,0 +1,217 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace snappin {
+
+struct EditHistoryStats {
+  uint64_t records = 0;   // records pushed (merged edits not counted)
+  uint64_t merged = 0;    // edits folded into the previous record
+  uint64_t evicted = 0;   // oldest records dropped to stay within limits
+  uint64_t undo_depth = 0;
+  uint64_t redo_depth = 0;
+  uint64_t bytes = 0;
+};
+
+// Undo/redo for an ordered list of items, stored as deltas instead of
+// snapshots. Every record names one slot and holds at most one item: an add
+// holds nothing until it is undone, a remove holds the removed item and a
+// replace holds the other version of the slot. Undo and redo swap that item
+// with the list, so pushing is O(1) and undo/redo moves a single item.
+//
+// The caller edits the list and then records the change. Records beyond the
+// byte budget or entry limit are dropped oldest first when pushing; the
+// newest record is always kept. `item_bytes` estimates the heap an item owns
+// beyond sizeof(T). Not thread-safe.
+template <typename T>
+class EditHistory {
+public:
+  static constexpr size_t kDefaultBudgetBytes = size_t{16} << 20;
+  static constexpr size_t kDefaultMaxEntries = 4096;
+
+  using ItemBytesFn = std::function<size_t(const T&)>;
+
+  explicit EditHistory(ItemBytesFn item_bytes = nullptr,
+                       size_t budget_bytes = kDefaultBudgetBytes,
+                       size_t max_entries = kDefaultMaxEntries)
+      : item_bytes_(std::move(item_bytes)),
+        budget_bytes_(budget_bytes),
+        max_entries_(max_entries == 0 ? 1 : max_entries) {}
+
+  void Clear() {
+    records_.clear();
+    cursor_ = 0;
+    bytes_ = 0;
+  }
+
+  // items[index] was just inserted. A later replace of the same slot with the
+  // same nonzero merge_key folds into this record (e.g. typing into a text
+  // box that was just placed), so one undo removes the finished item.
+  void RecordAdd(size_t index, uint64_t merge_key = 0) {
+    Push(Record{Kind::Add, index, std::nullopt, merge_key});
+  }
+
+  // `removed` was just erased from position `index`.
+  void RecordRemove(size_t index, T removed) {
+    Push(Record{Kind::Remove, index, std::move(removed), 0});
+  }
+
+  // items[index] was just changed from `before` (a move, resize or text
+  // edit). With a nonzero merge_key, consecutive changes of one slot with the
+  // same key collapse into a single undo step that keeps the oldest `before`.
+  void RecordReplace(size_t index, T before, uint64_t merge_key = 0) {
+    if (merge_key != 0 && cursor_ == records_.size() && cursor_ > 0) {
+      const Record& last = records_[cursor_ - 1];
+      if (last.kind != Kind::Remove && last.index == index && last.merge_key == merge_key) {
+        ++merged_;
+        return;
+      }
+    }
+    Push(Record{Kind::Replace, index, std::move(before), merge_key});
+  }
+
+  // Reverts the newest record. Returns the slot it touched, or nullopt if
+  // there is nothing to undo or the record does not fit `items`.
+  std::optional<size_t> Undo(std::vector<T>* items) {
+    if (cursor_ == 0) {
+      return std::nullopt;
+    }
+    Record& r = records_[cursor_ - 1];
+    if (!Apply(&r, items, /*forward=*/false)) {
+      return std::nullopt;
+    }
+    --cursor_;
+    return r.index;
+  }
+
+  std::optional<size_t> Redo(std::vector<T>* items) {
+    if (cursor_ == records_.size()) {
+      return std::nullopt;
+    }
+    Record& r = records_[cursor_];
+    if (!Apply(&r, items, /*forward=*/true)) {
+      return std::nullopt;
+    }
+    ++cursor_;
+    return r.index;
+  }
+
+  bool CanUndo() const { return cursor_ > 0; }
+  bool CanRedo() const { return cursor_ < records_.size(); }
+  // The slot the next Undo/Redo would touch, so callers can look at it first.
+  std::optional<size_t> UndoSlot() const {
+    return cursor_ > 0 ? std::optional<size_t>(records_[cursor_ - 1].index) : std::nullopt;
+  }
+  std::optional<size_t> RedoSlot() const {
+    return cursor_ < records_.size() ? std::optional<size_t>(records_[cursor_].index)
+                                     : std::nullopt;
+  }
+  size_t undo_depth() const { return cursor_; }
+  size_t redo_depth() const { return records_.size() - cursor_; }
+  size_t bytes() const { return bytes_; }
+
+  void SetLimits(size_t budget_bytes, size_t max_entries) {
+    budget_bytes_ = budget_bytes;
+    max_entries_ = max_entries == 0 ? 1 : max_entries;
+    Trim();
+  }
+
+  EditHistoryStats Stats() const {
+    EditHistoryStats s;
+    s.records = records_pushed_;
+    s.merged = merged_;
+    s.evicted = evicted_;
+    s.undo_depth = cursor_;
+    s.redo_depth = records_.size() - cursor_;
+    s.bytes = bytes_;
+    return s;
+  }
+
+private:
+  enum class Kind : uint8_t { Add, Remove, Replace };
+
+  struct Record {
+    Kind kind = Kind::Add;
+    size_t index = 0;
+    std::optional<T> item; // what the slot does not currently hold
+    uint64_t merge_key = 0;
+  };
+
+  size_t RecordBytes(const Record& r) const {
+    size_t bytes = sizeof(Record);
+    if (r.item && item_bytes_) {
+      bytes += item_bytes_(*r.item);
+    }
+    return bytes;
+  }
+
+  void Push(Record record) {
+    // A new edit discards the redo branch.
+    while (records_.size() > cursor_) {
+      bytes_ -= RecordBytes(records_.back());
+      records_.pop_back();
+    }
+    bytes_ += RecordBytes(record);
+    records_.push_back(std::move(record));
+    cursor_ = records_.size();
+    ++records_pushed_;
+    Trim();
+  }
+
+  void Trim() {
+    // Only undo records are dropped; the newest record always survives.
+    while (records_.size() > 1 && cursor_ > 1 &&
+           (records_.size() > max_entries_ || bytes_ > budget_bytes_)) {
+      bytes_ -= RecordBytes(records_.front());
+      records_.pop_front();
+      --cursor_;
+      ++evicted_;
+    }
+  }
+
+  // Moves the record's item into the list or out of it. Undoing an add or
+  // redoing a remove takes the item out; the other two put it back; a replace
+  // swaps either way.
+  bool Apply(Record* r, std::vector<T>* items, bool forward) {
+    const size_t before = RecordBytes(*r);
+    const bool take_out = (r->kind == Kind::Add) != forward;
+    if (r->kind == Kind::Replace) {
+      if (r->index >= items->size() || !r->item) {
+        return false;
+      }
+      std::swap((*items)[r->index], *r->item);
+    } else if (take_out) {
+      if (r->index >= items->size()) {
+        return false;
+      }
+      r->item.emplace(std::move((*items)[r->index]));
+      items->erase(items->begin() + static_cast<std::ptrdiff_t>(r->index));
+    } else {
+      if (r->index > items->size() || !r->item) {
+        return false;
+      }
+      items->insert(items->begin() + static_cast<std::ptrdiff_t>(r->index),
+                    std::move(*r->item));
+      r->item.reset();
+    }
+    bytes_ = bytes_ - before + RecordBytes(*r);
+    return true;
+  }
+
+  ItemBytesFn item_bytes_;
+  size_t budget_bytes_;
+  size_t max_entries_;
+  std::deque<Record> records_;
+  size_t cursor_ = 0; // records_[0, cursor_) can be undone
+  size_t bytes_ = 0;
+  uint64_t records_pushed_ = 0;
+  uint64_t merged_ = 0;
+  uint64_t evicted_ = 0;
+};
+
+} // namespace snappin
@@ -0,0 +1,492 @@
+#include "GlyphCache.h"
+#include "Rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <new>
+
+namespace snappin {
+namespace {
+
+constexpr size_t kPageBytes =
+    static_cast<size_t>(GlyphCache::kPagePx) * static_cast<size_t>(GlyphCache::kPagePx);
+// Shelves are opened at heights rounded up to this, so glyphs of one font
+// size share a few shelves instead of one per exact height.
+constexpr int32_t kShelfStep = 8;
+constexpr int32_t kMaxFontPx = 1024;
+
+size_t LayoutBytes(const std::wstring& text, const TextLayout& layout) {
+  // Rough per-entry overhead for the list node, index node and control block.
+  return sizeof(TextLayout) + 128 + text.size() * sizeof(wchar_t) +
+         layout.glyphs.capacity() * sizeof(PositionedGlyph);
+}
+
+// Next codepoint of UTF-16 (or UTF-32) text at *pos; unpaired surrogates
+// become U+FFFD.
+char32_t NextCodepoint(std::wstring_view text, size_t* pos) {
+  const uint32_t c = static_cast<uint32_t>(text[(*pos)++]);
+  if (c >= 0xD800 && c <= 0xDBFF) {
+    if (*pos < text.size()) {
+      const uint32_t low = static_cast<uint32_t>(text[*pos]);
+      if (low >= 0xDC00 && low <= 0xDFFF) {
+        ++*pos;
+        return static_cast<char32_t>(0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00));
+      }
+    }
+    return U'\uFFFD';
+  }
+  if (c >= 0xDC00 && c <= 0xDFFF) {
+    return U'\uFFFD';
+  }
+  return static_cast<char32_t>(c);
+}
+
+} // namespace
+
+size_t GlyphCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+  const uint64_t params = uint64_t{key.font} << 32 | static_cast<uint32_t>(key.max_width);
+  const size_t h = std::hash<std::wstring>()(key.text);
+  return h ^ (std::hash<uint64_t>()(params) + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+
+GlyphCache::GlyphCache(std::unique_ptr<GlyphSource> source, size_t budget_bytes)
+    : source_(std::move(source)), budget_bytes_(budget_bytes) {}
+
+void GlyphCache::SetBudget(size_t budget_bytes) {
+  budget_bytes_ = budget_bytes;
+  if (pages_.size() > MaxPages()) {
+    for (Font& font : fonts_) {
+      font.glyphs.clear();
+    }
+    evicted_pages_.fetch_add(pages_.size(), std::memory_order_relaxed);
+    pages_.clear();
+  }
+  TrimLayouts();
+  PublishSizes();
+}
+
+void GlyphCache::Clear() {
+  for (Font& font : fonts_) {
+    font.glyphs.clear();
+  }
+  pages_.clear();
+  layouts_.clear();
+  layout_index_.clear();
+  layout_bytes_ = 0;
+  PublishSizes();
+}
+
+size_t GlyphCache::MaxPages() const {
+  return std::max<size_t>(1, budget_bytes_ / 4 * 3 / kPageBytes);
+}
+
+uint32_t GlyphCache::FontId(const FontKey& font) {
+  FontKey key = font;
+  key.size_px = std::clamp(key.size_px, 1, kMaxFontPx);
+  for (size_t i = 0; i < fonts_.size(); ++i) {
+    const FontKey& k = fonts_[i].key;
+    if (k.size_px == key.size_px && k.bold == key.bold && k.family == key.family) {
+      return static_cast<uint32_t>(i);
+    }
+  }
+  Font entry;
+  entry.key = std::move(key);
+  const float size = static_cast<float>(entry.key.size_px);
+  if (!source_ || !source_->Metrics(entry.key, &entry.metrics) ||
+      !std::isfinite(entry.metrics.line_height) || entry.metrics.line_height <= 0.0f ||
+      !std::isfinite(entry.metrics.ascent)) {
+    entry.metrics = FontMetrics{size * 0.8f, size * 0.2f, size};
+  }
+  fonts_.push_back(std::move(entry));
+  return static_cast<uint32_t>(fonts_.size() - 1);
+}
+
+GlyphCache::Glyph GlyphCache::GlyphFor(uint32_t font, char32_t codepoint) {
+  Font& f = fonts_[font];
+  auto it = f.glyphs.find(codepoint);
+  if (it != f.glyphs.end()) {
+    glyph_hits_.fetch_add(1, std::memory_order_relaxed);
+    if (it->second.page >= 0) {
+      pages_[static_cast<size_t>(it->second.page)].last_use = clock_;
+    }
+    return it->second;
+  }
+  glyph_misses_.fetch_add(1, std::memory_order_relaxed);
+  GlyphOutline outline;
+  bool found = source_ && source_->Outline(f.key, codepoint, &outline);
+  if (!found && codepoint != U'?') {
+    outline = GlyphOutline{};
+    found = source_ && source_->Outline(f.key, U'?', &outline);
+  }
+  if (!found || !std::isfinite(outline.advance)) {
+    outline = GlyphOutline{};
+    outline.advance = static_cast<float>(f.key.size_px) * 0.5f;
+  }
+  Glyph glyph;
+  Rasterize(outline, &glyph);
+  // Rasterize may have evicted a page, which only erases entries.
+  f.glyphs.emplace(codepoint, glyph);
+  PublishSizes();
+  return glyph;
+}
+
+void GlyphCache::Rasterize(const GlyphOutline& outline, Glyph* glyph) {
+  glyph->advance = outline.advance;
+  float min_x = 0.0f;
+  float min_y = 0.0f;
+  float max_x = 0.0f;
+  float max_y = 0.0f;
+  bool any = false;
+  for (const auto& contour : outline.contours) {
+    if (contour.size() < 3) {
+      continue;
+    }
+    for (const PointF& p : contour) {
+      if (!std::isfinite(p.x) || !std::isfinite(p.y)) {
+        return;
+      }
+      min_x = any ? std::min(min_x, p.x) : p.x;
+      min_y = any ? std::min(min_y, p.y) : p.y;
+      max_x = any ? std::max(max_x, p.x) : p.x;
+      max_y = any ? std::max(max_y, p.y) : p.y;
+      any = true;
+    }
+  }
+  if (!any || max_x - min_x > kMaxFontPx * 4 || max_y - min_y > kMaxFontPx * 4) {
+    return;
+  }
+  glyph->left = static_cast<int32_t>(std::floor(min_x));
+  glyph->top = static_cast<int32_t>(std::floor(min_y));
+  glyph->w = std::max(1, static_cast<int32_t>(std::ceil(max_x)) - glyph->left);
+  glyph->h = std::max(1, static_cast<int32_t>(std::ceil(max_y)) - glyph->top);
+  if (glyph->w > kPagePx || glyph->h > kPagePx || !Allocate(glyph->w, glyph->h, glyph)) {
+    glyph->page = -1;
+    return;
+  }
+  std::vector<std::vector<PointF>> shifted = outline.contours;
+  for (auto& contour : shifted) {
+    for (PointF& p : contour) {
+      p.x -= static_cast<float>(glyph->left);
+      p.y -= static_cast<float>(glyph->top);
+    }
+  }
+  Page& page = pages_[static_cast<size_t>(glyph->page)];
+  uint8_t* mask = page.pixels.data() + static_cast<size_t>(glyph->y) * kPagePx + glyph->x;
+  if (!RasterizeCoverage(shifted, SizePX{glyph->w, glyph->h}, mask, kPagePx)) {
+    for (int32_t y = 0; y < glyph->h; ++y) {
+      std::fill_n(mask + static_cast<size_t>(y) * kPagePx, glyph->w, uint8_t{0});
+    }
+  }
+}
+
+bool GlyphCache::Allocate(int32_t w, int32_t h, Glyph* glyph) {
+  const int32_t shelf_h = std::min(kPagePx, (h + kShelfStep - 1) / kShelfStep * kShelfStep);
+  const auto place = [&](size_t page_index, Shelf& shelf) {
+    glyph->page = static_cast<int32_t>(page_index);
+    glyph->x = shelf.x;
+    glyph->y = shelf.y;
+    shelf.x += w;
+    pages_[page_index].last_use = clock_;
+    return true;
+  };
+  const auto open_shelf = [&](size_t page_index) {
+    Page& page = pages_[page_index];
+    page.shelves.push_back(Shelf{page.used_h, shelf_h, 0});
+    page.used_h += shelf_h;
+    return place(page_index, page.shelves.back());
+  };
+
+  for (size_t i = 0; i < pages_.size(); ++i) {
+    for (Shelf& shelf : pages_[i].shelves) {
+      if (shelf.h == shelf_h && shelf.x + w <= kPagePx) {
+        return place(i, shelf);
+      }
+    }
+  }
+  for (size_t i = 0; i < pages_.size(); ++i) {
+    if (pages_[i].used_h + shelf_h <= kPagePx) {
+      return open_shelf(i);
+    }
+  }
+  if (pages_.size() < MaxPages()) {
+    try {
+      Page page;
+      page.pixels.resize(kPageBytes);
+      pages_.push_back(std::move(page));
+    } catch (const std::bad_alloc&) {
+      return false;
+    }
+    return open_shelf(pages_.size() - 1);
+  }
+  size_t lru = 0;
+  for (size_t i = 1; i < pages_.size(); ++i) {
+    if (pages_[i].last_use < pages_[lru].last_use) {
+      lru = i;
+    }
+  }
+  EvictPage(static_cast<int32_t>(lru));
+  return open_shelf(lru);
+}
+
+void GlyphCache::EvictPage(int32_t page) {
+  for (Font& font : fonts_) {
+    for (auto it = font.glyphs.begin(); it != font.glyphs.end();) {
+      if (it->second.page == page) {
+        it = font.glyphs.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  Page& p = pages_[static_cast<size_t>(page)];
+  p.shelves.clear();
+  p.used_h = 0;
+  evicted_pages_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GlyphCache::TrimLayouts() {
+  while (layout_bytes_ > budget_bytes_ / 4 && !layouts_.empty()) {
+    const auto& [key, layout] = layouts_.back();
+    layout_bytes_ -= LayoutBytes(key.text, *layout);
+    layout_index_.erase(key);
+    layouts_.pop_back();
+    evicted_layouts_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void GlyphCache::PublishSizes() {
+  size_t glyphs = 0;
+  for (const Font& font : fonts_) {
+    glyphs += font.glyphs.size();
+  }
+  bytes_.store(pages_.size() * kPageBytes + layout_bytes_, std::memory_order_relaxed);
+  page_count_.store(pages_.size(), std::memory_order_relaxed);
+  glyph_count_.store(glyphs, std::memory_order_relaxed);
+  layout_count_.store(layouts_.size(), std::memory_order_relaxed);
+}
+
+std::shared_ptr<const TextLayout> GlyphCache::Layout(const FontKey& font, std::wstring_view text,
+                                                     int32_t max_width) {
+  LayoutKey key;
+  key.font = FontId(font);
+  key.max_width = std::max(0, max_width);
+  key.text.assign(text);
+  auto found = layout_index_.find(key);
+  if (found != layout_index_.end()) {
+    layout_hits_.fetch_add(1, std::memory_order_relaxed);
+    layouts_.splice(layouts_.begin(), layouts_, found->second);
+    return found->second->second;
+  }
+  layout_misses_.fetch_add(1, std::memory_order_relaxed);
+  ++clock_;
+
+  const FontMetrics metrics = fonts_[key.font].metrics;
+  const float limit = static_cast<float>(key.max_width);
+  auto layout = std::make_shared<TextLayout>();
+  std::vector<PositionedGlyph>& glyphs = layout->glyphs;
+  const auto baseline = [&](int32_t line) {
+    return static_cast<int32_t>(std::lround(metrics.ascent + metrics.line_height * line));
+  };
+
+  int32_t line = 0;
+  float widest = 0.0f;
+  float pen = 0.0f;
+  // Where the line's last non-blank glyph ends.
+  float ink = 0.0f;
+  // The word being laid out: its first glyph, where it starts, the line's ink
+  // before it and the unrounded pen of each of its glyphs.
+  bool in_word = false;
+  size_t word_start = 0;
+  float word_pen = 0.0f;
+  float ink_before_word = 0.0f;
+  std::vector<float> word_x;
+  const auto new_line = [&](float width) {
+    widest = std::max(widest, width);
+    ++line;
+    pen = 0.0f;
+    ink = 0.0f;
+  };
+
+  for (size_t pos = 0; pos < text.size();) {
+    char32_t cp = NextCodepoint(text, &pos);
+    if (cp == U'\r') {
+      continue;
+    }
+    if (cp == U'\n') {
+      new_line(pen);
+      in_word = false;
+      continue;
+    }
+    if (cp == U'\t') {
+      cp = U' ';
+    }
+    const Glyph glyph = GlyphFor(key.font, cp);
+    if (cp == U' ') {
+      pen += glyph.advance;
+      in_word = false;
+      continue;
+    }
+    if (!in_word) {
+      in_word = true;
+      word_start = glyphs.size();
+      word_pen = pen;
+      ink_before_word = ink;
+      word_x.clear();
+    }
+    if (limit > 0.0f && pen + glyph.advance > limit) {
+      if (word_pen > 0.0f) {
+        // Something precedes the word on this line; move the word down.
+        const float word_end = pen - word_pen;
+        new_line(ink_before_word);
+        const int32_t y = baseline(line);
+        for (size_t i = word_start; i < glyphs.size(); ++i) {
+          word_x[i - word_start] -= word_pen;
+          glyphs[i].x = static_cast<int32_t>(std::lround(word_x[i - word_start]));
+          glyphs[i].y = y;
+        }
+        pen = word_end;
+        ink = word_end;
+        word_pen = 0.0f;
+        ink_before_word = 0.0f;
+      }
+      if (pen > 0.0f && pen + glyph.advance > limit) {
+        // The word alone is wider than a line; break inside it.
+        new_line(pen);
+        word_start = glyphs.size();
+        word_x.clear();
+      }
+    }
+    word_x.push_back(pen);
+    glyphs.push_back(
+        PositionedGlyph{cp, static_cast<int32_t>(std::lround(pen)), baseline(line)});
+    pen += glyph.advance;
+    ink = pen;
+  }
+  widest = std::max(widest, pen);
+  layout->lines = line + 1;
+  layout->size.w = static_cast<int32_t>(std::ceil(widest));
+  layout->size.h = static_cast<int32_t>(std::ceil(metrics.line_height * layout->lines));
+
+  layout_bytes_ += LayoutBytes(key.text, *layout);
+  layouts_.emplace_front(key, layout);
+  layout_index_.emplace(std::move(key), layouts_.begin());
+  TrimLayouts();
+  PublishSizes();
+  return layout;
+}
+
+bool GlyphCache::Draw(const FontKey& font, const TextLayout& layout, PointPX origin,
+                      ColorRGBA color, const CpuBitmap& target, const RectPX& clip) {
+  if (!target.data.p || target.size_px.w <= 0 || target.size_px.h <= 0 ||
+      target.stride_bytes < target.size_px.w * 4) {
+    return false;
+  }
+  int32_t x0 = 0;
+  int32_t y0 = 0;
+  int32_t x1 = target.size_px.w;
+  int32_t y1 = target.size_px.h;
+  if (clip.w > 0 && clip.h > 0) {
+    x0 = std::max(x0, clip.x);
+    y0 = std::max(y0, clip.y);
+    x1 = std::min(x1, clip.x + clip.w);
+    y1 = std::min(y1, clip.y + clip.h);
+  }
+  if (x1 <= x0 || y1 <= y0 || color.a == 0) {
+    return true;
+  }
+  const bool bgra = target.format == PixelFormat::BGRA8;
+  const uint32_t c0 = bgra ? color.b : color.r;
+  const uint32_t c1 = color.g;
+  const uint32_t c2 = bgra ? color.r : color.b;
+  const uint32_t alpha = color.a;
+
+  const uint32_t id = FontId(font);
+  ++clock_;
+  for (const PositionedGlyph& pg : layout.glyphs) {
+    const Glyph glyph = GlyphFor(id, pg.codepoint);
+    if (glyph.w <= 0) {
+      continue;
+    }
+    const int64_t gx = static_cast<int64_t>(origin.x) + pg.x + glyph.left;
+    const int64_t gy = static_cast<int64_t>(origin.y) + pg.y + glyph.top;
+    const int64_t sx0 = std::max<int64_t>(gx, x0);
+    const int64_t sy0 = std::max<int64_t>(gy, y0);
+    const int64_t sx1 = std::min<int64_t>(gx + glyph.w, x1);
+    const int64_t sy1 = std::min<int64_t>(gy + glyph.h, y1);
+    if (sx1 <= sx0 || sy1 <= sy0) {
+      continue;
+    }
+
+    const uint8_t* mask = nullptr;
+    size_t mask_stride = 0;
+    if (glyph.page >= 0) {
+      mask = pages_[static_cast<size_t>(glyph.page)].pixels.data() +
+             static_cast<size_t>(glyph.y) * kPagePx + static_cast<size_t>(glyph.x);
+      mask_stride = kPagePx;
+    } else {
+      // Not in the atlas: rasterize just for this draw.
+      GlyphOutline outline;
+      const Font& f = fonts_[id];
+      if (!source_ || (!source_->Outline(f.key, pg.codepoint, &outline) &&
+                       !source_->Outline(f.key, U'?', &outline))) {
+        continue;
+      }
+      glyph_misses_.fetch_add(1, std::memory_order_relaxed);
+      for (auto& contour : outline.contours) {
+        for (PointF& p : contour) {
+          p.x -= static_cast<float>(glyph.left);
+          p.y -= static_cast<float>(glyph.top);
+        }
+      }
+      try {
+        scratch_.resize(static_cast<size_t>(glyph.w) * static_cast<size_t>(glyph.h));
+      } catch (const std::bad_alloc&) {
+        continue;
+      }
+      if (!RasterizeCoverage(outline.contours, SizePX{glyph.w, glyph.h}, scratch_.data(),
+                             glyph.w)) {
+        continue;
+      }
+      mask = scratch_.data();
+      mask_stride = static_cast<size_t>(glyph.w);
+    }
+
+    for (int64_t y = sy0; y < sy1; ++y) {
+      const uint8_t* cov = mask + static_cast<size_t>(y - gy) * mask_stride +
+                           static_cast<size_t>(sx0 - gx);
+      uint8_t* px = static_cast<uint8_t*>(target.data.p) +
+                    static_cast<size_t>(y) * static_cast<size_t>(target.stride_bytes) +
+                    static_cast<size_t>(sx0) * 4;
+      for (int64_t x = sx0; x < sx1; ++x, ++cov, px += 4) {
+        if (*cov == 0) {
+          continue;
+        }
+        const uint32_t a = (*cov * alpha + 127) / 255;
+        const uint32_t inv = 255 - a;
+        px[0] = static_cast<uint8_t>((c0 * a + px[0] * inv + 127) / 255);
+        px[1] = static_cast<uint8_t>((c1 * a + px[1] * inv + 127) / 255);
+        px[2] = static_cast<uint8_t>((c2 * a + px[2] * inv + 127) / 255);
+        px[3] = static_cast<uint8_t>(a + (px[3] * inv + 127) / 255);
+      }
+    }
+  }
+  return true;
+}
+
+GlyphCacheStats GlyphCache::Stats() const {
+  GlyphCacheStats stats;
+  stats.glyph_hits = glyph_hits_.load(std::memory_order_relaxed);
+  stats.glyph_misses = glyph_misses_.load(std::memory_order_relaxed);
+  stats.layout_hits = layout_hits_.load(std::memory_order_relaxed);
+  stats.layout_misses = layout_misses_.load(std::memory_order_relaxed);
+  stats.evicted_pages = evicted_pages_.load(std::memory_order_relaxed);
+  stats.evicted_layouts = evicted_layouts_.load(std::memory_order_relaxed);
+  stats.bytes = bytes_.load(std::memory_order_relaxed);
+  stats.pages = page_count_.load(std::memory_order_relaxed);
+  stats.glyphs = glyph_count_.load(std::memory_order_relaxed);
+  stats.layouts = layout_count_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace snappin
@@ -0,0 +1,181 @@
+#pragma once
+#include "Types.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace snappin {
+
+struct FontKey {
+  std::wstring family = L"Segoe UI";
+  // Cell height in pixels (CreateFontW's positive height).
+  int32_t size_px = 16;
+  bool bold = false;
+};
+
+struct FontMetrics {
+  float ascent = 0.0f;
+  float descent = 0.0f;
+  // Baseline-to-baseline distance.
+  float line_height = 0.0f;
+};
+
+struct GlyphOutline {
+  float advance = 0.0f;
+  // Closed contours in pixels relative to the pen position on the baseline,
+  // y down. Empty for blank glyphs such as the space.
+  std::vector<std::vector<PointF>> contours;
+};
+
+// Where glyph shapes come from (GDI on Windows, synthetic fonts in tests).
+// Called only from GlyphCache, on its thread.
+class GlyphSource {
+public:
+  virtual ~GlyphSource() = default;
+  virtual bool Metrics(const FontKey& font, FontMetrics* out) = 0;
+  // False when the font has no glyph for `codepoint`.
+  virtual bool Outline(const FontKey& font, char32_t codepoint, GlyphOutline* out) = 0;
+};
+
+// One glyph of a laid out string. (x, y) is the pen position on the baseline
+// relative to the top-left of the text box.
+struct PositionedGlyph {
+  char32_t codepoint = 0;
+  int32_t x = 0;
+  int32_t y = 0;
+};
+
+struct TextLayout {
+  std::vector<PositionedGlyph> glyphs;
+  // Widest line's advance by the height of all lines.
+  SizePX size{};
+  int32_t lines = 0;
+};
+
+struct GlyphCacheStats {
+  uint64_t glyph_hits = 0;
+  uint64_t glyph_misses = 0; // glyphs rasterized
+  uint64_t layout_hits = 0;
+  uint64_t layout_misses = 0;
+  uint64_t evicted_pages = 0;
+  uint64_t evicted_layouts = 0;
+  size_t bytes = 0; // atlas pages plus memoized layouts
+  size_t pages = 0;
+  size_t glyphs = 0;
+  size_t layouts = 0;
+};
+
+// Text renderer that rasterizes each (font, size, codepoint) once into an
+// 8-bit coverage atlas and memoizes layouts per (font, string, wrap width), so
+// repainting text only blends cached masks. Glyphs are shelf-packed into
+// kPagePx square pages; past the budget the least recently used page is
+// cleared and reused, and layouts are dropped least recently used first
+// beyond a quarter of the budget. Glyphs too large for a page are rasterized
+// on every draw. Pens are snapped to whole pixels and pairs are not kerned.
+// Not thread-safe, except Stats().
+class GlyphCache {
+public:
+  static constexpr int32_t kPagePx = 512;
+
+  explicit GlyphCache(std::unique_ptr<GlyphSource> source,
+                      size_t budget_bytes = size_t{16} << 20);
+  GlyphCache(const GlyphCache&) = delete;
+  GlyphCache& operator=(const GlyphCache&) = delete;
+
+  void SetBudget(size_t budget_bytes);
+  // Drops every glyph and layout; counters are kept.
+  void Clear();
+
+  // Lines break at '\n' and, when max_width > 0, between words (inside a
+  // word longer than a line). '\r' is ignored and tabs are spaces. Glyphs the
+  // font lacks are drawn as '?'. UTF-16 surrogate pairs are combined.
+  std::shared_ptr<const TextLayout> Layout(const FontKey& font, std::wstring_view text,
+                                           int32_t max_width = 0);
+  // Blends `layout`, with its top-left at `origin`, into a BGRA8 or RGBA8
+  // target (source-over, like RasterizeShapes). Only pixels inside `clip`
+  // are written; empty means the whole target. False on an invalid target.
+  bool Draw(const FontKey& font, const TextLayout& layout, PointPX origin, ColorRGBA color,
+            const CpuBitmap& target, const RectPX& clip = RectPX{});
+
+  GlyphCacheStats Stats() const;
+
+private:
+  struct Glyph {
+    float advance = 0.0f;
+    // Mask placement relative to the pen position, and its atlas slot.
+    int32_t left = 0;
+    int32_t top = 0;
+    int32_t w = 0;
+    int32_t h = 0;
+    int32_t page = -1; // -1: blank (w == 0) or not in the atlas
+    int32_t x = 0;
+    int32_t y = 0;
+  };
+  struct Shelf {
+    int32_t y = 0;
+    int32_t h = 0;
+    int32_t x = 0;
+  };
+  struct Page {
+    std::vector<uint8_t> pixels;
+    std::vector<Shelf> shelves;
+    int32_t used_h = 0;
+    uint64_t last_use = 0;
+  };
+  struct Font {
+    FontKey key;
+    FontMetrics metrics;
+    std::unordered_map<char32_t, Glyph> glyphs;
+  };
+  struct LayoutKey {
+    uint32_t font = 0;
+    int32_t max_width = 0;
+    std::wstring text;
+    bool operator==(const LayoutKey& other) const {
+      return font == other.font && max_width == other.max_width && text == other.text;
+    }
+  };
+  struct LayoutKeyHash {
+    size_t operator()(const LayoutKey& key) const;
+  };
+  using LayoutList = std::list<std::pair<LayoutKey, std::shared_ptr<const TextLayout>>>;
+
+  uint32_t FontId(const FontKey& font);
+  Glyph GlyphFor(uint32_t font, char32_t codepoint);
+  void Rasterize(const GlyphOutline& outline, Glyph* glyph);
+  bool Allocate(int32_t w, int32_t h, Glyph* glyph);
+  void EvictPage(int32_t page);
+  void TrimLayouts();
+  size_t MaxPages() const;
+  void PublishSizes();
+
+  std::unique_ptr<GlyphSource> source_;
+  size_t budget_bytes_ = 0;
+  std::vector<Font> fonts_;
+  std::vector<Page> pages_;
+  LayoutList layouts_;
+  std::unordered_map<LayoutKey, LayoutList::iterator, LayoutKeyHash> layout_index_;
+  size_t layout_bytes_ = 0;
+  uint64_t clock_ = 0;
+  std::vector<uint8_t> scratch_;
+
+  std::atomic<uint64_t> glyph_hits_{0};
+  std::atomic<uint64_t> glyph_misses_{0};
+  std::atomic<uint64_t> layout_hits_{0};
+  std::atomic<uint64_t> layout_misses_{0};
+  std::atomic<uint64_t> evicted_pages_{0};
+  std::atomic<uint64_t> evicted_layouts_{0};
+  std::atomic<size_t> bytes_{0};
+  std::atomic<size_t> page_count_{0};
+  std::atomic<size_t> glyph_count_{0};
+  std::atomic<size_t> layout_count_{0};
+};
+
+} // namespace snappin
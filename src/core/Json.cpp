@@ -0,0 +1,412 @@
+#include "Json.h"
+
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <utility>
+
+namespace snappin {
+
+class JsonParser {
+public:
+  explicit JsonParser(std::string_view text) : text_(text) {}
+
+  bool Parse(JsonValue* out, JsonParseError* err) {
+    if (text_.substr(0, 3) == "\xEF\xBB\xBF") {
+      pos_ = 3;
+    }
+    SkipSpace();
+    bool ok = ParseValue(out, 0);
+    if (ok) {
+      SkipSpace();
+      if (pos_ != text_.size()) {
+        ok = Fail("unexpected content after the document");
+      }
+    }
+    if (!ok && err) {
+      *err = error_;
+    }
+    return ok;
+  }
+
+private:
+  bool Fail(const char* message) {
+    error_.offset = pos_;
+    error_.line = 1;
+    error_.column = 1;
+    for (size_t i = 0; i < pos_ && i < text_.size(); ++i) {
+      if (text_[i] == '\n') {
+        ++error_.line;
+        error_.column = 1;
+      } else {
+        ++error_.column;
+      }
+    }
+    error_.message = message;
+    return false;
+  }
+
+  bool AtEnd() const { return pos_ >= text_.size(); }
+  char Peek() const { return text_[pos_]; }
+
+  void SkipSpace() {
+    while (!AtEnd()) {
+      const char c = Peek();
+      if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+        return;
+      }
+      ++pos_;
+    }
+  }
+
+  bool Literal(std::string_view word) {
+    if (text_.substr(pos_, word.size()) != word) {
+      return Fail("invalid literal");
+    }
+    pos_ += word.size();
+    return true;
+  }
+
+  bool ParseValue(JsonValue* out, int depth) {
+    if (AtEnd()) {
+      return Fail("unexpected end of input");
+    }
+    switch (Peek()) {
+      case '{':
+        return ParseObject(out, depth + 1);
+      case '[':
+        return ParseArray(out, depth + 1);
+      case '"':
+        out->type_ = JsonValue::Type::String;
+        return ParseString(&out->string_);
+      case 't':
+        out->type_ = JsonValue::Type::Bool;
+        out->bool_ = true;
+        return Literal("true");
+      case 'f':
+        out->type_ = JsonValue::Type::Bool;
+        out->bool_ = false;
+        return Literal("false");
+      case 'n':
+        out->type_ = JsonValue::Type::Null;
+        return Literal("null");
+      default:
+        return ParseNumber(out);
+    }
+  }
+
+  bool ParseObject(JsonValue* out, int depth) {
+    if (depth > kJsonMaxDepth) {
+      return Fail("nesting too deep");
+    }
+    out->type_ = JsonValue::Type::Object;
+    ++pos_; // '{'
+    SkipSpace();
+    if (!AtEnd() && Peek() == '}') {
+      ++pos_;
+      return true;
+    }
+    for (;;) {
+      if (AtEnd() || Peek() != '"') {
+        return Fail("expected a member name");
+      }
+      JsonMember member;
+      if (!ParseString(&member.key)) {
+        return false;
+      }
+      SkipSpace();
+      if (AtEnd() || Peek() != ':') {
+        return Fail("expected ':'");
+      }
+      ++pos_;
+      SkipSpace();
+      if (!ParseValue(&member.value, depth)) {
+        return false;
+      }
+      out->members_.push_back(std::move(member));
+      SkipSpace();
+      if (AtEnd()) {
+        return Fail("unterminated object");
+      }
+      if (Peek() == '}') {
+        ++pos_;
+        return true;
+      }
+      if (Peek() != ',') {
+        return Fail("expected ',' or '}'");
+      }
+      ++pos_;
+      SkipSpace();
+    }
+  }
+
+  bool ParseArray(JsonValue* out, int depth) {
+    if (depth > kJsonMaxDepth) {
+      return Fail("nesting too deep");
+    }
+    out->type_ = JsonValue::Type::Array;
+    ++pos_; // '['
+    SkipSpace();
+    if (!AtEnd() && Peek() == ']') {
+      ++pos_;
+      return true;
+    }
+    for (;;) {
+      out->items_.emplace_back();
+      if (!ParseValue(&out->items_.back(), depth)) {
+        return false;
+      }
+      SkipSpace();
+      if (AtEnd()) {
+        return Fail("unterminated array");
+      }
+      if (Peek() == ']') {
+        ++pos_;
+        return true;
+      }
+      if (Peek() != ',') {
+        return Fail("expected ',' or ']'");
+      }
+      ++pos_;
+      SkipSpace();
+    }
+  }
+
+  bool ParseHex4(uint32_t* out) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i, ++pos_) {
+      if (AtEnd()) {
+        return Fail("unterminated string");
+      }
+      const char c = Peek();
+      value <<= 4;
+      if (c >= '0' && c <= '9') {
+        value |= static_cast<uint32_t>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        value |= static_cast<uint32_t>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        value |= static_cast<uint32_t>(c - 'A' + 10);
+      } else {
+        return Fail("invalid \\u escape");
+      }
+    }
+    *out = value;
+    return true;
+  }
+
+  static void AppendUtf8(uint32_t cp, std::string* out) {
+    if (cp < 0x80) {
+      out->push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+      out->push_back(static_cast<char>(0xC0 | (cp >> 6)));
+      out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+      out->push_back(static_cast<char>(0xE0 | (cp >> 12)));
+      out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+      out->push_back(static_cast<char>(0xF0 | (cp >> 18)));
+      out->push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+  }
+
+  bool ParseString(std::string* out) {
+    ++pos_; // opening quote
+    for (;;) {
+      // Copy the run of plain characters in one go.
+      const size_t run_start = pos_;
+      while (!AtEnd()) {
+        const unsigned char c = static_cast<unsigned char>(Peek());
+        if (c == '"' || c == '\\' || c < 0x20) {
+          break;
+        }
+        ++pos_;
+      }
+      out->append(text_.data() + run_start, pos_ - run_start);
+      if (AtEnd()) {
+        return Fail("unterminated string");
+      }
+      const char c = Peek();
+      if (c == '"') {
+        ++pos_;
+        return true;
+      }
+      if (c != '\\') {
+        return Fail("control character in string");
+      }
+      ++pos_;
+      if (AtEnd()) {
+        return Fail("unterminated string");
+      }
+      const char esc = Peek();
+      ++pos_;
+      switch (esc) {
+        case '"':
+        case '\\':
+        case '/':
+          out->push_back(esc);
+          break;
+        case 'b':
+          out->push_back('\b');
+          break;
+        case 'f':
+          out->push_back('\f');
+          break;
+        case 'n':
+          out->push_back('\n');
+          break;
+        case 'r':
+          out->push_back('\r');
+          break;
+        case 't':
+          out->push_back('\t');
+          break;
+        case 'u': {
+          uint32_t cp = 0;
+          if (!ParseHex4(&cp)) {
+            return false;
+          }
+          if (cp >= 0xD800 && cp <= 0xDBFF) {
+            uint32_t low = 0;
+            if (text_.substr(pos_, 2) != "\\u") {
+              return Fail("unpaired surrogate");
+            }
+            pos_ += 2;
+            if (!ParseHex4(&low)) {
+              return false;
+            }
+            if (low < 0xDC00 || low > 0xDFFF) {
+              return Fail("unpaired surrogate");
+            }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+          } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            return Fail("unpaired surrogate");
+          }
+          AppendUtf8(cp, out);
+          break;
+        }
+        default:
+          --pos_;
+          return Fail("invalid escape");
+      }
+    }
+  }
+
+  bool Digits() {
+    const size_t start = pos_;
+    while (!AtEnd() && Peek() >= '0' && Peek() <= '9') {
+      ++pos_;
+    }
+    return pos_ > start;
+  }
+
+  bool ParseNumber(JsonValue* out) {
+    const size_t start = pos_;
+    if (Peek() == '-') {
+      ++pos_;
+    }
+    if (AtEnd() || Peek() < '0' || Peek() > '9') {
+      return Fail(pos_ == start ? "unexpected character" : "invalid number");
+    }
+    if (Peek() == '0') {
+      ++pos_;
+    } else {
+      Digits();
+    }
+    if (!AtEnd() && Peek() == '.') {
+      ++pos_;
+      if (!Digits()) {
+        return Fail("invalid number");
+      }
+    }
+    if (!AtEnd() && (Peek() == 'e' || Peek() == 'E')) {
+      ++pos_;
+      if (!AtEnd() && (Peek() == '+' || Peek() == '-')) {
+        ++pos_;
+      }
+      if (!Digits()) {
+        return Fail("invalid number");
+      }
+    }
+    double value = 0.0;
+    const char* first = text_.data() + start;
+    const char* last = text_.data() + pos_;
+    const std::from_chars_result res = std::from_chars(first, last, value);
+    if (res.ec != std::errc() || res.ptr != last || !std::isfinite(value)) {
+      pos_ = start;
+      return Fail("number out of range");
+    }
+    out->type_ = JsonValue::Type::Number;
+    out->number_ = value;
+    return true;
+  }
+
+  std::string_view text_;
+  size_t pos_ = 0;
+  JsonParseError error_;
+};
+
+const JsonValue* JsonValue::Find(std::string_view key) const {
+  for (const JsonMember& member : members_) {
+    if (member.key == key) {
+      return &member.value;
+    }
+  }
+  return nullptr;
+}
+
+bool JsonValue::ReadBool(std::string_view key, bool* out) const {
+  const JsonValue* v = Find(key);
+  if (!v || !v->is_bool()) {
+    return false;
+  }
+  *out = v->bool_;
+  return true;
+}
+
+bool JsonValue::ReadString(std::string_view key, std::string* out) const {
+  const JsonValue* v = Find(key);
+  if (!v || !v->is_string()) {
+    return false;
+  }
+  *out = v->string_;
+  return true;
+}
+
+bool JsonValue::ReadInt(std::string_view key, int* out) const {
+  const JsonValue* v = Find(key);
+  if (!v || !v->is_number() || v->number_ != std::floor(v->number_) ||
+      v->number_ < static_cast<double>(INT_MIN) || v->number_ > static_cast<double>(INT_MAX)) {
+    return false;
+  }
+  *out = static_cast<int>(v->number_);
+  return true;
+}
+
+bool JsonValue::ReadNumber(std::string_view key, double* out) const {
+  const JsonValue* v = Find(key);
+  if (!v || !v->is_number()) {
+    return false;
+  }
+  *out = v->number_;
+  return true;
+}
+
+bool ParseJson(std::string_view text, JsonValue* out, JsonParseError* err) {
+  JsonValue value;
+  JsonParser parser(text);
+  if (!parser.Parse(&value, err)) {
+    return false;
+  }
+  *out = std::move(value);
+  return true;
+}
+
+std::string FormatJsonError(const JsonParseError& err) {
+  return "line " + std::to_string(err.line) + ", column " + std::to_string(err.column) +
+         ": " + err.message;
+}
+
+} // namespace snappin
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace snappin {
+
+struct JsonMember;
+
+// Parsed JSON document node. Values are immutable once parsed.
+class JsonValue {
+public:
+  enum class Type { Null, Bool, Number, String, Array, Object };
+
+  Type type() const { return type_; }
+  bool is_null() const { return type_ == Type::Null; }
+  bool is_bool() const { return type_ == Type::Bool; }
+  bool is_number() const { return type_ == Type::Number; }
+  bool is_string() const { return type_ == Type::String; }
+  bool is_array() const { return type_ == Type::Array; }
+  bool is_object() const { return type_ == Type::Object; }
+
+  // Accessors return a neutral value when the type does not match.
+  bool bool_value() const { return type_ == Type::Bool && bool_; }
+  double number_value() const { return type_ == Type::Number ? number_ : 0.0; }
+  const std::string& string_value() const { return string_; }
+  const std::vector<JsonValue>& items() const { return items_; }
+  const std::vector<JsonMember>& members() const { return members_; }
+
+  // Object member lookup; null when absent or not an object. With duplicate
+  // keys the first one wins.
+  const JsonValue* Find(std::string_view key) const;
+
+  // Typed member reads; false (and *out untouched) when absent or mistyped.
+  bool ReadBool(std::string_view key, bool* out) const;
+  bool ReadString(std::string_view key, std::string* out) const;
+  bool ReadNumber(std::string_view key, double* out) const;
+  // Integral numbers in [INT_MIN, INT_MAX] only.
+  bool ReadInt(std::string_view key, int* out) const;
+
+private:
+  friend class JsonParser;
+
+  Type type_ = Type::Null;
+  bool bool_ = false;
+  double number_ = 0.0;
+  std::string string_;
+  std::vector<JsonValue> items_;
+  std::vector<JsonMember> members_;
+};
+
+struct JsonMember {
+  std::string key;
+  JsonValue value;
+};
+
+struct JsonParseError {
+  size_t offset = 0; // byte offset of the offending character
+  int line = 1;      // 1-based
+  int column = 1;    // 1-based, in bytes
+  std::string message;
+};
+
+// Parses a complete RFC 8259 document in one pass. A leading UTF-8 BOM is
+// skipped; \u escapes (including surrogate pairs) are decoded to UTF-8.
+// Nesting is limited to kJsonMaxDepth. On failure returns false and fills
+// *err (if non-null) with the position of the first error.
+inline constexpr int kJsonMaxDepth = 64;
+bool ParseJson(std::string_view text, JsonValue* out, JsonParseError* err = nullptr);
+
+// "line L, column C: message".
+std::string FormatJsonError(const JsonParseError& err);
+
+} // namespace snappin
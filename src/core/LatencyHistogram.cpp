@@ -0,0 +1,124 @@
+#include "LatencyHistogram.h"
+
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+namespace snappin {
+namespace {
+
+constexpr uint64_t kSubBuckets = uint64_t{1} << LatencyHistogram::kSubBucketBits;
+
+double MicrosToMs(uint64_t us) { return static_cast<double>(us) / 1000.0; }
+
+} // namespace
+
+uint64_t MonotonicMicros() {
+  using namespace std::chrono;
+  return static_cast<uint64_t>(
+      duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t us) {
+  if (us < kLinearLimit) {
+    return static_cast<size_t>(us);
+  }
+  const int magnitude = static_cast<int>(std::bit_width(us)) - 1;
+  if (magnitude > kMaxMagnitude) {
+    return kBucketCount - 1;
+  }
+  const int shift = magnitude - kSubBucketBits;
+  const uint64_t sub = (us >> shift) - kSubBuckets;
+  return static_cast<size_t>(kLinearLimit +
+                             static_cast<uint64_t>(magnitude - kSubBucketBits - 1) *
+                                 kSubBuckets +
+                             sub);
+}
+
+uint64_t LatencyHistogram::BucketUpperMicros(size_t index) {
+  if (index < kLinearLimit) {
+    return index;
+  }
+  if (index >= kBucketCount - 1) {
+    return UINT64_MAX;
+  }
+  const uint64_t offset = index - kLinearLimit;
+  const int shift = static_cast<int>(offset / kSubBuckets) + 1;
+  const uint64_t sub = offset % kSubBuckets;
+  return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::RecordMicros(uint64_t us) {
+  counts_[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+  sum_us_.fetch_add(us, std::memory_order_relaxed);
+  uint64_t prev = max_us_.load(std::memory_order_relaxed);
+  while (us > prev &&
+         !max_us_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::RecordMs(double ms) {
+  if (!(ms > 0.0)) {
+    RecordMicros(0);
+    return;
+  }
+  const double us = std::round(ms * 1000.0);
+  RecordMicros(us >= 1.8e19 ? UINT64_MAX : static_cast<uint64_t>(us));
+}
+
+LatencySummary LatencyHistogram::Summary() const {
+  uint64_t counts[kBucketCount];
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+  }
+  return Summarize(counts, sum_us_.load(std::memory_order_relaxed),
+                   max_us_.load(std::memory_order_relaxed));
+}
+
+LatencySummary LatencyHistogram::SnapshotAndReset() {
+  uint64_t counts[kBucketCount];
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    counts[i] = counts_[i].exchange(0, std::memory_order_relaxed);
+  }
+  return Summarize(counts, sum_us_.exchange(0, std::memory_order_relaxed),
+                   max_us_.exchange(0, std::memory_order_relaxed));
+}
+
+LatencySummary LatencyHistogram::Summarize(const uint64_t* counts, uint64_t sum_us,
+                                           uint64_t max_us) {
+  LatencySummary out;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    out.count += counts[i];
+  }
+  if (out.count == 0) {
+    return out;
+  }
+  // A racing reset can split one sample's bucket and max across snapshots;
+  // keep the reported values consistent with the buckets we did see.
+  size_t top = kBucketCount - 1;
+  while (counts[top] == 0) {
+    --top;
+  }
+  if (BucketIndex(max_us) != top) {
+    max_us = BucketUpperMicros(top);
+  }
+
+  const double ranks[3] = {0.50, 0.95, 0.99};
+  double* fields[3] = {&out.p50_ms, &out.p95_ms, &out.p99_ms};
+  size_t bucket = 0;
+  uint64_t seen = counts[0];
+  for (int q = 0; q < 3; ++q) {
+    const uint64_t rank = static_cast<uint64_t>(
+        std::ceil(ranks[q] * static_cast<double>(out.count)));
+    while (seen < rank) {
+      seen += counts[++bucket];
+    }
+    const uint64_t upper = BucketUpperMicros(bucket);
+    *fields[q] = MicrosToMs(upper < max_us ? upper : max_us);
+  }
+  out.max_ms = MicrosToMs(max_us);
+  out.mean_ms = MicrosToMs(sum_us) / static_cast<double>(out.count);
+  return out;
+}
+
+} // namespace snappin
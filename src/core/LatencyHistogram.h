@@ -0,0 +1,53 @@
+#pragma once
+#include "Stats.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace snappin {
+
+// Microseconds from a monotonic high-resolution clock (steady_clock, which is
+// QueryPerformanceCounter on Windows). Only differences are meaningful.
+uint64_t MonotonicMicros();
+
+// Fixed-size log-linear histogram of durations in microseconds. Values below
+// 64 us get one bucket each; above that every power of two is split into 32
+// buckets, so a bucket spans at most ~3% of its value. Values from ~71 min up
+// share the last bucket. Recording is lock-free (relaxed atomic adds) and
+// safe from any number of threads; memory never grows.
+class LatencyHistogram {
+public:
+  static constexpr int kSubBucketBits = 5;
+  static constexpr uint64_t kLinearLimit = uint64_t{2} << kSubBucketBits; // 64
+  static constexpr int kMaxMagnitude = 31; // highest split power of two
+  static constexpr size_t kBucketCount =
+      kLinearLimit + (kMaxMagnitude - kSubBucketBits) * (size_t{1} << kSubBucketBits);
+
+  LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void RecordMicros(uint64_t us);
+  // Negative and NaN durations record as 0.
+  void RecordMs(double ms);
+
+  LatencySummary Summary() const;
+  // Returns the summary and empties the histogram. A sample recorded
+  // concurrently lands in this summary or the next one, never both.
+  LatencySummary SnapshotAndReset();
+
+  static size_t BucketIndex(uint64_t us);
+  // Largest value that maps to `index`.
+  static uint64_t BucketUpperMicros(size_t index);
+
+private:
+  static LatencySummary Summarize(const uint64_t* counts, uint64_t sum_us,
+                                  uint64_t max_us);
+
+  std::atomic<uint64_t> counts_[kBucketCount] = {};
+  std::atomic<uint64_t> sum_us_{0};
+  std::atomic<uint64_t> max_us_{0};
+};
+
+} // namespace snappin
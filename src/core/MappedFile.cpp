@@ -0,0 +1,189 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+
+namespace snappin {
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+  Close();
+#ifdef _WIN32
+  HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  handle_ = handle;
+  LARGE_INTEGER size = {};
+  if (!GetFileSizeEx(handle, &size)) {
+    Close();
+    return false;
+  }
+  size_ = static_cast<uint64_t>(size.QuadPart);
+#else
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    return false;
+  }
+  struct stat st = {};
+  if (::fstat(fd_, &st) != 0) {
+    Close();
+    return false;
+  }
+  size_ = static_cast<uint64_t>(st.st_size);
+#endif
+  return true;
+}
+
+void MappedFile::Close() {
+  Unmap();
+#ifdef _WIN32
+  if (handle_) {
+    CloseHandle(static_cast<HANDLE>(handle_));
+    handle_ = nullptr;
+  }
+#else
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#endif
+  size_ = 0;
+}
+
+bool MappedFile::is_open() const {
+#ifdef _WIN32
+  return handle_ != nullptr;
+#else
+  return fd_ >= 0;
+#endif
+}
+
+bool MappedFile::Append(const uint8_t* data, size_t bytes) {
+  while (bytes > 0) {
+    const size_t chunk = std::min<size_t>(bytes, size_t{1} << 30);
+#ifdef _WIN32
+    OVERLAPPED at = {};
+    at.Offset = static_cast<DWORD>(size_);
+    at.OffsetHigh = static_cast<DWORD>(size_ >> 32);
+    DWORD written = 0;
+    if (!WriteFile(static_cast<HANDLE>(handle_), data, static_cast<DWORD>(chunk), &written,
+                   &at) ||
+        written == 0) {
+      return false;
+    }
+#else
+    const ssize_t written = ::pwrite(fd_, data, chunk, static_cast<off_t>(size_));
+    if (written <= 0) {
+      return false;
+    }
+#endif
+    size_ += static_cast<uint64_t>(written);
+    data += written;
+    bytes -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+bool MappedFile::Truncate(uint64_t bytes) {
+  Unmap();
+#ifdef _WIN32
+  LARGE_INTEGER at = {};
+  at.QuadPart = static_cast<LONGLONG>(bytes);
+  if (!SetFilePointerEx(static_cast<HANDLE>(handle_), at, nullptr, FILE_BEGIN) ||
+      !SetEndOfFile(static_cast<HANDLE>(handle_))) {
+    return false;
+  }
+#else
+  if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+    return false;
+  }
+#endif
+  size_ = bytes;
+  return true;
+}
+
+bool MappedFile::Sync() {
+#ifdef _WIN32
+  return FlushFileBuffers(static_cast<HANDLE>(handle_)) != 0;
+#else
+  return ::fsync(fd_) == 0;
+#endif
+}
+
+const uint8_t* MappedFile::Map(uint64_t bytes) {
+  if (bytes > size_ || bytes == 0) {
+    return nullptr;
+  }
+  if (bytes <= mapped_bytes_) {
+    return mapped_;
+  }
+  Unmap();
+#ifdef _WIN32
+  HANDLE mapping =
+      CreateFileMappingW(static_cast<HANDLE>(handle_), nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    return nullptr;
+  }
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!view) {
+    return nullptr;
+  }
+#else
+  void* view = ::mmap(nullptr, static_cast<size_t>(size_), PROT_READ, MAP_SHARED, fd_, 0);
+  if (view == MAP_FAILED) {
+    return nullptr;
+  }
+#endif
+  mapped_ = static_cast<const uint8_t*>(view);
+  mapped_bytes_ = size_;
+  return mapped_;
+}
+
+void MappedFile::Unmap() {
+  if (!mapped_) {
+    return;
+  }
+#ifdef _WIN32
+  UnmapViewOfFile(mapped_);
+#else
+  ::munmap(const_cast<uint8_t*>(mapped_), static_cast<size_t>(mapped_bytes_));
+#endif
+  mapped_ = nullptr;
+  mapped_bytes_ = 0;
+}
+
+bool MappedFile::Replace(const std::filesystem::path& from, const std::filesystem::path& to) {
+#ifdef _WIN32
+  return MoveFileExW(from.c_str(), to.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  if (::rename(from.c_str(), to.c_str()) != 0) {
+    return false;
+  }
+  const std::filesystem::path dir =
+      to.has_parent_path() ? to.parent_path() : std::filesystem::path(".");
+  const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+  if (dir_fd >= 0) {
+    ::fsync(dir_fd);
+    ::close(dir_fd);
+  }
+  return true;
+#endif
+}
+
+} // namespace snappin
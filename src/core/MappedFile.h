@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace snappin {
+
+// A read-write file appended to with positioned writes and read through a
+// read-only mapping of its first bytes (Win32 file mapping or POSIX mmap).
+// The mapping covers the file as it was when mapped; Map() with a larger
+// size remaps, which invalidates pointers into the old mapping, as do
+// Truncate() and Close(). Not thread-safe.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Opens, creating the file if needed. Other processes may read or delete
+  // it while it is open.
+  bool Open(const std::filesystem::path& path);
+  void Close();
+  bool is_open() const;
+
+  uint64_t size() const { return size_; }
+
+  bool Append(const uint8_t* data, size_t bytes);
+  bool Truncate(uint64_t bytes);
+  bool Sync();
+
+  // The first `bytes` of the file (at most size()), or null.
+  const uint8_t* Map(uint64_t bytes);
+  void Unmap();
+
+  // Atomically replaces `to` with `from` and makes the rename durable.
+  static bool Replace(const std::filesystem::path& from, const std::filesystem::path& to);
+
+private:
+#ifdef _WIN32
+  void* handle_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  uint64_t size_ = 0;
+  const uint8_t* mapped_ = nullptr;
+  uint64_t mapped_bytes_ = 0;
+};
+
+} // namespace snappin
@@ -0,0 +1,229 @@
+#include "OverlayCompositor.h"
+
+#include "PixelBufferPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace snappin {
+namespace {
+
+bool IsEmpty(const RectPX& r) { return r.w <= 0 || r.h <= 0; }
+
+bool SameRect(const RectPX& a, const RectPX& b) {
+  if (IsEmpty(a) || IsEmpty(b)) {
+    return IsEmpty(a) && IsEmpty(b);
+  }
+  return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+RectPX Intersect(const RectPX& a, const RectPX& b) {
+  const int32_t left = std::max(a.x, b.x);
+  const int32_t top = std::max(a.y, b.y);
+  const int32_t right = std::min(a.x + a.w, b.x + b.w);
+  const int32_t bottom = std::min(a.y + a.h, b.y + b.h);
+  if (right <= left || bottom <= top) {
+    return RectPX{};
+  }
+  return RectPX{left, top, right - left, bottom - top};
+}
+
+// Appends the non-empty parts of a - b (at most four bands).
+void Subtract(const RectPX& a, const RectPX& b, std::vector<RectPX>* out) {
+  const RectPX overlap = Intersect(a, b);
+  if (IsEmpty(overlap)) {
+    out->push_back(a);
+    return;
+  }
+  const int32_t a_right = a.x + a.w;
+  const int32_t a_bottom = a.y + a.h;
+  const int32_t o_right = overlap.x + overlap.w;
+  const int32_t o_bottom = overlap.y + overlap.h;
+  if (overlap.y > a.y) {
+    out->push_back(RectPX{a.x, a.y, a.w, overlap.y - a.y});
+  }
+  if (a_bottom > o_bottom) {
+    out->push_back(RectPX{a.x, o_bottom, a.w, a_bottom - o_bottom});
+  }
+  if (overlap.x > a.x) {
+    out->push_back(RectPX{a.x, overlap.y, overlap.x - a.x, overlap.h});
+  }
+  if (a_right > o_right) {
+    out->push_back(RectPX{o_right, overlap.y, a_right - o_right, overlap.h});
+  }
+}
+
+// Adds the part of `rect` not yet covered, keeping `region` disjoint.
+void AddDisjoint(const RectPX& rect, std::vector<RectPX>* region) {
+  if (IsEmpty(rect)) {
+    return;
+  }
+  std::vector<RectPX> pieces{rect};
+  std::vector<RectPX> next;
+  for (const RectPX& existing : *region) {
+    next.clear();
+    for (const RectPX& piece : pieces) {
+      Subtract(piece, existing, &next);
+    }
+    pieces.swap(next);
+    if (pieces.empty()) {
+      return;
+    }
+  }
+  region->insert(region->end(), pieces.begin(), pieces.end());
+}
+
+bool UsableSource(const BitmapView& src, const SizePX& size) {
+  return src.valid() && src.format() == PixelFormat::BGRA8 && src.size_px().w == size.w &&
+         src.size_px().h == size.h;
+}
+
+} // namespace
+
+bool OverlayCompositor::Reset(const SizePX& size, BitmapView dimmed, BitmapView bright,
+                              const OverlayStyle& style) {
+  if (!pixels_ || size.w != size_.w || size.h != size_.h) {
+    Clear();
+    if (!AcquirePixelBuffer(PixelBufferPool::Shared(), size, &pixels_, &stride_bytes_)) {
+      return false;
+    }
+    size_ = size;
+  }
+  dimmed_ = UsableSource(dimmed, size) ? std::move(dimmed) : BitmapView();
+  bright_ = UsableSource(bright, size) ? std::move(bright) : BitmapView();
+  style_ = style;
+  composed_selection_ = RectPX{};
+  full_dirty_ = true;
+  return true;
+}
+
+void OverlayCompositor::Clear() {
+  pixels_.reset();
+  size_ = SizePX{};
+  stride_bytes_ = 0;
+  dimmed_ = BitmapView();
+  bright_ = BitmapView();
+  composed_selection_ = RectPX{};
+  full_dirty_ = true;
+  dirty_.clear();
+}
+
+CpuBitmap OverlayCompositor::BackBuffer() const {
+  CpuBitmap out;
+  out.format = PixelFormat::BGRA8;
+  out.size_px = size_;
+  out.stride_bytes = stride_bytes_;
+  out.data.p = pixels_.get();
+  return out;
+}
+
+void OverlayCompositor::AppendBorder(const RectPX& selection,
+                                     std::vector<RectPX>* out) const {
+  if (IsEmpty(selection) || style_.border_px <= 0) {
+    return;
+  }
+  // Centered on the selection edge, like a GDI pen of the same width.
+  const int32_t grow = style_.border_px / 2;
+  const int32_t shrink = style_.border_px - grow;
+  const RectPX outer{selection.x - grow, selection.y - grow, selection.w + 2 * grow,
+                     selection.h + 2 * grow};
+  const RectPX inner{selection.x + shrink, selection.y + shrink, selection.w - 2 * shrink,
+                     selection.h - 2 * shrink};
+  std::vector<RectPX> ring;
+  if (IsEmpty(inner)) {
+    ring.push_back(outer);
+  } else {
+    Subtract(outer, inner, &ring);
+  }
+  for (const RectPX& r : ring) {
+    const RectPX clipped = Intersect(r, Bounds());
+    if (!IsEmpty(clipped)) {
+      out->push_back(clipped);
+    }
+  }
+}
+
+const std::vector<RectPX>& OverlayCompositor::Compose(const OverlayScene& scene) {
+  dirty_.clear();
+  ++stats_.frames;
+  stats_.last_composed_pixels = 0;
+  if (!pixels_) {
+    return dirty_;
+  }
+
+  const RectPX previous = composed_selection_;
+  const RectPX current = IsEmpty(scene.selection) ? RectPX{} : scene.selection;
+  if (full_dirty_) {
+    dirty_.push_back(Bounds());
+  } else if (SameRect(previous, current)) {
+    ++stats_.skipped_frames;
+    return dirty_;
+  } else {
+    std::vector<RectPX> changed;
+    AppendBorder(previous, &changed);
+    AppendBorder(current, &changed);
+    if (bright_.valid()) {
+      // Pixels inside exactly one of the two selections switch layers.
+      const RectPX before = Intersect(previous, Bounds());
+      const RectPX after = Intersect(current, Bounds());
+      if (!IsEmpty(before)) {
+        Subtract(before, after, &changed);
+      }
+      if (!IsEmpty(after)) {
+        Subtract(after, before, &changed);
+      }
+    }
+    for (const RectPX& r : changed) {
+      AddDisjoint(r, &dirty_);
+    }
+  }
+
+  composed_selection_ = current;
+  full_dirty_ = false;
+  for (const RectPX& r : dirty_) {
+    ComposeRect(r);
+    stats_.last_composed_pixels += static_cast<uint64_t>(r.w) * static_cast<uint64_t>(r.h);
+  }
+  stats_.composed_pixels += stats_.last_composed_pixels;
+  return dirty_;
+}
+
+void OverlayCompositor::ComposeRect(const RectPX& rect) {
+  auto copy = [this](const BitmapView& src, const RectPX& r) {
+    for (int32_t y = r.y; y < r.y + r.h; ++y) {
+      std::memcpy(pixels_.get() + static_cast<size_t>(y) * stride_bytes_ + r.x * 4,
+                  src.row(y) + r.x * 4, static_cast<size_t>(r.w) * 4);
+    }
+  };
+  auto fill = [this](const ColorRGBA& color, const RectPX& r) {
+    const uint8_t bgra[4] = {color.b, color.g, color.r, color.a};
+    for (int32_t y = r.y; y < r.y + r.h; ++y) {
+      uint8_t* dst = pixels_.get() + static_cast<size_t>(y) * stride_bytes_ + r.x * 4;
+      for (int32_t x = 0; x < r.w; ++x, dst += 4) {
+        std::memcpy(dst, bgra, 4);
+      }
+    }
+  };
+
+  if (dimmed_.valid()) {
+    copy(dimmed_, rect);
+  } else {
+    fill(style_.fill_color, rect);
+  }
+  if (bright_.valid()) {
+    const RectPX inside = Intersect(rect, composed_selection_);
+    if (!IsEmpty(inside)) {
+      copy(bright_, inside);
+    }
+  }
+  std::vector<RectPX> border;
+  AppendBorder(composed_selection_, &border);
+  for (const RectPX& r : border) {
+    const RectPX part = Intersect(rect, r);
+    if (!IsEmpty(part)) {
+      fill(style_.border_color, part);
+    }
+  }
+}
+
+} // namespace snappin
@@ -0,0 +1,79 @@
+#pragma once
+#include "Types.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace snappin {
+
+// What the overlay shows in one frame, in back-buffer pixels. An empty
+// selection shows the dimmed layer only.
+struct OverlayScene {
+  RectPX selection{};
+};
+
+struct OverlayStyle {
+  int32_t border_px = 2;
+  ColorRGBA border_color{255, 255, 255, 255};
+  // Used for a layer whose source bitmap is missing.
+  ColorRGBA fill_color{0, 0, 0, 255};
+};
+
+struct OverlayCompositorStats {
+  uint64_t frames = 0;
+  uint64_t skipped_frames = 0; // scene unchanged, nothing recomposed
+  uint64_t composed_pixels = 0;
+  uint64_t last_composed_pixels = 0;
+};
+
+// Retained compositor for the capture overlay: a persistent BGRA8 back buffer
+// showing the dimmed frame outside the selection, the bright frame inside it
+// and a border along its edge. Compose() only recomposes pixels whose layer
+// can differ between the previous and the new scene (both borders plus the
+// area covered by exactly one of the two selections) and does nothing when
+// the scene is unchanged. Not thread-safe; owned by the overlay's UI thread.
+class OverlayCompositor {
+public:
+  OverlayCompositor() = default;
+
+  // Sizes the back buffer (reusing it if the size is unchanged) and sets the
+  // layer sources. A source that is missing, not BGRA8 or not exactly `size`
+  // is drawn as style.fill_color; a missing bright layer means the selection
+  // is not highlighted. The next Compose() recomposes the whole buffer.
+  // Returns false (and leaves the compositor empty) if allocation fails.
+  bool Reset(const SizePX& size, BitmapView dimmed, BitmapView bright,
+             const OverlayStyle& style = OverlayStyle{});
+  void Clear();
+
+  // Brings the back buffer up to `scene`. Returns the disjoint rectangles
+  // that were recomposed; empty if nothing changed.
+  const std::vector<RectPX>& Compose(const OverlayScene& scene);
+  // Marks the whole buffer dirty for the next Compose().
+  void InvalidateAll() { full_dirty_ = true; }
+
+  bool valid() const { return pixels_ != nullptr; }
+  SizePX size_px() const { return size_; }
+  // Unowned view of the back buffer; valid until the next Reset()/Clear().
+  CpuBitmap BackBuffer() const;
+  const OverlayCompositorStats& Stats() const { return stats_; }
+
+private:
+  RectPX Bounds() const { return RectPX{0, 0, size_.w, size_.h}; }
+  void AppendBorder(const RectPX& selection, std::vector<RectPX>* out) const;
+  void ComposeRect(const RectPX& rect);
+
+  std::shared_ptr<uint8_t> pixels_;
+  SizePX size_{};
+  int32_t stride_bytes_ = 0;
+  BitmapView dimmed_;
+  BitmapView bright_;
+  OverlayStyle style_;
+
+  RectPX composed_selection_{}; // selection as last composed (unclipped)
+  bool full_dirty_ = true;
+  std::vector<RectPX> dirty_;
+  OverlayCompositorStats stats_;
+};
+
+} // namespace snappin
@@ -0,0 +1,442 @@
+#include "PinPixelStore.h"
+
+#include "PixelBufferPool.h"
+#include "PixelCodec.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+bool SameSize(const SizePX& a, const SizePX& b) { return a.w == b.w && a.h == b.h; }
+
+uint64_t ViewBytes(const BitmapView& view) { return view.valid() ? view.span_bytes() : 0; }
+
+// A display copy is worth keeping only below full size. Pins painted larger
+// than the image would be inflated again by their next paint, so they stay
+// resident.
+bool WantsDisplayCopy(const SizePX& display, const SizePX& full) {
+  return display.w > 0 && display.h > 0 && display.w <= full.w && display.h <= full.h &&
+         !SameSize(display, full);
+}
+
+bool Compressible(const SizePX& display, const SizePX& full) {
+  return display.w <= full.w && display.h <= full.h;
+}
+
+BitmapView ResampleCopy(const BitmapView& full, const SizePX& size) {
+  std::shared_ptr<uint8_t> pixels;
+  int32_t stride = 0;
+  if (!AcquirePixelBuffer(PixelBufferPool::Shared(), size, &pixels, &stride)) {
+    return BitmapView{};
+  }
+  CpuBitmap target;
+  target.format = full.format();
+  target.size_px = size;
+  target.stride_bytes = stride;
+  target.data.p = pixels.get();
+  // Idle compression only; paints never wait on this copy.
+  if (!ResizeLanczos(full.AsCpuBitmap(), &target, PixelKernelIsa::Auto,
+                     TaskPriority::Background)) {
+    return BitmapView{};
+  }
+  return BitmapView(std::move(pixels), size, stride, full.format());
+}
+
+} // namespace
+
+PinPixelStore::PinPixelStore(ScaledImageCache* scaled_cache, uint64_t idle_ms)
+    : scaled_cache_(scaled_cache), idle_ms_(idle_ms) {}
+
+PinPixelStore::~PinPixelStore() { Stop(); }
+
+bool PinPixelStore::Add(uint64_t key, BitmapView pixels, std::function<void()> on_compressed) {
+  if (!pixels.valid() || pixels.size_px().w <= 0 || pixels.size_px().h <= 0) {
+    return false;
+  }
+  Entry entry;
+  entry.size_px = pixels.size_px();
+  entry.full = std::move(pixels);
+  entry.last_paint_ms = NowMs();
+  entry.on_compressed = std::move(on_compressed);
+  std::lock_guard<std::mutex> lock(mu_);
+  entries_[key] = std::move(entry);
+  return true;
+}
+
+bool PinPixelStore::AddPacked(uint64_t key, std::vector<uint8_t> packed) {
+  Entry entry;
+  if (!PackedPixelsInfo(packed, &entry.size_px, nullptr)) {
+    return false;
+  }
+  entry.packed = std::make_shared<const std::vector<uint8_t>>(std::move(packed));
+  entry.last_paint_ms = NowMs();
+  std::lock_guard<std::mutex> lock(mu_);
+  entries_[key] = std::move(entry);
+  return true;
+}
+
+bool PinPixelStore::AddDeferred(uint64_t key, const SizePX& size_px,
+                                std::function<BitmapView()> load,
+                                std::function<void(bool)> on_loaded) {
+  if (!load || size_px.w <= 0 || size_px.h <= 0) {
+    return false;
+  }
+  Entry entry;
+  entry.size_px = size_px;
+  entry.last_paint_ms = NowMs();
+  entry.load = std::move(load);
+  entry.on_loaded = std::move(on_loaded);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    entries_[key] = std::move(entry);
+    loads_pending_ = true;
+  }
+  wake_.notify_all();
+  return true;
+}
+
+void PinPixelStore::Remove(uint64_t key) {
+  Entry dropped;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return;
+    }
+    dropped = std::move(it->second);
+    entries_.erase(it);
+  }
+  // Pixels go back to the pool outside the lock.
+}
+
+bool PinPixelStore::Contains(uint64_t key) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return entries_.count(key) != 0;
+}
+
+bool PinPixelStore::PixelSize(uint64_t key, SizePX* size_px) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  if (size_px) {
+    *size_px = it->second.size_px;
+  }
+  return true;
+}
+
+BitmapView PinPixelStore::ForPaint(uint64_t key, const SizePX& display, uint64_t now_ms) {
+  std::unique_lock<std::mutex> lock(mu_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return BitmapView{};
+  }
+  if (it->second.load) {
+    // Without a worker nothing else will load it.
+    if (worker_.joinable()) {
+      return BitmapView{};
+    }
+    LoadDeferred(&lock, key);
+    it = entries_.find(key);
+    if (it == entries_.end() || !it->second.full.valid()) {
+      return BitmapView{};
+    }
+  }
+  Entry& entry = it->second;
+  entry.display_size = display;
+  if (entry.full.valid()) {
+    entry.last_paint_ms = now_ms;
+    return entry.full;
+  }
+  if (!entry.packed) {
+    return BitmapView{}; // its deferred load failed
+  }
+  if (entry.display.valid() && SameSize(entry.display.size_px(), display)) {
+    return entry.display;
+  }
+  // Full-size pins keep no display copy; painting one makes it resident
+  // again instead of decoding it on every repaint.
+  return Inflate(&lock, key, now_ms);
+}
+
+BitmapView PinPixelStore::Full(uint64_t key, uint64_t now_ms) {
+  std::unique_lock<std::mutex> lock(mu_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return BitmapView{};
+  }
+  if (it->second.load) {
+    return LoadDeferred(&lock, key);
+  }
+  if (it->second.full.valid()) {
+    it->second.last_paint_ms = now_ms;
+    return it->second.full;
+  }
+  if (!it->second.packed) {
+    return BitmapView{};
+  }
+  return Inflate(&lock, key, now_ms);
+}
+
+size_t PinPixelStore::CompressIdle(uint64_t now_ms) {
+  struct Candidate {
+    uint64_t key = 0;
+    BitmapView full;
+    SizePX display_size{};
+    uint64_t last_paint_ms = 0;
+  };
+  std::vector<Candidate> candidates;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (idle_ms_ == 0) {
+      return 0;
+    }
+    for (const auto& kv : entries_) {
+      const Entry& entry = kv.second;
+      if (entry.full.valid() && now_ms >= entry.last_paint_ms &&
+          now_ms - entry.last_paint_ms >= idle_ms_ &&
+          Compressible(entry.display_size, entry.size_px)) {
+        candidates.push_back({kv.first, entry.full, entry.display_size, entry.last_paint_ms});
+      }
+    }
+  }
+
+  size_t compressed = 0;
+  for (Candidate& c : candidates) {
+    std::vector<uint8_t> packed;
+    if (!CompressPixels(c.full, &packed)) {
+      continue;
+    }
+    BitmapView display;
+    if (WantsDisplayCopy(c.display_size, c.full.size_px())) {
+      if (scaled_cache_) {
+        display = scaled_cache_->Scaled(c.key, c.full, c.display_size);
+      }
+      if (!display.valid()) {
+        display = ResampleCopy(c.full, c.display_size);
+      }
+      if (!display.valid()) {
+        continue;
+      }
+    }
+    std::function<void()> on_compressed;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      auto it = entries_.find(c.key);
+      // Skip pins that were painted, zoomed or replaced meanwhile.
+      if (it == entries_.end() || !it->second.full.SharesBufferWith(c.full) ||
+          it->second.last_paint_ms != c.last_paint_ms ||
+          !SameSize(it->second.display_size, c.display_size)) {
+        continue;
+      }
+      Entry& entry = it->second;
+      entry.full = BitmapView{};
+      entry.packed = std::make_shared<const std::vector<uint8_t>>(std::move(packed));
+      entry.display = std::move(display);
+      on_compressed = std::move(entry.on_compressed);
+      entry.on_compressed = nullptr;
+      ++compressions_;
+    }
+    ++compressed;
+    if (scaled_cache_) {
+      scaled_cache_->Remove(c.key);
+    }
+    if (on_compressed) {
+      on_compressed();
+    }
+  }
+  return compressed;
+}
+
+void PinPixelStore::SetIdleMs(uint64_t idle_ms) {
+  std::lock_guard<std::mutex> lock(mu_);
+  idle_ms_ = idle_ms;
+}
+
+void PinPixelStore::SetDecodeHook(std::function<void(uint64_t key)> hook) {
+  std::lock_guard<std::mutex> lock(mu_);
+  decode_hook_ = std::move(hook);
+}
+
+void PinPixelStore::Start() {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (worker_.joinable()) {
+    return;
+  }
+  stopping_ = false;
+  worker_ = std::thread([this] { WorkerLoop(); });
+}
+
+void PinPixelStore::Stop() {
+  std::thread worker;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+    worker = std::move(worker_);
+  }
+  wake_.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+PinPixelStoreStats PinPixelStore::Stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  PinPixelStoreStats stats;
+  stats.pins = entries_.size();
+  for (const auto& kv : entries_) {
+    const Entry& entry = kv.second;
+    if (entry.full.valid()) {
+      stats.uncompressed_bytes += ViewBytes(entry.full);
+      continue;
+    }
+    if (entry.load) {
+      ++stats.deferred_pins;
+      continue;
+    }
+    if (!entry.packed) {
+      continue; // deferred load failed
+    }
+    ++stats.compressed_pins;
+    stats.compressed_bytes += entry.packed->size();
+    stats.compressed_source_bytes +=
+        static_cast<uint64_t>(entry.size_px.w) * static_cast<uint64_t>(entry.size_px.h) * 4;
+    stats.display_bytes += ViewBytes(entry.display);
+  }
+  stats.compressions = compressions_;
+  stats.decompressions = decompressions_;
+  stats.deferred_loads = deferred_loads_;
+  stats.deferred_failures = deferred_failures_;
+  return stats;
+}
+
+uint64_t PinPixelStore::NowMs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+PinPixelStore& PinPixelStore::Shared() {
+  static PinPixelStore store(&ScaledImageCache::Shared());
+  return store;
+}
+
+BitmapView PinPixelStore::Inflate(std::unique_lock<std::mutex>* lock, uint64_t key,
+                                  uint64_t now_ms) {
+  auto it = entries_.find(key);
+  const std::shared_ptr<const std::vector<uint8_t>> packed = it->second.packed;
+  const std::function<void(uint64_t)> hook = decode_hook_;
+  lock->unlock();
+  if (hook) {
+    hook(key);
+  }
+  BitmapView full = DecompressPixels(*packed);
+  lock->lock();
+  if (!full.valid()) {
+    return BitmapView{};
+  }
+  it = entries_.find(key);
+  if (it == entries_.end() || it->second.packed != packed) {
+    // Removed or replaced meanwhile; the caller still gets what it asked for.
+    return full;
+  }
+  Entry& entry = it->second;
+  entry.last_paint_ms = now_ms;
+  if (entry.full.valid()) {
+    return entry.full; // another thread inflated it first
+  }
+  entry.full = full;
+  entry.packed = nullptr;
+  entry.display = BitmapView{};
+  ++decompressions_;
+  return full;
+}
+
+BitmapView PinPixelStore::LoadDeferred(std::unique_lock<std::mutex>* lock, uint64_t key) {
+  auto it = entries_.find(key);
+  while (it != entries_.end() && it->second.loading) {
+    loaded_.wait(*lock);
+    it = entries_.find(key);
+  }
+  if (it == entries_.end()) {
+    return BitmapView{};
+  }
+  if (!it->second.load) {
+    return it->second.full;
+  }
+  it->second.loading = true;
+  const std::function<BitmapView()> load = it->second.load;
+  const SizePX size_px = it->second.size_px;
+  lock->unlock();
+  BitmapView pixels = load();
+  const bool ok = pixels.valid() && SameSize(pixels.size_px(), size_px);
+  lock->lock();
+
+  std::function<void(bool)> on_loaded;
+  it = entries_.find(key);
+  // Skip pins removed or replaced meanwhile.
+  if (it != entries_.end() && it->second.loading) {
+    Entry& entry = it->second;
+    entry.loading = false;
+    entry.load = nullptr;
+    on_loaded = std::move(entry.on_loaded);
+    entry.on_loaded = nullptr;
+    if (ok) {
+      entry.full = pixels;
+      entry.last_paint_ms = NowMs();
+      ++deferred_loads_;
+    } else {
+      ++deferred_failures_;
+    }
+  }
+  loaded_.notify_all();
+  if (on_loaded) {
+    lock->unlock();
+    on_loaded(ok);
+    lock->lock();
+  }
+  return ok ? pixels : BitmapView{};
+}
+
+void PinPixelStore::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!stopping_) {
+    const uint64_t interval =
+        idle_ms_ == 0 ? 1000 : std::clamp<uint64_t>(idle_ms_ / 4, 250, 5000);
+    wake_.wait_for(lock, std::chrono::milliseconds(interval),
+                   [this] { return stopping_ || loads_pending_; });
+    if (stopping_) {
+      break;
+    }
+    // Deferred loads first: their windows are showing placeholders.
+    while (loads_pending_ && !stopping_) {
+      loads_pending_ = false;
+      std::vector<uint64_t> keys;
+      for (const auto& kv : entries_) {
+        if (kv.second.load && !kv.second.loading) {
+          keys.push_back(kv.first);
+        }
+      }
+      for (uint64_t key : keys) {
+        if (stopping_) {
+          break;
+        }
+        LoadDeferred(&lock, key);
+      }
+    }
+    if (stopping_) {
+      break;
+    }
+    lock.unlock();
+    CompressIdle(NowMs());
+    lock.lock();
+  }
+}
+
+} // namespace snappin
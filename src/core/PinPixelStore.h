@@ -0,0 +1,145 @@
+#pragma once
+#include "ScaledImageCache.h"
+#include "Types.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace snappin {
+
+struct PinPixelStoreStats {
+  uint64_t pins = 0;
+  uint64_t compressed_pins = 0;
+  // Full-resolution pixels held as is (possibly shared with their artifact).
+  uint64_t uncompressed_bytes = 0;
+  // PixelCodec blobs of idle pins, and the pixel bytes they stand for.
+  uint64_t compressed_bytes = 0;
+  uint64_t compressed_source_bytes = 0;
+  // Display-resolution copies kept for idle pins shown smaller than 100%.
+  uint64_t display_bytes = 0;
+  uint64_t compressions = 0;
+  uint64_t decompressions = 0; // back to full resolution (copy, save, paint)
+  uint64_t deferred_pins = 0;  // registered with AddDeferred, not loaded yet
+  uint64_t deferred_loads = 0;
+  uint64_t deferred_failures = 0;
+};
+
+// Pixels of image pins, keyed by pin id. Pins not painted for the idle time
+// are compressed with PixelCodec (by CompressIdle or the background worker);
+// only a copy at the size they were last painted stays resident, taken from
+// the ScaledImageCache entry under the same key when there is one, which is
+// then dropped. Pins shown at full size keep no copy. Asking for full
+// resolution, or painting at a size without a copy, decompresses the pin and
+// restarts its idle clock.
+// Pins restored from a session can be registered before their pixels are
+// read (AddDeferred); the worker loads them, and until then they paint
+// nothing. Thread-safe.
+class PinPixelStore {
+public:
+  static constexpr uint64_t kDefaultIdleMs = 30000;
+
+  // scaled_cache may be null.
+  explicit PinPixelStore(ScaledImageCache* scaled_cache = nullptr,
+                         uint64_t idle_ms = kDefaultIdleMs);
+  ~PinPixelStore();
+  PinPixelStore(const PinPixelStore&) = delete;
+  PinPixelStore& operator=(const PinPixelStore&) = delete;
+
+  // Registers a pin's pixels; false if they are invalid. on_compressed runs
+  // once, the first time the pin is compressed, on the compressing thread
+  // with no lock held (PinManager releases the source artifact there).
+  bool Add(uint64_t key, BitmapView pixels, std::function<void()> on_compressed = {});
+  // Registers a pin already in PixelCodec form (a restored session), as if it
+  // had gone idle; false if `packed` has no valid header.
+  bool AddPacked(uint64_t key, std::vector<uint8_t> packed);
+  // Registers a pin of `size_px` whose pixels `load` reads later, with no
+  // lock held: on the worker (woken at once) or, if it is not running, on
+  // the first ForPaint; Full() loads it or waits for the load in progress.
+  // ForPaint returns nothing until then, so the window paints a placeholder.
+  // Loaded pixels stay resident like a new pin's. on_loaded runs once on the
+  // loading thread, with whether `load` produced pixels of `size_px`; a pin
+  // that failed stays registered without pixels.
+  bool AddDeferred(uint64_t key, const SizePX& size_px, std::function<BitmapView()> load,
+                   std::function<void(bool)> on_loaded = {});
+  void Remove(uint64_t key);
+  bool Contains(uint64_t key) const;
+  // Full-resolution size of a pin without decompressing it.
+  bool PixelSize(uint64_t key, SizePX* size_px) const;
+
+  // What to draw into a `display`-sized window: the full image while it is
+  // resident, else the display copy when it matches, else a decode. Decodes
+  // run with the store unlocked. Empty for unknown keys, pins still waiting
+  // for their deferred load, or when decompression fails.
+  BitmapView ForPaint(uint64_t key, const SizePX& display, uint64_t now_ms = NowMs());
+  // Full-resolution pixels, decompressing if needed.
+  BitmapView Full(uint64_t key, uint64_t now_ms = NowMs());
+
+  // Compresses every resident pin last painted at least the idle time before
+  // now_ms; returns how many. Does nothing when the idle time is 0.
+  size_t CompressIdle(uint64_t now_ms = NowMs());
+  void SetIdleMs(uint64_t idle_ms);
+  // Runs on the decoding thread with the store unlocked, just before a
+  // compressed pin is decoded. For tests that hold a decode open.
+  void SetDecodeHook(std::function<void(uint64_t key)> hook);
+
+  // Runs CompressIdle on a worker thread every quarter of the idle time
+  // (between 0.25 s and 5 s). Stop() joins it; the destructor stops it too.
+  void Start();
+  void Stop();
+
+  PinPixelStoreStats Stats() const;
+
+  static uint64_t NowMs();
+  // Process-wide store used by PinManager and PinWindow, over
+  // ScaledImageCache::Shared().
+  static PinPixelStore& Shared();
+
+private:
+  struct Entry {
+    BitmapView full;
+    SizePX size_px{};
+    // Shared so a decode can hold it with the store unlocked; replaced, never
+    // modified, so pointer equality tells a decode its entry is unchanged.
+    std::shared_ptr<const std::vector<uint8_t>> packed;
+    BitmapView display;
+    SizePX display_size{};
+    uint64_t last_paint_ms = 0;
+    std::function<void()> on_compressed;
+    // Set until a deferred load finishes; `loading` while a thread runs it.
+    std::function<BitmapView()> load;
+    std::function<void(bool)> on_loaded;
+    bool loading = false;
+  };
+
+  // Decodes `key`'s packed pixels with `lock` released and makes them
+  // resident, unless the pin was inflated, replaced or removed meanwhile.
+  BitmapView Inflate(std::unique_lock<std::mutex>* lock, uint64_t key, uint64_t now_ms);
+  // Runs the deferred load of `key`, or waits for the thread running it.
+  // Unlocks `lock` meanwhile. Empty when the load failed or the pin is gone.
+  BitmapView LoadDeferred(std::unique_lock<std::mutex>* lock, uint64_t key);
+  void WorkerLoop();
+
+  ScaledImageCache* scaled_cache_ = nullptr;
+  mutable std::mutex mu_;
+  std::unordered_map<uint64_t, Entry> entries_;
+  uint64_t idle_ms_ = 0;
+  std::function<void(uint64_t)> decode_hook_;
+  uint64_t compressions_ = 0;
+  uint64_t decompressions_ = 0;
+  uint64_t deferred_loads_ = 0;
+  uint64_t deferred_failures_ = 0;
+  std::condition_variable wake_;
+  std::condition_variable loaded_;
+  bool loads_pending_ = false;
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+} // namespace snappin
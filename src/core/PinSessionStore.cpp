@@ -0,0 +1,637 @@
+#include "PinSessionStore.h"
+
+#include "Crc32.h"
+#include "MappedFile.h"
+#include "PixelBufferPool.h"
+#include "PixelCodec.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+constexpr uint32_t kFileMagic = 0x4E535053u;   // "SPSN"
+constexpr uint32_t kRecordMagic = 0x43525053u; // "SPRC"
+constexpr uint32_t kVersion = 1;
+constexpr uint64_t kFileHeaderBytes = 32;
+constexpr uint64_t kRecordHeaderBytes = 32;
+constexpr uint64_t kMetaBytes = 32;
+constexpr uint64_t kPixelHeaderBytes = 16;
+
+constexpr uint8_t kTypeMeta = 1;
+constexpr uint8_t kTypePixels = 2;
+constexpr uint8_t kTypeRemove = 3;
+
+void StoreLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+  }
+}
+
+void StoreLe64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; ++i) {
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+  }
+}
+
+uint32_t LoadLe32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; --i) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+uint64_t LoadLe64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; --i) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+uint64_t Padded(uint64_t n) { return (n + 7) & ~uint64_t{7}; }
+
+std::vector<uint8_t> EncodeMeta(const PinSessionMeta& meta) {
+  std::vector<uint8_t> out(kMetaBytes, 0);
+  StoreLe32(out.data(), static_cast<uint32_t>(meta.pos_px.x));
+  StoreLe32(out.data() + 4, static_cast<uint32_t>(meta.pos_px.y));
+  StoreLe32(out.data() + 8, std::bit_cast<uint32_t>(meta.scale));
+  StoreLe32(out.data() + 12, std::bit_cast<uint32_t>(meta.opacity));
+  out[16] = meta.locked ? 1 : 0;
+  out[17] = meta.always_on_top ? 1 : 0;
+  out[18] = meta.visible ? 1 : 0;
+  return out;
+}
+
+PinSessionMeta DecodeMeta(const uint8_t* p) {
+  PinSessionMeta meta;
+  meta.pos_px.x = static_cast<int32_t>(LoadLe32(p));
+  meta.pos_px.y = static_cast<int32_t>(LoadLe32(p + 4));
+  meta.scale = std::bit_cast<float>(LoadLe32(p + 8));
+  meta.opacity = std::bit_cast<float>(LoadLe32(p + 12));
+  meta.locked = p[16] != 0;
+  meta.always_on_top = p[17] != 0;
+  meta.visible = p[18] != 0;
+  return meta;
+}
+
+bool EncodePixels(const BitmapView& pixels, PinSessionEncoding encoding,
+                  std::vector<uint8_t>* out) {
+  const SizePX size = pixels.size_px();
+  uint8_t header[kPixelHeaderBytes] = {};
+  StoreLe32(header, static_cast<uint32_t>(size.w));
+  StoreLe32(header + 4, static_cast<uint32_t>(size.h));
+  header[8] = pixels.format() == PixelFormat::BGRA8 ? 1 : 0;
+  header[9] = static_cast<uint8_t>(encoding);
+  if (encoding == PinSessionEncoding::Packed) {
+    std::vector<uint8_t> packed;
+    if (!CompressPixels(pixels, &packed)) {
+      return false;
+    }
+    out->assign(header, header + kPixelHeaderBytes);
+    out->insert(out->end(), packed.begin(), packed.end());
+    return true;
+  }
+  const size_t row_bytes = static_cast<size_t>(size.w) * 4;
+  out->assign(kPixelHeaderBytes + row_bytes * static_cast<size_t>(size.h), 0);
+  std::memcpy(out->data(), header, kPixelHeaderBytes);
+  for (int32_t y = 0; y < size.h; ++y) {
+    std::memcpy(out->data() + kPixelHeaderBytes + static_cast<size_t>(y) * row_bytes,
+                pixels.row(y), row_bytes);
+  }
+  return true;
+}
+
+} // namespace
+
+PinSessionStore::PinSessionStore() = default;
+
+PinSessionStore::~PinSessionStore() { Close(); }
+
+bool PinSessionStore::Open(const std::filesystem::path& path) {
+  Close();
+  {
+    std::lock_guard<std::mutex> lock(file_mu_);
+    if (!OpenLocked(path)) {
+      CloseLocked();
+      return false;
+    }
+  }
+  std::lock_guard<std::mutex> lock(queue_mu_);
+  stopping_ = false;
+  write_failed_ = false;
+  writer_ = std::thread([this] { WriterLoop(); });
+  return true;
+}
+
+void PinSessionStore::Close() {
+  std::thread writer;
+  {
+    std::lock_guard<std::mutex> lock(queue_mu_);
+    stopping_ = true;
+    writer = std::move(writer_);
+  }
+  queue_cv_.notify_all();
+  if (writer.joinable()) {
+    writer.join();
+  }
+  std::lock_guard<std::mutex> lock(file_mu_);
+  CloseLocked();
+}
+
+bool PinSessionStore::is_open() const {
+  std::lock_guard<std::mutex> lock(file_mu_);
+  return file_ != nullptr;
+}
+
+std::vector<uint64_t> PinSessionStore::Keys() const {
+  std::lock_guard<std::mutex> lock(file_mu_);
+  std::vector<std::pair<uint64_t, uint64_t>> ordered;
+  ordered.reserve(pins_.size());
+  for (const auto& kv : pins_) {
+    ordered.emplace_back(kv.second.order, kv.first);
+  }
+  std::sort(ordered.begin(), ordered.end());
+  std::vector<uint64_t> keys;
+  keys.reserve(ordered.size());
+  for (const auto& entry : ordered) {
+    keys.push_back(entry.second);
+  }
+  return keys;
+}
+
+bool PinSessionStore::Meta(uint64_t key, PinSessionMeta* out) const {
+  std::lock_guard<std::mutex> lock(file_mu_);
+  auto it = pins_.find(key);
+  if (it == pins_.end() || !it->second.has_meta) {
+    return false;
+  }
+  if (out) {
+    *out = it->second.meta;
+  }
+  return true;
+}
+
+bool PinSessionStore::PixelInfo(uint64_t key, SizePX* size_px, PixelFormat* format) const {
+  std::lock_guard<std::mutex> lock(file_mu_);
+  auto it = pins_.find(key);
+  if (it == pins_.end() || !it->second.has_pixels) {
+    return false;
+  }
+  if (size_px) {
+    *size_px = it->second.size_px;
+  }
+  if (format) {
+    *format = it->second.format;
+  }
+  return true;
+}
+
+bool PinSessionStore::PackedPixels(uint64_t key, std::vector<uint8_t>* out) {
+  std::lock_guard<std::mutex> lock(file_mu_);
+  auto it = pins_.find(key);
+  if (!out || it == pins_.end() || !it->second.has_pixels ||
+      it->second.encoding != PinSessionEncoding::Packed) {
+    return false;
+  }
+  const uint8_t* payload = PixelPayloadLocked(&it->second);
+  if (!payload) {
+    return false;
+  }
+  const uint64_t bytes = LoadLe32(payload - kRecordHeaderBytes + 16);
+  out->assign(payload + kPixelHeaderBytes, payload + bytes);
+  return true;
+}
+
+BitmapView PinSessionStore::Pixels(uint64_t key) {
+  std::lock_guard<std::mutex> lock(file_mu_);
+  auto it = pins_.find(key);
+  if (it == pins_.end() || !it->second.has_pixels) {
+    return BitmapView{};
+  }
+  Pin& pin = it->second;
+  const uint8_t* payload = PixelPayloadLocked(&pin);
+  if (!payload) {
+    return BitmapView{};
+  }
+  if (pin.encoding == PinSessionEncoding::Packed) {
+    const uint64_t bytes = LoadLe32(payload - kRecordHeaderBytes + 16);
+    return DecompressPixels(payload + kPixelHeaderBytes,
+                            static_cast<size_t>(bytes - kPixelHeaderBytes));
+  }
+  std::shared_ptr<uint8_t> pixels;
+  int32_t stride = 0;
+  if (!AcquirePixelBuffer(PixelBufferPool::Shared(), pin.size_px, &pixels, &stride)) {
+    return BitmapView{};
+  }
+  const size_t row_bytes = static_cast<size_t>(pin.size_px.w) * 4;
+  for (int32_t y = 0; y < pin.size_px.h; ++y) {
+    std::memcpy(pixels.get() + static_cast<size_t>(y) * static_cast<size_t>(stride),
+                payload + kPixelHeaderBytes + static_cast<size_t>(y) * row_bytes, row_bytes);
+  }
+  return BitmapView(std::move(pixels), pin.size_px, stride, pin.format);
+}
+
+bool PinSessionStore::PutPixels(uint64_t key, BitmapView pixels, PinSessionEncoding encoding) {
+  if (!pixels.valid() || pixels.size_px().w <= 0 || pixels.size_px().h <= 0) {
+    return false;
+  }
+  Op op;
+  op.kind = Op::Kind::Pixels;
+  op.key = key;
+  op.pixels = std::move(pixels);
+  op.encoding = encoding;
+  return Enqueue(std::move(op));
+}
+
+bool PinSessionStore::PutMeta(uint64_t key, const PinSessionMeta& meta) {
+  Op op;
+  op.kind = Op::Kind::Meta;
+  op.key = key;
+  op.meta = meta;
+  return Enqueue(std::move(op));
+}
+
+bool PinSessionStore::Remove(uint64_t key) {
+  Op op;
+  op.kind = Op::Kind::Remove;
+  op.key = key;
+  return Enqueue(std::move(op));
+}
+
+bool PinSessionStore::Flush() {
+  std::unique_lock<std::mutex> lock(queue_mu_);
+  if (!writer_.joinable()) {
+    return false;
+  }
+  idle_cv_.wait(lock, [this] { return queue_.empty() && !writing_; });
+  return !write_failed_;
+}
+
+bool PinSessionStore::Compact() {
+  std::lock_guard<std::mutex> lock(file_mu_);
+  return CompactLocked(true);
+}
+
+void PinSessionStore::SetCompactMinDeadBytes(uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(file_mu_);
+  compact_min_dead_bytes_ = bytes;
+}
+
+PinSessionStats PinSessionStore::Stats() const {
+  PinSessionStats stats;
+  {
+    std::lock_guard<std::mutex> lock(file_mu_);
+    stats.pins = pins_.size();
+    stats.file_bytes = file_ ? file_->size() : 0;
+    stats.live_bytes = LiveBytesLocked();
+    stats.records_written = records_written_;
+    stats.compactions = compactions_;
+    stats.torn_bytes = torn_bytes_;
+    stats.corrupt_pixels = corrupt_pixels_;
+  }
+  std::lock_guard<std::mutex> lock(queue_mu_);
+  stats.pending = queue_.size() + (writing_ ? 1 : 0);
+  return stats;
+}
+
+bool PinSessionStore::Enqueue(Op op) {
+  {
+    std::lock_guard<std::mutex> lock(queue_mu_);
+    if (!writer_.joinable() || stopping_) {
+      return false;
+    }
+    // A drag produces a run of meta updates for one pin; keep the last.
+    if (op.kind == Op::Kind::Meta && !queue_.empty() &&
+        queue_.back().kind == Op::Kind::Meta && queue_.back().key == op.key) {
+      queue_.back().meta = op.meta;
+      return true;
+    }
+    queue_.push_back(std::move(op));
+  }
+  queue_cv_.notify_one();
+  return true;
+}
+
+void PinSessionStore::WriterLoop() {
+  std::unique_lock<std::mutex> lock(queue_mu_);
+  for (;;) {
+    queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      break; // stopping, and everything accepted is written
+    }
+    Op op = std::move(queue_.front());
+    queue_.pop_front();
+    writing_ = true;
+    lock.unlock();
+
+    // Encoding runs without either lock.
+    std::vector<uint8_t> payload;
+    uint8_t type = kTypeRemove;
+    bool ok = true;
+    if (op.kind == Op::Kind::Pixels) {
+      type = kTypePixels;
+      ok = EncodePixels(op.pixels, op.encoding, &payload);
+      op.pixels = BitmapView{};
+    } else if (op.kind == Op::Kind::Meta) {
+      type = kTypeMeta;
+      payload = EncodeMeta(op.meta);
+    }
+    {
+      std::lock_guard<std::mutex> file_lock(file_mu_);
+      ok = ok && AppendLocked(type, op.key, payload);
+      if (ok && type == kTypePixels) {
+        ok = file_->Sync();
+      }
+      if (ok) {
+        CompactLocked(false);
+      }
+    }
+
+    lock.lock();
+    write_failed_ = write_failed_ || !ok;
+    if (queue_.empty()) {
+      lock.unlock();
+      bool synced = false;
+      {
+        std::lock_guard<std::mutex> file_lock(file_mu_);
+        synced = file_ && file_->Sync();
+      }
+      lock.lock();
+      write_failed_ = write_failed_ || !synced;
+    }
+    writing_ = false;
+    idle_cv_.notify_all();
+  }
+}
+
+bool PinSessionStore::OpenLocked(const std::filesystem::path& path) {
+  path_ = path;
+  std::error_code ec;
+  std::filesystem::path tmp = path;
+  tmp += ".tmp";
+  // Left over from a compaction that did not reach its rename.
+  std::filesystem::remove(tmp, ec);
+
+  file_ = std::make_unique<MappedFile>();
+  if (!file_->Open(path)) {
+    return false;
+  }
+  pins_.clear();
+  next_order_ = 0;
+  torn_bytes_ = 0;
+
+  const uint64_t size = file_->size();
+  if (size < kFileHeaderBytes) {
+    // New, or a crash before the header was complete: start over.
+    uint8_t header[kFileHeaderBytes] = {};
+    StoreLe32(header, kFileMagic);
+    StoreLe32(header + 4, kVersion);
+    torn_bytes_ = size;
+    return file_->Truncate(0) && file_->Append(header, sizeof(header)) && file_->Sync();
+  }
+  const uint8_t* base = file_->Map(size);
+  if (!base || LoadLe32(base) != kFileMagic || LoadLe32(base + 4) != kVersion) {
+    return false;
+  }
+  uint64_t valid_end = kFileHeaderBytes;
+  Scan(size, &valid_end);
+  if (valid_end < size) {
+    torn_bytes_ = size - valid_end;
+    return file_->Truncate(valid_end) && file_->Sync();
+  }
+  return true;
+}
+
+void PinSessionStore::CloseLocked() {
+  if (file_) {
+    file_->Sync();
+    file_.reset();
+  }
+  pins_.clear();
+}
+
+bool PinSessionStore::Scan(uint64_t file_size, uint64_t* valid_end) {
+  const uint8_t* base = file_->Map(file_size);
+  uint64_t off = kFileHeaderBytes;
+  while (off + kRecordHeaderBytes <= file_size) {
+    const uint8_t* h = base + off;
+    if (LoadLe32(h) != kRecordMagic || LoadLe32(h + 28) != UpdateCrc32(0, h, 28)) {
+      break;
+    }
+    const uint8_t type = h[4];
+    const uint64_t key = LoadLe64(h + 8);
+    const uint64_t len = LoadLe32(h + 16);
+    const uint32_t payload_crc = LoadLe32(h + 20);
+    const uint64_t bytes = kRecordHeaderBytes + Padded(len);
+    if (bytes > file_size - off) {
+      break;
+    }
+    const uint8_t* payload = h + kRecordHeaderBytes;
+    if (type == kTypeMeta) {
+      if (len != kMetaBytes || UpdateCrc32(0, payload, kMetaBytes) != payload_crc) {
+        break;
+      }
+      Pin& pin = pins_[key];
+      if (!pin.has_meta && !pin.has_pixels) {
+        pin.order = next_order_++;
+      }
+      pin.has_meta = true;
+      pin.meta = DecodeMeta(payload);
+      pin.meta_span = Span{off, bytes};
+    } else if (type == kTypePixels) {
+      // Only the small pixel header is read here; the checksum over the
+      // whole payload is verified on first read.
+      if (len < kPixelHeaderBytes || payload[8] > 1 || payload[9] > 1) {
+        break;
+      }
+      SizePX size;
+      size.w = static_cast<int32_t>(LoadLe32(payload));
+      size.h = static_cast<int32_t>(LoadLe32(payload + 4));
+      const auto encoding = static_cast<PinSessionEncoding>(payload[9]);
+      const uint64_t raw_bytes =
+          kPixelHeaderBytes + uint64_t{4} * static_cast<uint32_t>(size.w) *
+                                  static_cast<uint32_t>(size.h);
+      if (size.w <= 0 || size.h <= 0 ||
+          (encoding == PinSessionEncoding::Raw && len != raw_bytes)) {
+        break;
+      }
+      Pin& pin = pins_[key];
+      if (!pin.has_meta && !pin.has_pixels) {
+        pin.order = next_order_++;
+      }
+      pin.has_pixels = true;
+      pin.pixel_span = Span{off, bytes};
+      pin.size_px = size;
+      pin.format = payload[8] == 1 ? PixelFormat::BGRA8 : PixelFormat::RGBA8;
+      pin.encoding = encoding;
+      pin.payload_crc = payload_crc;
+      pin.verified = false;
+    } else if (type == kTypeRemove) {
+      if (len != 0) {
+        break;
+      }
+      pins_.erase(key);
+    } else {
+      break;
+    }
+    off += bytes;
+  }
+  *valid_end = off;
+  return off == file_size;
+}
+
+bool PinSessionStore::AppendLocked(uint8_t type, uint64_t key,
+                                   const std::vector<uint8_t>& payload) {
+  if (!file_) {
+    return false;
+  }
+  const uint64_t offset = file_->size();
+  uint8_t h[kRecordHeaderBytes] = {};
+  StoreLe32(h, kRecordMagic);
+  h[4] = type;
+  StoreLe64(h + 8, key);
+  StoreLe32(h + 16, static_cast<uint32_t>(payload.size()));
+  StoreLe32(h + 20, UpdateCrc32(0, payload.data(), payload.size()));
+  StoreLe32(h + 28, UpdateCrc32(0, h, 28));
+  const uint8_t pad[8] = {};
+  const size_t pad_bytes = static_cast<size_t>(Padded(payload.size()) - payload.size());
+  if (!file_->Append(h, sizeof(h)) || !file_->Append(payload.data(), payload.size()) ||
+      !file_->Append(pad, pad_bytes)) {
+    // Cut the partial record so later appends stay reachable.
+    file_->Truncate(offset);
+    return false;
+  }
+  ++records_written_;
+
+  const Span span{offset, kRecordHeaderBytes + Padded(payload.size())};
+  if (type == kTypeRemove) {
+    pins_.erase(key);
+    return true;
+  }
+  auto inserted = pins_.try_emplace(key);
+  Pin& pin = inserted.first->second;
+  if (inserted.second) {
+    pin.order = next_order_++;
+  }
+  if (type == kTypeMeta) {
+    pin.has_meta = true;
+    pin.meta = DecodeMeta(payload.data());
+    pin.meta_span = span;
+  } else {
+    pin.has_pixels = true;
+    pin.pixel_span = span;
+    pin.size_px.w = static_cast<int32_t>(LoadLe32(payload.data()));
+    pin.size_px.h = static_cast<int32_t>(LoadLe32(payload.data() + 4));
+    pin.format = payload[8] == 1 ? PixelFormat::BGRA8 : PixelFormat::RGBA8;
+    pin.encoding = static_cast<PinSessionEncoding>(payload[9]);
+    pin.payload_crc = LoadLe32(h + 20);
+    pin.verified = true;
+  }
+  return true;
+}
+
+bool PinSessionStore::CompactLocked(bool force) {
+  if (!file_) {
+    return false;
+  }
+  const uint64_t live = LiveBytesLocked();
+  const uint64_t dead = file_->size() - kFileHeaderBytes - live;
+  if (dead == 0 || (!force && (dead < live || dead < compact_min_dead_bytes_))) {
+    return true;
+  }
+  const uint8_t* base = file_->Map(file_->size());
+  if (!base) {
+    return false;
+  }
+  std::vector<std::pair<uint64_t, const Pin*>> ordered;
+  for (const auto& kv : pins_) {
+    ordered.emplace_back(kv.second.order, &kv.second);
+  }
+  std::sort(ordered.begin(), ordered.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  std::filesystem::path tmp = path_;
+  tmp += ".tmp";
+  bool ok = false;
+  {
+    MappedFile out;
+    ok = out.Open(tmp) && out.Truncate(0) && out.Append(base, kFileHeaderBytes);
+    // Records are position-independent, so live ones are copied verbatim.
+    for (const auto& entry : ordered) {
+      const Pin& pin = *entry.second;
+      if (ok && pin.has_pixels) {
+        ok = out.Append(base + pin.pixel_span.offset, pin.pixel_span.bytes);
+      }
+      if (ok && pin.has_meta) {
+        ok = out.Append(base + pin.meta_span.offset, pin.meta_span.bytes);
+      }
+    }
+    ok = ok && out.Sync();
+  }
+  std::error_code ec;
+  if (!ok) {
+    std::filesystem::remove(tmp, ec);
+    return false;
+  }
+  // The rename needs the original unmapped and closed on Windows.
+  file_.reset();
+  ok = MappedFile::Replace(tmp, path_);
+  if (!ok) {
+    std::filesystem::remove(tmp, ec);
+  }
+  const uint64_t torn = torn_bytes_;
+  if (!OpenLocked(path_)) {
+    file_.reset();
+    pins_.clear();
+    return false;
+  }
+  torn_bytes_ = torn;
+  if (ok) {
+    ++compactions_;
+  }
+  return ok;
+}
+
+const uint8_t* PinSessionStore::PixelPayloadLocked(Pin* pin) {
+  if (!file_) {
+    return nullptr;
+  }
+  const uint8_t* base = file_->Map(pin->pixel_span.offset + pin->pixel_span.bytes);
+  if (!base) {
+    return nullptr;
+  }
+  const uint8_t* header = base + pin->pixel_span.offset;
+  const uint8_t* payload = header + kRecordHeaderBytes;
+  if (!pin->verified) {
+    const uint64_t len = LoadLe32(header + 16);
+    if (UpdateCrc32(0, payload, static_cast<size_t>(len)) != pin->payload_crc) {
+      // Reported as missing from now on; the meta stays usable.
+      pin->has_pixels = false;
+      ++corrupt_pixels_;
+      return nullptr;
+    }
+    pin->verified = true;
+  }
+  return payload;
+}
+
+uint64_t PinSessionStore::LiveBytesLocked() const {
+  uint64_t live = 0;
+  for (const auto& kv : pins_) {
+    if (kv.second.has_meta) {
+      live += kv.second.meta_span.bytes;
+    }
+    if (kv.second.has_pixels) {
+      live += kv.second.pixel_span.bytes;
+    }
+  }
+  return live;
+}
+
+} // namespace snappin
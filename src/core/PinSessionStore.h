@@ -0,0 +1,171 @@
+#pragma once
+#include "Types.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace snappin {
+
+class MappedFile;
+
+// Window state of a pin, as restored at the next start.
+struct PinSessionMeta {
+  PointPX pos_px{};
+  float scale = 1.0f;
+  float opacity = 1.0f;
+  bool locked = false;
+  bool always_on_top = true;
+  bool visible = true;
+};
+
+enum class PinSessionEncoding : uint8_t {
+  Raw = 0,    // tight BGRA/RGBA rows
+  Packed = 1, // PixelCodec blob
+};
+
+struct PinSessionStats {
+  uint64_t pins = 0;
+  uint64_t file_bytes = 0;
+  uint64_t live_bytes = 0;    // records still describing a pin
+  uint64_t records_written = 0;
+  uint64_t compactions = 0;
+  uint64_t torn_bytes = 0;    // cut from the tail by the last Open
+  uint64_t corrupt_pixels = 0; // pixel records failing their checksum on read
+  size_t pending = 0;         // writes queued, not yet in the file
+};
+
+// Pins of the last session in one file, mapped at startup and appended to as
+// pins change.
+//
+// Layout (little-endian throughout): a 32-byte file header, then records of
+// a 32-byte header (magic, type, pin key, payload length, payload CRC-32,
+// header CRC-32) and a payload padded to 8 bytes. Meta records carry a
+// PinSessionMeta, pixel records a 16-byte size/format/encoding header and
+// the pixels (raw rows, 8-byte aligned in the mapping, or a PixelCodec
+// blob), remove records nothing. The last record of each kind wins.
+//
+// Crash consistency: records are only ever appended. Open keeps the longest
+// prefix of records whose headers check out (and whose meta payloads do),
+// and truncates the rest, so a write cut short by a crash drops that record
+// and nothing before it. Pixel payloads are checked when first read, so a
+// large session opens without touching its pixels; one that fails is
+// reported as missing. When dead records outweigh live ones the file is
+// rewritten to a temporary, synced, and renamed over the original.
+//
+// Writes are queued and applied in order by a background thread, which
+// encodes pixels and syncs the file after pixel records and whenever the
+// queue drains. Reads see what has been written; Flush() waits for the queue.
+// Thread-safe.
+class PinSessionStore {
+public:
+  static constexpr uint64_t kDefaultCompactMinDeadBytes = uint64_t{16} << 20;
+
+  PinSessionStore();
+  ~PinSessionStore();
+  PinSessionStore(const PinSessionStore&) = delete;
+  PinSessionStore& operator=(const PinSessionStore&) = delete;
+
+  // Opens (creating if needed) and scans the file. False when it cannot be
+  // opened or is not a session file; a damaged tail is not an error.
+  bool Open(const std::filesystem::path& path);
+  // Writes what is queued, syncs and closes.
+  void Close();
+  bool is_open() const;
+
+  // Pins in the file, in the order they were first written.
+  std::vector<uint64_t> Keys() const;
+  bool Meta(uint64_t key, PinSessionMeta* out) const;
+  // Size and format of a pin's pixels without reading them.
+  bool PixelInfo(uint64_t key, SizePX* size_px, PixelFormat* format) const;
+  // The PixelCodec blob of a Packed pin, checksum-verified; false for raw or
+  // missing pixels, or when the record is corrupt.
+  bool PackedPixels(uint64_t key, std::vector<uint8_t>* out);
+  // Decoded pixels in a PixelBufferPool buffer; empty when missing or corrupt.
+  BitmapView Pixels(uint64_t key);
+
+  // Queue writes. False when the store is not open (or the pixels are
+  // invalid). A pin's pixels are written once; its meta as often as it
+  // changes (consecutive updates of one pin coalesce while queued).
+  bool PutPixels(uint64_t key, BitmapView pixels,
+                 PinSessionEncoding encoding = PinSessionEncoding::Packed);
+  bool PutMeta(uint64_t key, const PinSessionMeta& meta);
+  bool Remove(uint64_t key);
+  // Waits until everything queued is written and synced.
+  bool Flush();
+
+  // Rewrites the file with only the live records. The writer thread does
+  // this by itself after an append once dead records outweigh both the live
+  // ones and the threshold.
+  bool Compact();
+  void SetCompactMinDeadBytes(uint64_t bytes);
+
+  PinSessionStats Stats() const;
+
+private:
+  struct Span {
+    uint64_t offset = 0;
+    uint64_t bytes = 0; // header + padded payload
+  };
+  struct Pin {
+    uint64_t order = 0;
+    bool has_meta = false;
+    PinSessionMeta meta;
+    Span meta_span;
+    bool has_pixels = false;
+    Span pixel_span;
+    SizePX size_px{};
+    PixelFormat format = PixelFormat::BGRA8;
+    PinSessionEncoding encoding = PinSessionEncoding::Raw;
+    uint32_t payload_crc = 0;
+    bool verified = false;
+  };
+  struct Op {
+    enum class Kind { Pixels, Meta, Remove } kind = Kind::Meta;
+    uint64_t key = 0;
+    BitmapView pixels;
+    PinSessionEncoding encoding = PinSessionEncoding::Packed;
+    PinSessionMeta meta;
+  };
+
+  bool Enqueue(Op op);
+  void WriterLoop();
+  // Callers hold file_mu_.
+  bool OpenLocked(const std::filesystem::path& path);
+  void CloseLocked();
+  bool Scan(uint64_t file_size, uint64_t* valid_end);
+  bool AppendLocked(uint8_t type, uint64_t key, const std::vector<uint8_t>& payload);
+  bool CompactLocked(bool force);
+  // Payload bytes of a pixel record, mapped and verified; null on failure.
+  const uint8_t* PixelPayloadLocked(Pin* pin);
+  uint64_t LiveBytesLocked() const;
+
+  mutable std::mutex file_mu_;
+  std::filesystem::path path_;
+  std::unique_ptr<MappedFile> file_;
+  std::unordered_map<uint64_t, Pin> pins_;
+  uint64_t next_order_ = 0;
+  uint64_t compact_min_dead_bytes_ = kDefaultCompactMinDeadBytes;
+  uint64_t records_written_ = 0;
+  uint64_t compactions_ = 0;
+  uint64_t torn_bytes_ = 0;
+  uint64_t corrupt_pixels_ = 0;
+
+  mutable std::mutex queue_mu_;
+  std::condition_variable queue_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<Op> queue_;
+  bool writing_ = false;
+  bool stopping_ = false;
+  bool write_failed_ = false;
+  std::thread writer_;
+};
+
+} // namespace snappin
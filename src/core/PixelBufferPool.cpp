@@ -0,0 +1,219 @@
+#include "PixelBufferPool.h"
+
+#include <climits>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <new>
+
+namespace snappin {
+
+struct PixelBufferPool::State {
+  struct IdleBlock {
+    size_t size = 0;
+    uint8_t* ptr = nullptr;
+  };
+
+  mutable std::mutex mutex;
+  // Front = most recently released.
+  std::list<IdleBlock> idle;
+  size_t high_water_bytes = 0;
+  size_t pooled_bytes = 0;
+  size_t outstanding_bytes = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t recycled = 0;
+  uint64_t dropped = 0;
+  bool alive = true;
+
+  static uint8_t* Allocate(size_t size) {
+    return static_cast<uint8_t*>(
+        ::operator new(size, std::align_val_t{kAlignment}, std::nothrow));
+  }
+
+  static void Free(uint8_t* ptr) {
+    ::operator delete(ptr, std::align_val_t{kAlignment});
+  }
+
+  // Caller holds mutex. Frees least recently released blocks over budget.
+  void EvictToLocked(size_t budget, std::list<IdleBlock>* freed) {
+    while (pooled_bytes > budget && !idle.empty()) {
+      pooled_bytes -= idle.back().size;
+      freed->splice(freed->end(), idle, std::prev(idle.end()));
+    }
+  }
+
+  void Release(uint8_t* ptr, size_t size) {
+    std::list<IdleBlock> freed;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      outstanding_bytes -= size;
+      if (alive && size <= high_water_bytes) {
+        idle.push_front(IdleBlock{size, ptr});
+        pooled_bytes += size;
+        ++recycled;
+        EvictToLocked(high_water_bytes, &freed);
+        ptr = nullptr;
+      } else {
+        ++dropped;
+      }
+    }
+    if (ptr) {
+      Free(ptr);
+    }
+    for (const IdleBlock& block : freed) {
+      Free(block.ptr);
+    }
+  }
+};
+
+PixelBufferPool::PixelBufferPool(size_t high_water_bytes)
+    : state_(std::make_shared<State>()) {
+  state_->high_water_bytes = high_water_bytes;
+}
+
+PixelBufferPool::~PixelBufferPool() {
+  std::list<State::IdleBlock> freed;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->alive = false;
+    state_->pooled_bytes = 0;
+    freed.swap(state_->idle);
+  }
+  for (const State::IdleBlock& block : freed) {
+    State::Free(block.ptr);
+  }
+}
+
+size_t PixelBufferPool::SizeClassFor(size_t bytes) {
+  const size_t kMinGranularity = 4096;
+  if (bytes <= kMinGranularity) {
+    return kMinGranularity;
+  }
+  // Granularity is 1/8 of the request's power-of-two floor, so classes are
+  // at most 12.5% larger than the request.
+  size_t floor_pow2 = 1;
+  while (floor_pow2 <= bytes / 2) {
+    floor_pow2 <<= 1;
+  }
+  size_t granularity = floor_pow2 / 8;
+  if (granularity < kMinGranularity) {
+    granularity = kMinGranularity;
+  }
+  return (bytes + granularity - 1) / granularity * granularity;
+}
+
+std::shared_ptr<uint8_t> PixelBufferPool::Acquire(size_t bytes) {
+  if (bytes == 0) {
+    return nullptr;
+  }
+  const size_t size = SizeClassFor(bytes);
+  uint8_t* ptr = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    for (auto it = state_->idle.begin(); it != state_->idle.end(); ++it) {
+      if (it->size == size) {
+        ptr = it->ptr;
+        state_->pooled_bytes -= size;
+        state_->idle.erase(it);
+        break;
+      }
+    }
+    if (ptr) {
+      ++state_->hits;
+    } else {
+      ++state_->misses;
+    }
+    state_->outstanding_bytes += size;
+  }
+  if (!ptr) {
+    ptr = State::Allocate(size);
+    if (!ptr) {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      state_->outstanding_bytes -= size;
+      return nullptr;
+    }
+  }
+  std::shared_ptr<State> state = state_;
+  return std::shared_ptr<uint8_t>(
+      ptr, [state, size](uint8_t* p) { state->Release(p, size); });
+}
+
+void PixelBufferPool::SetHighWaterBytes(size_t bytes) {
+  std::list<State::IdleBlock> freed;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->high_water_bytes = bytes;
+    state_->EvictToLocked(bytes, &freed);
+  }
+  for (const State::IdleBlock& block : freed) {
+    State::Free(block.ptr);
+  }
+}
+
+size_t PixelBufferPool::HighWaterBytes() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->high_water_bytes;
+}
+
+void PixelBufferPool::Trim() {
+  std::list<State::IdleBlock> freed;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->EvictToLocked(0, &freed);
+  }
+  for (const State::IdleBlock& block : freed) {
+    State::Free(block.ptr);
+  }
+}
+
+PixelBufferPoolStats PixelBufferPool::Stats() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  PixelBufferPoolStats stats;
+  stats.hits = state_->hits;
+  stats.misses = state_->misses;
+  stats.recycled = state_->recycled;
+  stats.dropped = state_->dropped;
+  stats.pooled_bytes = state_->pooled_bytes;
+  stats.outstanding_bytes = state_->outstanding_bytes;
+  stats.high_water_bytes = state_->high_water_bytes;
+  return stats;
+}
+
+PixelBufferPool& PixelBufferPool::Shared() {
+  static PixelBufferPool pool;
+  return pool;
+}
+
+bool AcquirePixelBuffer(PixelBufferPool& pool, const SizePX& size_px,
+                        std::shared_ptr<uint8_t>* pixels_out, int32_t* stride_out) {
+  if (!pixels_out || !stride_out || size_px.w <= 0 || size_px.h <= 0 ||
+      size_px.w > (INT32_MAX / 4)) {
+    return false;
+  }
+  const int32_t stride = size_px.w * 4;
+  std::shared_ptr<uint8_t> pixels =
+      pool.Acquire(static_cast<size_t>(stride) * static_cast<size_t>(size_px.h));
+  if (!pixels) {
+    return false;
+  }
+  *pixels_out = std::move(pixels);
+  *stride_out = stride;
+  return true;
+}
+
+BitmapView ClonePooled(PixelBufferPool& pool, const BitmapView& src) {
+  std::shared_ptr<uint8_t> pixels;
+  int32_t stride = 0;
+  if (!src.valid() || !AcquirePixelBuffer(pool, src.size_px(), &pixels, &stride)) {
+    return BitmapView();
+  }
+  for (int32_t y = 0; y < src.size_px().h; ++y) {
+    std::memcpy(pixels.get() + static_cast<size_t>(y) * static_cast<size_t>(stride),
+                src.row(y), static_cast<size_t>(stride));
+  }
+  return BitmapView(std::move(pixels), src.size_px(), stride, src.format());
+}
+
+} // namespace snappin
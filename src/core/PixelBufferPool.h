@@ -0,0 +1,66 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace snappin {
+
+struct PixelBufferPoolStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  // Released blocks kept for reuse vs. freed because of the high-water mark.
+  uint64_t recycled = 0;
+  uint64_t dropped = 0;
+  uint64_t pooled_bytes = 0;
+  uint64_t outstanding_bytes = 0;
+  uint64_t high_water_bytes = 0;
+};
+
+// Recycles large pixel buffers (frozen frames, dimmed copies, crops, pins) so
+// repeated captures reuse the same blocks instead of churning the heap.
+// Requests are rounded up to a size class (at most 1/8 over the request) and
+// blocks are aligned to kAlignment. Released blocks are kept idle, most
+// recently released first, until their total would exceed the high-water
+// mark; the least recently released ones are freed first.
+// Thread-safe. Blocks may outlive the pool; they are then freed on release.
+class PixelBufferPool {
+public:
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kDefaultHighWaterBytes = size_t{256} << 20;
+
+  explicit PixelBufferPool(size_t high_water_bytes = kDefaultHighWaterBytes);
+  ~PixelBufferPool();
+  PixelBufferPool(const PixelBufferPool&) = delete;
+  PixelBufferPool& operator=(const PixelBufferPool&) = delete;
+
+  // At least `bytes` bytes, contents unspecified. Returns null for 0 bytes or
+  // on allocation failure. The block returns to the pool with its last owner.
+  std::shared_ptr<uint8_t> Acquire(size_t bytes);
+
+  // Lowers or raises the idle budget; excess idle blocks are freed at once.
+  void SetHighWaterBytes(size_t bytes);
+  size_t HighWaterBytes() const;
+  // Frees every idle block.
+  void Trim();
+  PixelBufferPoolStats Stats() const;
+
+  static size_t SizeClassFor(size_t bytes);
+  // Process-wide pool shared by capture, overlay and pins.
+  static PixelBufferPool& Shared();
+
+private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+// Allocates a size_px 32bpp bitmap from `pool` with rows of exactly
+// size_px.w * 4 bytes. Returns false on invalid size or allocation failure.
+bool AcquirePixelBuffer(PixelBufferPool& pool, const SizePX& size_px,
+                        std::shared_ptr<uint8_t>* pixels_out, int32_t* stride_out);
+
+// BitmapView::Clone() into a pooled, tightly packed block.
+BitmapView ClonePooled(PixelBufferPool& pool, const BitmapView& src);
+
+} // namespace snappin
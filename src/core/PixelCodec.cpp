@@ -0,0 +1,283 @@
+#include "PixelCodec.h"
+
+#include "PixelBufferPool.h"
+
+#include <cstring>
+#include <memory>
+
+namespace snappin {
+namespace {
+
+constexpr uint32_t kMagic = 0x315A5053u; // "SPZ1"
+constexpr size_t kHeaderBytes = 16;
+constexpr int kHashBits = 14;
+constexpr size_t kMinMatch = 4;
+// Matches end at least kLastLiterals bytes before the end and none start in
+// the last kMatchLimit bytes, so the tail is always a literal run.
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMatchLimit = 12;
+constexpr size_t kMaxOffset = 65535;
+constexpr size_t kMaxPixelBytes = size_t{1} << 31;
+
+uint32_t Load32(const uint8_t* p) {
+  uint32_t v = 0;
+  std::memcpy(&v, p, 4);
+  return v;
+}
+
+uint64_t Load64(const uint8_t* p) {
+  uint64_t v = 0;
+  std::memcpy(&v, p, 8);
+  return v;
+}
+
+// Header fields are little-endian so blobs can be written to disk as is.
+void StoreLe32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+uint32_t LoadLe32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint32_t Hash(uint32_t v) { return (v * 2654435761u) >> (32 - kHashBits); }
+
+// dst = a ^ b over `bytes` bytes (a multiple of 4).
+void XorRow(const uint8_t* a, const uint8_t* b, uint8_t* dst, size_t bytes) {
+  size_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    const uint64_t v = Load64(a + i) ^ Load64(b + i);
+    std::memcpy(dst + i, &v, 8);
+  }
+  for (; i < bytes; i += 4) {
+    const uint32_t v = Load32(a + i) ^ Load32(b + i);
+    std::memcpy(dst + i, &v, 4);
+  }
+}
+
+void PutLength(std::vector<uint8_t>* out, size_t len) {
+  while (len >= 255) {
+    out->push_back(255);
+    len -= 255;
+  }
+  out->push_back(static_cast<uint8_t>(len));
+}
+
+// One sequence; match_len == 0 marks the final literal run.
+void EmitSequence(std::vector<uint8_t>* out, const uint8_t* literals, size_t literal_len,
+                  size_t offset, size_t match_len) {
+  const size_t lit_code = literal_len < 15 ? literal_len : 15;
+  const size_t match_code =
+      match_len == 0 ? 0 : (match_len - kMinMatch < 15 ? match_len - kMinMatch : 15);
+  out->push_back(static_cast<uint8_t>((lit_code << 4) | match_code));
+  if (lit_code == 15) {
+    PutLength(out, literal_len - 15);
+  }
+  out->insert(out->end(), literals, literals + literal_len);
+  if (match_len == 0) {
+    return;
+  }
+  out->push_back(static_cast<uint8_t>(offset & 0xFF));
+  out->push_back(static_cast<uint8_t>(offset >> 8));
+  if (match_code == 15) {
+    PutLength(out, match_len - kMinMatch - 15);
+  }
+}
+
+void Pack(const uint8_t* src, size_t n, std::vector<uint8_t>* out) {
+  size_t anchor = 0;
+  if (n > kMatchLimit) {
+    // Positions + 1; 0 is empty.
+    std::vector<uint32_t> table(size_t{1} << kHashBits, 0);
+    const size_t limit = n - kMatchLimit;
+    const size_t match_end = n - kLastLiterals;
+    size_t ip = 0;
+    while (ip < limit) {
+      const uint32_t seq = Load32(src + ip);
+      const uint32_t h = Hash(seq);
+      const size_t cand = table[h];
+      table[h] = static_cast<uint32_t>(ip + 1);
+      if (cand == 0 || ip - (cand - 1) > kMaxOffset || Load32(src + cand - 1) != seq) {
+        // Step faster through data that does not compress.
+        ip += 1 + ((ip - anchor) >> 6);
+        continue;
+      }
+      const size_t ref = cand - 1;
+      size_t len = kMinMatch;
+      while (ip + len + 8 <= match_end && Load64(src + ip + len) == Load64(src + ref + len)) {
+        len += 8;
+      }
+      while (ip + len < match_end && src[ip + len] == src[ref + len]) {
+        ++len;
+      }
+      EmitSequence(out, src + anchor, ip - anchor, ip - ref, len);
+      ip += len;
+      anchor = ip;
+      if (ip < limit) {
+        table[Hash(Load32(src + ip - 2))] = static_cast<uint32_t>(ip - 1);
+      }
+    }
+  }
+  EmitSequence(out, src + anchor, n - anchor, 0, 0);
+}
+
+bool ReadLength(const uint8_t* in, size_t size, size_t* ip, size_t limit, size_t* len) {
+  for (;;) {
+    if (*ip >= size) {
+      return false;
+    }
+    const uint8_t b = in[(*ip)++];
+    *len += b;
+    if (*len > limit) {
+      return false;
+    }
+    if (b != 255) {
+      return true;
+    }
+  }
+}
+
+bool Unpack(const uint8_t* in, size_t size, uint8_t* dst, size_t n) {
+  size_t ip = 0;
+  size_t op = 0;
+  while (ip < size) {
+    const uint8_t token = in[ip++];
+    size_t lit = token >> 4;
+    if (lit == 15 && !ReadLength(in, size, &ip, n, &lit)) {
+      return false;
+    }
+    if (lit > size - ip || lit > n - op) {
+      return false;
+    }
+    std::memcpy(dst + op, in + ip, lit);
+    ip += lit;
+    op += lit;
+    if (ip == size) {
+      break;
+    }
+    if (size - ip < 2) {
+      return false;
+    }
+    const size_t offset = static_cast<size_t>(in[ip]) | (static_cast<size_t>(in[ip + 1]) << 8);
+    ip += 2;
+    size_t len = token & 15;
+    if (len == 15 && !ReadLength(in, size, &ip, n, &len)) {
+      return false;
+    }
+    len += kMinMatch;
+    if (offset == 0 || offset > op || len > n - op) {
+      return false;
+    }
+    uint8_t* out = dst + op;
+    size_t i = 0;
+    // Short offsets (flat areas) repeat with any multiple of their period;
+    // seed one period >= 8 bytewise, then copy in 8-byte steps from there.
+    size_t period = offset;
+    while (period < 8) {
+      period += offset;
+    }
+    for (; i < len && i < period - offset; ++i) {
+      out[i] = out[i - offset];
+    }
+    const uint8_t* match = out - period;
+    for (; i + 8 <= len; i += 8) {
+      std::memcpy(out + i, match + i, 8);
+    }
+    for (; i < len; ++i) {
+      out[i] = out[i - offset];
+    }
+    op += len;
+  }
+  return op == n;
+}
+
+bool ParseHeader(const uint8_t* packed, size_t size, SizePX* size_px, PixelFormat* format) {
+  if (!packed || size < kHeaderBytes || LoadLe32(packed) != kMagic || packed[12] > 1) {
+    return false;
+  }
+  SizePX dims;
+  dims.w = static_cast<int32_t>(LoadLe32(packed + 4));
+  dims.h = static_cast<int32_t>(LoadLe32(packed + 8));
+  if (dims.w <= 0 || dims.h <= 0 ||
+      static_cast<uint64_t>(dims.w) * static_cast<uint64_t>(dims.h) * 4 > kMaxPixelBytes) {
+    return false;
+  }
+  if (size_px) {
+    *size_px = dims;
+  }
+  if (format) {
+    *format = packed[12] == 1 ? PixelFormat::BGRA8 : PixelFormat::RGBA8;
+  }
+  return true;
+}
+
+} // namespace
+
+bool CompressPixels(const BitmapView& src, std::vector<uint8_t>* out) {
+  if (!out || !src.valid() || src.size_px().w <= 0 || src.size_px().h <= 0) {
+    return false;
+  }
+  const int32_t w = src.size_px().w;
+  const int32_t h = src.size_px().h;
+  const size_t row_bytes = static_cast<size_t>(w) * 4;
+  const size_t n = row_bytes * static_cast<size_t>(h);
+  if (n > kMaxPixelBytes) {
+    return false;
+  }
+  std::vector<uint8_t> filtered(n);
+  std::memcpy(filtered.data(), src.row(0), row_bytes);
+  for (int32_t y = 1; y < h; ++y) {
+    XorRow(src.row(y), src.row(y - 1), filtered.data() + static_cast<size_t>(y) * row_bytes,
+           row_bytes);
+  }
+
+  out->clear();
+  out->reserve(kHeaderBytes + n / 4 + 64);
+  out->resize(kHeaderBytes);
+  uint8_t* header = out->data();
+  StoreLe32(header, kMagic);
+  StoreLe32(header + 4, static_cast<uint32_t>(w));
+  StoreLe32(header + 8, static_cast<uint32_t>(h));
+  header[12] = src.format() == PixelFormat::BGRA8 ? 1 : 0;
+  Pack(filtered.data(), n, out);
+  out->shrink_to_fit();
+  return true;
+}
+
+bool PackedPixelsInfo(const std::vector<uint8_t>& packed, SizePX* size_px,
+                      PixelFormat* format) {
+  return ParseHeader(packed.data(), packed.size(), size_px, format);
+}
+
+BitmapView DecompressPixels(const std::vector<uint8_t>& packed) {
+  return DecompressPixels(packed.data(), packed.size());
+}
+
+BitmapView DecompressPixels(const uint8_t* packed, size_t packed_size) {
+  SizePX size;
+  PixelFormat format = PixelFormat::BGRA8;
+  if (!ParseHeader(packed, packed_size, &size, &format)) {
+    return BitmapView{};
+  }
+  std::shared_ptr<uint8_t> pixels;
+  int32_t stride = 0;
+  if (!AcquirePixelBuffer(PixelBufferPool::Shared(), size, &pixels, &stride)) {
+    return BitmapView{};
+  }
+  const size_t row_bytes = static_cast<size_t>(stride);
+  const size_t n = row_bytes * static_cast<size_t>(size.h);
+  if (!Unpack(packed + kHeaderBytes, packed_size - kHeaderBytes, pixels.get(), n)) {
+    return BitmapView{};
+  }
+  for (int32_t y = 1; y < size.h; ++y) {
+    uint8_t* row = pixels.get() + static_cast<size_t>(y) * row_bytes;
+    XorRow(row, row - row_bytes, row, row_bytes);
+  }
+  return BitmapView(std::move(pixels), size, stride, format);
+}
+
+} // namespace snappin
@@ -0,0 +1,32 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snappin {
+
+// Lossless in-memory codec for 32bpp screenshots, used to park idle pins.
+// Every row after the first is XORed with the row above, which turns flat
+// UI regions and repeated lines into zeros, and the result is packed with a
+// byte-oriented LZ77 (LZ4-style sequences: literal run, 16-bit offset, match
+// length of at least 4). Only size_px.w * 4 bytes per row are stored. The
+// packed form starts with a 16-byte little-endian header (magic, size,
+// format). PinSessionStore writes it to disk as is, so any change to the
+// format needs a new magic.
+
+// Replaces *out with the packed form of src. False on an invalid bitmap.
+bool CompressPixels(const BitmapView& src, std::vector<uint8_t>* out);
+
+// Size and format recorded in a packed header; false if it is not one.
+bool PackedPixelsInfo(const std::vector<uint8_t>& packed, SizePX* size_px,
+                      PixelFormat* format);
+
+// Tightly packed pixels from PixelBufferPool::Shared(), or an empty view when
+// `packed` is truncated or corrupt.
+BitmapView DecompressPixels(const std::vector<uint8_t>& packed);
+// Same, from a blob in place (e.g. inside a mapped file).
+BitmapView DecompressPixels(const uint8_t* packed, size_t size);
+
+} // namespace snappin
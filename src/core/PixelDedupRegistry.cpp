@@ -0,0 +1,155 @@
+#include "PixelDedupRegistry.h"
+
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace snappin {
+namespace {
+
+bool SameRows(const BitmapView& a, const BitmapView& b) {
+  const size_t row_bytes = static_cast<size_t>(a.size_px().w) * 4;
+  for (int32_t y = 0; y < a.size_px().h; ++y) {
+    if (std::memcmp(a.row(y), b.row(y), row_bytes) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SameOwner(const std::weak_ptr<const uint8_t>& a, const std::weak_ptr<const uint8_t>& b) {
+  return !a.owner_before(b) && !b.owner_before(a);
+}
+
+uint64_t PixelBytes(const BitmapView& pixels) {
+  return uint64_t{4} * static_cast<uint32_t>(pixels.size_px().w) *
+         static_cast<uint32_t>(pixels.size_px().h);
+}
+
+} // namespace
+
+PixelDedupRegistry::PixelDedupRegistry(HashFn hash) : hash_(hash) {}
+
+PixelDedupRegistry& PixelDedupRegistry::Shared() {
+  static PixelDedupRegistry registry;
+  return registry;
+}
+
+bool PixelDedupRegistry::Matches(const Entry& entry, const BitmapView& pixels) {
+  return entry.size_px.w == pixels.size_px().w && entry.size_px.h == pixels.size_px().h &&
+         entry.format == pixels.format();
+}
+
+BitmapView PixelDedupRegistry::Intern(BitmapView pixels) {
+  if (!pixels.valid()) {
+    return pixels;
+  }
+  const std::weak_ptr<const uint8_t> owner = pixels.weak_origin();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.lookups;
+    // A view of a registered buffer (a pin made from an artifact, say).
+    auto known = by_data_.find(pixels.data());
+    if (known != by_data_.end()) {
+      auto range = by_hash_.equal_range(known->second);
+      for (auto it = range.first; it != range.second; ++it) {
+        const Entry& entry = it->second;
+        if (entry.data == pixels.data() && entry.stride_bytes == pixels.stride_bytes() &&
+            Matches(entry, pixels) && SameOwner(entry.origin, owner)) {
+          return pixels;
+        }
+      }
+    }
+  }
+
+  const CpuBitmap bitmap = pixels.AsCpuBitmap();
+  const uint64_t hash = hash_ ? hash_(bitmap) : HashBitmap(bitmap);
+  std::vector<BitmapView> candidates;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.hashed_bytes += PixelBytes(pixels);
+    auto range = by_hash_.equal_range(hash);
+    for (auto it = range.first; it != range.second;) {
+      std::shared_ptr<const uint8_t> origin = it->second.origin.lock();
+      if (!origin) {
+        EraseLocked(it++);
+        continue;
+      }
+      if (Matches(it->second, pixels)) {
+        candidates.emplace_back(std::move(origin), it->second.size_px, it->second.stride_bytes,
+                                it->second.format);
+      }
+      ++it;
+    }
+  }
+
+  uint64_t collisions = 0;
+  for (const BitmapView& candidate : candidates) {
+    if (candidate.data() == pixels.data()) {
+      return pixels;
+    }
+    if (SameRows(candidate, pixels)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++stats_.hits;
+      stats_.shared_bytes += PixelBytes(pixels);
+      stats_.collisions += collisions;
+      return candidate;
+    }
+    ++collisions;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.collisions += collisions;
+  InsertLocked(hash, pixels);
+  return pixels;
+}
+
+void PixelDedupRegistry::Sweep() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SweepLocked();
+}
+
+PixelDedupStats PixelDedupRegistry::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PixelDedupStats stats = stats_;
+  stats.entries = by_hash_.size();
+  return stats;
+}
+
+void PixelDedupRegistry::InsertLocked(uint64_t hash, const BitmapView& pixels) {
+  Entry entry;
+  entry.origin = pixels.weak_origin();
+  entry.data = pixels.data();
+  entry.size_px = pixels.size_px();
+  entry.stride_bytes = pixels.stride_bytes();
+  entry.format = pixels.format();
+  by_hash_.emplace(hash, std::move(entry));
+  by_data_[pixels.data()] = hash;
+  if (by_hash_.size() >= sweep_at_) {
+    SweepLocked();
+  }
+}
+
+void PixelDedupRegistry::EraseLocked(std::unordered_multimap<uint64_t, Entry>::iterator it) {
+  // The address may since belong to a newer buffer with its own entry.
+  auto known = by_data_.find(it->second.data);
+  if (known != by_data_.end() && known->second == it->first) {
+    by_data_.erase(known);
+  }
+  by_hash_.erase(it);
+}
+
+void PixelDedupRegistry::SweepLocked() {
+  for (auto it = by_hash_.begin(); it != by_hash_.end();) {
+    if (it->second.origin.expired()) {
+      EraseLocked(it++);
+    } else {
+      ++it;
+    }
+  }
+  // Grow the threshold with the live set so sweeps stay amortized O(1).
+  sweep_at_ = std::max<size_t>(64, by_hash_.size() * 2);
+}
+
+} // namespace snappin
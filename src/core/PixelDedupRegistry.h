@@ -0,0 +1,74 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace snappin {
+
+struct PixelDedupStats {
+  uint64_t entries = 0;      // registered buffers, including freed ones not yet swept
+  uint64_t lookups = 0;
+  uint64_t hits = 0;         // lookups answered with another, identical buffer
+  uint64_t shared_bytes = 0; // pixel bytes of those hits: copies callers could drop
+  uint64_t collisions = 0;   // equal hashes whose pixels differed
+  uint64_t hashed_bytes = 0;
+};
+
+// Content-addressed registry of immutable pixel buffers. Intern() hashes a
+// view's pixels (HashBitmap) and, when a live buffer with the same size,
+// format and pixels is registered, returns a view of that buffer so the
+// caller's copy is freed with its last view; otherwise it registers the view
+// and returns it unchanged. Equal hashes are always confirmed by comparing
+// the rows. Views already registered come back without hashing.
+//
+// The registry holds weak references only: a buffer stays alive as long as
+// any artifact, pin or export holds a view of it, and entries of freed
+// buffers are swept as the registry grows. Interned pixels must never be
+// written to. Thread-safe; hashing and comparing run outside the lock.
+class PixelDedupRegistry final : public IPixelInterner {
+public:
+  using HashFn = uint64_t (*)(const CpuBitmap& bitmap);
+
+  // `hash` defaults to HashBitmap; tests pass a weak one to force collisions.
+  explicit PixelDedupRegistry(HashFn hash = nullptr);
+  PixelDedupRegistry(const PixelDedupRegistry&) = delete;
+  PixelDedupRegistry& operator=(const PixelDedupRegistry&) = delete;
+
+  BitmapView Intern(BitmapView pixels) override;
+  // Drops entries whose buffers are gone.
+  void Sweep();
+
+  PixelDedupStats Stats() const;
+
+  // Process-wide registry shared by the artifact store and pins.
+  static PixelDedupRegistry& Shared();
+
+private:
+  struct Entry {
+    std::weak_ptr<const uint8_t> origin;
+    const uint8_t* data = nullptr;
+    SizePX size_px{};
+    int32_t stride_bytes = 0;
+    PixelFormat format = PixelFormat::BGRA8;
+  };
+
+  static bool Matches(const Entry& entry, const BitmapView& pixels);
+  // Callers hold mutex_.
+  void InsertLocked(uint64_t hash, const BitmapView& pixels);
+  void EraseLocked(std::unordered_multimap<uint64_t, Entry>::iterator it);
+  void SweepLocked();
+
+  const HashFn hash_;
+  mutable std::mutex mutex_;
+  std::unordered_multimap<uint64_t, Entry> by_hash_;
+  // First pixel of each registered view, for the no-hash path.
+  std::unordered_map<const uint8_t*, uint64_t> by_data_;
+  size_t sweep_at_ = 64;
+  PixelDedupStats stats_;
+};
+
+} // namespace snappin
@@ -0,0 +1,800 @@
+#include "PixelKernels.h"
+
+#include "PixelKernelsInternal.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#if defined(SNAPPIN_IMGPROC_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace snappin {
+namespace pixel_kernels {
+
+void DimRowScalar(const uint8_t* src, uint8_t* dst, int32_t pixels, uint16_t mul) {
+  for (int32_t i = 0; i < pixels; ++i) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    dst[o + 0] = static_cast<uint8_t>((src[o + 0] * static_cast<uint32_t>(mul)) >> 16);
+    dst[o + 1] = static_cast<uint8_t>((src[o + 1] * static_cast<uint32_t>(mul)) >> 16);
+    dst[o + 2] = static_cast<uint8_t>((src[o + 2] * static_cast<uint32_t>(mul)) >> 16);
+    dst[o + 3] = 0xFF;
+  }
+}
+
+void FillRowScalar(uint8_t* dst, int32_t pixels, uint32_t value) {
+  for (int32_t i = 0; i < pixels; ++i) {
+    std::memcpy(dst + static_cast<size_t>(i) * 4, &value, 4);
+  }
+}
+
+void BlendRowScalar(const uint8_t* src, uint8_t* dst, int32_t pixels,
+                    uint8_t opacity) {
+  for (int32_t i = 0; i < pixels; ++i) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    const uint32_t a = Div255(static_cast<uint32_t>(src[o + 3]) * opacity);
+    const uint32_t inv = 255 - a;
+    dst[o + 0] = static_cast<uint8_t>(Div255(src[o + 0] * a + dst[o + 0] * inv));
+    dst[o + 1] = static_cast<uint8_t>(Div255(src[o + 1] * a + dst[o + 1] * inv));
+    dst[o + 2] = static_cast<uint8_t>(Div255(src[o + 2] * a + dst[o + 2] * inv));
+    dst[o + 3] = static_cast<uint8_t>(Div255(255 * a + dst[o + 3] * inv));
+  }
+}
+
+void SwizzleRowScalar(const uint8_t* src, uint8_t* dst, int32_t pixels) {
+  for (int32_t i = 0; i < pixels; ++i) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    const uint8_t c0 = src[o + 0];
+    const uint8_t c2 = src[o + 2];
+    dst[o + 0] = c2;
+    dst[o + 1] = src[o + 1];
+    dst[o + 2] = c0;
+    dst[o + 3] = src[o + 3];
+  }
+}
+
+void BoxAccumulateRowScalar(uint16_t* sums, const uint8_t* add, const uint8_t* sub,
+                            int32_t count) {
+  if (sub) {
+    for (int32_t i = 0; i < count; ++i) {
+      sums[i] = static_cast<uint16_t>(sums[i] + add[i] - sub[i]);
+    }
+    return;
+  }
+  for (int32_t i = 0; i < count; ++i) {
+    sums[i] = static_cast<uint16_t>(sums[i] + add[i]);
+  }
+}
+
+void BoxScaleRowScalar(const uint16_t* hi, const uint16_t* lo, uint8_t* dst, int32_t count,
+                       uint16_t mul) {
+  for (int32_t i = 0; i < count; ++i) {
+    const uint32_t s = static_cast<uint16_t>(hi[i] - (lo ? lo[i] : 0));
+    const uint32_t v = (s * mul + 32768) >> 16;
+    dst[i] = static_cast<uint8_t>(v > 255 ? 255 : v);
+  }
+}
+
+void HalfRowScalar(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int32_t pixels) {
+  for (int32_t i = 0; i < pixels; ++i) {
+    const size_t s = static_cast<size_t>(i) * 8;
+    const size_t o = static_cast<size_t>(i) * 4;
+    for (size_t c = 0; c < 4; ++c) {
+      dst[o + c] = static_cast<uint8_t>(
+          (r0[s + c] + r0[s + 4 + c] + r1[s + c] + r1[s + 4 + c] + 2) >> 2);
+    }
+  }
+}
+
+void FilterRowsScalar(const uint8_t* const* rows, const int16_t* weights, int32_t taps,
+                      uint8_t* dst, int32_t count) {
+  for (int32_t i = 0; i < count; ++i) {
+    dst[i] = FilterRowsAt(rows, weights, taps, i);
+  }
+}
+
+void FilterColumnsScalar(const uint8_t* src, const int32_t* starts, const int16_t* weights,
+                         int32_t taps, uint8_t* dst, int32_t pixels) {
+  for (int32_t i = 0; i < pixels; ++i) {
+    const uint8_t* s = src + static_cast<size_t>(starts[i]) * 4;
+    const int16_t* w = weights + static_cast<size_t>(i) * static_cast<size_t>(taps);
+    int32_t sum[4] = {8192, 8192, 8192, 8192};
+    for (int32_t k = 0; k < taps; ++k) {
+      for (size_t c = 0; c < 4; ++c) {
+        sum[c] += w[k] * s[static_cast<size_t>(k) * 4 + c];
+      }
+    }
+    for (size_t c = 0; c < 4; ++c) {
+      dst[static_cast<size_t>(i) * 4 + c] = ClampFiltered(sum[c]);
+    }
+  }
+}
+
+void HashStripesScalar(uint64_t* acc, const uint8_t* data, const uint64_t* keys,
+                       int32_t stripes) {
+  for (int32_t s = 0; s < stripes; ++s) {
+    const uint8_t* p = data + static_cast<size_t>(s) * kHashStripeBytes;
+    const uint64_t* k = keys + s;
+    for (int32_t i = 0; i < kHashLanes; ++i) {
+      const uint64_t d = LoadLe64(p + static_cast<size_t>(i) * 8);
+      const uint64_t dk = d ^ k[i];
+      acc[i ^ 1] += d;
+      acc[i] += (dk & 0xFFFFFFFFu) * (dk >> 32);
+    }
+  }
+}
+
+const RowKernels& ScalarKernels() {
+  static const RowKernels kernels = {&DimRowScalar,          &FillRowScalar,
+                                     &BlendRowScalar,        &SwizzleRowScalar,
+                                     &BoxAccumulateRowScalar, &BoxScaleRowScalar,
+                                     &HalfRowScalar,         &FilterRowsScalar,
+                                     &FilterColumnsScalar,   &HashStripesScalar};
+  return kernels;
+}
+
+} // namespace pixel_kernels
+
+namespace {
+
+using pixel_kernels::RowKernels;
+
+#if defined(SNAPPIN_IMGPROC_X86)
+bool CpuHasSse2() {
+#if defined(_MSC_VER)
+#if defined(_M_X64)
+  return true;
+#else
+  int info[4] = {};
+  __cpuid(info, 1);
+  return (info[3] & (1 << 26)) != 0;
+#endif
+#else
+  return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool CpuHasAvx2() {
+#if defined(_MSC_VER)
+  int info[4] = {};
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx) {
+    return false;
+  }
+  // The OS must save YMM state across context switches.
+  if ((_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+PixelKernelIsa DetectBestIsa() {
+#if defined(SNAPPIN_IMGPROC_X86)
+  if (CpuHasAvx2()) {
+    return PixelKernelIsa::AVX2;
+  }
+  if (CpuHasSse2()) {
+    return PixelKernelIsa::SSE2;
+  }
+#elif defined(SNAPPIN_IMGPROC_NEON)
+  return PixelKernelIsa::NEON;
+#endif
+  return PixelKernelIsa::Scalar;
+}
+
+PixelKernelIsa ResolveIsa(PixelKernelIsa isa) {
+  if (isa == PixelKernelIsa::Auto || !PixelKernelIsaSupported(isa)) {
+    return ActivePixelKernelIsa();
+  }
+  return isa;
+}
+
+const RowKernels& KernelsFor(PixelKernelIsa isa) {
+  switch (ResolveIsa(isa)) {
+#if defined(SNAPPIN_IMGPROC_X86)
+    case PixelKernelIsa::SSE2:
+      return pixel_kernels::Sse2Kernels();
+    case PixelKernelIsa::AVX2:
+      return pixel_kernels::Avx2Kernels();
+#endif
+#if defined(SNAPPIN_IMGPROC_NEON)
+    case PixelKernelIsa::NEON:
+      return pixel_kernels::NeonKernels();
+#endif
+    default:
+      return pixel_kernels::ScalarKernels();
+  }
+}
+
+bool IsValidBitmap(const CpuBitmap& bmp) {
+  return bmp.data.p && bmp.size_px.w > 0 && bmp.size_px.h > 0 &&
+         bmp.stride_bytes >= bmp.size_px.w * 4;
+}
+
+bool SameSize(const CpuBitmap& a, const CpuBitmap& b) {
+  return a.size_px.w == b.size_px.w && a.size_px.h == b.size_px.h;
+}
+
+uint8_t* RowPtr(const CpuBitmap& bmp, int32_t y) {
+  return static_cast<uint8_t*>(bmp.data.p) +
+         static_cast<size_t>(y) * static_cast<size_t>(bmp.stride_bytes);
+}
+
+// Low and high halves of the 128-bit product, xor-folded.
+uint64_t MulFold64(uint64_t a, uint64_t b) {
+  const uint64_t a_lo = a & 0xFFFFFFFFu;
+  const uint64_t a_hi = a >> 32;
+  const uint64_t b_lo = b & 0xFFFFFFFFu;
+  const uint64_t b_hi = b >> 32;
+  const uint64_t lo_lo = a_lo * b_lo;
+  const uint64_t hi_lo = a_hi * b_lo;
+  const uint64_t lo_hi = a_lo * b_hi;
+  const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+  const uint64_t upper = (hi_lo >> 32) + (cross >> 32) + a_hi * b_hi;
+  const uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+  return lower ^ upper;
+}
+
+// Filter taps for one axis of ResizeLanczos: output i reads `taps` source
+// positions from starts[i] with weights[i * taps ...].
+struct ResampleAxis {
+  int32_t taps = 0;
+  std::vector<int32_t> starts;
+  std::vector<int16_t> weights;
+};
+
+double Lanczos2(double x) {
+  x = std::fabs(x);
+  if (x < 1e-9) {
+    return 1.0;
+  }
+  if (x >= 2.0) {
+    return 0.0;
+  }
+  constexpr double kPi = 3.14159265358979323846;
+  const double px = kPi * x;
+  return 2.0 * std::sin(px) * std::sin(px / 2.0) / (px * px);
+}
+
+ResampleAxis BuildResampleAxis(int32_t src_len, int32_t dst_len) {
+  ResampleAxis axis;
+  const double scale = static_cast<double>(dst_len) / src_len;
+  const double filter_scale = std::min(scale, 1.0);
+  const double support = 2.0 / filter_scale;
+  axis.taps = std::min(2 * static_cast<int32_t>(std::ceil(support)) + 1, src_len);
+  axis.starts.resize(static_cast<size_t>(dst_len));
+  axis.weights.assign(static_cast<size_t>(dst_len) * static_cast<size_t>(axis.taps), 0);
+  std::vector<double> w(static_cast<size_t>(axis.taps));
+  for (int32_t i = 0; i < dst_len; ++i) {
+    const double center = (i + 0.5) / scale - 0.5;
+    const int32_t first = static_cast<int32_t>(std::floor(center - support)) + 1;
+    const int32_t last = static_cast<int32_t>(std::ceil(center + support)) - 1;
+    // Every clamped source index in [first, last] lands inside the window.
+    const int32_t start = std::clamp(first, 0, src_len - axis.taps);
+    std::fill(w.begin(), w.end(), 0.0);
+    double total = 0.0;
+    for (int32_t j = first; j <= last; ++j) {
+      const double v = Lanczos2((j - center) * filter_scale);
+      w[static_cast<size_t>(std::clamp(j, 0, src_len - 1) - start)] += v;
+      total += v;
+    }
+    int16_t* out = axis.weights.data() + static_cast<size_t>(i) * static_cast<size_t>(axis.taps);
+    int32_t sum = 0;
+    size_t largest = 0;
+    for (size_t k = 0; k < w.size(); ++k) {
+      out[k] = static_cast<int16_t>(std::lround(w[k] / total * 16384.0));
+      sum += out[k];
+      if (out[k] > out[largest]) {
+        largest = k;
+      }
+    }
+    // Rounding leftovers go to the dominant tap so flat images stay flat.
+    out[largest] = static_cast<int16_t>(out[largest] + 16384 - sum);
+    axis.starts[static_cast<size_t>(i)] = start;
+  }
+  return axis;
+}
+
+// One horizontal box-blur row of `w` pixels into out; prefix holds
+// (w + 2 * radius + 1) * 4 running sums.
+void BoxBlurRow(const RowKernels& kernels, const uint8_t* s, int32_t w, int32_t radius,
+                int32_t span, uint16_t mul, uint16_t* prefix, uint8_t* out) {
+  uint16_t c0 = 0;
+  uint16_t c1 = 0;
+  uint16_t c2 = 0;
+  uint16_t c3 = 0;
+  uint16_t* p = prefix + 4;
+  const auto push = [&](const uint8_t* px) {
+    c0 = static_cast<uint16_t>(c0 + px[0]);
+    c1 = static_cast<uint16_t>(c1 + px[1]);
+    c2 = static_cast<uint16_t>(c2 + px[2]);
+    c3 = static_cast<uint16_t>(c3 + px[3]);
+    p[0] = c0;
+    p[1] = c1;
+    p[2] = c2;
+    p[3] = c3;
+    p += 4;
+  };
+  for (int32_t k = 0; k < radius; ++k) {
+    push(s);
+  }
+  for (int32_t x = 0; x < w; ++x) {
+    push(s + static_cast<size_t>(x) * 4);
+  }
+  for (int32_t k = 0; k < radius; ++k) {
+    push(s + static_cast<size_t>(w - 1) * 4);
+  }
+  kernels.box_scale_row(prefix + static_cast<size_t>(span) * 4, prefix, out, w * 4, mul);
+}
+
+// Images below this many bytes are not worth handing to the scheduler.
+constexpr size_t kStripMinImageBytes = size_t{256} << 10;
+constexpr int32_t kStripRows = 32;
+
+// Runs fn(y0, y1) over rows [0, rows) in strips of at least min_rows rows on
+// TaskScheduler::Shared(); small images run in one call on this thread.
+// Strips must only write their own rows. False when a strip threw.
+bool ForEachRowStrip(int32_t rows, size_t row_bytes, int32_t min_rows,
+                     TaskPriority priority, const std::function<void(int32_t, int32_t)>& fn) {
+  const int32_t strip = std::max(kStripRows, min_rows);
+  if (rows <= strip || static_cast<size_t>(rows) * row_bytes < kStripMinImageBytes) {
+    try {
+      fn(0, rows);
+    } catch (...) {
+      return false;
+    }
+    return true;
+  }
+  const int32_t strips = (rows + strip - 1) / strip;
+  return TaskScheduler::Shared().ParallelFor(
+      strips, 0, [&](int32_t i) { fn(i * strip, std::min(rows, (i + 1) * strip)); },
+      priority);
+}
+
+// One horizontal and one vertical box pass from src into dst through `tmp`, a
+// tightly packed w*h image. Windows clamp at the edges. The horizontal pass
+// differences wrapped prefix sums; the vertical one slides column sums.
+// False when a strip's scratch could not be allocated.
+bool BoxBlurPass(const RowKernels& kernels, const CpuBitmap& src, const CpuBitmap& dst,
+                 int32_t radius, uint16_t mul, uint8_t* tmp, TaskPriority priority) {
+  const int32_t w = src.size_px.w;
+  const int32_t h = src.size_px.h;
+  const int32_t span = 2 * radius + 1;
+  const size_t row_bytes = static_cast<size_t>(w) * 4;
+  // Horizontal: every row on its own.
+  const bool rows_ok = ForEachRowStrip(h, row_bytes, 1, priority, [&](int32_t y0, int32_t y1) {
+    std::vector<uint16_t> prefix((static_cast<size_t>(w) + 2 * static_cast<size_t>(radius) +
+                                  1) * 4);
+    for (int32_t y = y0; y < y1; ++y) {
+      BoxBlurRow(kernels, RowPtr(src, y), w, radius, span, mul, prefix.data(),
+                 tmp + static_cast<size_t>(y) * row_bytes);
+    }
+  });
+  if (!rows_ok) {
+    return false;
+  }
+
+  // Vertical: each strip primes its window sums from the rows around its
+  // first row, so strips are a few windows tall to keep that cheap.
+  const auto tmp_row = [&](int32_t y) {
+    return tmp + static_cast<size_t>(std::clamp(y, 0, h - 1)) * row_bytes;
+  };
+  return ForEachRowStrip(h, row_bytes, 4 * span, priority, [&](int32_t y0, int32_t y1) {
+    std::vector<uint16_t> sums(static_cast<size_t>(w) * 4, uint16_t{0});
+    for (int32_t k = y0 - radius; k <= y0 + radius; ++k) {
+      kernels.box_accumulate_row(sums.data(), tmp_row(k), nullptr, w * 4);
+    }
+    for (int32_t y = y0; y < y1; ++y) {
+      kernels.box_scale_row(sums.data(), nullptr, RowPtr(dst, y), w * 4, mul);
+      if (y + 1 < y1) {
+        kernels.box_accumulate_row(sums.data(), tmp_row(y + radius + 1), tmp_row(y - radius),
+                                   w * 4);
+      }
+    }
+  });
+}
+
+// Multiplier reproducing static_cast<uint8_t>(v * factor) for every byte value
+// as (v * mul) >> 16, or 0 when no 16-bit multiplier is exact for this factor.
+uint32_t ExactDimMultiplier(float factor, const std::array<uint8_t, 256>& lut) {
+  const float scaled = factor * 65536.0f;
+  const uint32_t base = static_cast<uint32_t>(scaled);
+  const uint32_t candidates[3] = {base + 1, base, base > 0 ? base - 1 : 0};
+  for (uint32_t mul : candidates) {
+    if (mul == 0 || mul > 0xFFFF) {
+      continue;
+    }
+    bool exact = true;
+    for (uint32_t v = 0; v < 256 && exact; ++v) {
+      exact = ((v * mul) >> 16) == lut[v];
+    }
+    if (exact) {
+      return mul;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+bool PixelKernelIsaSupported(PixelKernelIsa isa) {
+  switch (isa) {
+    case PixelKernelIsa::Auto:
+    case PixelKernelIsa::Scalar:
+      return true;
+#if defined(SNAPPIN_IMGPROC_X86)
+    case PixelKernelIsa::SSE2: {
+      static const bool supported = CpuHasSse2();
+      return supported;
+    }
+    case PixelKernelIsa::AVX2: {
+      static const bool supported = CpuHasAvx2();
+      return supported;
+    }
+#endif
+#if defined(SNAPPIN_IMGPROC_NEON)
+    case PixelKernelIsa::NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+PixelKernelIsa ActivePixelKernelIsa() {
+  static const PixelKernelIsa isa = DetectBestIsa();
+  return isa;
+}
+
+const char* PixelKernelIsaName(PixelKernelIsa isa) {
+  switch (isa) {
+    case PixelKernelIsa::Auto:
+      return "auto";
+    case PixelKernelIsa::Scalar:
+      return "scalar";
+    case PixelKernelIsa::SSE2:
+      return "sse2";
+    case PixelKernelIsa::AVX2:
+      return "avx2";
+    case PixelKernelIsa::NEON:
+      return "neon";
+    default:
+      return "unknown";
+  }
+}
+
+bool DimBitmap(const CpuBitmap& src, CpuBitmap* dst, float factor,
+               PixelKernelIsa isa) {
+  if (!dst || !IsValidBitmap(src) || !IsValidBitmap(*dst) || !SameSize(src, *dst)) {
+    return false;
+  }
+  if (!(factor > 0.0f)) {
+    factor = 0.0f;
+  } else if (factor > 1.0f) {
+    factor = 1.0f;
+  }
+
+  std::array<uint8_t, 256> lut = {};
+  for (int v = 0; v < 256; ++v) {
+    lut[static_cast<size_t>(v)] = static_cast<uint8_t>(v * factor);
+  }
+  const uint32_t mul = ExactDimMultiplier(factor, lut);
+  const RowKernels& kernels = KernelsFor(isa);
+  const int32_t w = src.size_px.w;
+  for (int32_t y = 0; y < src.size_px.h; ++y) {
+    const uint8_t* s = RowPtr(src, y);
+    uint8_t* d = RowPtr(*dst, y);
+    if (mul != 0) {
+      kernels.dim_row(s, d, w, static_cast<uint16_t>(mul));
+      continue;
+    }
+    for (int32_t x = 0; x < w; ++x) {
+      const size_t o = static_cast<size_t>(x) * 4;
+      d[o + 0] = lut[s[o + 0]];
+      d[o + 1] = lut[s[o + 1]];
+      d[o + 2] = lut[s[o + 2]];
+      d[o + 3] = 0xFF;
+    }
+  }
+  dst->format = src.format;
+  return true;
+}
+
+bool FillBitmapRect(CpuBitmap* dst, const RectPX& rect, ColorRGBA color,
+                    PixelKernelIsa isa) {
+  if (!dst || !IsValidBitmap(*dst)) {
+    return false;
+  }
+  const int32_t left = rect.x < 0 ? 0 : rect.x;
+  const int32_t top = rect.y < 0 ? 0 : rect.y;
+  const int64_t right64 = static_cast<int64_t>(rect.x) + rect.w;
+  const int64_t bottom64 = static_cast<int64_t>(rect.y) + rect.h;
+  const int32_t right =
+      static_cast<int32_t>(right64 > dst->size_px.w ? dst->size_px.w : right64);
+  const int32_t bottom =
+      static_cast<int32_t>(bottom64 > dst->size_px.h ? dst->size_px.h : bottom64);
+  if (right <= left || bottom <= top) {
+    return true;
+  }
+
+  uint8_t bytes[4] = {color.b, color.g, color.r, color.a};
+  if (dst->format == PixelFormat::RGBA8) {
+    bytes[0] = color.r;
+    bytes[2] = color.b;
+  }
+  uint32_t value = 0;
+  std::memcpy(&value, bytes, 4);
+
+  const RowKernels& kernels = KernelsFor(isa);
+  for (int32_t y = top; y < bottom; ++y) {
+    kernels.fill_row(RowPtr(*dst, y) + static_cast<size_t>(left) * 4, right - left,
+                     value);
+  }
+  return true;
+}
+
+bool BlendBitmap(const CpuBitmap& src, CpuBitmap* dst, uint8_t opacity,
+                 PixelKernelIsa isa) {
+  if (!dst || !IsValidBitmap(src) || !IsValidBitmap(*dst) || !SameSize(src, *dst) ||
+      src.format != dst->format) {
+    return false;
+  }
+  if (opacity == 0) {
+    return true;
+  }
+  const RowKernels& kernels = KernelsFor(isa);
+  for (int32_t y = 0; y < src.size_px.h; ++y) {
+    kernels.blend_row(RowPtr(src, y), RowPtr(*dst, y), src.size_px.w, opacity);
+  }
+  return true;
+}
+
+bool BoxBlurBitmap(const CpuBitmap& src, CpuBitmap* dst, int32_t radius, int32_t passes,
+                   PixelKernelIsa isa, TaskPriority priority) {
+  if (!dst || !IsValidBitmap(src) || !IsValidBitmap(*dst) || !SameSize(src, *dst)) {
+    return false;
+  }
+  radius = std::clamp(radius, 0, kMaxBoxBlurRadius);
+  const int32_t w = src.size_px.w;
+  const int32_t h = src.size_px.h;
+  if (radius == 0 || passes <= 0) {
+    if (src.data.p != dst->data.p) {
+      for (int32_t y = 0; y < h; ++y) {
+        std::memmove(RowPtr(*dst, y), RowPtr(src, y), static_cast<size_t>(w) * 4);
+      }
+    }
+    dst->format = src.format;
+    return true;
+  }
+  const int32_t span = 2 * radius + 1;
+  const uint16_t mul = static_cast<uint16_t>((65536 + span / 2) / span);
+  const RowKernels& kernels = KernelsFor(isa);
+  std::vector<uint8_t> tmp(static_cast<size_t>(w) * static_cast<size_t>(h) * 4);
+  if (!BoxBlurPass(kernels, src, *dst, radius, mul, tmp.data(), priority)) {
+    return false;
+  }
+  for (int32_t pass = 1; pass < passes; ++pass) {
+    if (!BoxBlurPass(kernels, *dst, *dst, radius, mul, tmp.data(), priority)) {
+      return false;
+    }
+  }
+  dst->format = src.format;
+  return true;
+}
+
+bool PixelateBitmap(const CpuBitmap& src, CpuBitmap* dst, int32_t cell_px,
+                    PixelKernelIsa isa, TaskPriority priority) {
+  if (!dst || !IsValidBitmap(src) || !IsValidBitmap(*dst) || !SameSize(src, *dst)) {
+    return false;
+  }
+  cell_px = std::clamp(cell_px, 1, kMaxPixelateCellPx);
+  const int32_t w = src.size_px.w;
+  const int32_t h = src.size_px.h;
+  const RowKernels& kernels = KernelsFor(isa);
+  // Strips are runs of whole bands of cell rows; a band reads and writes only
+  // its own rows, so src and dst may still alias.
+  const int32_t bands = (h + cell_px - 1) / cell_px;
+  const size_t band_bytes = static_cast<size_t>(w) * 4 * static_cast<size_t>(cell_px);
+  const bool ok = ForEachRowStrip(bands, band_bytes, 1, priority, [&](int32_t b0, int32_t b1) {
+    // Column sums over one band of cell rows; at most 255 * 256 per lane.
+    std::vector<uint16_t> sums(static_cast<size_t>(w) * 4);
+    std::vector<uint32_t> means(static_cast<size_t>(w / cell_px) + 1);
+    for (int32_t band = b0 * cell_px; band < b1 * cell_px; band += cell_px) {
+      const int32_t rows = std::min(cell_px, h - band);
+      std::fill(sums.begin(), sums.end(), uint16_t{0});
+      for (int32_t y = band; y < band + rows; ++y) {
+        kernels.box_accumulate_row(sums.data(), RowPtr(src, y), nullptr, w * 4);
+      }
+      size_t cell = 0;
+      for (int32_t x0 = 0; x0 < w; x0 += cell_px, ++cell) {
+        const int32_t cols = std::min(cell_px, w - x0);
+        const uint32_t count = static_cast<uint32_t>(cols) * static_cast<uint32_t>(rows);
+        uint32_t total[4] = {};
+        for (int32_t x = x0; x < x0 + cols; ++x) {
+          const uint16_t* s = sums.data() + static_cast<size_t>(x) * 4;
+          total[0] += s[0];
+          total[1] += s[1];
+          total[2] += s[2];
+          total[3] += s[3];
+        }
+        uint8_t mean[4];
+        for (int c = 0; c < 4; ++c) {
+          mean[c] = static_cast<uint8_t>((total[c] + count / 2) / count);
+        }
+        std::memcpy(&means[cell], mean, 4);
+      }
+      for (int32_t y = band; y < band + rows; ++y) {
+        uint8_t* d = RowPtr(*dst, y);
+        cell = 0;
+        for (int32_t x0 = 0; x0 < w; x0 += cell_px, ++cell) {
+          kernels.fill_row(d + static_cast<size_t>(x0) * 4, std::min(cell_px, w - x0),
+                           means[cell]);
+        }
+      }
+    }
+  });
+  if (!ok) {
+    return false;
+  }
+  dst->format = src.format;
+  return true;
+}
+
+bool DownsampleHalf(const CpuBitmap& src, CpuBitmap* dst, PixelKernelIsa isa,
+                    TaskPriority priority) {
+  if (!dst || !IsValidBitmap(src) || !IsValidBitmap(*dst) ||
+      dst->size_px.w != (src.size_px.w + 1) / 2 || dst->size_px.h != (src.size_px.h + 1) / 2) {
+    return false;
+  }
+  const RowKernels& kernels = KernelsFor(isa);
+  const int32_t pairs = src.size_px.w / 2;
+  const bool odd_w = (src.size_px.w & 1) != 0;
+  // Each output row reads two source rows.
+  const size_t row_bytes = static_cast<size_t>(src.size_px.w) * 8;
+  const bool ok = ForEachRowStrip(dst->size_px.h, row_bytes, 1, priority,
+                                  [&](int32_t y0, int32_t y1) {
+    for (int32_t y = y0; y < y1; ++y) {
+      const uint8_t* r0 = RowPtr(src, 2 * y);
+      const uint8_t* r1 = RowPtr(src, std::min(2 * y + 1, src.size_px.h - 1));
+      uint8_t* d = RowPtr(*dst, y);
+      kernels.half_row(r0, r1, d, pairs);
+      if (odd_w) {
+        const size_t last = static_cast<size_t>(src.size_px.w - 1) * 4;
+        uint8_t e0[8];
+        uint8_t e1[8];
+        std::memcpy(e0, r0 + last, 4);
+        std::memcpy(e0 + 4, r0 + last, 4);
+        std::memcpy(e1, r1 + last, 4);
+        std::memcpy(e1 + 4, r1 + last, 4);
+        pixel_kernels::HalfRowScalar(e0, e1, d + static_cast<size_t>(pairs) * 4, 1);
+      }
+    }
+  });
+  if (!ok) {
+    return false;
+  }
+  dst->format = src.format;
+  return true;
+}
+
+bool ResizeLanczos(const CpuBitmap& src, CpuBitmap* dst, PixelKernelIsa isa,
+                   TaskPriority priority) {
+  if (!dst || !IsValidBitmap(src) || !IsValidBitmap(*dst) || src.data.p == dst->data.p) {
+    return false;
+  }
+  const int32_t src_w = src.size_px.w;
+  const int32_t dst_w = dst->size_px.w;
+  const int32_t dst_h = dst->size_px.h;
+  dst->format = src.format;
+  if (SameSize(src, *dst)) {
+    for (int32_t y = 0; y < dst_h; ++y) {
+      std::memcpy(RowPtr(*dst, y), RowPtr(src, y), static_cast<size_t>(src_w) * 4);
+    }
+    return true;
+  }
+  const RowKernels& kernels = KernelsFor(isa);
+  const ResampleAxis cols = BuildResampleAxis(src_w, dst_w);
+  const ResampleAxis rows = BuildResampleAxis(src.size_px.h, dst_h);
+  // Each output row filters `rows.taps` source rows.
+  const size_t row_bytes = static_cast<size_t>(src_w) * 4 * static_cast<size_t>(rows.taps);
+  return ForEachRowStrip(dst_h, row_bytes, 1, priority, [&](int32_t y0, int32_t y1) {
+    std::vector<uint8_t> line(static_cast<size_t>(src_w) * 4);
+    std::vector<const uint8_t*> taps(static_cast<size_t>(rows.taps));
+    for (int32_t y = y0; y < y1; ++y) {
+      const int32_t start = rows.starts[static_cast<size_t>(y)];
+      for (int32_t k = 0; k < rows.taps; ++k) {
+        taps[static_cast<size_t>(k)] = RowPtr(src, start + k);
+      }
+      const int16_t* weights =
+          rows.weights.data() + static_cast<size_t>(y) * static_cast<size_t>(rows.taps);
+      kernels.filter_rows(taps.data(), weights, rows.taps, line.data(), src_w * 4);
+      kernels.filter_columns(line.data(), cols.starts.data(), cols.weights.data(), cols.taps,
+                             RowPtr(*dst, y), dst_w);
+    }
+  });
+}
+
+uint64_t HashBitmap(const CpuBitmap& src, PixelKernelIsa isa) {
+  using pixel_kernels::kHashBlockStripes;
+  using pixel_kernels::kHashLanes;
+  using pixel_kernels::kHashSecret;
+  using pixel_kernels::kHashStripeBytes;
+  if (!IsValidBitmap(src)) {
+    return 0;
+  }
+  const RowKernels& kernels = KernelsFor(isa);
+  uint64_t acc[kHashLanes] = {0x9E3779B1ull,          0x9E3779B185EBCA87ull,
+                              0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull,
+                              0x85EBCA77C2B2AE63ull, 0x85EBCA77ull,
+                              0x27D4EB2F165667C5ull, 0x165667B1ull};
+  const auto scramble = [&acc] {
+    for (int32_t i = 0; i < kHashLanes; ++i) {
+      uint64_t a = acc[i];
+      a ^= a >> 47;
+      a ^= kHashSecret[static_cast<size_t>(kHashBlockStripes + kHashLanes + i)];
+      acc[i] = a * 0x9E3779B1ull;
+    }
+  };
+  const int32_t row_bytes = src.size_px.w * 4;
+  const int32_t full_stripes = row_bytes / kHashStripeBytes;
+  const int32_t tail_bytes = row_bytes % kHashStripeBytes;
+  uint8_t tail[kHashStripeBytes];
+  for (int32_t y = 0; y < src.size_px.h; ++y) {
+    const uint8_t* row = RowPtr(src, y);
+    for (int32_t s = 0; s < full_stripes; s += kHashBlockStripes) {
+      kernels.hash_stripes(acc, row + static_cast<size_t>(s) * kHashStripeBytes,
+                           kHashSecret.data(), std::min(kHashBlockStripes, full_stripes - s));
+      scramble();
+    }
+    if (tail_bytes > 0) {
+      // The zero padding is unambiguous: the width is mixed in below.
+      std::memset(tail, 0, sizeof(tail));
+      std::memcpy(tail, row + static_cast<size_t>(full_stripes) * kHashStripeBytes,
+                  static_cast<size_t>(tail_bytes));
+      kernels.hash_stripes(acc, tail, kHashSecret.data(), 1);
+      scramble();
+    }
+  }
+
+  uint64_t h = ((static_cast<uint64_t>(src.size_px.w) << 32) |
+                static_cast<uint32_t>(src.size_px.h)) *
+                   0x9E3779B185EBCA87ull ^
+               static_cast<uint64_t>(src.format);
+  for (int32_t i = 0; i < kHashLanes; i += 2) {
+    const size_t k = static_cast<size_t>(kHashBlockStripes + 2 * kHashLanes + i);
+    h += MulFold64(acc[i] ^ kHashSecret[k], acc[i + 1] ^ kHashSecret[k + 1]);
+  }
+  h ^= h >> 37;
+  h *= 0x165667919E3779F9ull;
+  return h ^ (h >> 32);
+}
+
+bool SwizzleBitmapRB(const CpuBitmap& src, CpuBitmap* dst, PixelKernelIsa isa) {
+  if (!dst || !IsValidBitmap(src) || !IsValidBitmap(*dst) || !SameSize(src, *dst)) {
+    return false;
+  }
+  const RowKernels& kernels = KernelsFor(isa);
+  for (int32_t y = 0; y < src.size_px.h; ++y) {
+    kernels.swizzle_row(RowPtr(src, y), RowPtr(*dst, y), src.size_px.w);
+  }
+  dst->format =
+      src.format == PixelFormat::BGRA8 ? PixelFormat::RGBA8 : PixelFormat::BGRA8;
+  return true;
+}
+
+} // namespace snappin
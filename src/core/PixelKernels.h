@@ -0,0 +1,92 @@
+#pragma once
+#include "TaskScheduler.h"
+#include "Types.h"
+
+#include <cstdint>
+
+namespace snappin {
+
+// Instruction set used by the pixel kernels. Auto resolves to the best ISA
+// supported by the running CPU; the explicit values exist so tests and
+// benchmarks can pin a specific implementation.
+enum class PixelKernelIsa { Auto, Scalar, SSE2, AVX2, NEON };
+
+bool PixelKernelIsaSupported(PixelKernelIsa isa);
+PixelKernelIsa ActivePixelKernelIsa();
+const char* PixelKernelIsaName(PixelKernelIsa isa);
+
+// All kernels operate on 32bpp bitmaps (BGRA8 or RGBA8) and process
+// size_px.w pixels per row; row padding beyond that is left untouched.
+// Every SIMD path is bit-identical to the scalar reference described below.
+// The blur, pixelate and resampling kernels split large images into strips
+// of rows run on TaskScheduler::Shared() at `priority` (results do not
+// depend on the split); they fail if a strip's scratch cannot be allocated.
+
+// dst.c = static_cast<uint8_t>(src.c * factor) for the three color channels,
+// dst.a = 0xFF. factor is clamped to [0, 1]. src and dst may alias.
+bool DimBitmap(const CpuBitmap& src, CpuBitmap* dst, float factor,
+               PixelKernelIsa isa = PixelKernelIsa::Auto);
+
+// Fills rect (clipped to the bitmap) with color, stored in dst->format order.
+bool FillBitmapRect(CpuBitmap* dst, const RectPX& rect, ColorRGBA color,
+                    PixelKernelIsa isa = PixelKernelIsa::Auto);
+
+// Source-over blend of src onto dst with straight (non-premultiplied) alpha:
+//   a     = div255(src.a * opacity)
+//   dst.c = div255(src.c * a + dst.c * (255 - a))   for B, G, R
+//   dst.a = div255(255   * a + dst.a * (255 - a))
+// where div255(x) rounds x / 255 to nearest. Both bitmaps must share format.
+bool BlendBitmap(const CpuBitmap& src, CpuBitmap* dst, uint8_t opacity = 255,
+                 PixelKernelIsa isa = PixelKernelIsa::Auto);
+
+// Separable box blur, repeated `passes` times; three passes approximate a
+// Gaussian. Windows of 2 * radius + 1 pixels clamp at the bitmap edges (edge
+// pixels repeat). Each axis of each pass stores
+//   min(255, (window_sum * mul + 32768) >> 16),  mul = round(65536 / (2r + 1))
+// for all four channels. radius is clamped to [0, kMaxBoxBlurRadius]; 0 or no
+// passes copies. src and dst may alias. Allocates a w*h scratch image.
+constexpr int32_t kMaxBoxBlurRadius = 64;
+bool BoxBlurBitmap(const CpuBitmap& src, CpuBitmap* dst, int32_t radius,
+                   int32_t passes = 1, PixelKernelIsa isa = PixelKernelIsa::Auto,
+                   TaskPriority priority = TaskPriority::Interactive);
+
+// Mosaic: every cell_px x cell_px cell, counted from the top-left pixel, is
+// filled with the rounded mean of its pixels; cells on the right and bottom
+// edges are cut short. cell_px is clamped to [1, kMaxPixelateCellPx]. src and
+// dst may alias.
+constexpr int32_t kMaxPixelateCellPx = 256;
+bool PixelateBitmap(const CpuBitmap& src, CpuBitmap* dst, int32_t cell_px,
+                    PixelKernelIsa isa = PixelKernelIsa::Auto,
+                    TaskPriority priority = TaskPriority::Interactive);
+
+// 2x2 box downsample (one mip level): dst must be ceil(w / 2) x ceil(h / 2)
+// and each pixel is (a + b + c + d + 2) >> 2 of its block per channel. An odd
+// last column or row is paired with itself. dst->format is set to src's.
+bool DownsampleHalf(const CpuBitmap& src, CpuBitmap* dst,
+                    PixelKernelIsa isa = PixelKernelIsa::Auto,
+                    TaskPriority priority = TaskPriority::Interactive);
+
+// Separable Lanczos-2 resample of src to dst's size (either direction), rows
+// first and then columns. When shrinking an axis by s < 1 the kernel is
+// widened to 2 / s source pixels, so large reductions cost more taps; shrink
+// by DownsampleHalf first to keep them short. Weights are normalized 2.14
+// fixed point with edge taps folded onto the nearest pixel, and every value is
+// rounded and clamped to [0, 255] after each pass. Equal sizes copy. src and
+// dst must not alias. Allocates one row of scratch plus the weight tables.
+bool ResizeLanczos(const CpuBitmap& src, CpuBitmap* dst,
+                   PixelKernelIsa isa = PixelKernelIsa::Auto,
+                   TaskPriority priority = TaskPriority::Interactive);
+
+// Swaps the R and B channels (BGRA8 <-> RGBA8). dst->format is updated to the
+// swapped format of src. src and dst may alias.
+bool SwizzleBitmapRB(const CpuBitmap& src, CpuBitmap* dst,
+                     PixelKernelIsa isa = PixelKernelIsa::Auto);
+
+// 64-bit content hash of the pixels (row padding excluded) mixed with size
+// and format, for finding identical images. Rows are fed to eight 64-bit
+// multiply-accumulate lanes 64 bytes at a time (the XXH3 accumulate step),
+// scrambled every 1 KiB and at each row end. Not collision-resistant against
+// crafted input: equal hashes still need a compare. 0 for an invalid bitmap.
+uint64_t HashBitmap(const CpuBitmap& src, PixelKernelIsa isa = PixelKernelIsa::Auto);
+
+} // namespace snappin
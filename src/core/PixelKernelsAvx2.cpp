@@ -0,0 +1,278 @@
+#include "PixelKernelsInternal.h"
+
+#include <immintrin.h>
+
+#include <cstring>
+
+// Compiled with AVX2 code generation; only reached after runtime detection.
+
+namespace snappin {
+namespace pixel_kernels {
+namespace {
+
+inline __m256i Div255Epu16(__m256i x) {
+  const __m256i t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+void DimRowAvx2(const uint8_t* src, uint8_t* dst, int32_t pixels, uint16_t mul) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i m = _mm256_set1_epi16(static_cast<short>(mul));
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+  int32_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    const __m256i px = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(src + static_cast<size_t>(i) * 4));
+    // unpack/pack operate per 128-bit lane, so pixel order is preserved.
+    const __m256i lo = _mm256_mulhi_epu16(_mm256_unpacklo_epi8(px, zero), m);
+    const __m256i hi = _mm256_mulhi_epu16(_mm256_unpackhi_epi8(px, zero), m);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + static_cast<size_t>(i) * 4),
+                        _mm256_or_si256(_mm256_packus_epi16(lo, hi), alpha));
+  }
+  DimRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+               pixels - i, mul);
+}
+
+void FillRowAvx2(uint8_t* dst, int32_t pixels, uint32_t value) {
+  const __m256i v = _mm256_set1_epi32(static_cast<int>(value));
+  int32_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + static_cast<size_t>(i) * 4), v);
+  }
+  FillRowScalar(dst + static_cast<size_t>(i) * 4, pixels - i, value);
+}
+
+inline __m256i BlendQuadAvx2(__m256i s, __m256i d, __m256i opacity) {
+  const __m256i c255 = _mm256_set1_epi16(255);
+  const __m256i alpha_lanes = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0,
+                                               0, 255, 0, 0, 0);
+  __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+  a = Div255Epu16(_mm256_mullo_epi16(a, opacity));
+  const __m256i inv = _mm256_sub_epi16(c255, a);
+  s = _mm256_or_si256(s, alpha_lanes);
+  const __m256i x =
+      _mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, inv));
+  return Div255Epu16(x);
+}
+
+void BlendRowAvx2(const uint8_t* src, uint8_t* dst, int32_t pixels, uint8_t opacity) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i op = _mm256_set1_epi16(opacity);
+  int32_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + o));
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + o));
+    const __m256i lo = BlendQuadAvx2(_mm256_unpacklo_epi8(s, zero),
+                                     _mm256_unpacklo_epi8(d, zero), op);
+    const __m256i hi = BlendQuadAvx2(_mm256_unpackhi_epi8(s, zero),
+                                     _mm256_unpackhi_epi8(d, zero), op);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + o),
+                        _mm256_packus_epi16(lo, hi));
+  }
+  BlendRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+                 pixels - i, opacity);
+}
+
+void SwizzleRowAvx2(const uint8_t* src, uint8_t* dst, int32_t pixels) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  int32_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + o));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + o),
+                        _mm256_shuffle_epi8(p, shuffle));
+  }
+  SwizzleRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+                   pixels - i);
+}
+
+void BoxAccumulateRowAvx2(uint16_t* sums, const uint8_t* add, const uint8_t* sub,
+                          int32_t count) {
+  int32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums + i));
+    v = _mm256_add_epi16(v, _mm256_cvtepu8_epi16(
+                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i))));
+    if (sub) {
+      v = _mm256_sub_epi16(v, _mm256_cvtepu8_epi16(_mm_loadu_si128(
+                                  reinterpret_cast<const __m128i*>(sub + i))));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + i), v);
+  }
+  BoxAccumulateRowScalar(sums + i, add + i, sub ? sub + i : nullptr, count - i);
+}
+
+void BoxScaleRowAvx2(const uint16_t* hi, const uint16_t* lo, uint8_t* dst, int32_t count,
+                     uint16_t mul) {
+  const __m256i m = _mm256_set1_epi16(static_cast<short>(mul));
+  int32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi + i));
+    if (lo) {
+      s = _mm256_sub_epi16(s, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + i)));
+    }
+    // High half of s * mul plus the carry of the rounding term.
+    const __m256i v = _mm256_add_epi16(_mm256_mulhi_epu16(s, m),
+                                       _mm256_srli_epi16(_mm256_mullo_epi16(s, m), 15));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(_mm256_castsi256_si128(v),
+                                      _mm256_extracti128_si256(v, 1)));
+  }
+  BoxScaleRowScalar(hi + i, lo ? lo + i : nullptr, dst + i, count - i, mul);
+}
+
+// Per-channel pair sums of 8 source pixels from two rows. Lane 0 holds the
+// outputs for pixels 0..3, lane 1 for pixels 4..7.
+inline __m256i HalfSumsAvx2(const uint8_t* r0, const uint8_t* r1) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r0));
+  const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r1));
+  const __m256i lo =
+      _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+  const __m256i hi =
+      _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+  const __m256i sum =
+      _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+  return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+}
+
+void HalfRowAvx2(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int32_t pixels) {
+  int32_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    const size_t s = static_cast<size_t>(i) * 8;
+    const __m256i a = HalfSumsAvx2(r0 + s, r1 + s);
+    const __m256i b = HalfSumsAvx2(r0 + s + 32, r1 + s + 32);
+    // Packing interleaves lanes as [0 1 4 5 | 2 3 6 7]; restore pixel order.
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + static_cast<size_t>(i) * 4),
+                        _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8));
+  }
+  HalfRowScalar(r0 + static_cast<size_t>(i) * 8, r1 + static_cast<size_t>(i) * 8,
+                dst + static_cast<size_t>(i) * 4, pixels - i);
+}
+
+inline int WeightBits(int16_t a, int16_t b) {
+  return static_cast<int>(static_cast<uint16_t>(a) |
+                          (static_cast<uint32_t>(static_cast<uint16_t>(b)) << 16));
+}
+
+void FilterRowsAvx2(const uint8_t* const* rows, const int16_t* weights, int32_t taps,
+                    uint8_t* dst, int32_t count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i round = _mm256_set1_epi32(8192);
+  int32_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i acc0 = round;
+    __m256i acc1 = round;
+    __m256i acc2 = round;
+    __m256i acc3 = round;
+    for (int32_t k = 0; k < taps; k += 2) {
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k] + i));
+      const bool pair = k + 1 < taps;
+      const __m256i b =
+          pair ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k + 1] + i)) : zero;
+      const __m256i w =
+          _mm256_set1_epi32(WeightBits(weights[k], pair ? weights[k + 1] : int16_t{0}));
+      const __m256i lo = _mm256_unpacklo_epi8(a, b);
+      const __m256i hi = _mm256_unpackhi_epi8(a, b);
+      acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), w));
+      acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), w));
+      acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), w));
+      acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), w));
+    }
+    // Per lane, the packs below undo the unpacks above, so bytes stay in order.
+    const __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(acc0, 14),
+                                          _mm256_srai_epi32(acc1, 14));
+    const __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(acc2, 14),
+                                          _mm256_srai_epi32(acc3, 14));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+  for (; i < count; ++i) {
+    dst[i] = FilterRowsAt(rows, weights, taps, i);
+  }
+}
+
+// Two output pixels at a time, one per 128-bit lane.
+void FilterColumnsAvx2(const uint8_t* src, const int32_t* starts, const int16_t* weights,
+                       int32_t taps, uint8_t* dst, int32_t pixels) {
+  const __m256i zero = _mm256_setzero_si256();
+  const size_t stride = static_cast<size_t>(taps);
+  int32_t i = 0;
+  for (; i + 2 <= pixels; i += 2) {
+    const uint8_t* s0 = src + static_cast<size_t>(starts[i]) * 4;
+    const uint8_t* s1 = src + static_cast<size_t>(starts[i + 1]) * 4;
+    const int16_t* w0 = weights + static_cast<size_t>(i) * stride;
+    const int16_t* w1 = w0 + stride;
+    __m256i acc = _mm256_set1_epi32(8192);
+    int32_t k = 0;
+    for (; k + 2 <= taps; k += 2) {
+      const size_t o = static_cast<size_t>(k) * 4;
+      const __m256i px = _mm256_unpacklo_epi8(
+          _mm256_set_m128i(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s1 + o)),
+                           _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s0 + o))),
+          zero);
+      const __m256i pairs = _mm256_unpacklo_epi16(px, _mm256_srli_si256(px, 8));
+      const __m256i w = _mm256_set_m128i(_mm_set1_epi32(WeightBits(w1[k], w1[k + 1])),
+                                         _mm_set1_epi32(WeightBits(w0[k], w0[k + 1])));
+      acc = _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, w));
+    }
+    if (k < taps) {
+      const size_t o = static_cast<size_t>(k) * 4;
+      int32_t a = 0;
+      int32_t b = 0;
+      std::memcpy(&a, s0 + o, 4);
+      std::memcpy(&b, s1 + o, 4);
+      const __m256i px = _mm256_unpacklo_epi8(
+          _mm256_set_m128i(_mm_cvtsi32_si128(b), _mm_cvtsi32_si128(a)), zero);
+      const __m256i w = _mm256_set_m128i(_mm_set1_epi32(WeightBits(w1[k], 0)),
+                                         _mm_set1_epi32(WeightBits(w0[k], 0)));
+      acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_unpacklo_epi16(px, zero), w));
+    }
+    const __m256i packed = _mm256_packus_epi16(
+        _mm256_packs_epi32(_mm256_srai_epi32(acc, 14), zero), zero);
+    const int32_t out0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+    const int32_t out1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+    std::memcpy(dst + static_cast<size_t>(i) * 4, &out0, 4);
+    std::memcpy(dst + static_cast<size_t>(i) * 4 + 4, &out1, 4);
+  }
+  FilterColumnsScalar(src, starts + i, weights + static_cast<size_t>(i) * stride, taps,
+                      dst + static_cast<size_t>(i) * 4, pixels - i);
+}
+
+void HashStripesAvx2(uint64_t* acc, const uint8_t* data, const uint64_t* keys,
+                     int32_t stripes) {
+  __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+  __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4));
+  const auto step = [](__m256i a, const uint8_t* p, const uint64_t* k) {
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(k));
+    const __m256i dk = _mm256_xor_si256(d, key);
+    const __m256i product =
+        _mm256_mul_epu32(dk, _mm256_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+    const __m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_add_epi64(a, _mm256_add_epi64(product, swapped));
+  };
+  for (int32_t s = 0; s < stripes; ++s) {
+    const uint8_t* p = data + static_cast<size_t>(s) * kHashStripeBytes;
+    a0 = step(a0, p, keys + s);
+    a1 = step(a1, p + 32, keys + s + 4);
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), a0);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4), a1);
+}
+
+} // namespace
+
+const RowKernels& Avx2Kernels() {
+  static const RowKernels kernels = {&DimRowAvx2,          &FillRowAvx2,
+                                     &BlendRowAvx2,        &SwizzleRowAvx2,
+                                     &BoxAccumulateRowAvx2, &BoxScaleRowAvx2,
+                                     &HalfRowAvx2,         &FilterRowsAvx2,
+                                     &FilterColumnsAvx2,   &HashStripesAvx2};
+  return kernels;
+}
+
+} // namespace pixel_kernels
+} // namespace snappin
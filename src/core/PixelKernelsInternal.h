@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace snappin {
+namespace pixel_kernels {
+
+// Row kernels shared by every ISA. Each processes `pixels` 32bpp pixels.
+// dim_row multiplies color channels by `mul / 65536` (truncating) and forces
+// alpha to 0xFF; blend_row implements the formula documented on BlendBitmap.
+//
+// The box kernels work on `count` channel values rather than pixels and keep
+// window sums in wrapping 16-bit lanes; every window they are used for sums
+// to less than 65536, so differences of wrapped sums are exact.
+// box_accumulate_row: sums[i] += add[i] - sub[i] (sub may be null).
+// box_scale_row: s = hi[i] - lo[i] (lo may be null),
+//                dst[i] = min(255, (s * mul + 32768) >> 16).
+//
+// The resampling kernels use 2.14 fixed-point weights and round the same way:
+//   v = clamp((sum(w_k * x_k) + 8192) >> 14, 0, 255)   (arithmetic shift)
+// half_row: dst pixel i is the rounded mean of source pixels 2i and 2i + 1 in
+//           rows r0 and r1, per channel (a + b + c + d + 2) >> 2.
+// filter_rows: vertical pass over `count` channel values, x_k = rows[k][i].
+// filter_columns: horizontal pass; output pixel i reads `taps` source pixels
+//                 from starts[i] with weights[i * taps ...].
+// hash_stripes: for each 64-byte stripe s of data, with d_i the i-th
+//               little-endian u64 of the stripe and dk_i = d_i ^ keys[s + i]:
+//                 acc[i ^ 1] += d_i;  acc[i] += lo32(dk_i) * hi32(dk_i)
+//               (see HashBitmap for how stripes, blocks and rows are mixed).
+struct RowKernels {
+  void (*dim_row)(const uint8_t* src, uint8_t* dst, int32_t pixels, uint16_t mul);
+  void (*fill_row)(uint8_t* dst, int32_t pixels, uint32_t value);
+  void (*blend_row)(const uint8_t* src, uint8_t* dst, int32_t pixels,
+                    uint8_t opacity);
+  void (*swizzle_row)(const uint8_t* src, uint8_t* dst, int32_t pixels);
+  void (*box_accumulate_row)(uint16_t* sums, const uint8_t* add, const uint8_t* sub,
+                             int32_t count);
+  void (*box_scale_row)(const uint16_t* hi, const uint16_t* lo, uint8_t* dst,
+                        int32_t count, uint16_t mul);
+  void (*half_row)(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int32_t pixels);
+  void (*filter_rows)(const uint8_t* const* rows, const int16_t* weights, int32_t taps,
+                      uint8_t* dst, int32_t count);
+  void (*filter_columns)(const uint8_t* src, const int32_t* starts, const int16_t* weights,
+                         int32_t taps, uint8_t* dst, int32_t pixels);
+  void (*hash_stripes)(uint64_t* acc, const uint8_t* data, const uint64_t* keys,
+                       int32_t stripes);
+};
+
+inline uint32_t Div255(uint32_t x) { return (x + 128 + ((x + 128) >> 8)) >> 8; }
+
+inline uint8_t ClampFiltered(int32_t sum) {
+  const int32_t v = sum >> 14;
+  return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// One output value of filter_rows.
+inline uint8_t FilterRowsAt(const uint8_t* const* rows, const int16_t* weights, int32_t taps,
+                            int32_t i) {
+  int32_t sum = 8192;
+  for (int32_t k = 0; k < taps; ++k) {
+    sum += weights[k] * rows[k][i];
+  }
+  return ClampFiltered(sum);
+}
+
+// HashBitmap state: 8 accumulator lanes fed 64-byte stripes, scrambled after
+// every block of kHashBlockStripes and at the end of each row. Stripe s of a
+// block is keyed with kHashSecret[s .. s + 7]; the scramble and the final mix
+// use the words after those.
+constexpr int32_t kHashLanes = 8;
+constexpr int32_t kHashStripeBytes = 64;
+constexpr int32_t kHashBlockStripes = 16;
+
+constexpr std::array<uint64_t, 40> MakeHashSecret() {
+  // splitmix64 from a fixed seed.
+  std::array<uint64_t, 40> secret{};
+  uint64_t x = 0x5350494E48415348ull;
+  for (auto& word : secret) {
+    x += 0x9E3779B97F4A7C15ull;
+    uint64_t z = x;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    word = z ^ (z >> 31);
+  }
+  return secret;
+}
+inline constexpr std::array<uint64_t, 40> kHashSecret = MakeHashSecret();
+
+inline uint64_t LoadLe64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Scalar row kernels; SIMD implementations call these for row tails.
+void DimRowScalar(const uint8_t* src, uint8_t* dst, int32_t pixels, uint16_t mul);
+void FillRowScalar(uint8_t* dst, int32_t pixels, uint32_t value);
+void BlendRowScalar(const uint8_t* src, uint8_t* dst, int32_t pixels,
+                    uint8_t opacity);
+void SwizzleRowScalar(const uint8_t* src, uint8_t* dst, int32_t pixels);
+void BoxAccumulateRowScalar(uint16_t* sums, const uint8_t* add, const uint8_t* sub,
+                            int32_t count);
+void BoxScaleRowScalar(const uint16_t* hi, const uint16_t* lo, uint8_t* dst, int32_t count,
+                       uint16_t mul);
+void HalfRowScalar(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int32_t pixels);
+void FilterRowsScalar(const uint8_t* const* rows, const int16_t* weights, int32_t taps,
+                      uint8_t* dst, int32_t count);
+void FilterColumnsScalar(const uint8_t* src, const int32_t* starts, const int16_t* weights,
+                         int32_t taps, uint8_t* dst, int32_t pixels);
+void HashStripesScalar(uint64_t* acc, const uint8_t* data, const uint64_t* keys,
+                       int32_t stripes);
+
+const RowKernels& ScalarKernels();
+#if defined(SNAPPIN_IMGPROC_X86)
+const RowKernels& Sse2Kernels();
+const RowKernels& Avx2Kernels();
+#endif
+#if defined(SNAPPIN_IMGPROC_NEON)
+const RowKernels& NeonKernels();
+#endif
+
+} // namespace pixel_kernels
+} // namespace snappin
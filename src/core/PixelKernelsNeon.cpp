@@ -0,0 +1,218 @@
+#include "PixelKernelsInternal.h"
+
+#include <arm_neon.h>
+
+#include <cstring>
+
+namespace snappin {
+namespace pixel_kernels {
+namespace {
+
+inline uint16x8_t Div255U16(uint16x8_t x) {
+  const uint16x8_t t = vaddq_u16(x, vdupq_n_u16(128));
+  return vshrq_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+inline uint8x8_t MulHiU8(uint8x8_t v, uint16x4_t m) {
+  const uint16x8_t wide = vmovl_u8(v);
+  const uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(wide), m), 16);
+  const uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(wide), m), 16);
+  return vmovn_u16(vcombine_u16(lo, hi));
+}
+
+void DimRowNeon(const uint8_t* src, uint8_t* dst, int32_t pixels, uint16_t mul) {
+  const uint16x4_t m = vdup_n_u16(mul);
+  int32_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    uint8x8x4_t px = vld4_u8(src + o);
+    px.val[0] = MulHiU8(px.val[0], m);
+    px.val[1] = MulHiU8(px.val[1], m);
+    px.val[2] = MulHiU8(px.val[2], m);
+    px.val[3] = vdup_n_u8(0xFF);
+    vst4_u8(dst + o, px);
+  }
+  DimRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+               pixels - i, mul);
+}
+
+void FillRowNeon(uint8_t* dst, int32_t pixels, uint32_t value) {
+  const uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(value));
+  int32_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    vst1q_u8(dst + static_cast<size_t>(i) * 4, v);
+  }
+  FillRowScalar(dst + static_cast<size_t>(i) * 4, pixels - i, value);
+}
+
+void BlendRowNeon(const uint8_t* src, uint8_t* dst, int32_t pixels, uint8_t opacity) {
+  const uint8x8_t op = vdup_n_u8(opacity);
+  const uint8x8_t c255 = vdup_n_u8(255);
+  int32_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    const uint8x8x4_t s = vld4_u8(src + o);
+    uint8x8x4_t d = vld4_u8(dst + o);
+    const uint8x8_t a = vmovn_u16(Div255U16(vmull_u8(s.val[3], op)));
+    const uint8x8_t inv = vsub_u8(c255, a);
+    for (int c = 0; c < 3; ++c) {
+      const uint16x8_t x = vmlal_u8(vmull_u8(s.val[c], a), d.val[c], inv);
+      d.val[c] = vmovn_u16(Div255U16(x));
+    }
+    const uint16x8_t xa = vmlal_u8(vmull_u8(c255, a), d.val[3], inv);
+    d.val[3] = vmovn_u16(Div255U16(xa));
+    vst4_u8(dst + o, d);
+  }
+  BlendRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+                 pixels - i, opacity);
+}
+
+void SwizzleRowNeon(const uint8_t* src, uint8_t* dst, int32_t pixels) {
+  int32_t i = 0;
+  for (; i + 16 <= pixels; i += 16) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    uint8x16x4_t px = vld4q_u8(src + o);
+    const uint8x16_t c0 = px.val[0];
+    px.val[0] = px.val[2];
+    px.val[2] = c0;
+    vst4q_u8(dst + o, px);
+  }
+  SwizzleRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+                   pixels - i);
+}
+
+void BoxAccumulateRowNeon(uint16_t* sums, const uint8_t* add, const uint8_t* sub,
+                          int32_t count) {
+  int32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const uint8x16_t a = vld1q_u8(add + i);
+    uint16x8_t lo = vaddw_u8(vld1q_u16(sums + i), vget_low_u8(a));
+    uint16x8_t hi = vaddw_u8(vld1q_u16(sums + i + 8), vget_high_u8(a));
+    if (sub) {
+      const uint8x16_t b = vld1q_u8(sub + i);
+      lo = vsubw_u8(lo, vget_low_u8(b));
+      hi = vsubw_u8(hi, vget_high_u8(b));
+    }
+    vst1q_u16(sums + i, lo);
+    vst1q_u16(sums + i + 8, hi);
+  }
+  BoxAccumulateRowScalar(sums + i, add + i, sub ? sub + i : nullptr, count - i);
+}
+
+inline uint8x8_t ScaleU16(uint16x8_t s, uint16x4_t m) {
+  const uint16x4_t lo = vrshrn_n_u32(vmull_u16(vget_low_u16(s), m), 16);
+  const uint16x4_t hi = vrshrn_n_u32(vmull_u16(vget_high_u16(s), m), 16);
+  return vqmovn_u16(vcombine_u16(lo, hi));
+}
+
+void BoxScaleRowNeon(const uint16_t* hi, const uint16_t* lo, uint8_t* dst, int32_t count,
+                     uint16_t mul) {
+  const uint16x4_t m = vdup_n_u16(mul);
+  int32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint16x8_t a = vld1q_u16(hi + i);
+    uint16x8_t b = vld1q_u16(hi + i + 8);
+    if (lo) {
+      a = vsubq_u16(a, vld1q_u16(lo + i));
+      b = vsubq_u16(b, vld1q_u16(lo + i + 8));
+    }
+    vst1q_u8(dst + i, vcombine_u8(ScaleU16(a, m), ScaleU16(b, m)));
+  }
+  BoxScaleRowScalar(hi + i, lo ? lo + i : nullptr, dst + i, count - i, mul);
+}
+
+void HalfRowNeon(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int32_t pixels) {
+  int32_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    const size_t s = static_cast<size_t>(i) * 8;
+    // val[0] holds the even source pixels, val[1] the odd ones.
+    const uint32x4x2_t a = vld2q_u32(reinterpret_cast<const uint32_t*>(r0 + s));
+    const uint32x4x2_t b = vld2q_u32(reinterpret_cast<const uint32_t*>(r1 + s));
+    const uint8x16_t ae = vreinterpretq_u8_u32(a.val[0]);
+    const uint8x16_t ao = vreinterpretq_u8_u32(a.val[1]);
+    const uint8x16_t be = vreinterpretq_u8_u32(b.val[0]);
+    const uint8x16_t bo = vreinterpretq_u8_u32(b.val[1]);
+    const uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(ae), vget_low_u8(ao)),
+                                    vaddl_u8(vget_low_u8(be), vget_low_u8(bo)));
+    const uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(ae), vget_high_u8(ao)),
+                                    vaddl_u8(vget_high_u8(be), vget_high_u8(bo)));
+    vst1q_u8(dst + static_cast<size_t>(i) * 4,
+             vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+  }
+  HalfRowScalar(r0 + static_cast<size_t>(i) * 8, r1 + static_cast<size_t>(i) * 8,
+                dst + static_cast<size_t>(i) * 4, pixels - i);
+}
+
+inline uint8x8_t NarrowFiltered(int32x4_t lo, int32x4_t hi) {
+  return vqmovun_s16(
+      vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 14)), vqmovn_s32(vshrq_n_s32(hi, 14))));
+}
+
+void FilterRowsNeon(const uint8_t* const* rows, const int16_t* weights, int32_t taps,
+                    uint8_t* dst, int32_t count) {
+  int32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    int32x4_t lo = vdupq_n_s32(8192);
+    int32x4_t hi = lo;
+    for (int32_t k = 0; k < taps; ++k) {
+      const int16x8_t x = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rows[k] + i)));
+      lo = vmlal_n_s16(lo, vget_low_s16(x), weights[k]);
+      hi = vmlal_n_s16(hi, vget_high_s16(x), weights[k]);
+    }
+    vst1_u8(dst + i, NarrowFiltered(lo, hi));
+  }
+  for (; i < count; ++i) {
+    dst[i] = FilterRowsAt(rows, weights, taps, i);
+  }
+}
+
+void FilterColumnsNeon(const uint8_t* src, const int32_t* starts, const int16_t* weights,
+                       int32_t taps, uint8_t* dst, int32_t pixels) {
+  for (int32_t i = 0; i < pixels; ++i) {
+    const uint8_t* s = src + static_cast<size_t>(starts[i]) * 4;
+    const int16_t* w = weights + static_cast<size_t>(i) * static_cast<size_t>(taps);
+    int32x4_t acc = vdupq_n_s32(8192);
+    for (int32_t k = 0; k < taps; ++k) {
+      uint32_t px = 0;
+      std::memcpy(&px, s + static_cast<size_t>(k) * 4, 4);
+      const int16x8_t x = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(px))));
+      acc = vmlal_n_s16(acc, vget_low_s16(x), w[k]);
+    }
+    const uint32_t out = vget_lane_u32(vreinterpret_u32_u8(NarrowFiltered(acc, acc)), 0);
+    std::memcpy(dst + static_cast<size_t>(i) * 4, &out, 4);
+  }
+}
+
+void HashStripesNeon(uint64_t* acc, const uint8_t* data, const uint64_t* keys,
+                     int32_t stripes) {
+  uint64x2_t a[4];
+  for (int32_t j = 0; j < 4; ++j) {
+    a[j] = vld1q_u64(acc + 2 * j);
+  }
+  for (int32_t s = 0; s < stripes; ++s) {
+    const uint8_t* p = data + static_cast<size_t>(s) * kHashStripeBytes;
+    for (int32_t j = 0; j < 4; ++j) {
+      const uint64x2_t d = vreinterpretq_u64_u8(vld1q_u8(p + 16 * j));
+      const uint64x2_t dk = veorq_u64(d, vld1q_u64(keys + s + 2 * j));
+      a[j] = vmlal_u32(a[j], vmovn_u64(dk), vshrn_n_u64(dk, 32));
+      a[j] = vaddq_u64(a[j], vextq_u64(d, d, 1));
+    }
+  }
+  for (int32_t j = 0; j < 4; ++j) {
+    vst1q_u64(acc + 2 * j, a[j]);
+  }
+}
+
+} // namespace
+
+const RowKernels& NeonKernels() {
+  static const RowKernels kernels = {&DimRowNeon,          &FillRowNeon,
+                                     &BlendRowNeon,        &SwizzleRowNeon,
+                                     &BoxAccumulateRowNeon, &BoxScaleRowNeon,
+                                     &HalfRowNeon,         &FilterRowsNeon,
+                                     &FilterColumnsNeon,   &HashStripesNeon};
+  return kernels;
+}
+
+} // namespace pixel_kernels
+} // namespace snappin
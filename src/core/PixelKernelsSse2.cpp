@@ -0,0 +1,272 @@
+#include "PixelKernelsInternal.h"
+
+#include <emmintrin.h>
+
+#include <cstring>
+
+namespace snappin {
+namespace pixel_kernels {
+namespace {
+
+inline __m128i Div255Epu16(__m128i x) {
+  const __m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+void DimRowSse2(const uint8_t* src, uint8_t* dst, int32_t pixels, uint16_t mul) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i m = _mm_set1_epi16(static_cast<short>(mul));
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+  int32_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    const __m128i px =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + static_cast<size_t>(i) * 4));
+    const __m128i lo = _mm_mulhi_epu16(_mm_unpacklo_epi8(px, zero), m);
+    const __m128i hi = _mm_mulhi_epu16(_mm_unpackhi_epi8(px, zero), m);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + static_cast<size_t>(i) * 4),
+                     _mm_or_si128(_mm_packus_epi16(lo, hi), alpha));
+  }
+  DimRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+               pixels - i, mul);
+}
+
+void FillRowSse2(uint8_t* dst, int32_t pixels, uint32_t value) {
+  const __m128i v = _mm_set1_epi32(static_cast<int>(value));
+  int32_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + static_cast<size_t>(i) * 4), v);
+  }
+  FillRowScalar(dst + static_cast<size_t>(i) * 4, pixels - i, value);
+}
+
+// Blends two pixels held as eight 16-bit lanes.
+inline __m128i BlendPairSse2(__m128i s, __m128i d, __m128i opacity) {
+  const __m128i c255 = _mm_set1_epi16(255);
+  const __m128i alpha_lanes = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+  a = Div255Epu16(_mm_mullo_epi16(a, opacity));
+  const __m128i inv = _mm_sub_epi16(c255, a);
+  s = _mm_or_si128(s, alpha_lanes);
+  const __m128i x = _mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inv));
+  return Div255Epu16(x);
+}
+
+void BlendRowSse2(const uint8_t* src, uint8_t* dst, int32_t pixels, uint8_t opacity) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i op = _mm_set1_epi16(opacity);
+  int32_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + o));
+    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + o));
+    const __m128i lo =
+        BlendPairSse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), op);
+    const __m128i hi =
+        BlendPairSse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), op);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + o), _mm_packus_epi16(lo, hi));
+  }
+  BlendRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+                 pixels - i, opacity);
+}
+
+void SwizzleRowSse2(const uint8_t* src, uint8_t* dst, int32_t pixels) {
+  const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+  const __m128i low = _mm_set1_epi32(0xFF);
+  int32_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    const size_t o = static_cast<size_t>(i) * 4;
+    const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + o));
+    const __m128i c0 = _mm_slli_epi32(_mm_and_si128(p, low), 16);
+    const __m128i c2 = _mm_and_si128(_mm_srli_epi32(p, 16), low);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + o),
+                     _mm_or_si128(_mm_and_si128(p, keep), _mm_or_si128(c0, c2)));
+  }
+  SwizzleRowScalar(src + static_cast<size_t>(i) * 4, dst + static_cast<size_t>(i) * 4,
+                   pixels - i);
+}
+
+void BoxAccumulateRowSse2(uint16_t* sums, const uint8_t* add, const uint8_t* sub,
+                          int32_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  int32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i));
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i + 8));
+    lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(a, zero));
+    hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(a, zero));
+    if (sub) {
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + i));
+      lo = _mm_sub_epi16(lo, _mm_unpacklo_epi8(b, zero));
+      hi = _mm_sub_epi16(hi, _mm_unpackhi_epi8(b, zero));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i + 8), hi);
+  }
+  BoxAccumulateRowScalar(sums + i, add + i, sub ? sub + i : nullptr, count - i);
+}
+
+// (s * mul + 32768) >> 16 per 16-bit lane: the high half of the product plus
+// the carry the rounding term produces out of the low half.
+inline __m128i ScaleEpu16(__m128i s, __m128i m) {
+  return _mm_add_epi16(_mm_mulhi_epu16(s, m), _mm_srli_epi16(_mm_mullo_epi16(s, m), 15));
+}
+
+void BoxScaleRowSse2(const uint16_t* hi, const uint16_t* lo, uint8_t* dst, int32_t count,
+                     uint16_t mul) {
+  const __m128i m = _mm_set1_epi16(static_cast<short>(mul));
+  int32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + i + 8));
+    if (lo) {
+      a = _mm_sub_epi16(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + i)));
+      b = _mm_sub_epi16(b, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + i + 8)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(ScaleEpu16(a, m), ScaleEpu16(b, m)));
+  }
+  BoxScaleRowScalar(hi + i, lo ? lo + i : nullptr, dst + i, count - i, mul);
+}
+
+// Per-channel sums of adjacent pixel pairs in two rows, as 16-bit lanes:
+// source pixels 0..3 of r0 and r1 become [p0 + p1, p2 + p3].
+inline __m128i HalfSumsSse2(const uint8_t* r0, const uint8_t* r1) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0));
+  const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1));
+  const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+  const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+  const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+  return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+void HalfRowSse2(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int32_t pixels) {
+  int32_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    const size_t s = static_cast<size_t>(i) * 8;
+    const __m128i a = HalfSumsSse2(r0 + s, r1 + s);
+    const __m128i b = HalfSumsSse2(r0 + s + 16, r1 + s + 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + static_cast<size_t>(i) * 4),
+                     _mm_packus_epi16(a, b));
+  }
+  HalfRowScalar(r0 + static_cast<size_t>(i) * 8, r1 + static_cast<size_t>(i) * 8,
+                dst + static_cast<size_t>(i) * 4, pixels - i);
+}
+
+// Two 16-bit weights interleaved for _mm_madd_epi16 against (x_k, x_k+1).
+inline __m128i WeightPair(int16_t a, int16_t b) {
+  return _mm_set1_epi32(static_cast<int>(static_cast<uint16_t>(a) |
+                                         (static_cast<uint32_t>(static_cast<uint16_t>(b))
+                                          << 16)));
+}
+
+inline __m128i PackFilter(__m128i a, __m128i b, __m128i c, __m128i d) {
+  const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(a, 14), _mm_srai_epi32(b, 14));
+  const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(c, 14), _mm_srai_epi32(d, 14));
+  return _mm_packus_epi16(lo, hi);
+}
+
+void FilterRowsSse2(const uint8_t* const* rows, const int16_t* weights, int32_t taps,
+                    uint8_t* dst, int32_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi32(8192);
+  int32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i acc0 = round;
+    __m128i acc1 = round;
+    __m128i acc2 = round;
+    __m128i acc3 = round;
+    int32_t k = 0;
+    for (; k + 2 <= taps; k += 2) {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k + 1] + i));
+      const __m128i w = WeightPair(weights[k], weights[k + 1]);
+      const __m128i lo = _mm_unpacklo_epi8(a, b);
+      const __m128i hi = _mm_unpackhi_epi8(a, b);
+      acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+      acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+      acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+      acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+    }
+    if (k < taps) {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+      const __m128i w = WeightPair(weights[k], 0);
+      const __m128i lo = _mm_unpacklo_epi8(a, zero);
+      const __m128i hi = _mm_unpackhi_epi8(a, zero);
+      acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(lo, zero), w));
+      acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(lo, zero), w));
+      acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(hi, zero), w));
+      acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(hi, zero), w));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), PackFilter(acc0, acc1, acc2, acc3));
+  }
+  for (; i < count; ++i) {
+    dst[i] = FilterRowsAt(rows, weights, taps, i);
+  }
+}
+
+void FilterColumnsSse2(const uint8_t* src, const int32_t* starts, const int16_t* weights,
+                       int32_t taps, uint8_t* dst, int32_t pixels) {
+  const __m128i zero = _mm_setzero_si128();
+  for (int32_t i = 0; i < pixels; ++i) {
+    const uint8_t* s = src + static_cast<size_t>(starts[i]) * 4;
+    const int16_t* w = weights + static_cast<size_t>(i) * static_cast<size_t>(taps);
+    __m128i acc = _mm_set1_epi32(8192);
+    int32_t k = 0;
+    for (; k + 2 <= taps; k += 2) {
+      // [a0 a1 a2 a3 b0 b1 b2 b3] -> [a0 b0 a1 b1 a2 b2 a3 b3]
+      const __m128i px = _mm_unpacklo_epi8(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + static_cast<size_t>(k) * 4)),
+          zero);
+      const __m128i pairs = _mm_unpacklo_epi16(px, _mm_srli_si128(px, 8));
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, WeightPair(w[k], w[k + 1])));
+    }
+    if (k < taps) {
+      int32_t last = 0;
+      std::memcpy(&last, s + static_cast<size_t>(k) * 4, 4);
+      const __m128i px = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+      acc = _mm_add_epi32(
+          acc, _mm_madd_epi16(_mm_unpacklo_epi16(px, zero), WeightPair(w[k], 0)));
+    }
+    const __m128i packed = _mm_packs_epi32(_mm_srai_epi32(acc, 14), zero);
+    const int32_t out = _mm_cvtsi128_si32(_mm_packus_epi16(packed, zero));
+    std::memcpy(dst + static_cast<size_t>(i) * 4, &out, 4);
+  }
+}
+
+void HashStripesSse2(uint64_t* acc, const uint8_t* data, const uint64_t* keys,
+                     int32_t stripes) {
+  __m128i a[4];
+  for (int32_t j = 0; j < 4; ++j) {
+    a[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + 2 * j));
+  }
+  for (int32_t s = 0; s < stripes; ++s) {
+    const uint8_t* p = data + static_cast<size_t>(s) * kHashStripeBytes;
+    for (int32_t j = 0; j < 4; ++j) {
+      const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * j));
+      const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + s + 2 * j));
+      const __m128i dk = _mm_xor_si128(d, k);
+      const __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+      const __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+      a[j] = _mm_add_epi64(a[j], _mm_add_epi64(product, swapped));
+    }
+  }
+  for (int32_t j = 0; j < 4; ++j) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2 * j), a[j]);
+  }
+}
+
+} // namespace
+
+const RowKernels& Sse2Kernels() {
+  static const RowKernels kernels = {&DimRowSse2,          &FillRowSse2,
+                                     &BlendRowSse2,        &SwizzleRowSse2,
+                                     &BoxAccumulateRowSse2, &BoxScaleRowSse2,
+                                     &HalfRowSse2,         &FilterRowsSse2,
+                                     &FilterColumnsSse2,   &HashStripesSse2};
+  return kernels;
+}
+
+} // namespace pixel_kernels
+} // namespace snappin
@@ -0,0 +1,606 @@
+#include "Rasterizer.h"
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <new>
+#include <thread>
+
+namespace snappin {
+namespace {
+
+struct Capsule {
+  PointF a;
+  PointF b;
+  float radius = 0.0f;
+};
+
+// Everything one blend pass draws: the union of its capsules and polygons,
+// in one color.
+struct Layer {
+  std::vector<Capsule> capsules;
+  std::vector<std::vector<PointF>> polygons;
+  ColorRGBA color{};
+  float alpha = 0.0f;
+  // Pixel bounds, inclusive-exclusive.
+  int32_t x0 = 0;
+  int32_t y0 = 0;
+  int32_t x1 = 0;
+  int32_t y1 = 0;
+};
+
+float Clamp01(float v) { return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v); }
+
+bool Finite(const PointF& p) { return std::isfinite(p.x) && std::isfinite(p.y); }
+
+void GrowBounds(Layer* layer, float min_x, float min_y, float max_x, float max_y) {
+  // One extra pixel for the anti-aliasing ramp and float slop.
+  const auto lo = [](float v) {
+    return static_cast<int32_t>(std::max(-1.0e9f, std::floor(v) - 1.0f));
+  };
+  const auto hi = [](float v) {
+    return static_cast<int32_t>(std::min(1.0e9f, std::ceil(v) + 2.0f));
+  };
+  if (layer->x1 <= layer->x0 || layer->y1 <= layer->y0) {
+    layer->x0 = lo(min_x);
+    layer->y0 = lo(min_y);
+    layer->x1 = hi(max_x);
+    layer->y1 = hi(max_y);
+    return;
+  }
+  layer->x0 = std::min(layer->x0, lo(min_x));
+  layer->y0 = std::min(layer->y0, lo(min_y));
+  layer->x1 = std::max(layer->x1, hi(max_x));
+  layer->y1 = std::max(layer->y1, hi(max_y));
+}
+
+void AddCapsule(Layer* layer, const PointF& a, const PointF& b, float radius) {
+  layer->capsules.push_back(Capsule{a, b, radius});
+  GrowBounds(layer, std::min(a.x, b.x) - radius, std::min(a.y, b.y) - radius,
+             std::max(a.x, b.x) + radius, std::max(a.y, b.y) + radius);
+}
+
+void AddPolygon(Layer* layer, std::vector<PointF> poly) {
+  if (poly.size() < 3) {
+    return;
+  }
+  float min_x = poly[0].x;
+  float max_x = poly[0].x;
+  float min_y = poly[0].y;
+  float max_y = poly[0].y;
+  for (const PointF& p : poly) {
+    min_x = std::min(min_x, p.x);
+    max_x = std::max(max_x, p.x);
+    min_y = std::min(min_y, p.y);
+    max_y = std::max(max_y, p.y);
+  }
+  layer->polygons.push_back(std::move(poly));
+  GrowBounds(layer, min_x, min_y, max_x, max_y);
+}
+
+void AddPath(Layer* layer, const std::vector<PointF>& points, bool closed, float radius) {
+  if (points.size() == 1) {
+    AddCapsule(layer, points[0], points[0], radius);
+    return;
+  }
+  for (size_t i = 0; i + 1 < points.size(); ++i) {
+    AddCapsule(layer, points[i], points[i + 1], radius);
+  }
+  if (closed && points.size() > 2) {
+    AddCapsule(layer, points.back(), points.front(), radius);
+  }
+}
+
+void BuildLayers(const VectorShape& shape, std::vector<Layer>* out) {
+  if (shape.points.empty()) {
+    return;
+  }
+  for (const PointF& p : shape.points) {
+    if (!Finite(p)) {
+      return;
+    }
+  }
+
+  std::vector<PointF> outline = shape.points;
+  if (shape.kind == ShapeKind::Rect) {
+    if (shape.points.size() < 2) {
+      return;
+    }
+    const float x0 = std::min(shape.points[0].x, shape.points[1].x);
+    const float x1 = std::max(shape.points[0].x, shape.points[1].x);
+    const float y0 = std::min(shape.points[0].y, shape.points[1].y);
+    const float y1 = std::max(shape.points[0].y, shape.points[1].y);
+    outline = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+  }
+  const bool closed = shape.kind == ShapeKind::Rect || shape.kind == ShapeKind::Polygon;
+
+  if (closed && shape.fill.enabled) {
+    Layer fill;
+    fill.color = shape.fill.color;
+    fill.alpha = Clamp01(shape.fill.opacity) * (shape.fill.color.a / 255.0f);
+    AddPolygon(&fill, outline);
+    if (fill.alpha > 0.0f && !fill.polygons.empty()) {
+      out->push_back(std::move(fill));
+    }
+  }
+
+  const float width = std::isfinite(shape.stroke.width) ? shape.stroke.width : 0.0f;
+  if (width <= 0.0f) {
+    return;
+  }
+  Layer stroke;
+  stroke.color = shape.stroke.color;
+  stroke.alpha = Clamp01(shape.stroke.opacity) * (shape.stroke.color.a / 255.0f);
+  // Hairlines keep a one-pixel footprint and fade instead.
+  if (width < 1.0f) {
+    stroke.alpha *= width;
+  }
+  const float radius = std::max(width, 1.0f) * 0.5f;
+  if (stroke.alpha <= 0.0f) {
+    return;
+  }
+
+  switch (shape.kind) {
+    case ShapeKind::Rect:
+    case ShapeKind::Polygon:
+      AddPath(&stroke, outline, true, radius);
+      break;
+    case ShapeKind::Pencil:
+      AddPath(&stroke, shape.points, false, radius);
+      break;
+    case ShapeKind::Line:
+    case ShapeKind::Arrow: {
+      const PointF a = shape.points[0];
+      const PointF b = shape.points.size() > 1 ? shape.points[1] : a;
+      const float dx = b.x - a.x;
+      const float dy = b.y - a.y;
+      const float len = std::sqrt(dx * dx + dy * dy);
+      if (shape.kind == ShapeKind::Line || len < 1.0f) {
+        AddCapsule(&stroke, a, b, radius);
+        break;
+      }
+      const float ux = dx / len;
+      const float uy = dy / len;
+      const float head_len = std::max(8.0f, width * 4.0f);
+      const float wing = std::max(5.0f, width * 2.0f);
+      const PointF base{b.x - ux * head_len, b.y - uy * head_len};
+      // The shaft stops inside the head so the tip stays sharp.
+      const float shaft = std::max(0.0f, len - head_len * 0.5f);
+      AddCapsule(&stroke, a, PointF{a.x + ux * shaft, a.y + uy * shaft}, radius);
+      AddPolygon(&stroke, {b, {base.x - uy * wing, base.y + ux * wing},
+                           {base.x + uy * wing, base.y - ux * wing}});
+      break;
+    }
+  }
+  if (!stroke.capsules.empty() || !stroke.polygons.empty()) {
+    out->push_back(std::move(stroke));
+  }
+}
+
+// Signed-area accumulation: each edge adds, per pixel cell, the area it
+// sweeps to its right; a running sum along a row gives exact coverage.
+class Accumulator {
+public:
+  // Rows [y0, y1) of a target `width` pixels wide. Cells run to width + 1 so
+  // edges clamped onto the right border still land in the buffer.
+  bool Reset(int32_t width, int32_t y0, int32_t y1) {
+    width_ = width;
+    y0_ = y0;
+    y1_ = y1;
+    stride_ = static_cast<size_t>(width) + 2;
+    try {
+      cells_.assign(stride_ * static_cast<size_t>(y1 - y0), 0.0f);
+    } catch (const std::bad_alloc&) {
+      return false;
+    }
+    return true;
+  }
+
+  float* row(int32_t y) { return cells_.data() + static_cast<size_t>(y - y0_) * stride_; }
+
+  // Clamps the edge into [0, width] horizontally. Parts left of the target
+  // are projected onto x = 0 (they still count for every pixel to their
+  // right); parts right of it onto x = width, where they are never read.
+  void AddEdge(PointF p0, PointF p1) {
+    if (p0.y == p1.y) {
+      return;
+    }
+    const float w = static_cast<float>(width_);
+    // Split parameters, ascending: 0, crossings of x = 0 and x = width, 1.
+    float ts[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    int n = 1;
+    if (p0.x != p1.x) {
+      for (float bound : {0.0f, w}) {
+        const float t = (bound - p0.x) / (p1.x - p0.x);
+        if (t > 0.0f && t < 1.0f) {
+          ts[n++] = t;
+        }
+      }
+      if (n == 3 && ts[1] > ts[2]) {
+        std::swap(ts[1], ts[2]);
+      }
+    }
+    ts[n++] = 1.0f;
+    for (int i = 0; i + 1 < n; ++i) {
+      PointF a = Lerp(p0, p1, ts[i]);
+      PointF b = Lerp(p0, p1, ts[i + 1]);
+      if (i == 0) {
+        a = p0;
+      }
+      if (i + 2 == n) {
+        b = p1;
+      }
+      const float mid = 0.5f * (a.x + b.x);
+      if (mid <= 0.0f) {
+        a.x = b.x = 0.0f;
+      } else if (mid >= w) {
+        a.x = b.x = w;
+      } else {
+        a.x = std::clamp(a.x, 0.0f, w);
+        b.x = std::clamp(b.x, 0.0f, w);
+      }
+      DrawLine(a, b);
+    }
+  }
+
+private:
+  static PointF Lerp(const PointF& a, const PointF& b, float t) {
+    return PointF{a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+  }
+
+  void DrawLine(PointF p0, PointF p1) {
+    if (p0.y == p1.y) {
+      return;
+    }
+    float dir = 1.0f;
+    if (p0.y > p1.y) {
+      std::swap(p0, p1);
+      dir = -1.0f;
+    }
+    const float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+    const int32_t first = std::max(y0_, static_cast<int32_t>(std::floor(p0.y)));
+    const int32_t last = std::min(y1_, static_cast<int32_t>(std::ceil(p1.y)));
+    for (int32_t y = first; y < last; ++y) {
+      // Absolute row coordinates keep the result independent of banding.
+      const float ya = std::max(static_cast<float>(y), p0.y);
+      const float yb = std::min(static_cast<float>(y + 1), p1.y);
+      if (yb <= ya) {
+        continue;
+      }
+      const float x = p0.x + (ya - p0.y) * dxdy;
+      const float xnext = p0.x + (yb - p0.y) * dxdy;
+      const float d = (yb - ya) * dir;
+      const float x0 = std::min(x, xnext);
+      const float x1 = std::max(x, xnext);
+      const float x0floor = std::floor(x0);
+      const int32_t x0i = static_cast<int32_t>(x0floor);
+      const float x1ceil = std::ceil(x1);
+      const int32_t x1i = static_cast<int32_t>(x1ceil);
+      float* a = row(y);
+      if (x1i <= x0i + 1) {
+        const float xmf = 0.5f * (x + xnext) - x0floor;
+        a[x0i] += d - d * xmf;
+        a[x0i + 1] += d * xmf;
+      } else {
+        const float s = 1.0f / (x1 - x0);
+        const float x0f = x0 - x0floor;
+        const float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+        const float x1f = x1 - x1ceil + 1.0f;
+        const float am = 0.5f * s * x1f * x1f;
+        a[x0i] += d * a0;
+        if (x1i == x0i + 2) {
+          a[x0i + 1] += d * (1.0f - a0 - am);
+        } else {
+          const float a1 = s * (1.5f - x0f);
+          a[x0i + 1] += d * (a1 - a0);
+          for (int32_t xi = x0i + 2; xi < x1i - 1; ++xi) {
+            a[xi] += d * s;
+          }
+          const float a2 = a1 + static_cast<float>(x1i - x0i - 3) * s;
+          a[x1i - 1] += d * (1.0f - a2 - am);
+        }
+        a[x1i] += d * am;
+      }
+    }
+  }
+
+  std::vector<float> cells_;
+  size_t stride_ = 0;
+  int32_t width_ = 0;
+  int32_t y0_ = 0;
+  int32_t y1_ = 0;
+};
+
+float DistanceToSegment(float px, float py, const Capsule& c) {
+  const float vx = c.b.x - c.a.x;
+  const float vy = c.b.y - c.a.y;
+  const float wx = px - c.a.x;
+  const float wy = py - c.a.y;
+  const float len_sq = vx * vx + vy * vy;
+  float t = 0.0f;
+  if (len_sq > 0.0f) {
+    t = Clamp01((wx * vx + wy * vy) / len_sq);
+  }
+  const float dx = wx - vx * t;
+  const float dy = wy - vy * t;
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+// Renders one band: rows [y0, y1), columns [x0, x1) of the target.
+class BandRenderer {
+public:
+  BandRenderer(const CpuBitmap& target, int32_t x0, int32_t x1, int32_t y0, int32_t y1)
+      : target_(target), x0_(x0), x1_(x1), y0_(y0), y1_(y1) {}
+
+  bool Render(const std::vector<Layer>& layers) {
+    try {
+      coverage_.assign(static_cast<size_t>(x1_ - x0_) * static_cast<size_t>(y1_ - y0_),
+                       0.0f);
+    } catch (const std::bad_alloc&) {
+      return false;
+    }
+    bool acc_ready = false;
+    for (const Layer& layer : layers) {
+      const int32_t lx0 = std::max(x0_, layer.x0);
+      const int32_t lx1 = std::min(x1_, layer.x1);
+      const int32_t ly0 = std::max(y0_, layer.y0);
+      const int32_t ly1 = std::min(y1_, layer.y1);
+      if (lx1 <= lx0 || ly1 <= ly0) {
+        continue;
+      }
+      for (const Capsule& capsule : layer.capsules) {
+        AddCapsule(capsule, lx0, lx1, ly0, ly1);
+      }
+      if (!layer.polygons.empty()) {
+        if (!acc_ready) {
+          if (!acc_.Reset(target_.size_px.w, y0_, y1_)) {
+            return false;
+          }
+          acc_ready = true;
+        }
+        AddPolygons(layer, lx0, lx1, ly0, ly1);
+      }
+      Blend(layer, lx0, lx1, ly0, ly1);
+    }
+    return true;
+  }
+
+private:
+  float* coverage_row(int32_t y) {
+    return coverage_.data() + static_cast<size_t>(y - y0_) * static_cast<size_t>(x1_ - x0_) -
+           x0_;
+  }
+
+  void AddCapsule(const Capsule& c, int32_t lx0, int32_t lx1, int32_t ly0, int32_t ly1) {
+    const float reach = c.radius + 0.5f;
+    const int32_t cy0 =
+        std::max(ly0, static_cast<int32_t>(std::floor(std::min(c.a.y, c.b.y) - reach)));
+    const int32_t cy1 =
+        std::min(ly1, static_cast<int32_t>(std::ceil(std::max(c.a.y, c.b.y) + reach)) + 1);
+    const int32_t bx0 =
+        std::max(lx0, static_cast<int32_t>(std::floor(std::min(c.a.x, c.b.x) - reach)));
+    const int32_t bx1 =
+        std::min(lx1, static_cast<int32_t>(std::ceil(std::max(c.a.x, c.b.x) + reach)) + 1);
+    const float vx = c.b.x - c.a.x;
+    const float vy = c.b.y - c.a.y;
+    const float len = std::sqrt(vx * vx + vy * vy);
+    // Unit normal; rows only need the columns within `reach` of the line.
+    const float nx = len > 0.0f ? -vy / len : 0.0f;
+    const float ny = len > 0.0f ? vx / len : 0.0f;
+    for (int32_t y = cy0; y < cy1; ++y) {
+      const float py = static_cast<float>(y) + 0.5f;
+      int32_t sx0 = bx0;
+      int32_t sx1 = bx1;
+      if (std::fabs(nx) > 1e-4f) {
+        const float t = ny * (py - c.a.y);
+        const float ea = c.a.x + (-reach - t) / nx;
+        const float eb = c.a.x + (reach - t) / nx;
+        sx0 = std::max(sx0, static_cast<int32_t>(std::floor(std::min(ea, eb) - 0.5f)));
+        sx1 = std::min(sx1, static_cast<int32_t>(std::ceil(std::max(ea, eb) - 0.5f)) + 1);
+      }
+      float* cov = coverage_row(y);
+      for (int32_t x = sx0; x < sx1; ++x) {
+        const float d = DistanceToSegment(static_cast<float>(x) + 0.5f, py, c);
+        const float v = Clamp01(reach - d);
+        if (v > cov[x]) {
+          cov[x] = v;
+        }
+      }
+    }
+  }
+
+  void AddPolygons(const Layer& layer, int32_t lx0, int32_t lx1, int32_t ly0, int32_t ly1) {
+    float min_x = layer.polygons[0][0].x;
+    float max_x = min_x;
+    for (const auto& poly : layer.polygons) {
+      for (size_t i = 0; i < poly.size(); ++i) {
+        acc_.AddEdge(poly[i], poly[(i + 1) % poly.size()]);
+        min_x = std::min(min_x, poly[i].x);
+        max_x = std::max(max_x, poly[i].x);
+      }
+    }
+    // Cells written lie in [floor(min_x), ceil(max_x) + 1] clamped to the
+    // buffer; sum from the first one and clear as we go.
+    const int32_t w = target_.size_px.w;
+    const int32_t sx0 = std::clamp(static_cast<int32_t>(std::floor(min_x)), 0, w);
+    const int32_t sx1 = std::clamp(static_cast<int32_t>(std::ceil(max_x)) + 2, 0, w + 2);
+    const int32_t ay0 = std::max(y0_, layer.y0);
+    const int32_t ay1 = std::min(y1_, layer.y1);
+    for (int32_t y = ay0; y < ay1; ++y) {
+      float* a = acc_.row(y);
+      const bool blend_row = y >= ly0 && y < ly1;
+      float* cov = coverage_row(y);
+      float sum = 0.0f;
+      for (int32_t x = sx0; x < sx1; ++x) {
+        sum += a[x];
+        a[x] = 0.0f;
+        if (blend_row && x >= lx0 && x < lx1) {
+          const float v = std::min(1.0f, std::fabs(sum));
+          if (v > cov[x]) {
+            cov[x] = v;
+          }
+        }
+      }
+    }
+  }
+
+  void Blend(const Layer& layer, int32_t lx0, int32_t lx1, int32_t ly0, int32_t ly1) {
+    const bool bgra = target_.format == PixelFormat::BGRA8;
+    const uint32_t c0 = bgra ? layer.color.b : layer.color.r;
+    const uint32_t c1 = layer.color.g;
+    const uint32_t c2 = bgra ? layer.color.r : layer.color.b;
+    const float alpha255 = layer.alpha * 255.0f;
+    for (int32_t y = ly0; y < ly1; ++y) {
+      float* cov = coverage_row(y);
+      uint8_t* px = static_cast<uint8_t*>(target_.data.p) +
+                    static_cast<size_t>(y) * static_cast<size_t>(target_.stride_bytes) +
+                    static_cast<size_t>(lx0) * 4;
+      for (int32_t x = lx0; x < lx1; ++x, px += 4) {
+        const float v = cov[x];
+        if (v <= 0.0f) {
+          continue;
+        }
+        cov[x] = 0.0f;
+        const uint32_t a = static_cast<uint32_t>(v * alpha255 + 0.5f);
+        if (a == 0) {
+          continue;
+        }
+        const uint32_t inv = 255 - a;
+        px[0] = static_cast<uint8_t>((c0 * a + px[0] * inv + 127) / 255);
+        px[1] = static_cast<uint8_t>((c1 * a + px[1] * inv + 127) / 255);
+        px[2] = static_cast<uint8_t>((c2 * a + px[2] * inv + 127) / 255);
+        px[3] = static_cast<uint8_t>(a + (px[3] * inv + 127) / 255);
+      }
+    }
+  }
+
+  const CpuBitmap& target_;
+  const int32_t x0_;
+  const int32_t x1_;
+  const int32_t y0_;
+  const int32_t y1_;
+  std::vector<float> coverage_;
+  Accumulator acc_;
+};
+
+} // namespace
+
+RectPX ShapeBounds(const VectorShape& shape) {
+  std::vector<Layer> layers;
+  BuildLayers(shape, &layers);
+  RectPX out;
+  bool any = false;
+  int32_t x0 = 0;
+  int32_t y0 = 0;
+  int32_t x1 = 0;
+  int32_t y1 = 0;
+  for (const Layer& layer : layers) {
+    if (!any) {
+      x0 = layer.x0;
+      y0 = layer.y0;
+      x1 = layer.x1;
+      y1 = layer.y1;
+      any = true;
+      continue;
+    }
+    x0 = std::min(x0, layer.x0);
+    y0 = std::min(y0, layer.y0);
+    x1 = std::max(x1, layer.x1);
+    y1 = std::max(y1, layer.y1);
+  }
+  if (any) {
+    out = RectPX{x0, y0, x1 - x0, y1 - y0};
+  }
+  return out;
+}
+
+bool RasterizeCoverage(const std::vector<std::vector<PointF>>& contours, const SizePX& size,
+                       uint8_t* mask, int32_t stride) {
+  if (!mask || size.w <= 0 || size.h <= 0 || stride < size.w) {
+    return false;
+  }
+  Accumulator acc;
+  if (!acc.Reset(size.w, 0, size.h)) {
+    return false;
+  }
+  for (const auto& contour : contours) {
+    for (const PointF& p : contour) {
+      if (!Finite(p)) {
+        return false;
+      }
+    }
+    for (size_t i = 0; contour.size() > 2 && i < contour.size(); ++i) {
+      acc.AddEdge(contour[i], contour[(i + 1) % contour.size()]);
+    }
+  }
+  for (int32_t y = 0; y < size.h; ++y) {
+    const float* a = acc.row(y);
+    uint8_t* out = mask + static_cast<size_t>(y) * static_cast<size_t>(stride);
+    float sum = 0.0f;
+    for (int32_t x = 0; x < size.w; ++x) {
+      sum += a[x];
+      out[x] = static_cast<uint8_t>(std::min(1.0f, std::fabs(sum)) * 255.0f + 0.5f);
+    }
+  }
+  return true;
+}
+
+bool RasterizeShapes(const VectorShape* shapes, size_t count, const CpuBitmap& target,
+                     const RasterOptions& options) {
+  if (!target.data.p || target.size_px.w <= 0 || target.size_px.h <= 0 ||
+      target.stride_bytes < target.size_px.w * 4) {
+    return false;
+  }
+  int32_t x0 = 0;
+  int32_t y0 = 0;
+  int32_t x1 = target.size_px.w;
+  int32_t y1 = target.size_px.h;
+  if (options.clip.w > 0 && options.clip.h > 0) {
+    x0 = std::max(x0, options.clip.x);
+    y0 = std::max(y0, options.clip.y);
+    x1 = std::min(x1, options.clip.x + options.clip.w);
+    y1 = std::min(y1, options.clip.y + options.clip.h);
+  }
+  if (x1 <= x0 || y1 <= y0 || count == 0) {
+    return true;
+  }
+
+  std::vector<Layer> layers;
+  try {
+    for (size_t i = 0; i < count; ++i) {
+      BuildLayers(shapes[i], &layers);
+    }
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+  // Drop layers outside the clip up front so bands skip them cheaply.
+  layers.erase(std::remove_if(layers.begin(), layers.end(),
+                              [&](const Layer& l) {
+                                return l.x1 <= x0 || l.x0 >= x1 || l.y1 <= y0 || l.y0 >= y1;
+                              }),
+               layers.end());
+  if (layers.empty()) {
+    return true;
+  }
+
+  const int32_t band = std::max<int32_t>(1, options.tile_rows);
+  const int32_t bands = (y1 - y0 + band - 1) / band;
+  int32_t threads = options.threads;
+  if (threads <= 0) {
+    threads = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+  }
+  std::atomic<bool> failed{false};
+  const bool ok = TaskScheduler::Shared().ParallelFor(bands, threads, [&](int32_t i) {
+    const int32_t by0 = y0 + i * band;
+    const int32_t by1 = std::min(y1, by0 + band);
+    BandRenderer renderer(target, x0, x1, by0, by1);
+    if (!renderer.Render(layers)) {
+      failed.store(true, std::memory_order_relaxed);
+    }
+  });
+  return ok && !failed.load();
+}
+
+} // namespace snappin
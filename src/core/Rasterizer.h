@@ -0,0 +1,64 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snappin {
+
+enum class ShapeKind {
+  Rect,    // points[0], points[1]: opposite corners of the outline
+  Line,    // points[0] -> points[1]
+  Arrow,   // points[0] -> points[1], filled head at points[1]
+  Pencil,  // open polyline through all points
+  Polygon, // closed outline through all points
+};
+
+// Points are continuous pixel coordinates (see PointF).
+struct VectorShape {
+  ShapeKind kind = ShapeKind::Line;
+  std::vector<PointF> points;
+  // Outlines are centered on the path with round caps and joins. A zero
+  // width or opacity draws no outline.
+  StrokeStyle stroke;
+  // Interior of Rect and Polygon shapes (nonzero winding), drawn under the
+  // outline.
+  FillStyle fill;
+};
+
+struct RasterOptions {
+  // Only pixels inside are written; empty means the whole target.
+  RectPX clip{};
+  // Horizontal bands of this many rows are rendered independently.
+  int32_t tile_rows = 64;
+  // Worker threads for the bands. 0 uses the hardware concurrency.
+  int32_t threads = 1;
+};
+
+// Composites `shapes` in order (source-over, anti-aliased) into a BGRA8 or
+// RGBA8 target. Coverage is exact area for fills and a one-pixel ramp across
+// outline edges. Each shape blends once, so overlapping parts of one outline
+// never double up its opacity. The result does not depend on the clip, band
+// height or thread count. Returns false on an invalid target or allocation
+// failure (the target may then be partly drawn).
+bool RasterizeShapes(const VectorShape* shapes, size_t count, const CpuBitmap& target,
+                     const RasterOptions& options = RasterOptions{});
+inline bool RasterizeShapes(const std::vector<VectorShape>& shapes, const CpuBitmap& target,
+                            const RasterOptions& options = RasterOptions{}) {
+  return RasterizeShapes(shapes.data(), shapes.size(), target, options);
+}
+
+// Writes the exact-area coverage of `contours` (each implicitly closed; where
+// they overlap, opposite windings cancel, as in font outlines) to an 8-bit
+// mask of `size` pixels with rows `stride` bytes apart, replacing its
+// contents. Contours may extend past the mask. Returns false on an invalid
+// mask or allocation failure.
+bool RasterizeCoverage(const std::vector<std::vector<PointF>>& contours, const SizePX& size,
+                       uint8_t* mask, int32_t stride);
+
+// Pixels the shape can touch, including anti-aliasing; empty if it draws
+// nothing. Arrow heads are max(8, 4w) long and max(5, 2w) wide per side.
+RectPX ShapeBounds(const VectorShape& shape);
+
+} // namespace snappin
@@ -0,0 +1,199 @@
+#include "RedactionCache.h"
+
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+int32_t NormalizeStrength(RedactionKind kind, int32_t strength) {
+  return kind == RedactionKind::Blur ? std::clamp(strength, 1, kMaxBoxBlurRadius)
+                                     : std::clamp(strength, 1, kMaxPixelateCellPx);
+}
+
+RectPX Intersect(const RectPX& a, const RectPX& b) {
+  const int32_t x0 = std::max(a.x, b.x);
+  const int32_t y0 = std::max(a.y, b.y);
+  const int32_t x1 = std::min(a.x + a.w, b.x + b.w);
+  const int32_t y1 = std::min(a.y + a.h, b.y + b.h);
+  if (x1 <= x0 || y1 <= y0) {
+    return RectPX{};
+  }
+  return RectPX{x0, y0, x1 - x0, y1 - y0};
+}
+
+int32_t FloorTo(int32_t v, int32_t step) { return v / step * step; }
+
+} // namespace
+
+RedactionCache::RedactionCache(size_t budget_bytes) : budget_bytes_(budget_bytes) {}
+
+void RedactionCache::Reset(BitmapView source) {
+  layers_.clear();
+  bytes_ = 0;
+  source_ = std::move(source);
+  cols_ = 0;
+  rows_ = 0;
+  if (source_.valid()) {
+    cols_ = (source_.size_px().w + kTilePx - 1) / kTilePx;
+    rows_ = (source_.size_px().h + kTilePx - 1) / kTilePx;
+  }
+}
+
+void RedactionCache::SetBudget(size_t budget_bytes) {
+  budget_bytes_ = budget_bytes;
+  Trim(nullptr);
+}
+
+RedactionCache::Layer* RedactionCache::LayerFor(RedactionKind kind, int32_t strength) {
+  for (const auto& layer : layers_) {
+    if (layer->kind == kind && layer->strength == strength) {
+      return layer.get();
+    }
+  }
+  auto layer = std::make_unique<Layer>();
+  layer->kind = kind;
+  layer->strength = strength;
+  layer->tiles.resize(static_cast<size_t>(cols_) * static_cast<size_t>(rows_));
+  layers_.push_back(std::move(layer));
+  return layers_.back().get();
+}
+
+bool RedactionCache::BuildTile(const Layer& layer, const RectPX& tile,
+                               std::vector<uint8_t>* out) const {
+  const RectPX bounds{0, 0, source_.size_px().w, source_.size_px().h};
+  RectPX region;
+  if (layer.kind == RedactionKind::Blur) {
+    // Each pass is exact one radius further in than its input, so three
+    // passes need a three-radius halo around the tile.
+    const int32_t halo = 3 * layer.strength;
+    region = Intersect(RectPX{tile.x - halo, tile.y - halo, tile.w + 2 * halo,
+                              tile.h + 2 * halo},
+                       bounds);
+  } else {
+    // Whole cells, so the grid stays anchored at the source origin.
+    const int32_t cell = layer.strength;
+    const int32_t x0 = FloorTo(tile.x, cell);
+    const int32_t y0 = FloorTo(tile.y, cell);
+    const int32_t x1 = FloorTo(tile.x + tile.w + cell - 1, cell);
+    const int32_t y1 = FloorTo(tile.y + tile.h + cell - 1, cell);
+    region = Intersect(RectPX{x0, y0, x1 - x0, y1 - y0}, bounds);
+  }
+
+  std::vector<uint8_t> work(static_cast<size_t>(region.w) * static_cast<size_t>(region.h) * 4);
+  CpuBitmap dst;
+  dst.format = source_.format();
+  dst.size_px = {region.w, region.h};
+  dst.stride_bytes = region.w * 4;
+  dst.data.p = work.data();
+  const CpuBitmap src = source_.Crop(region).AsCpuBitmap();
+  const bool ok = layer.kind == RedactionKind::Blur
+                      ? BoxBlurBitmap(src, &dst, layer.strength, 3)
+                      : PixelateBitmap(src, &dst, layer.strength);
+  if (!ok) {
+    return false;
+  }
+
+  out->resize(static_cast<size_t>(tile.w) * static_cast<size_t>(tile.h) * 4);
+  for (int32_t y = 0; y < tile.h; ++y) {
+    std::memcpy(out->data() + static_cast<size_t>(y) * tile.w * 4,
+                work.data() + (static_cast<size_t>(tile.y - region.y + y) * region.w +
+                               static_cast<size_t>(tile.x - region.x)) *
+                                  4,
+                static_cast<size_t>(tile.w) * 4);
+  }
+  return true;
+}
+
+const std::vector<uint8_t>* RedactionCache::Tile(Layer* layer, int32_t col, int32_t row) {
+  std::vector<uint8_t>& tile =
+      layer->tiles[static_cast<size_t>(row) * static_cast<size_t>(cols_) +
+                   static_cast<size_t>(col)];
+  if (!tile.empty()) {
+    ++stats_.tile_hits;
+    return &tile;
+  }
+  const int32_t x = col * kTilePx;
+  const int32_t y = row * kTilePx;
+  const RectPX rect{x, y, std::min(kTilePx, source_.size_px().w - x),
+                    std::min(kTilePx, source_.size_px().h - y)};
+  if (!BuildTile(*layer, rect, &tile)) {
+    tile.clear();
+    return nullptr;
+  }
+  ++stats_.tile_misses;
+  bytes_ += tile.size();
+  Trim(layer);
+  return &tile;
+}
+
+void RedactionCache::Trim(const Layer* keep) {
+  while (bytes_ > budget_bytes_) {
+    auto victim = layers_.end();
+    for (auto it = layers_.begin(); it != layers_.end(); ++it) {
+      if (it->get() != keep &&
+          (victim == layers_.end() || (*it)->last_use < (*victim)->last_use)) {
+        victim = it;
+      }
+    }
+    if (victim == layers_.end()) {
+      return;
+    }
+    for (const auto& tile : (*victim)->tiles) {
+      bytes_ -= tile.size();
+    }
+    layers_.erase(victim);
+    ++stats_.evicted_layers;
+  }
+}
+
+bool RedactionCache::Render(RedactionKind kind, int32_t strength, const RectPX& rect,
+                            const CpuBitmap& target) {
+  if (!source_.valid() || !target.data.p || target.format != source_.format() ||
+      target.size_px.w != source_.size_px().w || target.size_px.h != source_.size_px().h ||
+      target.stride_bytes < target.size_px.w * 4) {
+    return false;
+  }
+  const RectPX area =
+      Intersect(rect, RectPX{0, 0, source_.size_px().w, source_.size_px().h});
+  if (area.w <= 0 || area.h <= 0) {
+    return true;
+  }
+  Layer* layer = LayerFor(kind, NormalizeStrength(kind, strength));
+  layer->last_use = ++clock_;
+
+  uint8_t* base = static_cast<uint8_t*>(target.data.p);
+  for (int32_t row = area.y / kTilePx; row <= (area.y + area.h - 1) / kTilePx; ++row) {
+    for (int32_t col = area.x / kTilePx; col <= (area.x + area.w - 1) / kTilePx; ++col) {
+      const std::vector<uint8_t>* tile = Tile(layer, col, row);
+      if (!tile) {
+        return false;
+      }
+      const int32_t tx = col * kTilePx;
+      const int32_t ty = row * kTilePx;
+      const int32_t tile_w = std::min(kTilePx, source_.size_px().w - tx);
+      const RectPX part = Intersect(area, RectPX{tx, ty, tile_w, kTilePx});
+      for (int32_t y = part.y; y < part.y + part.h; ++y) {
+        std::memcpy(base + static_cast<size_t>(y) * target.stride_bytes +
+                        static_cast<size_t>(part.x) * 4,
+                    tile->data() + (static_cast<size_t>(y - ty) * tile_w +
+                                    static_cast<size_t>(part.x - tx)) *
+                                       4,
+                    static_cast<size_t>(part.w) * 4);
+      }
+    }
+  }
+  return true;
+}
+
+RedactionCacheStats RedactionCache::Stats() const {
+  RedactionCacheStats stats = stats_;
+  stats.bytes = bytes_;
+  stats.layers = layers_.size();
+  return stats;
+}
+
+} // namespace snappin
@@ -0,0 +1,74 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace snappin {
+
+enum class RedactionKind : uint8_t {
+  Mosaic, // strength = cell size in pixels, grid anchored at the source origin
+  Blur,   // strength = box radius; three passes approximate a Gaussian
+};
+
+struct RedactionCacheStats {
+  uint64_t tile_hits = 0;
+  uint64_t tile_misses = 0; // tiles computed
+  uint64_t evicted_layers = 0;
+  size_t bytes = 0;
+  size_t layers = 0;
+};
+
+// Redacted copies of one source image, one layer per (kind, strength), built
+// lazily in kTilePx tiles. A redaction box only pays for the tiles it covers
+// the first time; moving or resizing it, or adding more boxes of the same
+// strength, copies cached pixels. Tiles equal the same region of the whole
+// image processed at once (blur tiles are computed with a 3 * radius halo,
+// mosaic tiles are widened to whole cells). Least recently used layers are
+// dropped past the byte budget; the layer being drawn is kept. Not
+// thread-safe.
+class RedactionCache {
+public:
+  static constexpr int32_t kTilePx = 256;
+
+  explicit RedactionCache(size_t budget_bytes = size_t{96} << 20);
+
+  // Starts over with a new source (BGRA8 or RGBA8); drops every layer.
+  void Reset(BitmapView source);
+  void SetBudget(size_t budget_bytes);
+
+  // Writes the redacted pixels of rect (clipped to the source and target) to
+  // the same coordinates of target, which must match the source's size and
+  // format. False when there is no source or the target does not match.
+  bool Render(RedactionKind kind, int32_t strength, const RectPX& rect,
+              const CpuBitmap& target);
+
+  RedactionCacheStats Stats() const;
+
+private:
+  struct Layer {
+    RedactionKind kind = RedactionKind::Mosaic;
+    int32_t strength = 0;
+    uint64_t last_use = 0;
+    // Row-major tiles, tightly packed; empty until first needed.
+    std::vector<std::vector<uint8_t>> tiles;
+  };
+
+  Layer* LayerFor(RedactionKind kind, int32_t strength);
+  const std::vector<uint8_t>* Tile(Layer* layer, int32_t col, int32_t row);
+  bool BuildTile(const Layer& layer, const RectPX& tile, std::vector<uint8_t>* out) const;
+  void Trim(const Layer* keep);
+
+  BitmapView source_;
+  int32_t cols_ = 0;
+  int32_t rows_ = 0;
+  std::vector<std::unique_ptr<Layer>> layers_;
+  size_t budget_bytes_ = 0;
+  size_t bytes_ = 0;
+  uint64_t clock_ = 0;
+  RedactionCacheStats stats_;
+};
+
+} // namespace snappin
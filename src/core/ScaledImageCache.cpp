@@ -0,0 +1,180 @@
+#include "ScaledImageCache.h"
+
+#include "PixelBufferPool.h"
+#include "PixelKernels.h"
+
+#include <memory>
+
+namespace snappin {
+namespace {
+
+size_t ViewBytes(const BitmapView& view) {
+  return view.valid() ? static_cast<size_t>(view.stride_bytes()) *
+                            static_cast<size_t>(view.size_px().h)
+                      : 0;
+}
+
+bool SameSize(const SizePX& a, const SizePX& b) { return a.w == b.w && a.h == b.h; }
+
+bool SameSource(const BitmapView& cached, const BitmapView& source) {
+  return cached.valid() && cached.data() == source.data() &&
+         cached.SharesBufferWith(source) && SameSize(cached.size_px(), source.size_px()) &&
+         cached.stride_bytes() == source.stride_bytes() && cached.format() == source.format();
+}
+
+SizePX HalfSize(const SizePX& size) { return SizePX{(size.w + 1) / 2, (size.h + 1) / 2}; }
+
+// A pooled, tightly packed bitmap of `size`; `out` gets a writable view of it.
+BitmapView AllocateBitmap(const SizePX& size, PixelFormat format, CpuBitmap* out) {
+  std::shared_ptr<uint8_t> pixels;
+  int32_t stride = 0;
+  if (!AcquirePixelBuffer(PixelBufferPool::Shared(), size, &pixels, &stride)) {
+    return BitmapView{};
+  }
+  out->format = format;
+  out->size_px = size;
+  out->stride_bytes = stride;
+  out->data.p = pixels.get();
+  return BitmapView(std::move(pixels), size, stride, format);
+}
+
+} // namespace
+
+ScaledImageCache::ScaledImageCache(size_t budget_bytes) : budget_bytes_(budget_bytes) {}
+
+void ScaledImageCache::SetBudget(size_t budget_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_bytes_ = budget_bytes;
+  Trim(nullptr);
+}
+
+BitmapView ScaledImageCache::Scaled(uint64_t key, const BitmapView& source,
+                                    const SizePX& size) {
+  if (!source.valid() || size.w <= 0 || size.h <= 0) {
+    return BitmapView{};
+  }
+  if (SameSize(size, source.size_px())) {
+    return source;
+  }
+  const size_t out_bytes = static_cast<size_t>(size.w) * static_cast<size_t>(size.h) * 4;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (out_bytes > budget_bytes_ / 2) {
+    return BitmapView{};
+  }
+  Entry& entry = entries_[key];
+  if (!SameSource(entry.source, source)) {
+    bytes_ -= EntryBytes(entry);
+    entry = Entry{};
+    entry.source = source;
+  }
+  entry.last_use = ++clock_;
+  if (entry.scaled.valid() && SameSize(entry.scaled.size_px(), size)) {
+    ++stats_.hits;
+    return entry.scaled;
+  }
+
+  // Smallest mip level that still covers the target in both axes.
+  BitmapView base = source;
+  for (size_t i = 0;; ++i) {
+    const SizePX next = HalfSize(base.size_px());
+    if (next.w < size.w || next.h < size.h || SameSize(next, base.size_px())) {
+      break;
+    }
+    const BitmapView* level = Level(&entry, i);
+    if (!level) {
+      break;
+    }
+    base = *level;
+  }
+
+  CpuBitmap target;
+  BitmapView scaled = AllocateBitmap(size, source.format(), &target);
+  if (!scaled.valid() || !ResizeLanczos(base.AsCpuBitmap(), &target)) {
+    return BitmapView{};
+  }
+  ++stats_.misses;
+  bytes_ -= ViewBytes(entry.scaled);
+  entry.scaled = scaled;
+  bytes_ += ViewBytes(scaled);
+  Trim(&entry);
+  return scaled;
+}
+
+void ScaledImageCache::Remove(uint64_t key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return;
+  }
+  bytes_ -= EntryBytes(it->second);
+  entries_.erase(it);
+}
+
+void ScaledImageCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  bytes_ = 0;
+}
+
+ScaledImageCacheStats ScaledImageCache::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ScaledImageCacheStats stats = stats_;
+  stats.bytes = bytes_;
+  stats.entries = entries_.size();
+  return stats;
+}
+
+ScaledImageCache& ScaledImageCache::Shared() {
+  static ScaledImageCache cache;
+  return cache;
+}
+
+const BitmapView* ScaledImageCache::Level(Entry* entry, size_t index) {
+  while (entry->levels.size() <= index) {
+    const BitmapView& parent = entry->levels.empty() ? entry->source : entry->levels.back();
+    CpuBitmap target;
+    BitmapView level = AllocateBitmap(HalfSize(parent.size_px()), parent.format(), &target);
+    if (!level.valid() || !DownsampleHalf(parent.AsCpuBitmap(), &target)) {
+      return nullptr;
+    }
+    ++stats_.levels_built;
+    bytes_ += ViewBytes(level);
+    entry->levels.push_back(std::move(level));
+  }
+  return &entry->levels[index];
+}
+
+size_t ScaledImageCache::EntryBytes(const Entry& entry) {
+  size_t bytes = ViewBytes(entry.scaled);
+  for (const BitmapView& level : entry.levels) {
+    bytes += ViewBytes(level);
+  }
+  return bytes;
+}
+
+void ScaledImageCache::Trim(Entry* keep) {
+  while (bytes_ > budget_bytes_) {
+    auto victim = entries_.end();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (&it->second != keep &&
+          (victim == entries_.end() || it->second.last_use < victim->second.last_use)) {
+        victim = it;
+      }
+    }
+    if (victim == entries_.end()) {
+      break;
+    }
+    bytes_ -= EntryBytes(victim->second);
+    entries_.erase(victim);
+    ++stats_.evictions;
+  }
+  if (keep && bytes_ > budget_bytes_ && !keep->levels.empty()) {
+    for (const BitmapView& level : keep->levels) {
+      bytes_ -= ViewBytes(level);
+    }
+    keep->levels.clear();
+    ++stats_.evictions;
+  }
+}
+
+} // namespace snappin
@@ -0,0 +1,73 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace snappin {
+
+struct ScaledImageCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0; // scaled images built
+  uint64_t levels_built = 0;
+  uint64_t evictions = 0; // entries or mip chains dropped for the budget
+  size_t bytes = 0;
+  size_t entries = 0;
+};
+
+// Zoomed copies of pin images. Each key (a pin) gets a mip chain of 2x2 box
+// downsamples, built lazily one level at a time, and the last size it was
+// asked for. A new size is Lanczos-resampled from the smallest level that is
+// still at least that large, so the filter never reads more than 2x the
+// output and repaints at an unchanged zoom copy nothing. Everything is
+// allocated from PixelBufferPool::Shared(). Past the byte budget whole entries
+// are dropped least recently used first; the entry being drawn only loses its
+// mip chain. Thread-safe.
+class ScaledImageCache {
+public:
+  explicit ScaledImageCache(size_t budget_bytes = size_t{64} << 20);
+  ScaledImageCache(const ScaledImageCache&) = delete;
+  ScaledImageCache& operator=(const ScaledImageCache&) = delete;
+
+  void SetBudget(size_t budget_bytes);
+
+  // `source` (BGRA8 or RGBA8) resampled to `size`. Returns `source` itself at
+  // its own size, and an empty view when the source or size is invalid or
+  // the result alone would take more than half the budget; callers then
+  // scale on their own. A source with a different buffer or size than last
+  // time for the same key starts the entry over.
+  BitmapView Scaled(uint64_t key, const BitmapView& source, const SizePX& size);
+  void Remove(uint64_t key);
+  void Clear();
+
+  ScaledImageCacheStats Stats() const;
+
+  // Process-wide cache used by pin windows.
+  static ScaledImageCache& Shared();
+
+private:
+  struct Entry {
+    BitmapView source;
+    // levels[i] is the source downsampled i + 1 times.
+    std::vector<BitmapView> levels;
+    BitmapView scaled;
+    uint64_t last_use = 0;
+  };
+
+  const BitmapView* Level(Entry* entry, size_t index);
+  static size_t EntryBytes(const Entry& entry);
+  // Evicts down to the budget; `keep` (may be null) only loses its levels.
+  void Trim(Entry* keep);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, Entry> entries_;
+  size_t budget_bytes_ = 0;
+  size_t bytes_ = 0;
+  uint64_t clock_ = 0;
+  ScaledImageCacheStats stats_;
+};
+
+} // namespace snappin
@@ -1,24 +1,94 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 namespace snappin {
 
+// Distribution of one latency metric. Percentiles are the upper edge of the
+// histogram bucket holding that rank (within ~3%, exact below 64 us), never
+// above `max_ms`.
+struct LatencySummary {
+  uint64_t count = 0;
+  double mean_ms = 0;
+  double p50_ms = 0;
+  double p95_ms = 0;
+  double p99_ms = 0;
+  double max_ms = 0;
+};
+
+struct ActionLatency {
+  std::string action_id;
+  LatencySummary latency;
+};
+
 struct StatsSnapshot {
   double overlay_show_ms_p95 = 0;
   double capture_once_ms_p95 = 0;
   double ocr_ms_last = 0;
 
+  LatencySummary overlay_show;
+  LatencySummary capture_once;
+  // Synchronous ActionDispatcher::Invoke time per action, sorted by id.
+  std::vector<ActionLatency> actions;
+
   uint64_t dropped_frames_total = 0;
   double encode_ms_per_frame_avg = 0;
 
   uint64_t working_set_bytes = 0;
+
+  uint64_t pixel_pool_hits = 0;
+  uint64_t pixel_pool_misses = 0;
+  uint64_t pixel_pool_idle_bytes = 0;
+
+  // Pixel bytes held by the artifact store (shared with pins/export views).
+  uint64_t artifact_count = 0;
+  uint64_t artifact_resident_bytes = 0;
+  uint64_t artifact_budget_bytes = 0;
+  uint64_t artifact_evictions = 0;
+
+  // Glyph atlas and memoized layouts shared by annotation text and text pins.
+  uint64_t glyph_cache_hits = 0;
+  uint64_t glyph_cache_misses = 0;
+  uint64_t glyph_cache_bytes = 0;
+  uint64_t text_layout_hits = 0;
+  uint64_t text_layout_misses = 0;
+
+  // Mip levels and zoomed copies of pinned images.
+  uint64_t pin_scale_cache_hits = 0;
+  uint64_t pin_scale_cache_misses = 0;
+  uint64_t pin_scale_cache_bytes = 0;
+
+  // Image pin pixels: full-resolution bytes held as is, PixelCodec bytes of
+  // idle pins (and what they decompress to), display-size copies of those.
+  uint64_t pins_compressed = 0;
+  uint64_t pin_pixels_uncompressed_bytes = 0;
+  uint64_t pin_pixels_compressed_bytes = 0;
+  uint64_t pin_pixels_compressed_source_bytes = 0;
+  uint64_t pin_pixels_display_bytes = 0;
+
+  // Captures and pins whose pixels matched an existing buffer and share it
+  // (bytes not kept twice), and hash matches that turned out to differ.
+  uint64_t pixel_dedup_hits = 0;
+  uint64_t pixel_dedup_shared_bytes = 0;
+  uint64_t pixel_dedup_collisions = 0;
+
+  // Capture history: captures indexed, segment bytes on disk, resident
+  // thumbnail bytes, and captures waiting for the background writer.
+  uint64_t history_entries = 0;
+  uint64_t history_disk_bytes = 0;
+  uint64_t history_thumbnail_bytes = 0;
+  uint64_t history_pending = 0;
 };
 
 class IStatsService {
 public:
   virtual ~IStatsService() = default;
   virtual StatsSnapshot Snapshot() = 0;
+  // Like Snapshot(), but latency histograms restart empty, so each sample is
+  // reported by exactly one scrape.
+  virtual StatsSnapshot SnapshotAndReset() = 0;
 };
 
 } // namespace snappin
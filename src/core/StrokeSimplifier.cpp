@@ -0,0 +1,99 @@
+#include "StrokeSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace snappin {
+namespace {
+
+float DistanceToSegmentSq(const PointF& p, const PointF& a, const PointF& b) {
+  const float vx = b.x - a.x;
+  const float vy = b.y - a.y;
+  const float wx = p.x - a.x;
+  const float wy = p.y - a.y;
+  const float len_sq = vx * vx + vy * vy;
+  float t = 0.0f;
+  if (len_sq > 0.0f) {
+    t = std::clamp((wx * vx + wy * vy) / len_sq, 0.0f, 1.0f);
+  }
+  const float dx = wx - t * vx;
+  const float dy = wy - t * vy;
+  return dx * dx + dy * dy;
+}
+
+StrokeSimplifierOptions Sanitize(StrokeSimplifierOptions options) {
+  if (!std::isfinite(options.tolerance_px) || options.tolerance_px < 0.0f) {
+    options.tolerance_px = 0.0f;
+  }
+  if (!std::isfinite(options.smoothing_weight)) {
+    options.smoothing_weight = 1.0f;
+  }
+  options.smoothing_weight = std::clamp(options.smoothing_weight, 0.05f, 1.0f);
+  options.max_run = std::max<int32_t>(options.max_run, 2);
+  return options;
+}
+
+} // namespace
+
+StrokeSimplifier::StrokeSimplifier(const StrokeSimplifierOptions& options)
+    : options_(Sanitize(options)) {}
+
+void StrokeSimplifier::Reset() {
+  points_.clear();
+  run_.clear();
+  committed_ = 0;
+  samples_ = 0;
+}
+
+void StrokeSimplifier::Reset(const StrokeSimplifierOptions& options) {
+  options_ = Sanitize(options);
+  Reset();
+}
+
+bool StrokeSimplifier::RunFits(const PointF& end) const {
+  const PointF& anchor = points_[committed_ - 1];
+  const float tol_sq = options_.tolerance_px * options_.tolerance_px;
+  for (const PointF& p : run_) {
+    if (DistanceToSegmentSq(p, anchor, end) > tol_sq) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void StrokeSimplifier::Add(PointF sample) {
+  if (!std::isfinite(sample.x) || !std::isfinite(sample.y)) {
+    return;
+  }
+  ++samples_;
+  if (points_.empty()) {
+    smoothed_ = sample;
+    points_.push_back(sample);
+    committed_ = 1;
+    return;
+  }
+  if (options_.smoothing) {
+    const float w = options_.smoothing_weight;
+    smoothed_.x += (sample.x - smoothed_.x) * w;
+    smoothed_.y += (sample.y - smoothed_.y) * w;
+    sample = smoothed_;
+  }
+  const PointF& last = run_.empty() ? points_[committed_ - 1] : run_.back();
+  if (sample.x == last.x && sample.y == last.y) {
+    return;
+  }
+
+  // The run excludes its own end; test the samples before `sample` against
+  // the segment from the anchor to it.
+  const bool fits = static_cast<int32_t>(run_.size()) < options_.max_run && RunFits(sample);
+  if (!fits) {
+    // The previous end satisfied every sample before it; keep it.
+    committed_ = points_.size();
+    run_.clear();
+  }
+  run_.push_back(sample);
+  points_.resize(committed_);
+  points_.push_back(sample);
+}
+
+} // namespace snappin
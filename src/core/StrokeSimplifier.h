@@ -0,0 +1,61 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snappin {
+
+struct StrokeSimplifierOptions {
+  // Largest distance, in device pixels, between a dropped sample and the kept
+  // polyline. 0 drops only repeats and samples exactly on the kept line. The
+  // default covers the +-0.5 px quantization of integer mouse input on both
+  // axes.
+  float tolerance_px = 1.0f;
+  // Exponential smoothing of incoming samples before simplification, to take
+  // out hand jitter and integer quantization. The weight is that of the new
+  // sample; 1 disables smoothing.
+  bool smoothing = false;
+  float smoothing_weight = 0.5f;
+  // A kept segment spans at most this many samples, which bounds the work per
+  // sample.
+  int32_t max_run = 64;
+};
+
+// Streaming polyline simplifier for freehand strokes. Each sample either
+// extends the current segment (when every sample since the last kept vertex
+// stays within tolerance of the segment to it) or commits the previous end
+// as a vertex. The newest sample is always the provisional last point, so a
+// live preview tracks the pointer exactly. Work per sample is O(max_run).
+class StrokeSimplifier {
+public:
+  explicit StrokeSimplifier(const StrokeSimplifierOptions& options = StrokeSimplifierOptions{});
+
+  // Starts a new stroke, optionally with new options.
+  void Reset();
+  void Reset(const StrokeSimplifierOptions& options);
+
+  void Add(PointF sample);
+
+  // Kept vertices followed by the newest sample. points()[0, committed())
+  // never change until Reset(); later entries may be replaced by Add().
+  const std::vector<PointF>& points() const { return points_; }
+  size_t committed() const { return committed_; }
+  // Samples passed to Add() since Reset(), including dropped ones.
+  size_t samples() const { return samples_; }
+  const StrokeSimplifierOptions& options() const { return options_; }
+
+private:
+  bool RunFits(const PointF& end) const;
+
+  StrokeSimplifierOptions options_;
+  std::vector<PointF> points_;
+  size_t committed_ = 0;
+  // Samples after the last committed vertex, the newest last.
+  std::vector<PointF> run_;
+  PointF smoothed_{};
+  size_t samples_ = 0;
+};
+
+} // namespace snappin
@@ -0,0 +1,304 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+// The scheduler and worker index of the current thread, so tasks submitted
+// from a worker stay on its deque.
+thread_local const TaskScheduler* t_scheduler = nullptr;
+thread_local size_t t_worker = 0;
+
+} // namespace
+
+CancellationToken CancellationToken::Create() {
+  CancellationToken token;
+  token.flag_ = std::make_shared<std::atomic<bool>>(false);
+  return token;
+}
+
+void CancellationToken::Cancel() const {
+  if (flag_) {
+    flag_->store(true, std::memory_order_release);
+  }
+}
+
+TaskScheduler::TaskScheduler(int32_t workers) {
+  if (workers <= 0) {
+    workers = static_cast<int32_t>(std::thread::hardware_concurrency()) - 1;
+  }
+  workers = std::max(workers, 1);
+  for (int32_t i = 0; i < workers; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->thread = std::thread([this, i] { WorkerLoop(i); });
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mu_);
+    stopping_ = true;
+  }
+  sleep_cv_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+TaskScheduler& TaskScheduler::Shared() {
+  static TaskScheduler scheduler;
+  return scheduler;
+}
+
+void TaskScheduler::Submit(Task task, TaskPriority priority, CancellationToken token) {
+  if (!task) {
+    return;
+  }
+  Push(Item{std::move(task), std::move(token)}, priority);
+}
+
+void TaskScheduler::SubmitThen(Task task, std::function<void(bool completed)> then,
+                               TaskPriority priority, CancellationToken token) {
+  // The token is checked here rather than by Run, so a cancelled task still
+  // gets its continuation.
+  Push(Item{[this, task = std::move(task), then = std::move(then),
+             token = std::move(token)]() mutable {
+              bool completed = false;
+              if (token.cancelled()) {
+                cancelled_.fetch_add(1, std::memory_order_relaxed);
+              } else {
+                try {
+                  task();
+                  completed = true;
+                } catch (...) {
+                  failed_.fetch_add(1, std::memory_order_relaxed);
+                }
+              }
+              task = nullptr;
+              if (then) {
+                PostUi([then = std::move(then), completed] { then(completed); });
+              }
+            },
+            CancellationToken{}},
+       priority);
+}
+
+bool TaskScheduler::ParallelFor(int32_t count, int32_t max_threads,
+                                const std::function<void(int32_t)>& fn, TaskPriority priority,
+                                const CancellationToken& token) {
+  if (count <= 0) {
+    return !token.cancelled();
+  }
+  parallel_fors_.fetch_add(1, std::memory_order_relaxed);
+  // Helpers that start after the caller is done must not touch fn, which
+  // lives on the caller's stack: they check `closed` on the way in.
+  struct State {
+    std::atomic<int32_t> next{0};
+    std::atomic<bool> failed{false};
+    int32_t count = 0;
+    const std::function<void(int32_t)>* fn = nullptr;
+    CancellationToken token;
+    std::mutex mu;
+    std::condition_variable cv;
+    int32_t running = 0;
+    bool closed = false;
+  };
+  auto state = std::make_shared<State>();
+  state->count = count;
+  state->fn = &fn;
+  state->token = token;
+  auto work = [](State& s) {
+    for (;;) {
+      if (s.failed.load(std::memory_order_relaxed) || s.token.cancelled()) {
+        return;
+      }
+      const int32_t i = s.next.fetch_add(1);
+      if (i >= s.count) {
+        return;
+      }
+      try {
+        (*s.fn)(i);
+      } catch (...) {
+        s.failed.store(true);
+      }
+    }
+  };
+
+  int32_t threads = max_threads <= 0 ? worker_count() + 1 : max_threads;
+  threads = std::min({threads, count, worker_count() + 1});
+  for (int32_t h = 1; h < threads; ++h) {
+    Push(Item{[state, work] {
+                {
+                  std::lock_guard<std::mutex> lock(state->mu);
+                  if (state->closed) {
+                    return;
+                  }
+                  ++state->running;
+                }
+                work(*state);
+                std::lock_guard<std::mutex> lock(state->mu);
+                if (--state->running == 0) {
+                  state->cv.notify_all();
+                }
+              },
+              CancellationToken{}},
+         priority);
+  }
+  work(*state);
+  // Every index is taken; only helpers still inside their last call remain.
+  std::unique_lock<std::mutex> lock(state->mu);
+  state->closed = true;
+  state->cv.wait(lock, [&] { return state->running == 0; });
+  return !state->failed.load() && !token.cancelled();
+}
+
+void TaskScheduler::SetUiWakeup(std::function<void()> wake) {
+  std::lock_guard<std::mutex> lock(ui_mu_);
+  ui_wake_ = std::move(wake);
+}
+
+size_t TaskScheduler::RunUiContinuations() {
+  std::vector<std::function<void()>> batch;
+  {
+    std::lock_guard<std::mutex> lock(ui_mu_);
+    batch.swap(ui_queue_);
+  }
+  for (auto& fn : batch) {
+    fn();
+  }
+  return batch.size();
+}
+
+void TaskScheduler::WaitIdle() {
+  std::unique_lock<std::mutex> lock(sleep_mu_);
+  idle_cv_.wait(lock, [this] { return queued_.load() == 0 && running_.load() == 0; });
+}
+
+TaskSchedulerStats TaskScheduler::Stats() const {
+  TaskSchedulerStats stats;
+  stats.workers = workers_.size();
+  stats.queued = queued_.load();
+  stats.submitted = submitted_.load(std::memory_order_relaxed);
+  stats.executed = executed_.load(std::memory_order_relaxed);
+  stats.stolen = stolen_.load(std::memory_order_relaxed);
+  stats.cancelled = cancelled_.load(std::memory_order_relaxed);
+  stats.failed = failed_.load(std::memory_order_relaxed);
+  stats.parallel_fors = parallel_fors_.load(std::memory_order_relaxed);
+  stats.continuations = continuations_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void TaskScheduler::WorkerLoop(size_t index) {
+  t_scheduler = this;
+  t_worker = index;
+  for (;;) {
+    Item item;
+    if (TakeTask(index, &item)) {
+      Run(item);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mu_);
+    sleepers_.fetch_add(1);
+    sleep_cv_.wait(lock, [this] { return queued_.load() > 0 || stopping_; });
+    sleepers_.fetch_sub(1);
+    // Stopping only once everything queued has run.
+    if (stopping_ && queued_.load() == 0) {
+      return;
+    }
+  }
+}
+
+bool TaskScheduler::TakeTask(size_t index, Item* out) {
+  if (queued_.load() == 0) {
+    return false;
+  }
+  const size_t n = workers_.size();
+  for (size_t p = 0; p < 2; ++p) {
+    {
+      Worker& own = *workers_[index];
+      std::lock_guard<std::mutex> lock(own.mu);
+      if (!own.queues[p].empty()) {
+        *out = std::move(own.queues[p].back());
+        own.queues[p].pop_back();
+        running_.fetch_add(1);
+        queued_.fetch_sub(1);
+        return true;
+      }
+    }
+    for (size_t k = 1; k < n; ++k) {
+      Worker& victim = *workers_[(index + k) % n];
+      std::lock_guard<std::mutex> lock(victim.mu);
+      if (!victim.queues[p].empty()) {
+        *out = std::move(victim.queues[p].front());
+        victim.queues[p].pop_front();
+        running_.fetch_add(1);
+        queued_.fetch_sub(1);
+        stolen_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void TaskScheduler::Push(Item item, TaskPriority priority) {
+  const size_t target = t_scheduler == this
+                            ? t_worker
+                            : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                                  workers_.size();
+  {
+    Worker& worker = *workers_[target];
+    std::lock_guard<std::mutex> lock(worker.mu);
+    // Counted before it is visible, so queued_ never undercounts.
+    queued_.fetch_add(1);
+    worker.queues[static_cast<size_t>(priority)].push_back(std::move(item));
+  }
+  submitted_.fetch_add(1, std::memory_order_relaxed);
+  if (sleepers_.load() > 0) {
+    // Taking the lock orders this wakeup after a sleeper's predicate check.
+    { std::lock_guard<std::mutex> lock(sleep_mu_); }
+    sleep_cv_.notify_one();
+  }
+}
+
+void TaskScheduler::Run(Item& item) {
+  if (item.token.cancelled()) {
+    cancelled_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    try {
+      item.task();
+      executed_.fetch_add(1, std::memory_order_relaxed);
+    } catch (...) {
+      failed_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  // Captures are released before anyone waiting for idle wakes up.
+  item.task = nullptr;
+  if (running_.fetch_sub(1) == 1 && queued_.load() == 0) {
+    { std::lock_guard<std::mutex> lock(sleep_mu_); }
+    idle_cv_.notify_all();
+  }
+}
+
+void TaskScheduler::PostUi(std::function<void()> fn) {
+  std::function<void()> wake;
+  {
+    std::lock_guard<std::mutex> lock(ui_mu_);
+    if (ui_queue_.empty()) {
+      wake = ui_wake_;
+    }
+    ui_queue_.push_back(std::move(fn));
+  }
+  continuations_.fetch_add(1, std::memory_order_relaxed);
+  if (wake) {
+    wake();
+  }
+}
+
+} // namespace snappin
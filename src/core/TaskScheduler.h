@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace snappin {
+
+enum class TaskPriority : uint8_t {
+  Interactive = 0, // someone is waiting on it: save strips, paint
+  Background = 1,  // housekeeping that can wait, and long blocking calls (OCR)
+};
+
+// Shared cancellation flag: copies see the same flag and any of them may set
+// it. A default-constructed token is never cancelled.
+class CancellationToken {
+public:
+  CancellationToken() = default;
+  static CancellationToken Create();
+
+  void Cancel() const;
+  bool cancelled() const { return flag_ && flag_->load(std::memory_order_acquire); }
+
+private:
+  std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+struct TaskSchedulerStats {
+  size_t workers = 0;
+  size_t queued = 0;
+  uint64_t submitted = 0;
+  uint64_t executed = 0;
+  uint64_t stolen = 0;    // run by a worker other than the one it was queued on
+  uint64_t cancelled = 0; // dropped because their token was cancelled first
+  uint64_t failed = 0;    // threw
+  uint64_t parallel_fors = 0;
+  uint64_t continuations = 0;
+};
+
+// Work-stealing thread pool. Each worker owns a deque per priority; tasks
+// submitted from a worker go to the back of its own deque and are taken
+// from the back (newest first, while the data is still in cache), tasks from
+// other threads are dealt round-robin across the workers. An idle worker
+// takes interactive work before background work: its own first, then the
+// oldest task at the front of another worker's deque. There is no ordering
+// between tasks.
+//
+// Continuations (SubmitThen) are queued for the UI thread, which runs them
+// in RunUiContinuations(); the wakeup callback is told whenever that queue
+// stops being empty (AppMain posts itself a message). Destruction runs every
+// queued task and then joins. Thread-safe.
+class TaskScheduler {
+public:
+  using Task = std::function<void()>;
+
+  // 0 workers means one per hardware thread but one, since ParallelFor
+  // callers work too; at least one.
+  explicit TaskScheduler(int32_t workers = 0);
+  ~TaskScheduler();
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  int32_t worker_count() const { return static_cast<int32_t>(workers_.size()); }
+
+  // Tasks whose token is cancelled before they start are dropped. A task
+  // that throws is counted as failed and the worker carries on.
+  void Submit(Task task, TaskPriority priority = TaskPriority::Background,
+              CancellationToken token = {});
+  // Runs `task` on a worker, then queues then(true) for the UI thread; or
+  // then(false) without running it when the token is cancelled first.
+  void SubmitThen(Task task, std::function<void(bool completed)> then,
+                  TaskPriority priority = TaskPriority::Interactive,
+                  CancellationToken token = {});
+
+  // Calls fn(i) for every i in [0, count) on up to max_threads threads (0 =
+  // all workers), the caller included, and returns once all calls are done.
+  // Indices are handed out one at a time, so uneven strips balance. Nested
+  // calls from a worker are fine: the caller never just waits for queued
+  // helpers. False when fn threw (std::bad_alloc, typically) or the token
+  // was cancelled; the remaining indices are then skipped.
+  bool ParallelFor(int32_t count, int32_t max_threads, const std::function<void(int32_t)>& fn,
+                   TaskPriority priority = TaskPriority::Interactive,
+                   const CancellationToken& token = {});
+
+  // Set at startup, before anything is submitted; null stops the wakeups.
+  void SetUiWakeup(std::function<void()> wake);
+  // Runs the continuations queued so far on the calling thread; returns how
+  // many ran.
+  size_t RunUiContinuations();
+
+  // Blocks until no task is queued or running.
+  void WaitIdle();
+  TaskSchedulerStats Stats() const;
+
+  // Process-wide scheduler shared by export, OCR and the pixel kernels.
+  static TaskScheduler& Shared();
+
+private:
+  struct Item {
+    Task task;
+    CancellationToken token;
+  };
+  struct Worker {
+    std::mutex mu;
+    std::deque<Item> queues[2]; // by TaskPriority
+    std::thread thread;
+  };
+
+  void WorkerLoop(size_t index);
+  bool TakeTask(size_t index, Item* out);
+  void Push(Item item, TaskPriority priority);
+  void Run(Item& item);
+  void PostUi(std::function<void()> fn);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_worker_{0};
+  std::atomic<size_t> queued_{0};
+  std::atomic<size_t> running_{0};
+  std::atomic<int32_t> sleepers_{0};
+  std::mutex sleep_mu_;
+  std::condition_variable sleep_cv_;
+  std::condition_variable idle_cv_;
+  bool stopping_ = false; // guarded by sleep_mu_
+
+  std::atomic<uint64_t> submitted_{0};
+  std::atomic<uint64_t> executed_{0};
+  std::atomic<uint64_t> stolen_{0};
+  std::atomic<uint64_t> cancelled_{0};
+  std::atomic<uint64_t> failed_{0};
+  std::atomic<uint64_t> parallel_fors_{0};
+  std::atomic<uint64_t> continuations_{0};
+
+  std::mutex ui_mu_;
+  std::function<void()> ui_wake_;
+  std::vector<std::function<void()>> ui_queue_;
+};
+
+} // namespace snappin
@@ -0,0 +1,246 @@
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace snappin {
+namespace {
+
+// Set by SetThreadName; copied into the thread's ring when it is made, so
+// naming a thread allocates nothing while tracing is off.
+thread_local std::string t_thread_name;
+
+void AppendEscaped(std::string* out, const char* s) {
+  for (; s && *s; ++s) {
+    const char c = *s;
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+      out->append(buf);
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+// Microseconds with nanosecond precision, as the trace viewer expects.
+void AppendMicros(std::string* out, int64_t ns) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%lld.%03lld", static_cast<long long>(ns / 1000),
+                static_cast<long long>(std::abs(ns % 1000)));
+  if (ns < 0 && ns > -1000) {
+    out->push_back('-');
+  }
+  out->append(buf);
+}
+
+} // namespace
+
+std::atomic<bool> TraceRecorder::enabled_{false};
+
+// One thread's events. Only the owning thread writes; fields are atomics so
+// a concurrent dump reads them without a data race, and it checks `head`
+// afterwards to drop slots that were rewritten under it.
+struct TraceRecorder::Ring {
+  struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<const char*> category{nullptr};
+    std::atomic<uint64_t> ts_ns{0};
+    std::atomic<uint64_t> arg{0};  // duration, or the counter value's bits
+    std::atomic<char> phase{0};
+  };
+
+  explicit Ring(uint32_t tid) : tid(tid), slots(std::make_unique<Slot[]>(kEventsPerThread)) {}
+
+  const uint32_t tid;
+  std::unique_ptr<Slot[]> slots;
+  std::atomic<uint64_t> head{0};     // events ever written
+  std::atomic<uint64_t> cleared{0};  // head at the last Clear
+  std::atomic<bool> finished{false};
+  std::string thread_name;           // guarded by the recorder's mu_
+};
+
+TraceRecorder& TraceRecorder::Shared() {
+  static TraceRecorder recorder;
+  return recorder;
+}
+
+void TraceRecorder::SetEnabled(bool enabled) {
+  // Constructed first, so its epoch precedes every timestamp.
+  Shared();
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t TraceRecorder::NowNs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+void TraceRecorder::Span(const char* category, const char* name, uint64_t begin_ns,
+                         uint64_t end_ns) {
+  Record('X', category, name, begin_ns, end_ns > begin_ns ? end_ns - begin_ns : 0);
+}
+
+void TraceRecorder::Counter(const char* name, int64_t value) {
+  if (!Enabled()) {
+    return;
+  }
+  Record('C', nullptr, name, NowNs(), std::bit_cast<uint64_t>(value));
+}
+
+void TraceRecorder::SetThreadName(const char* name) {
+  t_thread_name = name ? name : "";
+  Ring* ring = ThreadRing(false);
+  if (ring) {
+    std::lock_guard<std::mutex> lock(mu_);
+    ring->thread_name = t_thread_name;
+  }
+}
+
+TraceRecorder::Ring* TraceRecorder::ThreadRing(bool create) {
+  // Marks the ring finished when its thread exits, so it can be freed.
+  struct Holder {
+    std::shared_ptr<Ring> ring;
+    ~Holder() {
+      if (ring) {
+        ring->finished.store(true);
+      }
+    }
+  };
+  thread_local Holder holder;
+  if (holder.ring || !create) {
+    return holder.ring.get();
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  while (rings_.size() >= kMaxRings) {
+    auto done = std::find_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<Ring>& r) {
+      return r->finished.load();
+    });
+    if (done == rings_.end()) {
+      break;
+    }
+    rings_.erase(done);
+  }
+  holder.ring = std::make_shared<Ring>(next_tid_++);
+  holder.ring->thread_name = t_thread_name;
+  rings_.push_back(holder.ring);
+  return holder.ring.get();
+}
+
+void TraceRecorder::Record(char phase, const char* category, const char* name, uint64_t ts_ns,
+                           uint64_t arg) {
+  Ring* ring = ThreadRing();
+  const uint64_t n = ring->head.load(std::memory_order_relaxed);
+  Ring::Slot& slot = ring->slots[n & (kEventsPerThread - 1)];
+  // Release stores: a dump that reads any of them also sees `head` at n or
+  // later, so it knows the slot's old event is gone.
+  slot.name.store(name, std::memory_order_release);
+  slot.category.store(category, std::memory_order_release);
+  slot.ts_ns.store(ts_ns, std::memory_order_release);
+  slot.arg.store(arg, std::memory_order_release);
+  slot.phase.store(phase, std::memory_order_release);
+  ring->head.store(n + 1, std::memory_order_release);
+}
+
+std::string TraceRecorder::DumpJson() const {
+  struct Event {
+    const char* name;
+    const char* category;
+    uint64_t ts_ns;
+    uint64_t arg;
+    char phase;
+  };
+  std::string out = "{\"traceEvents\":[\n";
+  out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"SnapPin\"}}";
+  std::vector<Event> events;
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const std::shared_ptr<Ring>& ring : rings_) {
+    const std::string tid = std::to_string(ring->tid);
+    if (!ring->thread_name.empty()) {
+      out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid +
+             ",\"args\":{\"name\":\"";
+      AppendEscaped(&out, ring->thread_name.c_str());
+      out += "\"}}";
+    }
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t first = ring->cleared.load();
+    if (head > kEventsPerThread) {
+      first = std::max(first, head - kEventsPerThread);
+    }
+    events.clear();
+    for (uint64_t i = first; i < head; ++i) {
+      const Ring::Slot& slot = ring->slots[i & (kEventsPerThread - 1)];
+      events.push_back({slot.name.load(std::memory_order_acquire),
+                        slot.category.load(std::memory_order_acquire),
+                        slot.ts_ns.load(std::memory_order_acquire),
+                        slot.arg.load(std::memory_order_acquire),
+                        slot.phase.load(std::memory_order_acquire)});
+    }
+    // Slots of events up to head_after - capacity may have been reused
+    // while they were read.
+    const uint64_t head_after = ring->head.load(std::memory_order_acquire);
+    const uint64_t valid_from =
+        head_after >= kEventsPerThread ? head_after - kEventsPerThread + 1 : 0;
+    for (uint64_t i = std::max(first, valid_from); i < head; ++i) {
+      const Event& ev = events[static_cast<size_t>(i - first)];
+      out += ",\n{\"name\":\"";
+      AppendEscaped(&out, ev.name);
+      out += "\",";
+      if (ev.category) {
+        out += "\"cat\":\"";
+        AppendEscaped(&out, ev.category);
+        out += "\",";
+      }
+      out += "\"ph\":\"";
+      out.push_back(ev.phase);
+      out += "\",\"ts\":";
+      AppendMicros(&out, static_cast<int64_t>(ev.ts_ns - epoch_ns_));
+      if (ev.phase == 'X') {
+        out += ",\"dur\":";
+        AppendMicros(&out, static_cast<int64_t>(ev.arg));
+        out += ",\"pid\":1,\"tid\":" + tid + "}";
+      } else {
+        out += ",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"value\":" +
+               std::to_string(std::bit_cast<int64_t>(ev.arg)) + "}}";
+      }
+    }
+  }
+  out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return out;
+}
+
+bool TraceRecorder::DumpToFile(const std::filesystem::path& path) const {
+  const std::string json = DumpJson();
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(json.data(), static_cast<std::streamsize>(json.size()));
+  return file.good();
+}
+
+void TraceRecorder::Clear() {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const std::shared_ptr<Ring>& ring : rings_) {
+    ring->cleared.store(ring->head.load(std::memory_order_acquire));
+  }
+}
+
+TraceStats TraceRecorder::Stats() const {
+  TraceStats stats;
+  std::lock_guard<std::mutex> lock(mu_);
+  stats.threads = rings_.size();
+  for (const std::shared_ptr<Ring>& ring : rings_) {
+    const uint64_t recorded = ring->head.load() - ring->cleared.load();
+    stats.recorded += recorded;
+    stats.overwritten += recorded > kEventsPerThread ? recorded - kEventsPerThread : 0;
+  }
+  return stats;
+}
+
+} // namespace snappin
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace snappin {
+
+struct TraceStats {
+  size_t threads = 0;        // rings allocated so far, finished threads included
+  uint64_t recorded = 0;     // events written since the last Clear
+  uint64_t overwritten = 0;  // of those, lost to ring wrap-around
+};
+
+// Span and counter recorder for latency investigations, dumped as Chrome
+// trace-event JSON (chrome://tracing, Perfetto).
+//
+// Every thread that records gets its own ring of kEventsPerThread events,
+// allocated on its first event; recording touches nothing shared, and the
+// oldest events are overwritten once a ring is full. Spans are stored
+// complete ("X" events: start and duration) when they end, so wrap-around
+// never leaves an unmatched begin. Dumps can run while threads record:
+// events overwritten during the dump, and the oldest event of a full ring,
+// are left out.
+//
+// Off by default. While off, a span costs one relaxed atomic load.
+// Event and category names are not copied: pass string literals or strings
+// that outlive the recorder (registered action ids, say).
+class TraceRecorder {
+public:
+  static constexpr size_t kEventsPerThread = size_t{1} << 14;
+  // Rings of finished threads are freed, oldest first, beyond this many.
+  static constexpr size_t kMaxRings = 64;
+
+  static TraceRecorder& Shared();
+  static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void SetEnabled(bool enabled);
+  // Nanoseconds on a monotonic clock; only differences are meaningful.
+  static uint64_t NowNs();
+
+  void Span(const char* category, const char* name, uint64_t begin_ns, uint64_t end_ns);
+  void Counter(const char* name, int64_t value);
+  // Labels the calling thread in dumps ("ui", "export"); copied. Does not
+  // allocate the thread's ring: the name is applied when it first records.
+  void SetThreadName(const char* name);
+
+  // {"traceEvents":[...]} with timestamps in microseconds since the first
+  // ring was made. Recording carries on.
+  std::string DumpJson() const;
+  // Writes DumpJson() to `path` (replacing it); false when it cannot.
+  bool DumpToFile(const std::filesystem::path& path) const;
+  // Drops recorded events; rings stay allocated.
+  void Clear();
+  TraceStats Stats() const;
+
+private:
+  struct Ring;
+  TraceRecorder() = default;
+  // Null when the calling thread has no ring yet and `create` is false.
+  Ring* ThreadRing(bool create = true);
+  void Record(char phase, const char* category, const char* name, uint64_t ts_ns,
+              uint64_t arg);
+
+  static std::atomic<bool> enabled_;
+
+  mutable std::mutex mu_;
+  std::vector<std::shared_ptr<Ring>> rings_;  // guarded by mu_
+  uint32_t next_tid_ = 1;                     // guarded by mu_
+  const uint64_t epoch_ns_ = NowNs();
+};
+
+// Records the enclosing scope as a span when tracing was on at its start.
+class TraceSpan {
+public:
+  explicit TraceSpan(const char* name, const char* category = "app")
+      : name_(TraceRecorder::Enabled() ? name : nullptr),
+        category_(category),
+        begin_ns_(name_ ? TraceRecorder::NowNs() : 0) {}
+  ~TraceSpan() {
+    if (name_) {
+      TraceRecorder::Shared().Span(category_, name_, begin_ns_, TraceRecorder::NowNs());
+    }
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+  const char* name_;
+  const char* category_;
+  uint64_t begin_ns_;
+};
+
+#define SNAPPIN_TRACE_CONCAT_INNER(a, b) a##b
+#define SNAPPIN_TRACE_CONCAT(a, b) SNAPPIN_TRACE_CONCAT_INNER(a, b)
+// SNAPPIN_TRACE_SPAN("overlay.paint") or SNAPPIN_TRACE_SPAN("copy", "export").
+#define SNAPPIN_TRACE_SPAN(...) \
+  ::snappin::TraceSpan SNAPPIN_TRACE_CONCAT(snappin_trace_span_, __LINE__)(__VA_ARGS__)
+
+} // namespace snappin
@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
+#include <cstddef>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -15,6 +17,9 @@ struct Id64 { uint64_t value = 0; };
 struct PointPX { int32_t x = 0; int32_t y = 0; };
 struct SizePX  { int32_t w = 0; int32_t h = 0; };
 struct RectPX  { int32_t x = 0; int32_t y = 0; int32_t w = 0; int32_t h = 0; };
+// Continuous pixel coordinates: pixel (x, y) covers [x, x + 1) x [y, y + 1),
+// so pixel p's center is at p + 0.5.
+struct PointF  { float x = 0.0f; float y = 0.0f; };
 
 // ---------- Time ----------
 struct TimeStamp { uint64_t mono_ms = 0; };
@@ -107,4 +112,63 @@ struct CpuBitmap {
   CpuDataRef data{};
 };
 
+// Immutable, ref-counted view of 32bpp pixels: a shared backing buffer plus
+// origin, stride and size. Copying a view or cropping it never copies pixels;
+// every holder reads the same frame. Code that needs to modify pixels must
+// write into a new buffer (Clone() or its own allocation) and publish a new
+// view, so existing holders are never affected.
+class BitmapView {
+public:
+  BitmapView() = default;
+  // origin shares ownership with whatever keeps the pixels alive (use the
+  // shared_ptr aliasing constructor to point into a larger buffer).
+  BitmapView(std::shared_ptr<const uint8_t> origin, const SizePX& size_px,
+             int32_t stride_bytes, PixelFormat format = PixelFormat::BGRA8);
+
+  // Wraps a whole buffer. Returns an empty view if the buffer is too small.
+  static BitmapView FromBuffer(std::shared_ptr<std::vector<uint8_t>> buffer,
+                               const SizePX& size_px, int32_t stride_bytes,
+                               PixelFormat format = PixelFormat::BGRA8);
+  // Deep-copies an unowned bitmap into a tightly packed buffer.
+  static BitmapView CopyFrom(const CpuBitmap& bitmap);
+
+  bool valid() const { return origin_ != nullptr; }
+  const uint8_t* data() const { return origin_.get(); }
+  const uint8_t* row(int32_t y) const {
+    return origin_.get() + static_cast<size_t>(y) * static_cast<size_t>(stride_bytes_);
+  }
+  const SizePX& size_px() const { return size_px_; }
+  int32_t stride_bytes() const { return stride_bytes_; }
+  PixelFormat format() const { return format_; }
+  // Bytes from the first pixel to the end of the last row's pixels.
+  size_t span_bytes() const;
+
+  // Zero-copy sub-view; rect is clipped to the bitmap. Empty if nothing remains.
+  BitmapView Crop(const RectPX& rect) const;
+  // Deep copy into a new tightly packed buffer.
+  BitmapView Clone() const;
+  // Unowned CpuBitmap for APIs that take one. Pixels must be treated as
+  // read-only and the view must outlive the returned value.
+  CpuBitmap AsCpuBitmap() const;
+  bool SharesBufferWith(const BitmapView& other) const;
+  long use_count() const { return origin_.use_count(); }
+  // For registries that must not keep the pixels alive; lock() it and pass
+  // the same size, stride and format to rebuild the view.
+  std::weak_ptr<const uint8_t> weak_origin() const { return origin_; }
+
+private:
+  std::shared_ptr<const uint8_t> origin_;
+  SizePX size_px_{};
+  int32_t stride_bytes_ = 0;
+  PixelFormat format_ = PixelFormat::BGRA8;
+};
+
+// Maps a view to one with the same pixels, possibly sharing a buffer that is
+// already held elsewhere (PixelDedupRegistry). Thread-safe.
+class IPixelInterner {
+public:
+  virtual ~IPixelInterner() = default;
+  virtual BitmapView Intern(BitmapView pixels) = 0;
+};
+
 } // namespace snappin
@@ -0,0 +1,113 @@
+#include "WindowRectIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+int32_t CellCount(int64_t extent, int32_t* cell_px) {
+  int64_t cells = extent / WindowRectIndex::kMinCellPx;
+  cells = std::clamp<int64_t>(cells, 1, WindowRectIndex::kMaxCellsPerAxis);
+  *cell_px = static_cast<int32_t>((extent + cells - 1) / cells);
+  return static_cast<int32_t>(cells);
+}
+
+} // namespace
+
+void WindowRectIndex::Build(std::vector<WindowRectEntry> entries) {
+  Clear();
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+                               [](const WindowRectEntry& e) {
+                                 return e.rect.w <= 0 || e.rect.h <= 0;
+                               }),
+                entries.end());
+  if (entries.empty()) {
+    return;
+  }
+  entries_ = std::move(entries);
+
+  int64_t left = entries_[0].rect.x;
+  int64_t top = entries_[0].rect.y;
+  int64_t right = left + entries_[0].rect.w;
+  int64_t bottom = top + entries_[0].rect.h;
+  for (const WindowRectEntry& e : entries_) {
+    left = std::min<int64_t>(left, e.rect.x);
+    top = std::min<int64_t>(top, e.rect.y);
+    right = std::max<int64_t>(right, static_cast<int64_t>(e.rect.x) + e.rect.w);
+    bottom = std::max<int64_t>(bottom, static_cast<int64_t>(e.rect.y) + e.rect.h);
+  }
+  bounds_ = RectPX{static_cast<int32_t>(left), static_cast<int32_t>(top),
+                   static_cast<int32_t>(right - left), static_cast<int32_t>(bottom - top)};
+  cols_ = CellCount(right - left, &cell_w_);
+  rows_ = CellCount(bottom - top, &cell_h_);
+
+  // Two passes (count, then fill) into one flat array; filling in entry
+  // order keeps every cell list sorted by z-order.
+  auto cell_span = [this](const RectPX& r, int32_t* c0, int32_t* c1, int32_t* r0,
+                          int32_t* r1) {
+    const int64_t x0 = static_cast<int64_t>(r.x) - bounds_.x;
+    const int64_t y0 = static_cast<int64_t>(r.y) - bounds_.y;
+    *c0 = static_cast<int32_t>(x0 / cell_w_);
+    *c1 = static_cast<int32_t>((x0 + r.w - 1) / cell_w_);
+    *r0 = static_cast<int32_t>(y0 / cell_h_);
+    *r1 = static_cast<int32_t>((y0 + r.h - 1) / cell_h_);
+  };
+  const size_t cells = static_cast<size_t>(cols_) * static_cast<size_t>(rows_);
+  cell_start_.assign(cells + 1, 0);
+  for (const WindowRectEntry& e : entries_) {
+    int32_t c0, c1, r0, r1;
+    cell_span(e.rect, &c0, &c1, &r0, &r1);
+    for (int32_t row = r0; row <= r1; ++row) {
+      for (int32_t col = c0; col <= c1; ++col) {
+        ++cell_start_[static_cast<size_t>(row) * cols_ + col + 1];
+      }
+    }
+  }
+  for (size_t c = 0; c < cells; ++c) {
+    cell_start_[c + 1] += cell_start_[c];
+  }
+  cell_items_.resize(cell_start_[cells]);
+  std::vector<uint32_t> cursor(cell_start_.begin(), cell_start_.end() - 1);
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    int32_t c0, c1, r0, r1;
+    cell_span(entries_[i].rect, &c0, &c1, &r0, &r1);
+    for (int32_t row = r0; row <= r1; ++row) {
+      for (int32_t col = c0; col <= c1; ++col) {
+        cell_items_[cursor[static_cast<size_t>(row) * cols_ + col]++] =
+            static_cast<uint32_t>(i);
+      }
+    }
+  }
+}
+
+void WindowRectIndex::Clear() {
+  entries_.clear();
+  bounds_ = RectPX{};
+  cell_w_ = 1;
+  cell_h_ = 1;
+  cols_ = 0;
+  rows_ = 0;
+  cell_start_.clear();
+  cell_items_.clear();
+}
+
+const WindowRectEntry* WindowRectIndex::TopmostAt(const PointPX& pt) const {
+  const int64_t dx = static_cast<int64_t>(pt.x) - bounds_.x;
+  const int64_t dy = static_cast<int64_t>(pt.y) - bounds_.y;
+  if (entries_.empty() || dx < 0 || dy < 0 || dx >= bounds_.w || dy >= bounds_.h) {
+    return nullptr;
+  }
+  const size_t cell = static_cast<size_t>(dy / cell_h_) * cols_ + static_cast<size_t>(dx / cell_w_);
+  for (uint32_t k = cell_start_[cell]; k < cell_start_[cell + 1]; ++k) {
+    const WindowRectEntry& e = entries_[cell_items_[k]];
+    if (pt.x >= e.rect.x && pt.y >= e.rect.y &&
+        static_cast<int64_t>(pt.x) < static_cast<int64_t>(e.rect.x) + e.rect.w &&
+        static_cast<int64_t>(pt.y) < static_cast<int64_t>(e.rect.y) + e.rect.h) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace snappin
@@ -0,0 +1,54 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snappin {
+
+struct WindowRectEntry {
+  RectPX rect{};   // screen pixels
+  uint64_t id = 0; // caller's handle (an HWND on Windows)
+};
+
+// Immutable snapshot of top-level window rectangles in z-order, answering
+// "topmost window under this point" without touching the window manager.
+// The bounding box of all rects is cut into a uniform grid; each cell lists
+// the windows overlapping it in z-order, so a query scans one short list and
+// stops at the first hit. Cheap to query from the UI thread per mouse move.
+class WindowRectIndex {
+public:
+  // Cells never get smaller than this, nor more than kMaxCellsPerAxis per axis.
+  static constexpr int32_t kMinCellPx = 32;
+  static constexpr int32_t kMaxCellsPerAxis = 64;
+
+  WindowRectIndex() = default;
+
+  // `entries` are topmost first. Empty rects are dropped.
+  void Build(std::vector<WindowRectEntry> entries);
+  void Clear();
+
+  // Topmost entry whose rect contains `pt` (left/top inclusive, right/bottom
+  // exclusive), or null.
+  const WindowRectEntry* TopmostAt(const PointPX& pt) const;
+
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  // Total entry references across cells; for tests and benchmarks.
+  size_t cell_refs() const { return cell_items_.size(); }
+
+private:
+  std::vector<WindowRectEntry> entries_;
+  RectPX bounds_{};
+  int32_t cell_w_ = 1;
+  int32_t cell_h_ = 1;
+  int32_t cols_ = 0;
+  int32_t rows_ = 0;
+  // Cell c lists cell_items_[cell_start_[c] .. cell_start_[c + 1]), ascending
+  // entry index (= z-order).
+  std::vector<uint32_t> cell_start_;
+  std::vector<uint32_t> cell_items_;
+};
+
+} // namespace snappin
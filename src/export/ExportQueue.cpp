@@ -0,0 +1,198 @@
+#include "ExportQueue.h"
+
+#include "ErrorCodes.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace snappin {
+namespace {
+
+// Progress events are throttled to steps of at least this much.
+constexpr float kProgressStep = 0.05f;
+
+bool SameSnapshot(const BitmapView& a, const BitmapView& b) {
+  if (!a.valid() || !b.valid()) {
+    // No CPU pixels: the save recaptures the screen, so never merge.
+    return false;
+  }
+  return a.data() == b.data() && a.size_px().w == b.size_px().w &&
+         a.size_px().h == b.size_px().h && a.stride_bytes() == b.stride_bytes();
+}
+
+} // namespace
+
+ExportQueue::ExportQueue(ExportSaveFn save, ExportEventSink sink, int32_t max_jobs)
+    : save_(std::move(save)), sink_(std::move(sink)), max_jobs_(max_jobs > 0 ? max_jobs : 1) {}
+
+ExportQueue::~ExportQueue() {
+  std::unique_lock<std::mutex> lock(mu_);
+  stopping_ = true;
+  // Drain tasks use `this` until they return.
+  idle_cv_.wait(lock,
+                [this] { return pending_.empty() && running_.empty() && drains_ == 0; });
+}
+
+bool ExportQueue::SameSave(const ExportRequest& a, const ExportRequest& b) {
+  if (a.artifact.artifact_id.value != b.artifact.artifact_id.value ||
+      !SameSnapshot(a.artifact.base_cpu, b.artifact.base_cpu) ||
+      a.options.format != b.options.format ||
+      a.options.png_preset != b.options.png_preset) {
+    return false;
+  }
+  if (a.auto_path || b.auto_path) {
+    return a.auto_path && b.auto_path;
+  }
+  return a.options.path == b.options.path;
+}
+
+bool ExportQueue::Submit(Id64 correlation_id, ExportRequest request) {
+  std::unique_lock<std::mutex> lock(mu_);
+  if (stopping_) {
+    lock.unlock();
+    ExportQueueEvent ev;
+    ev.correlation_id = correlation_id;
+    ev.type = ActionEvent::Type::Failed;
+    Error err;
+    err.code = ERR_OPERATION_ABORTED;
+    err.message = "Export queue stopped";
+    err.retryable = false;
+    err.detail = "export_queue_stopping";
+    ev.error = err;
+    if (sink_) {
+      sink_(ev);
+    }
+    return false;
+  }
+  ++stats_.submitted;
+  for (const auto& job : running_) {
+    if (!job->finished && SameSave(job->request, request)) {
+      job->correlation_ids.push_back(correlation_id);
+      ++stats_.coalesced;
+      return true;
+    }
+  }
+  for (const auto& job : pending_) {
+    if (SameSave(job->request, request)) {
+      job->correlation_ids.push_back(correlation_id);
+      ++stats_.coalesced;
+      return true;
+    }
+  }
+  auto job = std::make_shared<Job>();
+  job->request = std::move(request);
+  job->correlation_ids.push_back(correlation_id);
+  pending_.push_back(std::move(job));
+  const bool start = drains_ < max_jobs_;
+  if (start) {
+    ++drains_;
+  }
+  lock.unlock();
+  if (start) {
+    TaskScheduler::Shared().Submit([this] { Drain(); }, TaskPriority::Interactive);
+  }
+  return false;
+}
+
+void ExportQueue::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mu_);
+  idle_cv_.wait(lock, [this] { return pending_.empty() && running_.empty(); });
+}
+
+ExportQueueStats ExportQueue::Stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  ExportQueueStats out = stats_;
+  out.pending = pending_.size() + running_.size();
+  return out;
+}
+
+void ExportQueue::Drain() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!pending_.empty()) {
+    std::shared_ptr<Job> job = std::move(pending_.front());
+    pending_.pop_front();
+    running_.push_back(job);
+    lock.unlock();
+
+    Run(job);
+
+    lock.lock();
+    running_.erase(std::find(running_.begin(), running_.end(), job));
+  }
+  --drains_;
+  // Under the lock: the destructor may be waiting to free the queue.
+  idle_cv_.notify_all();
+}
+
+void ExportQueue::Run(const std::shared_ptr<Job>& job) {
+  ExportQueueEvent started;
+  started.type = ActionEvent::Type::Progress;
+  started.progress_0_1 = 0.0f;
+  Emit(job, started);
+
+  ExportRequest request = job->request;
+  request.options.on_progress = [this, job](float progress) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (progress < 1.0f && progress < job->last_progress + kProgressStep) {
+        return;
+      }
+      job->last_progress = progress;
+    }
+    ExportQueueEvent ev;
+    ev.type = ActionEvent::Type::Progress;
+    ev.progress_0_1 = progress;
+    Emit(job, ev);
+  };
+
+  Result<std::wstring> saved;
+  if (save_) {
+    saved = save_(request);
+  } else {
+    Error err;
+    err.code = ERR_INTERNAL_ERROR;
+    err.message = "Export unavailable";
+    err.retryable = false;
+    err.detail = "export_save_null";
+    saved = Result<std::wstring>::Fail(err);
+  }
+
+  ExportQueueEvent done;
+  if (saved.ok) {
+    done.type = ActionEvent::Type::Succeeded;
+    done.progress_0_1 = 1.0f;
+    done.path = saved.value;
+  } else {
+    done.type = ActionEvent::Type::Failed;
+    done.error = saved.error;
+  }
+  {
+    // No request joins a finished job, so every id gets exactly one result.
+    std::lock_guard<std::mutex> lock(mu_);
+    job->finished = true;
+    if (saved.ok) {
+      ++stats_.succeeded;
+    } else {
+      ++stats_.failed;
+    }
+  }
+  Emit(job, done);
+}
+
+void ExportQueue::Emit(const std::shared_ptr<Job>& job, ExportQueueEvent ev) {
+  std::vector<Id64> ids;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ids = job->correlation_ids;
+  }
+  if (!sink_) {
+    return;
+  }
+  for (const Id64& id : ids) {
+    ev.correlation_id = id;
+    sink_(ev);
+  }
+}
+
+} // namespace snappin
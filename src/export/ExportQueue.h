@@ -0,0 +1,96 @@
+#pragma once
+#include "Action.h"
+#include "Artifact.h"
+#include "ExportService.h"
+#include "Types.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace snappin {
+
+// One save, bound to a snapshot of the artifact. `artifact.base_cpu` is an
+// immutable BitmapView, so later edits or a dismiss of the live artifact do
+// not affect a queued save.
+struct ExportRequest {
+  Artifact artifact;
+  SaveImageOptions options;
+  bool auto_path = false; // path was generated rather than requested
+};
+
+struct ExportQueueEvent {
+  Id64 correlation_id{};
+  ActionEvent::Type type = ActionEvent::Type::Progress;
+  float progress_0_1 = 0.0f;
+  std::wstring path; // Succeeded: the file written
+  std::optional<Error> error;
+};
+
+struct ExportQueueStats {
+  uint64_t submitted = 0;
+  uint64_t coalesced = 0;
+  uint64_t succeeded = 0;
+  uint64_t failed = 0;
+  size_t pending = 0;
+};
+
+// Runs one save on a scheduler worker. `request.options.on_progress` is set
+// by the queue and may be called with 0..1 while encoding.
+using ExportSaveFn = std::function<Result<std::wstring>(const ExportRequest& request)>;
+// Receives events on scheduler workers; must not call back into the queue.
+using ExportEventSink = std::function<void(const ExportQueueEvent& ev)>;
+
+// Background save queue. Submit returns at once; saves run as interactive
+// tasks on TaskScheduler::Shared(), at most max_jobs at a time, reporting
+// Progress and then Succeeded or Failed per correlation id. A save of the
+// same snapshot to the same destination (or to any generated path) while an
+// equal one is queued or running joins that job instead of encoding twice.
+// Destruction finishes every accepted job.
+class ExportQueue {
+public:
+  ExportQueue(ExportSaveFn save, ExportEventSink sink, int32_t max_jobs = 1);
+  ~ExportQueue();
+
+  ExportQueue(const ExportQueue&) = delete;
+  ExportQueue& operator=(const ExportQueue&) = delete;
+
+  // Returns true when the request joined an equal queued or running save.
+  bool Submit(Id64 correlation_id, ExportRequest request);
+  // Blocks until no job is queued or running.
+  void WaitIdle();
+  ExportQueueStats Stats() const;
+
+private:
+  struct Job {
+    ExportRequest request;
+    std::vector<Id64> correlation_ids;
+    float last_progress = 0.0f;
+    bool finished = false;
+  };
+
+  static bool SameSave(const ExportRequest& a, const ExportRequest& b);
+  // One scheduler task: runs queued jobs until none is left.
+  void Drain();
+  void Run(const std::shared_ptr<Job>& job);
+  void Emit(const std::shared_ptr<Job>& job, ExportQueueEvent ev);
+
+  ExportSaveFn save_;
+  ExportEventSink sink_;
+  const int32_t max_jobs_;
+  mutable std::mutex mu_;
+  std::condition_variable idle_cv_;
+  std::deque<std::shared_ptr<Job>> pending_;
+  std::vector<std::shared_ptr<Job>> running_;
+  ExportQueueStats stats_;
+  int32_t drains_ = 0; // Drain tasks submitted and not yet returned
+  bool stopping_ = false;
+};
+
+} // namespace snappin
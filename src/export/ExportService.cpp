@@ -1,14 +1,13 @@
 #include "ExportService.h"
 
 #include "ErrorCodes.h"
+#include "PngEncoder.h"
+#include "TraceRecorder.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
-#include <wincodec.h>
-
-#include <shlwapi.h>
-
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -37,12 +36,6 @@ bool OpenClipboardWithRetry(HWND hwnd, int retry_ms, int retry_count, Error* err
   return false;
 }
 
-void SafeRelease(IUnknown* ptr) {
-  if (ptr) {
-    ptr->Release();
-  }
-}
-
 struct DIBSection {
   HBITMAP bitmap = nullptr;
   void* bits = nullptr;
@@ -53,21 +46,12 @@ bool TryGetCpuBitmap(const Artifact& art, CpuBitmap* out) {
   if (!out) {
     return false;
   }
-  if (!art.base_cpu.has_value()) {
-    return false;
-  }
-  if (!art.base_cpu_storage || art.base_cpu_storage->empty()) {
+  if (!art.base_cpu.valid()) {
     return false;
   }
-  *out = art.base_cpu.value();
-  out->data.p = art.base_cpu_storage->data();
-  if (out->size_px.w <= 0 || out->size_px.h <= 0) {
-    return false;
-  }
-  if (out->stride_bytes < out->size_px.w * 4) {
-    return false;
-  }
-  return out->data.p != nullptr;
+  // Read-only view of the shared artifact pixels; the caller holds `art`.
+  *out = art.base_cpu.AsCpuBitmap();
+  return true;
 }
 
 DIBSection CreateDib(int32_t width, int32_t height) {
@@ -247,262 +231,82 @@ bool EnsureDirForFile(const std::wstring& path, Error* err) {
   return true;
 }
 
-Result<std::wstring> SavePngFromPixels(const void* pixels, int32_t width, int32_t height,
-                                       int32_t stride, const std::wstring& path) {
-  Error err;
-  if (!EnsureDirForFile(path, &err)) {
-    return Result<std::wstring>::Fail(err);
-  }
-
-  HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-  bool co_uninit = (hr == S_OK || hr == S_FALSE);
-  if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) {
-    err.code = ERR_INTERNAL_ERROR;
-    err.message = "COM init failed";
-    err.retryable = true;
-    err.detail = "CoInitializeEx";
-    return Result<std::wstring>::Fail(err);
-  }
-
-  IWICImagingFactory* factory = nullptr;
-  IWICBitmapEncoder* encoder = nullptr;
-  IWICBitmapFrameEncode* frame = nullptr;
-  IPropertyBag2* bag = nullptr;
-  IWICBitmap* bitmap = nullptr;
-  IStream* file_stream = nullptr;
-
-  hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
-                        IID_PPV_ARGS(&factory));
-  if (FAILED(hr)) {
-    err.code = ERR_INTERNAL_ERROR;
-    err.message = "WIC unavailable";
-    err.retryable = true;
-    err.detail = "CoCreateInstance";
-    if (co_uninit) {
-      CoUninitialize();
-    }
-    return Result<std::wstring>::Fail(err);
-  }
-
-  hr = factory->CreateBitmapFromMemory(width, height, GUID_WICPixelFormat32bppBGRA,
-                                       stride, height * stride,
-                                       reinterpret_cast<BYTE*>(const_cast<void*>(pixels)),
-                                       &bitmap);
-  if (FAILED(hr)) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "CreateBitmapFromMemory";
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
-    return Result<std::wstring>::Fail(err);
-  }
-
-  hr = SHCreateStreamOnFileEx(path.c_str(),
-                              STGM_CREATE | STGM_WRITE | STGM_SHARE_EXCLUSIVE,
-                              FILE_ATTRIBUTE_NORMAL, TRUE, nullptr, &file_stream);
-  if (FAILED(hr)) {
-    DWORD last = GetLastError();
-    if (HRESULT_FROM_WIN32(ERROR_DISK_FULL) == hr || last == ERROR_DISK_FULL) {
-      err.code = ERR_DISK_FULL;
-      err.message = "Disk full";
-      err.retryable = false;
-    } else {
-      err.code = ERR_PATH_NOT_WRITABLE;
-      err.message = "Save path not writable";
-      err.retryable = false;
-    }
-    char buffer[128];
-    _snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "SHCreateStreamOnFileEx hr=0x%08X",
-                static_cast<unsigned int>(hr));
-    err.detail = buffer;
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
-    return Result<std::wstring>::Fail(err);
-  }
-
-  hr = factory->CreateEncoder(GUID_ContainerFormatPng, nullptr, &encoder);
-  if (FAILED(hr)) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "CreateEncoder";
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
-    return Result<std::wstring>::Fail(err);
-  }
-
-  hr = encoder->Initialize(file_stream, WICBitmapEncoderNoCache);
-  if (FAILED(hr)) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "EncoderInitialize";
-    SafeRelease(encoder);
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
-    return Result<std::wstring>::Fail(err);
-  }
-
-  hr = encoder->CreateNewFrame(&frame, &bag);
-  if (FAILED(hr)) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "CreateNewFrame";
-    SafeRelease(encoder);
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
-    return Result<std::wstring>::Fail(err);
-  }
-
-  hr = frame->Initialize(bag);
-  if (FAILED(hr)) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "FrameInitialize";
-    SafeRelease(bag);
-    SafeRelease(frame);
-    SafeRelease(encoder);
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
-    return Result<std::wstring>::Fail(err);
-  }
-
-  hr = frame->SetSize(width, height);
-  if (FAILED(hr)) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "SetSize";
-    SafeRelease(bag);
-    SafeRelease(frame);
-    SafeRelease(encoder);
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
-    return Result<std::wstring>::Fail(err);
+bool WriteFileBytes(const std::wstring& path, const std::vector<uint8_t>& bytes,
+                    Error* err) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    FillWin32Error(err, ERR_PATH_NOT_WRITABLE, "Save path not writable", GetLastError());
+    err->retryable = false;
+    return false;
   }
-
-  WICPixelFormatGUID format = GUID_WICPixelFormat32bppBGRA;
-  hr = frame->SetPixelFormat(&format);
-  if (FAILED(hr) || format != GUID_WICPixelFormat32bppBGRA) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "SetPixelFormat";
-    SafeRelease(bag);
-    SafeRelease(frame);
-    SafeRelease(encoder);
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
+  size_t offset = 0;
+  while (offset < bytes.size()) {
+    const DWORD chunk = static_cast<DWORD>(
+        std::min<size_t>(bytes.size() - offset, size_t{1} << 30));
+    DWORD written = 0;
+    if (!WriteFile(file, bytes.data() + offset, chunk, &written, nullptr) || written == 0) {
+      const DWORD last = GetLastError();
+      CloseHandle(file);
+      DeleteFileW(path.c_str());
+      if (last == ERROR_DISK_FULL || last == ERROR_HANDLE_DISK_FULL) {
+        FillWin32Error(err, ERR_DISK_FULL, "Disk full", last);
+      } else {
+        FillWin32Error(err, ERR_PATH_NOT_WRITABLE, "Save path not writable", last);
+      }
+      err->retryable = false;
+      return false;
     }
-    return Result<std::wstring>::Fail(err);
+    offset += written;
   }
+  CloseHandle(file);
+  return true;
+}
 
-  hr = frame->WriteSource(bitmap, nullptr);
-  if (FAILED(hr)) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "WriteSource";
-    SafeRelease(bag);
-    SafeRelease(frame);
-    SafeRelease(encoder);
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
+Result<std::wstring> SavePngFromPixels(const void* pixels, int32_t width, int32_t height,
+                                       int32_t stride, PngPreset preset,
+                                       const std::function<void(float)>& progress,
+                                       const std::wstring& path) {
+  Error err;
+  if (!EnsureDirForFile(path, &err)) {
     return Result<std::wstring>::Fail(err);
   }
 
-  hr = frame->Commit();
-  if (FAILED(hr)) {
+  // The encoder reads rows through the stride, so cropped views need no packing.
+  CpuBitmap bmp;
+  bmp.format = PixelFormat::BGRA8;
+  bmp.size_px = {width, height};
+  bmp.stride_bytes = stride;
+  bmp.data.p = const_cast<void*>(pixels);
+
+  PngEncodeOptions options;
+  options.preset = preset;
+  options.progress = progress;
+  std::vector<uint8_t> png;
+  if (!EncodePng(bmp, options, &png)) {
     err.code = ERR_ENCODE_IMAGE_FAILED;
     err.message = "Encode failed";
     err.retryable = true;
-    err.detail = "FrameCommit";
-    SafeRelease(bag);
-    SafeRelease(frame);
-    SafeRelease(encoder);
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
+    err.detail = "EncodePng";
     return Result<std::wstring>::Fail(err);
   }
 
-  hr = encoder->Commit();
-  if (FAILED(hr)) {
-    err.code = ERR_ENCODE_IMAGE_FAILED;
-    err.message = "Encode failed";
-    err.retryable = true;
-    err.detail = "EncoderCommit";
-    SafeRelease(bag);
-    SafeRelease(frame);
-    SafeRelease(encoder);
-    SafeRelease(file_stream);
-    SafeRelease(bitmap);
-    SafeRelease(factory);
-    if (co_uninit) {
-      CoUninitialize();
-    }
+  if (!WriteFileBytes(path, png, &err)) {
     return Result<std::wstring>::Fail(err);
   }
-
-  SafeRelease(bag);
-  SafeRelease(frame);
-  SafeRelease(encoder);
-  SafeRelease(file_stream);
-  SafeRelease(bitmap);
-  SafeRelease(factory);
-  if (co_uninit) {
-    CoUninitialize();
-  }
   return Result<std::wstring>::Ok(path);
 }
 
 Result<std::wstring> SavePngFromDib(const DIBSection& dib, const RectPX& rect,
-                                    const std::wstring& path) {
-  return SavePngFromPixels(dib.bits, rect.w, rect.h, dib.stride, path);
+                                    const SaveImageOptions& options) {
+  return SavePngFromPixels(dib.bits, rect.w, rect.h, dib.stride, options.png_preset,
+                           options.on_progress, options.path);
 }
 
 } // namespace
 
 Result<void> ExportService::CopyImageToClipboard(const Artifact& art) {
+  SNAPPIN_TRACE_SPAN("export.copy_image", "export");
   Error err;
   CpuBitmap bmp;
   if (TryGetCpuBitmap(art, &bmp) && bmp.format == PixelFormat::BGRA8 &&
@@ -583,6 +387,7 @@ Result<void> ExportService::CopyImageToClipboard(const Artifact& art) {
 
 Result<std::wstring> ExportService::SaveImage(const Artifact& art,
                                               const SaveImageOptions& options) {
+  SNAPPIN_TRACE_SPAN("export.save_image", "export");
   if (options.format != ImageFormat::PNG) {
     Error err;
     err.code = ERR_ENCODE_IMAGE_FAILED;
@@ -604,7 +409,8 @@ Result<std::wstring> ExportService::SaveImage(const Artifact& art,
   if (TryGetCpuBitmap(art, &bmp) && bmp.format == PixelFormat::BGRA8 &&
       bmp.size_px.w > 0 && bmp.size_px.h > 0) {
     return SavePngFromPixels(bmp.data.p, bmp.size_px.w, bmp.size_px.h,
-                             bmp.stride_bytes, options.path);
+                             bmp.stride_bytes, options.png_preset, options.on_progress,
+                             options.path);
   }
 
   // Placeholder: recapture using GDI until GPU frames are wired.
@@ -624,7 +430,7 @@ Result<std::wstring> ExportService::SaveImage(const Artifact& art,
     return Result<std::wstring>::Fail(err);
   }
 
-  Result<std::wstring> saved = SavePngFromDib(dib, rect, options.path);
+  Result<std::wstring> saved = SavePngFromDib(dib, rect, options);
   DeleteObject(dib.bitmap);
   return saved;
 }
@@ -1,7 +1,9 @@
 #pragma once
 #include "Artifact.h"
+#include "PngEncoder.h"
 #include "Types.h"
 
+#include <functional>
 #include <string>
 
 namespace snappin {
@@ -11,8 +13,11 @@ enum class ImageFormat { PNG, JPEG, WEBP };
 struct SaveImageOptions {
   ImageFormat format = ImageFormat::PNG;
   int32_t quality_0_100 = 90;
+  PngPreset png_preset = PngPreset::Balanced;
   std::wstring path;
   bool open_folder = false;
+  // Called with 0..1 while encoding, possibly from encoder threads.
+  std::function<void(float)> on_progress;
 };
 
 class IExportService {
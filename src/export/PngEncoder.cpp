@@ -0,0 +1,912 @@
+#include "PngEncoder.h"
+
+#include "Crc32.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace snappin {
+namespace {
+
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kWindowMask = kWindowSize - 1;
+constexpr int kMinMatch = 3;
+constexpr int kMaxMatch = 258;
+constexpr int kHashBits = 15;
+constexpr size_t kHashSize = size_t{1} << kHashBits;
+constexpr size_t kBlockTokens = 16384;
+constexpr size_t kTargetStripBytes = 512 * 1024;
+constexpr size_t kMaxStoredLen = 65535;
+constexpr int kLitLenSymbols = 286;
+constexpr int kDistSymbols = 30;
+constexpr int kCodeLenSymbols = 19;
+constexpr uint32_t kAdlerBase = 65521;
+
+constexpr uint8_t kCodeLenOrder[kCodeLenSymbols] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                                    11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+struct PresetParams {
+  int max_chain;
+  int nice_length;
+  int lazy_below; // try the next position while the match is shorter than this
+  int max_insert; // hash every position of matches up to this length
+  bool all_filters;
+};
+
+PresetParams ParamsFor(PngPreset preset) {
+  switch (preset) {
+    case PngPreset::Fast:
+      return {8, 32, 0, 8, false};
+    case PngPreset::Small:
+      return {1024, kMaxMatch, kMaxMatch, kMaxMatch, true};
+    case PngPreset::Balanced:
+    default:
+      return {64, 128, 32, kMaxMatch, true};
+  }
+}
+
+// ---- Checksums (CRC-32 lives in Crc32.h) ----
+
+uint32_t UpdateAdler(uint32_t adler, const uint8_t* p, size_t n) {
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+  while (n > 0) {
+    // Largest run that cannot overflow b before the modulo.
+    const size_t chunk = std::min<size_t>(n, 5552);
+    for (size_t i = 0; i < chunk; ++i) {
+      a += p[i];
+      b += a;
+    }
+    a %= kAdlerBase;
+    b %= kAdlerBase;
+    p += chunk;
+    n -= chunk;
+  }
+  return a | (b << 16);
+}
+
+// Adler-32 of A||B from adler(A), adler(B) and len(B), as zlib's adler32_combine.
+uint32_t CombineAdler(uint32_t adler1, uint32_t adler2, size_t len2) {
+  const uint64_t base = kAdlerBase;
+  const uint64_t rem = static_cast<uint64_t>(len2 % base);
+  uint64_t sum1 = adler1 & 0xFFFF;
+  uint64_t sum2 = (rem * sum1) % base;
+  sum1 += (adler2 & 0xFFFF) + base - 1;
+  sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + base - rem;
+  if (sum1 >= base) {
+    sum1 -= base;
+  }
+  if (sum1 >= base) {
+    sum1 -= base;
+  }
+  if (sum2 >= (base << 1)) {
+    sum2 -= (base << 1);
+  }
+  if (sum2 >= base) {
+    sum2 -= base;
+  }
+  return static_cast<uint32_t>(sum1 | (sum2 << 16));
+}
+
+// ---- Deflate tables ----
+
+struct LzTables {
+  uint16_t len_symbol[kMaxMatch + 1];
+  uint16_t len_base[29];
+  uint8_t len_extra[29];
+  uint16_t dist_base[kDistSymbols];
+  uint8_t dist_extra[kDistSymbols];
+  uint8_t fixed_lit_len[288];
+  uint16_t fixed_lit_code[288];
+  uint8_t fixed_dist_len[kDistSymbols];
+  uint16_t fixed_dist_code[kDistSymbols];
+};
+
+uint16_t ReverseBits(uint32_t code, int len) {
+  uint32_t r = 0;
+  for (int i = 0; i < len; ++i) {
+    r = (r << 1) | (code & 1);
+    code >>= 1;
+  }
+  return static_cast<uint16_t>(r);
+}
+
+// Canonical Huffman codes, bit-reversed for LSB-first output.
+void AssignCodes(const uint8_t* lengths, int count, uint16_t* codes) {
+  uint32_t bl_count[16] = {};
+  for (int i = 0; i < count; ++i) {
+    ++bl_count[lengths[i]];
+  }
+  bl_count[0] = 0;
+  uint32_t next[16] = {};
+  uint32_t code = 0;
+  for (int bits = 1; bits < 16; ++bits) {
+    code = (code + bl_count[bits - 1]) << 1;
+    next[bits] = code;
+  }
+  for (int i = 0; i < count; ++i) {
+    codes[i] = lengths[i] ? ReverseBits(next[lengths[i]]++, lengths[i]) : 0;
+  }
+}
+
+const LzTables& Lz() {
+  static const LzTables tables = [] {
+    LzTables t{};
+    uint32_t base = 3;
+    for (int c = 0; c < 28; ++c) {
+      const int extra = c < 8 ? 0 : (c - 4) / 4;
+      t.len_base[c] = static_cast<uint16_t>(base);
+      t.len_extra[c] = static_cast<uint8_t>(extra);
+      for (uint32_t l = base; l < base + (1u << extra) && l <= kMaxMatch; ++l) {
+        t.len_symbol[l] = static_cast<uint16_t>(257 + c);
+      }
+      base += 1u << extra;
+    }
+    t.len_base[28] = kMaxMatch;
+    t.len_extra[28] = 0;
+    t.len_symbol[kMaxMatch] = 285;
+
+    base = 1;
+    for (int c = 0; c < kDistSymbols; ++c) {
+      const int extra = c < 4 ? 0 : (c - 2) / 2;
+      t.dist_base[c] = static_cast<uint16_t>(base);
+      t.dist_extra[c] = static_cast<uint8_t>(extra);
+      base += 1u << extra;
+    }
+
+    for (int i = 0; i < 288; ++i) {
+      t.fixed_lit_len[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    }
+    AssignCodes(t.fixed_lit_len, 288, t.fixed_lit_code);
+    std::fill(std::begin(t.fixed_dist_len), std::end(t.fixed_dist_len), uint8_t{5});
+    AssignCodes(t.fixed_dist_len, kDistSymbols, t.fixed_dist_code);
+    return t;
+  }();
+  return tables;
+}
+
+int DistSymbol(uint32_t dist) {
+  const uint32_t d = dist - 1;
+  if (d < 4) {
+    return static_cast<int>(d);
+  }
+  const int nb = std::bit_width(d) - 1;
+  return 2 * nb + static_cast<int>((d >> (nb - 1)) & 1);
+}
+
+// Huffman depths for the nonzero frequencies; false if any exceeds `limit`.
+bool HuffmanDepths(const std::vector<uint32_t>& freq, int limit, uint8_t* lengths) {
+  struct Leaf {
+    uint32_t weight;
+    int symbol;
+  };
+  std::vector<Leaf> leaves;
+  for (int i = 0; i < static_cast<int>(freq.size()); ++i) {
+    if (freq[static_cast<size_t>(i)] != 0) {
+      leaves.push_back({freq[static_cast<size_t>(i)], i});
+    }
+  }
+  std::sort(leaves.begin(), leaves.end(), [](const Leaf& a, const Leaf& b) {
+    return a.weight != b.weight ? a.weight < b.weight : a.symbol < b.symbol;
+  });
+  const size_t n = leaves.size();
+  const size_t nodes = 2 * n - 1;
+  std::vector<uint64_t> weight(nodes, 0);
+  std::vector<size_t> parent(nodes, 0);
+  for (size_t i = 0; i < n; ++i) {
+    weight[i] = leaves[i].weight;
+  }
+  // Two-queue construction: leaves in sorted order, internal nodes in
+  // creation order (which is also nondecreasing weight).
+  size_t leaf = 0;
+  size_t internal = n;
+  auto pick = [&](size_t next) {
+    if (leaf < n && (internal >= next || weight[leaf] <= weight[internal])) {
+      return leaf++;
+    }
+    return internal++;
+  };
+  for (size_t next = n; next < nodes; ++next) {
+    const size_t a = pick(next);
+    const size_t b = pick(next);
+    weight[next] = weight[a] + weight[b];
+    parent[a] = next;
+    parent[b] = next;
+  }
+  std::vector<int> depth(nodes, 0);
+  for (size_t i = nodes - 1; i-- > 0;) {
+    depth[i] = depth[parent[i]] + 1;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (depth[i] > limit) {
+      return false;
+    }
+    lengths[leaves[i].symbol] = static_cast<uint8_t>(depth[i]);
+  }
+  return true;
+}
+
+// Length-limited code lengths. At least two symbols always get a code so the
+// emitted tree is complete.
+void BuildLengths(const uint32_t* freq, int count, int limit, uint8_t* lengths) {
+  std::fill(lengths, lengths + count, uint8_t{0});
+  std::vector<uint32_t> f(freq, freq + count);
+  int used = 0;
+  for (uint32_t v : f) {
+    used += v != 0 ? 1 : 0;
+  }
+  for (int i = 0; i < count && used < 2; ++i) {
+    if (f[static_cast<size_t>(i)] == 0) {
+      f[static_cast<size_t>(i)] = 1;
+      ++used;
+    }
+  }
+  // Flattening the distribution converges to a balanced tree, which fits
+  // every limit used here.
+  while (!HuffmanDepths(f, limit, lengths)) {
+    for (auto& v : f) {
+      if (v != 0) {
+        v = (v + 1) / 2;
+      }
+    }
+  }
+}
+
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t>* out) : out_(out) {}
+
+  void Put(uint32_t bits, int count) {
+    acc_ |= static_cast<uint64_t>(bits) << used_;
+    used_ += count;
+    while (used_ >= 8) {
+      out_->push_back(static_cast<uint8_t>(acc_));
+      acc_ >>= 8;
+      used_ -= 8;
+    }
+  }
+
+  void AlignToByte() {
+    if (used_ > 0) {
+      Put(0, 8 - used_);
+    }
+  }
+
+  void PutAlignedBytes(const uint8_t* p, size_t n) { out_->insert(out_->end(), p, p + n); }
+
+private:
+  std::vector<uint8_t>* out_;
+  uint64_t acc_ = 0;
+  int used_ = 0;
+};
+
+struct Token {
+  uint16_t value; // literal byte, or match length when dist != 0
+  uint16_t dist;
+};
+
+// LZ77 + Huffman compressor for one strip of the filtered image. Emits
+// non-final blocks and ends with a sync flush, so strips concatenate into a
+// single deflate stream.
+class StripDeflater {
+public:
+  StripDeflater(const PresetParams& params, std::vector<uint8_t>* out)
+      : params_(params), bits_(out), head_(kHashSize, -1), prev_(kWindowSize, -1) {
+    tokens_.reserve(kBlockTokens + 1);
+  }
+
+  void Run(const uint8_t* data, size_t dict_start, size_t begin, size_t end) {
+    data_ = data;
+    base_ = dict_start;
+    end_ = end;
+    for (size_t p = dict_start; p < begin; ++p) {
+      Insert(p);
+    }
+    block_start_ = begin;
+    size_t pos = begin;
+    while (pos < end) {
+      uint32_t dist = 0;
+      int len = FindMatch(pos, &dist);
+      Insert(pos);
+      while (len > 0 && len < params_.lazy_below && pos + 1 < end) {
+        uint32_t next_dist = 0;
+        const int next_len = FindMatch(pos + 1, &next_dist);
+        if (next_len <= len) {
+          break;
+        }
+        Literal(data_[pos]);
+        ++pos;
+        Insert(pos);
+        len = next_len;
+        dist = next_dist;
+      }
+      if (len >= kMinMatch) {
+        Match(len, dist);
+        if (len <= params_.max_insert) {
+          for (int k = 1; k < len; ++k) {
+            Insert(pos + static_cast<size_t>(k));
+          }
+        }
+        pos += static_cast<size_t>(len);
+      } else {
+        Literal(data_[pos]);
+        ++pos;
+      }
+      if (tokens_.size() >= kBlockTokens) {
+        FlushBlock(pos);
+      }
+    }
+    FlushBlock(end);
+
+    // Sync flush: empty stored block, byte aligned.
+    bits_.Put(0, 3);
+    bits_.AlignToByte();
+    const uint8_t marker[4] = {0x00, 0x00, 0xFF, 0xFF};
+    bits_.PutAlignedBytes(marker, sizeof(marker));
+  }
+
+private:
+  static uint32_t Hash(const uint8_t* p) {
+    const uint32_t v = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                       (static_cast<uint32_t>(p[2]) << 16);
+    return (v * 2654435761u) >> (32 - kHashBits);
+  }
+
+  void Insert(size_t pos) {
+    if (pos + kMinMatch > end_) {
+      return;
+    }
+    const int32_t rel = static_cast<int32_t>(pos - base_);
+    int32_t& head = head_[Hash(data_ + pos)];
+    prev_[static_cast<size_t>(rel) & kWindowMask] = head;
+    head = rel;
+  }
+
+  static int MatchLength(const uint8_t* a, const uint8_t* b, int max_len) {
+    int n = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+      while (n + 8 <= max_len) {
+        uint64_t x = 0;
+        uint64_t y = 0;
+        std::memcpy(&x, a + n, 8);
+        std::memcpy(&y, b + n, 8);
+        if (x != y) {
+          return n + std::countr_zero(x ^ y) / 8;
+        }
+        n += 8;
+      }
+    }
+    while (n < max_len && a[n] == b[n]) {
+      ++n;
+    }
+    return n;
+  }
+
+  int FindMatch(size_t pos, uint32_t* dist) {
+    const int max_len = static_cast<int>(std::min<size_t>(kMaxMatch, end_ - pos));
+    if (max_len < kMinMatch) {
+      return 0;
+    }
+    const uint8_t* cur = data_ + pos;
+    const int32_t rel = static_cast<int32_t>(pos - base_);
+    int32_t cand = head_[Hash(cur)];
+    int best = kMinMatch - 1;
+    int chain = params_.max_chain;
+    while (cand >= 0 && chain-- > 0) {
+      const uint32_t distance = static_cast<uint32_t>(rel - cand);
+      if (distance > kWindowSize) {
+        break;
+      }
+      const uint8_t* m = data_ + base_ + static_cast<size_t>(cand);
+      if (m[best] == cur[best] && m[0] == cur[0] && m[1] == cur[1]) {
+        const int len = MatchLength(m, cur, max_len);
+        if (len > best) {
+          best = len;
+          *dist = distance;
+          if (len >= params_.nice_length || len == max_len) {
+            break;
+          }
+        }
+      }
+      const int32_t next = prev_[static_cast<size_t>(cand) & kWindowMask];
+      if (next >= cand) {
+        break; // slot was reused by a newer position
+      }
+      cand = next;
+    }
+    return best >= kMinMatch ? best : 0;
+  }
+
+  void Literal(uint8_t byte) {
+    tokens_.push_back({byte, 0});
+    ++lit_freq_[byte];
+  }
+
+  void Match(int len, uint32_t dist) {
+    tokens_.push_back({static_cast<uint16_t>(len), static_cast<uint16_t>(dist)});
+    ++lit_freq_[Lz().len_symbol[len]];
+    ++dist_freq_[DistSymbol(dist)];
+  }
+
+  uint64_t DataBits(const uint8_t* lit_len, const uint8_t* dist_len) const {
+    const LzTables& t = Lz();
+    uint64_t bits = 0;
+    for (int s = 0; s < kLitLenSymbols; ++s) {
+      uint64_t per = lit_len[s];
+      if (s > 256) {
+        per += t.len_extra[s - 257];
+      }
+      bits += static_cast<uint64_t>(lit_freq_[s]) * per;
+    }
+    for (int s = 0; s < kDistSymbols; ++s) {
+      bits += static_cast<uint64_t>(dist_freq_[s]) * (dist_len[s] + t.dist_extra[s]);
+    }
+    return bits;
+  }
+
+  void PutTokens(const uint8_t* lit_len, const uint16_t* lit_code, const uint8_t* dist_len,
+                 const uint16_t* dist_code) {
+    const LzTables& t = Lz();
+    for (const Token& tok : tokens_) {
+      if (tok.dist == 0) {
+        bits_.Put(lit_code[tok.value], lit_len[tok.value]);
+        continue;
+      }
+      const int sym = t.len_symbol[tok.value];
+      bits_.Put(lit_code[sym], lit_len[sym]);
+      const int lc = sym - 257;
+      if (t.len_extra[lc] != 0) {
+        bits_.Put(tok.value - t.len_base[lc], t.len_extra[lc]);
+      }
+      const int ds = DistSymbol(tok.dist);
+      bits_.Put(dist_code[ds], dist_len[ds]);
+      if (t.dist_extra[ds] != 0) {
+        bits_.Put(tok.dist - t.dist_base[ds], t.dist_extra[ds]);
+      }
+    }
+    bits_.Put(lit_code[256], lit_len[256]);
+  }
+
+  // Emits the pending tokens, covering input [block_start_, raw_end), as the
+  // cheapest of a dynamic, fixed or stored block.
+  void FlushBlock(size_t raw_end) {
+    const size_t raw_len = raw_end - block_start_;
+    if (tokens_.empty() && raw_len == 0) {
+      return;
+    }
+    lit_freq_[256] = 1;
+
+    uint8_t lit_len[kLitLenSymbols];
+    uint8_t dist_len[kDistSymbols];
+    BuildLengths(lit_freq_, kLitLenSymbols, 15, lit_len);
+    BuildLengths(dist_freq_, kDistSymbols, 15, dist_len);
+    int hlit = kLitLenSymbols;
+    while (hlit > 257 && lit_len[hlit - 1] == 0) {
+      --hlit;
+    }
+    int hdist = kDistSymbols;
+    while (hdist > 1 && dist_len[hdist - 1] == 0) {
+      --hdist;
+    }
+
+    // Run-length code the two length tables as one sequence.
+    uint8_t all[kLitLenSymbols + kDistSymbols];
+    std::memcpy(all, lit_len, static_cast<size_t>(hlit));
+    std::memcpy(all + hlit, dist_len, static_cast<size_t>(hdist));
+    const int total = hlit + hdist;
+    std::vector<Token> rle; // value = code length symbol, dist = extra bits value
+    rle.reserve(static_cast<size_t>(total));
+    for (int i = 0; i < total;) {
+      const uint8_t v = all[i];
+      int run = 1;
+      while (i + run < total && all[i + run] == v) {
+        ++run;
+      }
+      i += run;
+      if (v == 0) {
+        while (run >= 11) {
+          const int r = std::min(run, 138);
+          rle.push_back({18, static_cast<uint16_t>(r - 11)});
+          run -= r;
+        }
+        if (run >= 3) {
+          rle.push_back({17, static_cast<uint16_t>(run - 3)});
+          run = 0;
+        }
+      } else {
+        rle.push_back({v, 0});
+        --run;
+        while (run >= 3) {
+          const int r = std::min(run, 6);
+          rle.push_back({16, static_cast<uint16_t>(r - 3)});
+          run -= r;
+        }
+      }
+      for (; run > 0; --run) {
+        rle.push_back({v, 0});
+      }
+    }
+    uint32_t cl_freq[kCodeLenSymbols] = {};
+    for (const Token& r : rle) {
+      ++cl_freq[r.value];
+    }
+    uint8_t cl_len[kCodeLenSymbols];
+    BuildLengths(cl_freq, kCodeLenSymbols, 7, cl_len);
+    int hclen = kCodeLenSymbols;
+    while (hclen > 4 && cl_len[kCodeLenOrder[hclen - 1]] == 0) {
+      --hclen;
+    }
+
+    const uint8_t kRleExtra[3] = {2, 3, 7};
+    uint64_t dynamic_bits = 3 + 14 + 3 * static_cast<uint64_t>(hclen);
+    for (const Token& r : rle) {
+      dynamic_bits += cl_len[r.value] + (r.value >= 16 ? kRleExtra[r.value - 16] : 0);
+    }
+    dynamic_bits += DataBits(lit_len, dist_len);
+    const LzTables& t = Lz();
+    const uint64_t fixed_bits = 3 + DataBits(t.fixed_lit_len, t.fixed_dist_len);
+    const uint64_t stored_chunks = std::max<uint64_t>(1, (raw_len + kMaxStoredLen - 1) / kMaxStoredLen);
+    const uint64_t stored_bits = 8 * static_cast<uint64_t>(raw_len) + stored_chunks * (3 + 7 + 32);
+
+    if (stored_bits < dynamic_bits && stored_bits < fixed_bits) {
+      const uint8_t* raw = data_ + block_start_;
+      size_t left = raw_len;
+      do {
+        const size_t n = std::min(left, kMaxStoredLen);
+        bits_.Put(0, 3);
+        bits_.AlignToByte();
+        const uint8_t header[4] = {static_cast<uint8_t>(n), static_cast<uint8_t>(n >> 8),
+                                   static_cast<uint8_t>(~n), static_cast<uint8_t>(~n >> 8)};
+        bits_.PutAlignedBytes(header, sizeof(header));
+        bits_.PutAlignedBytes(raw, n);
+        raw += n;
+        left -= n;
+      } while (left > 0);
+    } else if (fixed_bits <= dynamic_bits) {
+      bits_.Put(0, 1);
+      bits_.Put(1, 2);
+      PutTokens(t.fixed_lit_len, t.fixed_lit_code, t.fixed_dist_len, t.fixed_dist_code);
+    } else {
+      uint16_t lit_code[kLitLenSymbols];
+      uint16_t dist_code[kDistSymbols];
+      uint16_t cl_code[kCodeLenSymbols];
+      AssignCodes(lit_len, kLitLenSymbols, lit_code);
+      AssignCodes(dist_len, kDistSymbols, dist_code);
+      AssignCodes(cl_len, kCodeLenSymbols, cl_code);
+      bits_.Put(0, 1);
+      bits_.Put(2, 2);
+      bits_.Put(static_cast<uint32_t>(hlit - 257), 5);
+      bits_.Put(static_cast<uint32_t>(hdist - 1), 5);
+      bits_.Put(static_cast<uint32_t>(hclen - 4), 4);
+      for (int i = 0; i < hclen; ++i) {
+        bits_.Put(cl_len[kCodeLenOrder[i]], 3);
+      }
+      for (const Token& r : rle) {
+        bits_.Put(cl_code[r.value], cl_len[r.value]);
+        if (r.value >= 16) {
+          bits_.Put(r.dist, kRleExtra[r.value - 16]);
+        }
+      }
+      PutTokens(lit_len, lit_code, dist_len, dist_code);
+    }
+
+    tokens_.clear();
+    std::fill(std::begin(lit_freq_), std::end(lit_freq_), 0u);
+    std::fill(std::begin(dist_freq_), std::end(dist_freq_), 0u);
+    block_start_ = raw_end;
+  }
+
+  PresetParams params_;
+  BitWriter bits_;
+  std::vector<int32_t> head_;
+  std::vector<int32_t> prev_;
+  std::vector<Token> tokens_;
+  uint32_t lit_freq_[kLitLenSymbols] = {};
+  uint32_t dist_freq_[kDistSymbols] = {};
+  const uint8_t* data_ = nullptr;
+  size_t base_ = 0;
+  size_t end_ = 0;
+  size_t block_start_ = 0;
+};
+
+// ---- Filtering ----
+
+uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c) {
+  const int p = a + b - c;
+  const int pa = p > a ? p - a : a - p;
+  const int pb = p > b ? p - b : b - p;
+  const int pc = p > c ? p - c : c - p;
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+// Sum of the filtered bytes read as signed values: the usual heuristic for
+// picking a filter per row.
+uint64_t FilterCost(const uint8_t* p, size_t n) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const int v = static_cast<int8_t>(p[i]);
+    sum += static_cast<uint64_t>(v < 0 ? -v : v);
+  }
+  return sum;
+}
+
+// Writes the filter type byte followed by the filtered row to `out`.
+void FilterRow(const uint8_t* cur, const uint8_t* prior, size_t n, size_t bpp,
+               bool all_filters, std::vector<uint8_t>* scratch, uint8_t* out) {
+  uint8_t* sub = scratch[1].data();
+  uint8_t* up = scratch[2].data();
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t a = i >= bpp ? cur[i - bpp] : 0;
+    sub[i] = static_cast<uint8_t>(cur[i] - a);
+    up[i] = static_cast<uint8_t>(cur[i] - prior[i]);
+  }
+  const uint8_t* best = cur;
+  uint8_t best_type = 0;
+  uint64_t best_cost = FilterCost(cur, n);
+  const uint64_t sub_cost = FilterCost(sub, n);
+  if (sub_cost < best_cost) {
+    best = sub;
+    best_type = 1;
+    best_cost = sub_cost;
+  }
+  const uint64_t up_cost = FilterCost(up, n);
+  if (up_cost < best_cost) {
+    best = up;
+    best_type = 2;
+    best_cost = up_cost;
+  }
+  if (all_filters) {
+    uint8_t* avg = scratch[3].data();
+    uint8_t* paeth = scratch[4].data();
+    for (size_t i = 0; i < n; ++i) {
+      const uint8_t a = i >= bpp ? cur[i - bpp] : 0;
+      const uint8_t c = i >= bpp ? prior[i - bpp] : 0;
+      avg[i] = static_cast<uint8_t>(cur[i] - ((a + prior[i]) >> 1));
+      paeth[i] = static_cast<uint8_t>(cur[i] - Paeth(a, prior[i], c));
+    }
+    const uint64_t avg_cost = FilterCost(avg, n);
+    if (avg_cost < best_cost) {
+      best = avg;
+      best_type = 3;
+      best_cost = avg_cost;
+    }
+    if (FilterCost(paeth, n) < best_cost) {
+      best = paeth;
+      best_type = 4;
+    }
+  }
+  out[0] = best_type;
+  std::memcpy(out + 1, best, n);
+}
+
+// Copies one source row into PNG channel order (RGBA or RGB).
+void ConvertRow(const uint8_t* src, int32_t width, bool bgra, bool alpha, uint8_t* dst) {
+  const int r = bgra ? 2 : 0;
+  const int b = bgra ? 0 : 2;
+  for (int32_t x = 0; x < width; ++x, src += 4) {
+    dst[0] = src[r];
+    dst[1] = src[1];
+    dst[2] = src[b];
+    if (alpha) {
+      dst[3] = src[3];
+      dst += 4;
+    } else {
+      dst += 3;
+    }
+  }
+}
+
+void AppendU32Be(std::vector<uint8_t>* out, uint32_t v) {
+  const uint8_t bytes[4] = {static_cast<uint8_t>(v >> 24), static_cast<uint8_t>(v >> 16),
+                            static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v)};
+  out->insert(out->end(), bytes, bytes + 4);
+}
+
+struct ByteRange {
+  const uint8_t* p;
+  size_t n;
+};
+
+void AppendChunk(std::vector<uint8_t>* out, const char* type,
+                 std::initializer_list<ByteRange> parts) {
+  size_t len = 0;
+  for (const ByteRange& part : parts) {
+    len += part.n;
+  }
+  AppendU32Be(out, static_cast<uint32_t>(len));
+  const size_t crc_from = out->size();
+  out->insert(out->end(), type, type + 4);
+  for (const ByteRange& part : parts) {
+    out->insert(out->end(), part.p, part.p + part.n);
+  }
+  AppendU32Be(out, UpdateCrc32(0, out->data() + crc_from, out->size() - crc_from));
+}
+
+} // namespace
+
+const char* PngPresetName(PngPreset preset) {
+  switch (preset) {
+    case PngPreset::Fast:
+      return "fast";
+    case PngPreset::Balanced:
+      return "balanced";
+    case PngPreset::Small:
+      return "small";
+    default:
+      return "unknown";
+  }
+}
+
+bool EncodePng(const CpuBitmap& src, const PngEncodeOptions& options,
+               std::vector<uint8_t>* out, PngEncodeStats* stats) {
+  if (!out || !src.data.p || src.size_px.w <= 0 || src.size_px.h <= 0 ||
+      src.stride_bytes < src.size_px.w * 4) {
+    return false;
+  }
+  const int32_t width = src.size_px.w;
+  const int32_t height = src.size_px.h;
+  const bool bgra = src.format == PixelFormat::BGRA8;
+  const uint8_t* pixels = static_cast<const uint8_t*>(src.data.p);
+  const size_t stride = static_cast<size_t>(src.stride_bytes);
+  const PresetParams params = ParamsFor(options.preset);
+
+  try {
+    int32_t threads = options.threads;
+    if (threads <= 0) {
+      threads = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    // Row-aligned strips sized for the RGBA row; dropping alpha only shrinks them.
+    const size_t rgba_row = static_cast<size_t>(width) * 4 + 1;
+    int32_t strip_rows = options.strip_rows;
+    if (strip_rows <= 0) {
+      strip_rows = static_cast<int32_t>(
+          std::max<size_t>(16, (kTargetStripBytes + rgba_row - 1) / rgba_row));
+    }
+    const int32_t strips = (height + strip_rows - 1) / strip_rows;
+    threads = std::min(threads, strips);
+    // Strips run on the shared scheduler's workers, the caller included.
+    TaskScheduler& pool = TaskScheduler::Shared();
+    auto strip_begin = [&](int32_t i) { return i * strip_rows; };
+    auto strip_end = [&](int32_t i) { return std::min(height, (i + 1) * strip_rows); };
+
+    bool has_alpha = true;
+    if (options.drop_opaque_alpha) {
+      std::atomic<bool> translucent{false};
+      pool.ParallelFor(strips, threads, [&](int32_t i) {
+        for (int32_t y = strip_begin(i); y < strip_end(i); ++y) {
+          if (translucent.load(std::memory_order_relaxed)) {
+            return;
+          }
+          const uint8_t* row = pixels + static_cast<size_t>(y) * stride;
+          for (int32_t x = 0; x < width; ++x) {
+            if (row[static_cast<size_t>(x) * 4 + 3] != 0xFF) {
+              translucent.store(true, std::memory_order_relaxed);
+              return;
+            }
+          }
+        }
+      });
+      has_alpha = translucent.load();
+    }
+
+    const size_t bpp = has_alpha ? 4 : 3;
+    const size_t row_bytes = static_cast<size_t>(width) * bpp;
+    const size_t row_len = row_bytes + 1;
+    std::vector<uint8_t> filtered(row_len * static_cast<size_t>(height));
+
+    bool ok = pool.ParallelFor(strips, threads, [&](int32_t i) {
+      std::vector<uint8_t> prior(row_bytes, 0);
+      std::vector<uint8_t> cur(row_bytes);
+      std::vector<uint8_t> scratch[5];
+      for (auto& s : scratch) {
+        s.resize(row_bytes);
+      }
+      const int32_t y0 = strip_begin(i);
+      if (y0 > 0) {
+        ConvertRow(pixels + static_cast<size_t>(y0 - 1) * stride, width, bgra, has_alpha,
+                   prior.data());
+      }
+      for (int32_t y = y0; y < strip_end(i); ++y) {
+        ConvertRow(pixels + static_cast<size_t>(y) * stride, width, bgra, has_alpha,
+                   cur.data());
+        FilterRow(cur.data(), prior.data(), row_bytes, bpp, params.all_filters, scratch,
+                  filtered.data() + static_cast<size_t>(y) * row_len);
+        cur.swap(prior);
+      }
+    });
+    if (!ok) {
+      return false;
+    }
+
+    std::vector<std::vector<uint8_t>> packed(static_cast<size_t>(strips));
+    std::vector<uint32_t> adlers(static_cast<size_t>(strips), 1);
+    std::mutex progress_mu;
+    int32_t strips_done = 0;
+    ok = pool.ParallelFor(strips, threads, [&](int32_t i) {
+      const size_t begin = static_cast<size_t>(strip_begin(i)) * row_len;
+      const size_t end = static_cast<size_t>(strip_end(i)) * row_len;
+      const size_t dict_start = begin > kWindowSize ? begin - kWindowSize : 0;
+      std::vector<uint8_t>& dst = packed[static_cast<size_t>(i)];
+      dst.reserve((end - begin) / 4);
+      StripDeflater deflater(params, &dst);
+      deflater.Run(filtered.data(), dict_start, begin, end);
+      adlers[static_cast<size_t>(i)] = UpdateAdler(1, filtered.data() + begin, end - begin);
+      if (options.progress) {
+        std::lock_guard<std::mutex> lock(progress_mu);
+        ++strips_done;
+        options.progress(static_cast<float>(strips_done) / static_cast<float>(strips));
+      }
+    });
+    if (!ok) {
+      return false;
+    }
+
+    uint32_t adler = adlers[0];
+    for (int32_t i = 1; i < strips; ++i) {
+      const size_t len =
+          static_cast<size_t>(strip_end(i) - strip_begin(i)) * row_len;
+      adler = CombineAdler(adler, adlers[static_cast<size_t>(i)], len);
+    }
+
+    size_t total = 64;
+    for (const auto& p : packed) {
+      total += p.size() + 12;
+    }
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out->assign(signature, signature + 8);
+    out->reserve(total);
+
+    uint8_t ihdr[13] = {};
+    for (int k = 0; k < 4; ++k) {
+      ihdr[k] = static_cast<uint8_t>(static_cast<uint32_t>(width) >> (24 - 8 * k));
+      ihdr[4 + k] = static_cast<uint8_t>(static_cast<uint32_t>(height) >> (24 - 8 * k));
+    }
+    ihdr[8] = 8;                    // bit depth
+    ihdr[9] = has_alpha ? 6 : 2;    // RGBA or RGB
+    AppendChunk(out, "IHDR", {{ihdr, sizeof(ihdr)}});
+
+    // zlib header (deflate, 32K window) with FLEVEL matching the preset.
+    const uint8_t flevel = options.preset == PngPreset::Fast    ? 0x01
+                           : options.preset == PngPreset::Small ? 0xDA
+                                                                : 0x9C;
+    const uint8_t zlib_header[2] = {0x78, flevel};
+    // Final empty fixed block, then the Adler-32 of the filtered data.
+    const uint8_t trailer[6] = {0x03,
+                                0x00,
+                                static_cast<uint8_t>(adler >> 24),
+                                static_cast<uint8_t>(adler >> 16),
+                                static_cast<uint8_t>(adler >> 8),
+                                static_cast<uint8_t>(adler)};
+    for (int32_t i = 0; i < strips; ++i) {
+      const auto& p = packed[static_cast<size_t>(i)];
+      const ByteRange head = i == 0 ? ByteRange{zlib_header, 2} : ByteRange{nullptr, 0};
+      const ByteRange tail = i == strips - 1 ? ByteRange{trailer, 6} : ByteRange{nullptr, 0};
+      AppendChunk(out, "IDAT", {head, {p.data(), p.size()}, tail});
+    }
+    AppendChunk(out, "IEND", {});
+
+    if (stats) {
+      stats->strips = strips;
+      stats->threads = threads;
+      stats->has_alpha = has_alpha;
+      stats->filtered_bytes = filtered.size();
+      stats->encoded_bytes = out->size();
+    }
+    return true;
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+}
+
+} // namespace snappin
@@ -0,0 +1,50 @@
+#pragma once
+#include "Types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace snappin {
+
+// Speed/size trade-off of the built-in PNG encoder.
+enum class PngPreset {
+  Fast,     // None/Sub/Up filters, short match chains, greedy parsing.
+  Balanced, // All five filters, moderate chains, lazy matching.
+  Small,    // All five filters, long chains; slowest, smallest files.
+};
+
+struct PngEncodeOptions {
+  PngPreset preset = PngPreset::Balanced;
+  // Worker threads for filtering and deflate. 0 uses the hardware concurrency.
+  int32_t threads = 0;
+  // Rows per independently deflated strip. 0 sizes strips from the row width.
+  // The output does not depend on `threads`, only on the strip layout.
+  int32_t strip_rows = 0;
+  // Write an RGB image when every pixel is opaque.
+  bool drop_opaque_alpha = true;
+  // Called with the fraction of strips deflated so far. Calls are serialized
+  // but may come from worker threads.
+  std::function<void(float)> progress;
+};
+
+struct PngEncodeStats {
+  int32_t strips = 0;
+  int32_t threads = 0;
+  bool has_alpha = false;
+  size_t filtered_bytes = 0;
+  size_t encoded_bytes = 0;
+};
+
+// Encodes a BGRA8 or RGBA8 bitmap with any stride into a complete PNG file
+// image. Rows are filtered per row and deflated in horizontal strips on
+// worker threads; each strip's match window is primed with the preceding
+// 32 KiB, so splitting costs little ratio. Returns false on invalid input or
+// allocation failure.
+bool EncodePng(const CpuBitmap& src, const PngEncodeOptions& options,
+               std::vector<uint8_t>* out, PngEncodeStats* stats = nullptr);
+
+const char* PngPresetName(PngPreset preset);
+
+} // namespace snappin
@@ -1,4 +1,5 @@
 #include "AnnotateWindow.h"
+#include "GdiGlyphSource.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -6,8 +7,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <optional>
 
 namespace snappin {
 namespace {
@@ -34,6 +37,13 @@ const INT_PTR kCmdRedo = 5209;
 const INT_PTR kCmdCopy = 5210;
 const INT_PTR kCmdSave = 5211;
 const INT_PTR kCmdClose = 5212;
+const INT_PTR kCmdMosaic = 5213;
+const INT_PTR kCmdBlur = 5214;
+
+// Redaction strength per unit of stroke thickness: mosaic cell size and box
+// blur radius in pixels.
+const int kMosaicCellPerThickness = 4;
+const int kBlurRadiusPerThickness = 2;
 
 int ClampInt(int value, int lo, int hi) {
   if (value < lo) {
@@ -149,6 +159,26 @@ POINT SnapPoint45(const POINT& anchor, const POINT& pt) {
   return out;
 }
 
+bool IsEmptyRect(const RectPX& r) { return r.w <= 0 || r.h <= 0; }
+
+RectPX UnionRectPX(const RectPX& a, const RectPX& b) {
+  if (IsEmptyRect(a)) {
+    return b;
+  }
+  if (IsEmptyRect(b)) {
+    return a;
+  }
+  const int32_t x0 = std::min(a.x, b.x);
+  const int32_t y0 = std::min(a.y, b.y);
+  const int32_t x1 = std::max(a.x + a.w, b.x + b.w);
+  const int32_t y1 = std::max(a.y + a.h, b.y + b.h);
+  return RectPX{x0, y0, x1 - x0, y1 - y0};
+}
+
+RectPX InflateRectPX(const RectPX& r, int32_t d) {
+  return RectPX{r.x - d, r.y - d, r.w + 2 * d, r.h + 2 * d};
+}
+
 } // namespace
 
 AnnotateWindow::~AnnotateWindow() { Destroy(); }
@@ -198,30 +228,24 @@ void AnnotateWindow::Destroy() {
   visible_ = false;
   dragging_ = false;
   text_editing_ = false;
-  source_pixels_.reset();
+  ReleaseCanvas();
+  redaction_cache_.Reset(BitmapView());
+  source_pixels_ = BitmapView();
 }
 
-bool AnnotateWindow::BeginSession(const RectPX& screen_rect,
-                                  std::shared_ptr<std::vector<uint8_t>> source_pixels,
-                                  const SizePX& size_px, int32_t stride_bytes) {
-  if (!hwnd_ || !source_pixels || size_px.w <= 0 || size_px.h <= 0 ||
-      stride_bytes < size_px.w * 4) {
-    return false;
-  }
-  const size_t expected_size =
-      static_cast<size_t>(stride_bytes) * static_cast<size_t>(size_px.h);
-  if (source_pixels->size() < expected_size) {
+bool AnnotateWindow::BeginSession(const RectPX& screen_rect, BitmapView source) {
+  if (!hwnd_ || !source.valid()) {
     return false;
   }
 
+  const SizePX size_px = source.size_px();
   screen_rect_px_ = screen_rect;
   bitmap_size_px_ = size_px;
-  stride_bytes_ = stride_bytes;
-  source_pixels_ = std::move(source_pixels);
+  source_pixels_ = std::move(source);
+  redaction_cache_.Reset(source_pixels_);
   annotations_.clear();
-  history_.clear();
-  history_.push_back(annotations_);
-  history_index_ = 0;
+  history_.Clear();
+  hit_index_.Reset(size_px);
   selected_index_ = -1;
   drag_index_ = -1;
   drag_mode_ = DragMode::None;
@@ -232,8 +256,8 @@ bool AnnotateWindow::BeginSession(const RectPX& screen_rect,
   color_ = RGB(255, 80, 64);
   thickness_ = 2;
 
-  const int min_toolbar_width = kToolbarPadding * 2 + (12 * kButtonWidth) +
-                                (11 * kButtonGap);
+  const int min_toolbar_width = kToolbarPadding * 2 + (14 * kButtonWidth) +
+                                (13 * kButtonGap);
   const int window_w = std::max(size_px.w, min_toolbar_width);
   const int window_h = size_px.h + kToolbarHeight;
   RECT desired = {};
@@ -285,6 +309,8 @@ void AnnotateWindow::EndSession() {
   visible_ = false;
   dragging_ = false;
   text_editing_ = false;
+  ReleaseCanvas();
+  redaction_cache_.Reset(BitmapView());
 }
 
 bool AnnotateWindow::IsVisible() const { return visible_; }
@@ -293,6 +319,10 @@ void AnnotateWindow::SetCommandCallback(CommandCallback on_command) {
   on_command_ = std::move(on_command);
 }
 
+void AnnotateWindow::SetPencilOptions(const StrokeSimplifierOptions& options) {
+  pencil_.Reset(options);
+}
+
 LRESULT CALLBACK AnnotateWindow::WndProc(HWND hwnd, UINT msg, WPARAM wparam,
                                          LPARAM lparam) {
   AnnotateWindow* self = nullptr;
@@ -338,6 +368,12 @@ LRESULT AnnotateWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
         case kCmdText:
           SetTool(Tool::Text);
           return 0;
+        case kCmdMosaic:
+          SetTool(Tool::Mosaic);
+          return 0;
+        case kCmdBlur:
+          SetTool(Tool::Blur);
+          return 0;
         case kCmdReselect:
           EmitCommand(Command::Reselect);
           return 0;
@@ -411,18 +447,19 @@ LRESULT AnnotateWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
       const bool ctrl = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
       const bool shift = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
       if (wparam == VK_ESCAPE) {
+        const RectPX selection = SelectionBounds();
         if (text_editing_) {
           text_editing_ = false;
           selected_index_ = -1;
           text_edit_index_ = -1;
-          Invalidate();
+          Invalidate(selection);
           return 0;
         }
         if (selected_index_ >= 0) {
           selected_index_ = -1;
           text_editing_ = false;
           text_edit_index_ = -1;
-          Invalidate();
+          Invalidate(selection);
           return 0;
         }
         EmitCommand(Command::Close);
@@ -464,6 +501,14 @@ LRESULT AnnotateWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
         SetTool(Tool::Pencil);
         return 0;
       }
+      if (shift && wparam == '6') {
+        SetTool(Tool::Mosaic);
+        return 0;
+      }
+      if (shift && wparam == '7') {
+        SetTool(Tool::Blur);
+        return 0;
+      }
       if (shift && wparam == '8') {
         SetTool(Tool::Text);
         return 0;
@@ -500,25 +545,30 @@ LRESULT AnnotateWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
           text_edit_index_ >= static_cast<int>(annotations_.size())) {
         break;
       }
-      Annotation& ann = annotations_[static_cast<size_t>(text_edit_index_)];
+      const size_t index = static_cast<size_t>(text_edit_index_);
+      Annotation& ann = annotations_[index];
+      const RectPX painted = PaintBounds(ann);
       if (wparam == VK_RETURN) {
         text_editing_ = false;
-        PushHistory();
-        Invalidate();
+        Invalidate(painted);
         return 0;
       }
       if (wparam == VK_BACK) {
         if (!ann.text.empty()) {
+          Annotation before = ann;
           ann.text.pop_back();
-          PushHistory();
-          Invalidate();
+          history_.RecordReplace(index, std::move(before), text_session_);
+          IndexUpdated(index);
+          Invalidate(UnionRectPX(painted, PaintBounds(ann)));
         }
         return 0;
       }
       if (wparam >= 32) {
+        Annotation before = ann;
         ann.text.push_back(static_cast<wchar_t>(wparam));
-        PushHistory();
-        Invalidate();
+        history_.RecordReplace(index, std::move(before), text_session_);
+        IndexUpdated(index);
+        Invalidate(UnionRectPX(painted, PaintBounds(ann)));
       }
       return 0;
     }
@@ -528,66 +578,54 @@ LRESULT AnnotateWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
       if (hdc) {
         RECT rc = {};
         GetClientRect(hwnd_, &rc);
-        const int w = rc.right - rc.left;
-        const int h = rc.bottom - rc.top;
-        HDC mem_dc = CreateCompatibleDC(hdc);
-        HBITMAP mem_bmp = nullptr;
-        HGDIOBJ old_bmp = nullptr;
-        if (mem_dc && w > 0 && h > 0) {
-          mem_bmp = CreateCompatibleBitmap(hdc, w, h);
-          if (mem_bmp) {
-            old_bmp = SelectObject(mem_dc, mem_bmp);
-          }
+        const RECT canvas = CanvasRectClient();
+        const bool have_canvas = source_pixels_.valid() && EnsureCanvas();
+
+        // Background and toolbar are flat fills; paint them around the canvas
+        // so the canvas pixels are written exactly once, by the blit below.
+        const int saved = SaveDC(hdc);
+        if (have_canvas) {
+          ExcludeClipRect(hdc, canvas.left, canvas.top, canvas.right, canvas.bottom);
         }
-        HDC draw_dc = (mem_dc && mem_bmp) ? mem_dc : hdc;
-
         HBRUSH bg = CreateSolidBrush(RGB(24, 24, 24));
-        FillRect(draw_dc, &rc, bg);
+        FillRect(hdc, &rc, bg);
         DeleteObject(bg);
-
         RECT toolbar = rc;
         toolbar.bottom = std::min(rc.bottom, static_cast<LONG>(kToolbarHeight));
         HBRUSH tb_bg = CreateSolidBrush(RGB(38, 38, 38));
-        FillRect(draw_dc, &toolbar, tb_bg);
+        FillRect(hdc, &toolbar, tb_bg);
         DeleteObject(tb_bg);
+        RestoreDC(hdc, saved);
+
+        RECT dirty = {};
+        if (have_canvas && IntersectRect(&dirty, &ps.rcPaint, &canvas)) {
+          // Recompose only the invalidated part of the canvas: source pixels,
+          // then annotations, selection handles and caret on top.
+          const RectPX clip{dirty.left - canvas.left, dirty.top - canvas.top,
+                            dirty.right - dirty.left, dirty.bottom - dirty.top};
+          uint8_t* dst = static_cast<uint8_t*>(canvas_pixels_.data.p);
+          for (int y = clip.y; y < clip.y + clip.h; ++y) {
+            std::memcpy(dst + static_cast<size_t>(y) * canvas_pixels_.stride_bytes +
+                            static_cast<size_t>(clip.x) * 4,
+                        source_pixels_.row(y) + static_cast<size_t>(clip.x) * 4,
+                        static_cast<size_t>(clip.w) * 4);
+          }
+          Annotation preview;
+          const bool has_preview = PreviewAnnotation(&preview);
+          RenderAnnotations(canvas_pixels_, clip, has_preview ? &preview : nullptr, 1);
+
+          const int canvas_saved = SaveDC(canvas_dc_);
+          IntersectClipRect(canvas_dc_, clip.x, clip.y, clip.x + clip.w, clip.y + clip.h);
+          if (selected_index_ >= 0 &&
+              selected_index_ < static_cast<int>(annotations_.size())) {
+            DrawSelectionHandles(canvas_dc_,
+                                 annotations_[static_cast<size_t>(selected_index_)]);
+          }
+          DrawTextCaret(canvas_dc_);
+          RestoreDC(canvas_dc_, canvas_saved);
 
-        RECT canvas = CanvasRectClient();
-        if (source_pixels_ && !source_pixels_->empty() && bitmap_size_px_.w > 0 &&
-            bitmap_size_px_.h > 0) {
-          BITMAPINFO bmi = {};
-          bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-          bmi.bmiHeader.biWidth = bitmap_size_px_.w;
-          bmi.bmiHeader.biHeight = -bitmap_size_px_.h;
-          bmi.bmiHeader.biPlanes = 1;
-          bmi.bmiHeader.biBitCount = 32;
-          bmi.bmiHeader.biCompression = BI_RGB;
-          StretchDIBits(draw_dc, canvas.left, canvas.top, bitmap_size_px_.w,
-                        bitmap_size_px_.h, 0, 0, bitmap_size_px_.w,
-                        bitmap_size_px_.h, source_pixels_->data(), &bmi,
-                        DIB_RGB_COLORS, SRCCOPY);
-        }
-
-        int saved = SaveDC(draw_dc);
-        SetViewportOrgEx(draw_dc, canvas.left, canvas.top, nullptr);
-        for (size_t i = 0; i < annotations_.size(); ++i) {
-          DrawAnnotation(draw_dc, annotations_[i],
-                         selected_index_ == static_cast<int>(i));
-        }
-        DrawOverlay(draw_dc);
-        if (selected_index_ >= 0 &&
-            selected_index_ < static_cast<int>(annotations_.size())) {
-          DrawSelectionHandles(draw_dc,
-                               annotations_[static_cast<size_t>(selected_index_)]);
-        }
-        RestoreDC(draw_dc, saved);
-
-        if (draw_dc != hdc) {
-          BitBlt(hdc, 0, 0, w, h, draw_dc, 0, 0, SRCCOPY);
-          SelectObject(mem_dc, old_bmp);
-          DeleteObject(mem_bmp);
-          DeleteDC(mem_dc);
-        } else if (mem_dc) {
-          DeleteDC(mem_dc);
+          BitBlt(hdc, dirty.left, dirty.top, clip.w, clip.h, canvas_dc_, clip.x, clip.y,
+                 SRCCOPY);
         }
       }
       EndPaint(hwnd_, &ps);
@@ -629,6 +667,13 @@ void AnnotateWindow::EnsureControls() {
   btn_text_ = CreateWindowW(L"BUTTON", L"Text", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
                             0, 0, kButtonWidth, kButtonHeight, hwnd_,
                             reinterpret_cast<HMENU>(kCmdText), instance_, nullptr);
+  btn_mosaic_ = CreateWindowW(
+      L"BUTTON", L"Mosaic", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 0, 0,
+      kButtonWidth, kButtonHeight, hwnd_, reinterpret_cast<HMENU>(kCmdMosaic),
+      instance_, nullptr);
+  btn_blur_ = CreateWindowW(L"BUTTON", L"Blur", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+                            0, 0, kButtonWidth, kButtonHeight, hwnd_,
+                            reinterpret_cast<HMENU>(kCmdBlur), instance_, nullptr);
   btn_reselect_ = CreateWindowW(
       L"BUTTON", L"Range", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 0, 0,
       kButtonWidth, kButtonHeight, hwnd_, reinterpret_cast<HMENU>(kCmdReselect),
@@ -662,8 +707,8 @@ void AnnotateWindow::LayoutControls() {
   GetClientRect(hwnd_, &rc);
 
   int x_left = kToolbarPadding;
-  HWND left_buttons[] = {btn_select_, btn_rect_, btn_line_, btn_arrow_,
-                         btn_pencil_, btn_text_, btn_reselect_};
+  HWND left_buttons[] = {btn_select_, btn_rect_,   btn_line_, btn_arrow_, btn_pencil_,
+                         btn_text_,   btn_mosaic_, btn_blur_, btn_reselect_};
   for (HWND btn : left_buttons) {
     if (btn) {
       SetWindowPos(btn, nullptr, x_left, y, kButtonWidth, kButtonHeight,
@@ -693,6 +738,8 @@ void AnnotateWindow::UpdateToolButtons() {
   SetWindowTextW(btn_arrow_, tool_ == Tool::Arrow ? L"[Arrow]" : L"Arrow");
   SetWindowTextW(btn_pencil_, tool_ == Tool::Pencil ? L"[Pencil]" : L"Pencil");
   SetWindowTextW(btn_text_, tool_ == Tool::Text ? L"[Text]" : L"Text");
+  SetWindowTextW(btn_mosaic_, tool_ == Tool::Mosaic ? L"[Mosaic]" : L"Mosaic");
+  SetWindowTextW(btn_blur_, tool_ == Tool::Blur ? L"[Blur]" : L"Blur");
 }
 
 void AnnotateWindow::SetTool(Tool tool) {
@@ -713,6 +760,20 @@ void AnnotateWindow::Invalidate() {
   InvalidateRect(hwnd_, nullptr, FALSE);
 }
 
+void AnnotateWindow::Invalidate(const RectPX& canvas_rect) {
+  if (!hwnd_ || IsEmptyRect(canvas_rect)) {
+    return;
+  }
+  const RECT canvas = CanvasRectClient();
+  const RECT rect = {canvas.left + canvas_rect.x, canvas.top + canvas_rect.y,
+                     canvas.left + canvas_rect.x + canvas_rect.w,
+                     canvas.top + canvas_rect.y + canvas_rect.h};
+  RECT dirty = {};
+  if (IntersectRect(&dirty, &rect, &canvas)) {
+    InvalidateRect(hwnd_, &dirty, FALSE);
+  }
+}
+
 RECT AnnotateWindow::CanvasRectClient() const {
   RECT rc = {};
   rc.left = 0;
@@ -748,6 +809,8 @@ void AnnotateWindow::BeginDrag(POINT canvas_pt) {
     SetFocus(hwnd_);
   }
   SetCapture(hwnd_);
+  // Repaints the selection as it was and as it ends up.
+  const RectPX selection_before = SelectionBounds();
   dragging_ = true;
   drag_start_ = canvas_pt;
   drag_current_ = canvas_pt;
@@ -771,7 +834,7 @@ void AnnotateWindow::BeginDrag(POINT canvas_pt) {
       drag_mode_ = DragMode::MoveText;
       text_editing_ = false;
       text_edit_index_ = -1;
-      Invalidate();
+      Invalidate(UnionRectPX(selection_before, SelectionBounds()));
       return;
     }
     Annotation text;
@@ -784,12 +847,13 @@ void AnnotateWindow::BeginDrag(POINT canvas_pt) {
     selected_index_ = static_cast<int>(annotations_.size() - 1);
     text_editing_ = true;
     text_edit_index_ = selected_index_;
-    PushHistory();
+    history_.RecordAdd(annotations_.size() - 1, ++text_session_);
+    IndexInserted(annotations_.size() - 1);
     dragging_ = false;
     drag_mode_ = DragMode::None;
     ReleaseCapture();
     SetFocus(hwnd_);
-    Invalidate();
+    Invalidate(UnionRectPX(selection_before, SelectionBounds()));
     return;
   }
 
@@ -800,7 +864,7 @@ void AnnotateWindow::BeginDrag(POINT canvas_pt) {
     drag_index_ = hit_index;
     drag_seed_ = annotations_[hit_index];
     drag_mode_ = hit_mode;
-    Invalidate();
+    Invalidate(UnionRectPX(selection_before, SelectionBounds()));
     return;
   }
 
@@ -815,6 +879,14 @@ void AnnotateWindow::BeginDrag(POINT canvas_pt) {
       drag_mode_ = DragMode::CreateRect;
       drag_seed_.type = AnnotationType::Rect;
       break;
+    case Tool::Mosaic:
+      drag_mode_ = DragMode::CreateRect;
+      drag_seed_.type = AnnotationType::Mosaic;
+      break;
+    case Tool::Blur:
+      drag_mode_ = DragMode::CreateRect;
+      drag_seed_.type = AnnotationType::Blur;
+      break;
     case Tool::Line:
       drag_mode_ = DragMode::CreateLine;
       drag_seed_.type = AnnotationType::Line;
@@ -827,7 +899,9 @@ void AnnotateWindow::BeginDrag(POINT canvas_pt) {
       drag_mode_ = DragMode::CreatePencil;
       drag_seed_.type = AnnotationType::Pencil;
       drag_seed_.points.clear();
-      drag_seed_.points.push_back(canvas_pt);
+      pencil_.Reset();
+      pencil_synced_ = 0;
+      AddPencilSample(canvas_pt);
       break;
     case Tool::Select:
       drag_mode_ = DragMode::None;
@@ -837,7 +911,19 @@ void AnnotateWindow::BeginDrag(POINT canvas_pt) {
     case Tool::Text:
       break;
   }
-  Invalidate();
+  Invalidate(UnionRectPX(selection_before, DragBounds()));
+}
+
+void AnnotateWindow::AddPencilSample(POINT canvas_pt) {
+  pencil_.Add(PointF{static_cast<float>(canvas_pt.x), static_cast<float>(canvas_pt.y)});
+  // Only the tail after the last final vertex can change.
+  const std::vector<PointF>& kept = pencil_.points();
+  drag_seed_.points.resize(pencil_synced_);
+  for (size_t i = pencil_synced_; i < kept.size(); ++i) {
+    drag_seed_.points.push_back(POINT{static_cast<LONG>(std::lround(kept[i].x)),
+                                      static_cast<LONG>(std::lround(kept[i].y))});
+  }
+  pencil_synced_ = pencil_.committed();
 }
 
 void AnnotateWindow::UpdateDrag(POINT canvas_pt) {
@@ -859,14 +945,18 @@ void AnnotateWindow::UpdateDrag(POINT canvas_pt) {
       adjusted = SnapPoint45(drag_seed_.p1, canvas_pt);
     }
   }
-  drag_current_ = adjusted;
   if (drag_mode_ == DragMode::CreatePencil) {
-    if (drag_seed_.points.empty() || !PointsEqual(drag_seed_.points.back(), adjusted)) {
-      drag_seed_.points.push_back(adjusted);
-    }
-    Invalidate();
+    // Points before pencil_synced_ are final, but the join at the last of
+    // them still follows the tail, so repaint from the segment before it.
+    const size_t first = pencil_synced_ >= 2 ? pencil_synced_ - 2 : 0;
+    const RectPX before = PencilTailBounds(first);
+    drag_current_ = adjusted;
+    AddPencilSample(adjusted);
+    Invalidate(UnionRectPX(before, PencilTailBounds(first)));
     return;
   }
+  const RectPX before = DragBounds();
+  drag_current_ = adjusted;
   if (drag_index_ >= 0 && drag_index_ < static_cast<int>(annotations_.size())) {
     Annotation& ann = annotations_[static_cast<size_t>(drag_index_)];
     const int dx = adjusted.x - drag_start_.x;
@@ -917,13 +1007,14 @@ void AnnotateWindow::UpdateDrag(POINT canvas_pt) {
         break;
     }
   }
-  Invalidate();
+  Invalidate(UnionRectPX(before, DragBounds()));
 }
 
 void AnnotateWindow::EndDrag(POINT canvas_pt) {
   if (!dragging_) {
     return;
   }
+  const RectPX before = UnionRectPX(DragBounds(), SelectionBounds());
   ReleaseCapture();
   dragging_ = false;
   POINT adjusted = canvas_pt;
@@ -940,7 +1031,6 @@ void AnnotateWindow::EndDrag(POINT canvas_pt) {
     }
   }
   drag_current_ = adjusted;
-  bool changed = false;
 
   switch (drag_mode_) {
     case DragMode::CreateRect: {
@@ -953,7 +1043,8 @@ void AnnotateWindow::EndDrag(POINT canvas_pt) {
         ann.p2.y = r.y + r.h;
         annotations_.push_back(std::move(ann));
         selected_index_ = static_cast<int>(annotations_.size() - 1);
-        changed = true;
+        history_.RecordAdd(annotations_.size() - 1);
+        IndexInserted(annotations_.size() - 1);
       }
       break;
     }
@@ -966,7 +1057,8 @@ void AnnotateWindow::EndDrag(POINT canvas_pt) {
         ann.p2 = drag_current_;
         annotations_.push_back(std::move(ann));
         selected_index_ = static_cast<int>(annotations_.size() - 1);
-        changed = true;
+        history_.RecordAdd(annotations_.size() - 1);
+        IndexInserted(annotations_.size() - 1);
       }
       break;
     }
@@ -974,7 +1066,8 @@ void AnnotateWindow::EndDrag(POINT canvas_pt) {
       if (drag_seed_.points.size() > 1) {
         annotations_.push_back(std::move(drag_seed_));
         selected_index_ = static_cast<int>(annotations_.size() - 1);
-        changed = true;
+        history_.RecordAdd(annotations_.size() - 1);
+        IndexInserted(annotations_.size() - 1);
       }
       break;
     case DragMode::MoveRect:
@@ -987,107 +1080,173 @@ void AnnotateWindow::EndDrag(POINT canvas_pt) {
     case DragMode::MoveLineEnd:
     case DragMode::MoveText:
       if (drag_index_ >= 0 && drag_index_ < static_cast<int>(annotations_.size())) {
-        const Annotation& current = annotations_[static_cast<size_t>(drag_index_)];
-        changed = !PointsEqual(current.p1, drag_seed_.p1) ||
-                  !PointsEqual(current.p2, drag_seed_.p2);
+        const size_t index = static_cast<size_t>(drag_index_);
+        const Annotation& current = annotations_[index];
+        // drag_seed_ holds the annotation as it was when the drag began.
+        if (!PointsEqual(current.p1, drag_seed_.p1) ||
+            !PointsEqual(current.p2, drag_seed_.p2)) {
+          history_.RecordReplace(index, std::move(drag_seed_));
+        }
+        IndexUpdated(index);
       }
       break;
     default:
       break;
   }
 
-  if (changed) {
-    PushHistory();
-  }
   drag_mode_ = DragMode::None;
   drag_index_ = -1;
-  Invalidate();
+  Invalidate(UnionRectPX(before, SelectionBounds()));
 }
 
 int AnnotateWindow::HitTestAnnotation(POINT canvas_pt, DragMode* mode_out) const {
   if (mode_out) {
     *mode_out = DragMode::None;
   }
-  const double tol_sq = static_cast<double>(kHitTolerance * kHitTolerance);
-  for (int i = static_cast<int>(annotations_.size()) - 1; i >= 0; --i) {
-    const Annotation& ann = annotations_[static_cast<size_t>(i)];
+  // The index narrows the search to annotations whose hit region contains the
+  // point, topmost first; the exact test below picks the handle.
+  hit_index_.HitsAt(PointPX{canvas_pt.x, canvas_pt.y}, &hit_candidates_);
+  for (size_t index : hit_candidates_) {
+    if (index >= annotations_.size()) {
+      continue;
+    }
+    const Annotation& ann = annotations_[index];
     if (!AnnotationTypeAllowedByTool(ann.type) || !AnnotationEditable(ann.type)) {
       continue;
     }
-    if (ann.type == AnnotationType::Rect) {
-      RectPX r = NormalizeRect(RectFromPoints(ann.p1, ann.p2));
-      POINT tl = {r.x, r.y};
-      POINT tr = {r.x + r.w, r.y};
-      POINT bl = {r.x, r.y + r.h};
-      POINT br = {r.x + r.w, r.y + r.h};
-      if (DistanceSq(canvas_pt, tl) <= tol_sq) {
-        if (mode_out) {
-          *mode_out = DragMode::ResizeRectTL;
-        }
-        return i;
+    if (HitTestOne(ann, canvas_pt, mode_out)) {
+      return static_cast<int>(index);
+    }
+  }
+  return -1;
+}
+
+bool AnnotateWindow::HitTestOne(const Annotation& ann, POINT canvas_pt,
+                                DragMode* mode_out) const {
+  const double tol_sq = static_cast<double>(kHitTolerance * kHitTolerance);
+  if (IsBoxType(ann.type)) {
+    RectPX r = NormalizeRect(RectFromPoints(ann.p1, ann.p2));
+    POINT tl = {r.x, r.y};
+    POINT tr = {r.x + r.w, r.y};
+    POINT bl = {r.x, r.y + r.h};
+    POINT br = {r.x + r.w, r.y + r.h};
+    if (DistanceSq(canvas_pt, tl) <= tol_sq) {
+      if (mode_out) {
+        *mode_out = DragMode::ResizeRectTL;
       }
-      if (DistanceSq(canvas_pt, tr) <= tol_sq) {
-        if (mode_out) {
-          *mode_out = DragMode::ResizeRectTR;
-        }
-        return i;
+      return true;
+    }
+    if (DistanceSq(canvas_pt, tr) <= tol_sq) {
+      if (mode_out) {
+        *mode_out = DragMode::ResizeRectTR;
       }
-      if (DistanceSq(canvas_pt, bl) <= tol_sq) {
-        if (mode_out) {
-          *mode_out = DragMode::ResizeRectBL;
-        }
-        return i;
+      return true;
+    }
+    if (DistanceSq(canvas_pt, bl) <= tol_sq) {
+      if (mode_out) {
+        *mode_out = DragMode::ResizeRectBL;
       }
-      if (DistanceSq(canvas_pt, br) <= tol_sq) {
-        if (mode_out) {
-          *mode_out = DragMode::ResizeRectBR;
-        }
-        return i;
+      return true;
+    }
+    if (DistanceSq(canvas_pt, br) <= tol_sq) {
+      if (mode_out) {
+        *mode_out = DragMode::ResizeRectBR;
       }
-      if (canvas_pt.x >= r.x && canvas_pt.y >= r.y && canvas_pt.x <= r.x + r.w &&
-          canvas_pt.y <= r.y + r.h) {
-        if (mode_out) {
-          *mode_out = DragMode::MoveRect;
-        }
-        return i;
+      return true;
+    }
+    if (canvas_pt.x >= r.x && canvas_pt.y >= r.y && canvas_pt.x <= r.x + r.w &&
+        canvas_pt.y <= r.y + r.h) {
+      if (mode_out) {
+        *mode_out = DragMode::MoveRect;
       }
-      continue;
+      return true;
     }
-    if (ann.type == AnnotationType::Line || ann.type == AnnotationType::Arrow) {
-      if (DistanceSq(canvas_pt, ann.p1) <= tol_sq) {
-        if (mode_out) {
-          *mode_out = DragMode::MoveLineStart;
-        }
-        return i;
+    return false;
+  }
+  if (ann.type == AnnotationType::Line || ann.type == AnnotationType::Arrow) {
+    if (DistanceSq(canvas_pt, ann.p1) <= tol_sq) {
+      if (mode_out) {
+        *mode_out = DragMode::MoveLineStart;
       }
-      if (DistanceSq(canvas_pt, ann.p2) <= tol_sq) {
-        if (mode_out) {
-          *mode_out = DragMode::MoveLineEnd;
-        }
-        return i;
+      return true;
+    }
+    if (DistanceSq(canvas_pt, ann.p2) <= tol_sq) {
+      if (mode_out) {
+        *mode_out = DragMode::MoveLineEnd;
       }
-      const int seg_tol = std::max(kHitTolerance, ann.thickness + 2);
-      if (DistanceToSegmentSq(canvas_pt, ann.p1, ann.p2) <=
-          static_cast<double>(seg_tol * seg_tol)) {
-        if (mode_out) {
-          *mode_out = DragMode::MoveLine;
-        }
-        return i;
+      return true;
+    }
+    const int seg_tol = std::max(kHitTolerance, ann.thickness + 2);
+    if (DistanceToSegmentSq(canvas_pt, ann.p1, ann.p2) <=
+        static_cast<double>(seg_tol * seg_tol)) {
+      if (mode_out) {
+        *mode_out = DragMode::MoveLine;
       }
-      continue;
+      return true;
     }
-    if (ann.type == AnnotationType::Text) {
-      RectPX r = RectBoundsForAnnotation(ann);
-      if (canvas_pt.x >= r.x && canvas_pt.y >= r.y && canvas_pt.x <= r.x + r.w &&
-          canvas_pt.y <= r.y + r.h) {
-        if (mode_out) {
-          *mode_out = DragMode::MoveText;
-        }
-        return i;
+    return false;
+  }
+  if (ann.type == AnnotationType::Text) {
+    RectPX r = RectBoundsForAnnotation(ann);
+    if (canvas_pt.x >= r.x && canvas_pt.y >= r.y && canvas_pt.x <= r.x + r.w &&
+        canvas_pt.y <= r.y + r.h) {
+      if (mode_out) {
+        *mode_out = DragMode::MoveText;
       }
+      return true;
     }
   }
-  return -1;
+  return false;
+}
+
+std::vector<HitShape> AnnotateWindow::HitShapesFor(const Annotation& ann) const {
+  std::vector<HitShape> shapes;
+  if (!AnnotationEditable(ann.type)) {
+    return shapes;
+  }
+  HitShape shape;
+  switch (ann.type) {
+    case AnnotationType::Rect:
+    case AnnotationType::Mosaic:
+    case AnnotationType::Blur: {
+      // Corner handles reach kHitTolerance beyond the outline.
+      const RectPX r = NormalizeRect(RectFromPoints(ann.p1, ann.p2));
+      shape.kind = HitShape::Kind::Box;
+      shape.a = PointPX{r.x - kHitTolerance, r.y - kHitTolerance};
+      shape.b = PointPX{r.x + r.w + kHitTolerance, r.y + r.h + kHitTolerance};
+      break;
+    }
+    case AnnotationType::Line:
+    case AnnotationType::Arrow:
+      shape.kind = HitShape::Kind::Capsule;
+      shape.a = PointPX{ann.p1.x, ann.p1.y};
+      shape.b = PointPX{ann.p2.x, ann.p2.y};
+      shape.radius = std::max(kHitTolerance, ann.thickness + 2);
+      break;
+    case AnnotationType::Text: {
+      const RectPX r = RectBoundsForAnnotation(ann);
+      shape.kind = HitShape::Kind::Box;
+      shape.a = PointPX{r.x, r.y};
+      shape.b = PointPX{r.x + r.w, r.y + r.h};
+      break;
+    }
+    default:
+      return shapes;
+  }
+  shapes.push_back(shape);
+  return shapes;
+}
+
+void AnnotateWindow::IndexInserted(size_t index) {
+  if (index < annotations_.size()) {
+    hit_index_.Insert(index, HitShapesFor(annotations_[index]));
+  }
+}
+
+void AnnotateWindow::IndexUpdated(size_t index) {
+  if (index < annotations_.size()) {
+    hit_index_.Update(index, HitShapesFor(annotations_[index]));
+  }
 }
 
 bool AnnotateWindow::AnnotationTypeAllowedByTool(AnnotationType type) const {
@@ -1109,6 +1268,12 @@ bool AnnotateWindow::AnnotationTypeAllowedByTool(AnnotationType type) const {
   if (tool_ == Tool::Pencil) {
     return type == AnnotationType::Pencil;
   }
+  if (tool_ == Tool::Mosaic) {
+    return type == AnnotationType::Mosaic;
+  }
+  if (tool_ == Tool::Blur) {
+    return type == AnnotationType::Blur;
+  }
   return true;
 }
 
@@ -1116,6 +1281,11 @@ bool AnnotateWindow::AnnotationEditable(AnnotationType type) const {
   return type != AnnotationType::Pencil;
 }
 
+bool AnnotateWindow::IsBoxType(AnnotationType type) {
+  return type == AnnotationType::Rect || type == AnnotationType::Mosaic ||
+         type == AnnotationType::Blur;
+}
+
 RectPX AnnotateWindow::RectFromPoints(POINT a, POINT b) const {
   RectPX r = {};
   r.x = std::min(a.x, b.x);
@@ -1126,7 +1296,7 @@ RectPX AnnotateWindow::RectFromPoints(POINT a, POINT b) const {
 }
 
 RectPX AnnotateWindow::RectBoundsForAnnotation(const Annotation& ann) const {
-  if (ann.type == AnnotationType::Rect) {
+  if (IsBoxType(ann.type)) {
     return NormalizeRect(RectFromPoints(ann.p1, ann.p2));
   }
   if (ann.type == AnnotationType::Line || ann.type == AnnotationType::Arrow) {
@@ -1161,9 +1331,9 @@ RectPX AnnotateWindow::RectBoundsForAnnotation(const Annotation& ann) const {
   if (ann.type == AnnotationType::Text) {
     RectPX r = {};
     const int char_w = std::max(8, ann.text_size / 2);
-    const int w =
-        std::max(char_w * 2, static_cast<int>(ann.text.size()) * char_w);
-    const int h = ann.text_size + 10;
+    const auto layout = SharedGlyphCache().Layout(TextFont(ann), ann.text);
+    const int w = std::max(char_w * 2, static_cast<int>(layout->size.w));
+    const int h = std::max(ann.text_size, static_cast<int>(layout->size.h)) + 10;
     r.x = ann.p1.x;
     r.y = ann.p1.y;
     r.w = w;
@@ -1189,107 +1359,212 @@ RectPX AnnotateWindow::NormalizeRect(RectPX rect) const {
   return rect;
 }
 
-void AnnotateWindow::DrawOverlay(HDC hdc) const {
+RectPX AnnotateWindow::PaintBounds(const Annotation& ann) const {
+  RectPX out;
+  VectorShape shape;
+  if (ToVectorShape(ann, &shape)) {
+    out = ShapeBounds(shape);
+  } else if (ann.type == AnnotationType::Text) {
+    // Glyphs may overhang their advances; the caret sits 2 px past the box.
+    const auto layout =
+        SharedGlyphCache().Layout(TextFont(ann), ann.text.empty() ? L"Text" : ann.text);
+    out = UnionRectPX(RectBoundsForAnnotation(ann),
+                      RectPX{ann.p1.x, ann.p1.y, layout->size.w, layout->size.h});
+    out = InflateRectPX(out, ann.text_size / 4 + 4);
+  } else {
+    out = RectBoundsForAnnotation(ann);
+  }
+  if (AnnotationEditable(ann.type)) {
+    out = UnionRectPX(out, InflateRectPX(RectBoundsForAnnotation(ann), kHandleSize / 2 + 1));
+  }
+  return out;
+}
+
+RectPX AnnotateWindow::PaintBoundsAt(std::optional<size_t> index) const {
+  if (!index || *index >= annotations_.size()) {
+    return {};
+  }
+  return PaintBounds(annotations_[*index]);
+}
+
+RectPX AnnotateWindow::SelectionBounds() const {
+  if (selected_index_ < 0) {
+    return {};
+  }
+  return PaintBoundsAt(static_cast<size_t>(selected_index_));
+}
+
+RectPX AnnotateWindow::DragBounds() const {
+  Annotation preview;
+  if (PreviewAnnotation(&preview)) {
+    return PaintBounds(preview);
+  }
+  if (drag_index_ < 0) {
+    return {};
+  }
+  return PaintBoundsAt(static_cast<size_t>(drag_index_));
+}
+
+RectPX AnnotateWindow::PencilTailBounds(size_t first) const {
+  if (first >= drag_seed_.points.size()) {
+    return {};
+  }
+  Annotation tail;
+  tail.type = AnnotationType::Pencil;
+  tail.thickness = drag_seed_.thickness;
+  tail.points.assign(drag_seed_.points.begin() + static_cast<std::ptrdiff_t>(first),
+                     drag_seed_.points.end());
+  return PaintBounds(tail);
+}
+
+bool AnnotateWindow::PreviewAnnotation(Annotation* out) const {
   if (drag_mode_ == DragMode::CreateRect || drag_mode_ == DragMode::CreateLine ||
       drag_mode_ == DragMode::CreateArrow) {
-    Annotation preview = drag_seed_;
-    preview.p1 = drag_start_;
-    preview.p2 = drag_current_;
-    DrawAnnotation(hdc, preview, false);
-    return;
+    *out = drag_seed_;
+    out->p1 = drag_start_;
+    out->p2 = drag_current_;
+    return true;
   }
   if (drag_mode_ == DragMode::CreatePencil && drag_seed_.points.size() > 1) {
-    DrawAnnotation(hdc, drag_seed_, false);
-    return;
+    *out = drag_seed_;
+    return true;
   }
+  return false;
 }
 
-void AnnotateWindow::DrawAnnotation(HDC hdc, const Annotation& ann,
-                                    bool selected) const {
-  HPEN pen = CreatePen(PS_SOLID, std::max(1, ann.thickness), ann.color);
-  HGDIOBJ old_pen = SelectObject(hdc, pen);
-  HGDIOBJ old_brush = SelectObject(hdc, GetStockObject(HOLLOW_BRUSH));
-
+bool AnnotateWindow::ToVectorShape(const Annotation& ann, VectorShape* out) const {
+  // Annotation points address pixels; the rasterizer works in continuous
+  // coordinates, so strokes run through pixel centers as GDI pens did.
+  const auto center = [](LONG x, LONG y) {
+    return PointF{static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f};
+  };
+  out->points.clear();
   switch (ann.type) {
     case AnnotationType::Rect: {
-      RectPX r = NormalizeRect(RectFromPoints(ann.p1, ann.p2));
-      Rectangle(hdc, r.x, r.y, r.x + r.w, r.y + r.h);
+      const RectPX r = NormalizeRect(RectFromPoints(ann.p1, ann.p2));
+      out->kind = ShapeKind::Rect;
+      out->points.push_back(center(r.x, r.y));
+      out->points.push_back(center(r.x + std::max(0, r.w - 1), r.y + std::max(0, r.h - 1)));
       break;
     }
     case AnnotationType::Line:
-      MoveToEx(hdc, ann.p1.x, ann.p1.y, nullptr);
-      LineTo(hdc, ann.p2.x, ann.p2.y);
-      break;
     case AnnotationType::Arrow:
-      MoveToEx(hdc, ann.p1.x, ann.p1.y, nullptr);
-      LineTo(hdc, ann.p2.x, ann.p2.y);
-      DrawArrowHead(hdc, ann.p1, ann.p2, ann.color, ann.thickness);
+      out->kind = ann.type == AnnotationType::Line ? ShapeKind::Line : ShapeKind::Arrow;
+      out->points.push_back(center(ann.p1.x, ann.p1.y));
+      out->points.push_back(center(ann.p2.x, ann.p2.y));
       break;
     case AnnotationType::Pencil:
-      if (ann.points.size() > 1) {
-        Polyline(hdc, ann.points.data(), static_cast<int>(ann.points.size()));
+      if (ann.points.empty()) {
+        return false;
+      }
+      out->kind = ShapeKind::Pencil;
+      out->points.reserve(ann.points.size());
+      for (const POINT& p : ann.points) {
+        out->points.push_back(center(p.x, p.y));
       }
       break;
-    case AnnotationType::Text: {
-      HFONT font = CreateFontW(
-          ann.text_size, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
-          OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-          DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
-      HGDIOBJ old_font = SelectObject(hdc, font);
-      SetBkMode(hdc, TRANSPARENT);
-      SetTextColor(hdc, ann.color);
-      const std::wstring draw = ann.text.empty() ? L"Text" : ann.text;
-      TextOutW(hdc, ann.p1.x, ann.p1.y, draw.c_str(),
-               static_cast<int>(draw.size()));
-      SelectObject(hdc, old_font);
-      DeleteObject(font);
-      break;
-    }
     default:
-      break;
+      return false;
   }
+  out->stroke.width = static_cast<float>(std::max(1, ann.thickness));
+  out->stroke.color = ColorRGBA{GetRValue(ann.color), GetGValue(ann.color),
+                                GetBValue(ann.color), 255};
+  out->stroke.opacity = 1.0f;
+  out->fill = FillStyle{};
+  return true;
+}
 
-  SelectObject(hdc, old_brush);
-  SelectObject(hdc, old_pen);
-  DeleteObject(pen);
-
-  if (selected && ann.type == AnnotationType::Text && text_editing_ &&
-      selected_index_ >= 0 &&
-      annotations_[static_cast<size_t>(selected_index_)].type ==
-          AnnotationType::Text) {
-    RectPX r = RectBoundsForAnnotation(ann);
-    HPEN caret_pen = CreatePen(PS_SOLID, 1, RGB(255, 255, 255));
-    HGDIOBJ old_caret_pen = SelectObject(hdc, caret_pen);
-    MoveToEx(hdc, r.x + r.w + 2, r.y, nullptr);
-    LineTo(hdc, r.x + r.w + 2, r.y + r.h);
-    SelectObject(hdc, old_caret_pen);
-    DeleteObject(caret_pen);
+void AnnotateWindow::RenderAnnotations(const CpuBitmap& target, const RectPX& clip,
+                                       const Annotation* preview, int32_t threads) const {
+  RasterOptions options;
+  options.clip = clip;
+  options.threads = threads;
+  std::vector<VectorShape> batch;
+  // GDI may still be writing handles or the caret from the last paint.
+  GdiFlush();
+  // Consecutive shapes are rasterized in one pass, flushed before a
+  // redaction box or text so the stacking order holds.
+  const auto flush = [&]() {
+    if (batch.empty()) {
+      return;
+    }
+    RasterizeShapes(batch, target, options);
+    batch.clear();
+  };
+  const auto draw = [&](const Annotation& ann) {
+    if (ann.type == AnnotationType::Mosaic || ann.type == AnnotationType::Blur) {
+      // Replaces the box with redacted source pixels, covering whatever was
+      // drawn there before it.
+      flush();
+      const RectPX box = NormalizeRect(RectFromPoints(ann.p1, ann.p2));
+      const int32_t x0 = std::max(box.x, clip.x);
+      const int32_t y0 = std::max(box.y, clip.y);
+      const int32_t x1 = std::min(box.x + box.w, clip.x + clip.w);
+      const int32_t y1 = std::min(box.y + box.h, clip.y + clip.h);
+      if (x1 > x0 && y1 > y0) {
+        const int thickness = std::max(1, ann.thickness);
+        if (ann.type == AnnotationType::Mosaic) {
+          redaction_cache_.Render(RedactionKind::Mosaic, thickness * kMosaicCellPerThickness,
+                                  RectPX{x0, y0, x1 - x0, y1 - y0}, target);
+        } else {
+          redaction_cache_.Render(RedactionKind::Blur, thickness * kBlurRadiusPerThickness,
+                                  RectPX{x0, y0, x1 - x0, y1 - y0}, target);
+        }
+      }
+      return;
+    }
+    if (ann.type == AnnotationType::Text) {
+      flush();
+      DrawTextAnnotation(target, clip, ann);
+      return;
+    }
+    VectorShape shape;
+    if (ToVectorShape(ann, &shape)) {
+      batch.push_back(std::move(shape));
+    }
+  };
+  for (const Annotation& ann : annotations_) {
+    draw(ann);
+  }
+  if (preview) {
+    draw(*preview);
   }
+  flush();
+}
+
+FontKey AnnotateWindow::TextFont(const Annotation& ann) {
+  FontKey font;
+  font.family = L"Segoe UI";
+  font.size_px = ann.text_size;
+  return font;
+}
+
+void AnnotateWindow::DrawTextAnnotation(const CpuBitmap& target, const RectPX& clip,
+                                        const Annotation& ann) const {
+  GlyphCache& glyphs = SharedGlyphCache();
+  const FontKey font = TextFont(ann);
+  const auto layout = glyphs.Layout(font, ann.text.empty() ? L"Text" : ann.text);
+  glyphs.Draw(font, *layout, PointPX{ann.p1.x, ann.p1.y},
+              ColorRGBA{GetRValue(ann.color), GetGValue(ann.color), GetBValue(ann.color), 255},
+              target, clip);
 }
 
-void AnnotateWindow::DrawArrowHead(HDC hdc, POINT start, POINT end, COLORREF color,
-                                   int thickness) const {
-  const double dx = static_cast<double>(end.x - start.x);
-  const double dy = static_cast<double>(end.y - start.y);
-  const double len = std::sqrt(dx * dx + dy * dy);
-  if (len < 1.0) {
+void AnnotateWindow::DrawTextCaret(HDC hdc) const {
+  if (!text_editing_ || selected_index_ < 0 ||
+      selected_index_ >= static_cast<int>(annotations_.size())) {
     return;
   }
-  const double ux = dx / len;
-  const double uy = dy / len;
-  const double head_len = std::max(8.0, static_cast<double>(thickness * 4));
-  const double wing = std::max(5.0, static_cast<double>(thickness * 2));
-  POINT p0 = end;
-  POINT p1 = {static_cast<int>(std::lround(end.x - ux * head_len - uy * wing)),
-              static_cast<int>(std::lround(end.y - uy * head_len + ux * wing))};
-  POINT p2 = {static_cast<int>(std::lround(end.x - ux * head_len + uy * wing)),
-              static_cast<int>(std::lround(end.y - uy * head_len - ux * wing))};
-  POINT tri[3] = {p0, p1, p2};
-  HBRUSH brush = CreateSolidBrush(color);
-  HGDIOBJ old_brush = SelectObject(hdc, brush);
-  Polygon(hdc, tri, 3);
-  SelectObject(hdc, old_brush);
-  DeleteObject(brush);
+  const Annotation& ann = annotations_[static_cast<size_t>(selected_index_)];
+  if (ann.type != AnnotationType::Text) {
+    return;
+  }
+  RectPX r = RectBoundsForAnnotation(ann);
+  HPEN caret_pen = CreatePen(PS_SOLID, 1, RGB(255, 255, 255));
+  HGDIOBJ old_caret_pen = SelectObject(hdc, caret_pen);
+  MoveToEx(hdc, r.x + r.w + 2, r.y, nullptr);
+  LineTo(hdc, r.x + r.w + 2, r.y + r.h);
+  SelectObject(hdc, old_caret_pen);
+  DeleteObject(caret_pen);
 }
 
 void AnnotateWindow::DrawSelectionHandles(HDC hdc, const Annotation& ann) const {
@@ -1321,14 +1596,62 @@ void AnnotateWindow::DrawSelectionHandles(HDC hdc, const Annotation& ann) const
   DeleteObject(fill);
 }
 
-bool AnnotateWindow::BuildComposedPixels(
-    std::shared_ptr<std::vector<uint8_t>>* out_pixels, SizePX* out_size,
-    int32_t* out_stride) const {
-  if (!out_pixels || !out_size || !out_stride || !source_pixels_ ||
-      bitmap_size_px_.w <= 0 || bitmap_size_px_.h <= 0 ||
-      stride_bytes_ < bitmap_size_px_.w * 4) {
+bool AnnotateWindow::EnsureCanvas() {
+  if (canvas_dc_ && canvas_pixels_.size_px.w == bitmap_size_px_.w &&
+      canvas_pixels_.size_px.h == bitmap_size_px_.h) {
+    return true;
+  }
+  ReleaseCanvas();
+  if (bitmap_size_px_.w <= 0 || bitmap_size_px_.h <= 0) {
     return false;
   }
+  BITMAPINFO bmi = {};
+  bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+  bmi.bmiHeader.biWidth = bitmap_size_px_.w;
+  bmi.bmiHeader.biHeight = -bitmap_size_px_.h;
+  bmi.bmiHeader.biPlanes = 1;
+  bmi.bmiHeader.biBitCount = 32;
+  bmi.bmiHeader.biCompression = BI_RGB;
+  void* bits = nullptr;
+  canvas_bitmap_ = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+  canvas_dc_ = canvas_bitmap_ ? CreateCompatibleDC(nullptr) : nullptr;
+  if (!canvas_dc_ || !bits) {
+    ReleaseCanvas();
+    return false;
+  }
+  canvas_old_bitmap_ = SelectObject(canvas_dc_, canvas_bitmap_);
+  canvas_pixels_.format = PixelFormat::BGRA8;
+  canvas_pixels_.size_px = bitmap_size_px_;
+  canvas_pixels_.stride_bytes = bitmap_size_px_.w * 4;
+  canvas_pixels_.data.p = bits;
+  return true;
+}
+
+void AnnotateWindow::ReleaseCanvas() {
+  if (canvas_dc_) {
+    if (canvas_old_bitmap_) {
+      SelectObject(canvas_dc_, canvas_old_bitmap_);
+    }
+    DeleteDC(canvas_dc_);
+  }
+  if (canvas_bitmap_) {
+    DeleteObject(canvas_bitmap_);
+  }
+  canvas_dc_ = nullptr;
+  canvas_bitmap_ = nullptr;
+  canvas_old_bitmap_ = nullptr;
+  canvas_pixels_ = CpuBitmap{};
+}
+
+bool AnnotateWindow::BuildComposedPixels(BitmapView* out_pixels) const {
+  if (!out_pixels || !source_pixels_.valid()) {
+    return false;
+  }
+  // Nothing drawn on top: the source view is the result, no copy needed.
+  if (annotations_.empty()) {
+    *out_pixels = source_pixels_;
+    return true;
+  }
 
   const int width = bitmap_size_px_.w;
   const int height = bitmap_size_px_.h;
@@ -1353,67 +1676,68 @@ bool AnnotateWindow::BuildComposedPixels(
   }
 
   uint8_t* dst = reinterpret_cast<uint8_t*>(bits);
-  const uint8_t* src = source_pixels_->data();
   for (int y = 0; y < height; ++y) {
-    std::memcpy(dst + static_cast<size_t>(y) * stride,
-                src + static_cast<size_t>(y) * stride_bytes_,
+    std::memcpy(dst + static_cast<size_t>(y) * stride, source_pixels_.row(y),
                 static_cast<size_t>(stride));
   }
 
-  HDC mem = CreateCompatibleDC(nullptr);
-  if (!mem) {
-    DeleteObject(dib);
-    return false;
-  }
-  HGDIOBJ old = SelectObject(mem, dib);
-  for (size_t i = 0; i < annotations_.size(); ++i) {
-    DrawAnnotation(mem, annotations_[i], false);
-  }
-  SelectObject(mem, old);
-  DeleteDC(mem);
-
-  auto pixels = std::make_shared<std::vector<uint8_t>>();
-  pixels->resize(static_cast<size_t>(stride) * static_cast<size_t>(height));
-  std::memcpy(pixels->data(), bits, pixels->size());
+  CpuBitmap target;
+  target.format = PixelFormat::BGRA8;
+  target.size_px = SizePX{width, height};
+  target.stride_bytes = stride;
+  target.data.p = dst;
+  RenderAnnotations(target, RectPX{0, 0, width, height}, nullptr, 0);
+
+  // The DIB section becomes the backing buffer of the returned view, so the
+  // composed pixels are not copied out again. It is freed with the last view.
+  std::shared_ptr<const uint8_t> owner(
+      dst, [dib](const uint8_t*) { DeleteObject(dib); });
+  *out_pixels = BitmapView(std::move(owner), SizePX{width, height}, stride,
+                           PixelFormat::BGRA8);
+  return out_pixels->valid();
+}
 
-  DeleteObject(dib);
-  *out_pixels = std::move(pixels);
-  *out_size = SizePX{width, height};
-  *out_stride = stride;
-  return true;
+size_t AnnotateWindow::AnnotationHeapBytes(const Annotation& ann) {
+  return ann.points.capacity() * sizeof(POINT) + ann.text.capacity() * sizeof(wchar_t);
 }
 
-void AnnotateWindow::PushHistory() {
-  if (history_index_ + 1 < history_.size()) {
-    history_.resize(history_index_ + 1);
+void AnnotateWindow::SyncHitIndex(size_t touched, size_t count_before) {
+  if (annotations_.size() > count_before) {
+    IndexInserted(touched);
+  } else if (annotations_.size() < count_before) {
+    hit_index_.Erase(touched);
+  } else {
+    IndexUpdated(touched);
   }
-  history_.push_back(annotations_);
-  history_index_ = history_.size() - 1;
 }
 
 bool AnnotateWindow::Undo() {
-  if (history_index_ == 0 || history_.empty()) {
+  const RectPX before = UnionRectPX(SelectionBounds(), PaintBoundsAt(history_.UndoSlot()));
+  const size_t count_before = annotations_.size();
+  const std::optional<size_t> touched = history_.Undo(&annotations_);
+  if (!touched) {
     return false;
   }
-  --history_index_;
-  annotations_ = history_[history_index_];
+  SyncHitIndex(*touched, count_before);
   selected_index_ = -1;
   text_editing_ = false;
   text_edit_index_ = -1;
-  Invalidate();
+  Invalidate(UnionRectPX(before, PaintBoundsAt(touched)));
   return true;
 }
 
 bool AnnotateWindow::Redo() {
-  if (history_.empty() || history_index_ + 1 >= history_.size()) {
+  const RectPX before = UnionRectPX(SelectionBounds(), PaintBoundsAt(history_.RedoSlot()));
+  const size_t count_before = annotations_.size();
+  const std::optional<size_t> touched = history_.Redo(&annotations_);
+  if (!touched) {
     return false;
   }
-  ++history_index_;
-  annotations_ = history_[history_index_];
+  SyncHitIndex(*touched, count_before);
   selected_index_ = -1;
   text_editing_ = false;
   text_edit_index_ = -1;
-  Invalidate();
+  Invalidate(UnionRectPX(before, PaintBoundsAt(touched)));
   return true;
 }
 
@@ -1424,12 +1748,16 @@ void AnnotateWindow::DeleteSelection() {
   if (!AnnotationEditable(annotations_[static_cast<size_t>(selected_index_)].type)) {
     return;
   }
+  const size_t index = static_cast<size_t>(selected_index_);
+  const RectPX painted = SelectionBounds();
+  Annotation removed = std::move(annotations_[index]);
   annotations_.erase(annotations_.begin() + selected_index_);
+  history_.RecordRemove(index, std::move(removed));
+  hit_index_.Erase(index);
   selected_index_ = -1;
   text_editing_ = false;
   text_edit_index_ = -1;
-  PushHistory();
-  Invalidate();
+  Invalidate(painted);
 }
 
 void AnnotateWindow::ShowContextMenu(POINT screen_pt) {
@@ -1443,6 +1771,8 @@ void AnnotateWindow::ShowContextMenu(POINT screen_pt) {
   AppendMenuW(menu, MF_STRING, kCmdArrow, L"Tool: Arrow");
   AppendMenuW(menu, MF_STRING, kCmdPencil, L"Tool: Pencil");
   AppendMenuW(menu, MF_STRING, kCmdText, L"Tool: Text");
+  AppendMenuW(menu, MF_STRING, kCmdMosaic, L"Tool: Mosaic");
+  AppendMenuW(menu, MF_STRING, kCmdBlur, L"Tool: Blur");
   AppendMenuW(menu, MF_STRING, kCmdReselect, L"Reselect Range (R)");
   AppendMenuW(menu, MF_SEPARATOR, 0, nullptr);
   AppendMenuW(menu, MF_STRING, kCmdUndo, L"Undo");
@@ -1465,11 +1795,9 @@ void AnnotateWindow::EmitCommand(Command cmd) {
   if (!on_command_) {
     return;
   }
-  std::shared_ptr<std::vector<uint8_t>> pixels;
-  SizePX size = {};
-  int32_t stride = 0;
-  BuildComposedPixels(&pixels, &size, &stride);
-  on_command_(cmd, std::move(pixels), size, stride);
+  BitmapView pixels;
+  BuildComposedPixels(&pixels);
+  on_command_(cmd, pixels);
 }
 
 } // namespace snappin
@@ -1,4 +1,10 @@
 #pragma once
+#include "AnnotationHitIndex.h"
+#include "EditHistory.h"
+#include "GlyphCache.h"
+#include "Rasterizer.h"
+#include "RedactionCache.h"
+#include "StrokeSimplifier.h"
 #include "Types.h"
 
 #define WIN32_LEAN_AND_MEAN
@@ -6,6 +12,7 @@
 
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -20,9 +27,7 @@ public:
     Reselect = 4,
   };
 
-  using CommandCallback =
-      std::function<void(Command, std::shared_ptr<std::vector<uint8_t>>,
-                         const SizePX&, int32_t)>;
+  using CommandCallback = std::function<void(Command, const BitmapView&)>;
 
   AnnotateWindow() = default;
   ~AnnotateWindow();
@@ -30,13 +35,13 @@ public:
   bool Create(HINSTANCE instance, HWND parent = nullptr);
   void Destroy();
 
-  bool BeginSession(const RectPX& screen_rect,
-                    std::shared_ptr<std::vector<uint8_t>> source_pixels,
-                    const SizePX& size_px, int32_t stride_bytes);
+  bool BeginSession(const RectPX& screen_rect, BitmapView source);
   void EndSession();
   bool IsVisible() const;
 
   void SetCommandCallback(CommandCallback on_command);
+  // Applies to pencil strokes started after the call.
+  void SetPencilOptions(const StrokeSimplifierOptions& options);
 
 private:
   enum class Tool {
@@ -46,14 +51,20 @@ private:
     Arrow,
     Pencil,
     Text,
+    Mosaic,
+    Blur,
   };
 
+  // Mosaic and Blur are boxes (p1, p2) whose pixels are replaced by a redacted
+  // copy of the source; thickness sets their strength.
   enum class AnnotationType {
     Rect,
     Line,
     Arrow,
     Pencil,
     Text,
+    Mosaic,
+    Blur,
   };
 
   enum class DragMode {
@@ -92,31 +103,62 @@ private:
   void LayoutControls();
   void UpdateToolButtons();
   void SetTool(Tool tool);
+  // Whole client area: new sessions and tool changes.
   void Invalidate();
+  // Canvas pixels only, for edits; empty rects are ignored.
+  void Invalidate(const RectPX& canvas_rect);
 
   RECT CanvasRectClient() const;
   bool ToCanvasPoint(POINT client_pt, POINT* out_canvas) const;
   POINT ClampToCanvas(POINT pt) const;
   void BeginDrag(POINT canvas_pt);
+  void AddPencilSample(POINT canvas_pt);
   void UpdateDrag(POINT canvas_pt);
   void EndDrag(POINT canvas_pt);
 
   int HitTestAnnotation(POINT canvas_pt, DragMode* mode_out) const;
+  bool HitTestOne(const Annotation& ann, POINT canvas_pt, DragMode* mode_out) const;
+  // Conservative hit regions (a superset of what HitTestOne accepts).
+  std::vector<HitShape> HitShapesFor(const Annotation& ann) const;
+  void IndexInserted(size_t index);
+  void IndexUpdated(size_t index);
+  // After undo/redo touched `touched`; the size change tells add from remove.
+  void SyncHitIndex(size_t touched, size_t count_before);
   bool AnnotationTypeAllowedByTool(AnnotationType type) const;
   bool AnnotationEditable(AnnotationType type) const;
+  // Types edited as a box through p1/p2 (Rect, Mosaic, Blur).
+  static bool IsBoxType(AnnotationType type);
   RectPX RectFromPoints(POINT a, POINT b) const;
   RectPX RectBoundsForAnnotation(const Annotation& ann) const;
   RectPX NormalizeRect(RectPX rect) const;
-
-  void DrawOverlay(HDC hdc) const;
-  void DrawAnnotation(HDC hdc, const Annotation& ann, bool selected) const;
-  void DrawArrowHead(HDC hdc, POINT start, POINT end, COLORREF color,
-                     int thickness) const;
+  // Canvas pixels a paint of `ann` can change: its shape, selection handles
+  // and text caret.
+  RectPX PaintBounds(const Annotation& ann) const;
+  // PaintBounds of annotations_[index], of the selected annotation, of the
+  // drag preview or dragged annotation, and of the pencil stroke from point
+  // `first` on. Empty when there is none.
+  RectPX PaintBoundsAt(std::optional<size_t> index) const;
+  RectPX SelectionBounds() const;
+  RectPX DragBounds() const;
+  RectPX PencilTailBounds(size_t first) const;
+
+  bool PreviewAnnotation(Annotation* out) const;
+  bool ToVectorShape(const Annotation& ann, VectorShape* out) const;
+  // Draws the annotations (and `preview`, if any) over `target`, a DIB
+  // section. Shapes go through the software rasterizer and text through the
+  // shared glyph cache. Only pixels inside `clip` are touched.
+  void RenderAnnotations(const CpuBitmap& target, const RectPX& clip,
+                         const Annotation* preview, int32_t threads) const;
+  static FontKey TextFont(const Annotation& ann);
+  void DrawTextAnnotation(const CpuBitmap& target, const RectPX& clip,
+                          const Annotation& ann) const;
+  void DrawTextCaret(HDC hdc) const;
   void DrawSelectionHandles(HDC hdc, const Annotation& ann) const;
-  bool BuildComposedPixels(std::shared_ptr<std::vector<uint8_t>>* out_pixels,
-                           SizePX* out_size, int32_t* out_stride) const;
+  bool EnsureCanvas();
+  void ReleaseCanvas();
+  bool BuildComposedPixels(BitmapView* out_pixels) const;
 
-  void PushHistory();
+  static size_t AnnotationHeapBytes(const Annotation& ann);
   bool Undo();
   bool Redo();
   void DeleteSelection();
@@ -130,8 +172,14 @@ private:
 
   RectPX screen_rect_px_{};
   SizePX bitmap_size_px_{};
-  int32_t stride_bytes_ = 0;
-  std::shared_ptr<std::vector<uint8_t>> source_pixels_;
+  BitmapView source_pixels_;
+
+  // Persistent paint target: a DIB section of the canvas size selected into
+  // its own memory DC, recomposed only inside the invalidated region.
+  HDC canvas_dc_ = nullptr;
+  HBITMAP canvas_bitmap_ = nullptr;
+  HGDIOBJ canvas_old_bitmap_ = nullptr;
+  CpuBitmap canvas_pixels_{};
 
   Tool tool_ = Tool::Rect;
   COLORREF color_ = RGB(255, 80, 64);
@@ -142,6 +190,10 @@ private:
   POINT drag_start_{};
   POINT drag_current_{};
   Annotation drag_seed_{};
+  // Simplifies pencil samples as they arrive; drag_seed_.points mirrors
+  // pencil_.points(), and entries below pencil_synced_ are final.
+  StrokeSimplifier pencil_;
+  size_t pencil_synced_ = 0;
   int selected_index_ = -1;
   int drag_index_ = -1;
   POINT drag_offset_{};
@@ -150,8 +202,15 @@ private:
   int text_edit_index_ = -1;
 
   std::vector<Annotation> annotations_;
-  std::vector<std::vector<Annotation>> history_;
-  size_t history_index_ = 0;
+  // Deltas against annotations_; typing into a new text box folds into the
+  // record that added it (merge key = text_session_).
+  EditHistory<Annotation> history_{&AnnotateWindow::AnnotationHeapBytes};
+  uint64_t text_session_ = 0;
+  // Mosaic/blur tiles of source_pixels_, reused across boxes and repaints.
+  mutable RedactionCache redaction_cache_;
+  // Mirrors annotations_ for HitTestAnnotation.
+  AnnotationHitIndex hit_index_;
+  mutable std::vector<size_t> hit_candidates_;
 
   HWND btn_select_ = nullptr;
   HWND btn_rect_ = nullptr;
@@ -159,6 +218,8 @@ private:
   HWND btn_arrow_ = nullptr;
   HWND btn_pencil_ = nullptr;
   HWND btn_text_ = nullptr;
+  HWND btn_mosaic_ = nullptr;
+  HWND btn_blur_ = nullptr;
   HWND btn_reselect_ = nullptr;
   HWND btn_undo_ = nullptr;
   HWND btn_redo_ = nullptr;
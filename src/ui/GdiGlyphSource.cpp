@@ -0,0 +1,179 @@
+#include "GdiGlyphSource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+namespace snappin {
+namespace {
+
+constexpr size_t kMaxFonts = 8;
+// Largest distance between a flattened quadratic and the curve, in pixels.
+constexpr float kFlattenTolerancePx = 0.1f;
+
+const MAT2 kIdentity = {{0, 1}, {0, 0}, {0, 0}, {0, 1}};
+
+// Outline points are y-up from the glyph origin; GlyphOutline is y-down.
+PointF ToPoint(const POINTFX& p) {
+  const float x = static_cast<float>(p.x.value) + static_cast<float>(p.x.fract) / 65536.0f;
+  const float y = static_cast<float>(p.y.value) + static_cast<float>(p.y.fract) / 65536.0f;
+  return PointF{x, -y};
+}
+
+void AddQuadratic(const PointF& p0, const PointF& c, const PointF& p1,
+                  std::vector<PointF>* contour) {
+  // The chord error of n segments is at most |p0 - 2c + p1| / (4 n^2).
+  const float dev = std::hypot(p0.x - 2.0f * c.x + p1.x, p0.y - 2.0f * c.y + p1.y);
+  const int n = std::clamp(
+      static_cast<int>(std::ceil(std::sqrt(dev / (4.0f * kFlattenTolerancePx)))), 1, 32);
+  for (int i = 1; i <= n; ++i) {
+    const float t = static_cast<float>(i) / static_cast<float>(n);
+    const float u = 1.0f - t;
+    contour->push_back(PointF{u * u * p0.x + 2.0f * u * t * c.x + t * t * p1.x,
+                              u * u * p0.y + 2.0f * u * t * c.y + t * t * p1.y});
+  }
+}
+
+} // namespace
+
+GdiGlyphSource::GdiGlyphSource() { dc_ = CreateCompatibleDC(nullptr); }
+
+GdiGlyphSource::~GdiGlyphSource() {
+  if (dc_ && original_font_) {
+    SelectObject(dc_, original_font_);
+  }
+  for (const CachedFont& cached : fonts_) {
+    DeleteObject(cached.font);
+  }
+  if (dc_) {
+    DeleteDC(dc_);
+  }
+}
+
+bool GdiGlyphSource::Select(const FontKey& font) {
+  if (!dc_) {
+    return false;
+  }
+  auto it = std::find_if(fonts_.begin(), fonts_.end(), [&](const CachedFont& cached) {
+    return cached.key.size_px == font.size_px && cached.key.bold == font.bold &&
+           cached.key.family == font.family;
+  });
+  if (it == fonts_.end()) {
+    HFONT handle = CreateFontW(font.size_px, 0, 0, 0, font.bold ? FW_BOLD : FW_NORMAL, FALSE,
+                               FALSE, FALSE, DEFAULT_CHARSET, OUT_TT_PRECIS,
+                               CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY,
+                               DEFAULT_PITCH | FF_DONTCARE, font.family.c_str());
+    if (!handle) {
+      return false;
+    }
+    fonts_.insert(fonts_.begin(), CachedFont{font, handle});
+  } else if (it != fonts_.begin()) {
+    std::rotate(fonts_.begin(), it, it + 1);
+  }
+  HGDIOBJ previous = SelectObject(dc_, fonts_.front().font);
+  if (!original_font_) {
+    original_font_ = previous;
+  }
+  while (fonts_.size() > kMaxFonts) {
+    DeleteObject(fonts_.back().font);
+    fonts_.pop_back();
+  }
+  return true;
+}
+
+bool GdiGlyphSource::Metrics(const FontKey& font, FontMetrics* out) {
+  TEXTMETRICW tm = {};
+  if (!Select(font) || !GetTextMetricsW(dc_, &tm)) {
+    return false;
+  }
+  out->ascent = static_cast<float>(tm.tmAscent);
+  out->descent = static_cast<float>(tm.tmDescent);
+  out->line_height = static_cast<float>(tm.tmHeight + tm.tmExternalLeading);
+  return true;
+}
+
+bool GdiGlyphSource::Outline(const FontKey& font, char32_t codepoint, GlyphOutline* out) {
+  if (codepoint > 0xFFFF || !Select(font)) {
+    return false;
+  }
+  const UINT ch = static_cast<UINT>(codepoint);
+  GLYPHMETRICS gm = {};
+  const DWORD size = GetGlyphOutlineW(dc_, ch, GGO_NATIVE, &gm, 0, nullptr, &kIdentity);
+  if (size == GDI_ERROR) {
+    return false;
+  }
+  out->advance = static_cast<float>(gm.gmCellIncX);
+  out->contours.clear();
+  if (size == 0) {
+    return true; // blank glyph
+  }
+  buffer_.resize(size);
+  if (GetGlyphOutlineW(dc_, ch, GGO_NATIVE, &gm, size, buffer_.data(), &kIdentity) ==
+      GDI_ERROR) {
+    return false;
+  }
+
+  // A run of TTPOLYGONHEADER records, each followed by TTPOLYCURVE records up
+  // to header.cb bytes. Records are not necessarily aligned; copy them out.
+  constexpr size_t kCurveHeader = offsetof(TTPOLYCURVE, apfx);
+  const uint8_t* p = buffer_.data();
+  const uint8_t* end = p + size;
+  while (static_cast<size_t>(end - p) >= sizeof(TTPOLYGONHEADER)) {
+    TTPOLYGONHEADER header;
+    std::memcpy(&header, p, sizeof(header));
+    if (header.cb < sizeof(header) || header.cb > static_cast<size_t>(end - p)) {
+      break;
+    }
+    std::vector<PointF> contour;
+    PointF last = ToPoint(header.pfxStart);
+    contour.push_back(last);
+    const uint8_t* c = p + sizeof(header);
+    const uint8_t* contour_end = p + header.cb;
+    while (static_cast<size_t>(contour_end - c) >= kCurveHeader) {
+      WORD type = 0;
+      WORD count = 0;
+      std::memcpy(&type, c + offsetof(TTPOLYCURVE, wType), sizeof(type));
+      std::memcpy(&count, c + offsetof(TTPOLYCURVE, cpfx), sizeof(count));
+      const size_t bytes = kCurveHeader + static_cast<size_t>(count) * sizeof(POINTFX);
+      if (bytes > static_cast<size_t>(contour_end - c)) {
+        break;
+      }
+      std::vector<PointF> pts(count);
+      for (WORD i = 0; i < count; ++i) {
+        POINTFX fx;
+        std::memcpy(&fx, c + kCurveHeader + i * sizeof(POINTFX), sizeof(fx));
+        pts[i] = ToPoint(fx);
+      }
+      if (type == TT_PRIM_QSPLINE && count >= 2) {
+        // B-spline: on-curve points between consecutive control points are
+        // implied at their midpoints; the last point is on the curve.
+        for (WORD i = 0; i + 1 < count; ++i) {
+          const PointF next = i + 2 == count
+                                  ? pts[i + 1]
+                                  : PointF{0.5f * (pts[i].x + pts[i + 1].x),
+                                           0.5f * (pts[i].y + pts[i + 1].y)};
+          AddQuadratic(last, pts[i], next, &contour);
+          last = next;
+        }
+      } else {
+        contour.insert(contour.end(), pts.begin(), pts.end());
+        if (!pts.empty()) {
+          last = pts.back();
+        }
+      }
+      c += bytes;
+    }
+    out->contours.push_back(std::move(contour));
+    p += header.cb;
+  }
+  return true;
+}
+
+GlyphCache& SharedGlyphCache() {
+  static GlyphCache cache(std::make_unique<GdiGlyphSource>());
+  return cache;
+}
+
+} // namespace snappin
@@ -0,0 +1,46 @@
+#pragma once
+#include "GlyphCache.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace snappin {
+
+// Glyph outlines and metrics from GDI (GetGlyphOutlineW, grid-fitted at the
+// requested size), flattened to polygons for GlyphCache. Keeps one HFONT per
+// recently used FontKey selected into a private memory DC. Codepoints outside
+// the BMP report no glyph. UI thread only.
+class GdiGlyphSource final : public GlyphSource {
+public:
+  GdiGlyphSource();
+  ~GdiGlyphSource() override;
+  GdiGlyphSource(const GdiGlyphSource&) = delete;
+  GdiGlyphSource& operator=(const GdiGlyphSource&) = delete;
+
+  bool Metrics(const FontKey& font, FontMetrics* out) override;
+  bool Outline(const FontKey& font, char32_t codepoint, GlyphOutline* out) override;
+
+private:
+  struct CachedFont {
+    FontKey key;
+    HFONT font = nullptr;
+  };
+
+  // Selects the font into dc_; false if it cannot be created.
+  bool Select(const FontKey& font);
+
+  HDC dc_ = nullptr;
+  HGDIOBJ original_font_ = nullptr;
+  // Most recently used first.
+  std::vector<CachedFont> fonts_;
+  std::vector<uint8_t> buffer_;
+};
+
+// Process-wide glyph cache over GdiGlyphSource, shared by annotation text and
+// text pins. UI thread only, except GlyphCache::Stats().
+GlyphCache& SharedGlyphCache();
+
+} // namespace snappin
@@ -1,5 +1,9 @@
 #include "OverlayWindow.h"
 
+#include "PixelBufferPool.h"
+#include "PixelKernels.h"
+#include "TraceRecorder.h"
+
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <windowsx.h>
@@ -9,6 +13,8 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
+#include <vector>
 
 namespace snappin {
 namespace {
@@ -21,25 +27,16 @@ const int kEscapeHotkeyId = 42;
 const UINT_PTR kOverlayRefreshTimerId = 7;
 const UINT kOverlayRefreshIntervalMs = 33;
 
-void DrawFrozenFrame(HDC hdc, const RECT& rc, const uint8_t* pixels, int32_t width,
-                     int32_t height) {
-  if (!pixels || width <= 0 || height <= 0) {
+// Maps [lo, hi) from an axis of length `from` onto one of length `to`,
+// rounding outward.
+void ScaleSpan(LONG lo, LONG hi, LONG from, LONG to, LONG* out_lo, LONG* out_hi) {
+  if (from == to || from <= 0) {
+    *out_lo = lo;
+    *out_hi = hi;
     return;
   }
-
-  BITMAPINFO bmi = {};
-  bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-  bmi.bmiHeader.biWidth = width;
-  bmi.bmiHeader.biHeight = -height;
-  bmi.bmiHeader.biPlanes = 1;
-  bmi.bmiHeader.biBitCount = 32;
-  bmi.bmiHeader.biCompression = BI_RGB;
-
-  int dst_w = rc.right - rc.left;
-  int dst_h = rc.bottom - rc.top;
-  SetStretchBltMode(hdc, HALFTONE);
-  StretchDIBits(hdc, 0, 0, dst_w, dst_h, 0, 0, width, height, pixels, &bmi,
-                DIB_RGB_COLORS, SRCCOPY);
+  *out_lo = static_cast<LONG>((static_cast<int64_t>(lo) * to) / from);
+  *out_hi = static_cast<LONG>((static_cast<int64_t>(hi) * to + from - 1) / from);
 }
 
 RectPX RectFromScreenPoints(const PointPX& a, const POINT& b) {
@@ -100,8 +97,11 @@ bool IsWindowCloaked(HWND hwnd) {
   return SUCCEEDED(hr) && cloaked != 0;
 }
 
-HWND WindowAtPointExcludingSelf(POINT pt, HWND self_hwnd) {
+// Walks the z-order once, topmost first, skipping hidden, minimized and
+// cloaked windows and those of this process (overlay, toolbar, pins).
+void SnapshotTopLevelWindows(HWND self_hwnd, WindowRectIndex* index) {
   const DWORD self_pid = GetCurrentProcessId();
+  std::vector<WindowRectEntry> entries;
   for (HWND w = GetTopWindow(nullptr); w; w = GetWindow(w, GW_HWNDNEXT)) {
     if (w == self_hwnd) {
       continue;
@@ -120,11 +120,12 @@ HWND WindowAtPointExcludingSelf(POINT pt, HWND self_hwnd) {
     if (!GetWindowFrameRect(w, &wr)) {
       continue;
     }
-    if (PtInRect(&wr, pt)) {
-      return w;
-    }
+    WindowRectEntry entry;
+    entry.rect = RectPX{wr.left, wr.top, wr.right - wr.left, wr.bottom - wr.top};
+    entry.id = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(w));
+    entries.push_back(entry);
   }
-  return nullptr;
+  index->Build(std::move(entries));
 }
 
 bool ShouldUseSelectionHoleImpl(bool interaction_enabled, bool dragging,
@@ -171,6 +172,7 @@ void OverlayWindow::Destroy() {
     hwnd_ = nullptr;
   }
   visible_ = false;
+  compositor_.Clear();
 }
 
 void OverlayWindow::ShowForCurrentMonitor() {
@@ -220,8 +222,10 @@ void OverlayWindow::ShowForRect(const RectPX& rect) {
   selected_rect_px_ = {};
   selected_rect_client_px_ = {};
   hover_rect_px_ = {};
+  SnapshotTopLevelWindows(hwnd_, &hover_index_);
   UpdateHoverRect();
   SetTimer(hwnd_, kOverlayRefreshTimerId, kOverlayRefreshIntervalMs, nullptr);
+  ResetCompositor();
   UpdateMaskRegion();
   Invalidate();
 }
@@ -237,6 +241,7 @@ void OverlayWindow::Hide() {
   dragging_ = false;
   has_selection_ = false;
   interaction_enabled_ = true;
+  hover_index_.Clear();
   ClearFrozenFrame();
 }
 
@@ -247,40 +252,36 @@ void OverlayWindow::SetCallbacks(SelectCallback on_select, CancelCallback on_can
   on_cancel_ = std::move(on_cancel);
 }
 
-void OverlayWindow::SetFrozenFrame(std::shared_ptr<std::vector<uint8_t>> pixels,
-                                   const SizePX& size_px, int32_t stride_bytes) {
+void OverlayWindow::SetFrozenFrame(BitmapView pixels) {
   frozen_pixels_ = std::move(pixels);
-  frozen_size_px_ = size_px;
-  frozen_stride_ = stride_bytes;
-  frozen_active_ = frozen_pixels_ && frozen_size_px_.w > 0 && frozen_size_px_.h > 0 &&
-                   frozen_stride_ >= frozen_size_px_.w * 4;
-  frozen_dimmed_.reset();
+  frozen_active_ = frozen_pixels_.valid();
+  frozen_dimmed_ = BitmapView();
   if (frozen_active_) {
-    const size_t total = static_cast<size_t>(frozen_stride_) *
-                         static_cast<size_t>(frozen_size_px_.h);
-    auto dimmed = std::make_shared<std::vector<uint8_t>>();
-    dimmed->resize(total);
-    const uint8_t* src = frozen_pixels_->data();
-    uint8_t* dst = dimmed->data();
-    for (size_t i = 0; i < total; i += 4) {
-      dst[i + 0] = static_cast<uint8_t>(src[i + 0] * kOverlayDimFactor);
-      dst[i + 1] = static_cast<uint8_t>(src[i + 1] * kOverlayDimFactor);
-      dst[i + 2] = static_cast<uint8_t>(src[i + 2] * kOverlayDimFactor);
-      dst[i + 3] = 0xFF;
+    std::shared_ptr<uint8_t> dimmed;
+    int32_t dimmed_stride = 0;
+    if (AcquirePixelBuffer(PixelBufferPool::Shared(), frozen_pixels_.size_px(), &dimmed,
+                           &dimmed_stride)) {
+      const CpuBitmap src = frozen_pixels_.AsCpuBitmap();
+      CpuBitmap dst = src;
+      dst.stride_bytes = dimmed_stride;
+      dst.data.p = dimmed.get();
+      if (DimBitmap(src, &dst, kOverlayDimFactor)) {
+        frozen_dimmed_ = BitmapView(std::move(dimmed), dst.size_px, dimmed_stride,
+                                    dst.format);
+      }
     }
-    frozen_dimmed_ = std::move(dimmed);
   }
+  ResetCompositor();
   UpdateOverlayAlpha();
   UpdateMaskRegion();
   Invalidate();
 }
 
 void OverlayWindow::ClearFrozenFrame() {
-  frozen_pixels_.reset();
-  frozen_dimmed_.reset();
-  frozen_size_px_ = {};
-  frozen_stride_ = 0;
+  frozen_pixels_ = BitmapView();
+  frozen_dimmed_ = BitmapView();
   frozen_active_ = false;
+  ResetCompositor();
   UpdateOverlayAlpha();
   UpdateMaskRegion();
   Invalidate();
@@ -318,6 +319,11 @@ LRESULT OverlayWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
         return 0;
       }
       if (wparam == kOverlayRefreshTimerId && !dragging_) {
+        POINT cursor = {};
+        if (!GetCursorPos(&cursor) ||
+            (cursor.x == last_hover_cursor_.x && cursor.y == last_hover_cursor_.y)) {
+          return 0;
+        }
         RectPX before = hover_rect_px_;
         UpdateHoverRect();
         if (before.x != hover_rect_px_.x || before.y != hover_rect_px_.y ||
@@ -388,101 +394,11 @@ LRESULT OverlayWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
     case WM_ERASEBKGND:
       return 1;
     case WM_PAINT: {
+      SNAPPIN_TRACE_SPAN("overlay.paint", "overlay");
       PAINTSTRUCT ps = {};
       HDC hdc = BeginPaint(hwnd_, &ps);
       if (hdc) {
-        RECT rc;
-        GetClientRect(hwnd_, &rc);
-        const int rc_w = rc.right - rc.left;
-        const int rc_h = rc.bottom - rc.top;
-        HDC mem_dc = CreateCompatibleDC(hdc);
-        HBITMAP mem_bmp = nullptr;
-        HGDIOBJ old_bmp = nullptr;
-        if (mem_dc && rc_w > 0 && rc_h > 0) {
-          mem_bmp = CreateCompatibleBitmap(hdc, rc_w, rc_h);
-          if (mem_bmp) {
-            old_bmp = SelectObject(mem_dc, mem_bmp);
-          }
-        }
-
-        HDC draw_dc = (mem_dc && mem_bmp) ? mem_dc : hdc;
-
-        RectPX rect_screen = ActiveRectPx();
-        if (!dragging_ && !has_selection_) {
-          rect_screen = hover_rect_px_;
-        }
-        if (dragging_) {
-          POINT cur = {};
-          if (GetCursorPos(&cur)) {
-            rect_screen = RectFromScreenPoints(start_px_, cur);
-          }
-        }
-        RECT sel = {};
-        bool show_sel = rect_screen.w > 0 && rect_screen.h > 0;
-        if (show_sel) {
-          RECT win = {};
-          GetWindowRect(hwnd_, &win);
-          sel.left = rect_screen.x - win.left;
-          sel.top = rect_screen.y - win.top;
-          sel.right = sel.left + rect_screen.w;
-          sel.bottom = sel.top + rect_screen.h;
-        }
-
-        if (frozen_active_ && frozen_pixels_ && frozen_dimmed_) {
-          DrawFrozenFrame(draw_dc, rc, frozen_dimmed_->data(), frozen_size_px_.w,
-                          frozen_size_px_.h);
-          if (show_sel) {
-            RECT bright = sel;
-            if (bright.left < 0) {
-              bright.left = 0;
-            }
-            if (bright.top < 0) {
-              bright.top = 0;
-            }
-            if (bright.right > rc.right) {
-              bright.right = rc.right;
-            }
-            if (bright.bottom > rc.bottom) {
-              bright.bottom = rc.bottom;
-            }
-            int bw = bright.right - bright.left;
-            int bh = bright.bottom - bright.top;
-            if (bw > 0 && bh > 0) {
-              HRGN clip = CreateRectRgn(bright.left, bright.top, bright.right,
-                                        bright.bottom);
-              if (clip) {
-                SelectClipRgn(draw_dc, clip);
-                DrawFrozenFrame(draw_dc, rc, frozen_pixels_->data(),
-                                frozen_size_px_.w, frozen_size_px_.h);
-                SelectClipRgn(draw_dc, nullptr);
-                DeleteObject(clip);
-              }
-            }
-          }
-        } else {
-          HBRUSH bg = CreateSolidBrush(RGB(0, 0, 0));
-          FillRect(draw_dc, &rc, bg);
-          DeleteObject(bg);
-        }
-
-        if (show_sel) {
-          HPEN pen = CreatePen(PS_SOLID, kBorderPx, RGB(255, 255, 255));
-          HGDIOBJ old_pen = SelectObject(draw_dc, pen);
-          HGDIOBJ old_brush = SelectObject(draw_dc, GetStockObject(HOLLOW_BRUSH));
-          Rectangle(draw_dc, sel.left, sel.top, sel.right, sel.bottom);
-          SelectObject(draw_dc, old_brush);
-          SelectObject(draw_dc, old_pen);
-          DeleteObject(pen);
-        }
-
-        if (draw_dc != hdc) {
-          BitBlt(hdc, 0, 0, rc_w, rc_h, draw_dc, 0, 0, SRCCOPY);
-          SelectObject(mem_dc, old_bmp);
-          DeleteObject(mem_bmp);
-          DeleteDC(mem_dc);
-        } else if (mem_dc) {
-          DeleteDC(mem_dc);
-        }
+        PaintBackBuffer(hdc, ps.rcPaint);
         EndPaint(hwnd_, &ps);
       }
       return 0;
@@ -686,7 +602,114 @@ void OverlayWindow::Invalidate() {
   if (!hwnd_) {
     return;
   }
-  InvalidateRect(hwnd_, nullptr, FALSE);
+  if (!compositor_.valid()) {
+    InvalidateRect(hwnd_, nullptr, FALSE);
+    return;
+  }
+  RECT client = {};
+  GetClientRect(hwnd_, &client);
+  const SizePX buf = compositor_.size_px();
+  for (const RectPX& r : compositor_.Compose(CurrentScene())) {
+    RECT dirty = {};
+    ScaleSpan(r.x, r.x + r.w, buf.w, client.right, &dirty.left, &dirty.right);
+    ScaleSpan(r.y, r.y + r.h, buf.h, client.bottom, &dirty.top, &dirty.bottom);
+    InvalidateRect(hwnd_, &dirty, FALSE);
+  }
+}
+
+void OverlayWindow::ResetCompositor() {
+  if (!visible_) {
+    // Hand the back buffer back to the pool while hidden.
+    compositor_.Clear();
+    return;
+  }
+  OverlayStyle style;
+  style.border_px = kBorderPx;
+  bool ok = false;
+  if (frozen_active_ && frozen_dimmed_.valid()) {
+    ok = compositor_.Reset(frozen_pixels_.size_px(), frozen_dimmed_, frozen_pixels_, style);
+  } else if (monitor_size_.cx > 0 && monitor_size_.cy > 0) {
+    // Live overlay: a flat fill under the layered alpha; the selection is a
+    // window-region hole, so only the border needs drawing.
+    ok = compositor_.Reset(SizePX{monitor_size_.cx, monitor_size_.cy}, BitmapView(),
+                           BitmapView(), style);
+  }
+  if (!ok) {
+    compositor_.Clear();
+  }
+}
+
+OverlayScene OverlayWindow::CurrentScene() const {
+  RectPX rect_screen = ActiveRectPx();
+  if (!dragging_ && !has_selection_) {
+    rect_screen = hover_rect_px_;
+  }
+  if (dragging_) {
+    POINT cur = {};
+    if (GetCursorPos(&cur)) {
+      rect_screen = RectFromScreenPoints(start_px_, cur);
+    }
+  }
+  OverlayScene scene;
+  if (rect_screen.w <= 0 || rect_screen.h <= 0) {
+    return scene;
+  }
+  RECT win = {};
+  RECT client = {};
+  GetWindowRect(hwnd_, &win);
+  GetClientRect(hwnd_, &client);
+  const SizePX buf = compositor_.size_px();
+  RECT sel = {};
+  ScaleSpan(rect_screen.x - win.left, rect_screen.x - win.left + rect_screen.w,
+            client.right, buf.w, &sel.left, &sel.right);
+  ScaleSpan(rect_screen.y - win.top, rect_screen.y - win.top + rect_screen.h,
+            client.bottom, buf.h, &sel.top, &sel.bottom);
+  scene.selection = RectPX{sel.left, sel.top, sel.right - sel.left, sel.bottom - sel.top};
+  return scene;
+}
+
+void OverlayWindow::PaintBackBuffer(HDC hdc, const RECT& paint) {
+  RECT client = {};
+  GetClientRect(hwnd_, &client);
+  RECT dst = paint;
+  IntersectRect(&dst, &dst, &client);
+  if (IsRectEmpty(&dst)) {
+    return;
+  }
+  const CpuBitmap buf = compositor_.BackBuffer();
+  if (!compositor_.valid()) {
+    FillRect(hdc, &dst, static_cast<HBRUSH>(GetStockObject(BLACK_BRUSH)));
+    return;
+  }
+
+  RECT src = {};
+  ScaleSpan(dst.left, dst.right, client.right, buf.size_px.w, &src.left, &src.right);
+  ScaleSpan(dst.top, dst.bottom, client.bottom, buf.size_px.h, &src.top, &src.bottom);
+  src.right = std::min<LONG>(src.right, buf.size_px.w);
+  src.bottom = std::min<LONG>(src.bottom, buf.size_px.h);
+  if (src.right <= src.left || src.bottom <= src.top) {
+    return;
+  }
+
+  // Point the DIB at the first source row so the blit only touches the
+  // dirty band (and sidesteps top-down source origin quirks).
+  const uint8_t* bits = static_cast<const uint8_t*>(buf.data.p) +
+                        static_cast<size_t>(src.top) * static_cast<size_t>(buf.stride_bytes);
+  const int src_w = src.right - src.left;
+  const int src_h = src.bottom - src.top;
+  BITMAPINFO bmi = {};
+  bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+  bmi.bmiHeader.biWidth = buf.stride_bytes / 4;
+  bmi.bmiHeader.biHeight = -src_h;
+  bmi.bmiHeader.biPlanes = 1;
+  bmi.bmiHeader.biBitCount = 32;
+  bmi.bmiHeader.biCompression = BI_RGB;
+
+  const int dst_w = dst.right - dst.left;
+  const int dst_h = dst.bottom - dst.top;
+  SetStretchBltMode(hdc, (dst_w == src_w && dst_h == src_h) ? COLORONCOLOR : HALFTONE);
+  StretchDIBits(hdc, dst.left, dst.top, dst_w, dst_h, src.left, 0, src_w, src_h, bits, &bmi,
+                DIB_RGB_COLORS, SRCCOPY);
 }
 
 void OverlayWindow::UpdateMaskRegion() {
@@ -768,25 +791,14 @@ void OverlayWindow::UpdateHoverRect() {
     hover_rect_px_ = {};
     return;
   }
+  last_hover_cursor_ = cursor;
 
-  HWND target = WindowAtPointExcludingSelf(cursor, hwnd_);
+  const WindowRectEntry* target = hover_index_.TopmostAt(PointPX{cursor.x, cursor.y});
   if (!target) {
     hover_rect_px_ = {};
     return;
   }
-
-  RECT wr = {};
-  if (!GetWindowFrameRect(target, &wr)) {
-    hover_rect_px_ = {};
-    return;
-  }
-
-  RectPX win_rect;
-  win_rect.x = wr.left;
-  win_rect.y = wr.top;
-  win_rect.w = wr.right - wr.left;
-  win_rect.h = wr.bottom - wr.top;
-  hover_rect_px_ = IntersectRectPx(win_rect, monitor_rect);
+  hover_rect_px_ = IntersectRectPx(target->rect, monitor_rect);
 }
 
 void OverlayWindow::EnsureEscapeHotkey(bool enable) {
@@ -1,5 +1,7 @@
 #pragma once
+#include "OverlayCompositor.h"
 #include "Types.h"
+#include "WindowRectIndex.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -27,8 +29,7 @@ public:
   bool IsVisible() const;
 
   void SetCallbacks(SelectCallback on_select, CancelCallback on_cancel);
-  void SetFrozenFrame(std::shared_ptr<std::vector<uint8_t>> pixels,
-                      const SizePX& size_px, int32_t stride_bytes);
+  void SetFrozenFrame(BitmapView pixels);
   void ClearFrozenFrame();
   void SetInteractionEnabled(bool enabled);
   bool IsInteractionEnabled() const;
@@ -52,7 +53,11 @@ private:
   RectPX ActiveRectPx() const;
   RectPX ActiveRectClient() const;
   void UpdateMaskRegion();
+  // Recomposes what changed since the last frame and invalidates only that.
   void Invalidate();
+  void ResetCompositor();
+  OverlayScene CurrentScene() const;
+  void PaintBackBuffer(HDC hdc, const RECT& paint);
   void SetClickThrough(bool enabled);
   void UpdateOverlayAlpha();
   void EnsureEscapeHotkey(bool enable);
@@ -76,11 +81,18 @@ private:
   RectPX hover_rect_px_{};
   float dpi_scale_ = 1.0f;
 
-  std::shared_ptr<std::vector<uint8_t>> frozen_pixels_;
-  std::shared_ptr<std::vector<uint8_t>> frozen_dimmed_;
-  SizePX frozen_size_px_{};
-  int32_t frozen_stride_ = 0;
+  BitmapView frozen_pixels_;
+  // Pooled; recycled for the next capture once the overlay drops it.
+  BitmapView frozen_dimmed_;
   bool frozen_active_ = false;
+  // Retained back buffer; WM_PAINT only copies from it.
+  OverlayCompositor compositor_;
+  // Cursor position of the last hover lookup; the refresh timer skips the
+  // window walk while it is unchanged.
+  POINT last_hover_cursor_ = {};
+  // Top-level window frames captured when the overlay opens; hover lookups
+  // query it instead of walking the z-order.
+  WindowRectIndex hover_index_;
   bool esc_hotkey_registered_ = false;
   bool interaction_enabled_ = true;
 
@@ -1,4 +1,7 @@
 ﻿#include "PinWindow.h"
+#include "GdiGlyphSource.h"
+#include "PinPixelStore.h"
+#include "ScaledImageCache.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -55,35 +58,31 @@ const wchar_t* DefaultTitleForContent(PinWindow::ContentKind kind) {
 
 PinWindow::~PinWindow() { Destroy(); }
 
-bool PinWindow::Create(HINSTANCE instance, Id64 pin_id,
-                       std::shared_ptr<std::vector<uint8_t>> pixels,
-                       const SizePX& size_px, int32_t stride_bytes,
-                       const PointPX& pos_px, ContentKind content_kind,
+bool PinWindow::Create(HINSTANCE instance, Id64 pin_id, const SizePX& size_px,
+                       const PointPX& pos_px,
+                       ContentKind content_kind,
                        const std::wstring& text_payload) {
   if (hwnd_ || size_px.w <= 0 || size_px.h <= 0) {
     return false;
   }
 
   if (content_kind == ContentKind::Image) {
-    if (!pixels || stride_bytes < size_px.w * 4) {
+    SizePX pixel_size;
+    if (!PinPixelStore::Shared().PixelSize(pin_id.value, &pixel_size) ||
+        pixel_size.w != size_px.w || pixel_size.h != size_px.h) {
       return false;
     }
   } else {
     if (text_payload.empty()) {
       return false;
     }
-    if (!pixels) {
-      stride_bytes = 0;
-    }
   }
 
   instance_ = instance;
   pin_id_ = pin_id;
   content_kind_ = content_kind;
   text_payload_ = text_payload;
-  pixels_ = std::move(pixels);
   bitmap_size_px_ = size_px;
-  stride_bytes_ = stride_bytes;
 
   WNDCLASSEXW wc = {};
   wc.cbSize = sizeof(wc);
@@ -112,6 +111,7 @@ bool PinWindow::Create(HINSTANCE instance, Id64 pin_id,
 }
 
 void PinWindow::Destroy() {
+  ScaledImageCache::Shared().Remove(pin_id_.value);
   if (hwnd_) {
     DestroyWindow(hwnd_);
     hwnd_ = nullptr;
@@ -128,6 +128,7 @@ void PinWindow::Show() {
   UpdateTopMost();
   visible_ = true;
   NotifyFocus();
+  NotifyState();
 }
 
 void PinWindow::Hide() {
@@ -137,6 +138,7 @@ void PinWindow::Hide() {
   ShowWindow(hwnd_, SW_HIDE);
   visible_ = false;
   dragging_ = false;
+  NotifyState();
 }
 
 bool PinWindow::IsVisible() const { return visible_; }
@@ -147,11 +149,49 @@ bool PinWindow::is_locked() const { return locked_; }
 
 PinWindow::ContentKind PinWindow::content_kind() const { return content_kind_; }
 
+PinWindow::State PinWindow::state() const {
+  State state;
+  if (hwnd_) {
+    RECT wr = {};
+    GetWindowRect(hwnd_, &wr);
+    state.pos_px = PointPX{wr.left, wr.top};
+  }
+  state.scale = scale_;
+  state.opacity = opacity_;
+  state.locked = locked_;
+  state.always_on_top = always_on_top_;
+  state.visible = visible_;
+  return state;
+}
+
+void PinWindow::RestoreState(const State& state) {
+  if (!hwnd_) {
+    return;
+  }
+  scale_ = std::clamp(state.scale, kScaleMin, kScaleMax);
+  opacity_ = std::clamp(state.opacity, kOpacityMin, kOpacityMax);
+  locked_ = state.locked;
+  always_on_top_ = state.always_on_top;
+  const int w = WidthFromScale(bitmap_size_px_.w, scale_);
+  const int h = HeightFromScale(bitmap_size_px_.h, scale_);
+  SetWindowPos(hwnd_, always_on_top_ ? HWND_TOPMOST : HWND_NOTOPMOST, state.pos_px.x,
+               state.pos_px.y, w, h, SWP_NOACTIVATE);
+  UpdateAlpha();
+  if (state.visible) {
+    Show();
+  } else {
+    Hide();
+  }
+  Invalidate();
+}
+
 void PinWindow::SetCallbacks(FocusCallback on_focus, CommandCallback on_command) {
   on_focus_ = std::move(on_focus);
   on_command_ = std::move(on_command);
 }
 
+void PinWindow::SetStateCallback(StateCallback on_state) { on_state_ = std::move(on_state); }
+
 LRESULT CALLBACK PinWindow::WndProc(HWND hwnd, UINT msg, WPARAM wparam,
                                     LPARAM lparam) {
   PinWindow* self = nullptr;
@@ -211,6 +251,7 @@ LRESULT PinWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
       if (dragging_) {
         dragging_ = false;
         ReleaseCapture();
+        NotifyState();
       }
       return 0;
     case WM_LBUTTONDBLCLK:
@@ -257,11 +298,13 @@ LRESULT PinWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
       }
       if (wparam == 'L') {
         locked_ = !locked_;
+        NotifyState();
         return 0;
       }
       if (wparam == 'T') {
         always_on_top_ = !always_on_top_;
         UpdateTopMost();
+        NotifyState();
         return 0;
       }
       if (ctrl && wparam == 'C') {
@@ -312,41 +355,40 @@ LRESULT PinWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
         const int dst_w = rc.right - rc.left;
         const int dst_h = rc.bottom - rc.top;
 
-        if (content_kind_ == ContentKind::Image && pixels_ && !pixels_->empty()) {
+        // Idle pins may only have a display-size copy resident; painting at a
+        // new size decompresses them. Restored pins whose pixels are still
+        // being read get the plain background and border as a placeholder.
+        const BitmapView pixels =
+            content_kind_ == ContentKind::Image
+                ? PinPixelStore::Shared().ForPaint(pin_id_.value, SizePX{dst_w, dst_h})
+                : BitmapView{};
+        if (pixels.valid()) {
+          // Zoomed pins blit a cached resample at the window size; StretchDIBits
+          // only runs when the cache declines (e.g. very large zoom-ins).
+          const BitmapView scaled =
+              ScaledImageCache::Shared().Scaled(pin_id_.value, pixels, SizePX{dst_w, dst_h});
+          const BitmapView& src = scaled.valid() ? scaled : pixels;
+          // Pixels may be a strided view into a larger frame.
           BITMAPINFO bmi = {};
           bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-          bmi.bmiHeader.biWidth = bitmap_size_px_.w;
-          bmi.bmiHeader.biHeight = -bitmap_size_px_.h;
+          bmi.bmiHeader.biWidth = src.stride_bytes() / 4;
+          bmi.bmiHeader.biHeight = -src.size_px().h;
           bmi.bmiHeader.biPlanes = 1;
           bmi.bmiHeader.biBitCount = 32;
           bmi.bmiHeader.biCompression = BI_RGB;
 
-          SetStretchBltMode(hdc, HALFTONE);
-          StretchDIBits(hdc, 0, 0, dst_w, dst_h, 0, 0, bitmap_size_px_.w,
-                        bitmap_size_px_.h, pixels_->data(), &bmi,
-                        DIB_RGB_COLORS, SRCCOPY);
+          if (scaled.valid()) {
+            SetDIBitsToDevice(hdc, 0, 0, static_cast<DWORD>(dst_w), static_cast<DWORD>(dst_h), 0,
+                              0, 0, static_cast<UINT>(dst_h), src.data(), &bmi,
+                              DIB_RGB_COLORS);
+          } else {
+            SetStretchBltMode(hdc, HALFTONE);
+            StretchDIBits(hdc, 0, 0, dst_w, dst_h, 0, 0, src.size_px().w,
+                          src.size_px().h, src.data(), &bmi,
+                          DIB_RGB_COLORS, SRCCOPY);
+          }
         } else {
-          const bool latex = content_kind_ == ContentKind::Latex;
-          HBRUSH bg = CreateSolidBrush(latex ? RGB(250, 247, 238) : RGB(246, 246, 246));
-          FillRect(hdc, &rc, bg);
-          DeleteObject(bg);
-
-          RECT text_rect = rc;
-          InflateRect(&text_rect, -12, -10);
-
-          HFONT font = CreateFontW(
-              latex ? 24 : 20, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-              DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-              CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_DONTCARE,
-              latex ? L"Cambria Math" : L"Segoe UI");
-          HGDIOBJ old_font = SelectObject(hdc, font);
-          SetBkMode(hdc, TRANSPARENT);
-          SetTextColor(hdc, RGB(32, 32, 32));
-          DrawTextW(hdc, text_payload_.c_str(), -1, &text_rect,
-                    DT_LEFT | DT_TOP | DT_WORDBREAK | DT_EDITCONTROL |
-                        DT_NOPREFIX);
-          SelectObject(hdc, old_font);
-          DeleteObject(font);
+          PaintText(hdc, dst_w, dst_h);
 
           HPEN border = CreatePen(PS_SOLID, 1, RGB(198, 198, 198));
           HGDIOBJ old_pen = SelectObject(hdc, border);
@@ -366,6 +408,45 @@ LRESULT PinWindow::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
   return DefWindowProcW(hwnd_, msg, wparam, lparam);
 }
 
+void PinWindow::PaintText(HDC hdc, int width, int height) {
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  const bool latex = content_kind_ == ContentKind::Latex;
+  const size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+  text_canvas_.resize(pixels * 4);
+  const uint32_t bg = latex ? 0xFFFAF7EEu : 0xFFF6F6F6u; // BGRA, opaque
+  uint32_t* px = reinterpret_cast<uint32_t*>(text_canvas_.data());
+  std::fill(px, px + pixels, bg);
+
+  CpuBitmap target;
+  target.format = PixelFormat::BGRA8;
+  target.size_px = SizePX{width, height};
+  target.stride_bytes = width * 4;
+  target.data.p = text_canvas_.data();
+  // Wrapped to the window inside a 12 x 10 px margin, and clipped to it.
+  const RectPX text_rect{12, 10, width - 24, height - 20};
+  if (text_rect.w > 0 && text_rect.h > 0) {
+    FontKey font;
+    font.family = latex ? L"Cambria Math" : L"Segoe UI";
+    font.size_px = latex ? 24 : 20;
+    GlyphCache& glyphs = SharedGlyphCache();
+    const auto layout = glyphs.Layout(font, text_payload_, text_rect.w);
+    glyphs.Draw(font, *layout, PointPX{text_rect.x, text_rect.y}, ColorRGBA{32, 32, 32, 255},
+                target, text_rect);
+  }
+
+  BITMAPINFO bmi = {};
+  bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+  bmi.bmiHeader.biWidth = width;
+  bmi.bmiHeader.biHeight = -height;
+  bmi.bmiHeader.biPlanes = 1;
+  bmi.bmiHeader.biBitCount = 32;
+  bmi.bmiHeader.biCompression = BI_RGB;
+  SetDIBitsToDevice(hdc, 0, 0, static_cast<DWORD>(width), static_cast<DWORD>(height), 0, 0, 0,
+                    static_cast<UINT>(height), text_canvas_.data(), &bmi, DIB_RGB_COLORS);
+}
+
 void PinWindow::Invalidate() {
   if (!hwnd_) {
     return;
@@ -404,6 +485,7 @@ void PinWindow::ResetScaleOpacity() {
   }
   UpdateAlpha();
   Invalidate();
+  NotifyState();
 }
 
 void PinWindow::ApplyScale(int wheel_delta) {
@@ -420,6 +502,7 @@ void PinWindow::ApplyScale(int wheel_delta) {
   SetWindowPos(hwnd_, always_on_top_ ? HWND_TOPMOST : HWND_NOTOPMOST, wr.left,
                wr.top, w, h, SWP_NOACTIVATE);
   Invalidate();
+  NotifyState();
 }
 
 void PinWindow::ApplyOpacity(int wheel_delta) {
@@ -429,6 +512,7 @@ void PinWindow::ApplyOpacity(int wheel_delta) {
   const float dir = wheel_delta > 0 ? 1.0f : -1.0f;
   opacity_ = std::clamp(opacity_ + dir * kOpacityStep, kOpacityMin, kOpacityMax);
   UpdateAlpha();
+  NotifyState();
 }
 
 void PinWindow::ShowContextMenu(POINT screen_pt) {
@@ -462,11 +546,13 @@ void PinWindow::ShowContextMenu(POINT screen_pt) {
   }
   if (cmd == kMenuToggleLock) {
     locked_ = !locked_;
+    NotifyState();
     return;
   }
   if (cmd == kMenuToggleTopMost) {
     always_on_top_ = !always_on_top_;
     UpdateTopMost();
+    NotifyState();
     return;
   }
   if (!on_command_) {
@@ -504,6 +590,12 @@ void PinWindow::NotifyFocus() {
   }
 }
 
+void PinWindow::NotifyState() {
+  if (on_state_ && hwnd_) {
+    on_state_(pin_id_, state());
+  }
+}
+
 } // namespace snappin
 
 
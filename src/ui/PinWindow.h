@@ -26,17 +26,31 @@ public:
     DestroySelf = 4,
     CloseAll = 5,
     DestroyAll = 6,
+    // Posted by PinManager once a restored pin's pixels have been read.
+    RepaintSelf = 7,
+  };
+
+  // What the user can change about a pin window; saved with the session.
+  struct State {
+    PointPX pos_px{};
+    float scale = 1.0f;
+    float opacity = 1.0f;
+    bool locked = false;
+    bool always_on_top = true;
+    bool visible = true;
   };
 
   using FocusCallback = std::function<void(Id64)>;
   using CommandCallback = std::function<void(Id64, Command)>;
+  using StateCallback = std::function<void(Id64, const State&)>;
 
   PinWindow() = default;
   ~PinWindow();
 
-  bool Create(HINSTANCE instance, Id64 pin_id,
-              std::shared_ptr<std::vector<uint8_t>> pixels,
-              const SizePX& size_px, int32_t stride_bytes, const PointPX& pos_px,
+  // Image pins paint the pixels registered under pin_id in
+  // PinPixelStore::Shared() (size_px must match them); text pins pass the
+  // estimated window size.
+  bool Create(HINSTANCE instance, Id64 pin_id, const SizePX& size_px, const PointPX& pos_px,
               ContentKind content_kind = ContentKind::Image,
               const std::wstring& text_payload = L"");
   void Destroy();
@@ -48,21 +62,31 @@ public:
   Id64 pin_id() const;
   bool is_locked() const;
   ContentKind content_kind() const;
+  State state() const;
+  // Applies a saved state (after Create); scale and opacity are clamped.
+  void RestoreState(const State& state);
 
   void SetCallbacks(FocusCallback on_focus, CommandCallback on_command);
+  // Called after a drag ends and whenever scale, opacity, lock, top-most or
+  // visibility change.
+  void SetStateCallback(StateCallback on_state);
+  // Repaints on the next WM_PAINT (e.g. once deferred pixels are loaded).
+  void Invalidate();
 
 private:
   static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam);
   LRESULT HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam);
 
-  void Invalidate();
   void UpdateAlpha();
   void UpdateTopMost();
   void ResetScaleOpacity();
   void ApplyScale(int wheel_delta);
   void ApplyOpacity(int wheel_delta);
   void ShowContextMenu(POINT screen_pt);
+  // Background and text of a text/LaTeX pin, composed in text_canvas_.
+  void PaintText(HDC hdc, int width, int height);
   void NotifyFocus();
+  void NotifyState();
 
   HWND hwnd_ = nullptr;
   HINSTANCE instance_ = nullptr;
@@ -77,15 +101,16 @@ private:
 
   ContentKind content_kind_ = ContentKind::Image;
   std::wstring text_payload_;
-  std::shared_ptr<std::vector<uint8_t>> pixels_;
   SizePX bitmap_size_px_{};
-  int32_t stride_bytes_ = 0;
+  // Client-sized BGRA scratch for PaintText, kept across repaints.
+  std::vector<uint8_t> text_canvas_;
 
   float scale_ = 1.0f;
   float opacity_ = 1.0f;
 
   FocusCallback on_focus_;
   CommandCallback on_command_;
+  StateCallback on_state_;
 };
 
 } // namespace snappin
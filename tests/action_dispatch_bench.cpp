@@ -0,0 +1,119 @@
+#include "ActionTable.h"
+
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Per-invoke lookup and dispatch cost as the number of registered actions
+// grows: the linear Find returning a descriptor copy plus the string if-chain
+// ActionDispatcher used before, against interned handles and the handler
+// table. Not registered with ctest.
+
+namespace {
+
+using snappin::ActionCall;
+using snappin::ActionDescriptor;
+using snappin::ActionInvoke;
+
+volatile int g_sink = 0;
+
+std::string IdFor(int i) { return "module" + std::to_string(i % 8) + ".action_" + std::to_string(i); }
+
+ActionDescriptor MakeDesc(int i) {
+  ActionDescriptor d;
+  d.id = IdFor(i);
+  d.title = "Action";
+  d.description = "Benchmark action";
+  d.contexts = {snappin::ActionContext::GLOBAL, snappin::ActionContext::OVERLAY};
+  d.params.push_back({"path", "string", "", false});
+  return d;
+}
+
+std::optional<ActionDescriptor> LegacyFind(const std::vector<ActionDescriptor>& actions,
+                                           const std::string& id) {
+  for (const auto& action : actions) {
+    if (action.id == id) {
+      return action;
+    }
+  }
+  return std::nullopt;
+}
+
+// The old ExecuteAction: one comparison per action until the match.
+snappin::Result<void> LegacyExecute(const std::vector<std::string>& chain,
+                                    const ActionInvoke& req) {
+  for (size_t i = 0; i < chain.size(); ++i) {
+    if (req.id == chain[i]) {
+      g_sink = g_sink + static_cast<int>(i);
+      return snappin::Result<void>::Ok();
+    }
+  }
+  return snappin::Result<void>::Fail(snappin::Error{});
+}
+
+template <typename Fn>
+double NsPerCall(int calls, Fn&& fn) {
+  double best = 1e30;
+  for (int round = 0; round < 5; ++round) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+      fn(i);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+    if (ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+} // namespace
+
+int main() {
+  std::printf("%8s %14s %14s\n", "actions", "legacy ns", "table ns");
+  for (int count : {16, 64, 256, 1024}) {
+    std::vector<ActionDescriptor> legacy;
+    std::vector<std::string> chain;
+    snappin::ActionTable table;
+    snappin::ActionHandlerTable handlers;
+    for (int i = 0; i < count; ++i) {
+      legacy.push_back(MakeDesc(i));
+      chain.push_back(IdFor(i));
+      const snappin::ActionHandle h = table.Add(MakeDesc(i));
+      handlers.Set(h, [i](ActionCall&) {
+        g_sink = g_sink + i;
+        return snappin::Result<void>::Ok();
+      });
+    }
+    // Invoke a spread of actions, as hotkeys and toolbar buttons do.
+    std::vector<ActionInvoke> requests(64);
+    for (size_t r = 0; r < requests.size(); ++r) {
+      requests[r].id = IdFor(static_cast<int>((r * 7919) % static_cast<size_t>(count)));
+    }
+    const int calls = 200000;
+
+    const double legacy_ns = NsPerCall(calls, [&](int i) {
+      const ActionInvoke& req = requests[static_cast<size_t>(i) & 63];
+      std::optional<ActionDescriptor> desc = LegacyFind(legacy, req.id);
+      if (desc.has_value() && !desc->contexts.empty()) {
+        LegacyExecute(chain, req);
+      }
+    });
+    const double table_ns = NsPerCall(calls, [&](int i) {
+      const ActionInvoke& req = requests[static_cast<size_t>(i) & 63];
+      const snappin::ActionHandle handle = table.Lookup(req.id);
+      const ActionDescriptor* desc = table.Find(handle);
+      if (desc && !desc->contexts.empty()) {
+        ActionCall call{req, handle, snappin::Id64{1}};
+        if (const snappin::ActionHandler* handler = handlers.Get(handle)) {
+          (*handler)(call);
+        }
+      }
+    });
+    std::printf("%8d %14.1f %14.1f\n", count, legacy_ns, table_ns);
+  }
+  return 0;
+}
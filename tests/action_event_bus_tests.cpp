@@ -0,0 +1,234 @@
+#include "ActionEventBus.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using snappin::ActionEvent;
+using snappin::ActionEventBus;
+using snappin::ActionEventBusStats;
+using snappin::ActionEventFilter;
+using snappin::EventDelivery;
+
+ActionEvent MakeEvent(const std::string& id, ActionEvent::Type type,
+                      uint64_t correlation = 0) {
+  ActionEvent ev{};
+  ev.action_id = id;
+  ev.type = type;
+  ev.correlation_id.value = correlation;
+  return ev;
+}
+
+// Polls, since async delivery has no completion signal of its own.
+template <typename Pred>
+bool WaitFor(Pred&& pred) {
+  for (int i = 0; i < 5000; ++i) {
+    if (pred()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return pred();
+}
+
+int TestFiltersAndUnsubscribe() {
+  ActionEventBus bus;
+  bus.Emit(MakeEvent("capture.start", ActionEvent::Type::Started));
+  int all = 0;
+  int capture = 0;
+  int finished = 0;
+  const auto all_id = bus.Subscribe([&](const ActionEvent&) { ++all; });
+  const auto capture_id = bus.Subscribe([&](const ActionEvent&) { ++capture; },
+                                        ActionEventFilter::ForAction("capture.start"));
+  ActionEventFilter done = ActionEventFilter::ForTypes(
+      {ActionEvent::Type::Succeeded, ActionEvent::Type::Failed});
+  done.action_id = "export.save_image";
+  bus.Subscribe([&](const ActionEvent&) { ++finished; }, done);
+  if (all_id == 0 || capture_id == all_id || bus.Subscribe(nullptr) != 0 ||
+      bus.subscriber_count() != 3) {
+    return 1;
+  }
+  bus.Emit(MakeEvent("capture.start", ActionEvent::Type::Started));
+  bus.Emit(MakeEvent("capture.start", ActionEvent::Type::Succeeded));
+  bus.Emit(MakeEvent("export.save_image", ActionEvent::Type::Progress));
+  bus.Emit(MakeEvent("export.save_image", ActionEvent::Type::Succeeded));
+  bus.Emit(MakeEvent("export.save_imagex", ActionEvent::Type::Failed));
+  if (all != 5 || capture != 2 || finished != 1) {
+    return 2;
+  }
+  if (!done.Matches(MakeEvent("export.save_image", ActionEvent::Type::Failed)) ||
+      done.Matches(MakeEvent("export.save_image", ActionEvent::Type::Started))) {
+    return 3;
+  }
+  // Removal takes effect for the next Emit on this thread.
+  if (!bus.Unsubscribe(capture_id) || bus.Unsubscribe(capture_id) ||
+      bus.subscriber_count() != 2) {
+    return 4;
+  }
+  bus.Emit(MakeEvent("capture.start", ActionEvent::Type::Started));
+  if (all != 6 || capture != 2) {
+    return 5;
+  }
+  return 0;
+}
+
+// Callbacks may emit and subscribe; the list being walked stays intact.
+int TestReentrancy() {
+  ActionEventBus bus;
+  std::vector<std::string> seen;
+  bool subscribed = false;
+  bus.Subscribe([&](const ActionEvent& ev) {
+    seen.push_back(ev.action_id);
+    if (ev.action_id == "outer") {
+      if (!subscribed) {
+        subscribed = true;
+        bus.Subscribe(
+            [&](const ActionEvent& inner) { seen.push_back("late:" + inner.action_id); });
+      }
+      bus.Emit(MakeEvent("inner", ActionEvent::Type::Started));
+    }
+  });
+  bus.Subscribe([&](const ActionEvent& ev) { seen.push_back("second:" + ev.action_id); });
+  bus.Emit(MakeEvent("outer", ActionEvent::Type::Started));
+  const std::vector<std::string> expected = {"outer", "inner", "second:inner", "late:inner",
+                                             "second:outer"};
+  if (seen != expected) {
+    return 10;
+  }
+  return 0;
+}
+
+int TestAsyncDelivery() {
+  ActionEventBus bus;
+  const std::thread::id emitter = std::this_thread::get_id();
+  std::mutex mu;
+  std::vector<uint64_t> order;
+  bool other_thread = true;
+  bus.Subscribe(
+      [&](const ActionEvent& ev) {
+        std::lock_guard<std::mutex> lock(mu);
+        order.push_back(ev.correlation_id.value);
+        other_thread = other_thread && std::this_thread::get_id() != emitter;
+      },
+      ActionEventFilter::ForTypes({ActionEvent::Type::Progress}), EventDelivery::Async, 1024);
+  for (uint64_t i = 0; i < 1000; ++i) {
+    bus.Emit(MakeEvent("export.save_image", ActionEvent::Type::Progress, i));
+    bus.Emit(MakeEvent("export.save_image", ActionEvent::Type::Started, i));
+  }
+  if (!WaitFor([&] { return bus.Stats().async_delivered == 1000; })) {
+    return 20;
+  }
+  std::lock_guard<std::mutex> lock(mu);
+  // One producer: delivered in order.
+  for (uint64_t i = 0; i < order.size(); ++i) {
+    if (order[i] != i || order.size() != 1000 || !other_thread) {
+      return 21;
+    }
+  }
+  return 0;
+}
+
+// A stuck subscriber loses events instead of blocking the emitter.
+int TestAsyncOverflow() {
+  ActionEventBus bus;
+  std::mutex mu;
+  std::condition_variable cv;
+  bool release = false;
+  std::atomic<int> got{0};
+  const auto id = bus.Subscribe(
+      [&](const ActionEvent&) {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return release; });
+        got.fetch_add(1);
+      },
+      {}, EventDelivery::Async, 5);
+  for (int i = 0; i < 100; ++i) {
+    bus.Emit(MakeEvent("pin.copy_focused", ActionEvent::Type::Started));
+  }
+  ActionEventBusStats stats = bus.Stats();
+  // Capacity rounds up to 8; the first event may already be in the callback.
+  if (stats.async_subscribers != 1 || stats.async_dropped < 91 || stats.async_dropped > 92 ||
+      stats.async_pending < 8) {
+    return 30;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    release = true;
+  }
+  cv.notify_all();
+  // Unsubscribe delivers what was queued before returning.
+  const int expected = static_cast<int>(100 - stats.async_dropped);
+  if (!bus.Unsubscribe(id) || got.load() != expected || bus.subscriber_count() != 0) {
+    return 31;
+  }
+  return 0;
+}
+
+// Emitters on several threads while subscriptions come and go.
+int TestConcurrentChurn() {
+  ActionEventBus bus;
+  std::atomic<uint64_t> sync_calls{0};
+  std::atomic<uint64_t> async_calls{0};
+  bus.Subscribe([&](const ActionEvent&) { sync_calls.fetch_add(1); });
+  bus.Subscribe([&](const ActionEvent&) { async_calls.fetch_add(1); }, {},
+                EventDelivery::Async, 1 << 16);
+  std::atomic<bool> done{false};
+  std::thread churn([&] {
+    while (!done.load()) {
+      const auto a = bus.Subscribe([](const ActionEvent&) {},
+                                   ActionEventFilter::ForAction("capture.start"));
+      const auto b = bus.Subscribe([](const ActionEvent&) {}, {}, EventDelivery::Async, 16);
+      bus.Unsubscribe(a);
+      bus.Unsubscribe(b);
+    }
+  });
+  const int kThreads = 4;
+  const int kEvents = 5000;
+  std::vector<std::thread> emitters;
+  for (int t = 0; t < kThreads; ++t) {
+    emitters.emplace_back([&bus, t] {
+      for (int i = 0; i < kEvents; ++i) {
+        bus.Emit(MakeEvent(i % 2 ? "capture.start" : "export.copy_image",
+                           ActionEvent::Type::Started, static_cast<uint64_t>(t)));
+      }
+    });
+  }
+  for (auto& t : emitters) {
+    t.join();
+  }
+  done.store(true);
+  churn.join();
+  const uint64_t total = uint64_t{kThreads} * kEvents;
+  if (sync_calls.load() != total ||
+      !WaitFor([&] { return async_calls.load() == total; }) ||
+      bus.subscriber_count() != 2) {
+    return 40;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  int rc = TestFiltersAndUnsubscribe();
+  if (rc == 0) {
+    rc = TestReentrancy();
+  }
+  if (rc == 0) {
+    rc = TestAsyncDelivery();
+  }
+  if (rc == 0) {
+    rc = TestAsyncOverflow();
+  }
+  if (rc == 0) {
+    rc = TestConcurrentChurn();
+  }
+  return rc;
+}
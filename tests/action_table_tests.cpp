@@ -0,0 +1,91 @@
+#include "ActionTable.h"
+
+#include <string>
+
+namespace {
+
+using snappin::ActionCall;
+using snappin::ActionDescriptor;
+using snappin::ActionHandle;
+using snappin::ActionInvoke;
+using snappin::ActionTable;
+
+ActionDescriptor MakeDesc(const std::string& id) {
+  ActionDescriptor d;
+  d.id = id;
+  d.title = "title " + id;
+  d.contexts = {snappin::ActionContext::GLOBAL};
+  return d;
+}
+
+} // namespace
+
+int main() {
+  ActionTable table;
+  if (table.Lookup("app.exit").valid() || table.Find(ActionHandle{}) ||
+      table.Find("app.exit")) {
+    return 1;
+  }
+
+  // Handles are dense and follow registration order.
+  constexpr int kCount = 5000;
+  for (int i = 0; i < kCount; ++i) {
+    const ActionHandle h = table.Add(MakeDesc("module" + std::to_string(i % 7) + ".action_" +
+                                              std::to_string(i)));
+    if (!h.valid() || h.value != static_cast<uint32_t>(i)) {
+      return 2;
+    }
+  }
+  if (table.ListAll().size() != kCount) {
+    return 3;
+  }
+  for (int i = 0; i < kCount; ++i) {
+    const std::string id = "module" + std::to_string(i % 7) + ".action_" + std::to_string(i);
+    const ActionHandle h = table.Lookup(id);
+    const ActionDescriptor* desc = table.Find(h);
+    if (h.value != static_cast<uint32_t>(i) || !desc || desc->id != id ||
+        desc != &table.ListAll()[static_cast<size_t>(i)] || table.Find(id) != desc) {
+      return 4;
+    }
+  }
+
+  // Duplicate and empty ids are refused; near-misses are not found.
+  if (table.Add(MakeDesc("module0.action_0")).valid() || table.Add(MakeDesc("")).valid() ||
+      table.ListAll().size() != kCount) {
+    return 5;
+  }
+  if (table.Lookup("module0.action_").valid() || table.Lookup("module0.action_00").valid() ||
+      table.Lookup("").valid() || table.Find(ActionHandle{kCount})) {
+    return 6;
+  }
+
+  // Handlers are indexed by handle and may be replaced.
+  snappin::ActionHandlerTable handlers;
+  const ActionHandle target = table.Lookup("module2.action_1234");
+  if (!target.valid() || handlers.Get(target) || handlers.Set(ActionHandle{}, nullptr)) {
+    return 7;
+  }
+  int calls = 0;
+  handlers.Set(target, [&calls](ActionCall& call) {
+    calls += 1;
+    call.deferred = true;
+    return snappin::Result<void>::Ok();
+  });
+  handlers.Set(target, [&calls](ActionCall& call) {
+    calls += 10;
+    call.deferred = call.req.kv.size() == 1;
+    return snappin::Result<void>::Ok();
+  });
+  if (handlers.Get(table.Lookup("module1.action_1233"))) {
+    return 8;
+  }
+  ActionInvoke req;
+  req.id = "module2.action_1234";
+  req.kv.push_back({"k", "v"});
+  ActionCall call{req, target, snappin::Id64{1}};
+  const snappin::ActionHandler* handler = handlers.Get(table.Lookup(req.id));
+  if (!handler || !(*handler)(call).ok || calls != 10 || !call.deferred) {
+    return 9;
+  }
+  return 0;
+}
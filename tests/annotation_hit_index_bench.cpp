@@ -0,0 +1,102 @@
+#include "AnnotationHitIndex.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Pointer hit-test cost on a 4K canvas against the number of freehand strokes
+// (64 segments each): a topmost-first walk testing every segment, as the
+// annotate window used to do, against the grid index. Also reports the cost
+// of re-indexing one stroke after it moves. Not registered with ctest.
+
+namespace {
+
+using snappin::HitShape;
+using snappin::PointPX;
+
+volatile uint64_t g_sink = 0;
+
+template <typename Fn>
+double NsPerCall(int calls, Fn&& fn) {
+  double best = 1e30;
+  for (int round = 0; round < 5; ++round) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+      fn(i);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+    if (ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+} // namespace
+
+int main() {
+  std::printf("%8s %12s %12s %12s %12s %12s\n", "strokes", "build ms", "linear ns",
+              "index ns", "update ns", "cell refs");
+  for (int count : {100, 1000, 4000}) {
+    std::mt19937 rng(static_cast<uint32_t>(count));
+    std::uniform_int_distribution<int32_t> x(0, 3839);
+    std::uniform_int_distribution<int32_t> y(0, 2159);
+    std::uniform_int_distribution<int32_t> step(-12, 12);
+    std::vector<std::vector<HitShape>> strokes;
+    for (int i = 0; i < count; ++i) {
+      std::vector<HitShape> shapes;
+      PointPX p{x(rng), y(rng)};
+      for (int s = 0; s < 64; ++s) {
+        const PointPX q{p.x + step(rng), p.y + step(rng)};
+        HitShape cap;
+        cap.kind = HitShape::Kind::Capsule;
+        cap.a = p;
+        cap.b = q;
+        cap.radius = 8;
+        shapes.push_back(cap);
+        p = q;
+      }
+      strokes.push_back(std::move(shapes));
+    }
+    std::vector<PointPX> points(4096);
+    for (PointPX& pt : points) {
+      pt = PointPX{x(rng), y(rng)};
+    }
+
+    snappin::AnnotationHitIndex index;
+    const auto b0 = std::chrono::steady_clock::now();
+    index.Reset({3840, 2160});
+    for (size_t i = 0; i < strokes.size(); ++i) {
+      index.Insert(i, strokes[i]);
+    }
+    const auto b1 = std::chrono::steady_clock::now();
+    const double build_ms = std::chrono::duration<double, std::milli>(b1 - b0).count();
+
+    const double linear_ns = NsPerCall(static_cast<int>(points.size()), [&](int i) {
+      const PointPX& pt = points[static_cast<size_t>(i)];
+      for (size_t s = strokes.size(); s-- > 0;) {
+        for (const HitShape& shape : strokes[s]) {
+          if (shape.Contains(pt)) {
+            g_sink = g_sink + s;
+            return;
+          }
+        }
+      }
+    });
+    std::vector<size_t> hits;
+    const double index_ns = NsPerCall(static_cast<int>(points.size()), [&](int i) {
+      index.HitsAt(points[static_cast<size_t>(i)], &hits);
+      g_sink = g_sink + hits.size();
+    });
+    const double update_ns = NsPerCall(256, [&](int i) {
+      const size_t pos = static_cast<size_t>(i) % strokes.size();
+      index.Update(pos, strokes[pos]);
+    });
+    std::printf("%8d %12.2f %12.1f %12.1f %12.1f %12zu\n", count, build_ms, linear_ns,
+                index_ns, update_ns, index.cell_refs());
+  }
+  return 0;
+}
@@ -0,0 +1,186 @@
+#include "AnnotationHitIndex.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+using snappin::AnnotationHitIndex;
+using snappin::HitShape;
+using snappin::PointPX;
+
+std::vector<size_t> BruteHits(const std::vector<std::vector<HitShape>>& items,
+                              const PointPX& pt) {
+  std::vector<size_t> out;
+  for (size_t i = items.size(); i-- > 0;) {
+    for (const HitShape& s : items[i]) {
+      if (s.Contains(pt)) {
+        out.push_back(i);
+        break;
+      }
+    }
+  }
+  return out;
+}
+
+HitShape Box(int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+  HitShape s;
+  s.kind = HitShape::Kind::Box;
+  s.a = {x0, y0};
+  s.b = {x1, y1};
+  return s;
+}
+
+HitShape Capsule(PointPX a, PointPX b, int32_t radius) {
+  HitShape s;
+  s.kind = HitShape::Kind::Capsule;
+  s.a = a;
+  s.b = b;
+  s.radius = radius;
+  return s;
+}
+
+int TestShapes() {
+  const HitShape box = Box(10, 20, 30, 40);
+  if (!box.Contains({10, 20}) || !box.Contains({30, 40}) || box.Contains({31, 40}) ||
+      box.Contains({9, 25})) {
+    return 1;
+  }
+  const HitShape cap = Capsule({0, 0}, {100, 0}, 8);
+  if (!cap.Contains({50, 8}) || cap.Contains({50, 9}) || !cap.Contains({-8, 0}) ||
+      cap.Contains({106, 6})) {
+    return 2;
+  }
+  const HitShape dot = Capsule({5, 5}, {5, 5}, 3);
+  if (!dot.Contains({8, 5}) || dot.Contains({8, 8})) {
+    return 3;
+  }
+  return 0;
+}
+
+int TestOrderAndEdits() {
+  AnnotationHitIndex index;
+  index.Reset({400, 300});
+  index.Insert(0, {Box(0, 0, 200, 200)});
+  index.Insert(1, {Box(100, 100, 300, 250)});
+  std::vector<size_t> hits;
+  index.HitsAt({150, 150}, &hits);
+  if (hits != std::vector<size_t>{1, 0}) {
+    return 10;
+  }
+  // Insert below both: positions shift up.
+  index.Insert(0, {Capsule({0, 150}, {399, 150}, 4)});
+  index.HitsAt({150, 150}, &hits);
+  if (hits != std::vector<size_t>{2, 1, 0}) {
+    return 11;
+  }
+  index.Erase(1);
+  index.HitsAt({150, 150}, &hits);
+  if (hits != std::vector<size_t>{1, 0} || index.size() != 2) {
+    return 12;
+  }
+  index.Update(1, {Box(350, 0, 399, 50)});
+  index.HitsAt({150, 150}, &hits);
+  if (hits != std::vector<size_t>{0}) {
+    return 13;
+  }
+  index.HitsAt({360, 10}, &hits);
+  if (hits != std::vector<size_t>{1}) {
+    return 14;
+  }
+  // Shapes beyond the canvas land in the border cells.
+  index.Insert(2, {Box(-50, -50, -10, -10)});
+  index.HitsAt({-20, -20}, &hits);
+  if (hits != std::vector<size_t>{2}) {
+    return 15;
+  }
+  index.Clear();
+  index.HitsAt({150, 150}, &hits);
+  if (!hits.empty() || index.size() != 0 || index.cell_refs() != 0) {
+    return 16;
+  }
+  return 0;
+}
+
+int TestMatchesBruteForce() {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int32_t> xs(-40, 1320);
+  std::uniform_int_distribution<int32_t> ys(-40, 760);
+  std::uniform_int_distribution<int32_t> step(-30, 30);
+  const auto random_item = [&]() {
+    std::vector<HitShape> shapes;
+    switch (rng() % 3) {
+      case 0: {
+        const int32_t x = xs(rng);
+        const int32_t y = ys(rng);
+        shapes.push_back(Box(x, y, x + static_cast<int32_t>(rng() % 300),
+                             y + static_cast<int32_t>(rng() % 200)));
+        break;
+      }
+      case 1:
+        shapes.push_back(Capsule({xs(rng), ys(rng)}, {xs(rng), ys(rng)},
+                                 static_cast<int32_t>(rng() % 12)));
+        break;
+      default: {
+        PointPX p{xs(rng), ys(rng)};
+        const int n = 1 + static_cast<int>(rng() % 80);
+        for (int i = 0; i < n; ++i) {
+          const PointPX q{p.x + step(rng), p.y + step(rng)};
+          shapes.push_back(Capsule(p, q, 6));
+          p = q;
+        }
+        break;
+      }
+    }
+    return shapes;
+  };
+
+  AnnotationHitIndex index;
+  index.Reset({1280, 720});
+  std::vector<std::vector<HitShape>> items;
+  std::vector<size_t> hits;
+  for (int round = 0; round < 3000; ++round) {
+    const int op = static_cast<int>(rng() % 10);
+    if (op < 5 || items.empty()) {
+      const size_t pos = rng() % (items.size() + 1);
+      std::vector<HitShape> shapes = random_item();
+      items.insert(items.begin() + static_cast<std::ptrdiff_t>(pos), shapes);
+      index.Insert(pos, std::move(shapes));
+    } else if (op < 7) {
+      const size_t pos = rng() % items.size();
+      items.erase(items.begin() + static_cast<std::ptrdiff_t>(pos));
+      index.Erase(pos);
+    } else {
+      const size_t pos = rng() % items.size();
+      items[pos] = random_item();
+      index.Update(pos, items[pos]);
+    }
+    if (index.size() != items.size()) {
+      return 20;
+    }
+    for (int q = 0; q < 8; ++q) {
+      const PointPX pt{xs(rng), ys(rng)};
+      index.HitsAt(pt, &hits);
+      if (hits != BruteHits(items, pt)) {
+        return 21;
+      }
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestShapes()) {
+    return rc;
+  }
+  if (int rc = TestOrderAndEdits()) {
+    return rc;
+  }
+  if (int rc = TestMatchesBruteForce()) {
+    return rc;
+  }
+  return 0;
+}
@@ -0,0 +1,170 @@
+#include "ArtifactStore.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using snappin::Artifact;
+using snappin::ArtifactStore;
+using snappin::BitmapView;
+using snappin::Id64;
+
+constexpr size_t kBytes = 16 * 16 * 4;
+
+Artifact MakeArtifact(uint64_t id, uint8_t fill) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(kBytes, fill);
+  Artifact art;
+  art.artifact_id = Id64{id};
+  art.base_cpu = BitmapView::FromBuffer(bytes, {16, 16}, 16 * 4);
+  art.screen_rect_px = {0, 0, 16, 16};
+  return art;
+}
+
+int TestSharedImmutableReads() {
+  ArtifactStore store;
+  store.Put(MakeArtifact(1, 7));
+  auto a = store.Get(Id64{1});
+  auto b = store.Get(Id64{1});
+  if (!a || a.get() != b.get() || a->base_cpu.data()[0] != 7) {
+    return 1;
+  }
+  // Replacing publishes a new object; earlier readers keep their snapshot.
+  Artifact edited = *a;
+  edited.base_cpu = MakeArtifact(1, 9).base_cpu;
+  store.Put(std::move(edited));
+  auto c = store.Get(Id64{1});
+  if (!c || c.get() == a.get() || c->base_cpu.data()[0] != 9 || a->base_cpu.data()[0] != 7) {
+    return 2;
+  }
+  if (store.Stats().resident_bytes != kBytes || store.Stats().count != 1) {
+    return 3;
+  }
+  if (store.Get(Id64{42})) {
+    return 4;
+  }
+  return 0;
+}
+
+int TestLruEvictionSparesActiveAndPinned() {
+  ArtifactStore store(3 * kBytes);
+  store.Put(MakeArtifact(1, 1));
+  store.Put(MakeArtifact(2, 2));
+  store.Put(MakeArtifact(3, 3));
+  store.AddPinRef(Id64{1});
+  auto held = store.Get(Id64{3});
+  store.Get(Id64{2}); // 3 is now the least recently used unpinned one
+  store.Put(MakeArtifact(4, 4));
+  // 1 is pinned, 4 is active, 2 was touched more recently than 3.
+  if (store.Get(Id64{3}) || !store.Get(Id64{1}) || !store.Get(Id64{2}) ||
+      !store.Get(Id64{4})) {
+    return 10;
+  }
+  // Eviction only drops the store's reference.
+  if (held->base_cpu.data()[0] != 3) {
+    return 11;
+  }
+  snappin::ArtifactStoreStats stats = store.Stats();
+  if (stats.count != 3 || stats.resident_bytes != 3 * kBytes || stats.evictions != 1) {
+    return 12;
+  }
+
+  // Shrinking the budget keeps only what is protected.
+  store.SetBudgetBytes(0);
+  if (store.Stats().count != 2 || store.Get(Id64{2}) || !store.Get(Id64{1}) ||
+      store.ActiveId()->value != 4) {
+    return 13;
+  }
+  store.ClearActive();
+  if (store.Get(Id64{4}) || !store.Get(Id64{1})) {
+    return 14;
+  }
+  // Pin references are counted; the last release makes it evictable.
+  store.AddPinRef(Id64{1});
+  store.ReleasePinRef(Id64{1});
+  if (!store.Get(Id64{1})) {
+    return 15;
+  }
+  store.ReleasePinRef(Id64{1});
+  stats = store.Stats();
+  if (store.Get(Id64{1}) || stats.count != 0 || stats.resident_bytes != 0) {
+    return 16;
+  }
+  // Unknown ids are ignored.
+  store.AddPinRef(Id64{99});
+  store.ReleasePinRef(Id64{99});
+  return 0;
+}
+
+int TestPinSurvivesReplace() {
+  ArtifactStore store(kBytes);
+  store.Put(MakeArtifact(1, 1));
+  store.AddPinRef(Id64{1});
+  store.Put(MakeArtifact(1, 2));
+  store.Put(MakeArtifact(2, 3));
+  if (!store.Get(Id64{1}) || !store.Get(Id64{2})) {
+    return 20;
+  }
+  return 0;
+}
+
+int TestConcurrentAccess() {
+  ArtifactStore store(8 * kBytes);
+  std::atomic<bool> stop{false};
+  std::atomic<bool> bad{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&, t] {
+      uint64_t i = static_cast<uint64_t>(t);
+      while (!stop.load()) {
+        const uint64_t id = 1 + (i++ % 64);
+        if (auto art = store.Get(Id64{id})) {
+          // Every artifact's pixels are filled with its id.
+          if (art->artifact_id.value != id ||
+              art->base_cpu.data()[kBytes - 1] != static_cast<uint8_t>(id)) {
+            bad = true;
+          }
+        }
+        if (id % 5 == 0) {
+          store.AddPinRef(Id64{id});
+          store.ReleasePinRef(Id64{id});
+        }
+      }
+    });
+  }
+  for (int round = 0; round < 200; ++round) {
+    for (uint64_t id = 1; id <= 64; ++id) {
+      store.Put(MakeArtifact(id, static_cast<uint8_t>(id)));
+    }
+  }
+  stop = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  const snappin::ArtifactStoreStats stats = store.Stats();
+  if (bad.load() || stats.resident_bytes > stats.budget_bytes || stats.count != 8) {
+    return 30;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestSharedImmutableReads()) {
+    return rc;
+  }
+  if (int rc = TestLruEvictionSparesActiveAndPinned()) {
+    return rc;
+  }
+  if (int rc = TestPinSurvivesReplace()) {
+    return rc;
+  }
+  if (int rc = TestConcurrentAccess()) {
+    return rc;
+  }
+  return 0;
+}
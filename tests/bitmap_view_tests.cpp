@@ -0,0 +1,124 @@
+#include "Types.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using snappin::BitmapView;
+using snappin::RectPX;
+using snappin::SizePX;
+
+std::shared_ptr<std::vector<uint8_t>> MakeFrame(int32_t w, int32_t h, int32_t stride) {
+  auto buffer = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(stride) *
+                                                       static_cast<size_t>(h));
+  for (int32_t y = 0; y < h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      uint8_t* px = buffer->data() + static_cast<size_t>(y) * stride +
+                    static_cast<size_t>(x) * 4;
+      px[0] = static_cast<uint8_t>(x);
+      px[1] = static_cast<uint8_t>(y);
+      px[2] = static_cast<uint8_t>(x ^ y);
+      px[3] = 0xFF;
+    }
+  }
+  return buffer;
+}
+
+} // namespace
+
+int main() {
+  // Invalid construction yields an empty view.
+  if (BitmapView().valid()) {
+    return 1;
+  }
+  auto small = std::make_shared<std::vector<uint8_t>>(15);
+  if (BitmapView::FromBuffer(small, SizePX{2, 2}, 8).valid()) {
+    return 2;
+  }
+  if (BitmapView::FromBuffer(MakeFrame(3, 4, 16), SizePX{4, 4}, 12).valid()) {
+    return 3;
+  }
+
+  auto buffer = MakeFrame(64, 32, 64 * 4 + 16);
+  const uint8_t* raw = buffer->data();
+  const BitmapView frame = BitmapView::FromBuffer(buffer, SizePX{64, 32}, 64 * 4 + 16);
+  buffer.reset();
+  if (!frame.valid() || frame.data() != raw || frame.size_px().w != 64 ||
+      frame.stride_bytes() != 64 * 4 + 16) {
+    return 4;
+  }
+
+  // Copies and crops share the buffer; nothing is duplicated.
+  const BitmapView copy = frame;
+  const BitmapView crop = frame.Crop(RectPX{10, 5, 20, 7});
+  if (!copy.SharesBufferWith(frame) || !crop.SharesBufferWith(frame) ||
+      frame.use_count() != 3) {
+    return 5;
+  }
+  if (crop.size_px().w != 20 || crop.size_px().h != 7 ||
+      crop.stride_bytes() != frame.stride_bytes() ||
+      crop.data() != raw + 5 * frame.stride_bytes() + 10 * 4) {
+    return 6;
+  }
+  if (crop.row(2)[0] != 10 || crop.row(2)[1] != 7) {
+    return 7;
+  }
+
+  // Crops are clipped; fully outside is empty.
+  const BitmapView clipped = frame.Crop(RectPX{-8, 30, 20, 20});
+  if (clipped.size_px().w != 12 || clipped.size_px().h != 2 || clipped.row(0)[1] != 30) {
+    return 8;
+  }
+  if (frame.Crop(RectPX{64, 0, 4, 4}).valid() || frame.Crop(RectPX{0, 0, 0, 4}).valid()) {
+    return 9;
+  }
+  const BitmapView nested = crop.Crop(RectPX{3, 1, 100, 100});
+  if (nested.size_px().w != 17 || nested.size_px().h != 6 || nested.row(0)[0] != 13 ||
+      nested.row(0)[1] != 6) {
+    return 10;
+  }
+  if (crop.span_bytes() !=
+      static_cast<size_t>(crop.stride_bytes()) * 6 + static_cast<size_t>(20) * 4) {
+    return 11;
+  }
+
+  // Clone is a packed deep copy with identical pixels.
+  const BitmapView cloned = crop.Clone();
+  if (!cloned.valid() || cloned.SharesBufferWith(frame) ||
+      cloned.stride_bytes() != 20 * 4) {
+    return 12;
+  }
+  for (int32_t y = 0; y < 7; ++y) {
+    for (int32_t i = 0; i < 20 * 4; ++i) {
+      if (cloned.row(y)[i] != crop.row(y)[i]) {
+        return 13;
+      }
+    }
+  }
+
+  // A crop keeps the frame alive after every other holder is gone.
+  std::weak_ptr<std::vector<uint8_t>> weak;
+  BitmapView survivor;
+  {
+    auto temp = MakeFrame(8, 8, 32);
+    weak = temp;
+    survivor = BitmapView::FromBuffer(std::move(temp), SizePX{8, 8}, 32).Crop(
+        RectPX{2, 2, 2, 2});
+  }
+  if (weak.expired() || survivor.row(1)[0] != 2 || survivor.row(1)[1] != 3) {
+    return 14;
+  }
+  survivor = BitmapView();
+  if (!weak.expired()) {
+    return 15;
+  }
+
+  const snappin::CpuBitmap bmp = crop.AsCpuBitmap();
+  if (bmp.data.p != crop.data() || bmp.stride_bytes != crop.stride_bytes() ||
+      bmp.size_px.w != 20) {
+    return 16;
+  }
+  return 0;
+}
@@ -0,0 +1,300 @@
+#include "CaptureHistoryStore.h"
+#include "test_pixels.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using snappin::Artifact;
+using snappin::BitmapView;
+using snappin::CaptureHistoryEntry;
+using snappin::CaptureHistoryStats;
+using snappin::CaptureHistoryStore;
+using snappin::PixelFormat;
+using snappin::SizePX;
+using snappin::testing::NoiseImage;
+using snappin::testing::SameRows;
+
+Artifact MakeArtifact(uint64_t id, BitmapView pixels) {
+  Artifact artifact;
+  artifact.artifact_id.value = id;
+  artifact.screen_rect_px = {static_cast<int32_t>(id) * 10, -20, pixels.size_px().w,
+                             pixels.size_px().h};
+  artifact.dpi_scale = 1.5f;
+  artifact.base_cpu = std::move(pixels);
+  return artifact;
+}
+
+size_t SegmentFiles(const fs::path& dir) {
+  size_t count = 0;
+  for (const auto& item : fs::directory_iterator(dir)) {
+    count += item.path().extension() == ".hist" ? 1 : 0;
+  }
+  return count;
+}
+
+fs::path NewestSegment(const fs::path& dir) {
+  fs::path newest;
+  for (const auto& item : fs::directory_iterator(dir)) {
+    if (item.path().extension() == ".hist" && item.path() > newest) {
+      newest = item.path();
+    }
+  }
+  return newest;
+}
+
+int TestAppendAndReopen(const fs::path& dir) {
+  const BitmapView wide = NoiseImage(600, 300, 1);
+  const BitmapView small = NoiseImage(50, 40, 2, 0, PixelFormat::RGBA8);
+  const BitmapView tall = NoiseImage(90, 700, 3);
+  uint64_t seqs[3] = {};
+  {
+    CaptureHistoryStore store;
+    if (store.Append(MakeArtifact(1, wide)) != 0 || store.Open(dir, 0)) {
+      return 1;
+    }
+    if (!store.Open(dir, uint64_t{64} << 20)) {
+      return 2;
+    }
+    seqs[0] = store.Append(MakeArtifact(11, wide));
+    seqs[1] = store.Append(MakeArtifact(12, small));
+    seqs[2] = store.Append(MakeArtifact(13, tall));
+    if (seqs[0] != 1 || seqs[1] != 2 || seqs[2] != 3 || store.Append(Artifact{}) != 0) {
+      return 3;
+    }
+    // Indexed and readable before the writer gets to them.
+    CaptureHistoryEntry entry;
+    if (store.size() != 3 || !store.NthNewest(0, &entry) || entry.seq != 3 ||
+        !SameRows(store.Load(seqs[1]), small)) {
+      return 4;
+    }
+    if (!store.Flush()) {
+      return 5;
+    }
+    if (!store.Find(seqs[0], &entry) || entry.pending || entry.artifact_id.value != 11 ||
+        entry.screen_rect_px.x != 110 || entry.dpi_scale != 1.5f ||
+        entry.thumbnail.size_px().w != 128 || entry.thumbnail.size_px().h != 64 ||
+        entry.stored_bytes == 0 || entry.captured_at_ms == 0) {
+      return 6;
+    }
+    if (!store.Find(seqs[2], &entry) || entry.thumbnail.size_px().w != 16 ||
+        entry.thumbnail.size_px().h != 128) {
+      return 7;
+    }
+    // Small captures are their own thumbnail.
+    if (!store.Find(seqs[1], &entry) || !SameRows(entry.thumbnail, small)) {
+      return 8;
+    }
+    if (!SameRows(store.Load(seqs[0]), wide) || store.Stats().records_written != 3) {
+      return 9;
+    }
+  }
+
+  CaptureHistoryStore store;
+  if (!store.Open(dir, uint64_t{64} << 20) || store.size() != 3) {
+    return 10;
+  }
+  const std::vector<CaptureHistoryEntry> recent = store.Recent(2);
+  if (recent.size() != 2 || recent[0].seq != 3 || recent[1].seq != 2 ||
+      recent[1].format != PixelFormat::RGBA8 || recent[0].size_px.h != 700 ||
+      recent[0].artifact_id.value != 13 || !recent[0].thumbnail.valid()) {
+    return 11;
+  }
+  if (!SameRows(store.Load(seqs[2]), tall) || !SameRows(store.Load(seqs[0]), wide) ||
+      store.Load(99).valid()) {
+    return 12;
+  }
+  // Numbering carries on after the last session.
+  if (store.Append(MakeArtifact(14, small)) != 4) {
+    return 13;
+  }
+  return 0;
+}
+
+int TestTornTail(const fs::path& dir) {
+  {
+    CaptureHistoryStore store;
+    if (!store.Open(dir, uint64_t{64} << 20)) {
+      return 20;
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+      store.Append(MakeArtifact(i, NoiseImage(64, 64, 20 + i)));
+    }
+    if (!store.Flush()) {
+      return 21;
+    }
+  }
+  // Cut the last record short, as a crash in the middle of a write would.
+  const fs::path segment = NewestSegment(dir);
+  fs::resize_file(segment, fs::file_size(segment) - 100);
+  CaptureHistoryStore store;
+  if (!store.Open(dir, uint64_t{64} << 20) || store.size() != 2 ||
+      store.Stats().torn_bytes == 0) {
+    return 22;
+  }
+  CaptureHistoryEntry entry;
+  if (!store.NthNewest(0, &entry) || !SameRows(store.Load(entry.seq), NoiseImage(64, 64, 21))) {
+    return 23;
+  }
+  // Appends go after the cut.
+  const uint64_t seq = store.Append(MakeArtifact(9, NoiseImage(32, 32, 29)));
+  if (seq != entry.seq + 1 || !store.Flush()) {
+    return 24;
+  }
+  store.Close();
+  if (!store.Open(dir, uint64_t{64} << 20) || store.size() != 3 ||
+      !SameRows(store.Load(seq), NoiseImage(32, 32, 29))) {
+    return 25;
+  }
+  return 0;
+}
+
+int TestCorruption(const fs::path& dir) {
+  {
+    CaptureHistoryStore store;
+    if (!store.Open(dir, uint64_t{64} << 20)) {
+      return 30;
+    }
+    store.Append(MakeArtifact(1, NoiseImage(200, 100, 30)));
+    store.Append(MakeArtifact(2, NoiseImage(200, 100, 31)));
+    if (!store.Flush()) {
+      return 31;
+    }
+  }
+  // Flip a byte near the end of the last record: its pixels, not its header
+  // or thumbnail, so Open still indexes it.
+  const fs::path segment = NewestSegment(dir);
+  std::vector<uint8_t> bytes;
+  {
+    std::ifstream in(segment, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  bytes[bytes.size() - 64] ^= 0x5A;
+  {
+    std::ofstream out(segment, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+  }
+  CaptureHistoryStore store;
+  if (!store.Open(dir, uint64_t{64} << 20) || store.size() != 2) {
+    return 32;
+  }
+  CaptureHistoryEntry newest;
+  CaptureHistoryEntry older;
+  if (!store.NthNewest(0, &newest) || !store.NthNewest(1, &older)) {
+    return 33;
+  }
+  if (store.Load(newest.seq).valid() || store.Stats().corrupt_records != 1 ||
+      store.size() != 1 || !SameRows(store.Load(older.seq), NoiseImage(200, 100, 30))) {
+    return 34;
+  }
+  return 0;
+}
+
+int TestRotation(const fs::path& dir) {
+  // 100x100 noise is its own thumbnail, so ~80 KB a record: one per segment.
+  const uint64_t max_bytes = 400 << 10;
+  const uint64_t segment_bytes = 100 << 10;
+  CaptureHistoryStore store;
+  if (!store.Open(dir, max_bytes, segment_bytes)) {
+    return 40;
+  }
+  for (uint32_t i = 0; i < 30; ++i) {
+    store.Append(MakeArtifact(i, NoiseImage(100, 100, 40 + i)));
+  }
+  if (!store.Flush()) {
+    return 41;
+  }
+  const CaptureHistoryStats stats = store.Stats();
+  if (stats.evicted_segments == 0 || stats.disk_bytes > max_bytes + segment_bytes ||
+      stats.segments != SegmentFiles(dir) || stats.entries + stats.evicted_entries != 30 ||
+      stats.entries < 4) {
+    return 42;
+  }
+  CaptureHistoryEntry entry;
+  if (store.Find(1, &entry) || store.Load(1).valid()) {
+    return 43;
+  }
+  // The newest captures are all there, oldest-first in seq.
+  const std::vector<CaptureHistoryEntry> recent = store.Recent(stats.entries);
+  for (size_t i = 0; i < recent.size(); ++i) {
+    if (recent[i].seq != 30 - i ||
+        !SameRows(store.Load(recent[i].seq),
+                  NoiseImage(100, 100, 40 + static_cast<uint32_t>(29 - i)))) {
+      return 44;
+    }
+  }
+  store.Close();
+  // A lower limit drops more at the next start.
+  if (!store.Open(dir, max_bytes / 4, segment_bytes) ||
+      store.Stats().disk_bytes > max_bytes / 4 + segment_bytes ||
+      store.size() >= stats.entries || !store.NthNewest(0, &entry) || entry.seq != 30) {
+    return 45;
+  }
+  return 0;
+}
+
+int TestConcurrentLoads(const fs::path& dir) {
+  CaptureHistoryStore store;
+  if (!store.Open(dir, uint64_t{64} << 20, 256 << 10)) {
+    return 50;
+  }
+  std::atomic<bool> done{false};
+  std::atomic<int> mismatches{0};
+  std::atomic<int> loads{0};
+  std::thread reader([&] {
+    while (!done.load()) {
+      CaptureHistoryEntry entry;
+      if (!store.NthNewest(0, &entry)) {
+        continue;
+      }
+      const BitmapView pixels = store.Load(entry.seq);
+      const uint32_t seed = 500 + static_cast<uint32_t>(entry.artifact_id.value);
+      if (!SameRows(pixels, NoiseImage(120, 80, seed))) {
+        mismatches.fetch_add(1);
+      }
+      loads.fetch_add(1);
+    }
+  });
+  for (uint32_t i = 0; i < 40; ++i) {
+    store.Append(MakeArtifact(i, NoiseImage(120, 80, 500 + i)));
+  }
+  store.Flush();
+  done.store(true);
+  reader.join();
+  if (mismatches.load() != 0 || loads.load() == 0 || store.size() != 40 ||
+      store.Stats().segments < 2) {
+    return 51;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  const fs::path root = fs::temp_directory_path() / "snappin_capture_history_tests";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  int rc = TestAppendAndReopen(root / "reopen");
+  if (rc == 0) {
+    rc = TestTornTail(root / "torn");
+  }
+  if (rc == 0) {
+    rc = TestCorruption(root / "corrupt");
+  }
+  if (rc == 0) {
+    rc = TestRotation(root / "rotation");
+  }
+  if (rc == 0) {
+    rc = TestConcurrentLoads(root / "concurrent");
+  }
+  fs::remove_all(root, ec);
+  return rc;
+}
@@ -0,0 +1,130 @@
+#include "ConfigSnapshot.h"
+#include "Json.h"
+
+#include <string>
+#include <string_view>
+
+namespace {
+
+using snappin::ConfigSnapshot;
+using snappin::JsonParseError;
+using snappin::JsonValue;
+
+// Expects `text` to be rejected at the given 1-based line/column.
+bool RejectsAt(std::string_view text, int line, int column) {
+  JsonValue value;
+  JsonParseError err;
+  if (snappin::ParseJson(text, &value, &err)) {
+    return false;
+  }
+  return err.line == line && err.column == column && !err.message.empty();
+}
+
+} // namespace
+
+int main() {
+  // The shipped defaults parse and map to the documented values.
+  ConfigSnapshot defaults;
+  JsonParseError err;
+  if (!snappin::BuildConfigSnapshot(snappin::DefaultConfigJson(), &defaults, &err)) {
+    return 1;
+  }
+  if (defaults.capture_auto_copy_to_clipboard != true ||
+      defaults.capture_auto_show_toolbar != true ||
+      defaults.export_open_folder_after_save != false || defaults.debug_enabled != false ||
+      defaults.debug_trace_enabled != false ||
+      defaults.hotkeys_enabled != true || defaults.hotkeys_conflict_policy != "warn" ||
+      defaults.export_png_preset != "balanced" || !defaults.export_save_dir.empty() ||
+      defaults.export_naming_pattern != "SnapPin_{yyyyMMdd_HHmmss}_{rand4}" ||
+      defaults.advanced_pixel_pool_max_mb != 256 ||
+      defaults.advanced_max_cpu_bitmap_cache_mb != 128 ||
+      defaults.advanced_pin_scale_cache_mb != 64 ||
+      defaults.advanced_pin_compress_idle_seconds != 30 ||
+      defaults.advanced_history_max_mb != 512 ||
+      defaults.annotate_pencil_tolerance_px != 1.0 ||
+      defaults.annotate_pencil_smoothing != false || defaults.pin_restore_session != true) {
+    return 2;
+  }
+
+  // Fields are read from their own section only, and wrong types fall back.
+  ConfigSnapshot snap;
+  const char* scoped = R"({
+    "debug": { "nested": { "enabled": true } },
+    "capture": { "auto_copy_to_clipboard": "yes", "auto_show_toolbar": false },
+    "export": { "save_dir": "D:\\Shots \u5c4f\u5e55", "png_preset": "fast" },
+    "advanced": { "pixel_pool_max_mb": -5 },
+    "annotate": { "pencil_tolerance_px": -1, "pencil_smoothing": true }
+  })";
+  if (!snappin::BuildConfigSnapshot(scoped, &snap, &err)) {
+    return 3;
+  }
+  if (snap.debug_enabled.has_value() || snap.capture_auto_copy_to_clipboard.has_value() ||
+      snap.capture_auto_show_toolbar != false || snap.export_png_preset != "fast" ||
+      snap.advanced_pixel_pool_max_mb.has_value() ||
+      snap.annotate_pencil_tolerance_px.has_value() || snap.annotate_pencil_smoothing != true) {
+    return 4;
+  }
+  if (snap.export_save_dir != "D:\\Shots \xE5\xB1\x8F\xE5\xB9\x95") {
+    return 5;
+  }
+
+  // A UTF-8 BOM, as left by Notepad, is accepted.
+  if (!snappin::BuildConfigSnapshot("\xEF\xBB\xBF{\"debug\":{\"enabled\":true}}", &snap,
+                                    &err) ||
+      snap.debug_enabled != true) {
+    return 6;
+  }
+
+  // Values of every kind.
+  JsonValue doc;
+  if (!snappin::ParseJson(R"([null, true, -1.5e2, "a\"\n\ud83d\ude00", {}, [[]], 0])", &doc) ||
+      !doc.is_array() || doc.items().size() != 7 || !doc.items()[0].is_null() ||
+      !doc.items()[1].bool_value() || doc.items()[2].number_value() != -150.0 ||
+      doc.items()[3].string_value() != "a\"\n\xF0\x9F\x98\x80" ||
+      !doc.items()[4].is_object() || doc.items()[5].items().size() != 1) {
+    return 7;
+  }
+  int value = 0;
+  if (!snappin::ParseJson(R"({"a": 12, "b": 1.5, "c": 3e9})", &doc) ||
+      !doc.ReadInt("a", &value) || value != 12 || doc.ReadInt("b", &value) ||
+      doc.ReadInt("c", &value)) {
+    return 8;
+  }
+  double number = 0.0;
+  if (!doc.ReadNumber("b", &number) || number != 1.5 || !doc.ReadNumber("c", &number) ||
+      number != 3e9 || doc.ReadNumber("d", &number)) {
+    return 14;
+  }
+
+  // Malformed input is rejected with the position of the first error.
+  if (!RejectsAt("{\n  \"a\": 1,\n  \"b\" 2\n}", 3, 7) ||
+      !RejectsAt("{\"a\": [1, 2,]}", 1, 13) || !RejectsAt("{\"a\": tru}", 1, 7) ||
+      !RejectsAt("{\"a\": 01}", 1, 8) || !RejectsAt("{\"a\": 1} x", 1, 10) ||
+      !RejectsAt("{\"a\": \"x", 1, 9) || !RejectsAt("{\"a\": \"\\q\"}", 1, 9) ||
+      !RejectsAt("{\"a\": \"\\ud800\"}", 1, 14) || !RejectsAt("", 1, 1) ||
+      !RejectsAt("[1e999]", 1, 2) || !RejectsAt("{\"a\": \"tab\there\"}", 1, 11)) {
+    return 9;
+  }
+  std::string deep(snappin::kJsonMaxDepth + 1, '[');
+  deep.append(snappin::kJsonMaxDepth + 1, ']');
+  if (snappin::ParseJson(deep, &doc, &err) || err.message != "nesting too deep") {
+    return 10;
+  }
+  deep = deep.substr(1, deep.size() - 2);
+  if (!snappin::ParseJson(deep, &doc)) {
+    return 11;
+  }
+
+  // A non-object root is not a config, and a failed build leaves *out alone.
+  snap = ConfigSnapshot{};
+  snap.export_png_preset = "keep";
+  if (snappin::BuildConfigSnapshot("[1]", &snap, &err) ||
+      snappin::BuildConfigSnapshot("{\"export\": {\"png_preset\": \"x\"", &snap, &err) ||
+      snap.export_png_preset != "keep") {
+    return 12;
+  }
+  if (snappin::FormatJsonError(err).rfind("line 1, column ", 0) != 0) {
+    return 13;
+  }
+  return 0;
+}
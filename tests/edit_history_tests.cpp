@@ -0,0 +1,310 @@
+#include "EditHistory.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using snappin::EditHistory;
+
+struct Item {
+  uint64_t id = 0;
+  int32_t x = 0;
+  std::string text;
+};
+
+bool operator==(const Item& a, const Item& b) {
+  return a.id == b.id && a.x == b.x && a.text == b.text;
+}
+
+size_t ItemBytes(const Item& item) { return item.text.capacity(); }
+
+uint64_t Hash(const std::vector<Item>& items) {
+  uint64_t h = 1469598103934665603ull;
+  const auto mix = [&h](uint64_t v) {
+    h ^= v;
+    h *= 1099511628211ull;
+  };
+  for (const Item& item : items) {
+    mix(item.id);
+    mix(static_cast<uint32_t>(item.x));
+    for (char c : item.text) {
+      mix(static_cast<unsigned char>(c));
+    }
+    mix(0xFF);
+  }
+  return h;
+}
+
+// Counts copies so the test can tell pushes move items instead of copying.
+struct Tracked {
+  static int copies;
+  Tracked() = default;
+  explicit Tracked(int v) : value(v) {}
+  Tracked(const Tracked& o) : value(o.value) { ++copies; }
+  Tracked(Tracked&&) noexcept = default;
+  Tracked& operator=(const Tracked& o) {
+    value = o.value;
+    ++copies;
+    return *this;
+  }
+  Tracked& operator=(Tracked&&) noexcept = default;
+  int value = 0;
+};
+int Tracked::copies = 0;
+
+int TestBasics() {
+  EditHistory<Item> history(&ItemBytes);
+  std::vector<Item> items;
+  if (history.CanUndo() || history.CanRedo() || history.Undo(&items) || history.UndoSlot() ||
+      history.RedoSlot()) {
+    return 1;
+  }
+  items.push_back({1, 10, "a"});
+  history.RecordAdd(0);
+  items.push_back({2, 20, "b"});
+  history.RecordAdd(1);
+  Item before = items[0];
+  items[0].x = 15;
+  history.RecordReplace(0, before);
+  Item removed = items[1];
+  items.erase(items.begin() + 1);
+  history.RecordRemove(1, removed);
+
+  const std::vector<Item> final_state = items;
+  if (history.UndoSlot() != 1u || history.RedoSlot()) {
+    return 7;
+  }
+  if (history.undo_depth() != 4 || history.Undo(&items) != 1u || items.size() != 2 ||
+      !(items[1] == removed)) {
+    return 2;
+  }
+  if (history.RedoSlot() != 1u || history.Undo(&items) != 0u || items[0].x != 10) {
+    return 3;
+  }
+  history.Undo(&items);
+  history.Undo(&items);
+  if (!items.empty() || history.CanUndo() || history.redo_depth() != 4) {
+    return 4;
+  }
+  while (history.Redo(&items)) {
+  }
+  if (items != final_state) {
+    return 5;
+  }
+  // A new edit after undo drops the redo branch.
+  history.Undo(&items);
+  items[0].text = "edited";
+  history.RecordReplace(0, Item{1, 15, "a"});
+  if (history.CanRedo() || history.undo_depth() != 4) {
+    return 6;
+  }
+  return 0;
+}
+
+int TestMerge() {
+  EditHistory<Item> history(&ItemBytes);
+  std::vector<Item> items;
+  // Place a text box and type into it: one undo step.
+  items.push_back({7, 0, ""});
+  history.RecordAdd(0, /*merge_key=*/1);
+  for (char c : std::string("hello")) {
+    Item before = items[0];
+    items[0].text.push_back(c);
+    history.RecordReplace(0, before, 1);
+  }
+  if (history.undo_depth() != 1 || history.Stats().merged != 5) {
+    return 10;
+  }
+  history.Undo(&items);
+  if (!items.empty()) {
+    return 11;
+  }
+  history.Redo(&items);
+  if (items.size() != 1 || items[0].text != "hello") {
+    return 12;
+  }
+  // A different key, or a record in between, starts a new step.
+  Item before = items[0];
+  items[0].text += "!";
+  history.RecordReplace(0, before, 2);
+  items.push_back({8, 0, "x"});
+  history.RecordAdd(1);
+  before = items[0];
+  items[0].text += "?";
+  history.RecordReplace(0, before, 2);
+  if (history.undo_depth() != 4) {
+    return 13;
+  }
+  return 0;
+}
+
+int TestNoCopies() {
+  EditHistory<Tracked> history;
+  std::vector<Tracked> items;
+  items.reserve(64);
+  Tracked::copies = 0;
+  for (int i = 0; i < 32; ++i) {
+    items.emplace_back(i);
+    history.RecordAdd(items.size() - 1);
+  }
+  for (int i = 0; i < 16; ++i) {
+    Tracked before(std::move(items[0]));
+    items[0] = Tracked(100 + i);
+    history.RecordReplace(0, std::move(before));
+    Tracked removed(std::move(items.back()));
+    items.pop_back();
+    history.RecordRemove(items.size(), std::move(removed));
+  }
+  while (history.Undo(&items)) {
+  }
+  while (history.Redo(&items)) {
+  }
+  if (Tracked::copies != 0 || items.size() != 16 || items[0].value != 115) {
+    return 20;
+  }
+  return 0;
+}
+
+int TestLimits() {
+  // Entry limit: only the newest records stay undoable.
+  EditHistory<Item> by_count(&ItemBytes, EditHistory<Item>::kDefaultBudgetBytes, 8);
+  std::vector<Item> items;
+  for (int i = 0; i < 100; ++i) {
+    items.push_back({static_cast<uint64_t>(i), i, ""});
+    by_count.RecordAdd(items.size() - 1);
+  }
+  if (by_count.undo_depth() != 8 || by_count.Stats().evicted != 92) {
+    return 30;
+  }
+  while (by_count.Undo(&items)) {
+  }
+  if (items.size() != 92) {
+    return 31;
+  }
+
+  // Byte budget: removed items count against it, the newest record survives.
+  const size_t budget = 64 * 1024;
+  EditHistory<Item> by_bytes(&ItemBytes, budget, 1 << 20);
+  items.clear();
+  for (int i = 0; i < 200; ++i) {
+    items.push_back({static_cast<uint64_t>(i), 0, std::string(4096, 'p')});
+  }
+  for (int i = 0; i < 200; ++i) {
+    Item removed = std::move(items.back());
+    items.pop_back();
+    by_bytes.RecordRemove(items.size(), std::move(removed));
+    if (by_bytes.bytes() > budget) {
+      return 32;
+    }
+  }
+  if (by_bytes.undo_depth() == 0 || by_bytes.undo_depth() > budget / 4096) {
+    return 33;
+  }
+  Item huge{999, 0, std::string(budget * 2, 'h')};
+  items.push_back({998, 0, ""});
+  by_bytes.RecordRemove(0, huge);
+  items.erase(items.begin());
+  if (by_bytes.undo_depth() != 1 || !by_bytes.Undo(&items) || items.size() != 1 ||
+      items[0].id != 999) {
+    return 34;
+  }
+  by_bytes.SetLimits(0, 1);
+  if (by_bytes.undo_depth() + by_bytes.redo_depth() != 1) {
+    return 35;
+  }
+  return 0;
+}
+
+// Tens of thousands of random edits, undos and redos checked against a hash
+// of the list at every version.
+int TestStress() {
+  std::mt19937 rng(1234);
+  EditHistory<Item> history(&ItemBytes, size_t{64} << 20, 1 << 20);
+  std::vector<Item> items;
+  std::vector<uint64_t> versions = {Hash(items)};
+  size_t version = 0;
+  uint64_t next_id = 1;
+  for (int step = 0; step < 60000; ++step) {
+    const int roll = static_cast<int>(rng() % 100);
+    if (roll < 15 && history.CanUndo()) {
+      if (!history.Undo(&items)) {
+        return 40;
+      }
+      --version;
+    } else if (roll < 25 && history.CanRedo()) {
+      if (!history.Redo(&items)) {
+        return 41;
+      }
+      ++version;
+    } else {
+      const int op = items.empty() ? 0 : static_cast<int>(rng() % 4);
+      const size_t slot = items.empty() ? 0 : rng() % items.size();
+      if (op == 0 || items.size() < 4) {
+        const size_t at = rng() % (items.size() + 1);
+        items.insert(items.begin() + static_cast<std::ptrdiff_t>(at),
+                     Item{next_id++, 0, std::string(rng() % 24, 'a')});
+        history.RecordAdd(at);
+      } else if (op == 1) {
+        Item removed = std::move(items[slot]);
+        items.erase(items.begin() + static_cast<std::ptrdiff_t>(slot));
+        history.RecordRemove(slot, std::move(removed));
+      } else if (op == 2) {
+        Item before = items[slot];
+        items[slot].x += static_cast<int32_t>(rng() % 9) - 4;
+        history.RecordReplace(slot, std::move(before));
+      } else {
+        Item before = items[slot];
+        items[slot].text.push_back(static_cast<char>('a' + rng() % 26));
+        history.RecordReplace(slot, std::move(before));
+      }
+      versions.resize(version + 1);
+      versions.push_back(Hash(items));
+      ++version;
+    }
+    if (Hash(items) != versions[version]) {
+      return 42;
+    }
+  }
+  // Unwind everything and replay it.
+  const uint64_t final_hash = Hash(items);
+  const size_t depth = history.undo_depth();
+  while (history.Undo(&items)) {
+    --version;
+  }
+  if (version != 0 || !items.empty()) {
+    return 43;
+  }
+  for (size_t i = 0; i < depth; ++i) {
+    if (!history.Redo(&items)) {
+      return 44;
+    }
+  }
+  if (Hash(items) != final_hash) {
+    return 45;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestBasics()) {
+    return rc;
+  }
+  if (int rc = TestMerge()) {
+    return rc;
+  }
+  if (int rc = TestNoCopies()) {
+    return rc;
+  }
+  if (int rc = TestLimits()) {
+    return rc;
+  }
+  if (int rc = TestStress()) {
+    return rc;
+  }
+  return 0;
+}
@@ -0,0 +1,316 @@
+#include "ErrorCodes.h"
+#include "ExportQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using snappin::ActionEvent;
+using snappin::Artifact;
+using snappin::BitmapView;
+using snappin::ExportQueue;
+using snappin::ExportQueueEvent;
+using snappin::ExportRequest;
+using snappin::Id64;
+
+BitmapView MakePixels(int32_t w, int32_t h, uint8_t fill) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(w) * h * 4, fill);
+  return BitmapView::FromBuffer(bytes, {w, h}, w * 4);
+}
+
+ExportRequest MakeRequest(uint64_t artifact_id, const BitmapView& pixels, bool auto_path,
+                          const wchar_t* path) {
+  ExportRequest req;
+  req.artifact.artifact_id = Id64{artifact_id};
+  req.artifact.base_cpu = pixels;
+  req.options.path = path;
+  req.auto_path = auto_path;
+  return req;
+}
+
+// Save function whose calls block until Release(), recording what it saw.
+class FakeSaver {
+public:
+  snappin::Result<std::wstring> Save(const ExportRequest& req) {
+    std::unique_lock<std::mutex> lock(mu_);
+    ++calls_;
+    first_bytes_.push_back(req.artifact.base_cpu.valid() ? req.artifact.base_cpu.data()[0] : 0);
+    entered_cv_.notify_all();
+    gate_cv_.wait(lock, [this] { return open_; });
+    lock.unlock();
+    if (req.options.on_progress) {
+      for (int i = 1; i <= 20; ++i) {
+        req.options.on_progress(static_cast<float>(i) / 20.0f);
+      }
+    }
+    if (fail_) {
+      snappin::Error err;
+      err.code = snappin::ERR_DISK_FULL;
+      err.message = "Disk full";
+      return snappin::Result<std::wstring>::Fail(err);
+    }
+    return snappin::Result<std::wstring>::Ok(req.options.path);
+  }
+
+  void WaitEntered(int calls) {
+    std::unique_lock<std::mutex> lock(mu_);
+    entered_cv_.wait(lock, [&] { return calls_ >= calls; });
+  }
+
+  void Release() {
+    std::lock_guard<std::mutex> lock(mu_);
+    open_ = true;
+    gate_cv_.notify_all();
+  }
+
+  int calls() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return calls_;
+  }
+
+  std::vector<uint8_t> first_bytes() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return first_bytes_;
+  }
+
+  bool fail_ = false;
+
+private:
+  std::mutex mu_;
+  std::condition_variable entered_cv_;
+  std::condition_variable gate_cv_;
+  bool open_ = false;
+  int calls_ = 0;
+  std::vector<uint8_t> first_bytes_;
+};
+
+struct EventLog {
+  std::mutex mu;
+  std::map<uint64_t, std::vector<ExportQueueEvent>> by_id;
+
+  void Add(const ExportQueueEvent& ev) {
+    std::lock_guard<std::mutex> lock(mu);
+    by_id[ev.correlation_id.value].push_back(ev);
+  }
+};
+
+// Progress events never go backwards and exactly one terminal event ends the list.
+bool WellFormed(const std::vector<ExportQueueEvent>& events, ActionEvent::Type terminal) {
+  if (events.empty() || events.back().type != terminal) {
+    return false;
+  }
+  float last = -1.0f;
+  for (size_t i = 0; i + 1 < events.size(); ++i) {
+    if (events[i].type != ActionEvent::Type::Progress || events[i].progress_0_1 < last) {
+      return false;
+    }
+    last = events[i].progress_0_1;
+  }
+  return true;
+}
+
+int TestCoalesceAndSnapshot() {
+  FakeSaver saver;
+  EventLog log;
+  const BitmapView first = MakePixels(8, 8, 11);
+  const BitmapView edited = MakePixels(8, 8, 22);
+  {
+    ExportQueue queue([&](const ExportRequest& r) { return saver.Save(r); },
+                      [&](const ExportQueueEvent& ev) { log.Add(ev); });
+
+    // Submit returns while the save is still blocked in the worker.
+    if (queue.Submit(Id64{1}, MakeRequest(7, first, true, L"a.png"))) {
+      return 10;
+    }
+    saver.WaitEntered(1);
+    // Same snapshot, generated path: joins the running job.
+    if (!queue.Submit(Id64{2}, MakeRequest(7, first, true, L"b.png"))) {
+      return 11;
+    }
+    // Edited pixels: a new job that sees its own snapshot.
+    if (queue.Submit(Id64{3}, MakeRequest(7, edited, true, L"c.png"))) {
+      return 12;
+    }
+    // A duplicate of the queued job joins it.
+    if (!queue.Submit(Id64{4}, MakeRequest(7, edited, true, L"d.png"))) {
+      return 13;
+    }
+    // An explicit different destination is a separate save.
+    if (queue.Submit(Id64{5}, MakeRequest(7, edited, false, L"e.png"))) {
+      return 14;
+    }
+    // Another artifact never merges.
+    if (queue.Submit(Id64{6}, MakeRequest(8, edited, true, L"f.png"))) {
+      return 15;
+    }
+    const snappin::ExportQueueStats before = queue.Stats();
+    if (before.submitted != 6 || before.coalesced != 2 || before.pending != 4) {
+      return 16;
+    }
+    saver.Release();
+    queue.WaitIdle();
+    const snappin::ExportQueueStats after = queue.Stats();
+    if (after.succeeded != 4 || after.failed != 0 || after.pending != 0) {
+      return 17;
+    }
+  }
+  if (saver.calls() != 4) {
+    return 18;
+  }
+  const std::vector<uint8_t> seen = saver.first_bytes();
+  if (seen.size() != 4 || seen[0] != 11 || seen[1] != 22) {
+    return 19;
+  }
+  for (uint64_t id = 1; id <= 6; ++id) {
+    const auto& events = log.by_id[id];
+    if (!WellFormed(events, ActionEvent::Type::Succeeded)) {
+      std::fprintf(stderr, "id %llu: %zu events\n", static_cast<unsigned long long>(id),
+                   events.size());
+      return 20;
+    }
+  }
+  // Joined requests report the leader's file.
+  if (log.by_id[2].back().path != L"a.png" || log.by_id[4].back().path != L"c.png" ||
+      log.by_id[5].back().path != L"e.png") {
+    return 21;
+  }
+  // Throttled: 0, then at most one event per 5% step, then the result.
+  if (log.by_id[1].size() > 23 || log.by_id[1].size() < 3) {
+    return 22;
+  }
+  return 0;
+}
+
+int TestFailureReachesEveryId() {
+  FakeSaver saver;
+  saver.fail_ = true;
+  EventLog log;
+  const BitmapView pixels = MakePixels(4, 4, 1);
+  {
+    ExportQueue queue([&](const ExportRequest& r) { return saver.Save(r); },
+                      [&](const ExportQueueEvent& ev) { log.Add(ev); });
+    queue.Submit(Id64{1}, MakeRequest(1, pixels, false, L"x.png"));
+    queue.Submit(Id64{2}, MakeRequest(1, pixels, false, L"x.png"));
+    saver.Release();
+  }
+  if (saver.calls() != 1) {
+    return 30;
+  }
+  for (uint64_t id = 1; id <= 2; ++id) {
+    const auto& events = log.by_id[id];
+    if (!WellFormed(events, ActionEvent::Type::Failed) || !events.back().error.has_value() ||
+        events.back().error->code != snappin::ERR_DISK_FULL) {
+      return 31;
+    }
+  }
+  return 0;
+}
+
+int TestDestructionFinishesQueuedSaves() {
+  FakeSaver saver;
+  EventLog log;
+  {
+    ExportQueue queue([&](const ExportRequest& r) { return saver.Save(r); },
+                      [&](const ExportQueueEvent& ev) { log.Add(ev); }, 2);
+    for (uint64_t i = 1; i <= 8; ++i) {
+      queue.Submit(Id64{i}, MakeRequest(i, MakePixels(2, 2, static_cast<uint8_t>(i)), true,
+                                        L"p.png"));
+    }
+    saver.Release();
+  }
+  if (saver.calls() != 8) {
+    return 40;
+  }
+  for (uint64_t id = 1; id <= 8; ++id) {
+    if (!WellFormed(log.by_id[id], ActionEvent::Type::Succeeded)) {
+      return 41;
+    }
+  }
+  return 0;
+}
+
+int TestNoSaveFunction() {
+  EventLog log;
+  {
+    ExportQueue queue(nullptr, [&](const ExportQueueEvent& ev) { log.Add(ev); });
+    queue.Submit(Id64{9}, MakeRequest(1, MakePixels(2, 2, 0), true, L"n.png"));
+    queue.WaitIdle();
+  }
+  const auto& events = log.by_id[9];
+  if (!WellFormed(events, ActionEvent::Type::Failed) ||
+      events.back().error->code != snappin::ERR_INTERNAL_ERROR) {
+    return 50;
+  }
+  return 0;
+}
+
+// Saves run on the shared scheduler, never on the submitting thread, and no more than
+// max_jobs at a time.
+int TestSavesRunOnScheduler() {
+  std::mutex mu;
+  int running = 0;
+  int peak = 0;
+  bool on_caller = false;
+  const std::thread::id caller = std::this_thread::get_id();
+  auto save = [&](const ExportRequest& r) {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      on_caller = on_caller || std::this_thread::get_id() == caller;
+      peak = std::max(peak, ++running);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    std::lock_guard<std::mutex> lock(mu);
+    --running;
+    return snappin::Result<std::wstring>::Ok(r.options.path);
+  };
+  EventLog log;
+  {
+    ExportQueue queue(save, [&](const ExportQueueEvent& ev) { log.Add(ev); }, 2);
+    for (uint64_t i = 1; i <= 6; ++i) {
+      queue.Submit(Id64{i}, MakeRequest(i, MakePixels(2, 2, 0), true, L"s.png"));
+    }
+    queue.WaitIdle();
+  }
+  if (on_caller) {
+    return 60;
+  }
+  if (peak < 1 || peak > 2) {
+    return 61;
+  }
+  for (uint64_t id = 1; id <= 6; ++id) {
+    if (!WellFormed(log.by_id[id], ActionEvent::Type::Succeeded)) {
+      return 62;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestCoalesceAndSnapshot()) {
+    return rc;
+  }
+  if (int rc = TestFailureReachesEveryId()) {
+    return rc;
+  }
+  if (int rc = TestDestructionFinishesQueuedSaves()) {
+    return rc;
+  }
+  if (int rc = TestNoSaveFunction()) {
+    return rc;
+  }
+  if (int rc = TestSavesRunOnScheduler()) {
+    return rc;
+  }
+  return 0;
+}
@@ -0,0 +1,341 @@
+#include "GlyphCache.h"
+#include "Rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using snappin::ColorRGBA;
+using snappin::CpuBitmap;
+using snappin::FontKey;
+using snappin::FontMetrics;
+using snappin::GlyphCache;
+using snappin::GlyphCacheStats;
+using snappin::GlyphOutline;
+using snappin::GlyphSource;
+using snappin::PixelFormat;
+using snappin::PointF;
+using snappin::PointPX;
+using snappin::RasterizeCoverage;
+using snappin::RectPX;
+using snappin::SizePX;
+using snappin::TextLayout;
+
+// Synthetic font: printable ASCII glyphs are boxes whose width depends on the
+// codepoint, even codepoints with a hole wound the other way; '?' is a
+// diamond and U+1F600 a triangle. Everything else is missing.
+class BoxFont final : public GlyphSource {
+public:
+  bool Metrics(const FontKey& font, FontMetrics* out) override {
+    const float s = static_cast<float>(font.size_px);
+    *out = FontMetrics{0.8f * s, 0.2f * s, 1.2f * s};
+    return true;
+  }
+
+  bool Outline(const FontKey& font, char32_t cp, GlyphOutline* out) override {
+    ++outline_calls;
+    const float s = static_cast<float>(font.size_px);
+    out->contours.clear();
+    if (cp == U' ') {
+      out->advance = 0.3f * s;
+      return true;
+    }
+    if (cp == U'?') {
+      out->advance = 0.5f * s + 1.25f;
+      out->contours.push_back(
+          {{0.25f * s, -0.7f * s}, {0.5f * s, -0.35f * s}, {0.25f * s, 0.1f * s}, {0.1f, -0.35f * s}});
+      return true;
+    }
+    if (cp == U'\U0001F600') {
+      out->advance = 0.9f * s;
+      out->contours.push_back({{0.1f * s, 0.0f}, {0.45f * s, -0.75f * s}, {0.8f * s, 0.0f}});
+      return true;
+    }
+    if (cp < 0x21 || cp > 0x7E) {
+      return false;
+    }
+    const float w = 0.3f * s + static_cast<float>(cp % 5);
+    const float x0 = 0.3f;
+    const float y0 = -0.7f * s - 0.4f;
+    const float y1 = (cp == U'g' || cp == U'j') ? 0.15f * s : 0.0f;
+    out->advance = w + 2.25f;
+    out->contours.push_back({{x0, y0}, {x0 + w, y0}, {x0 + w, y1}, {x0, y1}});
+    if (cp % 2 == 0) {
+      const float m = std::max(1.0f, 0.1f * s);
+      out->contours.push_back(
+          {{x0 + m, y0 + m}, {x0 + m, y1 - m}, {x0 + w - m, y1 - m}, {x0 + w - m, y0 + m}});
+    }
+    return true;
+  }
+
+  int outline_calls = 0;
+};
+
+struct Canvas {
+  Canvas(int32_t w, int32_t h) : pixels(static_cast<size_t>(w) * static_cast<size_t>(h) * 4, 0) {
+    for (size_t i = 0; i < pixels.size(); ++i) {
+      pixels[i] = static_cast<uint8_t>(i % 4 == 3 ? 255 : 40 + (i * 7) % 90);
+    }
+    bitmap.format = PixelFormat::BGRA8;
+    bitmap.size_px = {w, h};
+    bitmap.stride_bytes = w * 4;
+    bitmap.data.p = pixels.data();
+  }
+
+  std::vector<uint8_t> pixels;
+  CpuBitmap bitmap;
+};
+
+// Draws `layout` by rasterizing every glyph outline straight into the canvas.
+void ReferenceDraw(const FontKey& font, const TextLayout& layout, PointPX origin,
+                   ColorRGBA color, Canvas* canvas) {
+  BoxFont source;
+  const SizePX size = canvas->bitmap.size_px;
+  std::vector<uint8_t> mask(static_cast<size_t>(size.w) * static_cast<size_t>(size.h));
+  for (const auto& pg : layout.glyphs) {
+    GlyphOutline outline;
+    if (!source.Outline(font, pg.codepoint, &outline)) {
+      source.Outline(font, U'?', &outline);
+    }
+    for (auto& contour : outline.contours) {
+      for (PointF& p : contour) {
+        p.x += static_cast<float>(origin.x + pg.x);
+        p.y += static_cast<float>(origin.y + pg.y);
+      }
+    }
+    RasterizeCoverage(outline.contours, size, mask.data(), size.w);
+    for (size_t i = 0; i < mask.size(); ++i) {
+      if (mask[i] == 0) {
+        continue;
+      }
+      uint8_t* px = canvas->pixels.data() + i * 4;
+      const uint32_t a = (mask[i] * uint32_t{color.a} + 127) / 255;
+      const uint32_t inv = 255 - a;
+      px[0] = static_cast<uint8_t>((color.b * a + px[0] * inv + 127) / 255);
+      px[1] = static_cast<uint8_t>((color.g * a + px[1] * inv + 127) / 255);
+      px[2] = static_cast<uint8_t>((color.r * a + px[2] * inv + 127) / 255);
+      px[3] = static_cast<uint8_t>(a + (px[3] * inv + 127) / 255);
+    }
+  }
+}
+
+int MaxDiff(const Canvas& a, const Canvas& b) {
+  int diff = 0;
+  for (size_t i = 0; i < a.pixels.size(); ++i) {
+    diff = std::max(diff, std::abs(static_cast<int>(a.pixels[i]) - static_cast<int>(b.pixels[i])));
+  }
+  return diff;
+}
+
+FontKey Font(int32_t size_px) {
+  FontKey font;
+  font.family = L"Box";
+  font.size_px = size_px;
+  return font;
+}
+
+int TestCoverage() {
+  // A 2.5 px square at (1.25, 1.25): quarter-covered corners, half-covered
+  // edges, a full center.
+  std::vector<uint8_t> mask(5 * 5, 7);
+  const std::vector<std::vector<PointF>> square{
+      {{1.25f, 1.25f}, {3.75f, 1.25f}, {3.75f, 3.75f}, {1.25f, 3.75f}}};
+  if (!RasterizeCoverage(square, SizePX{5, 5}, mask.data(), 5)) {
+    return 1;
+  }
+  const uint8_t expected[5] = {0, 191, 255, 191, 0};
+  for (int32_t y = 0; y < 5; ++y) {
+    for (int32_t x = 0; x < 5; ++x) {
+      const int want = (expected[x] * expected[y] + 127) / 255;
+      if (std::abs(mask[static_cast<size_t>(y * 5 + x)] - want) > 1) {
+        return 2;
+      }
+    }
+  }
+  // A hole wound the other way is empty; contours past the mask are clipped.
+  const std::vector<std::vector<PointF>> ring{
+      {{-3.0f, 0.0f}, {8.0f, 0.0f}, {8.0f, 5.0f}, {-3.0f, 5.0f}},
+      {{1.0f, 1.0f}, {1.0f, 4.0f}, {4.0f, 4.0f}, {4.0f, 1.0f}}};
+  if (!RasterizeCoverage(ring, SizePX{5, 5}, mask.data(), 5) || mask[0] != 255 ||
+      mask[2 * 5 + 2] != 0 || mask[4 * 5 + 4] != 255) {
+    return 3;
+  }
+  if (RasterizeCoverage(ring, SizePX{5, 5}, nullptr, 5) ||
+      RasterizeCoverage(ring, SizePX{5, 5}, mask.data(), 4)) {
+    return 4;
+  }
+  return 0;
+}
+
+int TestLayout() {
+  GlyphCache cache(std::make_unique<BoxFont>());
+  const FontKey font = Font(20);
+  // Advances: 'a' (97) 10.25, 'b' (98) 11.25, space 6.
+  const auto one = cache.Layout(font, L"ab a");
+  if (one->lines != 1 || one->glyphs.size() != 3 || one->glyphs[0].x != 0 ||
+      one->glyphs[1].x != 10 || one->glyphs[2].x != 28 || one->glyphs[0].y != 16 ||
+      one->size.w != 38 || one->size.h != 24) {
+    return 10;
+  }
+  // Same key: the memoized layout; another width: a new one.
+  if (cache.Layout(font, L"ab a") != one || cache.Layout(font, L"ab a", 500) == one) {
+    return 11;
+  }
+  // Words move to the next line whole; trailing spaces do not count.
+  const auto wrapped = cache.Layout(font, L"ab ab  ab", 50);
+  if (wrapped->lines != 2 || wrapped->glyphs.size() != 6 || wrapped->glyphs[2].x != 28 ||
+      wrapped->glyphs[4].x != 0 || wrapped->glyphs[4].y != 40 || wrapped->glyphs[5].x != 10 ||
+      wrapped->size.w != 49 || wrapped->size.h != 48) {
+    return 12;
+  }
+  // A word longer than the line breaks inside it.
+  const auto broken = cache.Layout(font, L"aaaaaaa", 31);
+  if (broken->lines != 3 || broken->glyphs[3].x != 0 || broken->glyphs[3].y != 40 ||
+      broken->glyphs[6].y != 64) {
+    return 13;
+  }
+  // Explicit breaks, CR ignored, surrogate pairs combined.
+  std::wstring text = L"a\r\n\nb";
+  text.push_back(static_cast<wchar_t>(0xD83D));
+  text.push_back(static_cast<wchar_t>(0xDE00));
+  const auto lines = cache.Layout(font, text);
+  if (lines->lines != 3 || lines->glyphs.size() != 3 || lines->glyphs[1].y != 64 ||
+      lines->glyphs[2].codepoint != U'\U0001F600' || lines->glyphs[2].x != 11) {
+    return 14;
+  }
+  const GlyphCacheStats stats = cache.Stats();
+  if (stats.layout_hits != 1 || stats.layout_misses != 5 || stats.layouts != 5) {
+    return 15;
+  }
+  return 0;
+}
+
+int TestDrawMatchesOutlines() {
+  auto owned = std::make_unique<BoxFont>();
+  BoxFont* source = owned.get();
+  GlyphCache cache(std::move(owned));
+  const ColorRGBA color{250, 40, 10, 230};
+  for (int32_t size : {9, 20, 37}) {
+    const FontKey font = Font(size);
+    const auto layout = cache.Layout(font, L"The quick brown fox\njumps over \x00e9 lazy dog?", 300);
+    Canvas drawn(340, 200);
+    Canvas expected(340, 200);
+    const PointPX origin{-3, 12};
+    if (!cache.Draw(font, *layout, origin, color, drawn.bitmap)) {
+      return 20;
+    }
+    ReferenceDraw(font, *layout, origin, color, &expected);
+    if (MaxDiff(drawn, expected) > 1) {
+      return 21;
+    }
+    // Clipped draws in pieces give the same pixels.
+    Canvas pieces(340, 200);
+    for (int32_t y = 0; y < 200; y += 23) {
+      for (int32_t x = 0; x < 340; x += 57) {
+        cache.Draw(font, *layout, origin, color, pieces.bitmap, RectPX{x, y, 57, 23});
+      }
+    }
+    if (pieces.pixels != drawn.pixels) {
+      return 22;
+    }
+  }
+  // Repaints only hit the cache.
+  const int calls = source->outline_calls;
+  const GlyphCacheStats before = cache.Stats();
+  const FontKey font = Font(20);
+  const auto layout = cache.Layout(font, L"The quick brown fox\njumps over \x00e9 lazy dog?", 300);
+  Canvas again(340, 200);
+  cache.Draw(font, *layout, PointPX{0, 0}, color, again.bitmap);
+  const GlyphCacheStats after = cache.Stats();
+  if (source->outline_calls != calls || after.glyph_misses != before.glyph_misses ||
+      after.glyph_hits <= before.glyph_hits || after.layout_hits != before.layout_hits + 1 ||
+      after.pages != 1 || after.bytes < size_t{GlyphCache::kPagePx} * GlyphCache::kPagePx) {
+    return 23;
+  }
+  Canvas invalid(4, 4);
+  invalid.bitmap.stride_bytes = 8;
+  if (cache.Draw(font, *layout, PointPX{0, 0}, color, invalid.bitmap)) {
+    return 24;
+  }
+  return 0;
+}
+
+int TestBudget() {
+  // One page: every new size evicts the previous one's glyphs.
+  GlyphCache cache(std::make_unique<BoxFont>(), size_t{1} << 18);
+  const ColorRGBA color{255, 255, 255, 255};
+  const std::wstring text = L"!\"#$%&'()*+,-./0123456789:;<=>@ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  for (int round = 0; round < 2; ++round) {
+    for (int32_t size : {64, 90, 120}) {
+      const FontKey font = Font(size);
+      const auto layout = cache.Layout(font, text, 600);
+      Canvas drawn(640, 640);
+      Canvas expected(640, 640);
+      cache.Draw(font, *layout, PointPX{5, 5}, color, drawn.bitmap);
+      ReferenceDraw(font, *layout, PointPX{5, 5}, color, &expected);
+      if (MaxDiff(drawn, expected) > 1) {
+        return 30;
+      }
+    }
+  }
+  GlyphCacheStats stats = cache.Stats();
+  if (stats.pages != 1 || stats.evicted_pages == 0 || stats.bytes > (size_t{1} << 18) * 5 / 4) {
+    return 31;
+  }
+  // Layouts are bounded by a quarter of the budget.
+  for (int i = 0; i < 2000; ++i) {
+    cache.Layout(Font(12), std::to_wstring(i) + L" some words to lay out");
+  }
+  stats = cache.Stats();
+  if (stats.evicted_layouts == 0 || stats.bytes > (size_t{1} << 18) * 5 / 4) {
+    return 32;
+  }
+  cache.Clear();
+  stats = cache.Stats();
+  if (stats.pages != 0 || stats.glyphs != 0 || stats.layouts != 0 || stats.bytes != 0) {
+    return 33;
+  }
+  return 0;
+}
+
+int TestOversizedGlyphs() {
+  GlyphCache cache(std::make_unique<BoxFont>());
+  const FontKey font = Font(800);
+  const auto layout = cache.Layout(font, L"A");
+  Canvas drawn(700, 800);
+  Canvas expected(700, 800);
+  const ColorRGBA color{0, 128, 255, 255};
+  cache.Draw(font, *layout, PointPX{10, 0}, color, drawn.bitmap);
+  ReferenceDraw(font, *layout, PointPX{10, 0}, color, &expected);
+  if (MaxDiff(drawn, expected) > 1 || cache.Stats().pages != 0) {
+    return 40;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestCoverage()) {
+    return rc;
+  }
+  if (int rc = TestLayout()) {
+    return rc;
+  }
+  if (int rc = TestDrawMatchesOutlines()) {
+    return rc;
+  }
+  if (int rc = TestBudget()) {
+    return rc;
+  }
+  if (int rc = TestOversizedGlyphs()) {
+    return rc;
+  }
+  return 0;
+}
@@ -0,0 +1,231 @@
+#include "PixelCodec.h"
+#include "PixelDedupRegistry.h"
+#include "PixelKernels.h"
+#include "RedactionCache.h"
+#include "ScaledImageCache.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Throughput of the pixel kernels on full-screen frames, per ISA, against the
+// scalar loop OverlayWindow used before, and the per-frame cost of dragging a
+// blur box across a 4K capture through RedactionCache (first sweep builds
+// tiles, the second reuses them), and pin zoom: resampling every step of a
+// 100% -> 10% wheel sweep from full resolution versus through
+// ScaledImageCache's mip chain, plus a repaint at an unchanged zoom, and
+// PixelCodec on a screenshot-like 4K frame (what idle pins pay to pack and
+// to come back for copy/save), and PixelDedupRegistry on 4K frames: content
+// hashing per ISA, interning a duplicate (hash plus full compare) and
+// re-interning a registered view. Not registered with ctest.
+
+namespace {
+
+using snappin::CpuBitmap;
+using snappin::PixelKernelIsa;
+
+constexpr float kDimFactor = 0.55f;
+
+struct Frame {
+  std::vector<uint8_t> bytes;
+  CpuBitmap bmp;
+};
+
+Frame MakeFrame(int32_t w, int32_t h) {
+  Frame f;
+  f.bmp.format = snappin::PixelFormat::BGRA8;
+  f.bmp.size_px = {w, h};
+  f.bmp.stride_bytes = w * 4;
+  f.bytes.resize(static_cast<size_t>(w) * static_cast<size_t>(h) * 4);
+  uint32_t state = 1;
+  for (auto& b : f.bytes) {
+    state = state * 1664525u + 1013904223u;
+    b = static_cast<uint8_t>(state >> 24);
+  }
+  f.bmp.data.p = f.bytes.data();
+  return f;
+}
+
+template <typename Fn>
+double BestMs(int iterations, Fn&& fn) {
+  double best = 1e30;
+  for (int i = 0; i < iterations; ++i) {
+    const auto t0 = std::chrono::steady_clock::now();
+    fn();
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    if (ms < best) {
+      best = ms;
+    }
+  }
+  return best;
+}
+
+void ReferenceDim(const Frame& src, Frame* dst) {
+  const size_t total = src.bytes.size();
+  const uint8_t* s = src.bytes.data();
+  uint8_t* d = dst->bytes.data();
+  for (size_t i = 0; i < total; i += 4) {
+    d[i + 0] = static_cast<uint8_t>(s[i + 0] * kDimFactor);
+    d[i + 1] = static_cast<uint8_t>(s[i + 1] * kDimFactor);
+    d[i + 2] = static_cast<uint8_t>(s[i + 2] * kDimFactor);
+    d[i + 3] = 0xFF;
+  }
+}
+
+void Report(const char* kernel, const char* isa, int32_t w, int32_t h, double ms) {
+  const double mpix = static_cast<double>(w) * h / 1e6;
+  std::printf("%-8s %-10s %5dx%-5d %8.3f ms %9.1f Mpx/s\n", kernel, isa, w, h, ms,
+              mpix / (ms / 1000.0));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+  const PixelKernelIsa isas[] = {PixelKernelIsa::Scalar, PixelKernelIsa::SSE2,
+                                 PixelKernelIsa::AVX2, PixelKernelIsa::NEON};
+  const snappin::SizePX sizes[] = {{3840, 2160}, {5120, 2880}};
+  for (const auto& size : sizes) {
+    const Frame src = MakeFrame(size.w, size.h);
+    Frame dst = MakeFrame(size.w, size.h);
+    Report("dim", "reference", size.w, size.h,
+           BestMs(iterations, [&] { ReferenceDim(src, &dst); }));
+    for (PixelKernelIsa isa : isas) {
+      if (!snappin::PixelKernelIsaSupported(isa)) {
+        continue;
+      }
+      const char* name = snappin::PixelKernelIsaName(isa);
+      Report("dim", name, size.w, size.h, BestMs(iterations, [&] {
+               snappin::DimBitmap(src.bmp, &dst.bmp, kDimFactor, isa);
+             }));
+      Report("fill", name, size.w, size.h, BestMs(iterations, [&] {
+               snappin::FillBitmapRect(&dst.bmp, {0, 0, size.w, size.h},
+                                       {0, 0, 0, 255}, isa);
+             }));
+      Report("blend", name, size.w, size.h, BestMs(iterations, [&] {
+               snappin::BlendBitmap(src.bmp, &dst.bmp, 200, isa);
+             }));
+      Report("swizzle", name, size.w, size.h, BestMs(iterations, [&] {
+               snappin::SwizzleBitmapRB(src.bmp, &dst.bmp, isa);
+             }));
+      Report("blur3", name, size.w, size.h, BestMs(iterations, [&] {
+               snappin::BoxBlurBitmap(src.bmp, &dst.bmp, 8, 3, isa);
+             }));
+      Report("mosaic", name, size.w, size.h, BestMs(iterations, [&] {
+               snappin::PixelateBitmap(src.bmp, &dst.bmp, 12, isa);
+             }));
+      Frame half = MakeFrame((size.w + 1) / 2, (size.h + 1) / 2);
+      Report("half", name, size.w, size.h, BestMs(iterations, [&] {
+               snappin::DownsampleHalf(src.bmp, &half.bmp, isa);
+             }));
+      Frame zoomed = MakeFrame(size.w * 7 / 10, size.h * 7 / 10);
+      Report("lanczos", name, size.w, size.h, BestMs(iterations, [&] {
+               snappin::ResizeLanczos(src.bmp, &zoomed.bmp, isa);
+             }));
+      uint64_t hash = 0;
+      const double hash_ms =
+          BestMs(iterations, [&] { hash = snappin::HashBitmap(src.bmp, isa); });
+      Report("hash", name, size.w, size.h, hash_ms);
+      std::printf("%-8s %-10s %.1f GB/s (%016llx)\n", "", "", src.bytes.size() / hash_ms / 1e6,
+                  static_cast<unsigned long long>(hash));
+    }
+  }
+
+  const Frame src = MakeFrame(3840, 2160);
+  Frame dst = MakeFrame(3840, 2160);
+  auto pixels = std::make_shared<std::vector<uint8_t>>(src.bytes);
+  snappin::RedactionCache cache;
+  cache.Reset(snappin::BitmapView::FromBuffer(pixels, {3840, 2160}, 3840 * 4));
+  for (int sweep = 0; sweep < 2; ++sweep) {
+    double worst = 0.0;
+    double total = 0.0;
+    for (int step = 0; step < 60; ++step) {
+      const snappin::RectPX box{step * 54, step * 28, 600, 400};
+      const auto t0 = std::chrono::steady_clock::now();
+      cache.Render(snappin::RedactionKind::Blur, 8, box, dst.bmp);
+      const auto t1 = std::chrono::steady_clock::now();
+      const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+      total += ms;
+      worst = ms > worst ? ms : worst;
+    }
+    std::printf("drag blur 600x400 sweep %d: %.3f ms/frame avg, %.3f ms worst\n", sweep,
+                total / 60.0, worst);
+  }
+
+  // Window sizes a 4K pin steps through on the way from 100% to 10%.
+  std::vector<snappin::SizePX> zooms;
+  for (int step = 20; step >= 2; --step) {
+    zooms.push_back({3840 * step / 20, 2160 * step / 20});
+  }
+  const auto pin = snappin::BitmapView::FromBuffer(pixels, {3840, 2160}, 3840 * 4);
+  std::vector<Frame> outs;
+  for (const auto& zoom : zooms) {
+    outs.push_back(MakeFrame(zoom.w, zoom.h));
+  }
+  snappin::ScaledImageCache zoom_cache(size_t{256} << 20);
+  // Warm the pixel pool so both sides write into touched memory.
+  for (const auto& zoom : zooms) {
+    zoom_cache.Scaled(0, pin, zoom);
+  }
+  zoom_cache.Remove(0);
+  double full_ms[2] = {};
+  double mip_ms[2] = {};
+  for (size_t i = 0; i < zooms.size(); ++i) {
+    // [0]: every step, [1]: steps at or below 50%.
+    const int below = zooms[i].w <= 1920 ? 1 : 0;
+    const double full = BestMs(1, [&] { snappin::ResizeLanczos(src.bmp, &outs[i].bmp); });
+    const double mip = BestMs(1, [&] { zoom_cache.Scaled(1, pin, zooms[i]); });
+    full_ms[0] += full;
+    mip_ms[0] += mip;
+    full_ms[1] += below * full;
+    mip_ms[1] += below * mip;
+  }
+  const double repaint_ms =
+      BestMs(iterations, [&] { zoom_cache.Scaled(1, pin, zooms.back()); });
+  std::printf("zoom sweep 100%%->10%%: full-res %.3f ms, mip %.3f ms; "
+              "at <=50%%: full-res %.3f ms, mip %.3f ms; repaint %.4f ms\n",
+              full_ms[0], mip_ms[0], full_ms[1], mip_ms[1], repaint_ms);
+
+  // Flat panels with rows of text-like speckles, unlike the noise frames above.
+  auto shot = std::make_shared<std::vector<uint8_t>>(size_t{3840} * 2160 * 4);
+  uint32_t state = 7;
+  for (size_t i = 0; i < shot->size(); i += 4) {
+    const size_t y = i / (3840 * 4);
+    uint32_t c = y < 40 ? 0xFF2B579Au : 0xFFF3F3F3u;
+    if (y > 60 && (y / 18) % 2 == 0) {
+      state = state * 1664525u + 1013904223u;
+      c = (state >> 28) < 4 ? 0xFF1E1E1Eu : c;
+    }
+    std::memcpy(shot->data() + i, &c, 4);
+  }
+  const auto shot_view = snappin::BitmapView::FromBuffer(shot, {3840, 2160}, 3840 * 4);
+  std::vector<uint8_t> packed;
+  const double pack_ms =
+      BestMs(iterations, [&] { snappin::CompressPixels(shot_view, &packed); });
+  const double unpack_ms =
+      BestMs(iterations, [&] { snappin::DecompressPixels(packed); });
+  const double mb = static_cast<double>(shot->size()) / (1 << 20);
+  std::printf("pixel codec 3840x2160: %.1fx, compress %.3f ms (%.0f MB/s), "
+              "decompress %.3f ms (%.0f MB/s)\n",
+              static_cast<double>(shot->size()) / packed.size(), pack_ms, mb / pack_ms * 1000,
+              unpack_ms, mb / unpack_ms * 1000);
+
+  // A second capture of the same screen: a separate buffer, equal pixels.
+  snappin::PixelDedupRegistry registry;
+  const auto original = registry.Intern(shot_view);
+  const auto duplicate = snappin::BitmapView::FromBuffer(
+      std::make_shared<std::vector<uint8_t>>(*shot), {3840, 2160}, 3840 * 4);
+  snappin::BitmapView interned;
+  const double dup_ms = BestMs(iterations, [&] { interned = registry.Intern(duplicate); });
+  const double known_ms = BestMs(iterations, [&] { registry.Intern(original); });
+  std::printf("pixel dedup 3840x2160: intern duplicate %.3f ms (%s), "
+              "re-intern registered %.4f ms, %llu hits\n",
+              dup_ms, interned.SharesBufferWith(original) ? "shared" : "NOT shared", known_ms,
+              static_cast<unsigned long long>(registry.Stats().hits));
+  return 0;
+}
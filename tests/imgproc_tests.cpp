@@ -0,0 +1,717 @@
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using snappin::CpuBitmap;
+using snappin::PixelFormat;
+using snappin::PixelKernelIsa;
+
+const PixelKernelIsa kIsas[] = {PixelKernelIsa::Scalar, PixelKernelIsa::SSE2,
+                                PixelKernelIsa::AVX2, PixelKernelIsa::NEON};
+
+struct TestImage {
+  std::vector<uint8_t> bytes;
+  CpuBitmap bmp;
+};
+
+TestImage MakeImage(int32_t w, int32_t h, int32_t pad, uint32_t seed,
+                    PixelFormat format = PixelFormat::BGRA8) {
+  TestImage img;
+  img.bmp.format = format;
+  img.bmp.size_px = {w, h};
+  img.bmp.stride_bytes = w * 4 + pad;
+  img.bytes.resize(static_cast<size_t>(img.bmp.stride_bytes) * static_cast<size_t>(h));
+  uint32_t state = seed;
+  for (auto& b : img.bytes) {
+    state = state * 1664525u + 1013904223u;
+    b = static_cast<uint8_t>(state >> 24);
+  }
+  img.bmp.data.p = img.bytes.data();
+  return img;
+}
+
+TestImage CloneImage(const TestImage& src) {
+  TestImage img = src;
+  img.bmp.data.p = img.bytes.data();
+  return img;
+}
+
+// The loop OverlayWindow::SetFrozenFrame used before the kernels existed.
+void ReferenceDim(const TestImage& src, TestImage* dst, float factor) {
+  for (int32_t y = 0; y < src.bmp.size_px.h; ++y) {
+    const uint8_t* s = src.bytes.data() + static_cast<size_t>(y) * src.bmp.stride_bytes;
+    uint8_t* d = dst->bytes.data() + static_cast<size_t>(y) * dst->bmp.stride_bytes;
+    for (int32_t x = 0; x < src.bmp.size_px.w; ++x) {
+      const size_t i = static_cast<size_t>(x) * 4;
+      d[i + 0] = static_cast<uint8_t>(s[i + 0] * factor);
+      d[i + 1] = static_cast<uint8_t>(s[i + 1] * factor);
+      d[i + 2] = static_cast<uint8_t>(s[i + 2] * factor);
+      d[i + 3] = 0xFF;
+    }
+  }
+}
+
+uint32_t RefDiv255(uint32_t x) { return (x + 127) / 255; }
+
+void ReferenceBlend(const TestImage& src, TestImage* dst, uint8_t opacity) {
+  for (int32_t y = 0; y < src.bmp.size_px.h; ++y) {
+    const uint8_t* s = src.bytes.data() + static_cast<size_t>(y) * src.bmp.stride_bytes;
+    uint8_t* d = dst->bytes.data() + static_cast<size_t>(y) * dst->bmp.stride_bytes;
+    for (int32_t x = 0; x < src.bmp.size_px.w; ++x) {
+      const size_t i = static_cast<size_t>(x) * 4;
+      const uint32_t a = RefDiv255(s[i + 3] * static_cast<uint32_t>(opacity));
+      for (int c = 0; c < 3; ++c) {
+        d[i + c] = static_cast<uint8_t>(RefDiv255(s[i + c] * a + d[i + c] * (255 - a)));
+      }
+      d[i + 3] = static_cast<uint8_t>(RefDiv255(255 * a + d[i + 3] * (255 - a)));
+    }
+  }
+}
+
+bool SameBytes(const TestImage& a, const TestImage& b) { return a.bytes == b.bytes; }
+
+// Straightforward box blur with the rounding documented on BoxBlurBitmap.
+void ReferenceBoxBlur(const TestImage& src, TestImage* dst, int32_t r, int32_t passes) {
+  const int32_t w = src.bmp.size_px.w;
+  const int32_t h = src.bmp.size_px.h;
+  const uint32_t mul = (65536u + static_cast<uint32_t>(r)) / static_cast<uint32_t>(2 * r + 1);
+  const auto at = [&](const std::vector<uint8_t>& img, int32_t x, int32_t y, int c) {
+    x = x < 0 ? 0 : (x >= w ? w - 1 : x);
+    y = y < 0 ? 0 : (y >= h ? h - 1 : y);
+    return static_cast<uint32_t>(img[static_cast<size_t>(y) * w * 4 + x * 4 + c]);
+  };
+  const auto scale = [&](uint32_t sum) {
+    const uint32_t v = (sum * mul + 32768) >> 16;
+    return static_cast<uint8_t>(v > 255 ? 255 : v);
+  };
+  std::vector<uint8_t> cur(static_cast<size_t>(w) * h * 4);
+  for (int32_t y = 0; y < h; ++y) {
+    std::memcpy(cur.data() + static_cast<size_t>(y) * w * 4,
+                src.bytes.data() + static_cast<size_t>(y) * src.bmp.stride_bytes,
+                static_cast<size_t>(w) * 4);
+  }
+  std::vector<uint8_t> tmp(cur.size());
+  for (int32_t pass = 0; pass < passes; ++pass) {
+    for (int32_t y = 0; y < h; ++y) {
+      for (int32_t x = 0; x < w; ++x) {
+        for (int c = 0; c < 4; ++c) {
+          uint32_t sum = 0;
+          for (int32_t k = -r; k <= r; ++k) {
+            sum += at(cur, x + k, y, c);
+          }
+          tmp[static_cast<size_t>(y) * w * 4 + x * 4 + c] = scale(sum);
+        }
+      }
+    }
+    for (int32_t y = 0; y < h; ++y) {
+      for (int32_t x = 0; x < w; ++x) {
+        for (int c = 0; c < 4; ++c) {
+          uint32_t sum = 0;
+          for (int32_t k = -r; k <= r; ++k) {
+            sum += at(tmp, x, y + k, c);
+          }
+          cur[static_cast<size_t>(y) * w * 4 + x * 4 + c] = scale(sum);
+        }
+      }
+    }
+  }
+  for (int32_t y = 0; y < h; ++y) {
+    std::memcpy(dst->bytes.data() + static_cast<size_t>(y) * dst->bmp.stride_bytes,
+                cur.data() + static_cast<size_t>(y) * w * 4, static_cast<size_t>(w) * 4);
+  }
+}
+
+void ReferencePixelate(const TestImage& src, TestImage* dst, int32_t cell) {
+  const int32_t w = src.bmp.size_px.w;
+  const int32_t h = src.bmp.size_px.h;
+  for (int32_t y0 = 0; y0 < h; y0 += cell) {
+    for (int32_t x0 = 0; x0 < w; x0 += cell) {
+      const int32_t x1 = x0 + cell < w ? x0 + cell : w;
+      const int32_t y1 = y0 + cell < h ? y0 + cell : h;
+      const uint32_t n = static_cast<uint32_t>((x1 - x0) * (y1 - y0));
+      for (int c = 0; c < 4; ++c) {
+        uint32_t sum = 0;
+        for (int32_t y = y0; y < y1; ++y) {
+          for (int32_t x = x0; x < x1; ++x) {
+            sum += src.bytes[static_cast<size_t>(y) * src.bmp.stride_bytes + x * 4 + c];
+          }
+        }
+        const uint8_t mean = static_cast<uint8_t>((sum + n / 2) / n);
+        for (int32_t y = y0; y < y1; ++y) {
+          for (int32_t x = x0; x < x1; ++x) {
+            dst->bytes[static_cast<size_t>(y) * dst->bmp.stride_bytes + x * 4 + c] = mean;
+          }
+        }
+      }
+    }
+  }
+}
+
+int TestDim() {
+  const int32_t widths[] = {1, 3, 4, 7, 8, 15, 16, 17, 33, 257};
+  const float factors[] = {0.0f, 0.1f, 0.25f, 0.3333f, 0.5f, 0.55f, 0.7f, 0.9f, 1.0f};
+  for (PixelKernelIsa isa : kIsas) {
+    if (!snappin::PixelKernelIsaSupported(isa)) {
+      continue;
+    }
+    for (int32_t w : widths) {
+      for (float f : factors) {
+        const TestImage src = MakeImage(w, 5, (w % 3) * 4, static_cast<uint32_t>(w));
+        TestImage expected = CloneImage(src);
+        TestImage actual = CloneImage(src);
+        ReferenceDim(src, &expected, f);
+        if (!snappin::DimBitmap(src.bmp, &actual.bmp, f, isa) ||
+            !SameBytes(expected, actual)) {
+          std::fprintf(stderr, "dim mismatch isa=%s w=%d f=%f\n",
+                       snappin::PixelKernelIsaName(isa), w, static_cast<double>(f));
+          return 10;
+        }
+        // In place.
+        TestImage inplace = CloneImage(src);
+        if (!snappin::DimBitmap(inplace.bmp, &inplace.bmp, f, isa) ||
+            !SameBytes(expected, inplace)) {
+          return 11;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+int TestFill() {
+  const snappin::RectPX rects[] = {
+      {0, 0, 40, 9}, {-5, -5, 12, 4}, {3, 2, 17, 5}, {35, 7, 100, 100}, {50, 0, 4, 4}};
+  const snappin::ColorRGBA color{10, 20, 30, 40};
+  for (PixelKernelIsa isa : kIsas) {
+    if (!snappin::PixelKernelIsaSupported(isa)) {
+      continue;
+    }
+    for (PixelFormat format : {PixelFormat::BGRA8, PixelFormat::RGBA8}) {
+      for (const auto& r : rects) {
+        TestImage actual = MakeImage(40, 9, 8, 7, format);
+        TestImage expected = CloneImage(actual);
+        const uint8_t px[4] = {format == PixelFormat::BGRA8 ? color.b : color.r, color.g,
+                               format == PixelFormat::BGRA8 ? color.r : color.b, color.a};
+        for (int32_t y = 0; y < 9; ++y) {
+          for (int32_t x = 0; x < 40; ++x) {
+            if (x >= r.x && x < r.x + r.w && y >= r.y && y < r.y + r.h) {
+              std::memcpy(expected.bytes.data() +
+                              static_cast<size_t>(y) * expected.bmp.stride_bytes +
+                              static_cast<size_t>(x) * 4,
+                          px, 4);
+            }
+          }
+        }
+        if (!snappin::FillBitmapRect(&actual.bmp, r, color, isa) ||
+            !SameBytes(expected, actual)) {
+          return 20;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+int TestBlend() {
+  const int32_t widths[] = {1, 5, 8, 13, 16, 31, 64, 101};
+  const uint8_t opacities[] = {0, 1, 77, 128, 200, 254, 255};
+  for (PixelKernelIsa isa : kIsas) {
+    if (!snappin::PixelKernelIsaSupported(isa)) {
+      continue;
+    }
+    for (int32_t w : widths) {
+      for (uint8_t op : opacities) {
+        const TestImage src = MakeImage(w, 4, 12, 99u + static_cast<uint32_t>(w));
+        TestImage expected = MakeImage(w, 4, 12, 5u + static_cast<uint32_t>(op));
+        TestImage actual = CloneImage(expected);
+        ReferenceBlend(src, &expected, op);
+        if (!snappin::BlendBitmap(src.bmp, &actual.bmp, op, isa) ||
+            !SameBytes(expected, actual)) {
+          std::fprintf(stderr, "blend mismatch isa=%s w=%d op=%d\n",
+                       snappin::PixelKernelIsaName(isa), w, op);
+          return 30;
+        }
+      }
+    }
+  }
+  // Formats must match.
+  const TestImage a = MakeImage(4, 4, 0, 1, PixelFormat::BGRA8);
+  TestImage b = MakeImage(4, 4, 0, 2, PixelFormat::RGBA8);
+  if (snappin::BlendBitmap(a.bmp, &b.bmp)) {
+    return 31;
+  }
+  return 0;
+}
+
+int TestSwizzle() {
+  const int32_t widths[] = {1, 2, 7, 8, 9, 16, 17, 63, 64, 65};
+  for (PixelKernelIsa isa : kIsas) {
+    if (!snappin::PixelKernelIsaSupported(isa)) {
+      continue;
+    }
+    for (int32_t w : widths) {
+      const TestImage src = MakeImage(w, 3, 4, 1234u + static_cast<uint32_t>(w));
+      TestImage expected = CloneImage(src);
+      for (int32_t y = 0; y < 3; ++y) {
+        uint8_t* row = expected.bytes.data() + static_cast<size_t>(y) * src.bmp.stride_bytes;
+        for (int32_t x = 0; x < w; ++x) {
+          std::swap(row[x * 4 + 0], row[x * 4 + 2]);
+        }
+      }
+      TestImage actual = CloneImage(src);
+      if (!snappin::SwizzleBitmapRB(src.bmp, &actual.bmp, isa) ||
+          !SameBytes(expected, actual) || actual.bmp.format != PixelFormat::RGBA8) {
+        return 40;
+      }
+      // Swizzling twice in place restores the source.
+      if (!snappin::SwizzleBitmapRB(actual.bmp, &actual.bmp, isa) ||
+          !SameBytes(src, actual) || actual.bmp.format != PixelFormat::BGRA8) {
+        return 41;
+      }
+    }
+  }
+  return 0;
+}
+
+int TestBoxBlur() {
+  struct Case {
+    int32_t w, h, radius, passes;
+  };
+  const Case cases[] = {{1, 1, 1, 1},   {7, 5, 1, 1},  {17, 9, 2, 3},  {33, 20, 5, 1},
+                        {40, 3, 9, 2},  {64, 64, 64, 1}, {19, 31, 4, 3}, {8, 8, 0, 3}};
+  for (PixelKernelIsa isa : kIsas) {
+    if (!snappin::PixelKernelIsaSupported(isa)) {
+      continue;
+    }
+    for (const Case& c : cases) {
+      const TestImage src =
+          MakeImage(c.w, c.h, (c.w % 3) * 4, 31u * static_cast<uint32_t>(c.w + c.h));
+      TestImage expected = CloneImage(src);
+      if (c.radius > 0) {
+        ReferenceBoxBlur(src, &expected, c.radius, c.passes);
+      }
+      TestImage actual = MakeImage(c.w, c.h, (c.w % 3) * 4, 1);
+      // Row padding is not touched.
+      for (int32_t y = 0; y < c.h; ++y) {
+        std::memcpy(expected.bytes.data() + static_cast<size_t>(y) * src.bmp.stride_bytes +
+                        static_cast<size_t>(c.w) * 4,
+                    actual.bytes.data() + static_cast<size_t>(y) * src.bmp.stride_bytes +
+                        static_cast<size_t>(c.w) * 4,
+                    static_cast<size_t>(src.bmp.stride_bytes - c.w * 4));
+      }
+      if (!snappin::BoxBlurBitmap(src.bmp, &actual.bmp, c.radius, c.passes, isa) ||
+          !SameBytes(expected, actual)) {
+        std::fprintf(stderr, "box blur mismatch isa=%s w=%d h=%d r=%d\n",
+                     snappin::PixelKernelIsaName(isa), c.w, c.h, c.radius);
+        return 60;
+      }
+      TestImage inplace = CloneImage(src);
+      TestImage inplace_expected = CloneImage(src);
+      if (c.radius > 0) {
+        ReferenceBoxBlur(src, &inplace_expected, c.radius, c.passes);
+      }
+      if (!snappin::BoxBlurBitmap(inplace.bmp, &inplace.bmp, c.radius, c.passes, isa) ||
+          !SameBytes(inplace_expected, inplace)) {
+        return 61;
+      }
+    }
+  }
+  // A flat image stays flat at any radius, including ones wider than it.
+  TestImage flat = MakeImage(21, 13, 0, 1);
+  std::memset(flat.bytes.data(), 0xC8, flat.bytes.size());
+  const TestImage before = CloneImage(flat);
+  if (!snappin::BoxBlurBitmap(flat.bmp, &flat.bmp, 200, 3) || !SameBytes(before, flat)) {
+    return 62;
+  }
+  return 0;
+}
+
+int TestPixelate() {
+  const int32_t widths[] = {1, 5, 16, 33, 70};
+  const int32_t cells[] = {1, 2, 3, 8, 16, 256};
+  for (PixelKernelIsa isa : kIsas) {
+    if (!snappin::PixelKernelIsaSupported(isa)) {
+      continue;
+    }
+    for (int32_t w : widths) {
+      for (int32_t cell : cells) {
+        const TestImage src = MakeImage(w, 11, 8, 77u + static_cast<uint32_t>(w * cell));
+        TestImage expected = CloneImage(src);
+        ReferencePixelate(src, &expected, cell);
+        TestImage actual = CloneImage(src);
+        if (!snappin::PixelateBitmap(actual.bmp, &actual.bmp, cell, isa) ||
+            !SameBytes(expected, actual)) {
+          std::fprintf(stderr, "pixelate mismatch isa=%s w=%d cell=%d\n",
+                       snappin::PixelKernelIsaName(isa), w, cell);
+          return 70;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+void ReferenceDownsampleHalf(const TestImage& src, TestImage* dst) {
+  const int32_t w = src.bmp.size_px.w;
+  const int32_t h = src.bmp.size_px.h;
+  for (int32_t y = 0; y < dst->bmp.size_px.h; ++y) {
+    for (int32_t x = 0; x < dst->bmp.size_px.w; ++x) {
+      const int32_t xs[2] = {2 * x, std::min(2 * x + 1, w - 1)};
+      const int32_t ys[2] = {2 * y, std::min(2 * y + 1, h - 1)};
+      for (int c = 0; c < 4; ++c) {
+        int32_t sum = 2;
+        for (int32_t sy : ys) {
+          for (int32_t sx : xs) {
+            sum += src.bytes[static_cast<size_t>(sy) * src.bmp.stride_bytes +
+                             static_cast<size_t>(sx) * 4 + c];
+          }
+        }
+        dst->bytes[static_cast<size_t>(y) * dst->bmp.stride_bytes + static_cast<size_t>(x) * 4 +
+                   c] = static_cast<uint8_t>(sum >> 2);
+      }
+    }
+  }
+}
+
+double Lanczos2(double x) {
+  x = std::fabs(x);
+  if (x < 1e-9) {
+    return 1.0;
+  }
+  if (x >= 2.0) {
+    return 0.0;
+  }
+  const double px = 3.14159265358979323846 * x;
+  return 2.0 * std::sin(px) * std::sin(px / 2.0) / (px * px);
+}
+
+// Floating-point Lanczos-2 along one axis with clamped edges, rounded to bytes.
+std::vector<uint8_t> ResampleLine(const std::vector<uint8_t>& in, int32_t len, int32_t out_len) {
+  const double scale = static_cast<double>(out_len) / len;
+  const double fs = std::min(scale, 1.0);
+  const double support = 2.0 / fs;
+  std::vector<uint8_t> out(static_cast<size_t>(out_len) * 4);
+  for (int32_t i = 0; i < out_len; ++i) {
+    const double center = (i + 0.5) / scale - 0.5;
+    double acc[4] = {};
+    double total = 0.0;
+    for (int32_t j = static_cast<int32_t>(std::floor(center - support));
+         j <= static_cast<int32_t>(std::ceil(center + support)); ++j) {
+      const double wgt = Lanczos2((j - center) * fs);
+      const int32_t k = std::clamp(j, 0, len - 1);
+      for (int c = 0; c < 4; ++c) {
+        acc[c] += wgt * in[static_cast<size_t>(k) * 4 + c];
+      }
+      total += wgt;
+    }
+    for (int c = 0; c < 4; ++c) {
+      out[static_cast<size_t>(i) * 4 + c] =
+          static_cast<uint8_t>(std::clamp(std::lround(acc[c] / total), 0L, 255L));
+    }
+  }
+  return out;
+}
+
+int TestDownsampleHalf() {
+  const int32_t widths[] = {1, 2, 3, 7, 8, 9, 16, 17, 33, 64, 65};
+  const int32_t heights[] = {1, 2, 5};
+  for (PixelKernelIsa isa : kIsas) {
+    if (!snappin::PixelKernelIsaSupported(isa)) {
+      continue;
+    }
+    for (int32_t w : widths) {
+      for (int32_t h : heights) {
+        const TestImage src = MakeImage(w, h, 4, 5u + static_cast<uint32_t>(w * h));
+        const int32_t dw = (w + 1) / 2;
+        const int32_t dh = (h + 1) / 2;
+        TestImage expected = MakeImage(dw, dh, 8, 9);
+        TestImage actual = CloneImage(expected);
+        ReferenceDownsampleHalf(src, &expected);
+        if (!snappin::DownsampleHalf(src.bmp, &actual.bmp, isa) ||
+            !SameBytes(expected, actual)) {
+          std::fprintf(stderr, "downsample mismatch isa=%s w=%d h=%d\n",
+                       snappin::PixelKernelIsaName(isa), w, h);
+          return 80;
+        }
+      }
+    }
+  }
+  const TestImage src = MakeImage(9, 9, 0, 1);
+  TestImage wrong = MakeImage(4, 5, 0, 1);
+  if (snappin::DownsampleHalf(src.bmp, &wrong.bmp)) {
+    return 81;
+  }
+  return 0;
+}
+
+// Tightly packed dw x dh result of the separable reference: rows first, then columns,
+// rounding after each pass like the kernels.
+std::vector<uint8_t> ReferenceResize(const TestImage& src, int32_t dw, int32_t dh) {
+  const int32_t sw = src.bmp.size_px.w;
+  const int32_t sh = src.bmp.size_px.h;
+  std::vector<uint8_t> mid(static_cast<size_t>(sw) * dh * 4);
+  for (int32_t x = 0; x < sw; ++x) {
+    std::vector<uint8_t> column(static_cast<size_t>(sh) * 4);
+    for (int32_t y = 0; y < sh; ++y) {
+      std::memcpy(&column[static_cast<size_t>(y) * 4],
+                  &src.bytes[static_cast<size_t>(y) * src.bmp.stride_bytes +
+                             static_cast<size_t>(x) * 4],
+                  4);
+    }
+    const std::vector<uint8_t> out = ResampleLine(column, sh, dh);
+    for (int32_t y = 0; y < dh; ++y) {
+      std::memcpy(&mid[(static_cast<size_t>(y) * sw + x) * 4], &out[static_cast<size_t>(y) * 4],
+                  4);
+    }
+  }
+  std::vector<uint8_t> result;
+  result.reserve(static_cast<size_t>(dw) * dh * 4);
+  for (int32_t y = 0; y < dh; ++y) {
+    const std::vector<uint8_t> row(mid.begin() + static_cast<ptrdiff_t>(y) * sw * 4,
+                                   mid.begin() + static_cast<ptrdiff_t>(y + 1) * sw * 4);
+    const std::vector<uint8_t> expected = ResampleLine(row, sw, dw);
+    result.insert(result.end(), expected.begin(), expected.end());
+  }
+  return result;
+}
+
+// Largest per-byte difference against a ReferenceResize result.
+int32_t MaxResizeError(const TestImage& actual, const std::vector<uint8_t>& expected) {
+  const size_t row_bytes = static_cast<size_t>(actual.bmp.size_px.w) * 4;
+  int32_t worst = 0;
+  for (int32_t y = 0; y < actual.bmp.size_px.h; ++y) {
+    for (size_t i = 0; i < row_bytes; ++i) {
+      const int32_t got = actual.bytes[static_cast<size_t>(y) * actual.bmp.stride_bytes + i];
+      worst = std::max(worst, std::abs(got - expected[static_cast<size_t>(y) * row_bytes + i]));
+    }
+  }
+  return worst;
+}
+
+int TestResizeLanczos() {
+  struct Case {
+    int32_t sw, sh, dw, dh;
+  };
+  const Case cases[] = {{40, 30, 20, 15}, {64, 48, 37, 29}, {17, 9, 30, 20},
+                        {100, 3, 1, 1},   {33, 21, 33, 10}, {3, 70, 65, 36},
+                        {256, 4, 129, 4}};
+  for (const Case& c : cases) {
+    const TestImage src = MakeImage(c.sw, c.sh, 12, 17u + static_cast<uint32_t>(c.sw));
+    TestImage scalar = MakeImage(c.dw, c.dh, 4, 3);
+    if (!snappin::ResizeLanczos(src.bmp, &scalar.bmp, PixelKernelIsa::Scalar)) {
+      return 90;
+    }
+    const int32_t error = MaxResizeError(scalar, ReferenceResize(src, c.dw, c.dh));
+    if (error > 2) {
+      std::fprintf(stderr, "lanczos off by %d at %dx%d -> %dx%d\n", error, c.sw, c.sh, c.dw,
+                   c.dh);
+      return 91;
+    }
+    for (PixelKernelIsa isa : kIsas) {
+      if (!snappin::PixelKernelIsaSupported(isa)) {
+        continue;
+      }
+      TestImage actual = MakeImage(c.dw, c.dh, 4, 3);
+      if (!snappin::ResizeLanczos(src.bmp, &actual.bmp, isa) || !SameBytes(scalar, actual)) {
+        std::fprintf(stderr, "lanczos mismatch isa=%s %dx%d -> %dx%d\n",
+                     snappin::PixelKernelIsaName(isa), c.sw, c.sh, c.dw, c.dh);
+        return 92;
+      }
+    }
+  }
+  // Flat images stay flat; equal sizes copy; aliasing is rejected.
+  TestImage flat = MakeImage(50, 40, 0, 1);
+  std::memset(flat.bytes.data(), 0x5A, flat.bytes.size());
+  TestImage small = MakeImage(23, 17, 0, 2);
+  if (!snappin::ResizeLanczos(flat.bmp, &small.bmp)) {
+    return 93;
+  }
+  for (uint8_t b : small.bytes) {
+    if (b != 0x5A) {
+      return 94;
+    }
+  }
+  TestImage copy = MakeImage(23, 17, 0, 3);
+  if (!snappin::ResizeLanczos(small.bmp, &copy.bmp) || !SameBytes(small, copy)) {
+    return 95;
+  }
+  if (snappin::ResizeLanczos(small.bmp, &small.bmp)) {
+    return 96;
+  }
+  return 0;
+}
+
+// Images past the strip threshold run in row strips; the bytes must not change.
+int TestStrips() {
+  const TestImage src = MakeImage(600, 500, 8, 4242u);
+  const int32_t radii[] = {5, 40};
+  for (int32_t radius : radii) {
+    TestImage expected = CloneImage(src);
+    ReferenceBoxBlur(src, &expected, radius, 2);
+    TestImage actual = CloneImage(src);
+    if (!snappin::BoxBlurBitmap(actual.bmp, &actual.bmp, radius, 2) ||
+        !SameBytes(expected, actual)) {
+      std::fprintf(stderr, "strip box blur mismatch r=%d\n", radius);
+      return 110;
+    }
+  }
+  TestImage pixelated = CloneImage(src);
+  TestImage pixelated_expected = CloneImage(src);
+  ReferencePixelate(src, &pixelated_expected, 7);
+  if (!snappin::PixelateBitmap(pixelated.bmp, &pixelated.bmp, 7) ||
+      !SameBytes(pixelated_expected, pixelated)) {
+    return 111;
+  }
+  TestImage half_expected = MakeImage(300, 250, 4, 9);
+  TestImage half = CloneImage(half_expected);
+  ReferenceDownsampleHalf(src, &half_expected);
+  if (!snappin::DownsampleHalf(src.bmp, &half.bmp, PixelKernelIsa::Auto,
+                               snappin::TaskPriority::Background) ||
+      !SameBytes(half_expected, half)) {
+    return 112;
+  }
+  TestImage resized = MakeImage(430, 310, 4, 3);
+  if (!snappin::ResizeLanczos(src.bmp, &resized.bmp, PixelKernelIsa::Auto,
+                              snappin::TaskPriority::Background) ||
+      MaxResizeError(resized, ReferenceResize(src, 430, 310)) > 2) {
+    return 113;
+  }
+  return 0;
+}
+
+// Same pixels at another stride (fresh padding bytes).
+TestImage Restride(const TestImage& src, int32_t pad) {
+  TestImage img = MakeImage(src.bmp.size_px.w, src.bmp.size_px.h, pad, 99, src.bmp.format);
+  for (int32_t y = 0; y < src.bmp.size_px.h; ++y) {
+    std::memcpy(img.bytes.data() + static_cast<size_t>(y) * img.bmp.stride_bytes,
+                src.bytes.data() + static_cast<size_t>(y) * src.bmp.stride_bytes,
+                static_cast<size_t>(src.bmp.size_px.w) * 4);
+  }
+  return img;
+}
+
+int TestHash() {
+  const int32_t widths[] = {1, 15, 16, 17, 255, 256, 257, 300, 1031};
+  for (int32_t w : widths) {
+    const TestImage img = MakeImage(w, 5, 12, 4321u + static_cast<uint32_t>(w));
+    const uint64_t expected = snappin::HashBitmap(img.bmp, PixelKernelIsa::Scalar);
+    for (PixelKernelIsa isa : kIsas) {
+      if (snappin::PixelKernelIsaSupported(isa) && snappin::HashBitmap(img.bmp, isa) != expected) {
+        std::fprintf(stderr, "hash %s w=%d differs from scalar\n",
+                     snappin::PixelKernelIsaName(isa), w);
+        return 100;
+      }
+    }
+    // Row padding is not part of the content.
+    if (snappin::HashBitmap(Restride(img, 0).bmp) != expected) {
+      return 101;
+    }
+    // Any changed byte, including ones in the zero-padded row tail.
+    for (size_t x : {size_t{0}, static_cast<size_t>(w) * 2, static_cast<size_t>(w) * 4 - 1}) {
+      TestImage changed = CloneImage(img);
+      changed.bytes[static_cast<size_t>(img.bmp.stride_bytes) * 3 + x] ^= 0x01;
+      if (snappin::HashBitmap(changed.bmp) == expected) {
+        return 102;
+      }
+    }
+    // Reordered rows.
+    TestImage swapped = CloneImage(img);
+    std::swap_ranges(swapped.bytes.begin(), swapped.bytes.begin() + img.bmp.stride_bytes,
+                     swapped.bytes.begin() + img.bmp.stride_bytes);
+    if (snappin::HashBitmap(swapped.bmp) == expected) {
+      return 103;
+    }
+  }
+  // Reordered 64-byte stripes within and across blocks of a row.
+  const TestImage wide = MakeImage(1024, 2, 0, 8);
+  const uint64_t wide_hash = snappin::HashBitmap(wide.bmp);
+  for (size_t other : {size_t{64}, size_t{64} * 20}) {
+    TestImage swapped = CloneImage(wide);
+    std::swap_ranges(swapped.bytes.begin(), swapped.bytes.begin() + 64,
+                     swapped.bytes.begin() + static_cast<ptrdiff_t>(other));
+    if (snappin::HashBitmap(swapped.bmp) == wide_hash) {
+      return 104;
+    }
+  }
+  // The same bytes as another shape or format.
+  TestImage reshaped = CloneImage(wide);
+  reshaped.bmp.size_px = {512, 4};
+  reshaped.bmp.stride_bytes = 512 * 4;
+  TestImage rgba = CloneImage(wide);
+  rgba.bmp.format = PixelFormat::RGBA8;
+  if (snappin::HashBitmap(reshaped.bmp) == wide_hash ||
+      snappin::HashBitmap(rgba.bmp) == wide_hash || snappin::HashBitmap(CpuBitmap{}) != 0) {
+    return 105;
+  }
+  return 0;
+}
+
+int TestInvalidInput() {
+  CpuBitmap empty;
+  TestImage img = MakeImage(4, 4, 0, 3);
+  if (snappin::DimBitmap(empty, &img.bmp, 0.5f)) {
+    return 50;
+  }
+  TestImage small = MakeImage(3, 4, 0, 3);
+  if (snappin::DimBitmap(img.bmp, &small.bmp, 0.5f)) {
+    return 51;
+  }
+  if (snappin::SwizzleBitmapRB(img.bmp, nullptr)) {
+    return 52;
+  }
+  if (snappin::BoxBlurBitmap(img.bmp, &small.bmp, 2) ||
+      snappin::PixelateBitmap(empty, &img.bmp, 4)) {
+    return 53;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  std::printf("pixel kernels: active isa %s\n",
+              snappin::PixelKernelIsaName(snappin::ActivePixelKernelIsa()));
+  if (int rc = TestDim()) {
+    return rc;
+  }
+  if (int rc = TestFill()) {
+    return rc;
+  }
+  if (int rc = TestBlend()) {
+    return rc;
+  }
+  if (int rc = TestSwizzle()) {
+    return rc;
+  }
+  if (int rc = TestBoxBlur()) {
+    return rc;
+  }
+  if (int rc = TestPixelate()) {
+    return rc;
+  }
+  if (int rc = TestDownsampleHalf()) {
+    return rc;
+  }
+  if (int rc = TestResizeLanczos()) {
+    return rc;
+  }
+  if (int rc = TestStrips()) {
+    return rc;
+  }
+  if (int rc = TestHash()) {
+    return rc;
+  }
+  if (int rc = TestInvalidInput()) {
+    return rc;
+  }
+  return 0;
+}
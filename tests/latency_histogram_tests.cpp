@@ -0,0 +1,115 @@
+#include "LatencyHistogram.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using snappin::LatencyHistogram;
+using snappin::LatencySummary;
+
+bool Near(double actual, double expected, double rel) {
+  return std::fabs(actual - expected) <= expected * rel;
+}
+
+} // namespace
+
+int main() {
+  // Every value lands in a bucket whose upper edge covers it within 1/32,
+  // and bucket edges map back to their own bucket.
+  for (uint64_t v = 0; v < (uint64_t{1} << 32); v = v < 4096 ? v + 1 : v + v / 7) {
+    const size_t index = LatencyHistogram::BucketIndex(v);
+    const uint64_t upper = LatencyHistogram::BucketUpperMicros(index);
+    if (index >= LatencyHistogram::kBucketCount || upper < v ||
+        (v >= 64 && upper - v > v / 32)) {
+      return 1;
+    }
+    if (v < 64 && upper != v) {
+      return 2;
+    }
+  }
+  for (size_t i = 0; i + 1 < LatencyHistogram::kBucketCount; ++i) {
+    const uint64_t upper = LatencyHistogram::BucketUpperMicros(i);
+    if (LatencyHistogram::BucketIndex(upper) != i ||
+        LatencyHistogram::BucketIndex(upper + 1) != i + 1) {
+      return 3;
+    }
+  }
+  if (LatencyHistogram::BucketIndex(UINT64_MAX) != LatencyHistogram::kBucketCount - 1) {
+    return 4;
+  }
+
+  LatencyHistogram hist;
+  const LatencySummary empty = hist.Summary();
+  if (empty.count != 0 || empty.p99_ms != 0 || empty.max_ms != 0) {
+    return 5;
+  }
+
+  // 1..10000 us: true percentiles, not the last value.
+  for (uint64_t us = 10000; us >= 1; --us) {
+    hist.RecordMicros(us);
+  }
+  LatencySummary s = hist.Summary();
+  if (s.count != 10000 || !Near(s.p50_ms, 5.0, 0.035) || !Near(s.p95_ms, 9.5, 0.035) ||
+      !Near(s.p99_ms, 9.9, 0.035) || s.max_ms != 10.0 || !Near(s.mean_ms, 5.0005, 1e-9)) {
+    return 6;
+  }
+  if (s.p99_ms > s.max_ms || s.p50_ms > s.p95_ms || s.p95_ms > s.p99_ms) {
+    return 7;
+  }
+
+  // Snapshot-and-reset hands the samples over exactly once.
+  LatencySummary taken = hist.SnapshotAndReset();
+  if (taken.count != 10000 || taken.p95_ms != s.p95_ms || hist.Summary().count != 0) {
+    return 8;
+  }
+
+  // Sub-millisecond resolution; negative durations clamp to zero.
+  for (int i = 0; i < 99; ++i) {
+    hist.RecordMs(0.25);
+  }
+  hist.RecordMs(-3.0);
+  s = hist.SnapshotAndReset();
+  if (s.count != 100 || !Near(s.p50_ms, 0.25, 0.02) || !Near(s.max_ms, 0.25, 1e-9)) {
+    return 9;
+  }
+
+  // Concurrent writers and a concurrent scraper lose and duplicate nothing.
+  constexpr int kThreads = 4;
+  constexpr uint64_t kPerThread = 200000;
+  std::atomic<bool> done{false};
+  uint64_t scraped = 0;
+  double scraped_max = 0;
+  std::thread scraper([&] {
+    while (!done.load()) {
+      const LatencySummary part = hist.SnapshotAndReset();
+      scraped += part.count;
+      scraped_max = std::fmax(scraped_max, part.max_ms);
+      std::this_thread::yield();
+    }
+  });
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kThreads; ++t) {
+    writers.emplace_back([&hist, t] {
+      for (uint64_t i = 0; i < kPerThread; ++i) {
+        hist.RecordMicros((i * 7919 + static_cast<uint64_t>(t)) % 50000);
+      }
+    });
+  }
+  for (auto& w : writers) {
+    w.join();
+  }
+  done.store(true);
+  scraper.join();
+  const LatencySummary rest = hist.SnapshotAndReset();
+  if (scraped + rest.count != kThreads * kPerThread) {
+    return 10;
+  }
+  if (std::fmax(scraped_max, rest.max_ms) > 50.0) {
+    return 11;
+  }
+  return 0;
+}
@@ -0,0 +1,250 @@
+#include "OverlayCompositor.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+using snappin::BitmapView;
+using snappin::CpuBitmap;
+using snappin::OverlayCompositor;
+using snappin::OverlayScene;
+using snappin::RectPX;
+using snappin::SizePX;
+
+constexpr int32_t kW = 160;
+constexpr int32_t kH = 120;
+
+// Pixel (x, y) of a layer holds {x, y, tag, 255} so layers are distinguishable.
+BitmapView MakeLayer(uint8_t tag) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(kW) * kH * 4);
+  for (int32_t y = 0; y < kH; ++y) {
+    for (int32_t x = 0; x < kW; ++x) {
+      uint8_t* p = bytes->data() + (static_cast<size_t>(y) * kW + x) * 4;
+      p[0] = static_cast<uint8_t>(x);
+      p[1] = static_cast<uint8_t>(y);
+      p[2] = tag;
+      p[3] = 255;
+    }
+  }
+  return BitmapView::FromBuffer(bytes, {kW, kH}, kW * 4);
+}
+
+bool Inside(const RectPX& r, int32_t x, int32_t y) {
+  return r.w > 0 && r.h > 0 && x >= r.x && x < r.x + r.w && y >= r.y && y < r.y + r.h;
+}
+
+// Default style: 2 px border, one pixel either side of the selection edge.
+bool OnBorder(const RectPX& sel, int32_t x, int32_t y) {
+  if (sel.w <= 0 || sel.h <= 0) {
+    return false;
+  }
+  const RectPX outer{sel.x - 1, sel.y - 1, sel.w + 2, sel.h + 2};
+  const RectPX inner{sel.x + 1, sel.y + 1, sel.w - 2, sel.h - 2};
+  return Inside(outer, x, y) && !Inside(inner, x, y);
+}
+
+// Straightforward full-frame rendering of the scene.
+void Expected(const BitmapView* dimmed, const BitmapView* bright, const RectPX& sel,
+              int32_t x, int32_t y, uint8_t out[4]) {
+  if (OnBorder(sel, x, y)) {
+    const uint8_t white[4] = {255, 255, 255, 255};
+    std::memcpy(out, white, 4);
+  } else if (bright && Inside(sel, x, y)) {
+    std::memcpy(out, bright->row(y) + x * 4, 4);
+  } else if (dimmed) {
+    std::memcpy(out, dimmed->row(y) + x * 4, 4);
+  } else {
+    const uint8_t black[4] = {0, 0, 0, 255};
+    std::memcpy(out, black, 4);
+  }
+}
+
+bool MatchesReference(const OverlayCompositor& comp, const BitmapView* dimmed,
+                      const BitmapView* bright, const RectPX& sel) {
+  const CpuBitmap buf = comp.BackBuffer();
+  const uint8_t* base = static_cast<const uint8_t*>(buf.data.p);
+  for (int32_t y = 0; y < kH; ++y) {
+    for (int32_t x = 0; x < kW; ++x) {
+      uint8_t want[4];
+      Expected(dimmed, bright, sel, x, y, want);
+      if (std::memcmp(base + static_cast<size_t>(y) * buf.stride_bytes + x * 4, want, 4) != 0) {
+        std::fprintf(stderr, "mismatch at %d,%d\n", x, y);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Pixels whose layer can change between the two scenes.
+uint64_t ChangedPixels(const RectPX& before, const RectPX& after, bool highlight) {
+  uint64_t n = 0;
+  for (int32_t y = 0; y < kH; ++y) {
+    for (int32_t x = 0; x < kW; ++x) {
+      if (OnBorder(before, x, y) || OnBorder(after, x, y) ||
+          (highlight && Inside(before, x, y) != Inside(after, x, y))) {
+        ++n;
+      }
+    }
+  }
+  return n;
+}
+
+uint64_t Area(const std::vector<RectPX>& rects) {
+  uint64_t n = 0;
+  for (const RectPX& r : rects) {
+    n += static_cast<uint64_t>(r.w) * static_cast<uint64_t>(r.h);
+  }
+  return n;
+}
+
+int TestFirstFrameAndIdle() {
+  const BitmapView dimmed = MakeLayer(1);
+  const BitmapView bright = MakeLayer(2);
+  OverlayCompositor comp;
+  if (!comp.Reset({kW, kH}, dimmed, bright)) {
+    return 1;
+  }
+  const auto& first = comp.Compose(OverlayScene{});
+  if (Area(first) != static_cast<uint64_t>(kW) * kH) {
+    return 2;
+  }
+  if (!MatchesReference(comp, &dimmed, &bright, RectPX{})) {
+    return 3;
+  }
+  // Unchanged scene: no work at all.
+  for (int i = 0; i < 10; ++i) {
+    if (!comp.Compose(OverlayScene{}).empty()) {
+      return 4;
+    }
+  }
+  if (comp.Stats().skipped_frames != 10 || comp.Stats().composed_pixels !=
+                                                 static_cast<uint64_t>(kW) * kH) {
+    return 5;
+  }
+  return 0;
+}
+
+int TestDragRecomposesOnlyChanges() {
+  const BitmapView dimmed = MakeLayer(1);
+  const BitmapView bright = MakeLayer(2);
+  OverlayCompositor comp;
+  comp.Reset({kW, kH}, dimmed, bright);
+  comp.Compose(OverlayScene{});
+
+  // A drag growing the selection from a fixed corner, one pixel per frame.
+  RectPX prev{};
+  uint64_t total = 0;
+  for (int32_t i = 1; i <= 60; ++i) {
+    const RectPX sel{20, 15, i * 2, i};
+    const uint64_t expected = ChangedPixels(prev, sel, true);
+    const uint64_t got = Area(comp.Compose(OverlayScene{sel}));
+    if (got != expected || comp.Stats().last_composed_pixels != got) {
+      std::fprintf(stderr, "frame %d: %llu composed, %llu expected\n", i,
+                   static_cast<unsigned long long>(got),
+                   static_cast<unsigned long long>(expected));
+      return 10;
+    }
+    if (!MatchesReference(comp, &dimmed, &bright, sel)) {
+      return 11;
+    }
+    total += got;
+    prev = sel;
+  }
+  // Far below repainting the whole frame each time.
+  if (total * 10 > static_cast<uint64_t>(kW) * kH * 60) {
+    return 12;
+  }
+  return 0;
+}
+
+int TestRandomScenes() {
+  const BitmapView dimmed = MakeLayer(1);
+  const BitmapView bright = MakeLayer(2);
+  OverlayCompositor comp;
+  comp.Reset({kW, kH}, dimmed, bright);
+  comp.Compose(OverlayScene{});
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int32_t> coord(-20, 170);
+  std::uniform_int_distribution<int32_t> extent(0, 90);
+  RectPX prev{};
+  for (int i = 0; i < 300; ++i) {
+    RectPX sel{coord(rng), coord(rng), extent(rng), extent(rng)};
+    if (i % 7 == 0) {
+      sel = prev; // unchanged frame
+    }
+    if (sel.w <= 0 || sel.h <= 0) {
+      sel = RectPX{};
+    }
+    const bool same = sel.x == prev.x && sel.y == prev.y && sel.w == prev.w && sel.h == prev.h;
+    const uint64_t got = Area(comp.Compose(OverlayScene{sel}));
+    if (got != (same ? 0 : ChangedPixels(prev, sel, true))) {
+      return 20;
+    }
+    if (!MatchesReference(comp, &dimmed, &bright, sel)) {
+      return 21;
+    }
+    prev = sel;
+  }
+  return 0;
+}
+
+int TestWithoutFrozenFrame() {
+  // Live overlay: flat fill, only the border moves.
+  OverlayCompositor comp;
+  if (!comp.Reset({kW, kH}, BitmapView(), BitmapView())) {
+    return 30;
+  }
+  comp.Compose(OverlayScene{});
+  const RectPX a{10, 10, 30, 30};
+  const RectPX b{12, 10, 30, 30};
+  comp.Compose(OverlayScene{a});
+  const uint64_t got = Area(comp.Compose(OverlayScene{b}));
+  if (got != ChangedPixels(a, b, false) || !MatchesReference(comp, nullptr, nullptr, b)) {
+    return 31;
+  }
+  // A mismatched source is treated as missing rather than read out of bounds.
+  auto small = std::make_shared<std::vector<uint8_t>>(16 * 16 * 4, 9);
+  if (!comp.Reset({kW, kH}, BitmapView::FromBuffer(small, {16, 16}, 64), BitmapView())) {
+    return 32;
+  }
+  comp.Compose(OverlayScene{b});
+  if (!MatchesReference(comp, nullptr, nullptr, b)) {
+    return 33;
+  }
+  // Reset keeps the buffer for the same size and recomposes everything once.
+  const void* before = comp.BackBuffer().data.p;
+  comp.Reset({kW, kH}, BitmapView(), BitmapView());
+  if (comp.BackBuffer().data.p != before ||
+      Area(comp.Compose(OverlayScene{b})) != static_cast<uint64_t>(kW) * kH) {
+    return 34;
+  }
+  comp.InvalidateAll();
+  if (Area(comp.Compose(OverlayScene{b})) != static_cast<uint64_t>(kW) * kH) {
+    return 35;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestFirstFrameAndIdle()) {
+    return rc;
+  }
+  if (int rc = TestDragRecomposesOnlyChanges()) {
+    return rc;
+  }
+  if (int rc = TestRandomScenes()) {
+    return rc;
+  }
+  if (int rc = TestWithoutFrozenFrame()) {
+    return rc;
+  }
+  return 0;
+}
@@ -0,0 +1,284 @@
+#include "PinPixelStore.h"
+#include "PixelCodec.h"
+#include "ScaledImageCache.h"
+#include "test_pixels.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using snappin::BitmapView;
+using snappin::PinPixelStore;
+using snappin::PinPixelStoreStats;
+using snappin::PixelFormat;
+using snappin::ScaledImageCache;
+using snappin::SizePX;
+using snappin::testing::SameRows;
+
+// Flat panels with a few lines, so the codec has something to squeeze.
+BitmapView MakePin(int32_t w, int32_t h, uint8_t shade) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(w) * h * 4, shade);
+  for (int32_t y = 0; y < h; y += 7) {
+    std::memset(bytes->data() + static_cast<size_t>(y) * w * 4, 0x20, static_cast<size_t>(w));
+  }
+  return BitmapView::FromBuffer(bytes, SizePX{w, h}, w * 4, PixelFormat::BGRA8);
+}
+
+int TestIdleCompression() {
+  ScaledImageCache scaled;
+  PinPixelStore store(&scaled, 1000);
+  const BitmapView a = MakePin(300, 200, 0xF0);
+  const BitmapView b = MakePin(120, 80, 0x40);
+  int released = 0;
+  if (!store.Add(1, a, [&] { ++released; }) || !store.Add(2, b) ||
+      store.Add(3, BitmapView{})) {
+    return 1;
+  }
+  const uint64_t t0 = PinPixelStore::NowMs();
+  // Pin 1 is shown at half size (its zoomed copy sits in the scaled cache),
+  // pin 2 at full size.
+  const BitmapView painted = store.ForPaint(1, SizePX{150, 100}, t0);
+  if (painted.data() != a.data() || !scaled.Scaled(1, painted, SizePX{150, 100}).valid()) {
+    return 2;
+  }
+  store.ForPaint(2, SizePX{120, 80}, t0 + 500);
+  if (store.CompressIdle(t0 + 999) != 0) {
+    return 3;
+  }
+  if (store.CompressIdle(t0 + 1000) != 1 || released != 1 || store.CompressIdle(t0 + 1499) != 0) {
+    return 4;
+  }
+  PinPixelStoreStats stats = store.Stats();
+  if (stats.pins != 2 || stats.compressed_pins != 1 ||
+      stats.uncompressed_bytes != 120u * 80 * 4 || stats.display_bytes != 150u * 100 * 4 ||
+      stats.compressed_source_bytes != 300u * 200 * 4 || stats.compressed_bytes == 0 ||
+      stats.compressed_bytes * 10 > stats.compressed_source_bytes) {
+    return 5;
+  }
+  // The scaled cache entry moved into the store, releasing the full image.
+  if (scaled.Stats().entries != 0) {
+    return 6;
+  }
+
+  // Painting at the same size reuses the display copy.
+  const BitmapView display = store.ForPaint(1, SizePX{150, 100}, t0 + 2000);
+  if (display.size_px().w != 150 || store.Stats().compressed_pins != 1) {
+    return 7;
+  }
+  // Copy/save inflate to the exact pixels; the callback does not run again.
+  const BitmapView full = store.Full(1, t0 + 2000);
+  if (!SameRows(full, a) || full.data() == a.data() || store.Stats().decompressions != 1) {
+    return 8;
+  }
+  if (store.CompressIdle(t0 + 2999) != 1 || store.CompressIdle(t0 + 3000) != 1 ||
+      released != 1) {
+    return 9;
+  }
+  // Zooming to another size inflates.
+  const BitmapView zoomed = store.ForPaint(1, SizePX{200, 133}, t0 + 4000);
+  if (!SameRows(zoomed, a) || store.Stats().decompressions != 2) {
+    return 10;
+  }
+  return 0;
+}
+
+int TestFullSizePins() {
+  PinPixelStore store(nullptr, 100);
+  const BitmapView a = MakePin(64, 48, 0x80);
+  store.Add(7, a);
+  const uint64_t t0 = PinPixelStore::NowMs();
+  store.ForPaint(7, SizePX{64, 48}, t0);
+  if (store.CompressIdle(t0 + 100) != 1) {
+    return 20;
+  }
+  // Full-size pins keep no copy; the next paint makes them resident again
+  // and restarts their idle clock.
+  PinPixelStoreStats stats = store.Stats();
+  if (stats.display_bytes != 0 || stats.uncompressed_bytes != 0) {
+    return 21;
+  }
+  if (!SameRows(store.ForPaint(7, SizePX{64, 48}, t0 + 200), a) ||
+      store.Stats().decompressions != 1 || store.Stats().compressed_pins != 0 ||
+      store.CompressIdle(t0 + 299) != 0 || store.CompressIdle(t0 + 300) != 1) {
+    return 22;
+  }
+  // Pins shown larger than the image stay resident.
+  store.Full(7, t0 + 300);
+  store.ForPaint(7, SizePX{128, 96}, t0 + 300);
+  if (store.CompressIdle(t0 + 10000) != 0) {
+    return 23;
+  }
+  // 0 disables the policy.
+  store.ForPaint(7, SizePX{64, 48}, t0 + 300);
+  store.SetIdleMs(0);
+  if (store.CompressIdle(t0 + 10000) != 0) {
+    return 24;
+  }
+  store.Remove(7);
+  if (store.Contains(7) || store.ForPaint(7, SizePX{64, 48}).valid() ||
+      store.Full(7).valid() || store.Stats().pins != 0) {
+    return 25;
+  }
+  return 0;
+}
+
+// Decodes run with the store unlocked: while one is held open, other calls
+// on the store still return.
+int TestDecodeUnlocked() {
+  PinPixelStore store(nullptr, 1000);
+  const BitmapView a = MakePin(64, 48, 0x60);
+  std::vector<uint8_t> packed;
+  if (!snappin::CompressPixels(a, &packed) || !store.AddPacked(1, packed)) {
+    return 60;
+  }
+  std::promise<void> entered;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  store.SetDecodeHook([&](uint64_t) {
+    entered.set_value();
+    released.wait();
+  });
+  std::thread painter([&] { store.ForPaint(1, SizePX{64, 48}); });
+  entered.get_future().wait();
+  auto others = std::async(std::launch::async, [&] {
+    SizePX size;
+    return store.PixelSize(1, &size) && store.Contains(1) && size.w == 64;
+  });
+  const bool returned =
+      others.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+  release.set_value();
+  painter.join();
+  if (!returned || !others.get()) {
+    return 61;
+  }
+  if (store.Stats().decompressions != 1 || store.Stats().compressed_pins != 0) {
+    return 62;
+  }
+  return 0;
+}
+
+int TestAddPacked() {
+  PinPixelStore store(nullptr, 1000);
+  const BitmapView a = MakePin(50, 40, 0x33);
+  std::vector<uint8_t> packed;
+  if (!snappin::CompressPixels(a, &packed) || store.AddPacked(2, std::vector<uint8_t>(3, 0)) ||
+      !store.AddPacked(1, packed)) {
+    return 40;
+  }
+  SizePX size;
+  if (!store.PixelSize(1, &size) || size.w != 50 || size.h != 40 || store.PixelSize(2, &size)) {
+    return 41;
+  }
+  // Starts out compressed; a 100% paint inflates it.
+  const uint64_t t0 = PinPixelStore::NowMs();
+  if (store.Stats().compressed_pins != 1 ||
+      !SameRows(store.ForPaint(1, SizePX{50, 40}, t0), a) ||
+      store.Stats().compressed_pins != 0 || store.Stats().decompressions != 1) {
+    return 42;
+  }
+  if (!SameRows(store.Full(1, t0), a) || store.Stats().uncompressed_bytes != 50u * 40 * 4) {
+    return 43;
+  }
+  return 0;
+}
+
+int TestWorker() {
+  PinPixelStore store(nullptr, 1);
+  store.Add(1, MakePin(32, 32, 0x10));
+  store.Start();
+  for (int i = 0; i < 200 && store.Stats().compressed_pins == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  store.Stop();
+  if (store.Stats().compressed_pins != 1) {
+    return 30;
+  }
+  return 0;
+}
+
+// Restored pins: registered by size, pixels read once, later.
+int TestDeferred() {
+  PinPixelStore store(nullptr, 1000);
+  const BitmapView a = MakePin(40, 30, 0x55);
+  int loads = 0;
+  int loaded_ok = 0;
+  int loaded_failed = 0;
+  auto on_loaded = [&](bool ok) { ++(ok ? loaded_ok : loaded_failed); };
+  if (store.AddDeferred(9, SizePX{40, 30}, nullptr) ||
+      store.AddDeferred(9, SizePX{0, 30}, [&] { return a; }) ||
+      !store.AddDeferred(1, SizePX{40, 30}, [&] { ++loads; return a; }, on_loaded)) {
+    return 50;
+  }
+  SizePX size;
+  if (loads != 0 || !store.PixelSize(1, &size) || size.w != 40 ||
+      store.Stats().deferred_pins != 1) {
+    return 51;
+  }
+  // No worker running: the first paint loads, and the pixels stay resident.
+  const uint64_t t0 = PinPixelStore::NowMs();
+  const BitmapView first = store.ForPaint(1, SizePX{40, 30}, t0);
+  const BitmapView second = store.ForPaint(1, SizePX{40, 30}, t0);
+  if (!SameRows(first, a) || second.data() != first.data() || loads != 1 || loaded_ok != 1 ||
+      store.Stats().deferred_pins != 0 || store.Stats().deferred_loads != 1 ||
+      store.Stats().decompressions != 0) {
+    return 52;
+  }
+  // A load of the wrong size fails; the pin stays, without pixels.
+  store.AddDeferred(2, SizePX{41, 30}, [&] { return a; }, on_loaded);
+  if (store.Full(2, t0).valid() || loaded_failed != 1 || store.ForPaint(2, size, t0).valid() ||
+      store.Stats().deferred_failures != 1 || !store.Contains(2)) {
+    return 53;
+  }
+
+  // With the worker running, paints show nothing until it has loaded; Full
+  // waits for that load instead of starting another.
+  PinPixelStore worker_store(nullptr, 0);
+  worker_store.Start();
+  std::atomic<int> slow_loads{0};
+  worker_store.AddDeferred(3, SizePX{40, 30}, [&] {
+    slow_loads.fetch_add(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return a;
+  });
+  if (worker_store.ForPaint(3, SizePX{40, 30}).valid()) {
+    return 54;
+  }
+  const BitmapView full = worker_store.Full(3);
+  worker_store.Stop();
+  if (!SameRows(full, a) || slow_loads.load() != 1 ||
+      worker_store.ForPaint(3, SizePX{40, 30}).data() != full.data()) {
+    return 55;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestIdleCompression()) {
+    return rc;
+  }
+  if (int rc = TestFullSizePins()) {
+    return rc;
+  }
+  if (int rc = TestDecodeUnlocked()) {
+    return rc;
+  }
+  if (int rc = TestAddPacked()) {
+    return rc;
+  }
+  if (int rc = TestWorker()) {
+    return rc;
+  }
+  if (int rc = TestDeferred()) {
+    return rc;
+  }
+  return 0;
+}
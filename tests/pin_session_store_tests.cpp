@@ -0,0 +1,332 @@
+#include "PinSessionStore.h"
+#include "test_pixels.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using snappin::BitmapView;
+using snappin::PinSessionEncoding;
+using snappin::PinSessionMeta;
+using snappin::PinSessionStats;
+using snappin::PinSessionStore;
+using snappin::PixelFormat;
+using snappin::SizePX;
+using snappin::testing::NoiseImage;
+using snappin::testing::SameRows;
+
+bool SameMeta(const PinSessionMeta& a, const PinSessionMeta& b) {
+  return a.pos_px.x == b.pos_px.x && a.pos_px.y == b.pos_px.y && a.scale == b.scale &&
+         a.opacity == b.opacity && a.locked == b.locked &&
+         a.always_on_top == b.always_on_top && a.visible == b.visible;
+}
+
+PinSessionMeta MakeMeta(int32_t x, int32_t y, float scale) {
+  PinSessionMeta meta;
+  meta.pos_px = {x, y};
+  meta.scale = scale;
+  meta.opacity = 0.75f;
+  meta.locked = x % 2 == 0;
+  meta.always_on_top = y % 2 == 0;
+  meta.visible = x >= 0;
+  return meta;
+}
+
+std::vector<uint8_t> ReadBytes(const fs::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {});
+}
+
+void WriteBytes(const fs::path& path, const std::vector<uint8_t>& bytes, size_t len) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(len));
+}
+
+// What a reader should see: pin key -> meta (if any) and pixels (if any).
+struct Expected {
+  std::map<uint64_t, PinSessionMeta> metas;
+  std::map<uint64_t, BitmapView> pixels;
+  std::vector<uint64_t> order;
+};
+
+bool Matches(PinSessionStore* store, const Expected& expected) {
+  if (store->Keys() != expected.order) {
+    return false;
+  }
+  for (uint64_t key : expected.order) {
+    PinSessionMeta meta;
+    auto m = expected.metas.find(key);
+    if (store->Meta(key, &meta) != (m != expected.metas.end()) ||
+        (m != expected.metas.end() && !SameMeta(meta, m->second))) {
+      return false;
+    }
+    auto p = expected.pixels.find(key);
+    SizePX size;
+    if (store->PixelInfo(key, &size, nullptr) != (p != expected.pixels.end())) {
+      return false;
+    }
+    if (p != expected.pixels.end() &&
+        (size.w != p->second.size_px().w || !SameRows(store->Pixels(key), p->second))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int TestRoundTrip(const fs::path& dir) {
+  const fs::path path = dir / "round_trip.pins";
+  const BitmapView a = NoiseImage(120, 90, 1);
+  const BitmapView b = NoiseImage(33, 17, 2);
+  {
+    PinSessionStore store;
+    if (store.PutMeta(1, MakeMeta(1, 2, 1.0f)) || !store.Open(path)) {
+      return 1;
+    }
+    if (!store.PutPixels(7, a) || !store.PutMeta(7, MakeMeta(-40, 10, 0.5f)) ||
+        !store.PutPixels(3, b, PinSessionEncoding::Raw) ||
+        !store.PutMeta(3, MakeMeta(5, 6, 2.0f)) || store.PutPixels(9, BitmapView{}) ||
+        !store.Flush()) {
+      return 2;
+    }
+    // Readable before the store is reopened.
+    if (!SameRows(store.Pixels(7), a) || store.Stats().records_written != 4) {
+      return 3;
+    }
+  }
+  PinSessionStore store;
+  if (!store.Open(path)) {
+    return 4;
+  }
+  Expected expected;
+  expected.order = {7, 3};
+  expected.metas = {{7, MakeMeta(-40, 10, 0.5f)}, {3, MakeMeta(5, 6, 2.0f)}};
+  expected.pixels = {{7, a}, {3, b}};
+  if (!Matches(&store, expected)) {
+    return 5;
+  }
+  std::vector<uint8_t> packed;
+  if (!store.PackedPixels(7, &packed) || packed.empty() || store.PackedPixels(3, &packed)) {
+    return 6;
+  }
+  // Later records win; removed pins are gone.
+  store.PutMeta(3, MakeMeta(8, 8, 1.5f));
+  store.Remove(7);
+  store.Flush();
+  store.Close();
+  if (!store.Open(path)) {
+    return 7;
+  }
+  expected.order = {3};
+  expected.metas = {{3, MakeMeta(8, 8, 1.5f)}};
+  expected.pixels = {{3, b}};
+  if (!Matches(&store, expected) || store.Stats().torn_bytes != 0) {
+    return 8;
+  }
+  return 0;
+}
+
+int TestTornTail(const fs::path& dir) {
+  const fs::path path = dir / "torn.pins";
+  const fs::path cut = dir / "torn_cut.pins";
+  // State after each record, and where each record ends.
+  std::vector<Expected> states(1);
+  std::vector<size_t> ends;
+  {
+    PinSessionStore store;
+    if (!store.Open(path)) {
+      return 10;
+    }
+    ends.push_back(static_cast<size_t>(fs::file_size(path)));
+    auto step = [&](auto&& write, auto&& apply) {
+      write();
+      store.Flush();
+      Expected next = states.back();
+      apply(&next);
+      states.push_back(next);
+      ends.push_back(static_cast<size_t>(fs::file_size(path)));
+    };
+    const BitmapView p1 = NoiseImage(24, 10, 5);
+    const BitmapView p2 = NoiseImage(9, 31, 6);
+    step([&] { store.PutPixels(1, p1); },
+         [&](Expected* e) {
+           e->order.push_back(1);
+           e->pixels[1] = p1;
+         });
+    step([&] { store.PutMeta(1, MakeMeta(3, 4, 1.0f)); },
+         [&](Expected* e) { e->metas[1] = MakeMeta(3, 4, 1.0f); });
+    step([&] { store.PutPixels(2, p2, PinSessionEncoding::Raw); },
+         [&](Expected* e) {
+           e->order.push_back(2);
+           e->pixels[2] = p2;
+         });
+    step([&] { store.PutMeta(2, MakeMeta(-7, 2, 0.3f)); },
+         [&](Expected* e) { e->metas[2] = MakeMeta(-7, 2, 0.3f); });
+    step([&] { store.PutMeta(1, MakeMeta(11, 12, 3.0f)); },
+         [&](Expected* e) { e->metas[1] = MakeMeta(11, 12, 3.0f); });
+    step([&] { store.Remove(1); },
+         [&](Expected* e) {
+           e->order.erase(e->order.begin());
+           e->metas.erase(1);
+           e->pixels.erase(1);
+         });
+  }
+  const std::vector<uint8_t> full = ReadBytes(path);
+  if (full.size() != ends.back()) {
+    return 11;
+  }
+  // A crash can leave any prefix of the file; each one opens to the state
+  // after the last complete record, and the file accepts appends again.
+  for (size_t len = 0; len <= full.size(); ++len) {
+    WriteBytes(cut, full, len);
+    size_t k = 0;
+    while (k + 1 < ends.size() && ends[k + 1] <= len) {
+      ++k;
+    }
+    PinSessionStore store;
+    if (!store.Open(cut)) {
+      std::fprintf(stderr, "prefix of %zu bytes did not open\n", len);
+      return 12;
+    }
+    const Expected& expected = len < ends[0] ? states[0] : states[k];
+    const size_t kept = len < ends[0] ? 0 : ends[k];
+    if (!Matches(&store, expected) || store.Stats().torn_bytes != len - kept) {
+      std::fprintf(stderr, "prefix of %zu bytes restored the wrong state\n", len);
+      return 13;
+    }
+    if (len % 97 == 0 || len == full.size() - 1) {
+      store.PutMeta(99, MakeMeta(1, 1, 1.0f));
+      store.Flush();
+      store.Close();
+      if (!store.Open(cut) || !store.Meta(99, nullptr)) {
+        return 14;
+      }
+    }
+  }
+  return 0;
+}
+
+int TestCorruption(const fs::path& dir) {
+  const fs::path path = dir / "corrupt.pins";
+  const BitmapView a = NoiseImage(64, 64, 9);
+  const BitmapView b = NoiseImage(16, 16, 10);
+  size_t a_end = 0;
+  {
+    PinSessionStore store;
+    store.Open(path);
+    store.PutPixels(1, a, PinSessionEncoding::Raw);
+    store.Flush();
+    a_end = static_cast<size_t>(fs::file_size(path));
+    store.PutMeta(1, MakeMeta(2, 2, 1.0f));
+    store.PutPixels(2, b);
+    store.Flush();
+  }
+  std::vector<uint8_t> bytes = ReadBytes(path);
+  // A flipped pixel byte: the pin keeps its meta, its pixels read as missing.
+  bytes[a_end - 100] ^= 0x40;
+  WriteBytes(path, bytes, bytes.size());
+  {
+    PinSessionStore store;
+    if (!store.Open(path) || store.Keys().size() != 2 || !store.PixelInfo(1, nullptr, nullptr)) {
+      return 20;
+    }
+    if (store.Pixels(1).valid() || store.PixelInfo(1, nullptr, nullptr) ||
+        !store.Meta(1, nullptr) || store.Stats().corrupt_pixels != 1 ||
+        !SameRows(store.Pixels(2), b)) {
+      return 21;
+    }
+  }
+  // A damaged record header ends the file there.
+  bytes[a_end + 5] ^= 0x01;
+  WriteBytes(path, bytes, bytes.size());
+  {
+    PinSessionStore store;
+    if (!store.Open(path) || store.Keys().size() != 1 || store.Meta(1, nullptr) ||
+        store.Stats().torn_bytes != bytes.size() - a_end) {
+      return 22;
+    }
+  }
+  // Not a session file.
+  const fs::path other = dir / "other.bin";
+  WriteBytes(other, std::vector<uint8_t>(64, 0x11), 64);
+  PinSessionStore store;
+  if (store.Open(other) || store.is_open() || ReadBytes(other).size() != 64) {
+    return 23;
+  }
+  return 0;
+}
+
+int TestCompaction(const fs::path& dir) {
+  const fs::path path = dir / "compact.pins";
+  const BitmapView a = NoiseImage(200, 100, 11);
+  const BitmapView b = NoiseImage(50, 50, 12);
+  PinSessionStore store;
+  store.SetCompactMinDeadBytes(0);
+  store.Open(path);
+  store.PutPixels(1, a);
+  store.PutPixels(2, b);
+  store.Flush();
+  // Dragging pin 2 around: each update leaves one dead meta record behind.
+  for (int i = 0; i < 200; ++i) {
+    store.PutMeta(2, MakeMeta(i, i, 1.0f));
+    store.Flush();
+  }
+  store.Remove(1);
+  store.Flush();
+  PinSessionStats stats = store.Stats();
+  if (stats.compactions == 0 || stats.file_bytes > stats.live_bytes * 2 + 32) {
+    return 30;
+  }
+  Expected expected;
+  expected.order = {2};
+  expected.metas = {{2, MakeMeta(199, 199, 1.0f)}};
+  expected.pixels = {{2, b}};
+  if (!Matches(&store, expected)) {
+    return 31;
+  }
+  store.PutMeta(2, MakeMeta(500, 1, 1.0f));
+  store.Flush();
+  if (!store.Compact() || store.Stats().file_bytes != store.Stats().live_bytes + 32) {
+    return 32;
+  }
+  // A temporary left by a crash mid-compaction is ignored and removed.
+  store.Close();
+  fs::path tmp = path;
+  tmp += ".tmp";
+  WriteBytes(tmp, std::vector<uint8_t>(10, 0), 10);
+  if (!store.Open(path) || fs::exists(tmp)) {
+    return 33;
+  }
+  expected.metas[2] = MakeMeta(500, 1, 1.0f);
+  if (!Matches(&store, expected)) {
+    return 34;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  const fs::path dir = fs::temp_directory_path() / "snappin_pin_session_tests";
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+  fs::create_directories(dir);
+  int rc = TestRoundTrip(dir);
+  if (rc == 0) {
+    rc = TestTornTail(dir);
+  }
+  if (rc == 0) {
+    rc = TestCorruption(dir);
+  }
+  if (rc == 0) {
+    rc = TestCompaction(dir);
+  }
+  fs::remove_all(dir, ec);
+  return rc;
+}
@@ -0,0 +1,163 @@
+#include "PixelCodec.h"
+#include "test_pixels.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using snappin::BitmapView;
+using snappin::PixelFormat;
+using snappin::SizePX;
+using snappin::testing::NoiseImage;
+using snappin::testing::SameRows;
+
+BitmapView MakeView(int32_t w, int32_t h, int32_t pad, const std::vector<uint8_t>& rows,
+                    PixelFormat format = PixelFormat::BGRA8) {
+  const int32_t stride = w * 4 + pad;
+  auto bytes = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(stride) * h, 0xEE);
+  for (int32_t y = 0; y < h; ++y) {
+    std::memcpy(bytes->data() + static_cast<size_t>(y) * stride,
+                rows.data() + static_cast<size_t>(y) * w * 4, static_cast<size_t>(w) * 4);
+  }
+  return BitmapView::FromBuffer(bytes, SizePX{w, h}, stride, format);
+}
+
+// Window chrome: flat panels, a title bar, text-like speckles and a gradient.
+std::vector<uint8_t> Screenshot(int32_t w, int32_t h) {
+  std::vector<uint8_t> px(static_cast<size_t>(w) * h * 4);
+  uint32_t state = 9;
+  for (int32_t y = 0; y < h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      uint8_t* p = &px[(static_cast<size_t>(y) * w + x) * 4];
+      uint32_t c = y < 24 ? 0xFF2B579Au : 0xFFF3F3F3u;
+      if (x > w / 3 && x < w / 3 + 2) {
+        c = 0xFFC8C8C8u;
+      }
+      if (y > 40 && (y / 14) % 2 == 0 && x % 9 < 6) {
+        state = state * 1664525u + 1013904223u;
+        if ((state >> 28) < 5) {
+          c = 0xFF1E1E1Eu;
+        }
+      }
+      if (y > h * 3 / 4) {
+        c = 0xFF000000u | static_cast<uint32_t>(x * 255 / w) * 0x010101u;
+      }
+      std::memcpy(p, &c, 4);
+    }
+  }
+  return px;
+}
+
+int TestRoundTrip() {
+  struct Case {
+    int32_t w, h, pad;
+  };
+  const Case cases[] = {{1, 1, 0}, {2, 3, 4}, {3, 1, 0}, {17, 5, 8}, {64, 64, 0}, {333, 77, 12}};
+  for (const Case& c : cases) {
+    const BitmapView variants[] = {
+        NoiseImage(c.w, c.h, static_cast<uint32_t>(c.w * 31 + c.h), c.pad, PixelFormat::RGBA8),
+        MakeView(c.w, c.h, c.pad, Screenshot(c.w, c.h), PixelFormat::RGBA8),
+        MakeView(c.w, c.h, c.pad, std::vector<uint8_t>(static_cast<size_t>(c.w) * c.h * 4, 0x7F),
+                 PixelFormat::RGBA8)};
+    for (const BitmapView& src : variants) {
+      std::vector<uint8_t> packed;
+      if (!snappin::CompressPixels(src, &packed)) {
+        return 1;
+      }
+      SizePX size;
+      PixelFormat format = PixelFormat::BGRA8;
+      if (!snappin::PackedPixelsInfo(packed, &size, &format) || size.w != c.w ||
+          size.h != c.h || format != PixelFormat::RGBA8) {
+        return 2;
+      }
+      const BitmapView back = snappin::DecompressPixels(packed);
+      if (!back.valid() || back.stride_bytes() != c.w * 4 || !SameRows(src, back)) {
+        std::fprintf(stderr, "round trip mismatch %dx%d\n", c.w, c.h);
+        return 3;
+      }
+    }
+  }
+  // Long runs need extended lengths; offsets stay within 64 KiB.
+  const int32_t w = 5000;
+  const BitmapView wide = MakeView(w, 40, 0, Screenshot(w, 40));
+  std::vector<uint8_t> packed;
+  if (!snappin::CompressPixels(wide, &packed) ||
+      !SameRows(wide, snappin::DecompressPixels(packed))) {
+    return 4;
+  }
+  return 0;
+}
+
+int TestRatio() {
+  const BitmapView shot = MakeView(1280, 720, 0, Screenshot(1280, 720));
+  std::vector<uint8_t> packed;
+  if (!snappin::CompressPixels(shot, &packed)) {
+    return 10;
+  }
+  const size_t raw = size_t{1280} * 720 * 4;
+  std::printf("pixel codec: screenshot %zu -> %zu bytes (%.1fx)\n", raw, packed.size(),
+              static_cast<double>(raw) / packed.size());
+  if (packed.size() * 8 > raw) {
+    return 11;
+  }
+  // Noise does not compress but must not grow much either.
+  const BitmapView noise = NoiseImage(256, 256, 5);
+  if (!snappin::CompressPixels(noise, &packed) ||
+      packed.size() > size_t{256} * 256 * 4 * 101 / 100 + 64) {
+    return 12;
+  }
+  return 0;
+}
+
+int TestCorruptInput() {
+  const BitmapView src = MakeView(40, 30, 0, Screenshot(40, 30));
+  std::vector<uint8_t> packed;
+  if (!snappin::CompressPixels(src, &packed)) {
+    return 20;
+  }
+  if (snappin::CompressPixels(BitmapView{}, &packed) || snappin::CompressPixels(src, nullptr)) {
+    return 21;
+  }
+  // Every truncation is rejected, never over- or under-filled.
+  for (size_t len = 0; len < packed.size(); ++len) {
+    std::vector<uint8_t> cut(packed.begin(), packed.begin() + static_cast<ptrdiff_t>(len));
+    if (snappin::DecompressPixels(cut).valid()) {
+      std::fprintf(stderr, "truncated stream of %zu bytes accepted\n", len);
+      return 23;
+    }
+  }
+  std::vector<uint8_t> bad = packed;
+  bad[0] ^= 0xFF;
+  if (snappin::DecompressPixels(bad).valid()) {
+    return 24;
+  }
+  // Flipped bytes either fail or decode to some image of the right size.
+  for (size_t i = 16; i < packed.size(); i += 3) {
+    bad = packed;
+    bad[i] ^= 0x5A;
+    const BitmapView out = snappin::DecompressPixels(bad);
+    if (out.valid() && (out.size_px().w != 40 || out.size_px().h != 30)) {
+      return 25;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestRoundTrip()) {
+    return rc;
+  }
+  if (int rc = TestRatio()) {
+    return rc;
+  }
+  if (int rc = TestCorruptInput()) {
+    return rc;
+  }
+  return 0;
+}
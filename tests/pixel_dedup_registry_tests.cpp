@@ -0,0 +1,180 @@
+#include "ArtifactStore.h"
+#include "PixelDedupRegistry.h"
+#include "test_pixels.h"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using snappin::Artifact;
+using snappin::ArtifactStore;
+using snappin::BitmapView;
+using snappin::CpuBitmap;
+using snappin::Id64;
+using snappin::PixelDedupRegistry;
+using snappin::PixelDedupStats;
+using snappin::PixelFormat;
+using snappin::SizePX;
+using snappin::testing::NoiseImage;
+
+// Every image collides.
+uint64_t ConstantHash(const CpuBitmap&) { return 42; }
+
+int TestSharing() {
+  PixelDedupRegistry registry;
+  const BitmapView first = registry.Intern(NoiseImage(70, 30, 1));
+  // The same pixels at another stride come back as the first buffer.
+  const BitmapView copy = NoiseImage(70, 30, 1, 8);
+  const BitmapView shared = registry.Intern(copy);
+  if (!shared.SharesBufferWith(first) || shared.data() != first.data() ||
+      shared.stride_bytes() != 70 * 4) {
+    return 1;
+  }
+  // Other pixels, sizes or formats are kept.
+  const BitmapView other = NoiseImage(70, 30, 2);
+  const BitmapView rgba = NoiseImage(70, 30, 1, 0, PixelFormat::RGBA8);
+  if (!registry.Intern(other).SharesBufferWith(other) ||
+      !registry.Intern(rgba).SharesBufferWith(rgba) ||
+      registry.Intern(BitmapView{}).valid()) {
+    return 2;
+  }
+  PixelDedupStats stats = registry.Stats();
+  if (stats.entries != 3 || stats.hits != 1 || stats.shared_bytes != 70u * 30 * 4 ||
+      stats.collisions != 0 || stats.hashed_bytes != 4u * 70 * 30 * 4) {
+    return 3;
+  }
+  // Registered buffers, through any view of them, are not hashed again.
+  if (registry.Intern(first).data() != first.data() ||
+      registry.Intern(other).data() != other.data() ||
+      registry.Stats().hashed_bytes != stats.hashed_bytes) {
+    return 4;
+  }
+  return 0;
+}
+
+int TestCollisions() {
+  PixelDedupRegistry registry(&ConstantHash);
+  const BitmapView a = registry.Intern(NoiseImage(16, 16, 10));
+  const BitmapView b = registry.Intern(NoiseImage(16, 16, 11));
+  if (b.SharesBufferWith(a) || registry.Stats().collisions != 1) {
+    return 10;
+  }
+  // Found among the colliding entries.
+  const BitmapView b_again = registry.Intern(NoiseImage(16, 16, 11, 4));
+  const uint64_t collisions = registry.Stats().collisions;
+  if (!b_again.SharesBufferWith(b) || registry.Stats().hits != 1 || collisions > 2) {
+    return 11;
+  }
+  // A size mismatch is not even compared.
+  registry.Intern(NoiseImage(8, 32, 10));
+  if (registry.Stats().collisions != collisions || registry.Stats().entries != 3) {
+    return 12;
+  }
+  return 0;
+}
+
+int TestWeakReferences() {
+  PixelDedupRegistry registry;
+  std::weak_ptr<const uint8_t> gone;
+  {
+    const BitmapView first = registry.Intern(NoiseImage(40, 40, 20));
+    gone = first.weak_origin();
+  }
+  // The registry did not keep the buffer alive, and a new copy replaces it.
+  if (!gone.expired()) {
+    return 20;
+  }
+  const BitmapView second = NoiseImage(40, 40, 20);
+  if (!registry.Intern(second).SharesBufferWith(second) || registry.Stats().hits != 0 ||
+      registry.Stats().entries != 1) {
+    return 21;
+  }
+  for (uint32_t i = 0; i < 200; ++i) {
+    registry.Intern(NoiseImage(4, 4, 100 + i));
+  }
+  // Growth sweeps as it goes; an explicit sweep leaves the live entry.
+  if (registry.Stats().entries > 64) {
+    return 22;
+  }
+  registry.Sweep();
+  if (registry.Stats().entries != 1) {
+    return 23;
+  }
+  return 0;
+}
+
+int TestArtifactStore() {
+  PixelDedupRegistry registry;
+  ArtifactStore store;
+  store.SetPixelInterner(&registry);
+  // A pin read back from the clipboard right after a capture.
+  const BitmapView pin = registry.Intern(NoiseImage(64, 48, 30));
+  Artifact a;
+  a.artifact_id = store.NextId();
+  a.base_cpu = NoiseImage(64, 48, 30, 16);
+  const Id64 a_id = a.artifact_id;
+  store.Put(std::move(a));
+  Artifact b;
+  b.artifact_id = store.NextId();
+  b.base_cpu = NoiseImage(64, 48, 30);
+  const Id64 b_id = b.artifact_id;
+  store.Put(std::move(b));
+  const auto stored_a = store.Get(a_id);
+  const auto stored_b = store.Get(b_id);
+  if (!stored_a || !stored_b || !stored_a->base_cpu.SharesBufferWith(pin) ||
+      !stored_b->base_cpu.SharesBufferWith(pin) || registry.Stats().hits != 2) {
+    return 30;
+  }
+  return 0;
+}
+
+int TestConcurrentInterning() {
+  PixelDedupRegistry registry;
+  const BitmapView reference = registry.Intern(NoiseImage(128, 64, 40));
+  std::vector<std::thread> threads;
+  std::vector<int> shared(4, 0);
+  for (size_t t = 0; t < shared.size(); ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 50; ++i) {
+        const BitmapView mine = NoiseImage(128, 64, 40, static_cast<int32_t>(t) * 4);
+        shared[t] += registry.Intern(mine).SharesBufferWith(reference) ? 1 : 0;
+        registry.Intern(NoiseImage(32, 8, static_cast<uint32_t>(t * 1000 + i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int count : shared) {
+    if (count != 50) {
+      return 40;
+    }
+  }
+  if (registry.Stats().hits != 200 || registry.Stats().lookups != 401) {
+    return 41;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestSharing()) {
+    return rc;
+  }
+  if (int rc = TestCollisions()) {
+    return rc;
+  }
+  if (int rc = TestWeakReferences()) {
+    return rc;
+  }
+  if (int rc = TestArtifactStore()) {
+    return rc;
+  }
+  if (int rc = TestConcurrentInterning()) {
+    return rc;
+  }
+  return 0;
+}
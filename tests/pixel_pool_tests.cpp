@@ -0,0 +1,147 @@
+#include "PixelBufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using snappin::PixelBufferPool;
+
+bool Aligned(const void* p) {
+  return reinterpret_cast<uintptr_t>(p) % PixelBufferPool::kAlignment == 0;
+}
+
+} // namespace
+
+int main() {
+  // Size classes never shrink a request and waste at most 1/8.
+  for (size_t bytes : {size_t{1}, size_t{4096}, size_t{4097}, size_t{100000},
+                       size_t{3840} * 2160 * 4, size_t{5120} * 2880 * 4}) {
+    const size_t cls = PixelBufferPool::SizeClassFor(bytes);
+    if (cls < bytes || cls - bytes > std::max<size_t>(bytes / 8, 4096)) {
+      return 1;
+    }
+  }
+  if (PixelBufferPool::SizeClassFor(3840 * 2160 * 4) !=
+      PixelBufferPool::SizeClassFor(3840 * 2160 * 4 - 100)) {
+    return 2;
+  }
+
+  PixelBufferPool pool(64u << 20);
+  const size_t frame = size_t{1920} * 1080 * 4;
+  uint8_t* first_ptr = nullptr;
+  {
+    std::shared_ptr<uint8_t> a = pool.Acquire(frame);
+    if (!a || !Aligned(a.get())) {
+      return 3;
+    }
+    std::memset(a.get(), 0xAB, frame);
+    first_ptr = a.get();
+    const snappin::PixelBufferPoolStats s = pool.Stats();
+    if (s.misses != 1 || s.hits != 0 ||
+        s.outstanding_bytes != PixelBufferPool::SizeClassFor(frame)) {
+      return 4;
+    }
+  }
+  // Released block is recycled for the next same-class request.
+  {
+    std::shared_ptr<uint8_t> b = pool.Acquire(frame - 16);
+    const snappin::PixelBufferPoolStats s = pool.Stats();
+    if (b.get() != first_ptr || s.hits != 1 || s.recycled != 1 || s.pooled_bytes != 0) {
+      return 5;
+    }
+    // A different class misses.
+    std::shared_ptr<uint8_t> c = pool.Acquire(frame * 2);
+    if (!c || c.get() == first_ptr || pool.Stats().misses != 2) {
+      return 6;
+    }
+  }
+  if (pool.Stats().outstanding_bytes != 0 || pool.Stats().pooled_bytes == 0) {
+    return 7;
+  }
+
+  // High-water mark: lowering it frees idle blocks, least recent first.
+  pool.SetHighWaterBytes(PixelBufferPool::SizeClassFor(frame * 2));
+  {
+    const snappin::PixelBufferPoolStats s = pool.Stats();
+    if (s.pooled_bytes > s.high_water_bytes) {
+      return 8;
+    }
+  }
+  // Blocks larger than the budget are dropped on release.
+  pool.SetHighWaterBytes(1u << 20);
+  {
+    std::shared_ptr<uint8_t> big = pool.Acquire(frame);
+  }
+  if (pool.Stats().dropped == 0 || pool.Stats().pooled_bytes != 0) {
+    return 9;
+  }
+  pool.SetHighWaterBytes(64u << 20);
+  { std::shared_ptr<uint8_t> x = pool.Acquire(8192); }
+  pool.Trim();
+  if (pool.Stats().pooled_bytes != 0) {
+    return 10;
+  }
+
+  // BitmapView integration.
+  {
+    std::shared_ptr<uint8_t> pixels;
+    int32_t stride = 0;
+    if (!snappin::AcquirePixelBuffer(pool, snappin::SizePX{10, 3}, &pixels, &stride) ||
+        stride != 40) {
+      return 11;
+    }
+    for (int i = 0; i < 120; ++i) {
+      pixels.get()[i] = static_cast<uint8_t>(i);
+    }
+    const snappin::BitmapView view(pixels, snappin::SizePX{10, 3}, stride);
+    const snappin::BitmapView crop = view.Crop(snappin::RectPX{2, 1, 4, 2});
+    const snappin::BitmapView packed = snappin::ClonePooled(pool, crop);
+    if (!packed.valid() || packed.stride_bytes() != 16 || packed.row(1)[0] != 88 ||
+        !Aligned(packed.data())) {
+      return 12;
+    }
+  }
+
+  // Blocks may outlive the pool.
+  std::shared_ptr<uint8_t> orphan;
+  {
+    PixelBufferPool scoped;
+    orphan = scoped.Acquire(1 << 16);
+  }
+  orphan.reset();
+
+  // Concurrent acquire/release keeps the books balanced.
+  {
+    PixelBufferPool shared_pool(8u << 20);
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&shared_pool, &failed, t] {
+        for (int i = 0; i < 500; ++i) {
+          const size_t bytes = size_t{4096} * static_cast<size_t>(1 + (i + t) % 7);
+          std::shared_ptr<uint8_t> p = shared_pool.Acquire(bytes);
+          if (!p || !Aligned(p.get())) {
+            failed = true;
+            return;
+          }
+          p.get()[bytes - 1] = 1;
+        }
+      });
+    }
+    for (std::thread& th : threads) {
+      th.join();
+    }
+    const snappin::PixelBufferPoolStats s = shared_pool.Stats();
+    if (failed || s.outstanding_bytes != 0 || s.hits + s.misses != 2000 ||
+        s.pooled_bytes > s.high_water_bytes) {
+      return 13;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include "PngEncoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Throughput and ratio of the built-in PNG encoder on synthetic screenshot
+// content, per preset and thread count. Not registered with ctest.
+
+namespace {
+
+using snappin::CpuBitmap;
+using snappin::PngPreset;
+
+struct Frame {
+  std::vector<uint8_t> bytes;
+  CpuBitmap bmp;
+};
+
+// Desktop-like BGRA frame: title bar, flat panels with grid lines, rows of
+// repeated glyph-like marks and a noisy gradient standing in for a photo.
+Frame MakeScreenshot(int32_t w, int32_t h) {
+  Frame f;
+  f.bmp.format = snappin::PixelFormat::BGRA8;
+  f.bmp.size_px = {w, h};
+  f.bmp.stride_bytes = w * 4;
+  f.bytes.resize(static_cast<size_t>(w) * static_cast<size_t>(h) * 4);
+  uint32_t state = 1;
+  for (int32_t y = 0; y < h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      uint8_t r = 243;
+      uint8_t g = 243;
+      uint8_t b = 243;
+      if (y < 40) {
+        r = 32;
+        g = 96;
+        b = 160;
+      } else if (x > w * 2 / 3 && y > h / 3) {
+        state = state * 1664525u + 1013904223u;
+        const uint8_t n = static_cast<uint8_t>((state >> 24) & 15);
+        r = static_cast<uint8_t>(x * 255 / w + n);
+        g = static_cast<uint8_t>(y * 255 / h + n);
+        b = static_cast<uint8_t>(96 + n);
+      } else if (x % 241 == 0 || y % 173 == 0) {
+        r = g = b = 200;
+      } else if ((y / 11) % 2 == 1 && (x % 8) < 6) {
+        const uint32_t glyph = static_cast<uint32_t>((x / 8) * 31 + (y / 22) * 17) % 37;
+        if (((glyph >> (x % 6)) ^ (y % 11)) & 1) {
+          r = g = b = 24;
+        }
+      }
+      uint8_t* p = f.bytes.data() + (static_cast<size_t>(y) * w + x) * 4;
+      p[0] = b;
+      p[1] = g;
+      p[2] = r;
+      p[3] = 0xFF;
+    }
+  }
+  f.bmp.data.p = f.bytes.data();
+  return f;
+}
+
+template <typename Fn>
+double BestMs(int iterations, Fn&& fn) {
+  double best = 1e30;
+  for (int i = 0; i < iterations; ++i) {
+    const auto t0 = std::chrono::steady_clock::now();
+    fn();
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    if (ms < best) {
+      best = ms;
+    }
+  }
+  return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 3;
+  const int32_t max_threads =
+      static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+  const snappin::SizePX sizes[] = {{1920, 1080}, {3840, 2160}};
+  const PngPreset presets[] = {PngPreset::Fast, PngPreset::Balanced, PngPreset::Small};
+  std::vector<int32_t> thread_counts;
+  for (int32_t t = 1; t < max_threads; t *= 2) {
+    thread_counts.push_back(t);
+  }
+  thread_counts.push_back(max_threads);
+  for (const auto& size : sizes) {
+    const Frame frame = MakeScreenshot(size.w, size.h);
+    const double mpix = static_cast<double>(size.w) * size.h / 1e6;
+    const double raw_mb = mpix * 4.0;
+    for (PngPreset preset : presets) {
+      for (int32_t threads : thread_counts) {
+        snappin::PngEncodeOptions options;
+        options.preset = preset;
+        options.threads = threads;
+        std::vector<uint8_t> png;
+        const double ms =
+            BestMs(iterations, [&] { snappin::EncodePng(frame.bmp, options, &png); });
+        std::printf("%-8s t=%-2d %5dx%-5d %9.1f ms %8.1f MB/s %9zu bytes %5.2f%%\n",
+                    snappin::PngPresetName(preset), threads, size.w, size.h, ms,
+                    raw_mb / (ms / 1000.0), png.size(),
+                    100.0 * static_cast<double>(png.size()) / (raw_mb * 1e6));
+      }
+    }
+  }
+  return 0;
+}
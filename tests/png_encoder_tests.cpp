@@ -0,0 +1,673 @@
+#include "PngEncoder.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using snappin::CpuBitmap;
+using snappin::PixelFormat;
+using snappin::PngEncodeOptions;
+using snappin::PngPreset;
+
+// ---- Reference decoder: independent CRC/Adler, inflate and unfilter. ----
+
+uint32_t RefCrc(const uint8_t* p, size_t n) {
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < n; ++i) {
+    crc ^= p[i];
+    for (int k = 0; k < 8; ++k) {
+      crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+uint32_t RefAdler(const std::vector<uint8_t>& data) {
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (uint8_t v : data) {
+    a = (a + v) % 65521;
+    b = (b + a) % 65521;
+  }
+  return a | (b << 16);
+}
+
+uint32_t Be32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+struct BitReader {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  size_t pos = 0;
+  uint32_t bitbuf = 0;
+  int bitcnt = 0;
+  bool overrun = false;
+
+  uint32_t Bits(int need) {
+    uint32_t val = bitbuf;
+    while (bitcnt < need) {
+      if (pos >= size) {
+        overrun = true;
+        return 0;
+      }
+      val |= static_cast<uint32_t>(data[pos++]) << bitcnt;
+      bitcnt += 8;
+    }
+    bitbuf = need < 32 ? val >> need : 0;
+    bitcnt -= need;
+    return need < 32 ? val & ((1u << need) - 1) : val;
+  }
+};
+
+struct Huffman {
+  int16_t count[16] = {};
+  int16_t symbol[288] = {};
+};
+
+// Returns false unless the lengths describe a complete prefix code.
+bool Construct(Huffman* h, const uint8_t* lengths, int n) {
+  *h = Huffman{};
+  for (int s = 0; s < n; ++s) {
+    ++h->count[lengths[s]];
+  }
+  if (h->count[0] == n) {
+    return false;
+  }
+  int left = 1;
+  for (int len = 1; len < 16; ++len) {
+    left <<= 1;
+    left -= h->count[len];
+    if (left < 0) {
+      return false;
+    }
+  }
+  int16_t offs[16] = {};
+  for (int len = 1; len < 15; ++len) {
+    offs[len + 1] = static_cast<int16_t>(offs[len] + h->count[len]);
+  }
+  for (int s = 0; s < n; ++s) {
+    if (lengths[s] != 0) {
+      h->symbol[offs[lengths[s]]++] = static_cast<int16_t>(s);
+    }
+  }
+  return left == 0;
+}
+
+int Decode(BitReader* br, const Huffman& h) {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (int len = 1; len < 16; ++len) {
+    code |= static_cast<int>(br->Bits(1));
+    const int count = h.count[len];
+    if (code - count < first) {
+      return h.symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+const uint16_t kLenBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                               31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                               2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t kDistBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385,
+                                24577};
+const uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+struct InflateCounters {
+  int stored = 0;
+  int fixed = 0;
+  int dynamic = 0;
+};
+
+bool InflateCodes(BitReader* br, const Huffman& lit, const Huffman& dist,
+                  std::vector<uint8_t>* out) {
+  for (;;) {
+    const int sym = Decode(br, lit);
+    if (sym < 0 || br->overrun) {
+      return false;
+    }
+    if (sym < 256) {
+      out->push_back(static_cast<uint8_t>(sym));
+      continue;
+    }
+    if (sym == 256) {
+      return true;
+    }
+    const int li = sym - 257;
+    if (li >= 29) {
+      return false;
+    }
+    const size_t len = kLenBase[li] + br->Bits(kLenExtra[li]);
+    const int ds = Decode(br, dist);
+    if (ds < 0 || ds >= 30) {
+      return false;
+    }
+    const size_t d = kDistBase[ds] + br->Bits(kDistExtra[ds]);
+    if (d > out->size() || d > 32768) {
+      return false;
+    }
+    for (size_t i = 0; i < len; ++i) {
+      out->push_back((*out)[out->size() - d]);
+    }
+  }
+}
+
+bool Inflate(const std::vector<uint8_t>& z, std::vector<uint8_t>* out,
+             InflateCounters* counters) {
+  if (z.size() < 6 || (z[0] & 0x0F) != 8 || ((z[0] << 8) | z[1]) % 31 != 0 ||
+      (z[1] & 0x20) != 0) {
+    return false;
+  }
+  BitReader br;
+  br.data = z.data() + 2;
+  br.size = z.size() - 6;
+  int last = 0;
+  do {
+    last = static_cast<int>(br.Bits(1));
+    const uint32_t type = br.Bits(2);
+    if (type == 0) {
+      br.bitbuf = 0;
+      br.bitcnt = 0;
+      if (br.pos + 4 > br.size) {
+        return false;
+      }
+      const uint32_t len = br.data[br.pos] | (br.data[br.pos + 1] << 8);
+      const uint32_t nlen = br.data[br.pos + 2] | (br.data[br.pos + 3] << 8);
+      br.pos += 4;
+      if ((len ^ 0xFFFFu) != nlen || br.pos + len > br.size) {
+        return false;
+      }
+      out->insert(out->end(), br.data + br.pos, br.data + br.pos + len);
+      br.pos += len;
+      ++counters->stored;
+    } else if (type == 1) {
+      uint8_t lengths[320];
+      for (int i = 0; i < 288; ++i) {
+        lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+      }
+      for (int i = 0; i < 30; ++i) {
+        lengths[288 + i] = 5;
+      }
+      Huffman lit;
+      Huffman dist;
+      Construct(&lit, lengths, 288);
+      Construct(&dist, lengths + 288, 30);
+      if (!InflateCodes(&br, lit, dist, out)) {
+        return false;
+      }
+      ++counters->fixed;
+    } else if (type == 2) {
+      const int nlen = static_cast<int>(br.Bits(5)) + 257;
+      const int ndist = static_cast<int>(br.Bits(5)) + 1;
+      const int ncode = static_cast<int>(br.Bits(4)) + 4;
+      static const uint8_t kOrder[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                         11, 4,  12, 3, 13, 2, 14, 1, 15};
+      if (nlen > 286 || ndist > 30) {
+        return false;
+      }
+      uint8_t lengths[320] = {};
+      for (int i = 0; i < ncode; ++i) {
+        lengths[kOrder[i]] = static_cast<uint8_t>(br.Bits(3));
+      }
+      Huffman lencode;
+      if (!Construct(&lencode, lengths, 19)) {
+        return false;
+      }
+      int index = 0;
+      while (index < nlen + ndist) {
+        int sym = Decode(&br, lencode);
+        if (sym < 0) {
+          return false;
+        }
+        if (sym < 16) {
+          lengths[index++] = static_cast<uint8_t>(sym);
+          continue;
+        }
+        uint8_t len = 0;
+        int repeat = 0;
+        if (sym == 16) {
+          if (index == 0) {
+            return false;
+          }
+          len = lengths[index - 1];
+          repeat = 3 + static_cast<int>(br.Bits(2));
+        } else if (sym == 17) {
+          repeat = 3 + static_cast<int>(br.Bits(3));
+        } else {
+          repeat = 11 + static_cast<int>(br.Bits(7));
+        }
+        if (index + repeat > nlen + ndist) {
+          return false;
+        }
+        while (repeat-- > 0) {
+          lengths[index++] = len;
+        }
+      }
+      if (lengths[256] == 0) {
+        return false;
+      }
+      Huffman lit;
+      Huffman dist;
+      if (!Construct(&lit, lengths, nlen) || !Construct(&dist, lengths + nlen, ndist)) {
+        return false;
+      }
+      if (!InflateCodes(&br, lit, dist, out)) {
+        return false;
+      }
+      ++counters->dynamic;
+    } else {
+      return false;
+    }
+    if (br.overrun) {
+      return false;
+    }
+  } while (!last);
+  // Only the Adler-32 may follow the final block.
+  if (br.pos != br.size) {
+    return false;
+  }
+  return Be32(z.data() + z.size() - 4) == RefAdler(*out);
+}
+
+int RefPaeth(int a, int b, int c) {
+  const int p = a + b - c;
+  const int pa = p > a ? p - a : a - p;
+  const int pb = p > b ? p - b : b - p;
+  const int pc = p > c ? p - c : c - p;
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+struct DecodedPng {
+  int32_t width = 0;
+  int32_t height = 0;
+  int color_type = 0;
+  int idat_chunks = 0;
+  InflateCounters blocks;
+  std::vector<uint8_t> rgba; // always RGBA, alpha 255 for RGB images
+};
+
+bool DecodePng(const std::vector<uint8_t>& png, DecodedPng* out) {
+  static const uint8_t kSig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  if (png.size() < 8 || std::memcmp(png.data(), kSig, 8) != 0) {
+    return false;
+  }
+  std::vector<uint8_t> z;
+  bool seen_end = false;
+  size_t pos = 8;
+  while (pos + 12 <= png.size()) {
+    const uint32_t len = Be32(png.data() + pos);
+    if (pos + 12 + len > png.size()) {
+      return false;
+    }
+    const std::string type(reinterpret_cast<const char*>(png.data() + pos + 4), 4);
+    const uint8_t* body = png.data() + pos + 8;
+    if (Be32(body + len) != RefCrc(png.data() + pos + 4, len + 4)) {
+      return false;
+    }
+    if (type == "IHDR") {
+      if (len != 13 || body[8] != 8 || body[10] != 0 || body[11] != 0 || body[12] != 0) {
+        return false;
+      }
+      out->width = static_cast<int32_t>(Be32(body));
+      out->height = static_cast<int32_t>(Be32(body + 4));
+      out->color_type = body[9];
+    } else if (type == "IDAT") {
+      z.insert(z.end(), body, body + len);
+      ++out->idat_chunks;
+    } else if (type == "IEND") {
+      seen_end = true;
+      pos += 12 + len;
+      break;
+    }
+    pos += 12 + len;
+  }
+  if (!seen_end || pos != png.size() || out->width <= 0 || out->height <= 0 ||
+      (out->color_type != 2 && out->color_type != 6)) {
+    return false;
+  }
+  std::vector<uint8_t> raw;
+  if (!Inflate(z, &raw, &out->blocks)) {
+    return false;
+  }
+  const size_t bpp = out->color_type == 6 ? 4 : 3;
+  const size_t row_bytes = static_cast<size_t>(out->width) * bpp;
+  if (raw.size() != (row_bytes + 1) * static_cast<size_t>(out->height)) {
+    return false;
+  }
+  std::vector<uint8_t> prior(row_bytes, 0);
+  std::vector<uint8_t> cur(row_bytes);
+  out->rgba.clear();
+  for (int32_t y = 0; y < out->height; ++y) {
+    const uint8_t* f = raw.data() + static_cast<size_t>(y) * (row_bytes + 1);
+    const uint8_t type = f[0];
+    for (size_t i = 0; i < row_bytes; ++i) {
+      const int a = i >= bpp ? cur[i - bpp] : 0;
+      const int b = prior[i];
+      const int c = i >= bpp ? prior[i - bpp] : 0;
+      int pred = 0;
+      switch (type) {
+        case 0: pred = 0; break;
+        case 1: pred = a; break;
+        case 2: pred = b; break;
+        case 3: pred = (a + b) / 2; break;
+        case 4: pred = RefPaeth(a, b, c); break;
+        default: return false;
+      }
+      cur[i] = static_cast<uint8_t>(f[1 + i] + pred);
+    }
+    for (int32_t x = 0; x < out->width; ++x) {
+      const uint8_t* p = cur.data() + static_cast<size_t>(x) * bpp;
+      out->rgba.insert(out->rgba.end(), {p[0], p[1], p[2], bpp == 4 ? p[3] : uint8_t{0xFF}});
+    }
+    prior.swap(cur);
+  }
+  return true;
+}
+
+// ---- Test images ----
+
+struct TestImage {
+  std::vector<uint8_t> bytes;
+  CpuBitmap bmp;
+};
+
+TestImage MakeBlank(int32_t w, int32_t h, int32_t pad, PixelFormat format) {
+  TestImage img;
+  img.bmp.format = format;
+  img.bmp.size_px = {w, h};
+  img.bmp.stride_bytes = w * 4 + pad;
+  img.bytes.assign(static_cast<size_t>(img.bmp.stride_bytes) * static_cast<size_t>(h), 0xCD);
+  img.bmp.data.p = img.bytes.data();
+  return img;
+}
+
+void SetPx(TestImage* img, int32_t x, int32_t y, uint8_t r, uint8_t g, uint8_t b,
+           uint8_t a) {
+  uint8_t* p = img->bytes.data() + static_cast<size_t>(y) * img->bmp.stride_bytes +
+               static_cast<size_t>(x) * 4;
+  const bool bgra = img->bmp.format == PixelFormat::BGRA8;
+  p[0] = bgra ? b : r;
+  p[1] = g;
+  p[2] = bgra ? r : b;
+  p[3] = a;
+}
+
+TestImage MakeNoise(int32_t w, int32_t h, int32_t pad, PixelFormat format, uint32_t seed,
+                    bool opaque) {
+  TestImage img = MakeBlank(w, h, pad, format);
+  uint32_t state = seed;
+  for (int32_t y = 0; y < h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      state = state * 1664525u + 1013904223u;
+      SetPx(&img, x, y, static_cast<uint8_t>(state >> 24), static_cast<uint8_t>(state >> 16),
+            static_cast<uint8_t>(state >> 8), opaque ? 0xFF : static_cast<uint8_t>(state));
+    }
+  }
+  return img;
+}
+
+// Flat panels, borders, repeated glyph-like marks and a soft gradient.
+TestImage MakeScreenshot(int32_t w, int32_t h, int32_t pad, PixelFormat format) {
+  TestImage img = MakeBlank(w, h, pad, format);
+  uint32_t state = 7;
+  for (int32_t y = 0; y < h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      uint8_t r = 243;
+      uint8_t g = 243;
+      uint8_t b = 243;
+      if (y < 32) {
+        r = 32;
+        g = 96;
+        b = 160;
+      } else if (x > w / 2 && y > h / 2) {
+        state = state * 1664525u + 1013904223u;
+        const uint8_t n = static_cast<uint8_t>((state >> 24) & 7);
+        r = static_cast<uint8_t>(x * 255 / w + n);
+        g = static_cast<uint8_t>(y * 255 / h + n);
+        b = static_cast<uint8_t>(128 + n);
+      } else if (x % 97 == 0 || y % 61 == 0) {
+        r = g = b = 200;
+      } else if ((y / 9) % 2 == 1 && (x % 7) < 5) {
+        const uint32_t glyph = static_cast<uint32_t>((x / 7) * 31 + (y / 18) * 17) % 23;
+        if (((glyph >> (x % 5)) ^ (y % 9)) & 1) {
+          r = g = b = 20;
+        }
+      }
+      SetPx(&img, x, y, r, g, b, 0xFF);
+    }
+  }
+  return img;
+}
+
+bool MatchesSource(const TestImage& img, const DecodedPng& png) {
+  if (png.width != img.bmp.size_px.w || png.height != img.bmp.size_px.h) {
+    return false;
+  }
+  const bool bgra = img.bmp.format == PixelFormat::BGRA8;
+  for (int32_t y = 0; y < png.height; ++y) {
+    const uint8_t* s = img.bytes.data() + static_cast<size_t>(y) * img.bmp.stride_bytes;
+    const uint8_t* d = png.rgba.data() + static_cast<size_t>(y) * png.width * 4;
+    for (int32_t x = 0; x < png.width; ++x, s += 4, d += 4) {
+      const uint8_t r = bgra ? s[2] : s[0];
+      const uint8_t b = bgra ? s[0] : s[2];
+      if (d[0] != r || d[1] != s[1] || d[2] != b || d[3] != s[3]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+const PngPreset kPresets[] = {PngPreset::Fast, PngPreset::Balanced, PngPreset::Small};
+
+bool RoundTrip(const TestImage& img, const PngEncodeOptions& options, DecodedPng* decoded,
+               std::vector<uint8_t>* png = nullptr) {
+  std::vector<uint8_t> local;
+  std::vector<uint8_t>* bytes = png ? png : &local;
+  if (!snappin::EncodePng(img.bmp, options, bytes)) {
+    std::fprintf(stderr, "encode failed\n");
+    return false;
+  }
+  if (!DecodePng(*bytes, decoded)) {
+    std::fprintf(stderr, "decode failed %dx%d preset=%s\n", img.bmp.size_px.w,
+                 img.bmp.size_px.h, snappin::PngPresetName(options.preset));
+    return false;
+  }
+  if (!MatchesSource(img, *decoded)) {
+    std::fprintf(stderr, "pixel mismatch %dx%d preset=%s\n", img.bmp.size_px.w,
+                 img.bmp.size_px.h, snappin::PngPresetName(options.preset));
+    return false;
+  }
+  return true;
+}
+
+int TestRoundTripSizes() {
+  const snappin::SizePX sizes[] = {{1, 1}, {2, 3}, {17, 5}, {64, 64}, {257, 33}, {333, 120}};
+  for (const auto& size : sizes) {
+    for (PixelFormat format : {PixelFormat::BGRA8, PixelFormat::RGBA8}) {
+      for (PngPreset preset : kPresets) {
+        const int32_t pad = (size.w % 3) * 4;
+        for (bool opaque : {true, false}) {
+          const TestImage img = MakeNoise(size.w, size.h, pad, format,
+                                          static_cast<uint32_t>(size.w * 7 + size.h), opaque);
+          PngEncodeOptions options;
+          options.preset = preset;
+          DecodedPng decoded;
+          if (!RoundTrip(img, options, &decoded)) {
+            return 10;
+          }
+          if (decoded.color_type != (opaque ? 2 : 6)) {
+            return 11;
+          }
+        }
+        const TestImage shot = MakeScreenshot(size.w, size.h, pad, format);
+        PngEncodeOptions options;
+        options.preset = preset;
+        DecodedPng decoded;
+        if (!RoundTrip(shot, options, &decoded)) {
+          return 12;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+int TestStripsAndThreads() {
+  const TestImage img = MakeScreenshot(800, 600, 16, PixelFormat::BGRA8);
+  for (PngPreset preset : kPresets) {
+    std::vector<uint8_t> reference;
+    for (int32_t strip_rows : {1, 7, 64, 0}) {
+      for (int32_t threads : {1, 3, 8}) {
+        PngEncodeOptions options;
+        options.preset = preset;
+        options.strip_rows = strip_rows;
+        options.threads = threads;
+        std::vector<uint8_t> png;
+        DecodedPng decoded;
+        if (!RoundTrip(img, options, &decoded, &png)) {
+          return 20;
+        }
+        const int expected_strips = strip_rows == 0 ? -1 : (600 + strip_rows - 1) / strip_rows;
+        if (expected_strips > 0 && decoded.idat_chunks != expected_strips) {
+          return 21;
+        }
+        // The layout, not the thread count, determines the bytes.
+        if (strip_rows == 0) {
+          if (reference.empty()) {
+            reference = png;
+          } else if (png != reference) {
+            return 22;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+int TestCompression() {
+  const TestImage shot = MakeScreenshot(1280, 720, 0, PixelFormat::BGRA8);
+  const size_t raw = static_cast<size_t>(1280) * 720 * 4;
+  size_t sizes[3] = {};
+  for (int i = 0; i < 3; ++i) {
+    PngEncodeOptions options;
+    options.preset = kPresets[i];
+    std::vector<uint8_t> png;
+    DecodedPng decoded;
+    if (!RoundTrip(shot, options, &decoded, &png)) {
+      return 30;
+    }
+    if (decoded.blocks.dynamic == 0) {
+      return 31;
+    }
+    sizes[i] = png.size();
+  }
+  if (sizes[0] * 8 > raw || sizes[2] > sizes[0] || sizes[2] > sizes[1]) {
+    std::fprintf(stderr, "sizes fast=%zu balanced=%zu small=%zu raw=%zu\n", sizes[0],
+                 sizes[1], sizes[2], raw);
+    return 32;
+  }
+
+  // Incompressible input falls back to stored blocks instead of growing.
+  const TestImage noise = MakeNoise(512, 256, 0, PixelFormat::RGBA8, 99, false);
+  std::vector<uint8_t> png;
+  DecodedPng decoded;
+  PngEncodeOptions options;
+  if (!RoundTrip(noise, options, &decoded, &png)) {
+    return 33;
+  }
+  const size_t filtered = static_cast<size_t>(512 * 4 + 1) * 256;
+  if (decoded.blocks.stored == 0 || png.size() > filtered + filtered / 100 + 256) {
+    return 34;
+  }
+
+  // Long flat rows: maximum-length matches and far distances.
+  TestImage flat = MakeBlank(4000, 40, 0, PixelFormat::BGRA8);
+  for (int32_t y = 0; y < 40; ++y) {
+    for (int32_t x = 0; x < 4000; ++x) {
+      SetPx(&flat, x, y, static_cast<uint8_t>(y * 5), 10, 200, 0xFF);
+    }
+  }
+  if (!RoundTrip(flat, options, &decoded, &png) || png.size() > 4096) {
+    return 35;
+  }
+  return 0;
+}
+
+int TestOptions() {
+  const TestImage shot = MakeScreenshot(40, 30, 0, PixelFormat::BGRA8);
+  PngEncodeOptions options;
+  options.drop_opaque_alpha = false;
+  DecodedPng decoded;
+  if (!RoundTrip(shot, options, &decoded) || decoded.color_type != 6) {
+    return 40;
+  }
+  snappin::PngEncodeStats stats;
+  std::vector<uint8_t> png;
+  options.drop_opaque_alpha = true;
+  options.strip_rows = 8;
+  options.threads = 2;
+  if (!snappin::EncodePng(shot.bmp, options, &png, &stats) || stats.strips != 4 ||
+      stats.threads != 2 || stats.has_alpha || stats.encoded_bytes != png.size() ||
+      stats.filtered_bytes != static_cast<size_t>(40 * 3 + 1) * 30) {
+    return 41;
+  }
+  return 0;
+}
+
+int TestInvalidInput() {
+  std::vector<uint8_t> png;
+  CpuBitmap empty;
+  if (snappin::EncodePng(empty, {}, &png)) {
+    return 50;
+  }
+  TestImage img = MakeBlank(4, 4, 0, PixelFormat::BGRA8);
+  if (snappin::EncodePng(img.bmp, {}, nullptr)) {
+    return 51;
+  }
+  img.bmp.stride_bytes = 12;
+  if (snappin::EncodePng(img.bmp, {}, &png)) {
+    return 52;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestRoundTripSizes()) {
+    return rc;
+  }
+  if (int rc = TestStripsAndThreads()) {
+    return rc;
+  }
+  if (int rc = TestCompression()) {
+    return rc;
+  }
+  if (int rc = TestOptions()) {
+    return rc;
+  }
+  if (int rc = TestInvalidInput()) {
+    return rc;
+  }
+  return 0;
+}
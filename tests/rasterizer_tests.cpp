@@ -0,0 +1,411 @@
+#include "Rasterizer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using snappin::ColorRGBA;
+using snappin::CpuBitmap;
+using snappin::PixelFormat;
+using snappin::PointF;
+using snappin::RasterizeShapes;
+using snappin::RasterOptions;
+using snappin::RectPX;
+using snappin::ShapeKind;
+using snappin::VectorShape;
+
+struct Canvas {
+  Canvas(int32_t w, int32_t h, uint8_t fill = 0)
+      : pixels(static_cast<size_t>(w) * static_cast<size_t>(h) * 4, fill) {
+    bitmap.format = PixelFormat::BGRA8;
+    bitmap.size_px = {w, h};
+    bitmap.stride_bytes = w * 4;
+    bitmap.data.p = pixels.data();
+  }
+
+  const uint8_t* at(int32_t x, int32_t y) const {
+    return pixels.data() + (static_cast<size_t>(y) * bitmap.size_px.w + x) * 4;
+  }
+
+  std::vector<uint8_t> pixels;
+  CpuBitmap bitmap;
+};
+
+VectorShape Stroke(ShapeKind kind, std::vector<PointF> points, float width,
+                   ColorRGBA color = {255, 255, 255, 255}, float opacity = 1.0f) {
+  VectorShape shape;
+  shape.kind = kind;
+  shape.points = std::move(points);
+  shape.stroke.width = width;
+  shape.stroke.color = color;
+  shape.stroke.opacity = opacity;
+  return shape;
+}
+
+VectorShape Fill(ShapeKind kind, std::vector<PointF> points, float opacity = 1.0f) {
+  VectorShape shape = Stroke(kind, std::move(points), 0.0f);
+  shape.fill.enabled = true;
+  shape.fill.color = {255, 255, 255, 255};
+  shape.fill.opacity = opacity;
+  return shape;
+}
+
+// Golden images are alpha coverage quantized to '.' (none) or a digit 0-9
+// (round(9 * a / 255)); a digit may differ by one level.
+bool MatchesGolden(const VectorShape& shape, const std::vector<const char*>& golden) {
+  const int32_t w = static_cast<int32_t>(std::strlen(golden[0]));
+  const int32_t h = static_cast<int32_t>(golden.size());
+  Canvas canvas(w, h);
+  if (!RasterizeShapes(&shape, 1, canvas.bitmap)) {
+    return false;
+  }
+  for (int32_t y = 0; y < h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      const int a = canvas.at(x, y)[3];
+      const char want = golden[static_cast<size_t>(y)][x];
+      if (want == '.') {
+        if (a != 0) {
+          return false;
+        }
+        continue;
+      }
+      const int level = (a * 9 + 127) / 255;
+      if (a == 0 || std::abs(level - (want - '0')) > 1) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int TestGoldens() {
+  const std::vector<const char*> rect = {
+      ".............",
+      ".............",
+      "..999999999..",
+      "..9.......9..",
+      "..9.......9..",
+      "..9.......9..",
+      "..9.......9..",
+      "..999999999..",
+      ".............",
+  };
+  if (!MatchesGolden(Stroke(ShapeKind::Rect, {{2.5f, 2.5f}, {10.5f, 7.5f}}, 1.0f), rect)) {
+    return 1;
+  }
+  // Corners swapped: same outline.
+  if (!MatchesGolden(Stroke(ShapeKind::Rect, {{10.5f, 7.5f}, {2.5f, 2.5f}}, 1.0f), rect)) {
+    return 2;
+  }
+  const std::vector<const char*> line = {
+      "772..........",
+      "7994.........",
+      ".59961.......",
+      "..38994......",
+      "...169961....",
+      ".....49983...",
+      "......16995..",
+      "........4997.",
+      ".........277.",
+      ".............",
+  };
+  if (!MatchesGolden(Stroke(ShapeKind::Line, {{1, 1}, {11, 8}}, 2.0f), line)) {
+    return 3;
+  }
+  const std::vector<const char*> arrow = {
+      "......20.........",
+      "......582........",
+      "......59961......",
+      "......5999830....",
+      "......59999971...",
+      ".99999999999991..",
+      "......59999971...",
+      "......5999830....",
+      "......59961......",
+      "......582........",
+      "......20.........",
+  };
+  if (!MatchesGolden(Stroke(ShapeKind::Arrow, {{1.5f, 5.5f}, {14.5f, 5.5f}}, 1.0f), arrow)) {
+    return 4;
+  }
+  const std::vector<const char*> triangle = {
+      ".............",
+      ".7876543210..",
+      ".4999999995..",
+      ".199999995...",
+      "..6999995....",
+      "..399995.....",
+      "..08995......",
+      "...595.......",
+      "...25........",
+      ".............",
+  };
+  if (!MatchesGolden(Fill(ShapeKind::Polygon, {{1, 1}, {11, 2}, {4, 9}}), triangle)) {
+    return 5;
+  }
+  return 0;
+}
+
+int TestExactFillCoverage() {
+  // Fractional edges: coverage is the covered area of each pixel.
+  Canvas canvas(8, 6);
+  const VectorShape shape = Fill(ShapeKind::Rect, {{1.25f, 1.5f}, {4.75f, 4.0f}});
+  if (!RasterizeShapes(&shape, 1, canvas.bitmap)) {
+    return 10;
+  }
+  const struct {
+    int32_t x;
+    int32_t y;
+    int alpha;
+  } probes[] = {{2, 2, 255}, {3, 3, 255}, {1, 2, 191}, {4, 3, 191}, {2, 1, 128},
+                {1, 1, 96},  {5, 2, 0},   {2, 4, 0},   {0, 0, 0}};
+  for (const auto& p : probes) {
+    if (std::abs(canvas.at(p.x, p.y)[3] - p.alpha) > 1) {
+      return 11;
+    }
+  }
+  // White over transparent black: color channels carry the same coverage.
+  if (canvas.at(1, 2)[0] != canvas.at(1, 2)[3] || canvas.at(1, 2)[2] != canvas.at(1, 2)[3]) {
+    return 12;
+  }
+  return 0;
+}
+
+int TestFillOutsideTarget() {
+  // Edges left and right of the target still bound the interior correctly.
+  Canvas canvas(10, 4);
+  const std::vector<VectorShape> shapes = {Fill(ShapeKind::Rect, {{-5, 0}, {3, 4}}),
+                                           Fill(ShapeKind::Rect, {{6, 0}, {25, 2}})};
+  if (!RasterizeShapes(shapes, canvas.bitmap)) {
+    return 20;
+  }
+  for (int32_t y = 0; y < 4; ++y) {
+    for (int32_t x = 0; x < 10; ++x) {
+      const bool inside = x < 3 || (x >= 6 && y < 2);
+      if (canvas.at(x, y)[3] != (inside ? 255 : 0)) {
+        return 21;
+      }
+    }
+  }
+  return 0;
+}
+
+int TestOpacityAndColor() {
+  Canvas canvas(6, 6, 0);
+  for (size_t i = 3; i < canvas.pixels.size(); i += 4) {
+    canvas.pixels[i] = 255;
+  }
+  VectorShape shape = Stroke(ShapeKind::Line, {{0, 3}, {6, 3}}, 2.0f, {255, 0, 0, 255}, 0.5f);
+  if (!RasterizeShapes(&shape, 1, canvas.bitmap)) {
+    return 30;
+  }
+  // BGRA byte order: red lands in byte 2.
+  const uint8_t* px = canvas.at(3, 2);
+  if (px[0] != 0 || px[1] != 0 || std::abs(px[2] - 128) > 1 || px[3] != 255) {
+    return 31;
+  }
+  if (canvas.at(3, 0)[2] != 0) {
+    return 32;
+  }
+
+  Canvas rgba(6, 6);
+  rgba.bitmap.format = PixelFormat::RGBA8;
+  shape.stroke.opacity = 1.0f;
+  if (!RasterizeShapes(&shape, 1, rgba.bitmap) || rgba.at(3, 2)[0] != 255 ||
+      rgba.at(3, 2)[2] != 0) {
+    return 33;
+  }
+  // Zero opacity or width draws nothing.
+  Canvas empty(6, 6);
+  shape.stroke.opacity = 0.0f;
+  VectorShape thin = shape;
+  thin.stroke.opacity = 1.0f;
+  thin.stroke.width = 0.0f;
+  if (!RasterizeShapes({shape, thin}, empty.bitmap) ||
+      empty.pixels != std::vector<uint8_t>(empty.pixels.size(), 0)) {
+    return 34;
+  }
+  return 0;
+}
+
+int TestNoDoubleBlend() {
+  // A pencil stroke that doubles back over itself blends each pixel once.
+  Canvas canvas(20, 8);
+  const VectorShape shape = Stroke(ShapeKind::Pencil, {{2, 4}, {18, 4}, {3, 4}, {17, 4}}, 2.0f,
+                                   {255, 255, 255, 255}, 0.5f);
+  if (!RasterizeShapes(&shape, 1, canvas.bitmap)) {
+    return 40;
+  }
+  if (std::abs(canvas.at(10, 3)[3] - 128) > 1 || std::abs(canvas.at(10, 4)[3] - 128) > 1) {
+    return 41;
+  }
+  // Separate shapes do stack.
+  const VectorShape again = shape;
+  if (!RasterizeShapes(&again, 1, canvas.bitmap) || std::abs(canvas.at(10, 3)[3] - 191) > 1) {
+    return 42;
+  }
+  // A single point is a round dot.
+  Canvas dot(8, 8);
+  const VectorShape tap = Stroke(ShapeKind::Pencil, {{4, 4}}, 4.0f);
+  if (!RasterizeShapes(&tap, 1, dot.bitmap) || dot.at(3, 3)[3] != 255 || dot.at(0, 0)[3] != 0) {
+    return 43;
+  }
+  return 0;
+}
+
+std::vector<VectorShape> RandomScene(uint32_t seed, int32_t w, int32_t h) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> xs(-20.0f, static_cast<float>(w) + 20.0f);
+  std::uniform_real_distribution<float> ys(-20.0f, static_cast<float>(h) + 20.0f);
+  std::uniform_real_distribution<float> widths(0.5f, 9.0f);
+  std::uniform_int_distribution<int> kinds(0, 4);
+  std::uniform_int_distribution<int> bytes(0, 255);
+  std::vector<VectorShape> shapes;
+  for (int i = 0; i < 40; ++i) {
+    const ShapeKind kind = static_cast<ShapeKind>(kinds(rng));
+    std::vector<PointF> points;
+    const int n = kind == ShapeKind::Pencil || kind == ShapeKind::Polygon ? 6 : 2;
+    for (int j = 0; j < n; ++j) {
+      points.push_back({xs(rng), ys(rng)});
+    }
+    const ColorRGBA color{static_cast<uint8_t>(bytes(rng)), static_cast<uint8_t>(bytes(rng)),
+                          static_cast<uint8_t>(bytes(rng)), 255};
+    VectorShape shape = Stroke(kind, std::move(points), widths(rng), color, 0.8f);
+    shape.fill.enabled = (i % 3) == 0;
+    shape.fill.color = color;
+    shape.fill.opacity = 0.4f;
+    shapes.push_back(std::move(shape));
+  }
+  return shapes;
+}
+
+int TestTilingAndThreadsInvariant() {
+  const int32_t w = 203;
+  const int32_t h = 157;
+  const std::vector<VectorShape> shapes = RandomScene(7, w, h);
+  Canvas reference(w, h, 40);
+  RasterOptions serial;
+  serial.tile_rows = 1 << 20;
+  if (!RasterizeShapes(shapes, reference.bitmap, serial)) {
+    return 50;
+  }
+  const struct {
+    int32_t tile_rows;
+    int32_t threads;
+  } configs[] = {{64, 1}, {1, 1}, {7, 4}, {16, 0}, {33, 3}};
+  for (const auto& c : configs) {
+    Canvas canvas(w, h, 40);
+    RasterOptions options;
+    options.tile_rows = c.tile_rows;
+    options.threads = c.threads;
+    if (!RasterizeShapes(shapes, canvas.bitmap, options)) {
+      return 51;
+    }
+    if (canvas.pixels != reference.pixels) {
+      return 52;
+    }
+  }
+  return 0;
+}
+
+int TestClip() {
+  const int32_t w = 120;
+  const int32_t h = 90;
+  const std::vector<VectorShape> shapes = RandomScene(11, w, h);
+  Canvas full(w, h, 17);
+  if (!RasterizeShapes(shapes, full.bitmap)) {
+    return 60;
+  }
+  const RectPX clips[] = {{10, 20, 37, 23}, {0, 0, 1, 1}, {100, 80, 50, 50}, {-5, -5, 30, 200}};
+  for (const RectPX& clip : clips) {
+    Canvas canvas(w, h, 17);
+    RasterOptions options;
+    options.clip = clip;
+    options.tile_rows = 5;
+    if (!RasterizeShapes(shapes, canvas.bitmap, options)) {
+      return 61;
+    }
+    for (int32_t y = 0; y < h; ++y) {
+      for (int32_t x = 0; x < w; ++x) {
+        const bool inside =
+            x >= clip.x && y >= clip.y && x < clip.x + clip.w && y < clip.y + clip.h;
+        const uint8_t* got = canvas.at(x, y);
+        const uint8_t* want = full.at(x, y);
+        for (int k = 0; k < 4; ++k) {
+          if (inside ? got[k] != want[k] : got[k] != 17) {
+            return 62;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+int TestBoundsAndInvalid() {
+  const VectorShape shape = Stroke(ShapeKind::Arrow, {{10, 10}, {60, 10}}, 3.0f);
+  const RectPX b = snappin::ShapeBounds(shape);
+  // Head wings reach max(5, 2w) = 6 px either side of the shaft.
+  if (b.x > 8 || b.y > 4 || b.x + b.w < 61 || b.y + b.h < 17) {
+    return 70;
+  }
+  Canvas canvas(80, 30);
+  RasterOptions options;
+  options.clip = b;
+  Canvas full(80, 30);
+  if (!RasterizeShapes(&shape, 1, canvas.bitmap, options) ||
+      !RasterizeShapes(&shape, 1, full.bitmap) || canvas.pixels != full.pixels) {
+    return 71;
+  }
+  const VectorShape nothing = Stroke(ShapeKind::Line, {}, 2.0f);
+  if (snappin::ShapeBounds(nothing).w != 0) {
+    return 72;
+  }
+  CpuBitmap bad;
+  if (RasterizeShapes(&shape, 1, bad)) {
+    return 73;
+  }
+  const VectorShape nan_shape = Stroke(ShapeKind::Line, {{0, 0}, {NAN, 3}}, 2.0f);
+  Canvas untouched(8, 8);
+  if (!RasterizeShapes(&nan_shape, 1, untouched.bitmap) ||
+      untouched.pixels != std::vector<uint8_t>(untouched.pixels.size(), 0)) {
+    return 74;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestGoldens()) {
+    return rc;
+  }
+  if (int rc = TestExactFillCoverage()) {
+    return rc;
+  }
+  if (int rc = TestFillOutsideTarget()) {
+    return rc;
+  }
+  if (int rc = TestOpacityAndColor()) {
+    return rc;
+  }
+  if (int rc = TestNoDoubleBlend()) {
+    return rc;
+  }
+  if (int rc = TestTilingAndThreadsInvariant()) {
+    return rc;
+  }
+  if (int rc = TestClip()) {
+    return rc;
+  }
+  if (int rc = TestBoundsAndInvalid()) {
+    return rc;
+  }
+  return 0;
+}
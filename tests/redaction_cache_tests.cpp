@@ -0,0 +1,203 @@
+#include "PixelKernels.h"
+#include "RedactionCache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+using snappin::BitmapView;
+using snappin::CpuBitmap;
+using snappin::PixelFormat;
+using snappin::RectPX;
+using snappin::RedactionCache;
+using snappin::RedactionKind;
+
+struct Image {
+  Image(int32_t w, int32_t h) : bytes(static_cast<size_t>(w) * static_cast<size_t>(h) * 4) {
+    bitmap.format = PixelFormat::BGRA8;
+    bitmap.size_px = {w, h};
+    bitmap.stride_bytes = w * 4;
+    bitmap.data.p = bytes.data();
+  }
+  std::vector<uint8_t> bytes;
+  CpuBitmap bitmap;
+};
+
+// Smooth gradients plus noise, so both blur and mosaic change most pixels.
+BitmapView MakeSource(int32_t w, int32_t h) {
+  auto buffer = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(w) * h * 4);
+  std::mt19937 rng(7);
+  for (int32_t y = 0; y < h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      uint8_t* px = buffer->data() + (static_cast<size_t>(y) * w + x) * 4;
+      px[0] = static_cast<uint8_t>(x * 3 + (rng() & 31));
+      px[1] = static_cast<uint8_t>(y * 2 + (rng() & 31));
+      px[2] = static_cast<uint8_t>((x ^ y) + (rng() & 63));
+      px[3] = 255;
+    }
+  }
+  return BitmapView::FromBuffer(buffer, {w, h}, w * 4);
+}
+
+// The whole source redacted in one call, as the tiles must reproduce.
+Image Whole(const BitmapView& source, RedactionKind kind, int32_t strength) {
+  Image out(source.size_px().w, source.size_px().h);
+  if (kind == RedactionKind::Blur) {
+    snappin::BoxBlurBitmap(source.AsCpuBitmap(), &out.bitmap, strength, 3);
+  } else {
+    snappin::PixelateBitmap(source.AsCpuBitmap(), &out.bitmap, strength);
+  }
+  return out;
+}
+
+bool Matches(const Image& actual, const Image& whole, const BitmapView& source,
+             const RectPX& rect) {
+  const int32_t w = source.size_px().w;
+  for (int32_t y = 0; y < source.size_px().h; ++y) {
+    for (int32_t x = 0; x < w; ++x) {
+      const bool inside = x >= rect.x && x < rect.x + rect.w && y >= rect.y &&
+                          y < rect.y + rect.h;
+      const size_t o = (static_cast<size_t>(y) * w + x) * 4;
+      const uint8_t* expected = inside ? whole.bytes.data() + o : source.row(y) + x * 4;
+      for (int c = 0; c < 4; ++c) {
+        if (actual.bytes[o + c] != expected[c]) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+Image CopyOf(const BitmapView& source) {
+  Image out(source.size_px().w, source.size_px().h);
+  for (int32_t y = 0; y < source.size_px().h; ++y) {
+    std::copy(source.row(y), source.row(y) + source.size_px().w * 4,
+              out.bytes.begin() + static_cast<std::ptrdiff_t>(y) * source.size_px().w * 4);
+  }
+  return out;
+}
+
+int TestTilesMatchWholeImage() {
+  // Not a multiple of the tile size, so edge tiles are partial.
+  const BitmapView source = MakeSource(700, 530);
+  RedactionCache cache;
+  cache.Reset(source);
+  std::mt19937 rng(3);
+  struct Mode {
+    RedactionKind kind;
+    int32_t strength;
+  };
+  const Mode modes[] = {{RedactionKind::Blur, 4},   {RedactionKind::Blur, 20},
+                        {RedactionKind::Mosaic, 12}, {RedactionKind::Mosaic, 100}};
+  for (const Mode& mode : modes) {
+    const Image whole = Whole(source, mode.kind, mode.strength);
+    for (int round = 0; round < 6; ++round) {
+      const RectPX rect{static_cast<int32_t>(rng() % 800) - 50,
+                        static_cast<int32_t>(rng() % 600) - 50,
+                        static_cast<int32_t>(rng() % 500), static_cast<int32_t>(rng() % 400)};
+      Image target = CopyOf(source);
+      if (!cache.Render(mode.kind, mode.strength, rect, target.bitmap)) {
+        return 1;
+      }
+      const RectPX clipped{std::max(rect.x, 0), std::max(rect.y, 0),
+                           std::min(rect.x + rect.w, 700) - std::max(rect.x, 0),
+                           std::min(rect.y + rect.h, 530) - std::max(rect.y, 0)};
+      if (!Matches(target, whole, source, clipped)) {
+        return 2;
+      }
+    }
+  }
+  // Everything rendered again comes from the cache.
+  const uint64_t misses = cache.Stats().tile_misses;
+  Image target = CopyOf(source);
+  if (!cache.Render(RedactionKind::Blur, 4, {0, 0, 700, 530}, target.bitmap) ||
+      cache.Stats().layers != 4) {
+    return 3;
+  }
+  const uint64_t refill = cache.Stats().tile_misses - misses;
+  if (!Matches(target, Whole(source, RedactionKind::Blur, 4), source, {0, 0, 700, 530}) ||
+      refill >= 12 || cache.Stats().tile_hits == 0) {
+    return 4;
+  }
+  if (!cache.Render(RedactionKind::Blur, 4, {0, 0, 700, 530}, target.bitmap) ||
+      cache.Stats().tile_misses != misses + refill) {
+    return 5;
+  }
+  return 0;
+}
+
+int TestBudget() {
+  const BitmapView source = MakeSource(512, 512);
+  const size_t layer_bytes = size_t{512} * 512 * 4;
+  RedactionCache cache(2 * layer_bytes);
+  cache.Reset(source);
+  Image target = CopyOf(source);
+  for (int32_t strength : {2, 3, 4}) {
+    if (!cache.Render(RedactionKind::Mosaic, strength, {0, 0, 512, 512}, target.bitmap)) {
+      return 10;
+    }
+  }
+  snappin::RedactionCacheStats stats = cache.Stats();
+  if (stats.layers != 2 || stats.bytes != 2 * layer_bytes || stats.evicted_layers != 1) {
+    return 11;
+  }
+  // The layer being drawn survives even when it alone exceeds the budget.
+  cache.SetBudget(layer_bytes / 2);
+  if (cache.Stats().layers != 0) {
+    return 12;
+  }
+  if (!cache.Render(RedactionKind::Blur, 8, {0, 0, 512, 512}, target.bitmap) ||
+      cache.Stats().layers != 1 ||
+      !Matches(target, Whole(source, RedactionKind::Blur, 8), source, {0, 0, 512, 512})) {
+    return 13;
+  }
+  cache.Reset(source);
+  if (cache.Stats().layers != 0 || cache.Stats().bytes != 0) {
+    return 14;
+  }
+  return 0;
+}
+
+int TestInvalid() {
+  RedactionCache cache;
+  Image target(16, 16);
+  if (cache.Render(RedactionKind::Blur, 2, {0, 0, 8, 8}, target.bitmap)) {
+    return 20;
+  }
+  cache.Reset(MakeSource(32, 32));
+  if (cache.Render(RedactionKind::Blur, 2, {0, 0, 8, 8}, target.bitmap)) {
+    return 21;
+  }
+  Image ok(32, 32);
+  ok.bitmap.format = PixelFormat::RGBA8;
+  if (cache.Render(RedactionKind::Mosaic, 2, {0, 0, 8, 8}, ok.bitmap)) {
+    return 22;
+  }
+  ok.bitmap.format = PixelFormat::BGRA8;
+  // Fully outside: nothing to do, nothing built.
+  if (!cache.Render(RedactionKind::Mosaic, 2, {40, 40, 8, 8}, ok.bitmap) ||
+      cache.Stats().tile_misses != 0) {
+    return 23;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestTilesMatchWholeImage()) {
+    return rc;
+  }
+  if (int rc = TestBudget()) {
+    return rc;
+  }
+  if (int rc = TestInvalid()) {
+    return rc;
+  }
+  return 0;
+}
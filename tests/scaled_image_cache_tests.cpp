@@ -0,0 +1,170 @@
+#include "PixelKernels.h"
+#include "ScaledImageCache.h"
+#include "test_pixels.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using snappin::BitmapView;
+using snappin::CpuBitmap;
+using snappin::PixelFormat;
+using snappin::ScaledImageCache;
+using snappin::ScaledImageCacheStats;
+using snappin::SizePX;
+using snappin::testing::NoiseImage;
+
+struct Owned {
+  std::vector<uint8_t> bytes;
+  CpuBitmap bmp;
+};
+
+Owned MakeTarget(int32_t w, int32_t h) {
+  Owned out;
+  out.bytes.resize(static_cast<size_t>(w) * h * 4);
+  out.bmp.format = PixelFormat::BGRA8;
+  out.bmp.size_px = {w, h};
+  out.bmp.stride_bytes = w * 4;
+  out.bmp.data.p = out.bytes.data();
+  return out;
+}
+
+bool SamePixels(const BitmapView& view, const Owned& expected) {
+  const int32_t w = expected.bmp.size_px.w;
+  if (view.size_px().w != w || view.size_px().h != expected.bmp.size_px.h) {
+    return false;
+  }
+  for (int32_t y = 0; y < view.size_px().h; ++y) {
+    if (std::memcmp(view.row(y), expected.bytes.data() + static_cast<size_t>(y) * w * 4,
+                    static_cast<size_t>(w) * 4) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int TestScaling() {
+  ScaledImageCache cache;
+  const BitmapView src = NoiseImage(400, 300, 7);
+  if (cache.Scaled(1, src, src.size_px()).data() != src.data()) {
+    return 1;
+  }
+  if (cache.Scaled(1, src, SizePX{0, 10}).valid() ||
+      cache.Scaled(1, BitmapView{}, SizePX{10, 10}).valid()) {
+    return 2;
+  }
+
+  // 90x70 comes from the second mip level (100x75).
+  Owned half = MakeTarget(200, 150);
+  Owned quarter = MakeTarget(100, 75);
+  Owned expected = MakeTarget(90, 70);
+  if (!snappin::DownsampleHalf(src.AsCpuBitmap(), &half.bmp) ||
+      !snappin::DownsampleHalf(half.bmp, &quarter.bmp) ||
+      !snappin::ResizeLanczos(quarter.bmp, &expected.bmp)) {
+    return 3;
+  }
+  const BitmapView small = cache.Scaled(1, src, SizePX{90, 70});
+  if (!SamePixels(small, expected)) {
+    return 4;
+  }
+  ScaledImageCacheStats stats = cache.Stats();
+  if (stats.misses != 1 || stats.hits != 0 || stats.levels_built != 2 || stats.entries != 1 ||
+      stats.bytes != (200 * 150 + 100 * 75 + 90 * 70) * 4u) {
+    return 5;
+  }
+  // Repainting at the same zoom reuses the pixels.
+  if (cache.Scaled(1, src, SizePX{90, 70}).data() != small.data() || cache.Stats().hits != 1) {
+    return 6;
+  }
+
+  // Larger than the first level: resampled from the source, no new levels.
+  Owned wide = MakeTarget(210, 160);
+  if (!snappin::ResizeLanczos(src.AsCpuBitmap(), &wide.bmp) ||
+      !SamePixels(cache.Scaled(1, src, SizePX{210, 160}), wide)) {
+    return 7;
+  }
+  // Zooming in works too.
+  Owned big = MakeTarget(500, 375);
+  if (!snappin::ResizeLanczos(src.AsCpuBitmap(), &big.bmp) ||
+      !SamePixels(cache.Scaled(1, src, SizePX{500, 375}), big)) {
+    return 8;
+  }
+  stats = cache.Stats();
+  if (stats.levels_built != 2 || stats.misses != 3) {
+    return 9;
+  }
+
+  // New pixels for the same key start over.
+  const BitmapView other = NoiseImage(400, 300, 8);
+  const BitmapView redone = cache.Scaled(1, other, SizePX{90, 70});
+  if (!redone.valid() || SamePixels(redone, expected) || cache.Stats().levels_built != 4) {
+    return 10;
+  }
+  cache.Remove(1);
+  stats = cache.Stats();
+  if (stats.entries != 0 || stats.bytes != 0) {
+    return 11;
+  }
+  return 0;
+}
+
+int TestBudget() {
+  // Each 160x160 result takes 100 KiB; the budget holds three.
+  const size_t each = 160 * 160 * 4;
+  ScaledImageCache cache(each * 3 + each / 2);
+  std::vector<BitmapView> sources;
+  for (uint32_t i = 0; i < 4; ++i) {
+    sources.push_back(NoiseImage(200, 200, 20 + i));
+  }
+  for (uint64_t key = 0; key < 3; ++key) {
+    if (!cache.Scaled(key, sources[key], SizePX{160, 160}).valid()) {
+      return 20;
+    }
+  }
+  // Touch key 0 so key 1 is the oldest when key 3 arrives.
+  cache.Scaled(0, sources[0], SizePX{160, 160});
+  cache.Scaled(3, sources[3], SizePX{160, 160});
+  ScaledImageCacheStats stats = cache.Stats();
+  if (stats.entries != 3 || stats.evictions != 1 || stats.bytes != each * 3 ||
+      stats.hits != 1) {
+    return 21;
+  }
+  // Key 1 comes back in place of key 2; key 0 survives.
+  cache.Scaled(1, sources[1], SizePX{160, 160});
+  if (cache.Stats().misses != 5) {
+    return 22;
+  }
+  cache.Scaled(0, sources[0], SizePX{160, 160});
+  if (cache.Stats().hits != 2) {
+    return 23;
+  }
+  // Results over half the budget are left to the caller.
+  if (cache.Scaled(0, sources[0], SizePX{400, 400}).valid()) {
+    return 24;
+  }
+  // Shrinking the budget evicts down to it.
+  cache.SetBudget(each);
+  stats = cache.Stats();
+  if (stats.bytes > each || stats.entries > 1) {
+    return 25;
+  }
+  cache.Clear();
+  if (cache.Stats().bytes != 0 || cache.Stats().entries != 0) {
+    return 26;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestScaling()) {
+    return rc;
+  }
+  if (int rc = TestBudget()) {
+    return rc;
+  }
+  return 0;
+}
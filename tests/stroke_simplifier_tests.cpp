@@ -0,0 +1,272 @@
+#include "StrokeSimplifier.h"
+#include "Rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using snappin::CpuBitmap;
+using snappin::PixelFormat;
+using snappin::PointF;
+using snappin::RasterizeShapes;
+using snappin::ShapeKind;
+using snappin::StrokeSimplifier;
+using snappin::StrokeSimplifierOptions;
+using snappin::VectorShape;
+
+constexpr int32_t kW = 600;
+constexpr int32_t kH = 400;
+
+// Alpha plane of a white pencil stroke on a transparent canvas.
+std::vector<uint8_t> Render(const std::vector<PointF>& points, float width) {
+  VectorShape shape;
+  shape.kind = ShapeKind::Pencil;
+  shape.points = points;
+  shape.stroke.width = width;
+  shape.stroke.color = {255, 255, 255, 255};
+  std::vector<uint8_t> pixels(static_cast<size_t>(kW) * kH * 4, 0);
+  CpuBitmap bitmap;
+  bitmap.format = PixelFormat::BGRA8;
+  bitmap.size_px = {kW, kH};
+  bitmap.stride_bytes = kW * 4;
+  bitmap.data.p = pixels.data();
+  RasterizeShapes(&shape, 1, bitmap);
+  std::vector<uint8_t> alpha(static_cast<size_t>(kW) * kH);
+  for (size_t i = 0; i < alpha.size(); ++i) {
+    alpha[i] = pixels[i * 4 + 3];
+  }
+  return alpha;
+}
+
+// Pixels that are solidly inked in `a` with nothing visible within one pixel
+// in `b`: a stroke that moved or lost a piece.
+int Misses(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+  int misses = 0;
+  for (int32_t y = 1; y < kH - 1; ++y) {
+    for (int32_t x = 1; x < kW - 1; ++x) {
+      if (a[static_cast<size_t>(y) * kW + x] < 128) {
+        continue;
+      }
+      uint8_t near = 0;
+      for (int32_t dy = -1; dy <= 1; ++dy) {
+        for (int32_t dx = -1; dx <= 1; ++dx) {
+          near = std::max(near, b[static_cast<size_t>(y + dy) * kW + x + dx]);
+        }
+      }
+      if (near < 64) {
+        ++misses;
+      }
+    }
+  }
+  return misses;
+}
+
+int MaxDiff(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+  int diff = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    diff = std::max(diff, std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+  }
+  return diff;
+}
+
+float DistanceToPolyline(const PointF& p, const std::vector<PointF>& line) {
+  float best = std::numeric_limits<float>::max();
+  for (size_t i = 0; i + 1 < line.size(); ++i) {
+    const PointF& a = line[i];
+    const PointF& b = line[i + 1];
+    const float vx = b.x - a.x;
+    const float vy = b.y - a.y;
+    const float len_sq = vx * vx + vy * vy;
+    float t = 0.0f;
+    if (len_sq > 0.0f) {
+      t = std::clamp(((p.x - a.x) * vx + (p.y - a.y) * vy) / len_sq, 0.0f, 1.0f);
+    }
+    best = std::min(best, std::hypot(p.x - a.x - t * vx, p.y - a.y - t * vy));
+  }
+  return best;
+}
+
+// A looping hand-drawn curve sampled at a high rate: the exact path and what a
+// mouse reports for it (integer pixel positions, repeats dropped, as the
+// annotate window already does).
+void Trajectory(std::vector<PointF>* exact, std::vector<PointF>* mouse) {
+  int32_t last_x = -1;
+  int32_t last_y = -1;
+  for (int i = 1; i <= 40000; ++i) {
+    const double t = i * 0.0004;
+    const double x = 300.0 + 200.0 * std::sin(t * 3.0) + 40.0 * std::sin(t * 11.0);
+    const double y = 200.0 + 150.0 * std::sin(t * 2.0 + 0.5);
+    exact->push_back({static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f});
+    const int32_t xi = static_cast<int32_t>(std::floor(x));
+    const int32_t yi = static_cast<int32_t>(std::floor(y));
+    if (xi == last_x && yi == last_y) {
+      continue;
+    }
+    last_x = xi;
+    last_y = yi;
+    mouse->push_back({xi + 0.5f, yi + 0.5f});
+  }
+}
+
+std::vector<PointF> Simplify(const std::vector<PointF>& samples,
+                             const StrokeSimplifierOptions& options) {
+  StrokeSimplifier simplifier(options);
+  for (const PointF& p : samples) {
+    simplifier.Add(p);
+  }
+  return simplifier.points();
+}
+
+int TestStreaming() {
+  StrokeSimplifierOptions options;
+  options.tolerance_px = 1.0f;
+  options.max_run = 16;
+  StrokeSimplifier s(options);
+  if (!s.points().empty() || s.committed() != 0) {
+    return 1;
+  }
+  std::vector<PointF> mouse;
+  std::vector<PointF> exact;
+  Trajectory(&exact, &mouse);
+  std::vector<PointF> prefix;
+  for (const PointF& p : mouse) {
+    s.Add(p);
+    // The newest sample is always drawn, and committed vertices never move.
+    const std::vector<PointF>& pts = s.points();
+    if (pts.back().x != p.x || pts.back().y != p.y || s.committed() > pts.size() ||
+        s.committed() < prefix.size()) {
+      return 2;
+    }
+    for (size_t i = 0; i < prefix.size(); ++i) {
+      if (pts[i].x != prefix[i].x || pts[i].y != prefix[i].y) {
+        return 3;
+      }
+    }
+    prefix.assign(pts.begin(), pts.begin() + static_cast<std::ptrdiff_t>(s.committed()));
+  }
+  if (s.samples() != mouse.size()) {
+    return 4;
+  }
+  // max_run bounds how many samples one kept segment may cover.
+  if (s.points().size() * 16 < mouse.size()) {
+    return 5;
+  }
+
+  s.Add({std::nanf(""), 1.0f});
+  s.Add({1.0f, std::numeric_limits<float>::infinity()});
+  if (s.samples() != mouse.size()) {
+    return 6;
+  }
+  s.Reset();
+  if (!s.points().empty() || s.samples() != 0 || s.committed() != 0) {
+    return 7;
+  }
+  // Zero tolerance drops only repeats and samples exactly on the kept line.
+  options.tolerance_px = 0.0f;
+  s.Reset(options);
+  const std::vector<PointF> zigzag{{0, 0}, {1, 0}, {1, 0}, {2, 0}, {3, 1}, {4, 1}};
+  for (const PointF& p : zigzag) {
+    s.Add(p);
+  }
+  if (s.points().size() != 4 || s.samples() != zigzag.size() || s.points()[2].x != 3.0f) {
+    return 8;
+  }
+  // Collinear samples collapse to their ends.
+  s.Reset();
+  for (int i = 0; i <= 10; ++i) {
+    s.Add({static_cast<float>(i), static_cast<float>(2 * i)});
+  }
+  if (s.points().size() != 2 || s.points()[1].x != 10.0f || s.points()[1].y != 20.0f) {
+    return 9;
+  }
+  return 0;
+}
+
+int TestToleranceBound() {
+  std::vector<PointF> exact;
+  std::vector<PointF> mouse;
+  Trajectory(&exact, &mouse);
+  for (float tolerance : {0.5f, 1.0f, 2.0f}) {
+    StrokeSimplifierOptions options;
+    options.tolerance_px = tolerance;
+    const std::vector<PointF> kept = Simplify(mouse, options);
+    for (const PointF& p : mouse) {
+      if (DistanceToPolyline(p, kept) > tolerance + 1e-3f) {
+        return 20;
+      }
+    }
+    if (kept.front().x != mouse.front().x || kept.back().y != mouse.back().y) {
+      return 21;
+    }
+  }
+  return 0;
+}
+
+int TestMouseStrokeLooksTheSame() {
+  std::vector<PointF> exact;
+  std::vector<PointF> mouse;
+  Trajectory(&exact, &mouse);
+
+  StrokeSimplifierOptions plain;
+  StrokeSimplifierOptions smoothed;
+  smoothed.tolerance_px = 0.5f;
+  smoothed.smoothing = true;
+  for (const StrokeSimplifierOptions& options : {plain, smoothed}) {
+    const std::vector<PointF> kept = Simplify(mouse, options);
+    if (kept.size() * 10 > mouse.size()) {
+      return 30;
+    }
+    for (float width : {1.0f, 2.0f, 4.0f}) {
+      const std::vector<uint8_t> before = Render(mouse, width);
+      const std::vector<uint8_t> after = Render(kept, width);
+      // The staircase of integer samples and its simplification differ in
+      // edge anti-aliasing, but neither has ink the other lacks.
+      if (Misses(before, after) != 0 || Misses(after, before) != 0) {
+        return 31;
+      }
+    }
+  }
+  return 0;
+}
+
+int TestSubpixelStrokeMatches() {
+  std::vector<PointF> exact;
+  std::vector<PointF> mouse;
+  Trajectory(&exact, &mouse);
+  StrokeSimplifierOptions options;
+  options.tolerance_px = 0.1f;
+  const std::vector<PointF> kept = Simplify(exact, options);
+  if (kept.size() * 10 > exact.size()) {
+    return 40;
+  }
+  for (float width : {1.0f, 3.0f}) {
+    const std::vector<uint8_t> before = Render(exact, width);
+    const std::vector<uint8_t> after = Render(kept, width);
+    if (MaxDiff(before, after) > 32 || Misses(before, after) != 0) {
+      return 41;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestStreaming()) {
+    return rc;
+  }
+  if (int rc = TestToleranceBound()) {
+    return rc;
+  }
+  if (int rc = TestMouseStrokeLooksTheSame()) {
+    return rc;
+  }
+  if (int rc = TestSubpixelStrokeMatches()) {
+    return rc;
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Scheduler overheads: tasks per second through Submit/WaitIdle from one
+// and from several submitting threads, and the latency of a small
+// ParallelFor against starting threads for every call, as PngEncoder and
+// the rasterizer did before. Not registered with ctest.
+
+namespace {
+
+using snappin::TaskPriority;
+using snappin::TaskScheduler;
+
+volatile int g_sink = 0;
+
+template <typename Fn>
+double NsPerCall(int calls, Fn&& fn) {
+  double best = 1e30;
+  for (int round = 0; round < 5; ++round) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+      fn(i);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+    if (ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+// A few hundred nanoseconds of work, so the strips are not free.
+void Spin(int32_t i) {
+  int acc = i;
+  for (int k = 0; k < 200; ++k) {
+    acc = acc * 1103515245 + 12345;
+  }
+  g_sink = g_sink + (acc & 1);
+}
+
+// The per-call thread pool the encoders used.
+void SpawnEach(int32_t count, int32_t threads) {
+  std::atomic<int32_t> next{0};
+  auto worker = [&]() {
+    for (int32_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+      Spin(i);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int32_t t = 1; t < threads; ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto& t : pool) {
+    t.join();
+  }
+}
+
+} // namespace
+
+int main() {
+  TaskScheduler scheduler;
+  const int32_t threads = scheduler.worker_count() + 1;
+  std::printf("workers: %d\n\n", scheduler.worker_count());
+
+  std::printf("%10s %16s\n", "submitters", "ns per task");
+  for (int submitters : {1, 2, 4}) {
+    const int tasks = 100000 / submitters;
+    const double ns = NsPerCall(1, [&](int) {
+      std::vector<std::thread> pool;
+      for (int s = 0; s < submitters; ++s) {
+        pool.emplace_back([&] {
+          for (int i = 0; i < tasks; ++i) {
+            scheduler.Submit([] { g_sink = g_sink + 1; }, TaskPriority::Interactive);
+          }
+        });
+      }
+      for (auto& t : pool) {
+        t.join();
+      }
+      scheduler.WaitIdle();
+    });
+    std::printf("%10d %16.1f\n", submitters, ns / (tasks * submitters));
+  }
+
+  std::printf("\n%8s %16s %16s\n", "strips", "spawn us", "scheduler us");
+  for (int32_t strips : {4, 16, 64, 256}) {
+    const int calls = 200;
+    const double spawn_ns = NsPerCall(calls, [&](int) { SpawnEach(strips, threads); });
+    const double pool_ns =
+        NsPerCall(calls, [&](int) { scheduler.ParallelFor(strips, threads, Spin); });
+    std::printf("%8d %16.1f %16.1f\n", strips, spawn_ns / 1000.0, pool_ns / 1000.0);
+  }
+  return 0;
+}
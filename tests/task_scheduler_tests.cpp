@@ -0,0 +1,302 @@
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using snappin::CancellationToken;
+using snappin::TaskPriority;
+using snappin::TaskScheduler;
+using snappin::TaskSchedulerStats;
+
+// Blocks its task until Open(), so tests can pile work up behind it.
+class Gate {
+public:
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return open_; });
+  }
+  void Open() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      open_ = true;
+    }
+    cv_.notify_all();
+  }
+
+private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool open_ = false;
+};
+
+int TestSubmitAndWait() {
+  TaskScheduler scheduler(4);
+  if (scheduler.worker_count() != 4) {
+    return 1;
+  }
+  std::atomic<int> sum{0};
+  for (int i = 1; i <= 1000; ++i) {
+    scheduler.Submit([&sum, i] { sum.fetch_add(i); });
+  }
+  scheduler.WaitIdle();
+  const TaskSchedulerStats stats = scheduler.Stats();
+  if (sum.load() != 500500 || stats.submitted != 1000 || stats.executed != 1000 ||
+      stats.queued != 0) {
+    return 2;
+  }
+  // A throwing task is counted and the worker keeps going.
+  scheduler.Submit([] { throw 1; });
+  scheduler.Submit([&sum] { sum.fetch_add(1); });
+  scheduler.WaitIdle();
+  if (scheduler.Stats().failed != 1 || sum.load() != 500501) {
+    return 3;
+  }
+  return 0;
+}
+
+// Tasks spawning tasks land on the spawning worker; idle workers steal them.
+int TestNestedSpawnAndSteal() {
+  TaskScheduler scheduler(4);
+  std::atomic<int> leaves{0};
+  std::function<void(int)> spawn = [&](int depth) {
+    if (depth == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      leaves.fetch_add(1);
+      return;
+    }
+    for (int i = 0; i < 4; ++i) {
+      scheduler.Submit([&spawn, depth] { spawn(depth - 1); });
+    }
+  };
+  scheduler.Submit([&spawn] { spawn(4); });
+  scheduler.WaitIdle();
+  if (leaves.load() != 256 || scheduler.Stats().stolen == 0) {
+    return 10;
+  }
+  return 0;
+}
+
+int TestPriorities() {
+  TaskScheduler scheduler(1);
+  Gate gate;
+  scheduler.Submit([&gate] { gate.Wait(); });
+  std::mutex mu;
+  std::vector<int> order;
+  for (int i = 0; i < 3; ++i) {
+    scheduler.Submit([&, i] {
+      std::lock_guard<std::mutex> lock(mu);
+      order.push_back(100 + i);
+    });
+    scheduler.Submit(
+        [&, i] {
+          std::lock_guard<std::mutex> lock(mu);
+          order.push_back(i);
+        },
+        TaskPriority::Interactive);
+  }
+  gate.Open();
+  scheduler.WaitIdle();
+  if (order.size() != 6) {
+    return 20;
+  }
+  // Interactive work first; within a priority a worker's own queue is LIFO.
+  for (size_t i = 0; i < 3; ++i) {
+    if (order[i] >= 100 || order[i + 3] < 100) {
+      return 21;
+    }
+  }
+  return 0;
+}
+
+int TestCancellation() {
+  TaskScheduler scheduler(1);
+  Gate gate;
+  scheduler.Submit([&gate] { gate.Wait(); });
+  CancellationToken token = CancellationToken::Create();
+  const CancellationToken copy = token;
+  std::atomic<int> ran{0};
+  for (int i = 0; i < 10; ++i) {
+    scheduler.Submit([&ran] { ran.fetch_add(1); }, TaskPriority::Background, token);
+  }
+  std::atomic<int> then_calls{0};
+  bool then_completed = true;
+  scheduler.SubmitThen([&ran] { ran.fetch_add(1); },
+                       [&](bool completed) {
+                         then_completed = completed;
+                         then_calls.fetch_add(1);
+                       },
+                       TaskPriority::Interactive, token);
+  copy.Cancel();
+  if (!token.cancelled() || CancellationToken{}.cancelled()) {
+    return 30;
+  }
+  gate.Open();
+  scheduler.WaitIdle();
+  // The continuation still comes, saying the task did not run.
+  if (ran.load() != 0 || scheduler.Stats().cancelled != 11 ||
+      scheduler.RunUiContinuations() != 1 || then_calls.load() != 1 || then_completed) {
+    return 31;
+  }
+  return 0;
+}
+
+int TestContinuations() {
+  TaskScheduler scheduler(2);
+  std::atomic<int> wakeups{0};
+  scheduler.SetUiWakeup([&wakeups] { wakeups.fetch_add(1); });
+  const std::thread::id ui = std::this_thread::get_id();
+  std::atomic<int> worked{0};
+  int completed = 0;
+  bool on_ui = true;
+  for (int i = 0; i < 20; ++i) {
+    scheduler.SubmitThen(
+        [&worked, ui] {
+          if (std::this_thread::get_id() != ui) {
+            worked.fetch_add(1);
+          }
+        },
+        [&](bool ok) {
+          completed += ok ? 1 : 0;
+          on_ui = on_ui && std::this_thread::get_id() == ui;
+        });
+  }
+  scheduler.SubmitThen([] { throw std::bad_alloc(); },
+                       [&](bool ok) { completed += ok ? 0 : 100; });
+  scheduler.WaitIdle();
+  // Nothing runs until the UI thread asks; one wakeup per empty-to-busy edge.
+  if (completed != 0 || wakeups.load() < 1 || wakeups.load() > 21) {
+    return 40;
+  }
+  if (scheduler.RunUiContinuations() != 21 || completed != 120 || !on_ui ||
+      worked.load() != 20 || scheduler.RunUiContinuations() != 0 ||
+      scheduler.Stats().continuations != 21) {
+    return 41;
+  }
+  return 0;
+}
+
+int TestParallelFor() {
+  TaskScheduler scheduler(3);
+  std::vector<std::atomic<int>> hits(1000);
+  if (!scheduler.ParallelFor(1000, 0, [&](int32_t i) { hits[i].fetch_add(1); })) {
+    return 50;
+  }
+  for (const auto& h : hits) {
+    if (h.load() != 1) {
+      return 51;
+    }
+  }
+  // One thread runs inline, in order.
+  std::vector<int32_t> order;
+  const std::thread::id caller = std::this_thread::get_id();
+  bool inline_only = true;
+  scheduler.ParallelFor(50, 1, [&](int32_t i) {
+    order.push_back(i);
+    inline_only = inline_only && std::this_thread::get_id() == caller;
+  });
+  for (int32_t i = 0; i < 50; ++i) {
+    if (order.size() != 50 || order[i] != i || !inline_only) {
+      return 52;
+    }
+  }
+  if (!scheduler.ParallelFor(0, 0, [](int32_t) {})) {
+    return 53;
+  }
+  // Nested loops from workers finish even with every worker busy in one.
+  std::atomic<int> inner{0};
+  if (!scheduler.ParallelFor(8, 0, [&](int32_t) {
+        scheduler.ParallelFor(64, 0, [&](int32_t) { inner.fetch_add(1); });
+      }) ||
+      inner.load() != 8 * 64) {
+    return 54;
+  }
+  // bad_alloc stops the loop and reports failure.
+  std::atomic<int> after{0};
+  if (scheduler.ParallelFor(10000, 0, [&](int32_t i) {
+        if (i == 10) {
+          throw std::bad_alloc();
+        }
+        after.fetch_add(1);
+      }) ||
+      after.load() >= 9999) {
+    return 55;
+  }
+  CancellationToken token = CancellationToken::Create();
+  std::atomic<int> done{0};
+  if (scheduler.ParallelFor(
+          10000, 0,
+          [&](int32_t i) {
+            if (i == 100) {
+              token.Cancel();
+            }
+            done.fetch_add(1);
+          },
+          TaskPriority::Interactive, token) ||
+      done.load() >= 10000) {
+    return 56;
+  }
+  scheduler.WaitIdle();
+  return 0;
+}
+
+int TestConcurrentSubmitters() {
+  std::atomic<int64_t> sum{0};
+  {
+    TaskScheduler scheduler(4);
+    std::vector<std::thread> submitters;
+    for (int t = 0; t < 4; ++t) {
+      submitters.emplace_back([&scheduler, &sum, t] {
+        for (int i = 0; i < 5000; ++i) {
+          scheduler.Submit([&sum] { sum.fetch_add(1); },
+                           (i + t) % 3 == 0 ? TaskPriority::Interactive
+                                            : TaskPriority::Background);
+          if (i % 500 == 0) {
+            scheduler.ParallelFor(16, 0, [&sum](int32_t) { sum.fetch_add(1); });
+          }
+        }
+      });
+    }
+    for (auto& t : submitters) {
+      t.join();
+    }
+    // Destruction runs whatever is still queued.
+  }
+  if (sum.load() != 4 * 5000 + 4 * 10 * 16) {
+    return 60;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  int rc = TestSubmitAndWait();
+  if (rc == 0) {
+    rc = TestNestedSpawnAndSteal();
+  }
+  if (rc == 0) {
+    rc = TestPriorities();
+  }
+  if (rc == 0) {
+    rc = TestCancellation();
+  }
+  if (rc == 0) {
+    rc = TestContinuations();
+  }
+  if (rc == 0) {
+    rc = TestParallelFor();
+  }
+  if (rc == 0) {
+    rc = TestConcurrentSubmitters();
+  }
+  return rc;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Types.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Pixel helpers shared by the image tests.
+namespace snappin::testing {
+
+// Seeded LCG noise in a fresh buffer: the same pixels for the same seed at
+// any row padding (padding bytes are 0xCD). Noise compresses to about its raw
+// size.
+inline BitmapView NoiseImage(int32_t w, int32_t h, uint32_t seed, int32_t pad = 0,
+                             PixelFormat format = PixelFormat::BGRA8) {
+  const int32_t stride = w * 4 + pad;
+  auto bytes = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(stride) * h, 0xCD);
+  uint32_t state = seed;
+  for (int32_t y = 0; y < h; ++y) {
+    uint8_t* row = bytes->data() + static_cast<size_t>(y) * stride;
+    for (int32_t x = 0; x < w * 4; ++x) {
+      state = state * 1664525u + 1013904223u;
+      row[x] = static_cast<uint8_t>(state >> 24);
+    }
+  }
+  return BitmapView::FromBuffer(bytes, SizePX{w, h}, stride, format);
+}
+
+// Same size, format and pixels; strides may differ.
+inline bool SameRows(const BitmapView& a, const BitmapView& b) {
+  if (!a.valid() || !b.valid() || a.size_px().w != b.size_px().w ||
+      a.size_px().h != b.size_px().h || a.format() != b.format()) {
+    return false;
+  }
+  for (int32_t y = 0; y < a.size_px().h; ++y) {
+    if (std::memcmp(a.row(y), b.row(y), static_cast<size_t>(a.size_px().w) * 4) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace snappin::testing
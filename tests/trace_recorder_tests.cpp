@@ -0,0 +1,298 @@
+#include "Json.h"
+#include "TraceRecorder.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using snappin::JsonValue;
+using snappin::TraceRecorder;
+using snappin::TraceStats;
+
+// The recorder is process-wide: every test starts from a cleared, disabled one.
+TraceRecorder& Fresh() {
+  TraceRecorder& recorder = TraceRecorder::Shared();
+  TraceRecorder::SetEnabled(false);
+  recorder.Clear();
+  return recorder;
+}
+
+bool ParseDump(const TraceRecorder& recorder, JsonValue* doc) {
+  return snappin::ParseJson(recorder.DumpJson(), doc) && doc->Find("traceEvents") &&
+         doc->Find("traceEvents")->is_array();
+}
+
+// Events named `name` (metadata excluded).
+std::vector<const JsonValue*> EventsNamed(const JsonValue& doc, const std::string& name) {
+  std::vector<const JsonValue*> found;
+  for (const JsonValue& ev : doc.Find("traceEvents")->items()) {
+    std::string ev_name;
+    std::string phase;
+    if (ev.ReadString("name", &ev_name) && ev_name == name && ev.ReadString("ph", &phase) &&
+        phase != "M") {
+      found.push_back(&ev);
+    }
+  }
+  return found;
+}
+
+void Work(int n) {
+  volatile int sink = 0;
+  for (int i = 0; i < n; ++i) {
+    sink = sink + i;
+  }
+}
+
+int TestDisabled() {
+  TraceRecorder& recorder = Fresh();
+  const uint64_t before = recorder.Stats().recorded;
+  {
+    SNAPPIN_TRACE_SPAN("disabled.span");
+    recorder.Counter("disabled.counter", 1);
+  }
+  JsonValue doc;
+  if (recorder.Stats().recorded != before || before != 0 || !ParseDump(recorder, &doc) ||
+      !EventsNamed(doc, "disabled.span").empty()) {
+    return 1;
+  }
+  // Naming a thread while off allocates no ring; the name still reaches the
+  // ring made when that thread first records.
+  const size_t threads = recorder.Stats().threads;
+  bool named_without_ring = false;
+  std::thread late([&] {
+    recorder.SetThreadName("late");
+    named_without_ring = recorder.Stats().threads == threads;
+    TraceRecorder::SetEnabled(true);
+    { SNAPPIN_TRACE_SPAN("late.span"); }
+    TraceRecorder::SetEnabled(false);
+  });
+  late.join();
+  if (!named_without_ring) {
+    return 2;
+  }
+  bool named = false;
+  if (!ParseDump(recorder, &doc) || EventsNamed(doc, "late.span").size() != 1) {
+    return 3;
+  }
+  for (const JsonValue& ev : doc.Find("traceEvents")->items()) {
+    std::string name;
+    const JsonValue* meta = ev.Find("args");
+    if (ev.ReadString("name", &name) && name == "thread_name" && meta &&
+        meta->ReadString("name", &name) && name == "late") {
+      named = true;
+    }
+  }
+  if (!named) {
+    return 4;
+  }
+  return 0;
+}
+
+int TestSpansAndCounters() {
+  TraceRecorder& recorder = Fresh();
+  TraceRecorder::SetEnabled(true);
+  recorder.SetThreadName("main \"test\"");
+  {
+    SNAPPIN_TRACE_SPAN("outer", "export");
+    Work(10000);
+    {
+      SNAPPIN_TRACE_SPAN("inner");
+      Work(10000);
+    }
+    recorder.Counter("queue.depth", -3);
+  }
+  TraceRecorder::SetEnabled(false);
+  JsonValue doc;
+  if (recorder.Stats().recorded != 3 || !ParseDump(recorder, &doc)) {
+    return 10;
+  }
+  const std::vector<const JsonValue*> outer = EventsNamed(doc, "outer");
+  const std::vector<const JsonValue*> inner = EventsNamed(doc, "inner");
+  const std::vector<const JsonValue*> counter = EventsNamed(doc, "queue.depth");
+  if (outer.size() != 1 || inner.size() != 1 || counter.size() != 1) {
+    return 11;
+  }
+  std::string phase;
+  std::string category;
+  double outer_ts = 0;
+  double outer_dur = 0;
+  double inner_ts = 0;
+  double inner_dur = 0;
+  double tid_outer = 0;
+  double tid_inner = 0;
+  if (!outer[0]->ReadString("ph", &phase) || phase != "X" ||
+      !outer[0]->ReadString("cat", &category) || category != "export" ||
+      !outer[0]->ReadNumber("ts", &outer_ts) || !outer[0]->ReadNumber("dur", &outer_dur) ||
+      !inner[0]->ReadNumber("ts", &inner_ts) || !inner[0]->ReadNumber("dur", &inner_dur) ||
+      !outer[0]->ReadNumber("tid", &tid_outer) || !inner[0]->ReadNumber("tid", &tid_inner)) {
+    return 12;
+  }
+  // The inner span nests inside the outer one on the same thread.
+  if (outer_ts < 0 || inner_ts < outer_ts || inner_ts + inner_dur > outer_ts + outer_dur ||
+      inner_dur <= 0 || tid_outer != tid_inner) {
+    return 13;
+  }
+  const JsonValue* args = counter[0]->Find("args");
+  double value = 0;
+  if (!args || !args->ReadNumber("value", &value) || value != -3) {
+    return 14;
+  }
+  // The thread name comes through escaped.
+  bool named = false;
+  for (const JsonValue& ev : doc.Find("traceEvents")->items()) {
+    std::string name;
+    const JsonValue* meta = ev.Find("args");
+    if (ev.ReadString("name", &name) && name == "thread_name" && meta &&
+        meta->ReadString("name", &name) && name == "main \"test\"") {
+      named = true;
+    }
+  }
+  if (!named) {
+    return 15;
+  }
+  return 0;
+}
+
+int TestWrapAround() {
+  TraceRecorder& recorder = Fresh();
+  TraceRecorder::SetEnabled(true);
+  const size_t total = TraceRecorder::kEventsPerThread + 100;
+  for (size_t i = 0; i < total; ++i) {
+    SNAPPIN_TRACE_SPAN(i < 100 ? "wrap.old" : "wrap.new");
+  }
+  TraceRecorder::SetEnabled(false);
+  const TraceStats stats = recorder.Stats();
+  JsonValue doc;
+  // The oldest event of a full ring shares its slot with the next write, so
+  // dumps leave it out.
+  if (stats.recorded != total || stats.overwritten != 100 || !ParseDump(recorder, &doc) ||
+      !EventsNamed(doc, "wrap.old").empty() ||
+      EventsNamed(doc, "wrap.new").size() != TraceRecorder::kEventsPerThread - 1) {
+    return 20;
+  }
+  recorder.Clear();
+  if (recorder.Stats().recorded != 0 || !ParseDump(recorder, &doc) ||
+      !EventsNamed(doc, "wrap.new").empty()) {
+    return 21;
+  }
+  return 0;
+}
+
+// Threads record while the main thread dumps; every dump parses.
+int TestConcurrentDump(const fs::path& dir) {
+  TraceRecorder& recorder = Fresh();
+  TraceRecorder::SetEnabled(true);
+  std::atomic<bool> done{false};
+  std::atomic<int> running{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      TraceRecorder::Shared().SetThreadName("worker");
+      bool counted = false;
+      while (!done.load()) {
+        {
+          SNAPPIN_TRACE_SPAN("worker.span", "test");
+          TraceRecorder::Shared().Counter("worker.counter", 7);
+        }
+        if (!counted) {
+          counted = true;
+          running.fetch_add(1);
+        }
+      }
+    });
+  }
+  while (running.load() < 4) {
+    std::this_thread::yield();
+  }
+  int rc = 0;
+  for (int i = 0; i < 20 && rc == 0; ++i) {
+    JsonValue doc;
+    if (!ParseDump(recorder, &doc)) {
+      rc = 30;
+    }
+  }
+  done.store(true);
+  for (auto& t : threads) {
+    t.join();
+  }
+  TraceRecorder::SetEnabled(false);
+  if (rc != 0) {
+    return rc;
+  }
+  JsonValue doc;
+  if (!ParseDump(recorder, &doc) || EventsNamed(doc, "worker.span").empty() ||
+      recorder.Stats().threads < 5) {
+    return 31;
+  }
+  // The file holds the same document.
+  const fs::path path = dir / "trace.json";
+  if (!recorder.DumpToFile(path)) {
+    return 32;
+  }
+  std::ifstream in(path, std::ios::binary);
+  const std::string text((std::istreambuf_iterator<char>(in)), {});
+  if (!snappin::ParseJson(text, &doc) || EventsNamed(doc, "worker.span").empty()) {
+    return 33;
+  }
+  return 0;
+}
+
+// Per-span cost, best of several rounds so a busy machine does not fail it:
+// disabled spans must be nearly free, enabled ones cost about two clock
+// reads. The limits leave room for unoptimized builds.
+int TestOverhead() {
+  TraceRecorder& recorder = Fresh();
+  auto best_ns = [](int spans) {
+    double best = 1e30;
+    for (int round = 0; round < 5; ++round) {
+      const uint64_t t0 = TraceRecorder::NowNs();
+      for (int i = 0; i < spans; ++i) {
+        SNAPPIN_TRACE_SPAN("overhead");
+      }
+      const double ns = static_cast<double>(TraceRecorder::NowNs() - t0) / spans;
+      best = ns < best ? ns : best;
+    }
+    return best;
+  };
+  const double disabled_ns = best_ns(1000000);
+  TraceRecorder::SetEnabled(true);
+  const double enabled_ns = best_ns(100000);
+  TraceRecorder::SetEnabled(false);
+  recorder.Clear();
+  if (disabled_ns > 50.0 || enabled_ns > 2000.0) {
+    return 40;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  const fs::path root = fs::temp_directory_path() / "snappin_trace_recorder_tests";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root, ec);
+  int rc = TestDisabled();
+  if (rc == 0) {
+    rc = TestSpansAndCounters();
+  }
+  if (rc == 0) {
+    rc = TestWrapAround();
+  }
+  if (rc == 0) {
+    rc = TestConcurrentDump(root);
+  }
+  if (rc == 0) {
+    rc = TestOverhead();
+  }
+  fs::remove_all(root, ec);
+  return rc;
+}
@@ -0,0 +1,85 @@
+#include "WindowRectIndex.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Hover lookup cost per query against the number of top-level windows: a
+// z-order walk over cached rects (the old per-tick loop minus its
+// cross-process calls, so a lower bound for it) against the grid index.
+// Not registered with ctest.
+
+namespace {
+
+using snappin::PointPX;
+using snappin::WindowRectEntry;
+
+volatile uint64_t g_sink = 0;
+
+template <typename Fn>
+double NsPerCall(int calls, Fn&& fn) {
+  double best = 1e30;
+  for (int round = 0; round < 5; ++round) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+      fn(i);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+    if (ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+} // namespace
+
+int main() {
+  std::printf("%8s %12s %12s %12s %10s\n", "windows", "build us", "linear ns", "index ns",
+              "cell refs");
+  for (int count : {16, 64, 256, 1024}) {
+    std::mt19937 rng(static_cast<uint32_t>(count));
+    std::uniform_int_distribution<int32_t> x(0, 3840);
+    std::uniform_int_distribution<int32_t> y(0, 2160);
+    std::uniform_int_distribution<int32_t> w(80, 1600);
+    std::uniform_int_distribution<int32_t> h(40, 1000);
+    std::vector<WindowRectEntry> entries;
+    for (int i = 0; i < count; ++i) {
+      entries.push_back({{x(rng), y(rng), w(rng), h(rng)}, static_cast<uint64_t>(i + 1)});
+    }
+    std::vector<PointPX> points(4096);
+    for (PointPX& pt : points) {
+      pt = PointPX{x(rng), y(rng)};
+    }
+
+    snappin::WindowRectIndex index;
+    const auto b0 = std::chrono::steady_clock::now();
+    index.Build(entries);
+    const auto b1 = std::chrono::steady_clock::now();
+    const double build_us = std::chrono::duration<double, std::micro>(b1 - b0).count();
+
+    const int calls = 400000;
+    const double linear_ns = NsPerCall(calls, [&](int i) {
+      const PointPX& pt = points[static_cast<size_t>(i) & 4095];
+      for (const WindowRectEntry& e : entries) {
+        if (pt.x >= e.rect.x && pt.y >= e.rect.y && pt.x < e.rect.x + e.rect.w &&
+            pt.y < e.rect.y + e.rect.h) {
+          g_sink = g_sink + e.id;
+          break;
+        }
+      }
+    });
+    const double index_ns = NsPerCall(calls, [&](int i) {
+      const PointPX& pt = points[static_cast<size_t>(i) & 4095];
+      if (const WindowRectEntry* e = index.TopmostAt(pt)) {
+        g_sink = g_sink + e->id;
+      }
+    });
+    std::printf("%8d %12.1f %12.1f %12.1f %10zu\n", count, build_us, linear_ns, index_ns,
+                index.cell_refs());
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include "WindowRectIndex.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+using snappin::PointPX;
+using snappin::RectPX;
+using snappin::WindowRectEntry;
+using snappin::WindowRectIndex;
+
+// What the overlay did before: walk the z-order until a rect contains the point.
+const WindowRectEntry* LinearTopmost(const std::vector<WindowRectEntry>& entries,
+                                     const PointPX& pt) {
+  for (const WindowRectEntry& e : entries) {
+    if (e.rect.w > 0 && e.rect.h > 0 && pt.x >= e.rect.x && pt.y >= e.rect.y &&
+        pt.x < e.rect.x + e.rect.w && pt.y < e.rect.y + e.rect.h) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+int TestBasics() {
+  WindowRectIndex index;
+  if (index.TopmostAt({0, 0})) {
+    return 1;
+  }
+  // Topmost first: a dialog over an editor over a maximized browser.
+  index.Build({{{100, 100, 200, 100}, 3}, {{50, 50, 400, 300}, 2}, {{0, 0, 1920, 1080}, 1},
+               {{10, 10, 0, 50}, 9}});
+  if (index.size() != 3) {
+    return 2;
+  }
+  struct Probe {
+    PointPX pt;
+    uint64_t id;
+  } probes[] = {{{150, 150}, 3}, {{100, 100}, 3}, {{299, 199}, 3}, {{300, 199}, 2},
+                {{60, 60}, 2},   {{449, 349}, 2}, {{450, 349}, 1}, {{0, 0}, 1},
+                {{1919, 1079}, 1}, {{1920, 0}, 0}, {{-1, 5}, 0},   {{5, 1080}, 0}};
+  for (const Probe& p : probes) {
+    const WindowRectEntry* hit = index.TopmostAt(p.pt);
+    if ((hit ? hit->id : 0) != p.id) {
+      return 3;
+    }
+  }
+  index.Clear();
+  if (!index.empty() || index.TopmostAt({150, 150})) {
+    return 4;
+  }
+  return 0;
+}
+
+int TestMatchesLinearScan() {
+  std::mt19937 rng(11);
+  // Two monitors, the left one at negative coordinates.
+  std::uniform_int_distribution<int32_t> x(-2560, 1900);
+  std::uniform_int_distribution<int32_t> y(-100, 1400);
+  std::uniform_int_distribution<int32_t> extent(0, 1400);
+  for (int trial = 0; trial < 20; ++trial) {
+    std::vector<WindowRectEntry> entries;
+    const int count = 1 + trial * 25;
+    for (int i = 0; i < count; ++i) {
+      entries.push_back({{x(rng), y(rng), extent(rng), extent(rng) / 2},
+                         static_cast<uint64_t>(i + 1)});
+    }
+    WindowRectIndex index;
+    index.Build(entries);
+    for (int q = 0; q < 4000; ++q) {
+      const PointPX pt{x(rng), y(rng)};
+      const WindowRectEntry* want = LinearTopmost(entries, pt);
+      const WindowRectEntry* got = index.TopmostAt(pt);
+      if ((want ? want->id : 0) != (got ? got->id : 0)) {
+        return 10;
+      }
+    }
+  }
+  return 0;
+}
+
+int TestSingleAndTinyRects() {
+  WindowRectIndex index;
+  index.Build({{{-5, -5, 1, 1}, 1}});
+  if (!index.TopmostAt({-5, -5}) || index.TopmostAt({-4, -5}) || index.TopmostAt({-5, -6})) {
+    return 20;
+  }
+  // Far-apart windows keep the grid bounded.
+  index.Build({{{-30000, -30000, 10, 10}, 1}, {{30000, 30000, 10, 10}, 2}});
+  const WindowRectEntry* a = index.TopmostAt({-29995, -29995});
+  const WindowRectEntry* b = index.TopmostAt({30009, 30009});
+  if (!a || a->id != 1 || !b || b->id != 2 || index.TopmostAt({0, 0}) ||
+      index.cell_refs() != 2) {
+    return 21;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (int rc = TestBasics()) {
+    return rc;
+  }
+  if (int rc = TestMatchesLinearScan()) {
+    return rc;
+  }
+  if (int rc = TestSingleAndTinyRects()) {
+    return rc;
+  }
+  return 0;
+}